@@ -2,6 +2,7 @@
 #include <dmlc/logging.h>
 #include <dmlc/omp.h>
 #include <xgboost/c_api.h>
+#include <xgboost/data.h>
 #include <vector>
 #include <string>
 #include <utility>
@@ -69,22 +70,14 @@ SEXP XGDMatrixCreateFromMat_R(SEXP mat,
   size_t nrow = static_cast<size_t>(INTEGER(dim)[0]);
   size_t ncol = static_cast<size_t>(INTEGER(dim)[1]);
   const bool is_int = TYPEOF(mat) == INTSXP;
-  double *din;
-  int *iin;
-  if (is_int) {
-    iin = INTEGER(mat);
-  } else {
-    din = REAL(mat);
-  }
-  std::vector<float> data(nrow * ncol);
-  #pragma omp parallel for schedule(static)
-  for (omp_ulong i = 0; i < nrow; ++i) {
-    for (size_t j = 0; j < ncol; ++j) {
-      data[i * ncol +j] = is_int ? static_cast<float>(iin[i + nrow * j]) : din[i + nrow * j];
-    }
-  }
+  // the column major matrix is read in place
+  const void* data = is_int ? static_cast<const void*>(INTEGER(mat))
+                            : static_cast<const void*>(REAL(mat));
+  const int64_t elem_size = is_int ? sizeof(int) : sizeof(double);
   DMatrixHandle handle;
-  CHECK_CALL(XGDMatrixCreateFromMat(BeginPtr(data), nrow, ncol, asReal(missing), &handle));
+  CHECK_CALL(XGDMatrixCreateFromStridedMat(data, is_int ? xgboost::kInt32 : xgboost::kDouble,
+                                           nrow, ncol, elem_size, elem_size * nrow,
+                                           asReal(missing), 0, &handle));
   ret = PROTECT(R_MakeExternalPtr(handle, R_NilValue, R_NilValue));
   R_RegisterCFinalizerEx(ret, _DMatrixFinalizer, TRUE);
   R_API_END();
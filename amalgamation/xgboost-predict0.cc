@@ -0,0 +1,61 @@
+/*!
+ * Copyright 2018 by Contributors.
+ * \brief XGBoost prediction only amalgamation.
+ *  A library that loads models and predicts with the CPU predictor. It has
+ *  no tree or linear updaters and no external memory; the C API has no
+ *  training and no data loading from files. Link it with the empty rabit
+ *  engine. OpenMP is optional, the library builds without it too.
+ *
+ *  Example usage command.
+ *  - $(CXX) -std=c++0x -fopenmp -shared -o libxgboost_predict.so xgboost-predict0.cc -ldmlc -lrabit_empty
+ */
+#define XGBOOST_PREDICT_ONLY 1
+
+// metrics, the models may name them
+#include "../src/metric/metric.cc"
+#include "../src/metric/elementwise_metric.cc"
+#include "../src/metric/multiclass_metric.cc"
+#include "../src/metric/rank_metric.cc"
+
+// objectives, they transform the predictions
+#include "../src/objective/objective.cc"
+#include "../src/objective/regression_obj.cc"
+#include "../src/objective/multiclass_obj.cc"
+#include "../src/objective/rank_obj.cc"
+
+// gbms
+#include "../src/gbm/gbm.cc"
+#include "../src/gbm/gbtree.cc"
+#include "../src/gbm/gblinear.cc"
+
+// data
+#include "../src/data/data.cc"
+#include "../src/data/simple_csr_source.cc"
+#include "../src/data/input_files.cc"
+#include "../src/data/simple_dmatrix.cc"
+#include "../src/data/sparse_page_raw_format.cc"
+#include "../src/data/mmap_csr_source.cc"
+#include "../src/data/sectioned_binary.cc"
+#include "../src/data/columnar_source.cc"
+#include "../src/data/row_sample.cc"
+#include "../src/data/slice_source.cc"
+
+// prediction
+#include "../src/predictor/predictor.cc"
+#include "../src/predictor/cpu_predictor.cc"
+#include "../src/predictor/quickscorer_predictor.cc"
+
+// the registries of the updaters, without any updater
+#include "../src/tree/tree_model.cc"
+#include "../src/tree/tree_updater.cc"
+#include "../src/linear/linear_updater.cc"
+
+// global
+#include "../src/learner.cc"
+#include "../src/logging.cc"
+#include "../src/common/common.cc"
+#include "../src/common/host_device_vector.cc"
+
+// c_api
+#include "../src/c_api/c_api.cc"
+#include "../src/c_api/c_api_error.cc"
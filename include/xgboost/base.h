@@ -18,6 +18,14 @@
 #define XGBOOST_STRICT_R_MODE 0
 #endif
 
+/*!
+ * \brief Whether this is the prediction only library, whose C API has no
+ *  training and no data loading from files.
+ */
+#ifndef XGBOOST_PREDICT_ONLY
+#define XGBOOST_PREDICT_ONLY 0
+#endif
+
 /*!
  * \brief Whether always log console message with time.
  *  It will display like, with timestamp appended to head of the message.
@@ -33,6 +33,10 @@ typedef uint64_t bst_ulong;  // NOLINT(*)
 typedef void *DMatrixHandle;
 /*! \brief handle to Booster */
 typedef void *BoosterHandle;
+/*! \brief handle to scratch space of reentrant prediction */
+typedef void *PredictionContextHandle;
+/*! \brief handle to an asynchronous operation of a Booster */
+typedef void *AsyncHandle;
 /*! \brief handle to a data iterator */
 typedef void *DataIterHandle;
 /*! \brief handle to a internal data holder. */
@@ -85,6 +89,47 @@ XGB_EXTERN_C typedef int XGBCallbackDataIterNext(
     XGBCallbackSetData* set_function,
     DataHolderHandle set_function_handle);
 
+/*!
+ * \brief Callback to rewind a data iterator to its first batch.
+ * \param data_handle The handle to the callback.
+ */
+XGB_EXTERN_C typedef void XGBCallbackDataIterReset(DataIterHandle data_handle);
+
+/*!
+ * \brief Callback receiving the dump of one booster of a model.
+ * \param dump The dump of the booster, valid during the call only.
+ * \param len The length of the dump.
+ * \param handle The handle to the callback.
+ */
+XGB_EXTERN_C typedef void XGBCallbackDumpModel(
+    const char* dump, bst_ulong len, void* handle);
+
+/*!
+ * \brief Callback of a finished asynchronous operation, called on the worker
+ *  thread of the booster. It must not free the booster nor wait for another
+ *  operation of it.
+ * \param handle The handle of the operation, valid during the call even
+ *  when the handle given to the caller has been freed.
+ * \param status 0 when the operation succeeded, -1 when it failed.
+ * \param user_data The user data given to the operation.
+ */
+XGB_EXTERN_C typedef void XGBCallbackAsync(
+    AsyncHandle handle, int status, void* user_data);
+
+/*!
+ * \brief Callback receiving the leaf indices of a block of rows.
+ * \param leaves The indices, ntree per row, row major, valid during the call only.
+ * \param index_size The size of an index, 2 for uint16_t or 4 for uint32_t.
+ * \param base_row The id of the first row of the block.
+ * \param nrow The number of rows of the block.
+ * \param ntree The number of trees.
+ * \param user_data The user data given to the prediction.
+ * \return 0 to go on, any other value stops the prediction with an error.
+ */
+XGB_EXTERN_C typedef int XGBCallbackLeafIndex(
+    const void* leaves, int index_size, bst_ulong base_row,
+    bst_ulong nrow, bst_ulong ntree, void* user_data);
+
 /*!
  * \brief get string message of the last error
  *
@@ -122,6 +167,42 @@ XGB_DLL int XGDMatrixCreateFromDataIter(
     const char* cache_info,
     DMatrixHandle *out);
 
+/*!
+ * \brief Create a DMatrix reading a data iterator again on every pass.
+ *  Only the meta information and the current batch are held in memory, the
+ *  iterator and data_handle must stay valid for the lifetime of the DMatrix.
+ * \param data_handle The handle to the data.
+ * \param callback The callback to get the data.
+ * \param reset The callback to rewind the data.
+ * \param out The created DMatrix
+ * \return 0 when success, -1 when failure happens.
+ */
+XGB_DLL int XGDMatrixCreateStreamingFromDataIter(
+    DataIterHandle data_handle,
+    XGBCallbackDataIterNext* callback,
+    XGBCallbackDataIterReset* reset,
+    DMatrixHandle *out);
+
+/*!
+ * \brief Create a DMatrix holding the histogram bins of a data iterator.
+ *  The data is read twice, once to sketch the features and once to quantize
+ *  the rows, and its values are never stored. The rows of the DMatrix give
+ *  the lower bound of the bin of each value, tree_method=hist with the same
+ *  max_bin trains directly on the bins.
+ * \param data_handle The handle to the data.
+ * \param callback The callback to get the data.
+ * \param reset The callback to rewind the data.
+ * \param max_bin The maximum number of bins of a feature.
+ * \param out The created DMatrix
+ * \return 0 when success, -1 when failure happens.
+ */
+XGB_DLL int XGDMatrixCreateQuantizedFromDataIter(
+    DataIterHandle data_handle,
+    XGBCallbackDataIterNext* callback,
+    XGBCallbackDataIterReset* reset,
+    int max_bin,
+    DMatrixHandle *out);
+
 /*!
  * \brief create a matrix content from CSR format
  * \param indptr pointer to row headers
@@ -140,6 +221,26 @@ XGB_DLL int XGDMatrixCreateFromCSREx(const size_t* indptr,
                                      size_t nelem,
                                      size_t num_col,
                                      DMatrixHandle* out);
+/*!
+ * \brief create a matrix content from CSR format, the rows are filled in parallel
+ * \param indptr pointer to row headers
+ * \param indices findex
+ * \param data fvalue
+ * \param nindptr number of rows in the matrix + 1
+ * \param nelem number of nonzero elements in the matrix
+ * \param num_col number of columns; when it's set to 0, then guess from data
+ * \param out created dmatrix
+ * \param nthread number of threads (up to maximum cores available, if <=0 use all cores)
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromCSREx_omp(const size_t* indptr,
+                                         const unsigned* indices,
+                                         const float* data,
+                                         size_t nindptr,
+                                         size_t nelem,
+                                         size_t num_col,
+                                         DMatrixHandle* out,
+                                         int nthread);
 /*!
  * \deprecated
  * \brief create a matrix content from CSR format
@@ -175,6 +276,26 @@ XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
                                      size_t nelem,
                                      size_t num_row,
                                      DMatrixHandle* out);
+/*!
+ * \brief create a matrix content from CSC format, the columns are read in parallel
+ * \param col_ptr pointer to col headers
+ * \param indices findex
+ * \param data fvalue
+ * \param nindptr number of rows in the matrix + 1
+ * \param nelem number of nonzero elements in the matrix
+ * \param num_row number of rows; when it's set to 0, then guess from data
+ * \param out created dmatrix
+ * \param nthread number of threads (up to maximum cores available, if <=0 use all cores)
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromCSCEx_omp(const size_t* col_ptr,
+                                         const unsigned* indices,
+                                         const float* data,
+                                         size_t nindptr,
+                                         size_t nelem,
+                                         size_t num_row,
+                                         DMatrixHandle* out,
+                                         int nthread);
 /*!
  * \deprecated
  * \brief create a matrix content from CSC format
@@ -223,7 +344,95 @@ XGB_DLL int XGDMatrixCreateFromMat_omp(const float *data,
                                        DMatrixHandle *out,
                                        int nthread);
 /*!
- * \brief create a new dmatrix from sliced content of existing matrix
+ * \brief create matrix content from a dense matrix of any layout, such as a
+ *  numpy array or a column major R matrix, without converting it first.
+ *  The values are converted to float while the rows are built.
+ * \param data pointer to the first value
+ * \param type data type of the values: 1 float32, 2 double, 3 uint32,
+ *  4 uint64, 5 int32, 6 int64
+ * \param nrow number of rows
+ * \param ncol number columns
+ * \param row_stride distance in bytes from a value to the one of the next row,
+ *  ncol * sizeof(value) for a row major matrix, sizeof(value) for a column major one
+ * \param col_stride distance in bytes from a value to the one of the next column
+ * \param missing which value to represent missing value, compared once the
+ *  value is converted to float
+ * \param nthread number of threads, if <=0 use all the threads
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromStridedMat(const void *data,
+                                          int type,
+                                          bst_ulong nrow,
+                                          bst_ulong ncol,
+                                          int64_t row_stride,
+                                          int64_t col_stride,
+                                          float missing,
+                                          int nthread,
+                                          DMatrixHandle *out);
+/*!
+ * \brief create a matrix over a dense matrix owned by the caller, without
+ *  copying it. The rows are converted one block at a time when they are read.
+ *  The data must stay valid and unchanged until the matrix is freed.
+ * \param data pointer to the data space
+ * \param nrow number of rows
+ * \param ncol number columns
+ * \param missing which value to represent missing value
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromMatNoCopy(const float *data,
+                                         bst_ulong nrow,
+                                         bst_ulong ncol,
+                                         float missing,
+                                         DMatrixHandle *out);
+/*!
+ * \brief create a matrix over a CSR matrix owned by the caller, without
+ *  copying it. The rows are converted one block at a time when they are read.
+ *  The buffers must stay valid and unchanged until the matrix is freed.
+ * \param indptr pointer to row headers
+ * \param indices findex
+ * \param data fvalue
+ * \param nindptr number of rows in the matrix + 1
+ * \param nelem number of nonzero elements in the matrix
+ * \param num_col number of columns; when it's set to 0, then guess from data
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromCSRNoCopy(const size_t* indptr,
+                                         const unsigned* indices,
+                                         const float* data,
+                                         size_t nindptr,
+                                         size_t nelem,
+                                         size_t num_col,
+                                         DMatrixHandle* out);
+/*!
+ * \brief create a matrix from column oriented buffers, such as the columns
+ *  of an Arrow record batch. The values are copied once into column storage,
+ *  which the exact and approx tree methods use without a transpose.
+ * \param columns the data buffer of each column
+ * \param types the data type of each column: 1 float32, 2 double, 3 uint32, 4 uint64
+ * \param validity the validity bitmap of each column, in Arrow bit order, a set
+ *  bit is a valid value. NULL, or a NULL entry, when all the values are valid.
+ *  NaN values are missing as well.
+ * \param offsets the first row of each column in its buffers, NULL when all are 0
+ * \param ncol number of columns
+ * \param nrow number of rows
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromColumns(const void** columns,
+                                       const int* types,
+                                       const uint8_t** validity,
+                                       const uint64_t* offsets,
+                                       bst_ulong ncol,
+                                       bst_ulong nrow,
+                                       DMatrixHandle* out);
+/*!
+ * \brief create a new dmatrix from sliced content of existing matrix.
+ *  The slice is a view over the selected rows, which are gathered when the
+ *  new matrix is read, and it keeps the existing matrix alive. Groups are
+ *  kept, a group partly selected becomes a group of the selected rows.
  * \param handle instance of data matrix to be sliced
  * \param idxset index set
  * \param len length of index set
@@ -234,6 +443,15 @@ XGB_DLL int XGDMatrixSliceDMatrix(DMatrixHandle handle,
                                   const int *idxset,
                                   bst_ulong len,
                                   DMatrixHandle *out);
+/*!
+ * \brief append the rows and the meta info of other to an in-memory matrix.
+ *  Its column access and the quantized matrix of tree_method=hist are updated
+ *  with the new rows instead of being built again, the cuts are not changed.
+ * \param handle the data matrix the rows are appended to
+ * \param other the data matrix holding the new rows, it is not modified
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixAppend(DMatrixHandle handle, DMatrixHandle other);
 /*!
  * \brief free space in data matrix
  * \return 0 when success, -1 when failure happens
@@ -248,6 +466,16 @@ XGB_DLL int XGDMatrixFree(DMatrixHandle handle);
  */
 XGB_DLL int XGDMatrixSaveBinary(DMatrixHandle handle,
                                 const char *fname, int silent);
+/*!
+ * \brief save a data matrix in the sectioned binary format, loaded back by
+ *  XGDMatrixCreateFromFile with its sections read in parallel
+ * \param handle a instance of data matrix
+ * \param fname file name, any URI supported by the output streams
+ * \param compress whether to delta code the row and group pointers
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixSaveSectioned(DMatrixHandle handle,
+                                   const char *fname, int compress);
 /*!
  * \brief set float vector to a content in info
  * \param handle a instance of data matrix
@@ -392,6 +620,44 @@ XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
                                  const char *evnames[],
                                  bst_ulong len,
                                  const char **out_result);
+/*!
+ * \brief get evaluation statistics for xgboost as numbers, and track the
+ *  early stopping when early_stopping_rounds is set
+ * \param handle handle
+ * \param iter current iteration rounds
+ * \param dmats pointers to data to be evaluated
+ * \param evnames pointers to names of each data
+ * \param len length of dmats
+ * \param out_len length of the results, the number of metrics times len
+ * \param out_result the value of each metric on each data, the metrics of
+ *          a data together in the order of XGBoosterGetMetricNames
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterEvalOneIterResults(BoosterHandle handle,
+                                        int iter,
+                                        DMatrixHandle dmats[],
+                                        const char *evnames[],
+                                        bst_ulong len,
+                                        bst_ulong *out_len,
+                                        const float **out_result);
+/*!
+ * \brief get the names of the evaluation metrics
+ * \param handle handle
+ * \param out_len the length of the returned names
+ * \param out pointer to hold the output metric names
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterGetMetricNames(BoosterHandle handle,
+                                    bst_ulong *out_len,
+                                    const char ***out);
+/*!
+ * \brief whether the watched metric has not improved for early_stopping_rounds
+ *  evaluations, the best iteration is in the attribute best_ntree_limit
+ * \param handle handle
+ * \param out 1 when the training should stop, 0 otherwise
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterEarlyStopped(BoosterHandle handle, int *out);
 /*!
  * \brief make prediction based on dmat
  * \param handle handle
@@ -414,6 +680,306 @@ XGB_DLL int XGBoosterPredict(BoosterHandle handle,
                              bst_ulong *out_len,
                              const float **out_result);
 
+/*!
+ * \brief make prediction based on dmat into memory allocated by the caller,
+ *  which is either host memory or, with a GPU build, device memory
+ * \param handle handle
+ * \param dmat data matrix
+ * \param option_mask bit-mask of options taken in prediction, as in XGBoosterPredict
+ * \param ntree_limit limit number of trees used for prediction, 0 uses all the trees
+ * \param out_size number of values out_result holds
+ * \param out_len used to store the number of predicted values, also set when
+ *  out_size is too small, so that the call can be repeated with a larger array
+ * \param out_result array the predictions are written to
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictInto(BoosterHandle handle,
+                                 DMatrixHandle dmat,
+                                 int option_mask,
+                                 unsigned ntree_limit,
+                                 bst_ulong out_size,
+                                 bst_ulong *out_len,
+                                 float *out_result);
+
+/*!
+ * \brief predict the leaf index of each tree, as option 2 of XGBoosterPredict,
+ *  in integers: uint16_t when the node ids of all the trees fit, uint32_t otherwise
+ * \param handle handle
+ * \param dmat data matrix
+ * \param ntree_limit limit number of trees used for prediction, 0 uses all the trees
+ * \param out_index_size used to store the size of an index, 2 or 4
+ * \param out_ntree used to store the number of trees, the indices of a row
+ * \param out_len used to store the number of indices
+ * \param out_result used to set a pointer to the indices, row major
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictLeafIndex(BoosterHandle handle,
+                                      DMatrixHandle dmat,
+                                      unsigned ntree_limit,
+                                      int *out_index_size,
+                                      bst_ulong *out_ntree,
+                                      bst_ulong *out_len,
+                                      const void **out_result);
+
+/*!
+ * \brief predict the leaf indices as XGBoosterPredictLeafIndex, but hand them
+ *  to callback a block of rows at a time, so that the memory is bounded by
+ *  the block whatever the number of rows
+ * \param handle handle
+ * \param dmat data matrix
+ * \param ntree_limit limit number of trees used for prediction, 0 uses all the trees
+ * \param callback called with each block, in the order of the rows
+ * \param user_data passed to callback
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictLeafIndexStream(BoosterHandle handle,
+                                            DMatrixHandle dmat,
+                                            unsigned ntree_limit,
+                                            XGBCallbackLeafIndex *callback,
+                                            void *user_data);
+
+/*!
+ * \brief make prediction based on dmat with several boosters at once. The
+ *  feature vector of a row is filled once for the trees of all the boosters,
+ *  which suits scoring a request with many models.
+ * \param handles the boosters
+ * \param num_boosters number of boosters
+ * \param dmat data matrix
+ * \param option_mask bit-mask of options taken in prediction, possible values
+ *          0:normal prediction
+ *          1:output margin instead of transformed value
+ * \param ntree_limit limit number of trees used by each booster, 0 uses all the trees
+ * \param out_offsets array of num_boosters + 1 values allocated by the caller, used
+ *  to store where the predictions of each booster start in out_result, the last
+ *  one is out_len
+ * \param out_len used to store length of returning result
+ * \param out_result used to set a pointer to the predictions of all the boosters,
+ *  those of handles[k] are laid out as by XGBoosterPredict
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictMulti(const BoosterHandle *handles,
+                                  bst_ulong num_boosters,
+                                  DMatrixHandle dmat,
+                                  int option_mask,
+                                  unsigned ntree_limit,
+                                  bst_ulong *out_offsets,
+                                  bst_ulong *out_len,
+                                  const float **out_result);
+
+/*!
+ * \brief make a booster predicting with the boosting rounds
+ *  [layer_begin, layer_end) of handle, e.g. a fast model made of the first
+ *  rounds next to the full one. The trees are shared with handle, which may
+ *  be trained further or freed before the slice.
+ * \param handle handle
+ * \param layer_begin the first round
+ * \param layer_end the round after the last one
+ * \param class_group the output group whose trees are kept, -1 for all of
+ *  them. The slice of a group of a multi-class model predicts its margin.
+ * \param out the slice, freed by XGBoosterFree
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterSlice(BoosterHandle handle,
+                           int layer_begin,
+                           int layer_end,
+                           int class_group,
+                           BoosterHandle *out);
+
+/*!
+ * \brief create scratch space for reentrant prediction, see XGBoosterPredictWithContext
+ * \param out the created context
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictionContextCreate(PredictionContextHandle *out);
+/*!
+ * \brief free a prediction context
+ * \param handle the context to be freed
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictionContextFree(PredictionContextHandle handle);
+/*!
+ * \brief make prediction based on dmat, all the scratch space and the result live
+ *  in ctx. Threads that each own a context and a dmat can call it concurrently on
+ *  one booster once the booster is loaded and a first prediction has been made.
+ *  Only normal and margin output are supported.
+ * \param handle handle
+ * \param ctx prediction context owned by the calling thread
+ * \param dmat data matrix
+ * \param option_mask bit-mask of options taken in prediction, possible values
+ *          0:normal prediction
+ *          1:output margin instead of transformed value
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out_len used to store length of returning result
+ * \param out_result used to set a pointer to array, valid until the next call with ctx
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictWithContext(BoosterHandle handle,
+                                        PredictionContextHandle ctx,
+                                        DMatrixHandle dmat,
+                                        int option_mask,
+                                        unsigned ntree_limit,
+                                        bst_ulong *out_len,
+                                        const float **out_result);
+/*!
+ * \brief make prediction for a single dense row without creating a DMatrix,
+ *  the output is written into a caller owned buffer.
+ *  Scratch space is thread local, so several threads can share one booster.
+ *  Only normal and margin output are supported.
+ * \param handle handle
+ * \param data pointer to the feature values of the row
+ * \param ncol number of columns, must not exceed the number of features of the model
+ * \param missing which value to represent missing value
+ * \param option_mask bit-mask of options taken in prediction, possible values
+ *          0:normal prediction
+ *          1:output margin instead of transformed value
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out_size capacity of out_result, at least the number of output groups
+ * \param out_len used to store the number of values written
+ * \param out_result caller owned buffer to hold the prediction
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictFromDenseRow(BoosterHandle handle,
+                                         const float *data,
+                                         bst_ulong ncol,
+                                         float missing,
+                                         int option_mask,
+                                         unsigned ntree_limit,
+                                         bst_ulong out_size,
+                                         bst_ulong *out_len,
+                                         float *out_result);
+/*!
+ * \brief make prediction for a single sparse row without creating a DMatrix,
+ *  the output is written into a caller owned buffer.
+ *  Scratch space is thread local, so several threads can share one booster.
+ *  Only normal and margin output are supported.
+ * \param handle handle
+ * \param indices feature indices of the present values
+ * \param data feature values
+ * \param nelem number of present values
+ * \param option_mask bit-mask of options taken in prediction, possible values
+ *          0:normal prediction
+ *          1:output margin instead of transformed value
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out_size capacity of out_result, at least the number of output groups
+ * \param out_len used to store the number of values written
+ * \param out_result caller owned buffer to hold the prediction
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictFromCSRRow(BoosterHandle handle,
+                                       const unsigned *indices,
+                                       const float *data,
+                                       bst_ulong nelem,
+                                       int option_mask,
+                                       unsigned ntree_limit,
+                                       bst_ulong out_size,
+                                       bst_ulong *out_len,
+                                       float *out_result);
+
+// --- Asynchronous API ----
+// The operations of a booster run one after the other on a worker thread of
+// the booster, in the order they are started, and the call returns at once.
+// The operations of different boosters run concurrently. The data matrices
+// are held until the operation is done, so their handles may be freed at
+// once. No synchronous call may be made on the booster before its started
+// operations are done, except XGBoosterFree, which waits for them.
+/*!
+ * \brief start an iteration of training, see XGBoosterUpdateOneIter
+ * \param handle handle
+ * \param iter current iteration rounds
+ * \param dtrain training data
+ * \param callback called when the iteration is done, can be NULL
+ * \param user_data passed to the callback
+ * \param out handle of the operation, to be freed with XGBAsyncFree
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterUpdateOneIterAsync(BoosterHandle handle,
+                                        int iter,
+                                        DMatrixHandle dtrain,
+                                        XGBCallbackAsync* callback,
+                                        void* user_data,
+                                        AsyncHandle* out);
+/*!
+ * \brief start the evaluation of the model, see XGBoosterEvalOneIter,
+ *  the result is given by XGBAsyncGetEvalResult
+ * \param handle handle
+ * \param iter current iteration rounds
+ * \param dmats pointers to data to be evaluated
+ * \param evnames pointers to names of each data, copied by the call
+ * \param len length of dmats
+ * \param callback called when the evaluation is done, can be NULL
+ * \param user_data passed to the callback
+ * \param out handle of the operation, to be freed with XGBAsyncFree
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterEvalOneIterAsync(BoosterHandle handle,
+                                      int iter,
+                                      DMatrixHandle dmats[],
+                                      const char *evnames[],
+                                      bst_ulong len,
+                                      XGBCallbackAsync* callback,
+                                      void* user_data,
+                                      AsyncHandle* out);
+/*!
+ * \brief start a prediction, see XGBoosterPredict,
+ *  the result is given by XGBAsyncGetPrediction
+ * \param handle handle
+ * \param dmat data matrix
+ * \param option_mask bit-mask of options taken in prediction, as in XGBoosterPredict
+ * \param ntree_limit limit number of trees used for prediction, 0 uses all the trees
+ * \param callback called when the prediction is done, can be NULL
+ * \param user_data passed to the callback
+ * \param out handle of the operation, to be freed with XGBAsyncFree
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictAsync(BoosterHandle handle,
+                                  DMatrixHandle dmat,
+                                  int option_mask,
+                                  unsigned ntree_limit,
+                                  XGBCallbackAsync* callback,
+                                  void* user_data,
+                                  AsyncHandle* out);
+/*!
+ * \brief wait until the operation is done
+ * \param handle handle of the operation
+ * \return 0 when the operation succeeded, -1 when it failed, with its error
+ *  given by XGBGetLastError
+ */
+XGB_DLL int XGBAsyncWait(AsyncHandle handle);
+/*!
+ * \brief whether the operation is done, without waiting
+ * \param handle handle of the operation
+ * \param out set to 1 when the operation is done, 0 otherwise
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBAsyncIsDone(AsyncHandle handle, int* out);
+/*!
+ * \brief wait for a prediction and get its result
+ * \param handle handle of an operation of XGBoosterPredictAsync
+ * \param out_len used to store length of returning result
+ * \param out_result used to set a pointer to array, valid until the handle is freed
+ * \return 0 when success, -1 when the prediction failed
+ */
+XGB_DLL int XGBAsyncGetPrediction(AsyncHandle handle,
+                                  bst_ulong *out_len,
+                                  const float **out_result);
+/*!
+ * \brief wait for an evaluation and get its result
+ * \param handle handle of an operation of XGBoosterEvalOneIterAsync
+ * \param out_result the evaluation statistics, valid until the handle is freed
+ * \return 0 when success, -1 when the evaluation failed
+ */
+XGB_DLL int XGBAsyncGetEvalResult(AsyncHandle handle, const char **out_result);
+/*!
+ * \brief free the handle of an operation. It does not wait, an operation that
+ *  is not done still completes and calls its callback.
+ * \param handle handle of the operation
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBAsyncFree(AsyncHandle handle);
+
 /*!
  * \brief load model from existing file
  * \param handle handle
@@ -483,6 +1049,40 @@ XGB_DLL int XGBoosterDumpModelEx(BoosterHandle handle,
                                  bst_ulong *out_len,
                                  const char ***out_dump_array);
 
+/*!
+ * \brief dump model one booster at a time, the trees are dumped in parallel
+ *  and the dump of the whole model is never held in memory.
+ * \param handle handle
+ * \param fmap  name to fmap can be empty string
+ * \param with_stats whether to dump with statistics
+ * \param format the format to dump the model in
+ * \param callback called with the dump of each booster, in order
+ * \param callback_handle the handle passed to the callback
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterDumpModelStream(BoosterHandle handle,
+                                     const char *fmap,
+                                     int with_stats,
+                                     const char *format,
+                                     XGBCallbackDumpModel* callback,
+                                     void *callback_handle);
+
+/*!
+ * \brief dump model into a file, as the dump task of the command line does.
+ *  The json formats write an array of the boosters.
+ * \param handle handle
+ * \param fmap  name to fmap can be empty string
+ * \param with_stats whether to dump with statistics
+ * \param format the format to dump the model in
+ * \param fname the file to write, a local file or an uri
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterDumpModelToFile(BoosterHandle handle,
+                                     const char *fmap,
+                                     int with_stats,
+                                     const char *format,
+                                     const char *fname);
+
 /*!
  * \brief dump model, return array of strings representing model dump
  * \param handle handle
@@ -558,6 +1158,47 @@ XGB_DLL int XGBoosterGetAttrNames(BoosterHandle handle,
                                   bst_ulong* out_len,
                                   const char*** out);
 
+/*!
+ * \brief Get the named timings and counters recorded by the learner, the
+ *  boosters, the updaters and the other components during the last training
+ *  iteration, as the JSON object
+ *  {"timings": {"name": seconds, ...}, "counters": {"name": count, ...}}.
+ *  The record is shared by all the boosters of the process.
+ * \param out_str the profile, valid until the next call in this thread
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBGetProfile(const char** out_str);
+
+/*!
+ * \brief Start or stop recording the timings as events of the threads and
+ *  the devices, see XGBGetTrace. Also done by the trace_file parameter.
+ * \param tracing whether to record, starting clears the events
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBSetTracing(int tracing);
+
+/*!
+ * \brief Get the events recorded since the tracing started, in the Chrome
+ *  trace event format read by chrome://tracing and Perfetto. The threads of
+ *  the host are in process 0, the GPU devices in process 1.
+ * \param out_str the trace, valid until the next call in this thread
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBGetTrace(const char** out_str);
+
+/*!
+ * \brief Get the bytes held by the data matrices, the quantized matrices,
+ *  the histograms, the prediction caches and the device buffers, current
+ *  and peak, as the JSON object
+ *  {"total": {"current": bytes, "peak": bytes}, "subsystem": {...}, ...}.
+ *  The record is shared by all the boosters of the process.
+ * \param reset_peak whether the peaks start again from the current bytes
+ *  after the call
+ * \param out_str the memory usage, valid until the next call in this thread
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBGetMemoryUsage(int reset_peak, const char** out_str);
+
 // --- Distributed training API----
 // NOTE: functions in rabit/c_api.h will be also available in libxgboost.so
 /*!
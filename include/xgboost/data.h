@@ -9,6 +9,9 @@
 
 #include <dmlc/base.h>
 #include <dmlc/data.h>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <string>
 #include <memory>
 #include <vector>
@@ -24,7 +27,9 @@ enum DataType {
   kFloat32 = 1,
   kDouble = 2,
   kUInt32 = 3,
-  kUInt64 = 4
+  kUInt64 = 4,
+  kInt32 = 5,
+  kInt64 = 6
 };
 
 /*!
@@ -110,6 +115,13 @@ struct MetaInfo {
    * \param num Number of elements in the source array.
    */
   void SetInfo(const char* key, const void* dptr, DataType dtype, size_t num);
+  /*!
+   * \brief Append the information of the rows of other after the rows of this.
+   *  Weights and root indices missing on one side take their default value,
+   *  groups and base margins must be given on both sides or on neither.
+   * \param other The meta info of the appended rows.
+   */
+  void Append(const MetaInfo& other);
 
  private:
   /*! \brief argsort of labels */
@@ -127,13 +139,14 @@ struct SparseBatch {
     /*! \brief feature value */
     bst_float fvalue;
     /*! \brief default constructor */
-    Entry() {}
+    XGBOOST_DEVICE Entry() {}
     /*!
      * \brief constructor with index and value
      * \param index The feature or row index.
      * \param fvalue THe feature value.
      */
-    Entry(bst_uint index, bst_float fvalue) : index(index), fvalue(fvalue) {}
+    XGBOOST_DEVICE Entry(bst_uint index, bst_float fvalue)
+        : index(index), fvalue(fvalue) {}
     /*! \brief reversely compare feature values */
     inline static bool CmpValue(const Entry& a, const Entry& b) {
       return a.fvalue < b.fvalue;
@@ -307,9 +320,38 @@ class DMatrix {
    *  The saved file only works for non-sharded dataset(single machine training).
    *  This API is deprecated and dis-encouraged to use.
    * \param fname The file name to be saved.
+   * \param page_aligned Whether to save in the page aligned binary format,
+   *  which Load maps into memory instead of reading.
    * \return The created DMatrix.
    */
-  virtual void SaveToLocalFile(const std::string& fname);
+  virtual void SaveToLocalFile(const std::string& fname,
+                               bool page_aligned = false);
+  /*!
+   * \brief Save DMatrix in the sectioned binary format, whose sections are
+   *  read in parallel by DMatrix::Load, from any stream supporting seek.
+   * \param uri The URI of the output.
+   * \param compress Whether to delta code the row and group pointers.
+   */
+  virtual void SaveSectioned(const std::string& uri, bool compress = true);
+  /*!
+   * \brief Append the rows and the meta info of other after the rows of this.
+   *  The column access already initialized is updated with the new rows
+   *  instead of being built again.
+   * \param other The matrix holding the appended rows, it is not modified.
+   */
+  virtual void Append(DMatrix* other);
+  /*!
+   * \brief Get the data an algorithm derives from the matrix, e.g. its quantized
+   *  bins. The data is kept with the matrix, so it is built once for all the
+   *  boosters trained on the matrix, in turn or at the same time. The data
+   *  must then be safe to read from several threads, the algorithm keeps
+   *  its own copy of the data that is not, e.g. of external memory pages.
+   * \param key Identifies the data and the parameters it is built with.
+   * \param create Allocates the data the first time key is asked for.
+   * \return The data of key.
+   */
+  std::shared_ptr<void> DerivedData(const std::string& key,
+                                    const std::function<std::shared_ptr<void>()>& create);
   /*!
    * \brief Load DMatrix from URI.
    * \param uri The URI of input.
@@ -352,6 +394,9 @@ class DMatrix {
   friend class LearnerImpl;
   /*! \brief public field to back ref cached matrix. */
   LearnerImpl* cache_learner_ptr_;
+  /*! \brief the data derived from the matrix, by key */
+  std::map<std::string, std::shared_ptr<void> > derived_;
+  std::mutex derived_mutex_;
 };
 
 // implementation of inline functions
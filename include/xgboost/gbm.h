@@ -21,6 +21,30 @@
 #include "../../src/common/host_device_vector.h"
 
 namespace xgboost {
+// forward declare the scratch space of reentrant prediction
+struct PredictionContext;
+namespace gbm {
+struct GBTreeModel;
+}  // namespace gbm
+/*!
+ * \brief the leaf indices of a block of rows, ntree of them per row, row major.
+ *  Each index is a uint16_t or a uint32_t, the smallest type holding the node
+ *  ids of all the trees.
+ */
+struct LeafIndexBlock {
+  /*! \brief id of the first row of the block */
+  size_t base_rowid;
+  /*! \brief number of rows of the block */
+  size_t nrow;
+  /*! \brief number of trees, the indices of a row */
+  size_t ntree;
+  /*! \brief size of an index in bytes, 2 or 4 */
+  int index_size;
+  /*! \brief the indices, valid during the callback only */
+  const void* data;
+};
+/*! \brief receives the blocks of leaf indices in the order of the rows */
+typedef std::function<void(const LeafIndexBlock&)> LeafIndexCallback;
 /*!
  * \brief interface of gradient boosting model.
  */
@@ -82,6 +106,18 @@ class GradientBooster {
   virtual void PredictBatch(DMatrix* dmat,
                             HostDeviceVector<bst_float>* out_preds,
                             unsigned ntree_limit = 0) = 0;
+  /*!
+   * \brief reentrant batch prediction, the only mutable state is ctx,
+   *  threads that each own a context and a feature matrix can share the booster
+   * \param dmat feature matrix
+   * \param out_preds output vector to hold the predictions
+   * \param ntree_limit limit the number of trees used in prediction
+   * \param ctx scratch space owned by the caller
+   */
+  virtual void PredictBatch(DMatrix* dmat,
+                            HostDeviceVector<bst_float>* out_preds,
+                            unsigned ntree_limit,
+                            PredictionContext* ctx) const;
   /*!
    * \brief online prediction function, predict score for one instance at a time
    *  NOTE: use the batch prediction interface if possible, batch prediction is usually
@@ -98,6 +134,19 @@ class GradientBooster {
                        std::vector<bst_float>* out_preds,
                        unsigned ntree_limit = 0,
                        unsigned root_index = 0) = 0;
+  /*!
+   * \brief reentrant online prediction, the only mutable state is ctx
+   * \param inst the instance you want to predict
+   * \param out_preds output vector to hold the predictions
+   * \param ntree_limit limit the number of trees used in prediction
+   * \param root_index the root index
+   * \param ctx scratch space owned by the caller
+   */
+  virtual void PredictInstance(const SparseBatch::Inst& inst,
+                               std::vector<bst_float>* out_preds,
+                               unsigned ntree_limit,
+                               unsigned root_index,
+                               PredictionContext* ctx) const;
   /*!
    * \brief predict the leaf index of each tree, the output will be nsample * ntree vector
    *        this is only valid in gbtree predictor
@@ -109,6 +158,25 @@ class GradientBooster {
   virtual void PredictLeaf(DMatrix* dmat,
                            std::vector<bst_float>* out_preds,
                            unsigned ntree_limit = 0) = 0;
+  /*!
+   * \brief predict the leaf index of each tree in compact integers, block by block
+   *  of rows, so that the indices of a large matrix are never held at once
+   * \param dmat feature matrix
+   * \param ntree_limit limit the number of trees used in prediction, 0 for all the trees
+   * \param callback called with each block of rows
+   */
+  virtual void PredictLeafIndex(DMatrix* dmat, unsigned ntree_limit,
+                                const LeafIndexCallback& callback) {
+    LOG(FATAL) << "The booster does not support prediction of leaf index";
+  }
+  /*!
+   * \brief the trees whose sum of the leaf values is the margin, so that the
+   *  trees of several boosters can be traversed in one pass over the rows.
+   * \return nullptr when the margin is not a plain sum of the trees
+   */
+  virtual const gbm::GBTreeModel* TreeModel() const {
+    return nullptr;
+  }
 
   /*!
    * \brief feature contributions to individual predictions; the output will be a vector
@@ -140,6 +208,35 @@ class GradientBooster {
   virtual std::vector<std::string> DumpModel(const FeatureMap& fmap,
                                              bool with_stats,
                                              std::string format) const = 0;
+  /*!
+   * \brief dump the model in the requested format one booster at a time,
+   *  so the dump of the whole model is never held in memory at once.
+   * \param fmap feature map that may help give interpretations of feature
+   * \param with_stats extra statistics while dumping model
+   * \param format the format to dump the model in
+   * \param visit called with the dump of each booster, in order.
+   */
+  virtual void DumpModelTo(const FeatureMap& fmap,
+                           bool with_stats,
+                           std::string format,
+                           const std::function<void(const std::string&)>& visit) const {
+    for (const std::string& dump : this->DumpModel(fmap, with_stats, format)) {
+      visit(dump);
+    }
+  }
+  /*!
+   * \brief put the boosting rounds [layer_begin, layer_end) of the model in
+   *  out, a new booster of the same type, sharing the parts of the model
+   *  that are not changed by the training.
+   * \param layer_begin the first round.
+   * \param layer_end the round after the last one.
+   * \param group the output group to keep, -1 for all of them.
+   * \param out the booster receiving the slice.
+   */
+  virtual void Slice(int layer_begin, int layer_end, int group,
+                     GradientBooster* out) const {
+    LOG(FATAL) << "Slice is not supported by this booster";
+  }
   /*!
    * \brief create a gradient booster from given name
    * \param name name of gradient booster
@@ -9,6 +9,7 @@
 #define XGBOOST_LEARNER_H_
 
 #include <rabit/rabit.h>
+#include <functional>
 #include <utility>
 #include <string>
 #include <vector>
@@ -95,6 +96,30 @@ class Learner : public rabit::Serializable {
   virtual std::string EvalOneIter(int iter,
                                   const std::vector<DMatrix*>& data_sets,
                                   const std::vector<std::string>& data_names) = 0;
+  /*!
+   * \brief evaluate the model for specific iteration using the configured metrics,
+   *  and track the best iteration of the early stopping.
+   * \param iter iteration number
+   * \param data_sets datasets to be evaluated.
+   * \param data_names name of each dataset
+   * \param out_results the value of each metric on each dataset, the metrics
+   *   of a dataset being together in the order of GetMetricNames
+   */
+  virtual void EvalOneIter(int iter,
+                           const std::vector<DMatrix*>& data_sets,
+                           const std::vector<std::string>& data_names,
+                           std::vector<bst_float>* out_results) = 0;
+  /*!
+   * \return the names of the metrics evaluated by EvalOneIter
+   */
+  virtual std::vector<std::string> GetMetricNames() const = 0;
+  /*!
+   * \brief whether the training should stop, when the metric watched by the
+   *  early stopping has not improved for early_stopping_rounds evaluations.
+   *  The best iteration is kept in the attributes best_iteration, best_score
+   *  and best_ntree_limit, the number of trees to predict with.
+   */
+  virtual bool EarlyStopped() const = 0;
   /*!
    * \brief get prediction given the model.
    * \param data input data
@@ -115,6 +140,43 @@ class Learner : public rabit::Serializable {
                        bool pred_contribs = false,
                        bool approx_contribs = false,
                        bool pred_interactions = false) const = 0;
+  /*!
+   * \brief reentrant prediction, the only mutable state is ctx, so threads that
+   *  each own a context and a DMatrix can share one learner once it is configured.
+   * \param data input data
+   * \param output_margin whether to only predict margin value instead of transformed prediction
+   * \param out_preds output vector that stores the prediction
+   * \param ntree_limit limit number of trees used for boosted tree
+   *   predictor, when it equals 0, this means we are using all the trees
+   * \param ctx scratch space owned by the caller
+   */
+  virtual void Predict(DMatrix* data,
+                       bool output_margin,
+                       HostDeviceVector<bst_float> *out_preds,
+                       unsigned ntree_limit,
+                       PredictionContext* ctx) const = 0;
+  /*!
+   * \brief predict the leaf index of each tree in compact integers, the rows are
+   *  given to callback block by block so that the memory stays bounded.
+   * \param data input data
+   * \param ntree_limit limit number of trees used for boosted tree
+   *   predictor, when it equals 0, this means we are using all the trees
+   * \param callback receives the blocks of leaf indices in the order of the rows
+   */
+  virtual void PredictLeafIndex(DMatrix* data, unsigned ntree_limit,
+                                const LeafIndexCallback& callback) const = 0;
+  /*!
+   * \brief make a learner predicting with the boosting rounds
+   *  [layer_begin, layer_end) of this one. The trees are shared, so the
+   *  slice takes little memory, and it stays valid when this learner is
+   *  trained further or freed.
+   * \param layer_begin the first round.
+   * \param layer_end the round after the last one.
+   * \param group the output group to keep, -1 for all of them. The slice of a
+   *  group of a multi-class model predicts the margin of the group.
+   * \return the slice, owned by the caller.
+   */
+  virtual Learner* Slice(int layer_begin, int layer_end, int group) const = 0;
 
   /*!
    * \brief Set additional attribute to the Booster.
@@ -156,6 +218,30 @@ class Learner : public rabit::Serializable {
   std::vector<std::string> DumpModel(const FeatureMap& fmap,
                                      bool with_stats,
                                      std::string format) const;
+  /*!
+   * \brief dump the model in the requested format one booster at a time
+   * \param fmap feature map that may help give interpretations of feature
+   * \param with_stats extra statistics while dumping model
+   * \param format the format to dump the model in
+   * \param visit called with the dump of each booster, in order.
+   */
+  void DumpModel(const FeatureMap& fmap,
+                 bool with_stats,
+                 std::string format,
+                 const std::function<void(const std::string&)>& visit) const;
+  /*!
+   * \brief write the dump of the model to a stream, one booster at a time.
+   *  The json formats write an array of the boosters, the text format heads
+   *  each booster with booster[i]:.
+   * \param fmap feature map that may help give interpretations of feature
+   * \param with_stats extra statistics while dumping model
+   * \param format the format to dump the model in
+   * \param fo the output stream.
+   */
+  void DumpModel(const FeatureMap& fmap,
+                 bool with_stats,
+                 std::string format,
+                 dmlc::Stream* fo) const;
   /*!
    * \brief online prediction function, predict score for one instance at a time
    *  NOTE: use the batch prediction interface if possible, batch prediction is usually
@@ -171,6 +257,37 @@ class Learner : public rabit::Serializable {
                       bool output_margin,
                       HostDeviceVector<bst_float> *out_preds,
                       unsigned ntree_limit = 0) const;
+  /*!
+   * \brief reentrant online prediction, the only mutable state is ctx
+   * \param inst the instance you want to predict
+   * \param output_margin whether to only predict margin value instead of transformed prediction
+   * \param out_preds output vector to hold the predictions
+   * \param ntree_limit limit the number of trees used in prediction
+   * \param ctx scratch space owned by the caller
+   */
+  inline void Predict(const SparseBatch::Inst &inst,
+                      bool output_margin,
+                      HostDeviceVector<bst_float> *out_preds,
+                      unsigned ntree_limit,
+                      PredictionContext* ctx) const;
+  /*!
+   * \brief predict data with several learners. The trees of the learners that
+   *  are a plain sum of trees are traversed in one pass over the rows, the
+   *  other learners predict on their own.
+   * \param learners the learners, configured
+   * \param data input data
+   * \param output_margin whether to only predict margin value instead of transformed prediction
+   * \param ntree_limit limit number of trees used by each learner, 0 for all the trees
+   * \param out_preds the predictions of the learners, one after the other
+   * \param out_offsets where the predictions of each learner start, and the
+   *  total size at the end
+   */
+  static void PredictMulti(const std::vector<const Learner*>& learners,
+                           DMatrix* data,
+                           bool output_margin,
+                           unsigned ntree_limit,
+                           std::vector<bst_float>* out_preds,
+                           std::vector<size_t>* out_offsets);
   /*!
    * \brief Create a new instance of learner.
    * \param cache_data The matrix to cache the prediction.
@@ -200,6 +317,17 @@ inline void Learner::Predict(const SparseBatch::Inst& inst,
   }
 }
 
+inline void Learner::Predict(const SparseBatch::Inst& inst,
+                             bool output_margin,
+                             HostDeviceVector<bst_float>* out_preds,
+                             unsigned ntree_limit,
+                             PredictionContext* ctx) const {
+  gbm_->PredictInstance(inst, &out_preds->data_h(), ntree_limit, 0, ctx);
+  if (!output_margin) {
+    obj_->PredTransform(out_preds);
+  }
+}
+
 // implementing configure.
 template<typename PairIter>
 inline void Learner::Configure(PairIter begin, PairIter end) {
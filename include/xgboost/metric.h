@@ -11,8 +11,10 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <memory>
 #include "./data.h"
 #include "./base.h"
+#include "../../src/common/host_device_vector.h"
 
 namespace xgboost {
 /*!
@@ -32,8 +34,27 @@ class Metric {
   virtual bst_float Eval(const std::vector<bst_float>& preds,
                          const MetaInfo& info,
                          bool distributed) const = 0;
+  /*!
+   * \brief evaluate the metric on the device copy of the predictions,
+   *  without copying them to the host.
+   * \param preds prediction, on the device preds->device()
+   * \param info information, including label etc.
+   * \param distributed whether a call to Allreduce is needed.
+   * \param out the result.
+   * \return false if the metric is only evaluated on the host.
+   */
+  virtual bool EvalDevice(HostDeviceVector<bst_float>* preds,
+                          const MetaInfo& info,
+                          bool distributed,
+                          bst_float* out) const {
+    return false;
+  }
   /*! \return name of metric */
   virtual const char* Name() const = 0;
+  /*! \return whether a larger value of the metric is better */
+  virtual bool Maximize() const {
+    return false;
+  }
   /*! \brief virtual destructor */
   virtual ~Metric() {}
   /*!
@@ -44,6 +65,32 @@ class Metric {
    * \return the created metric.
    */
   static Metric* Create(const std::string& name);
+  /*!
+   * \brief evaluate several metrics on the same predictions.
+   *  The element-wise metrics are computed together in a single pass over
+   *  the rows, the others are evaluated in turn.
+   * \param metrics the metrics.
+   * \param preds prediction
+   * \param info information, including label etc.
+   * \param distributed whether a call to Allreduce is needed.
+   * \param out the results, in the order of metrics.
+   */
+  static void EvalAll(const std::vector<std::unique_ptr<Metric> >& metrics,
+                      const std::vector<bst_float>& preds,
+                      const MetaInfo& info,
+                      bool distributed,
+                      std::vector<bst_float>* out);
+  /*!
+   * \brief evaluate several metrics on predictions which may be on a device.
+   *  When the predictions are on a device, the metrics with a device
+   *  implementation are evaluated there, and the predictions are only copied
+   *  to the host for the others.
+   */
+  static void EvalAll(const std::vector<std::unique_ptr<Metric> >& metrics,
+                      HostDeviceVector<bst_float>* preds,
+                      const MetaInfo& info,
+                      bool distributed,
+                      std::vector<bst_float>* out);
 };
 
 /*!
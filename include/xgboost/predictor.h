@@ -7,6 +7,7 @@
 #pragma once
 #include <xgboost/base.h>
 #include <xgboost/data.h>
+#include <xgboost/gbm.h>
 #include <functional>
 #include <memory>
 #include <string>
@@ -22,6 +23,29 @@ class TreeUpdater;
 
 namespace xgboost {
 
+/**
+ * \struct  PredictionContext
+ *
+ * \brief Caller owned scratch space of a prediction. Predictions that take
+ * a context only read the predictor and the model, so threads that each
+ * own a context can share one model without locking.
+ */
+
+struct PredictionContext {
+  /*! \brief per thread feature vectors */
+  std::vector<RegTree::FVec> thread_temp;
+  /*! \brief per thread sparse feature vectors, for very wide models */
+  std::vector<RegTree::SparseFVec> thread_sparse;
+  /*! \brief per thread partial sums of a block of rows */
+  std::vector<bst_float> thread_psum;
+  /*! \brief per thread dense row buffers */
+  std::vector<bst_float> thread_dense;
+  /*! \brief per thread TreeShap path buffers */
+  std::vector<std::vector<PathElement> > thread_path;
+  /*! \brief per thread contribution accumulators */
+  std::vector<bst_float> thread_contribs;
+};
+
 /**
  * \class Predictor
  *
@@ -67,6 +91,23 @@ class Predictor {
                             const gbm::GBTreeModel& model, int tree_begin,
                             unsigned ntree_limit = 0) = 0;
 
+  /**
+   * \brief Reentrant batch prediction, all the scratch space lives in ctx.
+   * The prediction cache is not used. Concurrent calls are safe as long as
+   * every call has its own context and its own feature matrix.
+   *
+   * \param [in,out]  dmat        Feature matrix.
+   * \param [in,out]  out_preds   The output preds.
+   * \param           model       The model to predict from.
+   * \param           tree_begin  The tree begin index.
+   * \param           ntree_limit The ntree limit. 0 means do not limit trees.
+   * \param [in,out]  ctx         Scratch space owned by the caller.
+   */
+
+  virtual void PredictBatch(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
+                            const gbm::GBTreeModel& model, int tree_begin,
+                            unsigned ntree_limit, PredictionContext* ctx) const;
+
   /**
    * \fn  virtual void Predictor::UpdatePredictionCache( const gbm::GBTreeModel
    * &model, std::vector<std::unique_ptr<TreeUpdater> >* updaters, int
@@ -110,6 +151,24 @@ class Predictor {
                                unsigned ntree_limit = 0,
                                unsigned root_index = 0) = 0;
 
+  /**
+   * \brief Reentrant online prediction, all the scratch space lives in ctx,
+   * threads that each own a context can call it concurrently.
+   *
+   * \param           inst        The instance to predict.
+   * \param [in,out]  out_preds   The output preds.
+   * \param           model       The model to predict from
+   * \param           ntree_limit The ntree limit.
+   * \param           root_index  Zero-based index of the root.
+   * \param [in,out]  ctx         Scratch space owned by the caller.
+   */
+
+  virtual void PredictInstance(const SparseBatch::Inst& inst,
+                               std::vector<bst_float>* out_preds,
+                               const gbm::GBTreeModel& model,
+                               unsigned ntree_limit, unsigned root_index,
+                               PredictionContext* ctx) const;
+
   /**
    * \fn  virtual void Predictor::PredictLeaf(DMatrix* dmat,
    * std::vector<bst_float>* out_preds, const gbm::GBTreeModel& model, unsigned
@@ -128,6 +187,24 @@ class Predictor {
                            const gbm::GBTreeModel& model,
                            unsigned ntree_limit = 0) = 0;
 
+  /**
+   * \fn  virtual void Predictor::PredictLeafIndex(DMatrix* dmat,
+   * const gbm::GBTreeModel& model, unsigned ntree_limit,
+   * const LeafIndexCallback& callback);
+   *
+   * \brief predict the leaf index of each tree in uint16_t when the node ids
+   * of the trees fit, in uint32_t otherwise. The rows are predicted in blocks
+   * of bounded size, each given to the callback before the next one.
+   *
+   * \param [in,out]  dmat        The input feature matrix.
+   * \param           model       Model to make predictions from.
+   * \param           ntree_limit The ntree limit, 0 for all the trees.
+   * \param           callback    Receives the blocks in the order of the rows.
+   */
+
+  virtual void PredictLeafIndex(DMatrix* dmat, const gbm::GBTreeModel& model,
+                                unsigned ntree_limit, const LeafIndexCallback& callback);
+
   /**
    * \fn  virtual void Predictor::PredictContribution( DMatrix* dmat,
    * std::vector<bst_float>* out_contribs, const gbm::GBTreeModel& model,
@@ -160,6 +237,28 @@ class Predictor {
                                    unsigned ntree_limit = 0,
                                    bool approximate = false) = 0;
 
+  /**
+   * \fn  static void Predictor::PredictMultiModel(DMatrix* dmat,
+   * const std::vector<const gbm::GBTreeModel*>& models, unsigned ntree_limit,
+   * const std::vector<bst_float*>& out_margins);
+   *
+   * \brief add the leaf values of the trees of several models to their
+   * margins in one pass over the rows: the feature vector of a row is filled
+   * once and goes through the trees of all the models before it is dropped.
+   *
+   * \param [in,out]  dmat        The input feature matrix.
+   * \param           models      The models, which may differ in the number of
+   *                              features and of output groups.
+   * \param           ntree_limit The ntree limit of every model, 0 for all the trees.
+   * \param           out_margins The margins of each model, num_row *
+   *                              num_output_group of them, initialized by the caller.
+   */
+
+  static void PredictMultiModel(DMatrix* dmat,
+                                const std::vector<const gbm::GBTreeModel*>& models,
+                                unsigned ntree_limit,
+                                const std::vector<bst_float*>& out_margins);
+
   /**
    * \fn  static Predictor* Predictor::Create(std::string name);
    *
@@ -180,6 +279,34 @@ class Predictor {
     HostDeviceVector<bst_float> predictions;
   };
 
+  /**
+   * \brief Add the single new tree to the cached predictions of a matrix with
+   * the leaf of each row kept by the updater that grew it. The updaters
+   * running after it, such as the pruner, change the tree in place.
+   *
+   * \param [in,out]  updaters   The updater sequence that built the tree.
+   * \param           data       The matrix.
+   * \param [in,out]  out_preds  The cached predictions of the matrix.
+   *
+   * \return whether one of the updaters updated the predictions.
+   */
+  static bool UpdateCacheByUpdaters(
+      std::vector<std::unique_ptr<TreeUpdater>>* updaters, const DMatrix* data,
+      HostDeviceVector<bst_float>* out_preds);
+
+  /**
+   * \brief Whether the cached predictions of a matrix cover all its rows. The
+   * cache does not hold the rows appended after it was filled.
+   *
+   * \param  data              The matrix.
+   * \param  entry             The cache entry of the matrix.
+   * \param  num_output_group  The number of predictions of a row.
+   *
+   * \return whether the predictions can be read from the cache.
+   */
+  static bool CacheCoversRows(const DMatrix* data, const PredictionCacheEntry& entry,
+                              int num_output_group);
+
   /**
    * \brief Map of matrices and associated cached predictions to facilitate
    * storing and looking up predictions.
@@ -425,8 +425,8 @@ struct PathElement {
   bst_float zero_fraction;
   bst_float one_fraction;
   bst_float pweight;
-  PathElement() {}
-  PathElement(int i, bst_float z, bst_float o, bst_float w) :
+  XGBOOST_DEVICE PathElement() {}
+  XGBOOST_DEVICE PathElement(int i, bst_float z, bst_float o, bst_float w) :
     feature_index(i), zero_fraction(z), one_fraction(o), pweight(w) {}
 };
 
@@ -488,6 +488,58 @@ class RegTree: public TreeModel<bst_float, RTreeNodeStat> {
     // 稠密向量，索引与特征维度一致
     std::vector<Entry> data;
   };
+  /*!
+   * \brief sparse feature vector, an open addressing hash of the features
+   *  present in a row. It takes memory in the length of the widest row filled
+   *  instead of the number of features, for very wide models on sparse rows.
+   */
+  struct SparseFVec {
+   public:
+    /*!
+     * \brief fill the vector with sparse vector
+     * \param inst The sparse instance to fill.
+     */
+    inline void Fill(const RowBatch::Inst& inst);
+    /*!
+     * \brief drop the trace after fill, must be called after fill.
+     * \param inst The sparse instance to drop.
+     */
+    inline void Drop(const RowBatch::Inst& inst);
+    /*!
+     * \brief look up the i-th value
+     * \param i feature index.
+     * \param out set to the i-th feature value when present.
+     * \return whether the i-th value is present.
+     */
+    inline bool Find(size_t i, bst_float* out) const;
+    /*!
+     * \brief get ith value
+     * \param i feature index.
+     * \return the i-th feature value
+     */
+    inline bst_float fvalue(size_t i) const;
+    /*!
+     * \brief check whether i-th entry is missing
+     * \param i feature index.
+     * \return whether i-th value is missing.
+     */
+    inline bool is_missing(size_t i) const;
+
+   private:
+    /*! \brief the key of an empty slot */
+    static const bst_uint kEmpty = static_cast<bst_uint>(-1);
+    // first slot probed for a feature
+    inline size_t Slot(size_t i) const {
+      return static_cast<size_t>((static_cast<uint32_t>(i) * 2654435761U) >> shift_);
+    }
+    // feature of each slot, kEmpty when the slot is free
+    std::vector<bst_uint> index_;
+    std::vector<bst_float> value_;
+    // slots filled by the current row
+    std::vector<size_t> used_;
+    // 32 - log2 of the number of slots
+    unsigned shift_{0};
+  };
   /*!
    * \brief get the leaf index
    * \param feat dense feature vector, if the feature is missing the field is set to NaN
@@ -516,6 +568,28 @@ class RegTree: public TreeModel<bst_float, RTreeNodeStat> {
                                      bst_float *out_contribs,
                                      int condition = 0,
                                      unsigned condition_feature = 0) const;
+  /*!
+   * \brief calculate the feature contributions using a caller provided path buffer,
+   *  so the buffer can be reused across instances
+   * \param feat dense feature vector, if the feature is missing the field is set to NaN
+   * \param root_id starting root index of the instance
+   * \param out_contribs output vector to hold the contributions
+   * \param condition fix one feature to either off (-1) on (1) or not fixed (0 default)
+   * \param condition_feature the index of the feature to fix
+   * \param unique_path_data buffer of at least UniquePathSize(MaxDepth(root_id)) elements
+   */
+  inline void CalculateContributions(const RegTree::FVec& feat, unsigned root_id,
+                                     bst_float *out_contribs,
+                                     int condition, unsigned condition_feature,
+                                     PathElement *unique_path_data) const;
+  /*!
+   * \brief size of the unique path buffer TreeShap needs for a tree of the given depth
+   * \param max_depth maximum depth of the tree
+   */
+  inline static size_t UniquePathSize(int max_depth) {
+    const size_t maxd = static_cast<size_t>(max_depth) + 2;
+    return (maxd * (maxd + 1)) / 2;
+  }
   /*!
    * \brief Recursive function that computes the feature attributions for a single tree.
    * \param feat dense feature vector, if the feature is missing the field is set to NaN
@@ -608,6 +682,63 @@ inline bool RegTree::FVec::is_missing(size_t i) const {
   return data[i].flag == -1;
 }
 
+inline void RegTree::SparseFVec::Fill(const RowBatch::Inst& inst) {
+  // at most half of the slots are used, so the probes stay short
+  size_t nslot = 16;
+  unsigned shift = 28;
+  while (nslot < 2 * static_cast<size_t>(inst.length)) {
+    nslot <<= 1;
+    --shift;
+  }
+  if (index_.size() < nslot) {
+    index_.assign(nslot, static_cast<bst_uint>(kEmpty));
+    value_.resize(nslot);
+    shift_ = shift;
+  }
+  const size_t mask = index_.size() - 1;
+  for (bst_uint i = 0; i < inst.length; ++i) {
+    size_t slot = this->Slot(inst[i].index);
+    while (index_[slot] != kEmpty && index_[slot] != inst[i].index) {
+      slot = (slot + 1) & mask;
+    }
+    if (index_[slot] == kEmpty) {
+      index_[slot] = inst[i].index;
+      used_.push_back(slot);
+    }
+    value_[slot] = inst[i].fvalue;
+  }
+}
+
+inline void RegTree::SparseFVec::Drop(const RowBatch::Inst& inst) {
+  for (size_t slot : used_) {
+    index_[slot] = kEmpty;
+  }
+  used_.clear();
+}
+
+inline bool RegTree::SparseFVec::Find(size_t i, bst_float* out) const {
+  if (index_.empty()) return false;
+  const size_t mask = index_.size() - 1;
+  for (size_t slot = this->Slot(i); index_[slot] != kEmpty; slot = (slot + 1) & mask) {
+    if (index_[slot] == i) {
+      *out = value_[slot];
+      return true;
+    }
+  }
+  return false;
+}
+
+inline bst_float RegTree::SparseFVec::fvalue(size_t i) const {
+  bst_float v = 0.0f;
+  this->Find(i, &v);
+  return v;
+}
+
+inline bool RegTree::SparseFVec::is_missing(size_t i) const {
+  bst_float v;
+  return !this->Find(i, &v);
+}
+
 inline int RegTree::GetLeafIndex(const RegTree::FVec& feat, unsigned root_id) const {
   int pid = static_cast<int>(root_id);
   while (!(*this)[pid].is_leaf()) {
@@ -675,7 +806,7 @@ inline void RegTree::CalculateContributionsApprox(const RegTree::FVec& feat, uns
 }
 
 // extend our decision path with a fraction of one and zero extensions
-inline void ExtendPath(PathElement *unique_path, unsigned unique_depth,
+XGBOOST_DEVICE inline void ExtendPath(PathElement *unique_path, unsigned unique_depth,
                        bst_float zero_fraction, bst_float one_fraction, int feature_index) {
   unique_path[unique_depth].feature_index = feature_index;
   unique_path[unique_depth].zero_fraction = zero_fraction;
@@ -690,7 +821,7 @@ inline void ExtendPath(PathElement *unique_path, unsigned unique_depth,
 }
 
 // undo a previous extension of the decision path
-inline void UnwindPath(PathElement *unique_path, unsigned unique_depth, unsigned path_index) {
+XGBOOST_DEVICE inline void UnwindPath(PathElement *unique_path, unsigned unique_depth, unsigned path_index) {
   const bst_float one_fraction = unique_path[path_index].one_fraction;
   const bst_float zero_fraction = unique_path[path_index].zero_fraction;
   bst_float next_one_portion = unique_path[unique_depth].pweight;
@@ -717,7 +848,7 @@ inline void UnwindPath(PathElement *unique_path, unsigned unique_depth, unsigned
 
 // determine what the total permuation weight would be if
 // we unwound a previous extension in the decision path
-inline bst_float UnwoundPathSum(const PathElement *unique_path, unsigned unique_depth,
+XGBOOST_DEVICE inline bst_float UnwoundPathSum(const PathElement *unique_path, unsigned unique_depth,
                                 unsigned path_index) {
   const bst_float one_fraction = unique_path[path_index].one_fraction;
   const bst_float zero_fraction = unique_path[path_index].zero_fraction;
@@ -828,19 +959,24 @@ inline void RegTree::CalculateContributions(const RegTree::FVec& feat, unsigned
                                             bst_float *out_contribs,
                                             int condition,
                                             unsigned condition_feature) const {
+  // Preallocate space for the unique path data
+  std::vector<PathElement> unique_path_data(UniquePathSize(this->MaxDepth(root_id)));
+  this->CalculateContributions(feat, root_id, out_contribs, condition, condition_feature,
+                               unique_path_data.data());
+}
+
+inline void RegTree::CalculateContributions(const RegTree::FVec& feat, unsigned root_id,
+                                            bst_float *out_contribs,
+                                            int condition,
+                                            unsigned condition_feature,
+                                            PathElement *unique_path_data) const {
   // find the expected value of the tree's predictions
   if (condition == 0) {
     bst_float node_value = this->node_mean_values[static_cast<int>(root_id)];
     out_contribs[feat.size()] += node_value;
   }
-
-  // Preallocate space for the unique path data
-  const int maxd = this->MaxDepth(root_id) + 2;
-  PathElement *unique_path_data = new PathElement[(maxd * (maxd + 1)) / 2];
-
   TreeShap(feat, out_contribs, root_id, 0, unique_path_data,
            1, 1, -1, condition, condition_feature, 1);
-  delete[] unique_path_data;
 }
 
 /*! \brief get next position of the tree given current pid */
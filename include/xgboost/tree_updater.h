@@ -59,6 +59,18 @@ class TreeUpdater {
     return false;
   }
 
+  /*!
+   * \brief share the read-only data built from the training matrix with
+   *        another instance of the same updater, initialized with the same
+   *        arguments, so that both can update trees at the same time.
+   * \param other the updater receiving the data
+   * \return boolean indicating whether the two updaters can update trees
+   *         concurrently, each with its own gradients and trees.
+   */
+  virtual bool ShareWith(TreeUpdater* other) {
+    return false;
+  }
+
   /*!
    * \brief Create a tree updater given name
    * \param name Name of the tree updater.
@@ -16,6 +16,7 @@
 package ml.dmlc.xgboost4j.java;
 
 import java.io.*;
+import java.nio.ByteBuffer;
 import java.util.HashMap;
 import java.util.List;
 import java.util.Map;
@@ -318,6 +319,26 @@ public class Booster implements Serializable, KryoSerializable {
     return this.predict(data, outputMargin, treeLimit, false, false);
   }
 
+  /**
+   * Predict with data into a direct buffer, in native order, without creating java arrays.
+   * The predictions of row r start at float r * (number of predictions / rows).
+   *
+   * @param data         data
+   * @param outputMargin output margin
+   * @param treeLimit    limit number of trees, 0 means all trees.
+   * @param predicts     buffer the predictions are written to, from its first byte
+   * @return number of predicted floats
+   * @throws XGBoostError native error, also when predicts is too small
+   */
+  public synchronized long predictInto(DMatrix data, boolean outputMargin, int treeLimit,
+                                       ByteBuffer predicts) throws XGBoostError {
+    DMatrix.checkBuffer(predicts, 0, "predicts");
+    long[] outLen = new long[1];
+    XGBoostJNI.checkCall(XGBoostJNI.XGBoosterPredictIntoBuffer(handle, data.getHandle(),
+            outputMargin ? 1 : 0, treeLimit, predicts, outLen));
+    return outLen[0];
+  }
+
   /**
    * Save model to modelPath
    *
@@ -15,6 +15,8 @@
  */
 package ml.dmlc.xgboost4j.java;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.Iterator;
 
 import ml.dmlc.xgboost4j.LabeledPoint;
@@ -142,6 +144,45 @@ public class DMatrix {
     handle = out[0];
   }
 
+  /**
+   * Create DMatrix from a sparse matrix in CSR format held in direct buffers, which are
+   * read in place without a copy on the java heap.
+   * @param headers The row index of the matrix, numRows + 1 longs in native order.
+   * @param indices The indices of presenting entries, numElements ints in native order.
+   * @param data The data content, numElements floats in native order.
+   * @param numRows number of rows
+   * @param numElements number of present entries
+   * @param numColumns number of columns, 0 to infer it from the indices
+   * @throws XGBoostError native error
+   */
+  public DMatrix(ByteBuffer headers, ByteBuffer indices, ByteBuffer data, long numRows,
+                 long numElements, int numColumns) throws XGBoostError {
+    checkBuffer(headers, (numRows + 1) * 8, "headers");
+    checkBuffer(indices, numElements * 4, "indices");
+    checkBuffer(data, numElements * 4, "data");
+    long[] out = new long[1];
+    XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixCreateFromCSRExBuffer(headers, indices, data,
+            numRows + 1, numElements, numColumns, out));
+    handle = out[0];
+  }
+
+  /**
+   * create DMatrix from a dense matrix held in a direct buffer, which is read in place
+   * without a copy on the java heap.
+   * @param data data values, nrow * ncol floats in native order, row major
+   * @param nrow number of rows
+   * @param ncol number of columns
+   * @param missing the specified value to represent the missing value
+   * @throws XGBoostError native error
+   */
+  public DMatrix(ByteBuffer data, int nrow, int ncol, float missing) throws XGBoostError {
+    checkBuffer(data, (long) nrow * ncol * 4, "data");
+    long[] out = new long[1];
+    XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixCreateFromMatBuffer(data, nrow, ncol, missing,
+            out));
+    handle = out[0];
+  }
+
   /**
    * used for DMatrix slice
    */
@@ -170,6 +211,30 @@ public class DMatrix {
     XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixSetFloatInfo(handle, "weight", weights));
   }
 
+  /**
+   * set label of dmatrix from a direct buffer of floats in native order
+   *
+   * @param labels labels
+   * @param len number of labels
+   * @throws XGBoostError native error
+   */
+  public void setLabel(ByteBuffer labels, long len) throws XGBoostError {
+    checkBuffer(labels, len * 4, "labels");
+    XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixSetFloatInfoBuffer(handle, "label", labels, len));
+  }
+
+  /**
+   * set weight of each instance from a direct buffer of floats in native order
+   *
+   * @param weights weights
+   * @param len number of weights
+   * @throws XGBoostError native error
+   */
+  public void setWeight(ByteBuffer weights, long len) throws XGBoostError {
+    checkBuffer(weights, len * 4, "weights");
+    XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixSetFloatInfoBuffer(handle, "weight", weights, len));
+  }
+
   /**
    * Set base margin (initial prediction).
    *
@@ -283,6 +348,25 @@ public class DMatrix {
     return handle;
   }
 
+  /**
+   * check that buffer is direct, in native order and holds at least nbytes
+   */
+  static void checkBuffer(ByteBuffer buffer, long nbytes, String name) {
+    if (buffer == null) {
+      throw new NullPointerException(name + ": null");
+    }
+    if (!buffer.isDirect()) {
+      throw new IllegalArgumentException(name + " must be a direct ByteBuffer");
+    }
+    if (buffer.order() != ByteOrder.nativeOrder()) {
+      throw new IllegalArgumentException(name + " must be in native byte order");
+    }
+    if (buffer.capacity() < nbytes) {
+      throw new IllegalArgumentException(String.format(
+              "%s must hold %s bytes, got %s", name, nbytes, buffer.capacity()));
+    }
+  }
+
   /**
    * flatten a mat to array
    */
@@ -65,6 +65,15 @@ class XGBoostJNI {
   public final static native int XGDMatrixCreateFromMat(float[] data, int nrow, int ncol,
                                                         float missing, long[] out);
 
+  // the buffers are direct and in native order, they are read in place
+  public final static native int XGDMatrixCreateFromCSRExBuffer(ByteBuffer indptr, ByteBuffer indices,
+                                                              ByteBuffer data, long nindptr,
+                                                              long nelem, int shapeParam,
+                                                              long[] out);
+
+  public final static native int XGDMatrixCreateFromMatBuffer(ByteBuffer data, int nrow, int ncol,
+                                                              float missing, long[] out);
+
   public final static native int XGDMatrixSliceDMatrix(long handle, int[] idxset, long[] out);
 
   public final static native int XGDMatrixFree(long handle);
@@ -73,6 +82,9 @@ class XGBoostJNI {
 
   public final static native int XGDMatrixSetFloatInfo(long handle, String field, float[] array);
 
+  public final static native int XGDMatrixSetFloatInfoBuffer(long handle, String field,
+                                                             ByteBuffer array, long len);
+
   public final static native int XGDMatrixSetUIntInfo(long handle, String field, int[] array);
 
   public final static native int XGDMatrixSetGroup(long handle, int[] group);
@@ -100,6 +112,10 @@ class XGBoostJNI {
   public final static native int XGBoosterPredict(long handle, long dmat, int option_mask,
                                                   int ntree_limit, float[][] predicts);
 
+  public final static native int XGBoosterPredictIntoBuffer(long handle, long dmat,
+                                                            int option_mask, int ntree_limit,
+                                                            ByteBuffer predicts, long[] out_len);
+
   public final static native int XGBoosterLoadModel(long handle, String fname);
 
   public final static native int XGBoosterSaveModel(long handle, String fname);
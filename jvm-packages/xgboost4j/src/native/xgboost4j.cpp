@@ -32,6 +32,16 @@ void setHandle(JNIEnv *jenv, jlongArray jhandle, void* handle) {
   jenv->SetLongArrayRegion(jhandle, 0, 1, &out);
 }
 
+// address of a direct buffer, throws IllegalArgumentException in java for other buffers
+void* getBufferAddress(JNIEnv *jenv, jobject jbuffer) {
+  void* ptr = jbuffer == nullptr ? nullptr : jenv->GetDirectBufferAddress(jbuffer);
+  if (ptr == nullptr) {
+    jenv->ThrowNew(jenv->FindClass("java/lang/IllegalArgumentException"),
+                   "a direct ByteBuffer is required");
+  }
+  return ptr;
+}
+
 // global JVM
 static JavaVM* global_jvm = nullptr;
 
@@ -111,19 +121,19 @@ XGB_EXTERN_C int XGBoost4jCallbackDataIterNext(
           << XGBGetLastError();
       // release the elements.
       jenv->ReleaseLongArrayElements(
-          joffset, reinterpret_cast<jlong *>(cbatch.offset), 0);
+          joffset, reinterpret_cast<jlong *>(cbatch.offset), JNI_ABORT);
       jenv->DeleteLocalRef(joffset);
       if (jlabel != nullptr) {
-        jenv->ReleaseFloatArrayElements(jlabel, cbatch.label, 0);
+        jenv->ReleaseFloatArrayElements(jlabel, cbatch.label, JNI_ABORT);
         jenv->DeleteLocalRef(jlabel);
       }
       if (jweight != nullptr) {
-        jenv->ReleaseFloatArrayElements(jweight, cbatch.weight, 0);
+        jenv->ReleaseFloatArrayElements(jweight, cbatch.weight, JNI_ABORT);
         jenv->DeleteLocalRef(jweight);
       }
-      jenv->ReleaseIntArrayElements(jindex, (jint*) cbatch.index, 0);
+      jenv->ReleaseIntArrayElements(jindex, (jint*) cbatch.index, JNI_ABORT);
       jenv->DeleteLocalRef(jindex);
-      jenv->ReleaseFloatArrayElements(jvalue, cbatch.value, 0);
+      jenv->ReleaseFloatArrayElements(jvalue, cbatch.value, JNI_ABORT);
       jenv->DeleteLocalRef(jvalue);
       jenv->DeleteLocalRef(batch);
       jenv->DeleteLocalRef(batchClass);
@@ -216,9 +226,9 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFro
   jint ret = (jint) XGDMatrixCreateFromCSREx((size_t const *)indptr, (unsigned int const *)indices, (float const *)data, nindptr, nelem, jcol, &result);
   setHandle(jenv, jout, result);
   //Release
-  jenv->ReleaseLongArrayElements(jindptr, indptr, 0);
-  jenv->ReleaseIntArrayElements(jindices, indices, 0);
-  jenv->ReleaseFloatArrayElements(jdata, data, 0);
+  jenv->ReleaseLongArrayElements(jindptr, indptr, JNI_ABORT);
+  jenv->ReleaseIntArrayElements(jindices, indices, JNI_ABORT);
+  jenv->ReleaseFloatArrayElements(jdata, data, JNI_ABORT);
   return ret;
 }
 
@@ -239,9 +249,9 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFro
   jint ret = (jint) XGDMatrixCreateFromCSCEx((size_t const *)indptr, (unsigned int const *)indices, (float const *)data, nindptr, nelem, jrow, &result);
   setHandle(jenv, jout, result);
   //release
-  jenv->ReleaseLongArrayElements(jindptr, indptr, 0);
-  jenv->ReleaseIntArrayElements(jindices, indices, 0);
-  jenv->ReleaseFloatArrayElements(jdata, data, 0);
+  jenv->ReleaseLongArrayElements(jindptr, indptr, JNI_ABORT);
+  jenv->ReleaseIntArrayElements(jindices, indices, JNI_ABORT);
+  jenv->ReleaseFloatArrayElements(jdata, data, JNI_ABORT);
 
   return ret;
 }
@@ -261,7 +271,40 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFro
   jint ret = (jint) XGDMatrixCreateFromMat((float const *)data, nrow, ncol, jmiss, &result);
   setHandle(jenv, jout, result);
   //release
-  jenv->ReleaseFloatArrayElements(jdata, data, 0);
+  jenv->ReleaseFloatArrayElements(jdata, data, JNI_ABORT);
+  return ret;
+}
+
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGDMatrixCreateFromCSRExBuffer
+ * Signature: (Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;JJI[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFromCSRExBuffer
+  (JNIEnv *jenv, jclass jcls, jobject jindptr, jobject jindices, jobject jdata, jlong jnindptr, jlong jnelem, jint jcol, jlongArray jout) {
+  DMatrixHandle result;
+  void* indptr = getBufferAddress(jenv, jindptr);
+  void* indices = getBufferAddress(jenv, jindices);
+  void* data = getBufferAddress(jenv, jdata);
+  if (indptr == nullptr || indices == nullptr || data == nullptr) return -1;
+  // the buffers are read in place, without a copy in java
+  jint ret = (jint) XGDMatrixCreateFromCSREx((size_t const *)indptr, (unsigned int const *)indices, (float const *)data, (size_t)jnindptr, (size_t)jnelem, (size_t)jcol, &result);
+  setHandle(jenv, jout, result);
+  return ret;
+}
+
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGDMatrixCreateFromMatBuffer
+ * Signature: (Ljava/nio/ByteBuffer;IIF[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFromMatBuffer
+  (JNIEnv *jenv, jclass jcls, jobject jdata, jint jnrow, jint jncol, jfloat jmiss, jlongArray jout) {
+  DMatrixHandle result;
+  void* data = getBufferAddress(jenv, jdata);
+  if (data == nullptr) return -1;
+  jint ret = (jint) XGDMatrixCreateFromMat((float const *)data, (bst_ulong)jnrow, (bst_ulong)jncol, jmiss, &result);
+  setHandle(jenv, jout, result);
   return ret;
 }
 
@@ -327,7 +370,24 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixSetFloatI
   int ret = XGDMatrixSetFloatInfo(handle, field, (float const *)array, len);
   //release
   if (field) jenv->ReleaseStringUTFChars(jfield, field);
-  jenv->ReleaseFloatArrayElements(jarray, array, 0);
+  jenv->ReleaseFloatArrayElements(jarray, array, JNI_ABORT);
+  return ret;
+}
+
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGDMatrixSetFloatInfoBuffer
+ * Signature: (JLjava/lang/String;Ljava/nio/ByteBuffer;J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixSetFloatInfoBuffer
+  (JNIEnv *jenv, jclass jcls, jlong jhandle, jstring jfield, jobject jarray, jlong jlen) {
+  DMatrixHandle handle = (DMatrixHandle) jhandle;
+  void* array = getBufferAddress(jenv, jarray);
+  if (array == nullptr) return -1;
+  const char*  field = jenv->GetStringUTFChars(jfield, 0);
+  int ret = XGDMatrixSetFloatInfo(handle, field, (float const *)array, (bst_ulong)jlen);
+  //release
+  if (field) jenv->ReleaseStringUTFChars(jfield, field);
   return ret;
 }
 
@@ -345,7 +405,7 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixSetUIntIn
   int ret = XGDMatrixSetUIntInfo(handle, (char const *)field, (unsigned int const *)array, len);
   //release
   if (field) jenv->ReleaseStringUTFChars(jfield, (const char *)field);
-  jenv->ReleaseIntArrayElements(jarray, array, 0);
+  jenv->ReleaseIntArrayElements(jarray, array, JNI_ABORT);
 
   return ret;
 }
@@ -362,7 +422,7 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixSetGroup
   bst_ulong len = (bst_ulong)jenv->GetArrayLength(jarray);
   int ret = XGDMatrixSetGroup(handle, (unsigned int const *)array, len);
   //release
-  jenv->ReleaseIntArrayElements(jarray, array, 0);
+  jenv->ReleaseIntArrayElements(jarray, array, JNI_ABORT);
   return ret;
 }
 
@@ -564,6 +624,26 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGBoosterPredict
   return ret;
 }
 
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGBoosterPredictIntoBuffer
+ * Signature: (JJIILjava/nio/ByteBuffer;[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGBoosterPredictIntoBuffer
+  (JNIEnv *jenv, jclass jcls, jlong jhandle, jlong jdmat, jint joption_mask, jint jntree_limit, jobject jbuffer, jlongArray jout_len) {
+  BoosterHandle handle = (BoosterHandle) jhandle;
+  DMatrixHandle dmat = (DMatrixHandle) jdmat;
+  void* out = getBufferAddress(jenv, jbuffer);
+  if (out == nullptr) return -1;
+  bst_ulong size = (bst_ulong)(jenv->GetDirectBufferCapacity(jbuffer) / sizeof(float));
+  bst_ulong len = 0;
+  // the predictions are written into the buffer, no java array is created
+  int ret = XGBoosterPredictInto(handle, dmat, joption_mask, (unsigned int) jntree_limit, size, &len, (float *) out);
+  jlong jlen = (jlong) len;
+  jenv->SetLongArrayRegion(jout_len, 0, 1, &jlen);
+  return ret;
+}
+
 /*
  * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
  * Method:    XGBoosterLoadModel
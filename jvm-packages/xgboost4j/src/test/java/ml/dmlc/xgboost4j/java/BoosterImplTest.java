@@ -16,6 +16,8 @@
 package ml.dmlc.xgboost4j.java;
 
 import java.io.*;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.nio.file.Files;
 import java.nio.file.Path;
 import java.util.Arrays;
@@ -101,6 +103,29 @@ public class BoosterImplTest {
     TestCase.assertTrue(eval.eval(predicts, testMat) < 0.1f);
   }
 
+  @Test
+  public void testPredictIntoBuffer() throws XGBoostError, IOException {
+    DMatrix trainMat = new DMatrix("../../demo/data/agaricus.txt.train");
+    DMatrix testMat = new DMatrix("../../demo/data/agaricus.txt.test");
+
+    Booster booster = trainBooster(trainMat, testMat);
+    float[][] predicts = booster.predict(testMat, true, 0);
+    int nrow = (int) testMat.rowNum();
+    ByteBuffer buffer = ByteBuffer.allocateDirect(nrow * 4).order(ByteOrder.nativeOrder());
+    TestCase.assertEquals(nrow, booster.predictInto(testMat, true, 0, buffer));
+    for (int i = 0; i < nrow; ++i) {
+      TestCase.assertEquals(predicts[i][0], buffer.getFloat(i * 4));
+    }
+    // too small a buffer is an error
+    try {
+      booster.predictInto(testMat, true, 0, ByteBuffer.allocateDirect(4)
+              .order(ByteOrder.nativeOrder()));
+      TestCase.fail("too small a buffer must be rejected");
+    } catch (XGBoostError e) {
+      // expected
+    }
+  }
+
   @Test
   public void saveLoadModelWithPath() throws XGBoostError, IOException {
     DMatrix trainMat = new DMatrix("../../demo/data/agaricus.txt.train");
@@ -15,6 +15,8 @@
  */
 package ml.dmlc.xgboost4j.java;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.Arrays;
 import java.util.Random;
 
@@ -223,4 +225,42 @@ public class DMatrixTest {
     TestCase.assertTrue(dmat0.rowNum() == 10);
     TestCase.assertTrue(dmat0.getLabel().length == 10);
   }
+
+  @Test
+  public void testCreateFromDirectBuffer() throws XGBoostError {
+    // the sparse matrix of testCreateFromCSREx, read in place from direct buffers
+    float[] data = new float[]{1, 2, 3, 4, 2, 3, 5, 3, 1, 2, 5};
+    int[] colIndex = new int[]{0, 2, 3, 0, 2, 3, 4, 0, 1, 2, 3};
+    long[] rowHeaders = new long[]{0, 3, 7, 11};
+    ByteBuffer bdata = ByteBuffer.allocateDirect(data.length * 4).order(ByteOrder.nativeOrder());
+    bdata.asFloatBuffer().put(data);
+    ByteBuffer bindex = ByteBuffer.allocateDirect(colIndex.length * 4)
+            .order(ByteOrder.nativeOrder());
+    bindex.asIntBuffer().put(colIndex);
+    ByteBuffer bheaders = ByteBuffer.allocateDirect(rowHeaders.length * 8)
+            .order(ByteOrder.nativeOrder());
+    bheaders.asLongBuffer().put(rowHeaders);
+    DMatrix dmat1 = new DMatrix(bheaders, bindex, bdata, 3, data.length, 5);
+    TestCase.assertTrue(dmat1.rowNum() == 3);
+    float[] label1 = new float[]{1, 0, 1};
+    ByteBuffer blabel = ByteBuffer.allocateDirect(label1.length * 4)
+            .order(ByteOrder.nativeOrder());
+    blabel.asFloatBuffer().put(label1);
+    dmat1.setLabel(blabel, label1.length);
+    TestCase.assertTrue(Arrays.equals(label1, dmat1.getLabel()));
+
+    // the dense matrix
+    ByteBuffer bdense = ByteBuffer.allocateDirect(6 * 4).order(ByteOrder.nativeOrder());
+    bdense.asFloatBuffer().put(new float[]{1, -0.1f, 2, 3, 4, -0.1f});
+    DMatrix dmat2 = new DMatrix(bdense, 2, 3, -0.1f);
+    TestCase.assertTrue(dmat2.rowNum() == 2);
+
+    // heap buffers are not accepted
+    try {
+      new DMatrix(ByteBuffer.allocate(6 * 4).order(ByteOrder.nativeOrder()), 2, 3, -0.1f);
+      TestCase.fail("a heap buffer must be rejected");
+    } catch (IllegalArgumentException e) {
+      // expected
+    }
+  }
 }
@@ -0,0 +1,316 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file dense_csv.cc
+ * \brief Plugin to load dense csv with a fixed number of columns, registered
+ *  as the dense_csv data format, e.g. train.csv?format=dense_csv&label_column=0
+ *
+ *  The chunks are read by the parallel text parser. The commas of a line are
+ *  found 16 bytes at a time with SSE2, and every row is parsed straight into
+ *  its num_col slots of a row major buffer. The index of the block is the
+ *  same for all the rows, so it is only written when the block grows. Empty
+ *  fields and the fields equal to missing are left out of the block.
+ */
+#include <dmlc/omp.h>
+#include <dmlc/parameter.h>
+#include <dmlc/registry.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+#include "../../src/data/parallel_text_parser.h"
+#include "../../src/data/text_number.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define XGBOOST_DENSE_CSV_SSE2
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace xgboost {
+namespace data {
+
+DMLC_REGISTRY_FILE_TAG(dense_csv);
+
+struct DenseCSVParam : public dmlc::Parameter<DenseCSVParam> {
+  /*! \brief number of feature columns, 0 to count them on the first line */
+  int num_col;
+  /*! \brief value of the missing entries, besides the empty fields */
+  float missing;
+  DMLC_DECLARE_PARAMETER(DenseCSVParam) {
+    DMLC_DECLARE_FIELD(num_col).set_default(0).set_lower_bound(0)
+        .describe("Number of feature columns, 0 to count them on the first line.");
+    DMLC_DECLARE_FIELD(missing).set_default(std::numeric_limits<float>::quiet_NaN())
+        .describe("Value of the missing entries, besides the empty fields.");
+  }
+};
+
+DMLC_REGISTER_PARAMETER(DenseCSVParam);
+
+namespace {
+/*! \brief finds the commas of [p, end) one after the other */
+class CommaScanner {
+ public:
+  CommaScanner(const char* p, const char* end)
+      : next_(p), end_(end), base_(p), mask_(0) {}
+  /*! \brief the next comma, end when there is none left */
+  inline const char* Next() {
+#ifdef XGBOOST_DENSE_CSV_SSE2
+    const __m128i comma = _mm_set1_epi8(',');
+    while (mask_ == 0 && end_ - next_ >= 16) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(next_));
+      mask_ = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, comma)));
+      base_ = next_;
+      next_ += 16;
+    }
+    if (mask_ != 0) {
+      const char* pos = base_ + LowestBit(mask_);
+      mask_ &= mask_ - 1;
+      return pos;
+    }
+#endif
+    // the tail shorter than a vector
+    const char* pos = static_cast<const char*>(std::memchr(next_, ',', end_ - next_));
+    if (pos == nullptr) {
+      next_ = end_;
+      return end_;
+    }
+    next_ = pos + 1;
+    return pos;
+  }
+
+ private:
+  static inline int LowestBit(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;  // NOLINT(*)
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+  }
+  // start of the bytes not yet scanned
+  const char* next_;
+  const char* end_;
+  // start of the vector whose commas are the bits of mask_
+  const char* base_;
+  unsigned mask_;
+};
+
+// the value of the field [p, end), false when it is not a number
+inline bool ParseField(const char* p, const char* end, bst_float missing, bst_float* out) {
+  p = SkipSpace(p, end);
+  if (p == end) {
+    *out = std::numeric_limits<bst_float>::quiet_NaN();
+    return true;
+  }
+  const char* q = ParseFloat(p, end, out);
+  if (q == p || SkipSpace(q, end) != end) return false;
+  if (*out == missing) *out = std::numeric_limits<bst_float>::quiet_NaN();
+  return true;
+}
+
+// number of fields of the first line of [p, end) that is not blank
+size_t CountFields(const char* p, const char* end) {
+  while (p != end) {
+    const char* lend = LineEnd(p, end);
+    if (SkipSpace(p, lend) != lend) return std::count(p, lend, ',') + 1;
+    p = lend == end ? end : lend + 1;
+  }
+  return 0;
+}
+
+// number of lines of [p, end) that are not blank
+size_t CountRows(const char* p, const char* end) {
+  size_t nrow = 0;
+  while (p != end) {
+    const char* lend = LineEnd(p, end);
+    if (SkipSpace(p, lend) != lend) ++nrow;
+    p = lend == end ? end : lend + 1;
+  }
+  return nrow;
+}
+}  // namespace
+
+class DenseCSVParser : public ParallelTextParser {
+ public:
+  DenseCSVParser(dmlc::SeekStream* fi, const std::map<std::string, std::string>& args)
+      : ParallelTextParser(fi, true, args), pattern_size_(0) {
+    dense_param_.InitAllowUnknown(args);
+    ncol_ = static_cast<size_t>(dense_param_.num_col);
+  }
+
+ protected:
+  void ParseChunk(const char* begin, const char* end) override {
+    const int label_column = param_.label_column;
+    if (ncol_ == 0) {
+      const size_t nfield = CountFields(begin, end);
+      ncol_ = label_column >= 0 && nfield > static_cast<size_t>(label_column) ?
+          nfield - 1 : nfield;
+    }
+    CHECK(ncol_ != 0 || CountFields(begin, end) == 0) << "dense_csv: no feature column";
+    const int nthread = param_.nthread > 0 ? param_.nthread : omp_get_max_threads();
+    const size_t nseg = std::max(1, nthread);
+    // one segment of complete lines per thread
+    std::vector<const char*> segments(nseg + 1, end);
+    segments[0] = begin;
+    for (size_t t = 1; t < nseg; ++t) {
+      const char* p = std::max(segments[t - 1], begin + (end - begin) * t / nseg);
+      const char* lend = LineEnd(p, end);
+      segments[t] = lend == end ? end : lend + 1;
+    }
+    std::vector<size_t> row_begin(nseg + 1, 0);
+    #pragma omp parallel for schedule(static, 1) num_threads(nthread)
+    for (omp_ulong t = 0; t < nseg; ++t) {
+      row_begin[t + 1] = CountRows(segments[t], segments[t + 1]);
+    }
+    for (size_t t = 0; t < nseg; ++t) row_begin[t + 1] += row_begin[t];
+    const size_t nrow = row_begin[nseg];
+    const size_t ncol = ncol_;
+    offset_.resize(nrow + 1);
+    label_.resize(nrow);
+    value_.resize(nrow * ncol);
+    if (index_.size() < nrow * ncol) index_.resize(nrow * ncol);
+
+    // parse every row into its slots, the missing values are NaN
+    std::vector<size_t> nmissing(nseg, 0);
+    std::vector<const char*> errors(nseg, nullptr);
+    #pragma omp parallel for schedule(static, 1) num_threads(nthread)
+    for (omp_ulong t = 0; t < nseg; ++t) {
+      size_t row = row_begin[t];
+      const char* p = segments[t];
+      while (p != segments[t + 1] && errors[t] == nullptr) {
+        const char* lend = LineEnd(p, segments[t + 1]);
+        if (SkipSpace(p, lend) != lend) {
+          bst_float* out = dmlc::BeginPtr(value_) + row * ncol;
+          label_[row] = 0.0f;
+          CommaScanner commas(p, lend);
+          size_t nfeature = 0;
+          const char* field = p;
+          for (int column = 0; ; ++column) {
+            const char* comma = commas.Next();
+            bst_float v;
+            if (!ParseField(field, comma, dense_param_.missing, &v)) {
+              errors[t] = p;
+              break;
+            }
+            if (column == label_column) {
+              label_[row] = std::isnan(v) ? 0.0f : v;
+            } else if (nfeature < ncol) {
+              out[nfeature++] = v;
+              nmissing[t] += std::isnan(v);
+            } else {
+              errors[t] = p;
+              break;
+            }
+            if (comma == lend) break;
+            field = comma + 1;
+          }
+          if (errors[t] == nullptr && nfeature != ncol) errors[t] = p;
+          ++row;
+        }
+        p = lend == segments[t + 1] ? lend : lend + 1;
+      }
+    }
+    size_t total_missing = 0;
+    for (size_t t = 0; t < nseg; ++t) {
+      if (errors[t] != nullptr) {
+        LOG(FATAL) << "dense_csv: the line `" << std::string(errors[t], LineEnd(errors[t], end))
+                   << "` does not have " << ncol << " numeric feature columns";
+      }
+      total_missing += nmissing[t];
+    }
+    const omp_ulong nentry = static_cast<omp_ulong>(nrow * ncol);
+    if (total_missing == 0) {
+      // the same index for all the rows, only the new part is written
+      if (pattern_size_ < nentry) {
+        #pragma omp parallel for schedule(static) num_threads(nthread)
+        for (omp_ulong k = pattern_size_; k < nentry; ++k) {
+          index_[k] = static_cast<uint32_t>(k % ncol);
+        }
+        pattern_size_ = nentry;
+      }
+      #pragma omp parallel for schedule(static) num_threads(nthread)
+      for (omp_ulong i = 0; i <= nrow; ++i) offset_[i] = i * ncol;
+    } else {
+      this->Compact(row_begin, nthread);
+    }
+    block_.size = nrow;
+    block_.offset = dmlc::BeginPtr(offset_);
+    block_.label = dmlc::BeginPtr(label_);
+    block_.weight = nullptr;
+    block_.index = dmlc::BeginPtr(index_);
+    block_.value = dmlc::BeginPtr(value_);
+  }
+
+ private:
+  // leave the NaN values out of the rows of the segments
+  void Compact(const std::vector<size_t>& row_begin, int nthread) {
+    const size_t nseg = row_begin.size() - 1;
+    const size_t ncol = ncol_;
+    std::vector<size_t> seg_end(nseg);
+    #pragma omp parallel for schedule(static, 1) num_threads(nthread)
+    for (omp_ulong t = 0; t < nseg; ++t) {
+      size_t w = row_begin[t] * ncol;
+      for (size_t row = row_begin[t]; row < row_begin[t + 1]; ++row) {
+        for (size_t j = 0; j < ncol; ++j) {
+          const bst_float v = value_[row * ncol + j];
+          if (std::isnan(v)) continue;
+          value_[w] = v;
+          index_[w] = static_cast<uint32_t>(j);
+          ++w;
+        }
+        offset_[row + 1] = w;
+      }
+      seg_end[t] = w;
+    }
+    // close the gaps between the segments
+    offset_[0] = 0;
+    size_t nentry = 0;
+    for (size_t t = 0; t < nseg; ++t) {
+      const size_t seg_begin = row_begin[t] * ncol;
+      const size_t shift = seg_begin - nentry;
+      if (shift != 0) {
+        std::memmove(dmlc::BeginPtr(index_) + nentry, dmlc::BeginPtr(index_) + seg_begin,
+                     (seg_end[t] - seg_begin) * sizeof(uint32_t));
+        std::memmove(dmlc::BeginPtr(value_) + nentry, dmlc::BeginPtr(value_) + seg_begin,
+                     (seg_end[t] - seg_begin) * sizeof(bst_float));
+        for (size_t i = row_begin[t]; i < row_begin[t + 1]; ++i) {
+          offset_[i + 1] -= shift;
+        }
+      }
+      nentry += seg_end[t] - seg_begin;
+    }
+    // the index is no longer the same for all the rows
+    pattern_size_ = 0;
+  }
+
+  DenseCSVParam dense_param_;
+  /*! \brief number of feature columns */
+  size_t ncol_;
+  /*! \brief length of the start of index_ that holds the index of the dense rows */
+  size_t pattern_size_;
+};
+
+namespace {
+dmlc::Parser<uint32_t>* CreateDenseCSVParser(
+    const std::string& path, const std::map<std::string, std::string>& args,
+    unsigned part_index, unsigned num_parts) {
+  if (num_parts != 1) {
+    // the input is split by the parsers of dmlc-core in distributed mode
+    return dmlc::Parser<uint32_t>::Create(path.c_str(), part_index, num_parts, "csv");
+  }
+  return new DenseCSVParser(dmlc::SeekStream::CreateForRead(path.c_str()), args);
+}
+}  // namespace
+
+DMLC_REGISTRY_REGISTER(::dmlc::ParserFactoryReg<uint32_t>,
+                       ParserFactoryReg_uint32_t, dense_csv)
+.set_body(CreateDenseCSVParser);
+}  // namespace data
+}  // namespace xgboost
@@ -1,2 +1,3 @@
 PLUGIN_OBJS += build_plugin/dense_parser/dense_libsvm.o
+PLUGIN_OBJS += build_plugin/dense_parser/dense_csv.o
 PLUGIN_LDFLAGS +=
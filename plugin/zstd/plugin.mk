@@ -0,0 +1,2 @@
+PLUGIN_OBJS += build_plugin/zstd/sparse_page_zstd_format.o
+PLUGIN_LDFLAGS += -lzstd
@@ -0,0 +1,478 @@
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file sparse_page_zstd_format.cc
+ *  XGBoost Plugin to enable zstd compressed format on the external memory pages.
+ *  The row offsets are stored as row lengths and the indices as deltas within
+ *  each row, a dictionary trained on the first page of a file is used for the
+ *  chunks of all its pages.
+ */
+#include <xgboost/data.h>
+#include <xgboost/logging.h>
+#include <dmlc/registry.h>
+#include <dmlc/parameter.h>
+#include <dmlc/omp.h>
+#include <zstd.h>
+#include <zdict.h>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+#include "../../src/data/sparse_batch_page.h"
+
+namespace xgboost {
+namespace data {
+
+DMLC_REGISTRY_FILE_TAG(sparse_page_zstd_format);
+
+// dictionary of a file, shared by the chunks of all its pages.
+class ZstdDict {
+ public:
+  ZstdDict() : cdict_(nullptr), ddict_(nullptr) {}
+  ~ZstdDict() { this->Clear(); }
+  // the dictionary content, empty when there is none.
+  inline const std::string& content() const {
+    return content_;
+  }
+  // set the dictionary content.
+  inline void Init(const std::string& content, int level) {
+    this->Clear();
+    content_ = content;
+    if (content_.length() == 0) return;
+    cdict_ = ZSTD_createCDict(content_.data(), content_.length(), level);
+    ddict_ = ZSTD_createDDict(content_.data(), content_.length());
+    CHECK(cdict_ != nullptr && ddict_ != nullptr) << "Invalid zstd dictionary";
+  }
+  inline const ZSTD_CDict* cdict() const {
+    return cdict_;
+  }
+  inline const ZSTD_DDict* ddict() const {
+    return ddict_;
+  }
+
+ private:
+  inline void Clear() {
+    if (cdict_ != nullptr) ZSTD_freeCDict(cdict_);
+    if (ddict_ != nullptr) ZSTD_freeDDict(ddict_);
+    cdict_ = nullptr;
+    ddict_ = nullptr;
+    content_.clear();
+  }
+  std::string content_;
+  ZSTD_CDict* cdict_;
+  ZSTD_DDict* ddict_;
+};
+
+// array compressed by chunks, each chunk is encoded independently.
+template<typename DType>
+class ZstdCompressArray {
+ public:
+  // the data content.
+  std::vector<DType> data;
+  // number of chunks
+  inline int num_chunk() const {
+    CHECK_GT(raw_chunks_.size(), 1);
+    return static_cast<int>(raw_chunks_.size() - 1);
+  }
+  // the first element of chunk_id
+  inline size_t chunk_begin(int chunk_id) const {
+    return raw_chunks_[chunk_id];
+  }
+  // the end of chunk_id
+  inline size_t chunk_end(int chunk_id) const {
+    return raw_chunks_[chunk_id + 1];
+  }
+  // raw bytes
+  inline size_t RawBytes() const {
+    return raw_chunks_.back() * sizeof(DType);
+  }
+  // encoded bytes
+  inline size_t EncodedBytes() const {
+    return encoded_chunks_.back() +
+        (encoded_chunks_.size() + raw_chunks_.size()) * sizeof(bst_uint);
+  }
+  // append the raw bytes of the array to samples, cut in pieces of
+  // sample_bytes, used to train a dictionary.
+  inline void AddSamples(size_t sample_bytes, std::string* samples,
+                         std::vector<size_t>* sample_sizes) const {
+    const size_t nbytes = data.size() * sizeof(DType);
+    samples->append(reinterpret_cast<const char*>(dmlc::BeginPtr(data)), nbytes);
+    for (size_t begin = 0; begin < nbytes; begin += sample_bytes) {
+      sample_sizes->push_back(std::min(sample_bytes, nbytes - begin));
+    }
+  }
+  // load the array from file.
+  inline void Read(dmlc::SeekStream* fi);
+  // run decode on chunk_id
+  inline void Decompress(int chunk_id, const ZstdDict& dict);
+  // initialize the compression chunks
+  inline void InitCompressChunks(size_t chunk_size, size_t max_nchunk);
+  // run encode on chunk_id
+  inline void Compress(int chunk_id, int level, const ZstdDict& dict);
+  // save the output buffer into file.
+  inline void Write(dmlc::Stream* fo);
+
+ private:
+  // the chunk split of the data, by number of elements
+  std::vector<bst_uint> raw_chunks_;
+  // the encoded chunk, by number of bytes
+  std::vector<bst_uint> encoded_chunks_;
+  // output buffer of compression.
+  std::vector<std::string> out_buffer_;
+  // input buffer of data.
+  std::string in_buffer_;
+};
+
+template<typename DType>
+inline void ZstdCompressArray<DType>::Read(dmlc::SeekStream* fi) {
+  CHECK(fi->Read(&raw_chunks_));
+  CHECK(fi->Read(&encoded_chunks_));
+  CHECK_GE(raw_chunks_.size(), 2) << "Invalid zstd page";
+  size_t buffer_size = encoded_chunks_.back();
+  in_buffer_.resize(buffer_size);
+  CHECK_EQ(fi->Read(dmlc::BeginPtr(in_buffer_), buffer_size), buffer_size);
+  data.resize(raw_chunks_.back());
+}
+
+template<typename DType>
+inline void ZstdCompressArray<DType>::Decompress(int chunk_id, const ZstdDict& dict) {
+  size_t chunk_size = (raw_chunks_[chunk_id + 1] - raw_chunks_[chunk_id]) * sizeof(DType);
+  size_t encoded_size = encoded_chunks_[chunk_id + 1] - encoded_chunks_[chunk_id];
+  if (chunk_size == 0) return;
+  const char* src = dmlc::BeginPtr(in_buffer_) + encoded_chunks_[chunk_id];
+  char* dst = reinterpret_cast<char*>(dmlc::BeginPtr(data) + raw_chunks_[chunk_id]);
+  ZSTD_DCtx* ctx = ZSTD_createDCtx();
+  size_t size;
+  if (dict.ddict() != nullptr) {
+    size = ZSTD_decompress_usingDDict(ctx, dst, chunk_size, src, encoded_size, dict.ddict());
+  } else {
+    size = ZSTD_decompressDCtx(ctx, dst, chunk_size, src, encoded_size);
+  }
+  ZSTD_freeDCtx(ctx);
+  CHECK(!ZSTD_isError(size)) << "zstd decode error: " << ZSTD_getErrorName(size);
+  CHECK_EQ(size, chunk_size);
+}
+
+template<typename DType>
+inline void ZstdCompressArray<DType>::InitCompressChunks(size_t chunk_size, size_t max_nchunk) {
+  raw_chunks_.clear();
+  raw_chunks_.push_back(0);
+  size_t min_chunk_size = data.size() / max_nchunk;
+  chunk_size = std::max(min_chunk_size, chunk_size);
+  size_t nstep = data.size() / chunk_size;
+  for (size_t i = 0; i < nstep; ++i) {
+    raw_chunks_.push_back(raw_chunks_.back() + chunk_size);
+    CHECK_LE(raw_chunks_.back(), data.size());
+  }
+  if (nstep == 0) raw_chunks_.push_back(0);
+  raw_chunks_.back() = data.size();
+  CHECK_GE(raw_chunks_.size(), 2);
+  out_buffer_.resize(raw_chunks_.size() - 1);
+}
+
+template<typename DType>
+inline void ZstdCompressArray<DType>::Compress(int chunk_id, int level, const ZstdDict& dict) {
+  CHECK_LT(static_cast<size_t>(chunk_id + 1), raw_chunks_.size());
+  std::string& buf = out_buffer_[chunk_id];
+  size_t raw_chunk_size = (raw_chunks_[chunk_id + 1] - raw_chunks_[chunk_id]) * sizeof(DType);
+  if (raw_chunk_size == 0) {
+    buf.clear();
+    return;
+  }
+  buf.resize(ZSTD_compressBound(raw_chunk_size));
+  const char* src = reinterpret_cast<const char*>(dmlc::BeginPtr(data) + raw_chunks_[chunk_id]);
+  ZSTD_CCtx* ctx = ZSTD_createCCtx();
+  size_t encoded_size;
+  if (dict.cdict() != nullptr) {
+    encoded_size = ZSTD_compress_usingCDict(
+        ctx, dmlc::BeginPtr(buf), buf.length(), src, raw_chunk_size, dict.cdict());
+  } else {
+    encoded_size = ZSTD_compressCCtx(
+        ctx, dmlc::BeginPtr(buf), buf.length(), src, raw_chunk_size, level);
+  }
+  ZSTD_freeCCtx(ctx);
+  CHECK(!ZSTD_isError(encoded_size)) << "zstd encode error: " << ZSTD_getErrorName(encoded_size);
+  buf.resize(encoded_size);
+}
+
+template<typename DType>
+inline void ZstdCompressArray<DType>::Write(dmlc::Stream* fo) {
+  encoded_chunks_.clear();
+  encoded_chunks_.push_back(0);
+  for (size_t i = 0; i < out_buffer_.size(); ++i) {
+    encoded_chunks_.push_back(encoded_chunks_.back() + out_buffer_[i].length());
+  }
+  fo->Write(raw_chunks_);
+  fo->Write(encoded_chunks_);
+  for (const std::string& buf : out_buffer_) {
+    fo->Write(dmlc::BeginPtr(buf), buf.length());
+  }
+}
+
+class SparsePageZstdFormat : public SparsePage::Format {
+ public:
+  SparsePageZstdFormat() : has_dict_(false) {
+    raw_bytes_ = raw_bytes_value_ = raw_bytes_index_ = 0;
+    encoded_bytes_ = encoded_bytes_value_ = encoded_bytes_index_ = 0;
+    level_ = dmlc::GetEnv("XGBOOST_ZSTD_LEVEL", 3);
+    dict_capacity_ = dmlc::GetEnv("XGBOOST_ZSTD_DICT_SIZE", kDictCapacity);
+    nthread_ = dmlc::GetEnv("XGBOOST_ZSTD_DECODE_NTHREAD", 4);
+    nthread_write_ = dmlc::GetEnv("XGBOOST_ZSTD_COMPRESS_NTHREAD", 12);
+  }
+  virtual ~SparsePageZstdFormat() {
+    size_t encoded_bytes = encoded_bytes_ + encoded_bytes_value_ + encoded_bytes_index_;
+    raw_bytes_ += raw_bytes_value_ + raw_bytes_index_;
+    if (raw_bytes_ != 0) {
+      LOG(CONSOLE) << "raw_bytes=" << raw_bytes_
+                   << ", encoded_bytes=" << encoded_bytes
+                   << ", ratio=" << double(encoded_bytes) / raw_bytes_
+                   << ", ratio-index=" << double(encoded_bytes_index_) /raw_bytes_index_
+                   << ", ratio-value=" << double(encoded_bytes_value_) /raw_bytes_value_;
+    }
+  }
+
+  bool Read(SparsePage* page, dmlc::SeekStream* fi) override {
+    if (!this->LoadPage(fi, &(page->offset))) return false;
+    page->data.resize(page->offset.back());
+    CHECK_EQ(index_.data.size(), page->data.size());
+    const bst_omp_uint ndata = static_cast<bst_omp_uint>(page->data.size());
+    #pragma omp parallel for schedule(static) num_threads(nthread_)
+    for (bst_omp_uint i = 0; i < ndata; ++i) {
+      page->data[i] = SparseBatch::Entry(index_.data[i] + min_index_, value_.data[i]);
+    }
+    return true;
+  }
+
+  bool Read(SparsePage* page,
+            dmlc::SeekStream* fi,
+            const std::vector<bst_uint>& sorted_index_set) override {
+    if (!this->LoadPage(fi, &disk_offset_)) return false;
+
+    page->offset.clear();
+    page->offset.push_back(0);
+    for (bst_uint cid : sorted_index_set) {
+      page->offset.push_back(
+          page->offset.back() + disk_offset_[cid + 1] - disk_offset_[cid]);
+    }
+    page->data.resize(page->offset.back());
+    CHECK_EQ(index_.data.size(), disk_offset_.back());
+
+    const bst_omp_uint nindex = static_cast<bst_omp_uint>(sorted_index_set.size());
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(nthread_)
+    for (bst_omp_uint i = 0; i < nindex; ++i) {
+      bst_uint cid = sorted_index_set[i];
+      size_t dst_begin = page->offset[i];
+      size_t src_begin = disk_offset_[cid];
+      size_t num = disk_offset_[cid + 1] - disk_offset_[cid];
+      for (size_t j = 0; j < num; ++j) {
+        page->data[dst_begin + j] = SparseBatch::Entry(
+            index_.data[src_begin + j] + min_index_, value_.data[src_begin + j]);
+      }
+    }
+    return true;
+  }
+
+  void Write(const SparsePage& page, dmlc::Stream* fo) override {
+    CHECK(page.offset.size() != 0 && page.offset[0] == 0);
+    CHECK_EQ(page.offset.back(), page.data.size());
+    min_index_ = page.min_index;
+    const size_t nrow = page.offset.size() - 1;
+    length_.data.resize(nrow);
+    index_.data.resize(page.data.size());
+    value_.data.resize(page.data.size());
+    for (size_t i = 0; i < nrow; ++i) {
+      size_t len = page.offset[i + 1] - page.offset[i];
+      CHECK_LE(len, static_cast<size_t>(std::numeric_limits<bst_uint>::max()))
+          << "The zstd page format limits the length of a row to "
+          << std::numeric_limits<bst_uint>::max();
+      length_.data[i] = static_cast<bst_uint>(len);
+    }
+    for (size_t i = 0; i < page.data.size(); ++i) {
+      value_.data[i] = page.data[i].fvalue;
+    }
+
+    length_.InitCompressChunks(kChunkSize, kMaxChunk);
+    index_.InitCompressChunks(kChunkSize, kMaxChunk);
+    value_.InitCompressChunks(kChunkSize, kMaxChunk);
+    this->EncodeDelta(page);
+
+    // the first page of the file carries the dictionary.
+    std::string dict_content;
+    if (!has_dict_) {
+      dict_content = this->TrainDict();
+      dict_.Init(dict_content, level_);
+      has_dict_ = true;
+    }
+    uint64_t dict_size = dict_content.length();
+    fo->Write(&dict_size, sizeof(dict_size));
+    if (dict_size != 0) fo->Write(dmlc::BeginPtr(dict_content), dict_size);
+    fo->Write(&min_index_, sizeof(min_index_));
+
+    int nlength = length_.num_chunk();
+    int nindex = index_.num_chunk();
+    int nvalue = value_.num_chunk();
+    int ntotal = nlength + nindex + nvalue;
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(nthread_write_)
+    for (int i = 0; i < ntotal; ++i) {
+      if (i < nlength) {
+        length_.Compress(i, level_, dict_);
+      } else if (i < nlength + nindex) {
+        index_.Compress(i - nlength, level_, dict_);
+      } else {
+        value_.Compress(i - nlength - nindex, level_, dict_);
+      }
+    }
+    length_.Write(fo);
+    index_.Write(fo);
+    value_.Write(fo);
+    // statistics
+    raw_bytes_index_ += index_.RawBytes();
+    raw_bytes_value_ += value_.RawBytes();
+    encoded_bytes_index_ += index_.EncodedBytes();
+    encoded_bytes_value_ += value_.EncodedBytes();
+    raw_bytes_ += page.offset.size() * sizeof(size_t);
+    encoded_bytes_ += length_.EncodedBytes() + dict_size + sizeof(dict_size);
+  }
+
+ private:
+  // read one page, and decode the offset into offset.
+  inline bool LoadPage(dmlc::SeekStream* fi, std::vector<size_t>* offset) {
+    uint64_t dict_size;
+    if (fi->Read(&dict_size, sizeof(dict_size)) == 0) return false;
+    if (dict_size != 0) {
+      std::string dict_content;
+      dict_content.resize(dict_size);
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(dict_content), dict_size), dict_size)
+          << "Invalid zstd page";
+      dict_.Init(dict_content, level_);
+    }
+    CHECK_EQ(fi->Read(&min_index_, sizeof(min_index_)), sizeof(min_index_))
+        << "Invalid zstd page";
+    length_.Read(fi);
+    index_.Read(fi);
+    value_.Read(fi);
+
+    int nlength = length_.num_chunk();
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(nthread_)
+    for (int i = 0; i < nlength; ++i) {
+      length_.Decompress(i, dict_);
+    }
+    offset->resize(length_.data.size() + 1);
+    (*offset)[0] = 0;
+    for (size_t i = 0; i < length_.data.size(); ++i) {
+      (*offset)[i + 1] = (*offset)[i] + length_.data[i];
+    }
+    CHECK_EQ(offset->back(), index_.data.size()) << "Invalid zstd page";
+    CHECK_EQ(index_.data.size(), value_.data.size()) << "Invalid zstd page";
+
+    int nindex = index_.num_chunk();
+    int nvalue = value_.num_chunk();
+    int ntotal = nindex + nvalue;
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(nthread_)
+    for (int i = 0; i < ntotal; ++i) {
+      if (i < nindex) {
+        index_.Decompress(i, dict_);
+        this->DecodeDelta(*offset, i);
+      } else {
+        value_.Decompress(i - nindex, dict_);
+      }
+    }
+    return true;
+  }
+  // store the indices of page as their difference to the previous index of
+  // the row, the first index of a row or of a chunk is kept as it is.
+  inline void EncodeDelta(const SparsePage& page) {
+    const int nchunk = index_.num_chunk();
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(nthread_write_)
+    for (int c = 0; c < nchunk; ++c) {
+      const size_t begin = index_.chunk_begin(c), end = index_.chunk_end(c);
+      if (begin == end) continue;
+      size_t r = std::upper_bound(page.offset.begin(), page.offset.end(), begin) -
+          page.offset.begin() - 1;
+      index_.data[begin] = page.data[begin].index - min_index_;
+      for (size_t i = begin + 1; i < end; ++i) {
+        while (page.offset[r + 1] <= i) ++r;
+        index_.data[i] = page.data[i].index - min_index_;
+        if (i != page.offset[r]) index_.data[i] -= page.data[i - 1].index - min_index_;
+      }
+    }
+  }
+  // invert EncodeDelta on one chunk.
+  inline void DecodeDelta(const std::vector<size_t>& offset, int chunk_id) {
+    const size_t begin = index_.chunk_begin(chunk_id), end = index_.chunk_end(chunk_id);
+    if (begin == end) return;
+    size_t r = std::upper_bound(offset.begin(), offset.end(), begin) - offset.begin() - 1;
+    for (size_t i = begin + 1; i < end; ++i) {
+      while (offset[r + 1] <= i) ++r;
+      if (i != offset[r]) index_.data[i] += index_.data[i - 1];
+    }
+  }
+  // train a dictionary on the chunks of the current page, empty on failure.
+  inline std::string TrainDict() const {
+    std::string samples;
+    std::vector<size_t> sample_sizes;
+    length_.AddSamples(kSampleBytes, &samples, &sample_sizes);
+    index_.AddSamples(kSampleBytes, &samples, &sample_sizes);
+    value_.AddSamples(kSampleBytes, &samples, &sample_sizes);
+    // too few samples to train a useful dictionary.
+    if (dict_capacity_ == 0 || sample_sizes.size() < kMinSamples) return std::string();
+    std::string dict_content;
+    dict_content.resize(dict_capacity_);
+    size_t size = ZDICT_trainFromBuffer(
+        dmlc::BeginPtr(dict_content), dict_content.length(),
+        samples.data(), dmlc::BeginPtr(sample_sizes),
+        static_cast<unsigned>(sample_sizes.size()));
+    if (ZDICT_isError(size)) {
+      LOG(INFO) << "zstd dictionary training failed: " << ZDICT_getErrorName(size)
+                << ", the pages are compressed without dictionary";
+      return std::string();
+    }
+    dict_content.resize(size);
+    return dict_content;
+  }
+
+  // default chunk size, in number of elements.
+  static const size_t kChunkSize = 64 << 10UL;
+  // maximum number of chunks.
+  static const size_t kMaxChunk = 128;
+  // default capacity of the dictionary, in bytes.
+  static const size_t kDictCapacity = 64 << 10UL;
+  // size of the samples the dictionary is trained on, in bytes.
+  static const size_t kSampleBytes = 4 << 10UL;
+  // minimum number of samples to train a dictionary on.
+  static const size_t kMinSamples = 64;
+  // compression level
+  int level_;
+  // capacity of the dictionary
+  size_t dict_capacity_;
+  // number of threads
+  int nthread_;
+  // number of writing threads
+  int nthread_write_;
+  // whether the dictionary of the file is written
+  bool has_dict_;
+  // the dictionary of the file
+  ZstdDict dict_;
+  // raw bytes
+  size_t raw_bytes_, raw_bytes_index_, raw_bytes_value_;
+  // encoded bytes
+  size_t encoded_bytes_, encoded_bytes_index_, encoded_bytes_value_;
+  /*! \brief minimum index value */
+  uint32_t min_index_;
+  /*! \brief external memory column offset */
+  std::vector<size_t> disk_offset_;
+  // row lengths
+  ZstdCompressArray<bst_uint> length_;
+  // internal index, delta encoded within rows
+  ZstdCompressArray<bst_uint> index_;
+  // value set.
+  ZstdCompressArray<bst_float> value_;
+};
+
+XGBOOST_REGISTER_SPARSE_PAGE_FORMAT(zstd)
+.describe("Apply zstd binary data compression with a trained dictionary for ext memory.")
+.set_body([]() {
+    return new SparsePageZstdFormat();
+  });
+
+}  // namespace data
+}  // namespace xgboost
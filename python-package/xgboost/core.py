@@ -169,6 +169,10 @@ PANDAS_DTYPE_MAPPER = {'int8': 'int', 'int16': 'int', 'int32': 'int', 'int64': '
                        'float16': 'float', 'float32': 'float', 'float64': 'float',
                        'bool': 'i'}
 
+# numpy types read in place by XGDMatrixCreateFromStridedMat, with the DataType of each
+_NUMPY_DATA_TYPES = {np.float32: 1, np.float64: 2, np.uint32: 3, np.uint64: 4,
+                     np.int32: 5, np.int64: 6}
+
 
 def _maybe_pandas_data(data, feature_names, feature_types):
     """ Extract internal data from pd.DataFrame for DMatrix data """
@@ -271,15 +275,15 @@ class DMatrix(object):
                                                      ctypes.c_int(silent),
                                                      ctypes.byref(self.handle)))
         elif isinstance(data, scipy.sparse.csr_matrix):
-            self._init_from_csr(data)
+            self._init_from_csr(data, nthread)
         elif isinstance(data, scipy.sparse.csc_matrix):
-            self._init_from_csc(data)
+            self._init_from_csc(data, nthread)
         elif isinstance(data, np.ndarray):
             self._init_from_npy2d(data, missing, nthread)
         else:
             try:
                 csr = scipy.sparse.csr_matrix(data)
-                self._init_from_csr(csr)
+                self._init_from_csr(csr, nthread)
             except:
                 raise TypeError('can not initialize DMatrix from {}'.format(type(data).__name__))
         if label is not None:
@@ -296,71 +300,68 @@ class DMatrix(object):
         self.feature_names = feature_names
         self.feature_types = feature_types
 
-    def _init_from_csr(self, csr):
+    def _init_from_csr(self, csr, nthread=None):
         """
         Initialize data from a CSR matrix.
         """
         if len(csr.indices) != len(csr.data):
             raise ValueError('length mismatch: {} vs {}'.format(len(csr.indices), len(csr.data)))
         self.handle = ctypes.c_void_p()
-        _check_call(_LIB.XGDMatrixCreateFromCSREx(c_array(ctypes.c_size_t, csr.indptr),
-                                                  c_array(ctypes.c_uint, csr.indices),
-                                                  c_array(ctypes.c_float, csr.data),
-                                                  ctypes.c_size_t(len(csr.indptr)),
-                                                  ctypes.c_size_t(len(csr.data)),
-                                                  ctypes.c_size_t(csr.shape[1]),
-                                                  ctypes.byref(self.handle)))
-
-    def _init_from_csc(self, csc):
+        if nthread is None:
+            nthread = 0
+        _check_call(_LIB.XGDMatrixCreateFromCSREx_omp(c_array(ctypes.c_size_t, csr.indptr),
+                                                      c_array(ctypes.c_uint, csr.indices),
+                                                      c_array(ctypes.c_float, csr.data),
+                                                      ctypes.c_size_t(len(csr.indptr)),
+                                                      ctypes.c_size_t(len(csr.data)),
+                                                      ctypes.c_size_t(csr.shape[1]),
+                                                      ctypes.byref(self.handle),
+                                                      ctypes.c_int(nthread)))
+
+    def _init_from_csc(self, csc, nthread=None):
         """
         Initialize data from a CSC matrix.
         """
         if len(csc.indices) != len(csc.data):
             raise ValueError('length mismatch: {} vs {}'.format(len(csc.indices), len(csc.data)))
         self.handle = ctypes.c_void_p()
-        _check_call(_LIB.XGDMatrixCreateFromCSCEx(c_array(ctypes.c_size_t, csc.indptr),
-                                                  c_array(ctypes.c_uint, csc.indices),
-                                                  c_array(ctypes.c_float, csc.data),
-                                                  ctypes.c_size_t(len(csc.indptr)),
-                                                  ctypes.c_size_t(len(csc.data)),
-                                                  ctypes.c_size_t(csc.shape[0]),
-                                                  ctypes.byref(self.handle)))
+        if nthread is None:
+            nthread = 0
+        _check_call(_LIB.XGDMatrixCreateFromCSCEx_omp(c_array(ctypes.c_size_t, csc.indptr),
+                                                      c_array(ctypes.c_uint, csc.indices),
+                                                      c_array(ctypes.c_float, csc.data),
+                                                      ctypes.c_size_t(len(csc.indptr)),
+                                                      ctypes.c_size_t(len(csc.data)),
+                                                      ctypes.c_size_t(csc.shape[0]),
+                                                      ctypes.byref(self.handle),
+                                                      ctypes.c_int(nthread)))
 
     def _init_from_npy2d(self, mat, missing, nthread):
         """
         Initialize data from a 2-D numpy matrix.
 
-        If ``mat`` does not have ``order='C'`` (aka row-major) or is not contiguous,
-        a temporary copy will be made.
-
-        If ``mat`` does not have ``dtype=numpy.float32``, a temporary copy will be made.
-
-        So there could be as many as two temporary data copies; be mindful of input layout
-        and type if memory use is a concern.
+        Matrices of float32, float64, int32, int64, uint32 and uint64 values are read
+        in place, whatever their layout, and converted while the rows are built.
+        Other types are first copied to a float32 array.
         """
         if len(mat.shape) != 2:
             raise ValueError('Input numpy.ndarray must be 2 dimensional')
-        # flatten the array by rows and ensure it is float32.
-        # we try to avoid data copies if possible (reshape returns a view when possible
-        # and we explicitly tell np.array to try and avoid copying)
-        data = np.array(mat.reshape(mat.size), copy=False, dtype=np.float32)
+        data_type = _NUMPY_DATA_TYPES.get(mat.dtype.type)
+        if data_type is None:
+            mat = np.array(mat, copy=False, dtype=np.float32)
+            data_type = _NUMPY_DATA_TYPES[np.float32]
         self.handle = ctypes.c_void_p()
         missing = missing if missing is not None else np.nan
-        if nthread is None:
-            _check_call(_LIB.XGDMatrixCreateFromMat(
-                data.ctypes.data_as(ctypes.POINTER(ctypes.c_float)),
-                c_bst_ulong(mat.shape[0]),
-                c_bst_ulong(mat.shape[1]),
-                ctypes.c_float(missing),
-                ctypes.byref(self.handle)))
-        else:
-            _check_call(_LIB.XGDMatrixCreateFromMat_omp(
-                data.ctypes.data_as(ctypes.POINTER(ctypes.c_float)),
-                c_bst_ulong(mat.shape[0]),
-                c_bst_ulong(mat.shape[1]),
-                ctypes.c_float(missing),
-                ctypes.byref(self.handle),
-                nthread))
+        _check_call(_LIB.XGDMatrixCreateFromStridedMat(
+            mat.ctypes.data_as(ctypes.c_void_p),
+            ctypes.c_int(data_type),
+            c_bst_ulong(mat.shape[0]),
+            c_bst_ulong(mat.shape[1]),
+            ctypes.c_int64(mat.strides[0]),
+            ctypes.c_int64(mat.strides[1]),
+            ctypes.c_float(missing),
+            ctypes.c_int(nthread if nthread is not None else 0),
+            ctypes.byref(self.handle)))
 
     def __del__(self):
         if self.handle is not None:
@@ -475,6 +476,23 @@ class DMatrix(object):
                                              c_str(fname),
                                              ctypes.c_int(silent)))
 
+    def save_sectioned(self, fname, compress=True):
+        """Save DMatrix in the sectioned binary format.
+
+        The sections of the file are read in parallel when it is loaded,
+        from a local file or any other URI supporting seek.
+
+        Parameters
+        ----------
+        fname : string
+            Name of the output file.
+        compress : bool (optional; default: True)
+            Whether to delta code the row and group pointers.
+        """
+        _check_call(_LIB.XGDMatrixSaveSectioned(self.handle,
+                                                c_str(fname),
+                                                ctypes.c_int(compress)))
+
     def set_label(self, label):
         """Set label of dmatrix
 
@@ -617,6 +635,19 @@ class DMatrix(object):
                                                ctypes.byref(res.handle)))
         return res
 
+    def append(self, other):
+        """Append the rows and the information of other to this DMatrix.
+
+        The column access and the histogram bins already built for this
+        DMatrix are updated with the new rows instead of being built again.
+
+        Parameters
+        ----------
+        other : DMatrix
+            The DMatrix holding the rows to be appended.
+        """
+        _check_call(_LIB.XGDMatrixAppend(self.handle, other.handle))
+
     @property
     def feature_names(self):
         """Get feature names (column labels).
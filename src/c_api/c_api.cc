@@ -2,21 +2,35 @@
 
 #include <xgboost/data.h>
 #include <xgboost/learner.h>
+#include <xgboost/predictor.h>
 #include <xgboost/c_api.h>
 #include <xgboost/logging.h>
 #include <dmlc/thread_local.h>
 #include <rabit/rabit.h>
+#include <condition_variable>
 #include <cstdio>
+#include <functional>
 #include <vector>
 #include <string>
 #include <cstring>
 #include <memory>
+#include <mutex>
 
 #include "./c_api_error.h"
 #include "../data/simple_csr_source.h"
+#if !XGBOOST_PREDICT_ONLY
+#include "../data/buffer_source.h"
+#include "../data/columnar_source.h"
+#include "../data/slice_source.h"
+#include "../data/quantized_source.h"
+#include "../data/parser_source.h"
+#endif  // !XGBOOST_PREDICT_ONLY
 #include "../common/math.h"
 #include "../common/io.h"
 #include "../common/group_data.h"
+#include "../common/memory_tracker.h"
+#include "../common/task_queue.h"
+#include "../common/timer.h"
 
 namespace xgboost {
 // booster wrapper for backward compatible reason.
@@ -26,6 +40,9 @@ class Booster {
       : configured_(false),
         initialized_(false),
         learner_(Learner::Create(cache_mats)) {}
+  // a booster over a learner made from another one
+  Booster(Learner* learner, const std::vector<std::pair<std::string, std::string> >& cfg)
+      : configured_(false), initialized_(true), learner_(learner), cfg_(cfg) {}
 
   inline Learner* learner() {
     return learner_.get();
@@ -70,8 +87,12 @@ class Booster {
   bool initialized_;
   std::unique_ptr<Learner> learner_;
   std::vector<std::pair<std::string, std::string> > cfg_;
+  // asynchronous operations, the last member so that they are done
+  // before the learner is destroyed
+  common::TaskQueue tasks_;
 };
 
+#if !XGBOOST_PREDICT_ONLY
 // declare the data callback.
 XGB_EXTERN_C int XGBoostNativeDataIterSetData(
     void *handle, XGBoostBatchCSR batch);
@@ -80,13 +101,20 @@ XGB_EXTERN_C int XGBoostNativeDataIterSetData(
 class NativeDataIter : public dmlc::Parser<uint32_t> {
  public:
   NativeDataIter(DataIterHandle data_handle,
-                 XGBCallbackDataIterNext* next_callback)
+                 XGBCallbackDataIterNext* next_callback,
+                 XGBCallbackDataIterReset* reset_callback = nullptr)
       :  at_first_(true), bytes_read_(0),
-         data_handle_(data_handle), next_callback_(next_callback) {
+         data_handle_(data_handle), next_callback_(next_callback),
+         reset_callback_(reset_callback) {
   }
 
   // override functions
   void BeforeFirst() override {
+    if (reset_callback_ != nullptr) {
+      (*reset_callback_)(data_handle_);
+      at_first_ = true;
+      return;
+    }
     CHECK(at_first_) << "cannot reset NativeDataIter";
   }
 
@@ -158,6 +186,8 @@ class NativeDataIter : public dmlc::Parser<uint32_t> {
   DataIterHandle data_handle_;
   // call back to get the data.
   XGBCallbackDataIterNext* next_callback_;
+  // call back to rewind the data, can be null.
+  XGBCallbackDataIterReset* reset_callback_;
   // internal offset
   std::vector<size_t> offset_;
   // internal label data
@@ -178,6 +208,7 @@ int XGBoostNativeDataIterSetData(
   static_cast<xgboost::NativeDataIter*>(handle)->SetData(batch);
   API_END();
 }
+#endif  // !XGBOOST_PREDICT_ONLY
 }  // namespace xgboost
 
 using namespace xgboost; // NOLINT(*);
@@ -192,13 +223,53 @@ struct XGBAPIThreadLocalEntry {
   std::vector<const char *> ret_vec_charp;
   /*! \brief returning float vector. */
   HostDeviceVector<bst_float> ret_vec_float;
+  /*! \brief returning predictions of several boosters. */
+  std::vector<bst_float> ret_vec_multi;
+  /*! \brief returning leaf indices, of uint16_t or uint32_t. */
+  std::vector<char> ret_vec_leaf;
   /*! \brief temp variable of gradient pairs. */
   HostDeviceVector<bst_gpair> tmp_gpair;
+  /*! \brief temp entries of a single row to be predicted. */
+  std::vector<RowBatch::Entry> tmp_row;
+  /*! \brief temp predictions of a single row. */
+  HostDeviceVector<bst_float> tmp_row_preds;
+  /*! \brief scratch space of single row prediction. */
+  PredictionContext row_ctx;
+};
+
+/*! \brief prediction context handed out through the C API. */
+struct PredictionContextEntry {
+  /*! \brief scratch space of the prediction */
+  PredictionContext ctx;
+  /*! \brief result holder of the last prediction */
+  HostDeviceVector<bst_float> preds;
+};
+
+/*! \brief state and result of an asynchronous operation */
+struct AsyncEntry {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool done{false};
+  int status{0};
+  /*! \brief error message of the failed operation */
+  std::string error;
+  /*! \brief result of a prediction */
+  HostDeviceVector<bst_float> preds;
+  /*! \brief result of an evaluation */
+  std::string eval;
+  /*! \brief waits for the operation, returns its status */
+  inline int Wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]() { return done; });
+    if (status != 0) XGBAPISetLastError(error.c_str());
+    return status;
+  }
 };
 
 // define the threadlocal store.
 typedef dmlc::ThreadLocalStore<XGBAPIThreadLocalEntry> XGBAPIThreadLocalStore;
 
+#if !XGBOOST_PREDICT_ONLY
 int XGDMatrixCreateFromFile(const char *fname,
                             int silent,
                             DMatrixHandle *out) {
@@ -227,45 +298,135 @@ int XGDMatrixCreateFromDataIter(
   API_END();
 }
 
-XGB_DLL int XGDMatrixCreateFromCSREx(const size_t* indptr,
-                                     const unsigned* indices,
-                                     const bst_float* data,
-                                     size_t nindptr,
-                                     size_t nelem,
-                                     size_t num_col,
-                                     DMatrixHandle* out) {
+int XGDMatrixCreateStreamingFromDataIter(
+    DataIterHandle data_handle,
+    XGBCallbackDataIterNext* callback,
+    XGBCallbackDataIterReset* reset,
+    DMatrixHandle *out) {
+  API_BEGIN();
+  CHECK(reset != nullptr) << "the data is read on every pass, it needs a reset callback";
+  std::unique_ptr<dmlc::Parser<uint32_t> > parser(
+      new NativeDataIter(data_handle, callback, reset));
+  std::unique_ptr<data::ParserSource> source(new data::ParserSource(std::move(parser)));
+  *out = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
+  API_END();
+}
+
+int XGDMatrixCreateQuantizedFromDataIter(
+    DataIterHandle data_handle,
+    XGBCallbackDataIterNext* callback,
+    XGBCallbackDataIterReset* reset,
+    int max_bin,
+    DMatrixHandle *out) {
+  API_BEGIN();
+  CHECK(reset != nullptr) << "the data is read twice, it needs a reset callback";
+  CHECK_GT(max_bin, 0) << "max_bin must be positive";
+  NativeDataIter parser(data_handle, callback, reset);
+  std::unique_ptr<data::QuantizedSource> source(
+      new data::QuantizedSource(&parser, static_cast<uint32_t>(max_bin)));
+  *out = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
+  API_END();
+}
+#endif  // !XGBOOST_PREDICT_ONLY
+
+void prefixsum_inplace(size_t *x, size_t N) {
+  size_t *suma;
+#pragma omp parallel
+  {
+    const int ithread = omp_get_thread_num();
+    const int nthreads = omp_get_num_threads();
+#pragma omp single
+    {
+      suma = new size_t[nthreads+1];
+      suma[0] = 0;
+    }
+    size_t sum = 0;
+    size_t offset = 0;
+#pragma omp for schedule(static)
+    for (omp_ulong i = 0; i < N; i++) {
+      sum += x[i];
+      x[i] = sum;
+    }
+    suma[ithread+1] = sum;
+#pragma omp barrier
+    for (omp_ulong i = 0; i < static_cast<omp_ulong>(ithread+1); i++) {
+      offset += suma[i];
+    }
+#pragma omp for schedule(static)
+    for (omp_ulong i = 0; i < N; i++) {
+      x[i] += offset;
+    }
+  }
+  delete[] suma;
+}
+
+XGB_DLL int XGDMatrixCreateFromCSREx_omp(const size_t* indptr,
+                                         const unsigned* indices,
+                                         const bst_float* data,
+                                         size_t nindptr,
+                                         size_t nelem,
+                                         size_t num_col,
+                                         DMatrixHandle* out,
+                                         int nthread) {
   std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
 
   API_BEGIN();
+  CHECK_GE(nindptr, 1U) << "empty row pointer";
+  if (nthread <= 0) nthread = omp_get_max_threads();
   data::SimpleCSRSource& mat = *source;
-  mat.row_ptr_.reserve(nindptr);
-  mat.row_data_.reserve(nelem);
-  mat.row_ptr_.resize(1);
+  const omp_ulong nrow = static_cast<omp_ulong>(nindptr - 1);
+  mat.row_ptr_.resize(nindptr);
   mat.row_ptr_[0] = 0;
-  size_t num_column = 0;
-  for (size_t i = 1; i < nindptr; ++i) {
-    for (size_t j = indptr[i - 1]; j < indptr[i]; ++j) {
+  // count the entries of each row, then find the rows by a prefix sum
+  std::vector<size_t> max_columns(nthread, 0);
+  #pragma omp parallel for schedule(static) num_threads(nthread)
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    size_t& max_column = max_columns[omp_get_thread_num()];
+    size_t length = 0;
+    for (size_t j = indptr[i]; j < indptr[i + 1]; ++j) {
       if (!common::CheckNAN(data[j])) {
         // automatically skip nan.
-        mat.row_data_.emplace_back(RowBatch::Entry(indices[j], data[j]));
-        num_column = std::max(num_column, static_cast<size_t>(indices[j] + 1));
+        ++length;
+        max_column = std::max(max_column, static_cast<size_t>(indices[j] + 1));
+      }
+    }
+    mat.row_ptr_[i + 1] = length;
+  }
+  prefixsum_inplace(dmlc::BeginPtr(mat.row_ptr_) + 1, nrow);
+  mat.row_data_.resize(mat.row_ptr_.back());
+  #pragma omp parallel for schedule(static) num_threads(nthread)
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    size_t pos = mat.row_ptr_[i];
+    for (size_t j = indptr[i]; j < indptr[i + 1]; ++j) {
+      if (!common::CheckNAN(data[j])) {
+        mat.row_data_[pos++] = RowBatch::Entry(indices[j], data[j]);
       }
     }
-    mat.row_ptr_.push_back(mat.row_data_.size());
   }
 
-  mat.info.num_col = num_column;
+  mat.info.num_col = *std::max_element(max_columns.begin(), max_columns.end());
   if (num_col > 0) {
     CHECK_LE(mat.info.num_col, num_col)
         << "num_col=" << num_col << " vs " << mat.info.num_col;
     mat.info.num_col = num_col;
   }
-  mat.info.num_row = nindptr - 1;
+  mat.info.num_row = nrow;
   mat.info.num_nonzero = mat.row_data_.size();
   *out = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
   API_END();
 }
 
+XGB_DLL int XGDMatrixCreateFromCSREx(const size_t* indptr,
+                                     const unsigned* indices,
+                                     const bst_float* data,
+                                     size_t nindptr,
+                                     size_t nelem,
+                                     size_t num_col,
+                                     DMatrixHandle* out) {
+  return XGDMatrixCreateFromCSREx_omp(indptr, indices, data, nindptr, nelem,
+                                      num_col, out, 0);
+}
+
 XGB_DLL int XGDMatrixCreateFromCSR(const xgboost::bst_ulong* indptr,
                                    const unsigned *indices,
                                    const bst_float* data,
@@ -280,23 +441,23 @@ XGB_DLL int XGDMatrixCreateFromCSR(const xgboost::bst_ulong* indptr,
     static_cast<size_t>(nindptr), static_cast<size_t>(nelem), 0, out);
 }
 
-XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
-                                     const unsigned* indices,
-                                     const bst_float* data,
-                                     size_t nindptr,
-                                     size_t nelem,
-                                     size_t num_row,
-                                     DMatrixHandle* out) {
+XGB_DLL int XGDMatrixCreateFromCSCEx_omp(const size_t* col_ptr,
+                                         const unsigned* indices,
+                                         const bst_float* data,
+                                         size_t nindptr,
+                                         size_t nelem,
+                                         size_t num_row,
+                                         DMatrixHandle* out,
+                                         int nthread) {
   std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
 
   API_BEGIN();
-  // FIXME: User should be able to control number of threads
-  const int nthread = omp_get_max_threads();
+  if (nthread <= 0) nthread = omp_get_max_threads();
   data::SimpleCSRSource& mat = *source;
   common::ParallelGroupBuilder<RowBatch::Entry> builder(&mat.row_ptr_, &mat.row_data_);
   builder.InitBudget(0, nthread);
   size_t ncol = nindptr - 1;  // NOLINT(*)
-  #pragma omp parallel for schedule(static)
+  #pragma omp parallel for schedule(static) num_threads(nthread)
   for (omp_ulong i = 0; i < static_cast<omp_ulong>(ncol); ++i) {  // NOLINT(*)
     int tid = omp_get_thread_num();
     for (size_t j = col_ptr[i]; j < col_ptr[i+1]; ++j) {
@@ -306,7 +467,7 @@ XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
     }
   }
   builder.InitStorage();
-  #pragma omp parallel for schedule(static)
+  #pragma omp parallel for schedule(static) num_threads(nthread)
   for (omp_ulong i = 0; i < static_cast<omp_ulong>(ncol); ++i) {  // NOLINT(*)
     int tid = omp_get_thread_num();
     for (size_t j = col_ptr[i]; j < col_ptr[i+1]; ++j) {
@@ -323,11 +484,22 @@ XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
     mat.info.num_row = num_row;
   }
   mat.info.num_col = ncol;
-  mat.info.num_nonzero = nelem;
+  mat.info.num_nonzero = mat.row_data_.size();
   *out  = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
   API_END();
 }
 
+XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
+                                     const unsigned* indices,
+                                     const bst_float* data,
+                                     size_t nindptr,
+                                     size_t nelem,
+                                     size_t num_row,
+                                     DMatrixHandle* out) {
+  return XGDMatrixCreateFromCSCEx_omp(col_ptr, indices, data, nindptr, nelem,
+                                      num_row, out, 0);
+}
+
 XGB_DLL int XGDMatrixCreateFromCSC(const xgboost::bst_ulong* col_ptr,
                                    const unsigned* indices,
                                    const bst_float* data,
@@ -394,37 +566,129 @@ XGB_DLL int XGDMatrixCreateFromMat(const bst_float* data,
   API_END();
 }
 
-void prefixsum_inplace(size_t *x, size_t N) {
-  size_t *suma;
-#pragma omp parallel
-  {
-    const int ithread = omp_get_thread_num();
-    const int nthreads = omp_get_num_threads();
-#pragma omp single
-    {
-      suma = new size_t[nthreads+1];
-      suma[0] = 0;
-    }
-    size_t sum = 0;
-    size_t offset = 0;
-#pragma omp for schedule(static)
-    for (omp_ulong i = 0; i < N; i++) {
-      sum += x[i];
-      x[i] = sum;
-    }
-    suma[ithread+1] = sum;
-#pragma omp barrier
-    for (omp_ulong i = 0; i < static_cast<omp_ulong>(ithread+1); i++) {
-      offset += suma[i];
+namespace {
+// fills mat from the values of the strided matrix, converted to float
+template <typename T>
+void FillFromStrided(const char* data, xgboost::bst_ulong nrow, xgboost::bst_ulong ncol,
+                     int64_t row_stride, int64_t col_stride, bst_float missing,
+                     int nthread, data::SimpleCSRSource* mat) {
+  const bool nan_missing = common::CheckNAN(missing);
+  auto value = [&](omp_ulong i, xgboost::bst_ulong j) {
+    return static_cast<bst_float>(*reinterpret_cast<const T*>(
+        data + static_cast<int64_t>(i) * row_stride + static_cast<int64_t>(j) * col_stride));
+  };
+  mat->row_ptr_.resize(1 + nrow);
+  std::vector<int> badnan(nthread, 0);
+  // count the entries of each row, then fill them
+  #pragma omp parallel for schedule(static) num_threads(nthread)
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    xgboost::bst_ulong nelem = 0;
+    for (xgboost::bst_ulong j = 0; j < ncol; ++j) {
+      const bst_float v = value(i, j);
+      if (common::CheckNAN(v)) {
+        if (!nan_missing) badnan[omp_get_thread_num()] = 1;
+      } else if (nan_missing || v != missing) {
+        ++nelem;
+      }
     }
-#pragma omp for schedule(static)
-    for (omp_ulong i = 0; i < N; i++) {
-      x[i] += offset;
+    mat->row_ptr_[i + 1] = nelem;
+  }
+  for (int i = 0; i < nthread; ++i) {
+    CHECK(!badnan[i]) << "There are NAN in the matrix, however, you did not set missing=NAN";
+  }
+  prefixsum_inplace(&mat->row_ptr_[0], mat->row_ptr_.size());
+  mat->row_data_.resize(mat->row_ptr_.back());
+  #pragma omp parallel for schedule(static) num_threads(nthread)
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    size_t pos = mat->row_ptr_[i];
+    for (xgboost::bst_ulong j = 0; j < ncol; ++j) {
+      const bst_float v = value(i, j);
+      if (!common::CheckNAN(v) && (nan_missing || v != missing)) {
+        mat->row_data_[pos++] = RowBatch::Entry(static_cast<bst_uint>(j), v);
+      }
     }
   }
-  delete[] suma;
 }
+}  // namespace
+
+XGB_DLL int XGDMatrixCreateFromStridedMat(const void* data,
+                                          int type,
+                                          xgboost::bst_ulong nrow,
+                                          xgboost::bst_ulong ncol,
+                                          int64_t row_stride,
+                                          int64_t col_stride,
+                                          bst_float missing,
+                                          int nthread,
+                                          DMatrixHandle* out) {
+  std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
 
+  API_BEGIN();
+  if (nthread <= 0) nthread = omp_get_max_threads();
+  data::SimpleCSRSource& mat = *source;
+  mat.info.num_row = nrow;
+  mat.info.num_col = ncol;
+  const char* bytes = static_cast<const char*>(data);
+  switch (type) {
+    case kFloat32:
+      FillFromStrided<float>(bytes, nrow, ncol, row_stride, col_stride, missing, nthread, &mat);
+      break;
+    case kDouble:
+      FillFromStrided<double>(bytes, nrow, ncol, row_stride, col_stride, missing, nthread, &mat);
+      break;
+    case kUInt32:
+      FillFromStrided<uint32_t>(bytes, nrow, ncol, row_stride, col_stride, missing, nthread,
+                                &mat);
+      break;
+    case kUInt64:
+      FillFromStrided<uint64_t>(bytes, nrow, ncol, row_stride, col_stride, missing, nthread,
+                                &mat);
+      break;
+    case kInt32:
+      FillFromStrided<int32_t>(bytes, nrow, ncol, row_stride, col_stride, missing, nthread,
+                               &mat);
+      break;
+    case kInt64:
+      FillFromStrided<int64_t>(bytes, nrow, ncol, row_stride, col_stride, missing, nthread,
+                               &mat);
+      break;
+    default:
+      LOG(FATAL) << "XGDMatrixCreateFromStridedMat: unknown data type " << type;
+  }
+  mat.info.num_nonzero = mat.row_data_.size();
+  *out  = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
+  API_END();
+}
+
+#if !XGBOOST_PREDICT_ONLY
+XGB_DLL int XGDMatrixCreateFromMatNoCopy(const bst_float* data,
+                                         xgboost::bst_ulong nrow,
+                                         xgboost::bst_ulong ncol,
+                                         bst_float missing,
+                                         DMatrixHandle* out) {
+  API_BEGIN();
+  std::unique_ptr<data::DenseBufferSource> source(
+      new data::DenseBufferSource(data, nrow, ncol, missing));
+  *out = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
+  API_END();
+}
+
+XGB_DLL int XGDMatrixCreateFromCSRNoCopy(const size_t* indptr,
+                                         const unsigned* indices,
+                                         const bst_float* data,
+                                         size_t nindptr,
+                                         size_t nelem,
+                                         size_t num_col,
+                                         DMatrixHandle* out) {
+  API_BEGIN();
+  CHECK_GE(nindptr, 1U) << "empty row pointer";
+  CHECK_EQ(indptr[nindptr - 1] - indptr[0], nelem)
+      << "the row pointer does not match the number of elements";
+  std::unique_ptr<data::CSRBufferSource> source(
+      new data::CSRBufferSource(indptr, indices, data, nindptr, num_col));
+  *out = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
+  API_END();
+}
+#endif  // !XGBOOST_PREDICT_ONLY
 
 XGB_DLL int XGDMatrixCreateFromMat_omp(const bst_float* data,
                                        xgboost::bst_ulong nrow,
@@ -505,56 +769,45 @@ XGB_DLL int XGDMatrixCreateFromMat_omp(const bst_float* data,
   API_END();
 }
 
+#if !XGBOOST_PREDICT_ONLY
+XGB_DLL int XGDMatrixCreateFromColumns(const void** columns,
+                                       const int* types,
+                                       const uint8_t** validity,
+                                       const uint64_t* offsets,
+                                       xgboost::bst_ulong ncol,
+                                       xgboost::bst_ulong nrow,
+                                       DMatrixHandle* out) {
+  API_BEGIN();
+  std::unique_ptr<data::ColumnarSource> source(new data::ColumnarSource(
+      columns, types, validity, offsets, ncol, nrow));
+  *out = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
+  API_END();
+}
+
 XGB_DLL int XGDMatrixSliceDMatrix(DMatrixHandle handle,
                                   const int* idxset,
                                   xgboost::bst_ulong len,
                                   DMatrixHandle* out) {
-  std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
-
   API_BEGIN();
-  data::SimpleCSRSource src;
-  src.CopyFrom(static_cast<std::shared_ptr<DMatrix>*>(handle)->get());
-  data::SimpleCSRSource& ret = *source;
-
-  CHECK_EQ(src.info.group_ptr.size(), 0U)
-      << "slice does not support group structure";
-
-  ret.Clear();
-  ret.info.num_row = len;
-  ret.info.num_col = src.info.num_col;
-
-  dmlc::DataIter<RowBatch>* iter = &src;
-  iter->BeforeFirst();
-  CHECK(iter->Next());
-
-  const RowBatch& batch = iter->Value();
+  std::vector<bst_uint> ridx(len);
   for (xgboost::bst_ulong i = 0; i < len; ++i) {
-    const int ridx = idxset[i];
-    RowBatch::Inst inst = batch[ridx];
-    CHECK_LT(static_cast<xgboost::bst_ulong>(ridx), batch.size);
-    ret.row_data_.resize(ret.row_data_.size() + inst.length);
-    std::memcpy(dmlc::BeginPtr(ret.row_data_) + ret.row_ptr_.back(), inst.data,
-                sizeof(RowBatch::Entry) * inst.length);
-    ret.row_ptr_.push_back(ret.row_ptr_.back() + inst.length);
-    ret.info.num_nonzero += inst.length;
-
-    if (src.info.labels.size() != 0) {
-      ret.info.labels.push_back(src.info.labels[ridx]);
-    }
-    if (src.info.weights.size() != 0) {
-      ret.info.weights.push_back(src.info.weights[ridx]);
-    }
-    if (src.info.base_margin.size() != 0) {
-      ret.info.base_margin.push_back(src.info.base_margin[ridx]);
-    }
-    if (src.info.root_index.size() != 0) {
-      ret.info.root_index.push_back(src.info.root_index[ridx]);
-    }
+    CHECK_GE(idxset[i], 0) << "slice index must be non-negative";
+    ridx[i] = static_cast<bst_uint>(idxset[i]);
   }
+  std::unique_ptr<data::SliceSource> source(new data::SliceSource(
+      *static_cast<std::shared_ptr<DMatrix>*>(handle), std::move(ridx)));
   *out = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
   API_END();
 }
 
+XGB_DLL int XGDMatrixAppend(DMatrixHandle handle, DMatrixHandle other) {
+  API_BEGIN();
+  static_cast<std::shared_ptr<DMatrix>*>(handle)->get()->Append(
+      static_cast<std::shared_ptr<DMatrix>*>(other)->get());
+  API_END();
+}
+#endif  // !XGBOOST_PREDICT_ONLY
+
 XGB_DLL int XGDMatrixFree(DMatrixHandle handle) {
   API_BEGIN();
   delete static_cast<std::shared_ptr<DMatrix>*>(handle);
@@ -569,6 +822,16 @@ XGB_DLL int XGDMatrixSaveBinary(DMatrixHandle handle,
   API_END();
 }
 
+#if !XGBOOST_PREDICT_ONLY
+XGB_DLL int XGDMatrixSaveSectioned(DMatrixHandle handle,
+                                   const char* fname,
+                                   int compress) {
+  API_BEGIN();
+  static_cast<std::shared_ptr<DMatrix>*>(handle)->get()->SaveSectioned(fname, compress != 0);
+  API_END();
+}
+#endif  // !XGBOOST_PREDICT_ONLY
+
 XGB_DLL int XGDMatrixSetFloatInfo(DMatrixHandle handle,
                           const char* field,
                           const bst_float* info,
@@ -684,6 +947,7 @@ XGB_DLL int XGBoosterSetParam(BoosterHandle handle,
   API_END();
 }
 
+#if !XGBOOST_PREDICT_ONLY
 XGB_DLL int XGBoosterUpdateOneIter(BoosterHandle handle,
                                    int iter,
                                    DMatrixHandle dtrain) {
@@ -717,6 +981,7 @@ XGB_DLL int XGBoosterBoostOneIter(BoosterHandle handle,
   bst->learner()->BoostOneIter(0, dtr->get(), &tmp_gpair);
   API_END();
 }
+#endif  // !XGBOOST_PREDICT_ONLY
 
 XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
                                  int iter,
@@ -741,6 +1006,57 @@ XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterEvalOneIterResults(BoosterHandle handle,
+                                        int iter,
+                                        DMatrixHandle dmats[],
+                                        const char* evnames[],
+                                        xgboost::bst_ulong len,
+                                        xgboost::bst_ulong* out_len,
+                                        const bst_float** out_result) {
+  std::vector<bst_float>& results =
+      XGBAPIThreadLocalStore::Get()->ret_vec_float.data_h();
+  API_BEGIN();
+  Booster* bst = static_cast<Booster*>(handle);
+  std::vector<DMatrix*> data_sets;
+  std::vector<std::string> data_names;
+
+  for (xgboost::bst_ulong i = 0; i < len; ++i) {
+    data_sets.push_back(static_cast<std::shared_ptr<DMatrix>*>(dmats[i])->get());
+    data_names.push_back(std::string(evnames[i]));
+  }
+
+  bst->LazyInit();
+  bst->learner()->EvalOneIter(iter, data_sets, data_names, &results);
+  *out_result = dmlc::BeginPtr(results);
+  *out_len = static_cast<xgboost::bst_ulong>(results.size());
+  API_END();
+}
+
+XGB_DLL int XGBoosterGetMetricNames(BoosterHandle handle,
+                                    xgboost::bst_ulong* out_len,
+                                    const char*** out) {
+  std::vector<std::string>& str_vecs = XGBAPIThreadLocalStore::Get()->ret_vec_str;
+  std::vector<const char*>& charp_vecs = XGBAPIThreadLocalStore::Get()->ret_vec_charp;
+  Booster *bst = static_cast<Booster*>(handle);
+  API_BEGIN();
+  bst->LazyInit();
+  str_vecs = bst->learner()->GetMetricNames();
+  charp_vecs.resize(str_vecs.size());
+  for (size_t i = 0; i < str_vecs.size(); ++i) {
+    charp_vecs[i] = str_vecs[i].c_str();
+  }
+  *out = dmlc::BeginPtr(charp_vecs);
+  *out_len = static_cast<xgboost::bst_ulong>(charp_vecs.size());
+  API_END();
+}
+
+XGB_DLL int XGBoosterEarlyStopped(BoosterHandle handle, int* out) {
+  API_BEGIN();
+  Booster* bst = static_cast<Booster*>(handle);
+  *out = bst->learner()->EarlyStopped() ? 1 : 0;
+  API_END();
+}
+
 XGB_DLL int XGBoosterPredict(BoosterHandle handle,
                              DMatrixHandle dmat,
                              int option_mask,
@@ -765,6 +1081,371 @@ XGB_DLL int XGBoosterPredict(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterPredictInto(BoosterHandle handle,
+                                 DMatrixHandle dmat,
+                                 int option_mask,
+                                 unsigned ntree_limit,
+                                 xgboost::bst_ulong out_size,
+                                 xgboost::bst_ulong *out_len,
+                                 bst_float *out_result) {
+  HostDeviceVector<bst_float>& preds =
+    XGBAPIThreadLocalStore::Get()->ret_vec_float;
+  API_BEGIN();
+  Booster *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  bst->learner()->Predict(
+      static_cast<std::shared_ptr<DMatrix>*>(dmat)->get(),
+      (option_mask & 1) != 0,
+      &preds, ntree_limit,
+      (option_mask & 2) != 0,
+      (option_mask & 4) != 0,
+      (option_mask & 8) != 0,
+      (option_mask & 16) != 0);
+  *out_len = static_cast<xgboost::bst_ulong>(preds.size());
+  CHECK_LE(preds.size(), out_size)
+      << "out_result holds " << out_size << " values but the prediction has "
+      << preds.size();
+  // the predictions of the GPU predictor are copied from the device
+  preds.copy_to(out_result);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictMulti(const BoosterHandle *handles,
+                                  xgboost::bst_ulong num_boosters,
+                                  DMatrixHandle dmat,
+                                  int option_mask,
+                                  unsigned ntree_limit,
+                                  xgboost::bst_ulong *out_offsets,
+                                  xgboost::bst_ulong *out_len,
+                                  const bst_float **out_result) {
+  std::vector<bst_float>& preds = XGBAPIThreadLocalStore::Get()->ret_vec_multi;
+  API_BEGIN();
+  CHECK_EQ(option_mask & ~1, 0)
+      << "XGBoosterPredictMulti only supports normal and margin output";
+  std::vector<const Learner*> learners;
+  for (xgboost::bst_ulong k = 0; k < num_boosters; ++k) {
+    Booster *bst = static_cast<Booster*>(handles[k]);
+    bst->LazyInit();
+    learners.push_back(bst->learner());
+  }
+  std::vector<size_t> offsets;
+  Learner::PredictMulti(learners, static_cast<std::shared_ptr<DMatrix>*>(dmat)->get(),
+                        (option_mask & 1) != 0, ntree_limit, &preds, &offsets);
+  for (size_t k = 0; k < offsets.size(); ++k) {
+    out_offsets[k] = static_cast<xgboost::bst_ulong>(offsets[k]);
+  }
+  *out_result = dmlc::BeginPtr(preds);
+  *out_len = static_cast<xgboost::bst_ulong>(preds.size());
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictLeafIndex(BoosterHandle handle,
+                                      DMatrixHandle dmat,
+                                      unsigned ntree_limit,
+                                      int *out_index_size,
+                                      xgboost::bst_ulong *out_ntree,
+                                      xgboost::bst_ulong *out_len,
+                                      const void **out_result) {
+  std::vector<char>& leaves = XGBAPIThreadLocalStore::Get()->ret_vec_leaf;
+  API_BEGIN();
+  Booster *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  DMatrix* p_fmat = static_cast<std::shared_ptr<DMatrix>*>(dmat)->get();
+  int index_size = sizeof(uint16_t);
+  size_t ntree = 0;
+  leaves.clear();
+  bst->learner()->PredictLeafIndex(p_fmat, ntree_limit, [&](const LeafIndexBlock& block) {
+    index_size = block.index_size;
+    ntree = block.ntree;
+    const size_t row_bytes = block.ntree * block.index_size;
+    leaves.resize(p_fmat->info().num_row * row_bytes);
+    std::memcpy(dmlc::BeginPtr(leaves) + block.base_rowid * row_bytes, block.data,
+                block.nrow * row_bytes);
+  });
+  *out_index_size = index_size;
+  *out_ntree = static_cast<xgboost::bst_ulong>(ntree);
+  *out_len = static_cast<xgboost::bst_ulong>(leaves.size() / index_size);
+  *out_result = dmlc::BeginPtr(leaves);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictLeafIndexStream(BoosterHandle handle,
+                                            DMatrixHandle dmat,
+                                            unsigned ntree_limit,
+                                            XGBCallbackLeafIndex *callback,
+                                            void *user_data) {
+  API_BEGIN();
+  Booster *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  bst->learner()->PredictLeafIndex(
+      static_cast<std::shared_ptr<DMatrix>*>(dmat)->get(), ntree_limit,
+      [&](const LeafIndexBlock& block) {
+        CHECK_EQ(callback(block.data, block.index_size,
+                          static_cast<xgboost::bst_ulong>(block.base_rowid),
+                          static_cast<xgboost::bst_ulong>(block.nrow),
+                          static_cast<xgboost::bst_ulong>(block.ntree), user_data), 0)
+            << "the callback of the leaf indices failed at row " << block.base_rowid;
+      });
+  API_END();
+}
+
+XGB_DLL int XGBoosterSlice(BoosterHandle handle,
+                           int layer_begin,
+                           int layer_end,
+                           int class_group,
+                           BoosterHandle *out) {
+  API_BEGIN();
+  Booster *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  std::unique_ptr<Learner> slice(bst->learner()->Slice(layer_begin, layer_end, class_group));
+  std::vector<std::pair<std::string, std::string> > cfg;
+  for (const auto& kv : bst->cfg_) {
+    // the objective and the metrics of the classes do not apply to a single group
+    if (class_group >= 0 &&
+        (kv.first == "objective" || kv.first == "num_class" || kv.first == "eval_metric")) {
+      continue;
+    }
+    cfg.push_back(kv);
+  }
+  *out = new Booster(slice.release(), cfg);
+  API_END();
+}
+
+// runs op after the operations started before on the booster
+static void StartAsync(Booster* bst, XGBCallbackAsync* callback, void* user_data,
+                       AsyncHandle* out, std::function<void(AsyncEntry*)> op) {
+  std::shared_ptr<AsyncEntry> entry(new AsyncEntry());
+  *out = new std::shared_ptr<AsyncEntry>(entry);
+  bst->tasks_.Push([entry, callback, user_data, op]() {
+    // the handle passed to the callback, the caller may have freed its own
+    std::shared_ptr<AsyncEntry> self = entry;
+    int status = 0;
+    std::string error;
+    try {
+      op(self.get());
+    } catch (const std::exception& e) {
+      status = -1;
+      error = e.what();
+    }
+    {
+      std::lock_guard<std::mutex> guard(self->mutex);
+      self->status = status;
+      self->error = error;
+      self->done = true;
+    }
+    self->cv.notify_all();
+    if (callback != nullptr) callback(&self, status, user_data);
+  });
+}
+
+#if !XGBOOST_PREDICT_ONLY
+XGB_DLL int XGBoosterUpdateOneIterAsync(BoosterHandle handle,
+                                        int iter,
+                                        DMatrixHandle dtrain,
+                                        XGBCallbackAsync* callback,
+                                        void* user_data,
+                                        AsyncHandle* out) {
+  API_BEGIN();
+  Booster* bst = static_cast<Booster*>(handle);
+  std::shared_ptr<DMatrix> dtr = *static_cast<std::shared_ptr<DMatrix>*>(dtrain);
+  StartAsync(bst, callback, user_data, out, [bst, iter, dtr](AsyncEntry* entry) {
+    bst->LazyInit();
+    bst->learner()->UpdateOneIter(iter, dtr.get());
+  });
+  API_END();
+}
+#endif  // !XGBOOST_PREDICT_ONLY
+
+XGB_DLL int XGBoosterEvalOneIterAsync(BoosterHandle handle,
+                                      int iter,
+                                      DMatrixHandle dmats[],
+                                      const char* evnames[],
+                                      xgboost::bst_ulong len,
+                                      XGBCallbackAsync* callback,
+                                      void* user_data,
+                                      AsyncHandle* out) {
+  API_BEGIN();
+  Booster* bst = static_cast<Booster*>(handle);
+  std::vector<std::shared_ptr<DMatrix> > data_sets;
+  std::vector<std::string> data_names;
+  for (xgboost::bst_ulong i = 0; i < len; ++i) {
+    data_sets.push_back(*static_cast<std::shared_ptr<DMatrix>*>(dmats[i]));
+    data_names.push_back(std::string(evnames[i]));
+  }
+  StartAsync(bst, callback, user_data, out,
+             [bst, iter, data_sets, data_names](AsyncEntry* entry) {
+    std::vector<DMatrix*> mats;
+    for (const auto& d : data_sets) mats.push_back(d.get());
+    bst->LazyInit();
+    entry->eval = bst->learner()->EvalOneIter(iter, mats, data_names);
+  });
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictAsync(BoosterHandle handle,
+                                  DMatrixHandle dmat,
+                                  int option_mask,
+                                  unsigned ntree_limit,
+                                  XGBCallbackAsync* callback,
+                                  void* user_data,
+                                  AsyncHandle* out) {
+  API_BEGIN();
+  Booster* bst = static_cast<Booster*>(handle);
+  std::shared_ptr<DMatrix> data = *static_cast<std::shared_ptr<DMatrix>*>(dmat);
+  StartAsync(bst, callback, user_data, out,
+             [bst, data, option_mask, ntree_limit](AsyncEntry* entry) {
+    bst->LazyInit();
+    bst->learner()->Predict(
+        data.get(),
+        (option_mask & 1) != 0,
+        &entry->preds, ntree_limit,
+        (option_mask & 2) != 0,
+        (option_mask & 4) != 0,
+        (option_mask & 8) != 0,
+        (option_mask & 16) != 0);
+  });
+  API_END();
+}
+
+XGB_DLL int XGBAsyncWait(AsyncHandle handle) {
+  return (*static_cast<std::shared_ptr<AsyncEntry>*>(handle))->Wait();
+}
+
+XGB_DLL int XGBAsyncIsDone(AsyncHandle handle, int* out) {
+  API_BEGIN();
+  AsyncEntry* entry = static_cast<std::shared_ptr<AsyncEntry>*>(handle)->get();
+  std::lock_guard<std::mutex> guard(entry->mutex);
+  *out = entry->done ? 1 : 0;
+  API_END();
+}
+
+XGB_DLL int XGBAsyncGetPrediction(AsyncHandle handle,
+                                  xgboost::bst_ulong *len,
+                                  const bst_float **out_result) {
+  AsyncEntry* entry = static_cast<std::shared_ptr<AsyncEntry>*>(handle)->get();
+  if (entry->Wait() != 0) return -1;
+  API_BEGIN();
+  *out_result = dmlc::BeginPtr(entry->preds.data_h());
+  *len = static_cast<xgboost::bst_ulong>(entry->preds.size());
+  API_END();
+}
+
+XGB_DLL int XGBAsyncGetEvalResult(AsyncHandle handle, const char** out_result) {
+  AsyncEntry* entry = static_cast<std::shared_ptr<AsyncEntry>*>(handle)->get();
+  if (entry->Wait() != 0) return -1;
+  API_BEGIN();
+  *out_result = entry->eval.c_str();
+  API_END();
+}
+
+XGB_DLL int XGBAsyncFree(AsyncHandle handle) {
+  API_BEGIN();
+  delete static_cast<std::shared_ptr<AsyncEntry>*>(handle);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictionContextCreate(PredictionContextHandle *out) {
+  API_BEGIN();
+  *out = new PredictionContextEntry();
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictionContextFree(PredictionContextHandle handle) {
+  API_BEGIN();
+  delete static_cast<PredictionContextEntry*>(handle);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictWithContext(BoosterHandle handle,
+                                        PredictionContextHandle ctx,
+                                        DMatrixHandle dmat,
+                                        int option_mask,
+                                        unsigned ntree_limit,
+                                        xgboost::bst_ulong *len,
+                                        const bst_float **out_result) {
+  API_BEGIN();
+  CHECK_EQ(option_mask & ~1, 0)
+      << "prediction with context only supports normal and margin output";
+  PredictionContextEntry* entry = static_cast<PredictionContextEntry*>(ctx);
+  Booster *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  bst->learner()->Predict(
+      static_cast<std::shared_ptr<DMatrix>*>(dmat)->get(),
+      (option_mask & 1) != 0,
+      &entry->preds, ntree_limit, &entry->ctx);
+  *out_result = dmlc::BeginPtr(entry->preds.data_h());
+  *len = static_cast<xgboost::bst_ulong>(entry->preds.size());
+  API_END();
+}
+
+// predict the row held in tmp_row of the thread local store
+inline void PredictRowInternal(BoosterHandle handle,
+                               int option_mask,
+                               unsigned ntree_limit,
+                               xgboost::bst_ulong out_size,
+                               xgboost::bst_ulong *out_len,
+                               bst_float *out_result) {
+  CHECK_EQ(option_mask & ~1, 0)
+      << "single row prediction only supports normal and margin output";
+  XGBAPIThreadLocalEntry* entry = XGBAPIThreadLocalStore::Get();
+  Booster *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  const RowBatch::Inst inst(dmlc::BeginPtr(entry->tmp_row),
+                            static_cast<bst_uint>(entry->tmp_row.size()));
+  bst->learner()->Predict(inst, (option_mask & 1) != 0, &entry->tmp_row_preds,
+                          ntree_limit, &entry->row_ctx);
+  const std::vector<bst_float>& preds = entry->tmp_row_preds.data_h();
+  CHECK_LE(preds.size(), out_size)
+      << "out_result holds " << out_size << " values but the prediction has "
+      << preds.size();
+  std::copy(preds.begin(), preds.end(), out_result);
+  *out_len = static_cast<xgboost::bst_ulong>(preds.size());
+}
+
+XGB_DLL int XGBoosterPredictFromDenseRow(BoosterHandle handle,
+                                         const bst_float *data,
+                                         xgboost::bst_ulong ncol,
+                                         bst_float missing,
+                                         int option_mask,
+                                         unsigned ntree_limit,
+                                         xgboost::bst_ulong out_size,
+                                         xgboost::bst_ulong *out_len,
+                                         bst_float *out_result) {
+  API_BEGIN();
+  std::vector<RowBatch::Entry>& row = XGBAPIThreadLocalStore::Get()->tmp_row;
+  row.clear();
+  bool nan_missing = common::CheckNAN(missing);
+  for (xgboost::bst_ulong j = 0; j < ncol; ++j) {
+    if (common::CheckNAN(data[j])) {
+      CHECK(nan_missing)
+        << "There are NAN in the row, however, you did not set missing=NAN";
+    } else if (nan_missing || data[j] != missing) {
+      row.push_back(RowBatch::Entry(static_cast<bst_uint>(j), data[j]));
+    }
+  }
+  PredictRowInternal(handle, option_mask, ntree_limit, out_size, out_len, out_result);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictFromCSRRow(BoosterHandle handle,
+                                       const unsigned *indices,
+                                       const bst_float *data,
+                                       xgboost::bst_ulong nelem,
+                                       int option_mask,
+                                       unsigned ntree_limit,
+                                       xgboost::bst_ulong out_size,
+                                       xgboost::bst_ulong *out_len,
+                                       bst_float *out_result) {
+  API_BEGIN();
+  std::vector<RowBatch::Entry>& row = XGBAPIThreadLocalStore::Get()->tmp_row;
+  row.resize(nelem);
+  for (xgboost::bst_ulong j = 0; j < nelem; ++j) {
+    row[j] = RowBatch::Entry(indices[j], data[j]);
+  }
+  PredictRowInternal(handle, option_mask, ntree_limit, out_size, out_len, out_result);
+  API_END();
+}
+
 XGB_DLL int XGBoosterLoadModel(BoosterHandle handle, const char* fname) {
   API_BEGIN();
   std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname, "r"));
@@ -850,6 +1531,49 @@ XGB_DLL int XGBoosterDumpModelEx(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterDumpModelStream(BoosterHandle handle,
+                                     const char* fmap,
+                                     int with_stats,
+                                     const char *format,
+                                     XGBCallbackDumpModel* callback,
+                                     void *callback_handle) {
+  API_BEGIN();
+  FeatureMap featmap;
+  if (strlen(fmap) != 0) {
+    std::unique_ptr<dmlc::Stream> fs(
+        dmlc::Stream::Create(fmap, "r"));
+    dmlc::istream is(fs.get());
+    featmap.LoadText(is);
+  }
+  Booster *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  bst->learner()->DumpModel(featmap, with_stats != 0, format,
+                            [&](const std::string& dump) {
+    callback(dump.c_str(), static_cast<xgboost::bst_ulong>(dump.length()), callback_handle);
+  });
+  API_END();
+}
+
+XGB_DLL int XGBoosterDumpModelToFile(BoosterHandle handle,
+                                     const char* fmap,
+                                     int with_stats,
+                                     const char *format,
+                                     const char *fname) {
+  API_BEGIN();
+  FeatureMap featmap;
+  if (strlen(fmap) != 0) {
+    std::unique_ptr<dmlc::Stream> fs(
+        dmlc::Stream::Create(fmap, "r"));
+    dmlc::istream is(fs.get());
+    featmap.LoadText(is);
+  }
+  Booster *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname, "w"));
+  bst->learner()->DumpModel(featmap, with_stats != 0, format, fo.get());
+  API_END();
+}
+
 XGB_DLL int XGBoosterDumpModelWithFeatures(BoosterHandle handle,
                                    int fnum,
                                    const char** fname,
@@ -924,6 +1648,37 @@ XGB_DLL int XGBoosterGetAttrNames(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBGetProfile(const char** out_str) {
+  std::string& ret_str = XGBAPIThreadLocalStore::Get()->ret_str;
+  API_BEGIN();
+  ret_str = common::Profiler::Get()->ToJSON();
+  *out_str = ret_str.c_str();
+  API_END();
+}
+
+XGB_DLL int XGBSetTracing(int tracing) {
+  API_BEGIN();
+  common::Profiler::Get()->SetTracing(tracing != 0);
+  API_END();
+}
+
+XGB_DLL int XGBGetTrace(const char** out_str) {
+  std::string& ret_str = XGBAPIThreadLocalStore::Get()->ret_str;
+  API_BEGIN();
+  ret_str = common::Profiler::Get()->TraceJSON();
+  *out_str = ret_str.c_str();
+  API_END();
+}
+
+XGB_DLL int XGBGetMemoryUsage(int reset_peak, const char** out_str) {
+  std::string& ret_str = XGBAPIThreadLocalStore::Get()->ret_str;
+  API_BEGIN();
+  ret_str = common::MemoryTracker::Get()->ToJSON();
+  if (reset_peak != 0) common::MemoryTracker::Get()->ResetPeak();
+  *out_str = ret_str.c_str();
+  API_END();
+}
+
 XGB_DLL int XGBoosterLoadRabitCheckpoint(BoosterHandle handle,
                                  int* version) {
   API_BEGIN();
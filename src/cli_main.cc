@@ -18,9 +18,13 @@
 #include <string>
 #include <cstdio>
 #include <cstring>
+#include <thread>
 #include <vector>
 #include "./common/sync.h"
 #include "./common/config.h"
+#include "./common/io.h"
+#include "./data/row_batch_source.h"
+#include "./data/simple_csr_source.h"
 
 
 namespace xgboost {
@@ -28,7 +32,13 @@ namespace xgboost {
 enum CLITask {
   kTrain = 0,
   kDumpModel = 1,
-  kPredict = 2
+  kPredict = 2,
+  kCompile = 3
+};
+
+enum CLIPredFormat {
+  kPredText = 0,
+  kPredBinary = 1
 };
 
 struct CLIParam : public dmlc::Parameter<CLIParam> {
@@ -42,6 +52,8 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
   int num_round;
   /*! \brief the period to save the model, 0 means only save the final round model */
   int save_period;
+  /*! \brief whether the models are saved by a background thread during the training */
+  bool save_async;
   /*! \brief the path of training set */
   std::string train_path;
   /*! \brief path of test dataset */
@@ -60,6 +72,12 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
   int ntree_limit;
   /*!\brief whether to directly output margin value */
   bool pred_margin;
+  /*!\brief whether to predict and write one page at a time */
+  bool pred_pages;
+  /*!\brief whether to parse, predict and write the test data one block at a time */
+  bool pred_stream;
+  /*!\brief format of the prediction file */
+  int pred_format;
   /*! \brief whether dump statistics along with model */
   int dump_stats;
   /*! \brief what format to dump the model in */
@@ -68,6 +86,8 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
   std::string name_fmap;
   /*! \brief name of dump file */
   std::string name_dump;
+  /*! \brief name of the generated source file */
+  std::string name_code;
   /*! \brief the paths of validation data sets */
   std::vector<std::string> eval_data_paths;
   /*! \brief the names of the evaluation data used in output log */
@@ -82,6 +102,7 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
         .add_enum("train", kTrain)
         .add_enum("dump", kDumpModel)
         .add_enum("pred", kPredict)
+        .add_enum("compile", kCompile)
         .describe("Task to be performed by the CLI program.");
     DMLC_DECLARE_FIELD(silent).set_default(0).set_range(0, 2)
         .describe("Silent level during the task.");
@@ -91,6 +112,9 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
         .describe("Number of boosting iterations");
     DMLC_DECLARE_FIELD(save_period).set_default(0).set_lower_bound(0)
         .describe("The period to save the model, 0 means only save final model.");
+    DMLC_DECLARE_FIELD(save_async).set_default(true)
+        .describe("Whether the models are written to their files by a background "
+                  "thread, while the training goes on.");
     DMLC_DECLARE_FIELD(train_path).set_default("NULL")
         .describe("Training data path.");
     DMLC_DECLARE_FIELD(test_path).set_default("NULL")
@@ -112,14 +136,28 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
         .describe("Number of trees used for prediction, 0 means use all trees.");
     DMLC_DECLARE_FIELD(pred_margin).set_default(false)
         .describe("Whether to predict margin value instead of probability.");
+    DMLC_DECLARE_FIELD(pred_pages).set_default(false)
+        .describe("Whether to predict and write the result one page at a time, "
+                  "the result of a page is written while the next one is scored.");
+    DMLC_DECLARE_FIELD(pred_stream).set_default(false)
+        .describe("Whether to parse, predict and write the text test data one block at a "
+                  "time, without loading it into memory.");
+    DMLC_DECLARE_FIELD(pred_format).set_default(kPredText)
+        .add_enum("text", kPredText)
+        .add_enum("binary", kPredBinary)
+        .describe("Format of the prediction file: text, one value per line, or binary, "
+                  "the raw float32 values.");
     DMLC_DECLARE_FIELD(dump_stats).set_default(false)
         .describe("Whether dump the model statistics.");
     DMLC_DECLARE_FIELD(dump_format).set_default("text")
-        .describe("What format to dump the model in.");
+        .describe("What format to dump the model in: text, json, or json_compact "
+                  "for trees as arrays indexed by node id.");
     DMLC_DECLARE_FIELD(name_fmap).set_default("NULL")
         .describe("Name of the feature map file.");
     DMLC_DECLARE_FIELD(name_dump).set_default("dump.txt")
         .describe("Name of the output dump text file.");
+    DMLC_DECLARE_FIELD(name_code).set_default("model.c")
+        .describe("Name of the generated C source file of compile task.");
     // alias
     DMLC_DECLARE_ALIAS(train_path, data);
     DMLC_DECLARE_ALIAS(test_path, test:data);
@@ -204,6 +242,8 @@ void CLITrain(const CLIParam& param) {
   const double start = dmlc::GetTime();
   std::cout << "version: " << version << std::endl;
   std::cout << "num_round: " << param.num_round << std::endl;
+  // writes the periodic models while the next rounds are trained
+  common::AsyncFileWriter saver;
   for (int i = version / 2; i < param.num_round; ++i) {
     double elapsed = dmlc::GetTime() - start;
     std::cout << "version: " << version << std::endl;
@@ -237,9 +277,13 @@ void CLITrain(const CLIParam& param) {
       os << param.model_dir << '/'
          << std::setfill('0') << std::setw(4)
          << i + 1 << ".model";
-      std::unique_ptr<dmlc::Stream> fo(
-          dmlc::Stream::Create(os.str().c_str(), "w"));
-      learner->Save(fo.get());
+      if (param.save_async) {
+        saver.Write(*learner, os.str());
+      } else {
+        std::unique_ptr<dmlc::Stream> fo(
+            dmlc::Stream::Create(os.str().c_str(), "w"));
+        learner->Save(fo.get());
+      }
     }
 
     if (learner->AllowLazyCheckPoint()) {
@@ -249,6 +293,14 @@ void CLITrain(const CLIParam& param) {
     }
     version += 1;
     CHECK_EQ(version, rabit::VersionNumber());
+    if (learner->EarlyStopped()) {
+      std::string best;
+      learner->GetAttr("best_iteration", &best);
+      if (param.silent < 2 && rabit::GetRank() == 0) {
+        LOG(CONSOLE) << "early stopping at round " << i << ", the best round is " << best;
+      }
+      break;
+    }
   }
   // always save final round
   if ((param.save_period == 0 || param.num_round % param.save_period != 0) &&
@@ -266,6 +318,7 @@ void CLITrain(const CLIParam& param) {
         dmlc::Stream::Create(os.str().c_str(), "w"));
     learner->Save(fo.get());
   }
+  saver.Wait();
 
   if (param.silent == 0) {
     double elapsed = dmlc::GetTime() - start;
@@ -289,35 +342,156 @@ void CLIDumpModel(const CLIParam& param) {
       dmlc::Stream::Create(param.model_in.c_str(), "r"));
   learner->Configure(param.cfg);
   learner->Load(fi.get());
-  // dump data
-  std::vector<std::string> dump = learner->DumpModel(
-      fmap, param.dump_stats, param.dump_format);
+  // dump data, the boosters are written as they are dumped
   std::unique_ptr<dmlc::Stream> fo(
       dmlc::Stream::Create(param.name_dump.c_str(), "w"));
+  learner->DumpModel(fmap, param.dump_stats, param.dump_format, fo.get());
+}
+
+void CLICompileModel(const CLIParam& param) {
+  CHECK_NE(param.model_in, "NULL")
+      << "Must specify model_in for compile";
+  std::unique_ptr<Learner> learner(Learner::Create({}));
+  std::unique_ptr<dmlc::Stream> fi(
+      dmlc::Stream::Create(param.model_in.c_str(), "r"));
+  learner->Configure(param.cfg);
+  learner->Load(fi.get());
+  // each tree becomes a function, the last entry is the predict function
+  std::vector<std::string> code = learner->DumpModel(
+      FeatureMap(), param.dump_stats, "c");
+  std::unique_ptr<dmlc::Stream> fo(
+      dmlc::Stream::Create(param.name_code.c_str(), "w"));
   dmlc::ostream os(fo.get());
-  if (param.dump_format == "json") {
-    os << "[" << std::endl;
-    for (size_t i = 0; i < dump.size(); ++i) {
-      if (i != 0) os << "," << std::endl;
-      os << dump[i];  // Dump the previously generated JSON here
-    }
-    os << std::endl << "]" << std::endl;
-  } else {
-    for (size_t i = 0; i < dump.size(); ++i) {
-      os << "booster[" << i << "]:\n";
-      os << dump[i];
-    }
+  os << "/* Generated by xgboost from " << param.model_in << ".\n"
+     << " * predict() returns the margin, the same as pred_margin=1;\n"
+     << " * missing features are passed as NAN. */\n"
+     << "#include <math.h>\n"
+     << "#if defined(__GNUC__)\n"
+     << "#define XGB_LIKELY(x) __builtin_expect(!!(x), 1)\n"
+     << "#else\n"
+     << "#define XGB_LIKELY(x) (x)\n"
+     << "#endif\n"
+     << "#define XGB_ISNAN(x) ((x) != (x))\n"
+     << "#ifdef __cplusplus\n"
+     << "extern \"C\" {\n"
+     << "#endif\n";
+  for (size_t i = 0; i < code.size(); ++i) {
+    os << code[i];
   }
+  os << "#ifdef __cplusplus\n"
+     << "}  /* extern \"C\" */\n"
+     << "#endif\n";
   // force flush before fo destruct.
   os.set_stream(nullptr);
 }
 
+// Predict one row page at a time. The pages of external memory data are
+// decoded ahead by the prefetcher of the source, and the predictions of
+// a page are written by a separate thread while the next page is scored.
+// writes the predictions in the format of the prediction file
+void WritePredictions(const std::vector<bst_float>& preds, int format, dmlc::Stream* fo) {
+  if (format == kPredBinary) {
+    if (preds.size() != 0) fo->Write(dmlc::BeginPtr(preds), preds.size() * sizeof(bst_float));
+    return;
+  }
+  // %g prints the same as the default formatting of the streams
+  std::string text;
+  text.reserve(preds.size() * 12);
+  char buffer[32];
+  for (bst_float p : preds) {
+    int len = snprintf(buffer, sizeof(buffer), "%g\n", p);
+    text.append(buffer, len);
+  }
+  fo->Write(text.data(), text.length());
+}
+
+// writes the predictions of a batch on a thread, while the next ones are computed
+class PredictionWriter {
+ public:
+  PredictionWriter(int format, dmlc::Stream* fo) : format_(format), fo_(fo) {}
+  ~PredictionWriter() {
+    this->Wait();
+  }
+  inline void Push(HostDeviceVector<bst_float>* preds) {
+    this->Wait();
+    writing_.swap(preds->data_h());
+    writer_ = std::thread([this]() { WritePredictions(writing_, format_, fo_); });
+  }
+  inline void Wait() {
+    if (writer_.joinable()) writer_.join();
+  }
+
+ private:
+  int format_;
+  dmlc::Stream* fo_;
+  std::vector<bst_float> writing_;
+  std::thread writer_;
+};
+
+void CLIPredictPages(const CLIParam& param, Learner* learner, DMatrix* dtest,
+                     dmlc::Stream* fo) {
+  PredictionWriter writer(param.pred_format, fo);
+  dmlc::DataIter<RowBatch>* iter = dtest->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    std::unique_ptr<DataSource> source(
+        new data::RowBatchSource(iter->Value(), dtest->info()));
+    std::unique_ptr<DMatrix> dpage(DMatrix::Create(std::move(source)));
+    HostDeviceVector<bst_float> preds;
+    learner->Predict(dpage.get(), param.pred_margin, &preds, param.ntree_limit);
+    writer.Push(&preds);
+  }
+}
+
+// the parser reads the next block on its own thread while a block is scored,
+// and the writer writes the previous one, so at most three blocks are in memory
+size_t CLIPredictStream(const CLIParam& param, Learner* learner, dmlc::Stream* fo) {
+  CHECK_EQ(param.test_path.find('#'), std::string::npos)
+      << "pred_stream reads the text data directly, it takes no cache file";
+  int partid = 0, npart = 1;
+  if (param.dsplit == 2) {
+    partid = rabit::GetRank();
+    npart = rabit::GetWorldSize();
+  }
+  std::unique_ptr<dmlc::Parser<uint32_t> > parser(
+      dmlc::Parser<uint32_t>::Create(param.test_path.c_str(), partid, npart, "auto"));
+  PredictionWriter writer(param.pred_format, fo);
+  size_t nrow = 0;
+  while (parser->Next()) {
+    std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+    source->Push(parser->Value());
+    nrow += source->info.num_row;
+    std::unique_ptr<DMatrix> dblock(DMatrix::Create(std::move(source)));
+    HostDeviceVector<bst_float> preds;
+    learner->Predict(dblock.get(), param.pred_margin, &preds, param.ntree_limit);
+    writer.Push(&preds);
+  }
+  writer.Wait();
+  if (param.silent == 0) {
+    LOG(CONSOLE) << nrow << " rows of " << param.test_path << " predicted";
+  }
+  return nrow;
+}
+
+// the rows predicted by each worker, in the order of the parts of the test data,
+// logged by rank 0
+void LogPredictionParts(const CLIParam& param, size_t nrow) {
+  std::vector<size_t> part_rows(rabit::GetWorldSize(), 0);
+  part_rows[rabit::GetRank()] = nrow;
+  rabit::Allreduce<rabit::op::Sum>(dmlc::BeginPtr(part_rows), part_rows.size());
+  if (param.silent == 0 && rabit::GetRank() == 0) {
+    size_t begin = 0;
+    for (size_t part = 0; part < part_rows.size(); ++part) {
+      LOG(CONSOLE) << "rows [" << begin << ", " << begin + part_rows[part] << ") in "
+                   << param.name_pred << ".part-" << part;
+      begin += part_rows[part];
+    }
+  }
+}
+
 void CLIPredict(const CLIParam& param) {
   CHECK_NE(param.test_path, "NULL")
       << "Test dataset parameter test:data must be specified.";
-  // load data
-  std::unique_ptr<DMatrix> dtest(
-      DMatrix::Load(param.test_path, param.silent != 0, param.dsplit == 2));
   // load model
   CHECK_NE(param.model_in, "NULL")
       << "Must specify model_in for predict";
@@ -330,19 +504,47 @@ void CLIPredict(const CLIParam& param) {
   if (param.silent == 0) {
     LOG(CONSOLE) << "start prediction...";
   }
-  HostDeviceVector<bst_float> preds;
-  learner->Predict(dtest.get(), param.pred_margin, &preds, param.ntree_limit);
-  if (param.silent == 0) {
-    LOG(CONSOLE) << "writing prediction to " << param.name_pred;
+  // each worker predicts its part of the rows into its own file, the parts
+  // in the order of the ranks are the predictions of the whole test data
+  const bool sharded = rabit::IsDistributed();
+  std::string name_pred = param.name_pred;
+  if (sharded) {
+    CHECK_EQ(param.dsplit, 2)
+        << "distributed prediction needs dsplit=row, every worker predicts its rows";
+    CHECK_NE(param.name_pred, "stdout")
+        << "distributed prediction writes one file per worker, name_pred cannot be stdout";
+    name_pred += ".part-" + std::to_string(rabit::GetRank());
   }
-  std::unique_ptr<dmlc::Stream> fo(
-      dmlc::Stream::Create(param.name_pred.c_str(), "w"));
-  dmlc::ostream os(fo.get());
-  for (bst_float p : preds.data_h()) {
-    os << p << '\n';
+  size_t nrow = 0;
+  {
+    std::unique_ptr<dmlc::Stream> fo(
+        dmlc::Stream::Create(name_pred.c_str(), "w"));
+    if (param.pred_stream) {
+      if (param.silent == 0) {
+        LOG(CONSOLE) << "writing prediction to " << name_pred << " block by block";
+      }
+      nrow = CLIPredictStream(param, learner.get(), fo.get());
+    } else {
+      // load data
+      std::unique_ptr<DMatrix> dtest(
+          DMatrix::Load(param.test_path, param.silent != 0, param.dsplit == 2));
+      nrow = dtest->info().num_row;
+      if (param.pred_pages) {
+        if (param.silent == 0) {
+          LOG(CONSOLE) << "writing prediction to " << name_pred << " page by page";
+        }
+        CLIPredictPages(param, learner.get(), dtest.get(), fo.get());
+      } else {
+        HostDeviceVector<bst_float> preds;
+        learner->Predict(dtest.get(), param.pred_margin, &preds, param.ntree_limit);
+        if (param.silent == 0) {
+          LOG(CONSOLE) << "writing prediction to " << name_pred;
+        }
+        WritePredictions(preds.data_h(), param.pred_format, fo.get());
+      }
+    }
   }
-  // force flush before fo destruct.
-  os.set_stream(nullptr);
+  if (sharded) LogPredictionParts(param, nrow);
 }
 
 int CLIRunTask(int argc, char *argv[]) {
@@ -373,6 +575,7 @@ int CLIRunTask(int argc, char *argv[]) {
     case kTrain: CLITrain(param); break;
     case kDumpModel: CLIDumpModel(param); break;
     case kPredict: CLIPredict(param); break;
+    case kCompile: CLICompileModel(param); break;
   }
   rabit::Finalize();
   return 0;
@@ -0,0 +1,137 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file arena.h
+ * \brief bump allocator for the scratch memory of the training iterations
+ */
+#ifndef XGBOOST_COMMON_ARENA_H_
+#define XGBOOST_COMMON_ARENA_H_
+
+#include <dmlc/logging.h>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+/*!
+ * \brief scratch memory handed out from large blocks by moving a pointer.
+ *  Nothing is freed before the end of the enclosing Scope, which gives all
+ *  the memory allocated in it back at once. When the outermost scope ends,
+ *  the blocks are merged into a single one, so that the next iterations no
+ *  longer allocate from the heap. An arena is used by one thread at a time.
+ */
+class Arena {
+ public:
+  /*! \brief gives back the memory allocated since its construction */
+  class Scope {
+   public:
+    explicit Scope(Arena* arena)
+        : arena_(arena), block_(arena->block_), offset_(arena->offset_) {
+      ++arena_->depth_;
+    }
+    ~Scope() {
+      arena_->block_ = block_;
+      arena_->offset_ = offset_;
+      if (--arena_->depth_ == 0) arena_->Merge();
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    Arena* arena_;
+    size_t block_;
+    size_t offset_;
+  };
+
+  explicit Arena(size_t min_block = kMinBlock)
+      : min_block_(min_block), block_(0), offset_(0), depth_(0) {}
+  Arena(Arena&&) = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  /*! \brief nbytes of memory aligned for any type, valid until the end of the scope */
+  inline void* Allocate(size_t nbytes) {
+    CHECK_GT(depth_, 0) << "Arena is used outside of a scope";
+    nbytes = (nbytes + kAlign - 1) / kAlign * kAlign;
+    while (block_ < blocks_.size() && offset_ + nbytes > blocks_[block_].size) {
+      ++block_;
+      offset_ = 0;
+    }
+    if (block_ == blocks_.size()) {
+      // the blocks double, so that a growing loop has few of them
+      blocks_.emplace_back(std::max(std::max(min_block_, nbytes), Capacity()));
+      offset_ = 0;
+    }
+    char* ptr = blocks_[block_].data.get() + offset_;
+    offset_ += nbytes;
+    return ptr;
+  }
+  /*! \brief total size of the blocks */
+  inline size_t Capacity() const {
+    size_t total = 0;
+    for (const Block& b : blocks_) total += b.size;
+    return total;
+  }
+  /*! \brief number of blocks, a single one once the iterations do not grow */
+  inline size_t NumBlocks() const {
+    return blocks_.size();
+  }
+
+ private:
+  struct Block {
+    explicit Block(size_t size) : data(new char[size]), size(size) {}
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+  inline void Merge() {
+    if (blocks_.size() <= 1) return;
+    const size_t total = Capacity();
+    blocks_.clear();
+    blocks_.emplace_back(total);
+  }
+  static const size_t kMinBlock = 64 << 10;
+  static const size_t kAlign = alignof(std::max_align_t);
+  std::vector<Block> blocks_;
+  size_t min_block_;
+  // the current block, and the offset of the free memory in it
+  size_t block_;
+  size_t offset_;
+  // number of open scopes
+  int depth_;
+};
+
+/*! \brief allocator of the standard containers on an arena, deallocate does nothing */
+template <typename T>
+struct ArenaAllocator {
+  typedef T value_type;
+  explicit ArenaAllocator(Arena* arena) : arena(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}  // NOLINT(*)
+  inline T* allocate(size_t n) {
+    return static_cast<T*>(arena->Allocate(n * sizeof(T)));
+  }
+  inline void deallocate(T* ptr, size_t n) {}
+  Arena* arena;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena == b.arena;
+}
+template <typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena != b.arena;
+}
+
+/*! \brief vector of scratch memory, it must not outlive the scope it is allocated in */
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+/*! \brief n copies of v on the arena */
+template <typename T>
+inline ArenaVector<T> MakeArenaVector(Arena* arena, size_t n = 0, const T& v = T()) {
+  return ArenaVector<T>(n, v, ArenaAllocator<T>(arena));
+}
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_ARENA_H_
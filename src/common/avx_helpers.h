@@ -4,9 +4,12 @@
  */
 #pragma once
 #include <algorithm>
+#include <cmath>
 #include "xgboost/base.h"
 
 #ifdef XGBOOST_USE_AVX
+#include <immintrin.h>
+
 namespace avx {
 /**
  * \struct  Float8
@@ -165,6 +168,35 @@ inline Float8 ExpAgner(Float8 x) {
   return z;
 }
 
+inline Float8 Exp(Float8 x) {
+  return ExpAgner(x);
+}
+
+inline void Store(float* dst, const Float8& v) {
+  _mm256_storeu_ps(dst, v.x);
+}
+
+inline float HorizontalSum(const Float8& v) {
+  __m128 x = _mm_add_ps(_mm256_castps256_ps128(v.x), _mm256_extractf128_ps(v.x, 1));
+  x = _mm_hadd_ps(x, x);
+  x = _mm_hadd_ps(x, x);
+  return _mm_cvtss_f32(x);
+}
+
+inline float HorizontalMax(const Float8& v) {
+  __m128 x = _mm_max_ps(_mm256_castps256_ps128(v.x), _mm256_extractf128_ps(v.x, 1));
+  x = _mm_max_ps(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 0, 3, 2)));
+  x = _mm_max_ps(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtss_f32(x);
+}
+
+inline float HorizontalMin(const Float8& v) {
+  __m128 x = _mm_min_ps(_mm256_castps256_ps128(v.x), _mm256_extractf128_ps(v.x, 1));
+  x = _mm_min_ps(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 0, 3, 2)));
+  x = _mm_min_ps(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtss_f32(x);
+}
+
 inline Float8 Sigmoid(Float8 x) {
   Float8 exp = ExpAgner(x * Float8(-1.0f));
   x = Float8(1.0f) + exp;
@@ -259,6 +291,43 @@ inline void StoreGpair(xgboost::bst_gpair* dst, const Float8& grad,
   }
 }
 
+inline Float8 Exp(Float8 x) {
+  for (int i = 0; i < 8; i++) {
+    x.x[i] = std::exp(x.x[i]);
+  }
+  return x;
+}
+
+inline void Store(float* dst, const Float8& v) {
+  for (int i = 0; i < 8; i++) {
+    dst[i] = v.x[i];
+  }
+}
+
+inline float HorizontalSum(const Float8& v) {
+  float sum = 0.0f;
+  for (int i = 0; i < 8; i++) {
+    sum += v.x[i];
+  }
+  return sum;
+}
+
+inline float HorizontalMax(const Float8& v) {
+  float max = v.x[0];
+  for (int i = 1; i < 8; i++) {
+    max = std::max(max, v.x[i]);
+  }
+  return max;
+}
+
+inline float HorizontalMin(const Float8& v) {
+  float min = v.x[0];
+  for (int i = 1; i < 8; i++) {
+    min = std::min(min, v.x[i]);
+  }
+  return min;
+}
+
 inline Float8 Sigmoid(Float8 x) {
   Float8 sig;
   for (int i = 0; i < 8; i++) {
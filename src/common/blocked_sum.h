@@ -0,0 +1,62 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file blocked_sum.h
+ * \brief parallel sums whose result does not depend on the number of threads
+ */
+#ifndef XGBOOST_COMMON_BLOCKED_SUM_H_
+#define XGBOOST_COMMON_BLOCKED_SUM_H_
+
+#include <dmlc/omp.h>
+#include <xgboost/base.h>
+#include <algorithm>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+
+/*! \brief number of rows of a block of the blocked sums */
+const size_t kSumBlockRows = 4096;
+
+/*!
+ * \brief add up the sums of nblock blocks pairwise into the first one:
+ *  block b + step is added to block b for the steps 1, 2, 4, ...
+ * \param sums width values per block, overwritten
+ */
+inline void PairwiseSumBlocks(size_t nblock, size_t width, double* sums) {
+  for (size_t step = 1; step < nblock; step *= 2) {
+    for (size_t b = 0; b + step < nblock; b += 2 * step) {
+      double* dst = sums + b * width;
+      const double* src = sums + (b + step) * width;
+      for (size_t k = 0; k < width; ++k) {
+        dst[k] += src[k];
+      }
+    }
+  }
+}
+
+/*!
+ * \brief sum width values over the rows [0, n), in an order that only
+ *  depends on n. The blocks of kSumBlockRows rows are summed in parallel by
+ *  fblock(begin, end, sum), which adds the rows [begin, end) to the width
+ *  values of sum, then the sums of the blocks are added pairwise.
+ * \param out the width sums
+ */
+template <typename Func>
+inline void BlockedSum(size_t n, size_t width, Func fblock, double* out,
+                       int nthread = omp_get_max_threads()) {
+  const size_t nblock = std::max((n + kSumBlockRows - 1) / kSumBlockRows,
+                                 static_cast<size_t>(1));
+  std::vector<double> sums(nblock * width, 0.0);
+  const omp_ulong nb = static_cast<omp_ulong>(nblock);
+  #pragma omp parallel for schedule(static) num_threads(nthread)
+  for (omp_ulong b = 0; b < nb; ++b) {
+    const size_t begin = static_cast<size_t>(b) * kSumBlockRows;
+    fblock(begin, std::min(n, begin + kSumBlockRows), &sums[b * width]);
+  }
+  PairwiseSumBlocks(nblock, width, dmlc::BeginPtr(sums));
+  std::copy(sums.begin(), sums.begin() + width, out);
+}
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_BLOCKED_SUM_H_
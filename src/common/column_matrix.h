@@ -25,10 +25,14 @@ switch (dtype) {                \
   }               \
 }
 
+#include <dmlc/omp.h>
+#include <algorithm>
 #include <type_traits>
 #include <limits>
 #include <vector>
+#include "first_touch.h"
 #include "hist_util.h"
+#include "memory_tracker.h"
 #include "../tree/fast_hist_param.h"
 
 using xgboost::tree::FastHistParam;
@@ -36,13 +40,6 @@ using xgboost::tree::FastHistParam;
 namespace xgboost {
 namespace common {
 
-/*! \brief indicator of data type used for storing bin id's in a column. */
-enum DataType {
-  uint8 = 1,
-  uint16 = 2,
-  uint32 = 4
-};
-
 /*! \brief column type */
 enum ColumnType {
   kDenseColumn,
@@ -96,9 +93,11 @@ class ColumnMatrix {
 
     gmat.GetFeatureCounts(&feature_counts_[0]);
     // classify features
+    const double sparse_threshold = param.adaptive_sparse_threshold ?
+        this->AdaptiveSparseThreshold() : param.sparse_threshold;
     for (bst_uint fid = 0; fid < nfeature; ++fid) {
       if (static_cast<double>(feature_counts_[fid])
-                 < param.sparse_threshold * nrow) {
+                 < sparse_threshold * nrow) {
         type_[fid] = kSparseColumn;
       } else {
         type_[fid] = kDenseColumn;
@@ -123,6 +122,7 @@ class ColumnMatrix {
       boundary_[fid].row_ind_end = accum_row_ind_;
     }
 
+    // left unwritten by resize, every entry is written by the fill below
     index_.resize((boundary_[nfeature - 1].index_end
                    + (packing_factor_ - 1)) / packing_factor_);
     row_ind_.resize(boundary_[nfeature - 1].row_ind_end);
@@ -133,54 +133,17 @@ class ColumnMatrix {
       index_base_[fid] = gmat.cut->row_ptr[fid];
     }
 
-    // pre-fill index_ for dense columns
-    for (bst_uint fid = 0; fid < nfeature; ++fid) {
-      if (type_[fid] == kDenseColumn) {
-        const size_t ibegin = boundary_[fid].index_begin;
-        XGBOOST_TYPE_SWITCH(this->dtype, {
-          const size_t block_offset = ibegin / packing_factor_;
-          const size_t elem_offset = ibegin % packing_factor_;
-          DType* begin = reinterpret_cast<DType*>(&index_[block_offset]) + elem_offset;
-          DType* end = begin + nrow;
-          std::fill(begin, end, std::numeric_limits<DType>::max());
-            // max() indicates missing values
-        });
-      }
-    }
+    XGBOOST_TYPE_SWITCH(this->dtype, {
+      this->FillColumns<DType>(gmat);
+    });
+    memory_.Set(this->MemoryBytes());
+  }
 
-    // loop over all rows and fill column entries
-    // num_nonzeros[fid] = how many nonzeros have this feature accumulated so far?
-    std::vector<size_t> num_nonzeros;
-    num_nonzeros.resize(nfeature);
-    std::fill(num_nonzeros.begin(), num_nonzeros.end(), 0);
-    for (size_t rid = 0; rid < nrow; ++rid) {
-      const size_t ibegin = gmat.row_ptr[rid];
-      const size_t iend = gmat.row_ptr[rid + 1];
-      size_t fid = 0;
-      for (size_t i = ibegin; i < iend; ++i) {
-        const uint32_t bin_id = gmat.index[i];
-        while (bin_id >= gmat.cut->row_ptr[fid + 1]) {
-          ++fid;
-        }
-        if (type_[fid] == kDenseColumn) {
-          XGBOOST_TYPE_SWITCH(this->dtype, {
-            const size_t block_offset = boundary_[fid].index_begin / packing_factor_;
-            const size_t elem_offset = boundary_[fid].index_begin % packing_factor_;
-            DType* begin = reinterpret_cast<DType*>(&index_[block_offset]) + elem_offset;
-            begin[rid] = static_cast<DType>(bin_id - index_base_[fid]);
-          });
-        } else {
-          XGBOOST_TYPE_SWITCH(this->dtype, {
-            const size_t block_offset = boundary_[fid].index_begin / packing_factor_;
-            const size_t elem_offset = boundary_[fid].index_begin % packing_factor_;
-            DType* begin = reinterpret_cast<DType*>(&index_[block_offset]) + elem_offset;
-            begin[num_nonzeros[fid]] = static_cast<DType>(bin_id - index_base_[fid]);
-          });
-          row_ind_[boundary_[fid].row_ind_begin + num_nonzeros[fid]] = rid;
-          ++num_nonzeros[fid];
-        }
-      }
-    }
+  // bytes held by the matrix
+  inline size_t MemoryBytes() const {
+    return (feature_counts_.capacity() + row_ind_.capacity()) * sizeof(size_t) +
+        (index_.capacity() + index_base_.capacity()) * sizeof(uint32_t) +
+        type_.capacity() * sizeof(ColumnType) + boundary_.capacity() * sizeof(ColumnBoundary);
   }
 
   /* Fetch an individual column. This code should be used with XGBOOST_TYPE_SWITCH
@@ -219,16 +182,122 @@ class ColumnMatrix {
     size_t row_ind_end;
   };
 
+  // fraction of the rows below which a sparse column takes less memory than
+  // a dense one, an entry of a sparse column also stores its row
+  inline double AdaptiveSparseThreshold() const {
+    const double bin_bytes = static_cast<double>(this->dtype);
+    return bin_bytes / (bin_bytes + sizeof(size_t));
+  }
+
+  template <typename T>
+  inline void FillColumns(const GHistIndexMatrix& gmat) {
+    XGBOOST_BIN_INDEX_SWITCH(gmat.index, {
+      this->FillColumns<T>(gmat, gmat.index.Reader<DType>());
+    });
+  }
+
+  // fill the columns from the rows of gmat, in blocks of rows in parallel.
+  // The first pass writes the dense columns and counts the entries of the
+  // sparse ones in each block, the second writes the sparse entries of each
+  // block after the ones of the blocks before it, so that the rows of a
+  // sparse column stay sorted.
+  template <typename T, typename BinReaderT>
+  inline void FillColumns(const GHistIndexMatrix& gmat, const BinReaderT& bins) {
+    const size_t nrow = gmat.row_ptr.size() - 1;
+    const bst_uint nfeature = static_cast<bst_uint>(type_.size());
+    const std::vector<uint32_t>& cut_ptr = gmat.cut->row_ptr;
+    std::vector<bst_uint> feature_of_bin(cut_ptr.back());
+    std::vector<T*> columns(nfeature);
+    // number of each sparse feature among the sparse ones
+    std::vector<size_t> sparse_id(nfeature, 0);
+    std::vector<bst_uint> dense_features;
+    size_t nsparse = 0;
+    for (bst_uint fid = 0; fid < nfeature; ++fid) {
+      std::fill(feature_of_bin.begin() + cut_ptr[fid],
+                feature_of_bin.begin() + cut_ptr[fid + 1], fid);
+      const size_t block_offset = boundary_[fid].index_begin / packing_factor_;
+      const size_t elem_offset = boundary_[fid].index_begin % packing_factor_;
+      columns[fid] = reinterpret_cast<T*>(index_.data() + block_offset) + elem_offset;
+      if (type_[fid] == kDenseColumn) {
+        dense_features.push_back(fid);
+      } else {
+        sparse_id[fid] = nsparse++;
+      }
+    }
+    // the blocks are bounded so that their counts stay small
+    const size_t kMaxCounts = 1 << 24;
+    const int nthread = omp_get_max_threads();
+    const size_t nblock = std::max<size_t>(
+        std::min({static_cast<size_t>(nthread), nrow,
+                  kMaxCounts / std::max<size_t>(nsparse, 1)}), 1);
+    const bst_omp_uint nblock_omp = static_cast<bst_omp_uint>(nblock);
+    std::vector<size_t> offsets(nblock * nsparse, 0);
+
+    #pragma omp parallel for num_threads(nthread) schedule(static, 1)
+    for (bst_omp_uint b = 0; b < nblock_omp; ++b) {
+      const size_t rbegin = nrow * b / nblock;
+      const size_t rend = nrow * (b + 1) / nblock;
+      // max() indicates missing values
+      for (bst_uint fid : dense_features) {
+        std::fill(columns[fid] + rbegin, columns[fid] + rend,
+                  std::numeric_limits<T>::max());
+      }
+      size_t* count = dmlc::BeginPtr(offsets) + b * nsparse;
+      for (size_t rid = rbegin; rid < rend; ++rid) {
+        for (size_t i = gmat.row_ptr[rid]; i < gmat.row_ptr[rid + 1]; ++i) {
+          const uint32_t bin_id = bins[i];
+          const bst_uint fid = feature_of_bin[bin_id];
+          if (type_[fid] == kDenseColumn) {
+            columns[fid][rid] = static_cast<T>(bin_id - index_base_[fid]);
+          } else {
+            ++count[sparse_id[fid]];
+          }
+        }
+      }
+    }
+    if (nsparse == 0) return;
+    // offset of the entries of each block in each sparse column
+    const bst_omp_uint nsparse_omp = static_cast<bst_omp_uint>(nsparse);
+    #pragma omp parallel for num_threads(nthread) schedule(static)
+    for (bst_omp_uint k = 0; k < nsparse_omp; ++k) {
+      size_t sum = 0;
+      for (size_t b = 0; b < nblock; ++b) {
+        const size_t count = offsets[b * nsparse + k];
+        offsets[b * nsparse + k] = sum;
+        sum += count;
+      }
+    }
+    #pragma omp parallel for num_threads(nthread) schedule(static, 1)
+    for (bst_omp_uint b = 0; b < nblock_omp; ++b) {
+      const size_t rbegin = nrow * b / nblock;
+      const size_t rend = nrow * (b + 1) / nblock;
+      size_t* offset = dmlc::BeginPtr(offsets) + b * nsparse;
+      for (size_t rid = rbegin; rid < rend; ++rid) {
+        for (size_t i = gmat.row_ptr[rid]; i < gmat.row_ptr[rid + 1]; ++i) {
+          const uint32_t bin_id = bins[i];
+          const bst_uint fid = feature_of_bin[bin_id];
+          if (type_[fid] == kSparseColumn) {
+            const size_t k = offset[sparse_id[fid]]++;
+            columns[fid][k] = static_cast<T>(bin_id - index_base_[fid]);
+            row_ind_[boundary_[fid].row_ind_begin + k] = rid;
+          }
+        }
+      }
+    }
+  }
+
   std::vector<size_t> feature_counts_;
   std::vector<ColumnType> type_;
-  std::vector<uint32_t> index_;  // index_: may store smaller integers; needs padding
-  std::vector<size_t> row_ind_;
+  // index_: may store smaller integers; needs padding
+  FirstTouchVector<uint32_t> index_;
+  FirstTouchVector<size_t> row_ind_;
   std::vector<ColumnBoundary> boundary_;
 
   size_t packing_factor_;  // how many integers are stored in each slot of index_
 
   // index_base_[fid]: least bin id for feature fid
   std::vector<uint32_t> index_base_;
+  TrackedBytes memory_{"ColumnMatrix"};
 };
 
 }  // namespace common
@@ -4,6 +4,7 @@
  * \brief Enable all kinds of global variables in common.
  */
 #include <dmlc/thread_local.h>
+#include "./common.h"
 #include "./random.h"
 
 namespace xgboost {
@@ -19,5 +20,11 @@ typedef dmlc::ThreadLocalStore<RandomThreadLocalEntry> RandomThreadLocalStore;
 GlobalRandomEngine& GlobalRandom() {
   return RandomThreadLocalStore::Get()->engine;
 }
+
+#ifndef XGBOOST_USE_CUDA
+int AllVisibleGPUs() {
+  return 0;
+}
+#endif
 }  // namespace common
 }  // namespace xgboost
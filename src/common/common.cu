@@ -0,0 +1,20 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file common.cu
+ * \brief the parts of common that need the CUDA runtime.
+ */
+#include "./common.h"
+
+namespace xgboost {
+namespace common {
+int AllVisibleGPUs() {
+  int n_visgpus = 0;
+  // no driver or no device is not an error, the CPU methods are used
+  if (cudaGetDeviceCount(&n_visgpus) != cudaSuccess) {
+    cudaGetLastError();
+    return 0;
+  }
+  return n_visgpus;
+}
+}  // namespace common
+}  // namespace xgboost
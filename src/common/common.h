@@ -6,6 +6,7 @@
 #ifndef XGBOOST_COMMON_COMMON_H_
 #define XGBOOST_COMMON_COMMON_H_
 
+#include <dmlc/omp.h>
 #include <vector>
 #include <string>
 #include <sstream>
@@ -35,6 +36,32 @@ inline std::string ToString(const T& data) {
   return os.str();
 }
 
+/*!
+ * \brief set the number of OpenMP threads of the calling thread for the life
+ *  of the scope, the previous number is set back on exit. The number belongs
+ *  to the calling thread only, so boosters called from different threads,
+ *  or in turn from one thread, each run with their own number of threads.
+ */
+class OMPThreadScope {
+ public:
+  /*! \param nthread number of threads, 0 or less keeps the current one */
+  explicit OMPThreadScope(int nthread)
+      : saved_(omp_get_max_threads()), set_(nthread > 0) {
+    if (set_) omp_set_num_threads(nthread);
+  }
+  ~OMPThreadScope() {
+    if (set_) omp_set_num_threads(saved_);
+  }
+  OMPThreadScope(const OMPThreadScope&) = delete;
+  OMPThreadScope& operator=(const OMPThreadScope&) = delete;
+
+ private:
+  int saved_;
+  bool set_;
+};
+
+/*! \brief number of the GPUs the process sees, 0 without GPU support */
+int AllVisibleGPUs();
 }  // namespace common
 }  // namespace xgboost
 #endif  // XGBOOST_COMMON_COMMON_H_
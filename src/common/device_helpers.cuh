@@ -2,6 +2,7 @@
  * Copyright 2017 XGBoost contributors
  */
 #pragma once
+#include <thrust/device_malloc_allocator.h>
 #include <thrust/device_ptr.h>
 #include <thrust/device_vector.h>
 #include <thrust/system/cuda/error.h>
@@ -11,10 +12,13 @@
 #include <chrono>
 #include <ctime>
 #include <cub/cub.cuh>
+#include <mutex>
 #include <numeric>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
+#include "memory_tracker.h"
 
 #ifdef XGBOOST_USE_NCCL
 #include "nccl.h"
@@ -63,13 +67,13 @@ inline ncclResult_t throw_on_nccl_error(ncclResult_t code, const char *file,
 }
 #endif
 
-template <typename T>
-T *raw(thrust::device_vector<T> &v) {  //  NOLINT
+template <typename T, typename AllocatorT>
+T *raw(thrust::device_vector<T, AllocatorT> &v) {  //  NOLINT
   return raw_pointer_cast(v.data());
 }
 
-template <typename T>
-const T *raw(const thrust::device_vector<T> &v) {  //  NOLINT
+template <typename T, typename AllocatorT>
+const T *raw(const thrust::device_vector<T, AllocatorT> &v) {  //  NOLINT
   return raw_pointer_cast(v.data());
 }
 
@@ -269,8 +273,168 @@ inline void launch_n(int device_idx, size_t n, L lambda) {
  * Memory
  */
 
+/**
+ * \class MemoryPool
+ *
+ * \brief Caching allocator of device memory shared by the GPU algorithms.
+ * Freed blocks are kept per device in power of two size classes and reused by
+ * later allocations, a block freed on one stream is only handed to another
+ * stream once the work queued before the free is done. Blocks above the
+ * largest size class are allocated and freed directly.
+ */
+
+class MemoryPool {
+  // size classes from 2^kMinBin to 2^kMaxBin bytes
+  static const unsigned kMinBin = 8;
+  static const unsigned kMaxBin = 26;
+  // maximum number of free bytes cached per device
+  static const size_t kMaxCachedBytes = size_t(1) << 30;
+
+  struct Block {
+    int device_idx;
+    size_t bytes;
+  };
+  struct Usage {
+    size_t current;
+    size_t peak;
+    Usage() : current(0), peak(0) {}
+  };
+
+  cub::CachingDeviceAllocator allocator_;
+  std::mutex mutex_;
+  std::unordered_map<void *, Block> blocks_;
+  std::unordered_map<int, Usage> usage_;
+
+ public:
+  MemoryPool() : allocator_(2, kMinBin, kMaxBin, kMaxCachedBytes, true) {}
+
+  /**
+   * \brief Allocate bytes on the device, for use on the given stream.
+   */
+  void *Allocate(int device_idx, size_t bytes, cudaStream_t stream = nullptr) {
+    void *ptr = nullptr;
+    safe_cuda(allocator_.DeviceAllocate(device_idx, &ptr, bytes, stream));
+    std::lock_guard<std::mutex> guard(mutex_);
+    Block block = {device_idx, bytes};
+    blocks_[ptr] = block;
+    Usage &usage = usage_[device_idx];
+    usage.current += bytes;
+    usage.peak = std::max(usage.peak, usage.current);
+    return ptr;
+  }
+
+  /**
+   * \brief Return a block obtained from Allocate to the pool.
+   */
+  void Free(void *ptr) {
+    if (ptr == nullptr) return;
+    int device_idx;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      auto it = blocks_.find(ptr);
+      CHECK(it != blocks_.end()) << "Freeing memory not owned by the pool";
+      device_idx = it->second.device_idx;
+      usage_[device_idx].current -= it->second.bytes;
+      blocks_.erase(it);
+    }
+    safe_cuda(allocator_.DeviceFree(device_idx, ptr));
+  }
+
+  /**
+   * \brief Release the cached free blocks of all the devices.
+   */
+  void FreeCached() { safe_cuda(allocator_.FreeAllCached()); }
+
+  /**
+   * \brief Number of bytes currently allocated from the pool on the device.
+   */
+  size_t CurrentBytes(int device_idx) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return usage_[device_idx].current;
+  }
+
+  /**
+   * \brief Largest number of bytes allocated at once from the pool on the
+   * device.
+   */
+  size_t PeakBytes(int device_idx) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return usage_[device_idx].peak;
+  }
+};
+
+inline MemoryPool &GlobalMemoryPool() {
+  // never destroyed, the CUDA runtime may shut down before static destructors
+  static MemoryPool *pool = new MemoryPool();
+  return *pool;
+}
+
+/**
+ * \brief Thrust allocator drawing from the global memory pool on the current
+ * device.
+ */
+template <typename T>
+struct caching_allocator : thrust::device_malloc_allocator<T> {
+  typedef thrust::device_malloc_allocator<T> super_t;
+  typedef typename super_t::pointer pointer;
+  typedef typename super_t::size_type size_type;
+  template <typename U>
+  struct rebind {
+    typedef caching_allocator<U> other;
+  };
+
+  pointer allocate(size_type n) {
+    int device_idx;
+    safe_cuda(cudaGetDevice(&device_idx));
+    return pointer(static_cast<T *>(
+        GlobalMemoryPool().Allocate(device_idx, n * sizeof(T))));
+  }
+  void deallocate(pointer ptr, size_type n) {
+    GlobalMemoryPool().Free(ptr.get());
+  }
+};
+
+template <typename T>
+using device_vector = thrust::device_vector<T, caching_allocator<T>>;
+
 enum memory_type { DEVICE, DEVICE_MANAGED };
 
+/**
+ * \brief Whether the device pages managed memory on demand, so managed
+ * allocations may exceed the device memory and accept prefetch hints.
+ */
+inline bool managed_oversubscription(int device_idx) {
+  int concurrent = 0;
+  safe_cuda(cudaDeviceGetAttribute(
+      &concurrent, cudaDevAttrConcurrentManagedAccess, device_idx));
+  return concurrent != 0;
+}
+
+/**
+ * \brief Advise that the managed range lives on the device, read mostly
+ * ranges may also be duplicated on the other processors reading them.
+ */
+inline void advise_managed(int device_idx, const void *ptr, size_t bytes,
+                           bool read_mostly) {
+  if (bytes == 0 || !managed_oversubscription(device_idx)) return;
+  safe_cuda(cudaMemAdvise(ptr, bytes, cudaMemAdviseSetPreferredLocation,
+                          device_idx));
+  if (read_mostly) {
+    safe_cuda(cudaMemAdvise(ptr, bytes, cudaMemAdviseSetReadMostly,
+                            device_idx));
+  }
+}
+
+/**
+ * \brief Migrate the managed range to the device ahead of the kernels
+ * using it, instead of faulting it in page by page.
+ */
+inline void prefetch_managed(int device_idx, const void *ptr, size_t bytes,
+                             cudaStream_t stream = nullptr) {
+  if (bytes == 0 || !managed_oversubscription(device_idx)) return;
+  safe_cuda(cudaMemPrefetchAsync(ptr, bytes, device_idx, stream));
+}
+
 template <memory_type MemoryT>
 class bulk_allocator;
 template <typename T>
@@ -327,6 +491,16 @@ class dvec {
     std::cout << "\n";
   }
 
+  // hints for a dvec in managed memory, see dh::advise_managed and
+  // dh::prefetch_managed
+  void advise_managed(bool read_mostly) const {
+    dh::advise_managed(_device_idx, _ptr, size() * sizeof(T), read_mostly);
+  }
+
+  void prefetch_managed(cudaStream_t stream = nullptr) const {
+    dh::prefetch_managed(_device_idx, _ptr, size() * sizeof(T), stream);
+  }
+
   thrust::device_ptr<T> tbegin() { return thrust::device_pointer_cast(_ptr); }
 
   thrust::device_ptr<T> tend() {
@@ -427,6 +601,9 @@ class bulk_allocator {
   std::vector<char *> d_ptr;
   std::vector<size_t> _size;
   std::vector<int> _device_idx;
+  std::vector<memory_type> _type;
+  memory_type _next_type = MemoryT;
+  xgboost::common::TrackedBytes _memory{"device.bulk_allocator"};
 
   const int align = 256;
 
@@ -461,10 +638,13 @@ class bulk_allocator {
   }
 
   char *allocate_device(int device_idx, size_t bytes, memory_type t) {
-    char *ptr;
     safe_cuda(cudaSetDevice(device_idx));
-    safe_cuda(cudaMalloc(&ptr, bytes));
-    return ptr;
+    if (t == DEVICE_MANAGED) {
+      char *ptr;
+      safe_cuda(cudaMallocManaged(&ptr, bytes));
+      return ptr;
+    }
+    return static_cast<char *>(GlobalMemoryPool().Allocate(device_idx, bytes));
   }
   template <typename T>
   size_t get_size_bytes(dvec2<T> *first_vec, size_t first_size) {
@@ -504,8 +684,12 @@ class bulk_allocator {
   ~bulk_allocator() {
     for (size_t i = 0; i < d_ptr.size(); i++) {
       if (!(d_ptr[i] == nullptr)) {
-        safe_cuda(cudaSetDevice(_device_idx[i]));
-        safe_cuda(cudaFree(d_ptr[i]));
+        if (_type[i] == DEVICE_MANAGED) {
+          safe_cuda(cudaSetDevice(_device_idx[i]));
+          safe_cuda(cudaFree(d_ptr[i]));
+        } else {
+          GlobalMemoryPool().Free(d_ptr[i]);
+        }
         d_ptr[i] = nullptr;
       }
     }
@@ -516,23 +700,35 @@ class bulk_allocator {
     return std::accumulate(_size.begin(), _size.end(), static_cast<size_t>(0));
   }
 
+  // memory type of the following allocations, managed memory may exceed the
+  // capacity of the device on devices paging it on demand
+  void set_memory_type(memory_type t) { _next_type = t; }
+
   template <typename... Args>
   void allocate(int device_idx, bool silent, Args... args) {
     size_t size = get_size_bytes(args...);
 
-    char *ptr = allocate_device(device_idx, size, MemoryT);
+    char *ptr = allocate_device(device_idx, size, _next_type);
 
     allocate_dvec(device_idx, ptr, args...);
 
     d_ptr.push_back(ptr);
     _size.push_back(size);
     _device_idx.push_back(device_idx);
+    _type.push_back(_next_type);
+    _memory.Set(this->size());
 
     if (!silent) {
       const int mb_size = 1048576;
-      LOG(CONSOLE) << "Allocated " << size / mb_size << "MB on [" << device_idx
+      LOG(CONSOLE) << "Allocated " << size / mb_size
+                   << (_next_type == DEVICE_MANAGED ? "MB managed" : "MB")
+                   << " on [" << device_idx
                    << "] " << device_name(device_idx) << ", "
-                   << available_memory(device_idx) / mb_size << "MB remaining.";
+                   << available_memory(device_idx) / mb_size << "MB remaining, "
+                   << GlobalMemoryPool().CurrentBytes(device_idx) / mb_size
+                   << "MB in use (peak "
+                   << GlobalMemoryPool().PeakBytes(device_idx) / mb_size
+                   << "MB).";
     }
   }
 };
@@ -556,14 +752,18 @@ struct CubMemory {
 
   void Free() {
     if (this->IsAllocated()) {
-      safe_cuda(cudaFree(d_temp_storage));
+      GlobalMemoryPool().Free(d_temp_storage);
+      d_temp_storage = nullptr;
+      temp_storage_bytes = 0;
     }
   }
 
   void LazyAllocate(size_t num_bytes) {
     if (num_bytes > temp_storage_bytes) {
       Free();
-      safe_cuda(cudaMalloc(&d_temp_storage, num_bytes));
+      int device_idx;
+      safe_cuda(cudaGetDevice(&device_idx));
+      d_temp_storage = GlobalMemoryPool().Allocate(device_idx, num_bytes);
       temp_storage_bytes = num_bytes;
     }
   }
@@ -859,7 +1059,17 @@ class AllReducer {
 #ifdef XGBOOST_USE_NCCL
   std::vector<ncclComm_t> comms;
   std::vector<cudaStream_t> streams;
+  std::vector<cudaEvent_t> events;
   std::vector<int> device_ordinals;
+
+  // Order the communication stream of the group after the work queued on the
+  // default stream of its device. The communication streams do not block on
+  // the default stream, so kernels queued after an allreduce overlap with it.
+  void WaitDefaultStream(int communication_group_idx) {
+    dh::safe_cuda(cudaEventRecord(events[communication_group_idx], 0));
+    dh::safe_cuda(cudaStreamWaitEvent(streams[communication_group_idx],
+                                      events[communication_group_idx], 0));
+  }
 #endif
  public:
   AllReducer() : initialised(false) {}
@@ -881,9 +1091,11 @@ class AllReducer {
                                   static_cast<int>(device_ordinals.size()),
                                   device_ordinals.data()));
     streams.resize(device_ordinals.size());
+    events.resize(device_ordinals.size());
     for (size_t i = 0; i < device_ordinals.size(); i++) {
       safe_cuda(cudaSetDevice(device_ordinals[i]));
-      safe_cuda(cudaStreamCreate(&streams[i]));
+      safe_cuda(cudaStreamCreateWithFlags(&streams[i], cudaStreamNonBlocking));
+      safe_cuda(cudaEventCreateWithFlags(&events[i], cudaEventDisableTiming));
     }
     initialised = true;
 #else
@@ -896,6 +1108,9 @@ class AllReducer {
       for (auto &stream : streams) {
         dh::safe_cuda(cudaStreamDestroy(stream));
       }
+      for (auto &event : events) {
+        dh::safe_cuda(cudaEventDestroy(event));
+      }
       for (auto &comm : comms) {
         ncclCommDestroy(comm);
       }
@@ -909,6 +1124,7 @@ class AllReducer {
    *
    * \brief Allreduce. Use in exactly the same way as NCCL but without needing
    * streams or comms.
+   * The call is asynchronous, the result is available after Synchronize().
    *
    * \param           communication_group_idx Zero-based index of the
    * communication group. \param sendbuff                The sendbuff. \param
@@ -922,12 +1138,40 @@ class AllReducer {
     CHECK(initialised);
 
     dh::safe_cuda(cudaSetDevice(device_ordinals[communication_group_idx]));
+    WaitDefaultStream(communication_group_idx);
     dh::safe_nccl(ncclAllReduce(sendbuff, recvbuff, count, ncclDouble, ncclSum,
                                 comms[communication_group_idx],
                                 streams[communication_group_idx]));
 #endif
   }
 
+  /**
+   * \fn  void AllReduceSum(int communication_group_idx, const float *sendbuff,
+   * float *recvbuff, int count)
+   *
+   * \brief Allreduce in single precision, used to halve the traffic of
+   * histograms.
+   *
+   * \param           communication_group_idx Zero-based index of the
+   * communication group.
+   * \param           sendbuff                The sendbuff.
+   * \param [in,out]  recvbuff                The recvbuff.
+   * \param           count                   Number of.
+   */
+
+  void AllReduceSum(int communication_group_idx, const float *sendbuff,
+                    float *recvbuff, int count) {
+#ifdef XGBOOST_USE_NCCL
+    CHECK(initialised);
+
+    dh::safe_cuda(cudaSetDevice(device_ordinals[communication_group_idx]));
+    WaitDefaultStream(communication_group_idx);
+    dh::safe_nccl(ncclAllReduce(sendbuff, recvbuff, count, ncclFloat, ncclSum,
+                                comms[communication_group_idx],
+                                streams[communication_group_idx]));
+#endif
+  }
+
   /**
    * \fn  void AllReduceSum(int communication_group_idx, const int64_t *sendbuff, int64_t *recvbuff, int count)
    *
@@ -948,6 +1192,7 @@ class AllReducer {
     CHECK(initialised);
 
     dh::safe_cuda(cudaSetDevice(device_ordinals[communication_group_idx]));
+    WaitDefaultStream(communication_group_idx);
     dh::safe_nccl(ncclAllReduce(sendbuff, recvbuff, count, ncclInt64, ncclSum,
                                 comms[communication_group_idx],
                                 streams[communication_group_idx]));
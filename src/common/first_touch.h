@@ -0,0 +1,51 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file first_touch.h
+ * \brief allocator for the large arrays filled by parallel loops
+ */
+#ifndef XGBOOST_COMMON_FIRST_TOUCH_H_
+#define XGBOOST_COMMON_FIRST_TOUCH_H_
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+
+/*!
+ * \brief allocator whose resize leaves the new elements default initialized,
+ *  i.e. not written at all for the scalar types. The memory is then first
+ *  touched by the threads of the loop filling it, which on NUMA hosts puts
+ *  the pages on the node of the threads that later read them with the same
+ *  static schedule.
+ */
+template <typename T>
+class FirstTouchAllocator : public std::allocator<T> {
+ public:
+  template <typename U>
+  struct rebind {
+    typedef FirstTouchAllocator<U> other;
+  };
+  FirstTouchAllocator() = default;
+  template <typename U>
+  FirstTouchAllocator(const FirstTouchAllocator<U>&) {}  // NOLINT(*)
+
+  template <typename U>
+  void construct(U* p) {
+    ::new (static_cast<void*>(p)) U;
+  }
+  template <typename U, typename... Args>
+  void construct(U* p, Args&&... args) {
+    ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+};
+
+/*! \brief vector whose resize leaves the scalar elements unwritten */
+template <typename T>
+using FirstTouchVector = std::vector<T, FirstTouchAllocator<T> >;
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_FIRST_TOUCH_H_
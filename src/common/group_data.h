@@ -14,6 +14,8 @@
 #ifndef XGBOOST_COMMON_GROUP_DATA_H_
 #define XGBOOST_COMMON_GROUP_DATA_H_
 
+#include <dmlc/omp.h>
+#include <xgboost/base.h>
 #include <vector>
 
 namespace xgboost {
@@ -72,18 +74,33 @@ struct ParallelGroupBuilder {
         rptr.resize(thread_rptr[tid].size() + 1);
       }
     }
-    // initialize rptr to be beginning of each segment
+    // size of each key, then its segment by a prefix sum
+    const omp_ulong nkeys = static_cast<omp_ulong>(rptr.size() - 1);
+    #pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < nkeys; ++i) {
+      SizeType ncnt = 0;
+      for (size_t tid = 0; tid < thread_rptr.size(); ++tid) {
+        if (i < thread_rptr[tid].size()) ncnt += thread_rptr[tid][i];
+      }
+      rptr[i + 1] = ncnt;
+    }
     size_t start = 0;
     for (size_t i = 0; i + 1 < rptr.size(); ++i) {
+      start += rptr[i + 1];
+      rptr[i + 1] = start;
+    }
+    // initialize the thread pointers to be beginning of each thread in a segment
+    #pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < nkeys; ++i) {
+      size_t begin = i == 0 ? 0 : rptr[i];
       for (size_t tid = 0; tid < thread_rptr.size(); ++tid) {
         std::vector<SizeType> &trptr = thread_rptr[tid];
         if (i < trptr.size()) {
           size_t ncnt = trptr[i];
-          trptr[i] = start;
-          start += ncnt;
+          trptr[i] = begin;
+          begin += ncnt;
         }
       }
-      rptr[i + 1] = start;
     }
     data.resize(start);
   }
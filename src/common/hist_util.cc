@@ -5,7 +5,13 @@
  * \author Philip Cho, Tianqi Chen
  */
 #include <dmlc/omp.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define XGBOOST_SSE2_LANE
+#endif
+#include <algorithm>
 #include <numeric>
+#include <random>
 #include <vector>
 #include "./sync.h"
 #include "./random.h"
@@ -16,12 +22,8 @@
 namespace xgboost {
 namespace common {
 
-void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins) {
-  typedef common::WXQuantileSketch<bst_float, bst_float> WXQSketch;
+void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins, float sample_rate) {
   const MetaInfo& info = p_fmat->info();
-
-  // safe factor for better accuracy
-  const int kFactor = 8;
   std::vector<WXQSketch> sketchs;
 
   const int nthread = omp_get_max_threads();
@@ -30,13 +32,25 @@ void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins) {
   unsigned ncol = static_cast<unsigned>(info.num_col);
   sketchs.resize(info.num_col);
   for (auto& s : sketchs) {
-    s.Init(info.num_row, 1.0 / (max_num_bins * kFactor));
+    s.Init(info.num_row, 1.0 / (max_num_bins * kSketchFactor));
   }
+  // whether a feature got an entry, the first entry of a feature is always
+  // pushed so that sampling leaves no present feature without cuts
+  std::vector<char> seen(info.num_col, 0);
+  std::vector<char> sampled;
+  std::bernoulli_distribution coin_flip(sample_rate);
+  auto& rnd = common::GlobalRandom();
 
   dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
   iter->BeforeFirst();
   while (iter->Next()) {
     const RowBatch& batch = iter->Value();
+    if (sample_rate < 1.0f) {
+      sampled.resize(batch.size);
+      for (size_t i = 0; i < batch.size; ++i) {
+        sampled[i] = coin_flip(rnd);
+      }
+    }
     #pragma omp parallel num_threads(nthread)
     {
       CHECK_EQ(nthread, omp_get_num_threads());
@@ -45,10 +59,13 @@ void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins) {
       unsigned end = std::min(nstep * (tid + 1), ncol);
       for (size_t i = 0; i < batch.size; ++i) { // NOLINT(*)
         size_t ridx = batch.base_rowid + i;
+        const bool keep = sample_rate >= 1.0f || sampled[i];
         RowBatch::Inst inst = batch[i];
         for (bst_uint j = 0; j < inst.length; ++j) {
-          if (inst[j].index >= begin && inst[j].index < end) {
-            sketchs[inst[j].index].Push(inst[j].fvalue, info.GetWeight(ridx));
+          const bst_uint fid = inst[j].index;
+          if (fid >= begin && fid < end && (keep || !seen[fid])) {
+            sketchs[fid].Push(inst[j].fvalue, info.GetWeight(ridx));
+            seen[fid] = 1;
           }
         }
       }
@@ -56,39 +73,43 @@ void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins) {
   }
 
   // gather the histogram data
-  rabit::SerializeReducer<WXQSketch::SummaryContainer> sreducer;
   std::vector<WXQSketch::SummaryContainer> summary_array;
-  summary_array.resize(sketchs.size());
-  for (size_t i = 0; i < sketchs.size(); ++i) {
-    WXQSketch::SummaryContainer out;
-    sketchs[i].GetSummary(&out);
-    summary_array[i].Reserve(max_num_bins * kFactor);
-    summary_array[i].SetPrune(out, max_num_bins * kFactor);
-  }
-  size_t nbytes = WXQSketch::SummaryContainer::CalcMemCost(max_num_bins * kFactor);
+  PruneSketchSummaries(&sketchs, max_num_bins * kSketchFactor, &summary_array);
+  this->Init(&summary_array, max_num_bins);
+}
+
+void HistCutMatrix::Init(std::vector<WXQSketch::SummaryContainer>* p_summary_array,
+                         uint32_t max_num_bins) {
+  std::vector<WXQSketch::SummaryContainer>& summary_array = *p_summary_array;
+  rabit::SerializeReducer<WXQSketch::SummaryContainer> sreducer;
+  size_t nbytes = WXQSketch::SummaryContainer::CalcMemCost(max_num_bins * kSketchFactor);
   sreducer.Allreduce(dmlc::BeginPtr(summary_array), nbytes, summary_array.size());
 
-  this->min_val.resize(info.num_col);
-  row_ptr.push_back(0);
-  for (size_t fid = 0; fid < summary_array.size(); ++fid) {
+  // the cuts of each feature are extracted in parallel, then concatenated
+  this->min_val.resize(summary_array.size());
+  std::vector<std::vector<bst_float> > feature_cuts(summary_array.size());
+  const bst_omp_uint nfeature = static_cast<bst_omp_uint>(summary_array.size());
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (bst_omp_uint fid = 0; fid < nfeature; ++fid) {
     WXQSketch::SummaryContainer a;
     a.Reserve(max_num_bins);
     a.SetPrune(summary_array[fid], max_num_bins);
+    std::vector<bst_float>& fcut = feature_cuts[fid];
     const bst_float mval = a.data[0].value;
     this->min_val[fid] = mval - (fabs(mval) + 1e-5);
     if (a.size > 1 && a.size <= 16) {
       /* specialized code categorial / ordinal data -- use midpoints */
       for (size_t i = 1; i < a.size; ++i) {
         bst_float cpt = (a.data[i].value + a.data[i - 1].value) / 2.0f;
-        if (i == 1 || cpt > cut.back()) {
-          cut.push_back(cpt);
+        if (i == 1 || cpt > fcut.back()) {
+          fcut.push_back(cpt);
         }
       }
     } else {
       for (size_t i = 2; i < a.size; ++i) {
         bst_float cpt = a.data[i - 1].value;
-        if (i == 2 || cpt > cut.back()) {
-          cut.push_back(cpt);
+        if (i == 2 || cpt > fcut.back()) {
+          fcut.push_back(cpt);
         }
       }
     }
@@ -97,64 +118,197 @@ void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins) {
       bst_float cpt = a.data[a.size - 1].value;
       // this must be bigger than last value in a scale
       bst_float last = cpt + (fabs(cpt) + 1e-5);
-      cut.push_back(last);
+      fcut.push_back(last);
     }
-
+  }
+  row_ptr.push_back(0);
+  for (size_t fid = 0; fid < feature_cuts.size(); ++fid) {
+    cut.insert(cut.end(), feature_cuts[fid].begin(), feature_cuts[fid].end());
     row_ptr.push_back(static_cast<bst_uint>(cut.size()));
   }
 }
 
+// quantize the rows of the batch into index, whose rows start at row_ptr
+template <typename T>
+static void QuantizeBatch(const RowBatch& batch, const HistCutMatrix& cut,
+                          const size_t* row_ptr, int nthread,
+                          size_t* hit_count_tloc, T* index) {
+  const uint32_t nbins = cut.row_ptr.back();
+  omp_ulong bsize = static_cast<omp_ulong>(batch.size);
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (omp_ulong i = 0; i < bsize; ++i) { // NOLINT(*)
+    const int tid = omp_get_thread_num();
+    size_t ibegin = row_ptr[i];
+    size_t iend = row_ptr[i + 1];
+    RowBatch::Inst inst = batch[i];
+    CHECK_EQ(ibegin + inst.length, iend);
+    for (bst_uint j = 0; j < inst.length; ++j) {
+      unsigned fid = inst[j].index;
+      auto cbegin = cut.cut.begin() + cut.row_ptr[fid];
+      auto cend = cut.cut.begin() + cut.row_ptr[fid + 1];
+      CHECK(cbegin != cend);
+      auto it = std::upper_bound(cbegin, cend, inst[j].fvalue);
+      if (it == cend) it = cend - 1;
+      uint32_t idx = static_cast<uint32_t>(it - cut.cut.begin());
+      index[ibegin + j] = static_cast<T>(idx);
+      ++hit_count_tloc[tid * nbins + idx];
+    }
+    std::sort(index + ibegin, index + iend);
+  }
+}
+
+// bit pack the n entries of data into buffer, every chunk has a multiple of
+// 8 entries so that it starts on a byte
+template <typename T>
+static void PackBins(const T* data, size_t n, uint32_t nbins, compressed_byte_t* buffer) {
+  const size_t bits = detail::SymbolBits(nbins);
+  const int nthread = omp_get_max_threads();
+  const size_t chunk = ((n + nthread - 1) / nthread + 7) / 8 * 8;
+  const bst_omp_uint nchunk = static_cast<bst_omp_uint>(chunk == 0 ? 0 : (n + chunk - 1) / chunk);
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint c = 0; c < nchunk; ++c) {
+    const size_t begin = c * chunk;
+    const size_t end = std::min(begin + chunk, n);
+    CompressedBufferWriter writer(nbins);
+    writer.Write(buffer + begin * bits / 8, data + begin, data + end);
+  }
+}
+
+template <typename T>
+static void UnpackBins(const BinReader<PackedBin>& reader, size_t n, T* data) {
+  const omp_ulong size = static_cast<omp_ulong>(n);
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < size; ++i) {
+    data[i] = static_cast<T>(reader[i]);
+  }
+}
+
+void BinIndex::Pack(uint32_t nbins) {
+  if (packed_) return;
+  const size_t n = this->size();
+  FirstTouchVector<uint8_t> packed(CompressedBufferWriter::CalculateBufferSize(n, nbins));
+  std::fill(packed.begin(), packed.begin() + detail::padding, 0);
+  XGBOOST_TYPE_SWITCH(dtype_, {
+    PackBins(this->data<DType>(), n, nbins, packed.data());
+  });
+  data_.swap(packed);
+  nbins_ = nbins;
+  packed_size_ = n;
+  packed_ = true;
+}
+
+void BinIndex::Unpack() {
+  if (!packed_) return;
+  FirstTouchVector<uint8_t> unpacked(packed_size_ * dtype_);
+  XGBOOST_TYPE_SWITCH(dtype_, {
+    UnpackBins(this->Reader<PackedBin>(), packed_size_,
+               reinterpret_cast<DType*>(unpacked.data()));
+  });
+  data_.swap(unpacked);
+  packed_ = false;
+}
+
 void GHistIndexMatrix::Init(DMatrix* p_fmat) {
   CHECK(cut != nullptr);
   dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    this->PushBatch(iter->Value());
+  }
+}
 
+void GHistIndexMatrix::PushBatch(const RowBatch& batch) {
+  CHECK(cut != nullptr);
+  CHECK_GT(cut->cut.size(), 0U);
+  CHECK_EQ(cut->row_ptr.back(), cut->cut.size());
   const int nthread = omp_get_max_threads();
   const uint32_t nbins = cut->row_ptr.back();
-  hit_count.resize(nbins, 0);
-  hit_count_tloc_.resize(nthread * nbins, 0);
+  if (row_ptr.empty()) {
+    hit_count.assign(nbins, 0);
+    index.SetBinCount(nbins);
+    row_ptr.push_back(0);
+  }
+  hit_count_tloc_.assign(nthread * nbins, 0);
+  // the rows are appended to the index as chosen by SetBinCount
+  const bool packed = index.packed();
+  index.Unpack();
 
-  iter->BeforeFirst();
-  row_ptr.push_back(0);
-  while (iter->Next()) {
-    const RowBatch& batch = iter->Value();
-    const size_t rbegin = row_ptr.size() - 1;
-    for (size_t i = 0; i < batch.size; ++i) {
-      row_ptr.push_back(batch[i].length + row_ptr.back());
+  const size_t rbegin = row_ptr.size() - 1;
+  for (size_t i = 0; i < batch.size; ++i) {
+    row_ptr.push_back(batch[i].length + row_ptr.back());
+  }
+  index.resize(row_ptr.back());
+
+  XGBOOST_TYPE_SWITCH(index.dtype(), {
+    QuantizeBatch(batch, *cut, dmlc::BeginPtr(row_ptr) + rbegin, nthread,
+                  dmlc::BeginPtr(hit_count_tloc_), index.data<DType>());
+  });
+
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint idx = 0; idx < bst_omp_uint(nbins); ++idx) {
+    for (int tid = 0; tid < nthread; ++tid) {
+      hit_count[idx] += hit_count_tloc_[tid * nbins + idx];
     }
-    index.resize(row_ptr.back());
+  }
+  if (packed) index.Pack(nbins);
+  memory_.Set(this->MemoryBytes());
+}
 
-    CHECK_GT(cut->cut.size(), 0U);
-    CHECK_EQ(cut->row_ptr.back(), cut->cut.size());
+GHistIndexPagedMatrix::~GHistIndexPagedMatrix() {
+  if (page_ != nullptr) {
+    prefetcher_->Recycle(&page_);
+  }
+}
 
-    omp_ulong bsize = static_cast<omp_ulong>(batch.size);
-    #pragma omp parallel for num_threads(nthread) schedule(static)
-    for (omp_ulong i = 0; i < bsize; ++i) { // NOLINT(*)
-      const int tid = omp_get_thread_num();
-      size_t ibegin = row_ptr[rbegin + i];
-      size_t iend = row_ptr[rbegin + i + 1];
-      RowBatch::Inst inst = batch[i];
-      CHECK_EQ(ibegin + inst.length, iend);
-      for (bst_uint j = 0; j < inst.length; ++j) {
-        unsigned fid = inst[j].index;
-        auto cbegin = cut->cut.begin() + cut->row_ptr[fid];
-        auto cend = cut->cut.begin() + cut->row_ptr[fid + 1];
-        CHECK(cbegin != cend);
-        auto it = std::upper_bound(cbegin, cend, inst[j].fvalue);
-        if (it == cend) it = cend - 1;
-        uint32_t idx = static_cast<uint32_t>(it - cut->cut.begin());
-        index[ibegin + j] = idx;
-        ++hit_count_tloc_[tid * nbins + idx];
+void GHistIndexPagedMatrix::Init(DMatrix* p_fmat, const std::string& cache_file) {
+  CHECK(cut != nullptr);
+  hit_count.assign(cut->row_ptr.back(), 0);
+  num_pages_ = 0;
+  {
+    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(cache_file.c_str(), "w"));
+    dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const RowBatch& batch = iter->Value();
+      GHistIndexMatrix page;
+      page.cut = cut;
+      page.base_rowid = batch.base_rowid;
+      page.PushBatch(batch);
+      for (size_t i = 0; i < hit_count.size(); ++i) {
+        hit_count[i] += page.hit_count[i];
       }
-      std::sort(index.begin() + ibegin, index.begin() + iend);
+      // the totals are kept here, not in every page
+      page.hit_count.clear();
+      page.Save(fo.get());
+      ++num_pages_;
     }
+  }
 
-    #pragma omp parallel for num_threads(nthread) schedule(static)
-    for (bst_omp_uint idx = 0; idx < bst_omp_uint(nbins); ++idx) {
-      for (int tid = 0; tid < nthread; ++tid) {
-        hit_count[idx] += hit_count_tloc_[tid * nbins + idx];
+  fi_.reset(dmlc::SeekStream::CreateForRead(cache_file.c_str()));
+  dmlc::SeekStream* fi = fi_.get();
+  const HistCutMatrix* page_cut = cut;
+  prefetcher_.reset(new dmlc::ThreadedIter<GHistIndexMatrix>(2));
+  prefetcher_->Init([fi, page_cut](GHistIndexMatrix** dptr) {
+      if (*dptr == nullptr) {
+        *dptr = new GHistIndexMatrix();
       }
-    }
+      (*dptr)->cut = page_cut;
+      return (*dptr)->Load(fi);
+    }, [fi]() { fi->Seek(0); });
+}
+
+void GHistIndexPagedMatrix::BeforeFirst() {
+  if (page_ != nullptr) {
+    prefetcher_->Recycle(&page_);
   }
+  prefetcher_->BeforeFirst();
+}
+
+bool GHistIndexPagedMatrix::Next() {
+  if (page_ != nullptr) {
+    prefetcher_->Recycle(&page_);
+  }
+  return prefetcher_->Next(&page_);
 }
 
 template <typename T>
@@ -217,8 +371,10 @@ FindGroups_(const std::vector<unsigned>& feature_list,
   std::vector<std::vector<bool>> conflict_marks;
   std::vector<size_t> group_nnz;
   std::vector<size_t> group_conflict_cnt;
+  const double max_conflict_rate =
+      param.exclusive_feature_bundling ? 0.0 : param.max_conflict_rate;
   const size_t max_conflict_cnt
-    = static_cast<size_t>(param.max_conflict_rate * nrow);
+    = static_cast<size_t>(max_conflict_rate * nrow);
 
   for (auto fid : feature_list) {
     const Column<T>& column = colmat.GetColumn<T>(fid);
@@ -301,8 +457,9 @@ FastFeatureGrouping(const GHistIndexMatrix& gmat,
   auto groups_alt2 = FindGroups(features_by_nnz, feature_nnz, colmat, nrow, param);
   auto& groups = (groups_alt1.size() > groups_alt2.size()) ? groups_alt2 : groups_alt1;
 
-  // take apart small, sparse groups, as it won't help speed
-  {
+  // take apart small, sparse groups, as it won't help speed. The bundles
+  // of exclusive features are stored densely, they are kept whole.
+  if (!param.exclusive_feature_bundling) {
     std::vector<std::vector<unsigned>> ret;
     for (const auto& group : groups) {
       if (group.size() <= 1 || group.size() >= 5) {
@@ -333,10 +490,16 @@ FastFeatureGrouping(const GHistIndexMatrix& gmat,
   return groups;
 }
 
+const uint32_t GHistIndexBlock::kNoBin;
+
 void GHistIndexBlockMatrix::Init(const GHistIndexMatrix& gmat,
                                  const ColumnMatrix& colmat,
                                  const FastHistParam& param) {
   cut = gmat.cut;
+  row_ptr.clear();
+  index.clear();
+  bundle.clear();
+  blocks.clear();
 
   const size_t nrow = gmat.row_ptr.size() - 1;
   const uint32_t nbins = gmat.cut->row_ptr.back();
@@ -356,6 +519,28 @@ void GHistIndexBlockMatrix::Init(const GHistIndexMatrix& gmat,
       }
     }
   }
+  if (param.exclusive_feature_bundling) {
+    // a row has at most one entry in each bundle
+    bundle.assign(static_cast<size_t>(nblock) * nrow, GHistIndexBlock::kNoBin);
+    const bst_omp_uint nrow_omp = static_cast<bst_omp_uint>(nrow);
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint rid = 0; rid < nrow_omp; ++rid) {
+      for (size_t j = gmat.row_ptr[rid]; j < gmat.row_ptr[rid + 1]; ++j) {
+        const uint32_t bin_id = gmat.index[j];
+        bundle[bin2block[bin_id] * nrow + rid] = bin_id;
+      }
+    }
+    for (uint32_t block_id = 0; block_id < nblock; ++block_id) {
+      Block blk;
+      blk.row_ptr_begin = blk.row_ptr_end = nullptr;
+      blk.index_begin = blk.index_end = nullptr;
+      blk.bundle_begin = bundle.data() + static_cast<size_t>(block_id) * nrow;
+      blocks.push_back(blk);
+    }
+    memory_.Set(this->MemoryBytes());
+    return;
+  }
+
   std::vector<std::vector<uint32_t>> index_temp(nblock);
   std::vector<std::vector<size_t>> row_ptr_temp(nblock);
   for (uint32_t block_id = 0; block_id < nblock; ++block_id) {
@@ -393,70 +578,343 @@ void GHistIndexBlockMatrix::Init(const GHistIndexMatrix& gmat,
     blk.row_ptr_begin = &row_ptr[row_ptr_blk_ptr[block_id]];
     blk.index_end = &index[index_blk_ptr[block_id + 1]];
     blk.row_ptr_end = &row_ptr[row_ptr_blk_ptr[block_id + 1]];
+    blk.bundle_begin = nullptr;
     blocks.push_back(blk);
   }
+  memory_.Set(this->MemoryBytes());
 }
 
-void GHistBuilder::BuildHist(const std::vector<bst_gpair>& gpair,
-                             const RowSetCollection::Elem row_indices,
-                             const GHistIndexMatrix& gmat,
-                             const std::vector<bst_uint>& feat_set,
-                             GHistRow hist) {
-  data_.resize(nbins_ * nthread_, GHistEntry());
-  std::fill(data_.begin(), data_.end(), GHistEntry());
+/*! \brief nodes with at most this many entries are built by one thread */
+static const size_t kSerialHistEntries = 1 << 12;
+/*! \brief distance in rows at which the gradients and bin indices are prefetched */
+static const size_t kPrefetchRows = 16;
+/*! \brief rows of a block of the deterministic histograms, and their maximum number */
+static const size_t kHistBlockRows = 1 << 13;
+static const size_t kMaxHistBlocks = 32;
 
-  const int K = 8;  // loop unrolling factor
-  const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread_);
-  const size_t nrows = row_indices.end - row_indices.begin;
-  const size_t rest = nrows % K;
+/*! \brief number of blocks of the deterministic histogram of nrows rows */
+inline size_t NumHistBlocks(size_t nrows) {
+  return std::min(std::max((nrows + kHistBlockRows - 1) / kHistBlockRows,
+                           static_cast<size_t>(1)), kMaxHistBlocks);
+}
 
-  #pragma omp parallel for num_threads(nthread) schedule(guided)
-  for (bst_omp_uint i = 0; i < nrows - rest; i += K) {
-    const bst_omp_uint tid = omp_get_thread_num();
-    const size_t off = tid * nbins_;
+inline void Prefetch(const void* ptr) {
+#if defined(__GNUC__)
+  __builtin_prefetch(ptr);
+#elif defined(XGBOOST_SSE2_LANE)
+  _mm_prefetch(reinterpret_cast<const char*>(ptr), _MM_HINT_T0);
+#endif
+}
+
+// A gradient pair as it is accumulated into a GHistEntryT<GradientSumT>.
+// Float sums take the pair as it is.
+template <typename GradientSumT>
+struct GradPairLane {
+  typedef bst_gpair Type;
+  static inline Type Load(const bst_gpair& g) {
+    return g;
+  }
+  static inline void AddToBin(GHistEntryT<GradientSumT>* e, Type g) {
+    e->Add(g);
+  }
+};
+
+// SSE2 is part of every x86-64 CPU, there the pair is widened to double and
+// grad and hess are added in one 128 bit lane.
+#if defined(XGBOOST_SSE2_LANE)
+template <>
+struct GradPairLane<double> {
+  typedef __m128d Type;
+  static inline Type Load(const bst_gpair& g) {
+    static_assert(sizeof(bst_gpair) == 2 * sizeof(float), "packed grad, hess");
+    return _mm_cvtps_pd(_mm_castsi128_ps(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&g))));
+  }
+  static inline void AddToBin(GHistEntryT<double>* e, Type g) {
+    static_assert(sizeof(GHistEntryT<double>) == 2 * sizeof(double),
+                  "packed sum_grad, sum_hess");
+    double* p = &e->sum_grad;
+    _mm_storeu_pd(p, _mm_add_pd(_mm_loadu_pd(p), g));
+  }
+};
+#endif
+
+// the gradient of the i-th row of a set, read in the order of the rows when
+// the set keeps its gradients
+inline const bst_gpair& RowGradient(const std::vector<bst_gpair>& gpair,
+                                    const RowSetCollection::Elem& rows, size_t i) {
+  return rows.gpair != nullptr ? rows.gpair[i] : gpair[rows.begin[i]];
+}
+
+// accumulate the gradients of the rows [begin, end) out of nrows into hist,
+// the rows further on are prefetched in two steps: first their row pointer,
+// then their gradient and the start of their bin indices. The gradients kept
+// with the rows are read sequentially and need no prefetch.
+template <typename T, typename GradientSumT>
+static void BuildHistRows(const std::vector<bst_gpair>& gpair,
+                          const RowSetCollection::Elem row_indices,
+                          size_t begin, size_t end,
+                          size_t nrows, const GHistIndexMatrix& gmat,
+                          GHistEntryT<GradientSumT>* hist) {
+  const size_t* rows = row_indices.begin;
+  const bool ordered = row_indices.gpair != nullptr;
+  typedef GradPairLane<GradientSumT> Lane;
+  const int K = 8;  // loop unrolling factor
+  const BinReader<T> index = gmat.index.Reader<T>();
+  const size_t* row_ptr = dmlc::BeginPtr(gmat.row_ptr);
+  const size_t base = gmat.base_rowid;
+  size_t i = begin;
+  for (; i + K <= end; i += K) {
     size_t rid[K];
     size_t ibegin[K];
     size_t iend[K];
-    bst_gpair stat[K];
+    typename Lane::Type stat[K];
+    for (int k = 0; k < K; ++k) {
+      rid[k] = rows[i + k];
+    }
     for (int k = 0; k < K; ++k) {
-      rid[k] = row_indices.begin[i + k];
+      if (i + k + 2 * kPrefetchRows < nrows) {
+        Prefetch(&row_ptr[rows[i + k + 2 * kPrefetchRows] - base]);
+      }
+      if (i + k + kPrefetchRows < nrows) {
+        const size_t ahead = rows[i + k + kPrefetchRows];
+        if (!ordered) Prefetch(&gpair[ahead]);
+        Prefetch(index.Address(row_ptr[ahead - base]));
+      }
     }
     for (int k = 0; k < K; ++k) {
-      ibegin[k] = gmat.row_ptr[rid[k]];
-      iend[k] = gmat.row_ptr[rid[k] + 1];
+      ibegin[k] = row_ptr[rid[k] - base];
+      iend[k] = row_ptr[rid[k] - base + 1];
     }
     for (int k = 0; k < K; ++k) {
-      stat[k] = gpair[rid[k]];
+      stat[k] = Lane::Load(RowGradient(gpair, row_indices, i + k));
     }
     for (int k = 0; k < K; ++k) {
       for (size_t j = ibegin[k]; j < iend[k]; ++j) {
-        const uint32_t bin = gmat.index[j];
-        data_[off + bin].Add(stat[k]);
+        Lane::AddToBin(hist + index[j], stat[k]);
       }
     }
   }
-  for (size_t i = nrows - rest; i < nrows; ++i) {
+  for (; i < end; ++i) {
+    const size_t rid = rows[i];
+    const typename Lane::Type stat = Lane::Load(RowGradient(gpair, row_indices, i));
+    for (size_t j = row_ptr[rid - base]; j < row_ptr[rid - base + 1]; ++j) {
+      Lane::AddToBin(hist + index[j], stat);
+    }
+  }
+}
+
+// accumulate the gradients of the rows into hist with the calling thread
+template <typename GradientSumT>
+static void BuildHistSerial(const std::vector<bst_gpair>& gpair,
+                            const RowSetCollection::Elem row_indices,
+                            const GHistIndexMatrix& gmat,
+                            GHistEntryT<GradientSumT>* hist) {
+  const size_t nrows = row_indices.end - row_indices.begin;
+  XGBOOST_BIN_INDEX_SWITCH(gmat.index, {
+    BuildHistRows<DType>(gpair, row_indices, 0, nrows, nrows, gmat, hist);
+  });
+}
+
+// accumulate the gradients of the rows into the bins [bin_begin, bin_end)
+// of hist, the threads owning disjoint bin ranges need no reduction
+template <typename T, typename GradientSumT>
+static void BuildHistBinRange(const std::vector<bst_gpair>& gpair,
+                              const RowSetCollection::Elem row_indices,
+                              const GHistIndexMatrix& gmat,
+                              uint32_t bin_begin, uint32_t bin_end,
+                              GHistEntryT<GradientSumT>* hist) {
+  typedef GradPairLane<GradientSumT> Lane;
+  const size_t nrows = row_indices.end - row_indices.begin;
+  const BinReader<T> index = gmat.index.Reader<T>();
+  const size_t base = gmat.base_rowid;
+  for (size_t i = 0; i < nrows; ++i) {
     const size_t rid = row_indices.begin[i];
-    const size_t ibegin = gmat.row_ptr[rid];
-    const size_t iend = gmat.row_ptr[rid + 1];
-    const bst_gpair stat = gpair[rid];
-    for (size_t j = ibegin; j < iend; ++j) {
-      const uint32_t bin = gmat.index[j];
-      data_[bin].Add(stat);
+    const typename Lane::Type stat = Lane::Load(RowGradient(gpair, row_indices, i));
+    for (size_t j = gmat.row_ptr[rid - base]; j < gmat.row_ptr[rid - base + 1]; ++j) {
+      const uint32_t bin = index[j];
+      if (bin >= bin_begin && bin < bin_end) {
+        Lane::AddToBin(hist + bin, stat);
+      }
     }
   }
+}
+
+// accumulate the gradients of the rows into the histogram of each thread.
+// With static_rows each thread takes one contiguous part of the rows, as
+// when the matrix was quantized, and so reads the pages it first touched.
+template <typename T, typename GradientSumT>
+static void BuildHistThreadLocal(const std::vector<bst_gpair>& gpair,
+                                 const RowSetCollection::Elem row_indices,
+                                 const GHistIndexMatrix& gmat,
+                                 bst_omp_uint nthread, bool static_rows,
+                                 std::vector<std::vector<GHistEntryT<GradientSumT> > >*
+                                     p_hist_tloc) {
+  std::vector<std::vector<GHistEntryT<GradientSumT> > >& hist_tloc = *p_hist_tloc;
+  const int K = 8;  // rows of one task
+  const size_t nrows = row_indices.end - row_indices.begin;
+  const size_t rest = nrows % K;
+
+  if (static_rows) {
+    #pragma omp parallel for num_threads(nthread) schedule(static, 1)
+    for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
+      BuildHistRows<T>(gpair, row_indices, nrows * tid / nthread,
+                       nrows * (tid + 1) / nthread, nrows, gmat,
+                       dmlc::BeginPtr(hist_tloc[tid]));
+    }
+    return;
+  }
+  #pragma omp parallel for num_threads(nthread) schedule(guided)
+  for (bst_omp_uint i = 0; i < nrows - rest; i += K) {
+    const bst_omp_uint tid = omp_get_thread_num();
+    BuildHistRows<T>(gpair, row_indices, i, i + K, nrows, gmat,
+                     dmlc::BeginPtr(hist_tloc[tid]));
+  }
+  BuildHistRows<T>(gpair, row_indices, nrows - rest, nrows, nrows, gmat,
+                   dmlc::BeginPtr(hist_tloc[0]));
+}
+
+// accumulate the gradients of the rows into the histogram of each of
+// nblock blocks of contiguous rows, which only depend on the number of rows
+template <typename T, typename GradientSumT>
+static void BuildHistBlocks(const std::vector<bst_gpair>& gpair,
+                            const RowSetCollection::Elem row_indices,
+                            const GHistIndexMatrix& gmat,
+                            bst_omp_uint nthread, bst_omp_uint nblock, uint32_t nbins,
+                            std::vector<std::vector<GHistEntryT<GradientSumT> > >*
+                                p_hist_block) {
+  std::vector<std::vector<GHistEntryT<GradientSumT> > >& hist_block = *p_hist_block;
+  const size_t nrows = row_indices.end - row_indices.begin;
+  #pragma omp parallel for num_threads(nthread) schedule(dynamic, 1)
+  for (bst_omp_uint b = 0; b < nblock; ++b) {
+    hist_block[b].resize(nbins);
+    std::fill(hist_block[b].begin(), hist_block[b].end(), GHistEntryT<GradientSumT>());
+    BuildHistRows<T>(gpair, row_indices, nrows * b / nblock,
+                     nrows * (b + 1) / nblock, nrows, gmat,
+                     dmlc::BeginPtr(hist_block[b]));
+  }
+}
+
+template <typename GradientSumT>
+void GHistBuilderT<GradientSumT>::BuildHist(const std::vector<bst_gpair>& gpair,
+                             const RowSetCollection::Elem row_indices,
+                             const GHistIndexMatrix& gmat,
+                             const std::vector<bst_uint>& feat_set,
+                             GHistRow hist) {
+  const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread_);
+  const size_t nrows = row_indices.end - row_indices.begin;
+  // estimated number of entries of the node
+  const size_t nentry = gmat.row_ptr.size() > 1 ?
+      nrows * gmat.index.size() / (gmat.row_ptr.size() - 1) : 0;
+  // the deterministic histograms are summed by blocks of rows, a single
+  // block in row order by one thread
+  const size_t nblock = NumHistBlocks(nrows);
+  if (deterministic_ && nblock == 1) {
+    BuildHistSerial(gpair, row_indices, gmat, hist.begin);
+    return;
+  }
+  if (deterministic_) {
+    data_.resize(std::max(data_.size(), nblock));
+    XGBOOST_BIN_INDEX_SWITCH(gmat.index, {
+      BuildHistBlocks<DType>(gpair, row_indices, gmat, nthread,
+                             static_cast<bst_omp_uint>(nblock), nbins_, &data_);
+    });
+    this->UpdateMemory();
+    // the blocks are added pairwise, bin by bin
+    const uint32_t nbins = nbins_;
+    #pragma omp parallel for num_threads(nthread) schedule(static)
+    for (bst_omp_uint bin_id = 0; bin_id < bst_omp_uint(nbins); ++bin_id) {
+      for (size_t step = 1; step < nblock; step *= 2) {
+        for (size_t b = 0; b + step < nblock; b += 2 * step) {
+          data_[b][bin_id].Add(data_[b + step][bin_id]);
+        }
+      }
+      hist.begin[bin_id].Add(data_[0][bin_id]);
+    }
+    return;
+  }
+  if (nthread <= 1 || nentry <= kSerialHistEntries) {
+    BuildHistSerial(gpair, row_indices, gmat, hist.begin);
+    return;
+  }
+  // as long as scanning the node once per thread is cheaper than clearing
+  // and reducing the per thread histograms, the threads split the bins
+  if (nentry <= nbins_) {
+    #pragma omp parallel num_threads(nthread)
+    {
+      const size_t tid = omp_get_thread_num();
+      const size_t nt = omp_get_num_threads();
+      const uint32_t bin_begin = static_cast<uint32_t>(nbins_ * tid / nt);
+      const uint32_t bin_end = static_cast<uint32_t>(nbins_ * (tid + 1) / nt);
+      XGBOOST_BIN_INDEX_SWITCH(gmat.index, {
+        BuildHistBinRange<DType>(gpair, row_indices, gmat, bin_begin, bin_end,
+                                 hist.begin);
+      });
+    }
+    return;
+  }
+
+  // every thread allocates and clears its own histogram, which is then
+  // placed on its NUMA node by the first touch
+  data_.resize(nthread_);
+  #pragma omp parallel for num_threads(nthread) schedule(static, 1)
+  for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
+    data_[tid].resize(nbins_);
+    std::fill(data_[tid].begin(), data_[tid].end(), GHistEntry());
+  }
+  this->UpdateMemory();
+
+  XGBOOST_BIN_INDEX_SWITCH(gmat.index, {
+    BuildHistThreadLocal<DType>(gpair, row_indices, gmat, nthread, static_rows_, &data_);
+  });
 
   /* reduction */
   const uint32_t nbins = nbins_;
   #pragma omp parallel for num_threads(nthread) schedule(static)
   for (bst_omp_uint bin_id = 0; bin_id < bst_omp_uint(nbins); ++bin_id) {
     for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
-      hist.begin[bin_id].Add(data_[tid * nbins_ + bin_id]);
+      hist.begin[bin_id].Add(data_[tid][bin_id]);
+    }
+  }
+}
+
+template <typename GradientSumT>
+void GHistBuilderT<GradientSumT>::BuildHistBatch(const std::vector<bst_gpair>& gpair,
+                                  const std::vector<RowSetCollection::Elem>& row_sets,
+                                  const GHistIndexMatrix& gmat,
+                                  const std::vector<bst_uint>& feat_set,
+                                  const std::vector<GHistRow>& hists) {
+  CHECK_EQ(row_sets.size(), hists.size());
+  const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread_);
+  size_t total_rows = 0;
+  for (const RowSetCollection::Elem& rows : row_sets) {
+    total_rows += rows.size();
+  }
+  // a node with more than its share of the rows is split among the threads,
+  // the others are built by one thread each without per thread copies
+  std::vector<size_t> serial_nodes;
+  for (size_t i = 0; i < row_sets.size(); ++i) {
+    if ((nthread > 1 && row_sets[i].size() * nthread > total_rows) ||
+        (deterministic_ && NumHistBlocks(row_sets[i].size()) > 1)) {
+      this->BuildHist(gpair, row_sets[i], gmat, feat_set, hists[i]);
+    } else {
+      serial_nodes.push_back(i);
     }
   }
+  // the largest nodes go first for load balance
+  std::sort(serial_nodes.begin(), serial_nodes.end(), [&](size_t a, size_t b) {
+      return row_sets[a].size() > row_sets[b].size();
+    });
+  const bst_omp_uint nserial = static_cast<bst_omp_uint>(serial_nodes.size());
+  #pragma omp parallel for num_threads(nthread) schedule(dynamic)
+  for (bst_omp_uint i = 0; i < nserial; ++i) {
+    const size_t node = serial_nodes[i];
+    BuildHistSerial(gpair, row_sets[node], gmat, hists[node].begin);
+  }
 }
 
-void GHistBuilder::BuildBlockHist(const std::vector<bst_gpair>& gpair,
+template <typename GradientSumT>
+void GHistBuilderT<GradientSumT>::BuildBlockHist(const std::vector<bst_gpair>& gpair,
                                   const RowSetCollection::Elem row_indices,
                                   const GHistIndexBlockMatrix& gmatb,
                                   const std::vector<bst_uint>& feat_set,
@@ -470,6 +928,17 @@ void GHistBuilder::BuildBlockHist(const std::vector<bst_gpair>& gpair,
   #pragma omp parallel for num_threads(nthread) schedule(guided)
   for (bst_omp_uint bid = 0; bid < nblock; ++bid) {
     auto gmat = gmatb[bid];
+    if (gmat.bundle != nullptr) {
+      // one bin per row, the other features of the bundle are empty
+      for (size_t i = 0; i < nrows; ++i) {
+        const size_t rid = row_indices.begin[i];
+        const uint32_t bin = gmat.bundle[rid];
+        if (bin != GHistIndexBlock::kNoBin) {
+          hist.begin[bin].Add(RowGradient(gpair, row_indices, i));
+        }
+      }
+      continue;
+    }
 
     for (size_t i = 0; i < nrows - rest; i += K) {
       size_t rid[K];
@@ -484,7 +953,7 @@ void GHistBuilder::BuildBlockHist(const std::vector<bst_gpair>& gpair,
         iend[k] = gmat.row_ptr[rid[k] + 1];
       }
       for (int k = 0; k < K; ++k) {
-        stat[k] = gpair[rid[k]];
+        stat[k] = RowGradient(gpair, row_indices, i + k);
       }
       for (int k = 0; k < K; ++k) {
         for (size_t j = ibegin[k]; j < iend[k]; ++j) {
@@ -497,7 +966,7 @@ void GHistBuilder::BuildBlockHist(const std::vector<bst_gpair>& gpair,
       const size_t rid = row_indices.begin[i];
       const size_t ibegin = gmat.row_ptr[rid];
       const size_t iend = gmat.row_ptr[rid + 1];
-      const bst_gpair stat = gpair[rid];
+      const bst_gpair stat = RowGradient(gpair, row_indices, i);
       for (size_t j = ibegin; j < iend; ++j) {
         const uint32_t bin = gmat.index[j];
         hist.begin[bin].Add(stat);
@@ -506,7 +975,9 @@ void GHistBuilder::BuildBlockHist(const std::vector<bst_gpair>& gpair,
   }
 }
 
-void GHistBuilder::SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent) {
+template <typename GradientSumT>
+void GHistBuilderT<GradientSumT>::SubtractionTrick(GHistRow self, GHistRow sibling,
+                                                   GHistRow parent) {
   const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread_);
   const uint32_t nbins = static_cast<bst_omp_uint>(nbins_);
   const int K = 8;  // loop unrolling factor
@@ -530,5 +1001,59 @@ void GHistBuilder::SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow pa
   }
 }
 
+template <typename GradientSumT>
+void GHistBuilderT<GradientSumT>::SubtractionTrickBatch(
+    const std::vector<GHistRow>& self, const std::vector<GHistRow>& sibling,
+    const std::vector<GHistRow>& parent) {
+  CHECK_EQ(self.size(), sibling.size());
+  CHECK_EQ(self.size(), parent.size());
+  const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread_);
+  const uint32_t nbins = nbins_;
+  const uint32_t kBlock = 1024;  // bins of one task
+  const size_t nblock = (nbins + kBlock - 1) / kBlock;
+  const bst_omp_uint ntask = static_cast<bst_omp_uint>(self.size() * nblock);
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint task = 0; task < ntask; ++task) {
+    const size_t node = task / nblock;
+    const uint32_t begin = static_cast<uint32_t>(task % nblock) * kBlock;
+    const uint32_t end = std::min(begin + kBlock, nbins);
+    for (uint32_t bin_id = begin; bin_id < end; ++bin_id) {
+      self[node].begin[bin_id].SetSubtract(parent[node].begin[bin_id],
+                                           sibling[node].begin[bin_id]);
+    }
+  }
+}
+
+template <typename GradientSumT>
+void GHistBuilderT<GradientSumT>::SubtractionTrickBatch(
+    const std::vector<GHistRow>& self, const std::vector<GHistRow>& sibling,
+    const std::vector<GHistRow>& parent, const std::vector<const BitMap*>& features,
+    const std::vector<uint32_t>& cut_ptr) {
+  CHECK_EQ(self.size(), sibling.size());
+  CHECK_EQ(self.size(), parent.size());
+  CHECK_EQ(self.size(), features.size());
+  const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread_);
+  const size_t nfeature = cut_ptr.size() - 1;
+  // a task is one word of the bitmap, the empty words are skipped at once
+  const size_t nword = (nfeature + 31) >> 5;
+  const bst_omp_uint ntask = static_cast<bst_omp_uint>(self.size() * nword);
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint task = 0; task < ntask; ++task) {
+    const size_t node = task / nword;
+    const size_t word = task % nword;
+    uint32_t bits = features[node]->data[word];
+    for (size_t fid = word << 5; bits != 0; ++fid, bits >>= 1) {
+      if ((bits & 1U) == 0) continue;
+      for (uint32_t bin_id = cut_ptr[fid]; bin_id < cut_ptr[fid + 1]; ++bin_id) {
+        self[node].begin[bin_id].SetSubtract(parent[node].begin[bin_id],
+                                             sibling[node].begin[bin_id]);
+      }
+    }
+  }
+}
+
+template class GHistBuilderT<float>;
+template class GHistBuilderT<double>;
+
 }  // namespace common
 }  // namespace xgboost
@@ -0,0 +1,210 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file hist_util.cu
+ * \brief Weighted quantile sketch of the features computed on the devices
+ */
+#include <dmlc/omp.h>
+#include <thrust/binary_search.h>
+#include <thrust/device_vector.h>
+#include <thrust/execution_policy.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/sort.h>
+#include <xgboost/data.h>
+#include <algorithm>
+#include <vector>
+#include "./device_helpers.cuh"
+#include "./hist_util.h"
+
+namespace xgboost {
+namespace common {
+
+typedef HistCutMatrix::WXQSketch WXQSketch;
+
+// an entry of a pruned summary, a negative wmin marks an unused slot
+struct SketchEntry {
+  bst_float rmin;
+  bst_float rmax;
+  bst_float wmin;
+  bst_float value;
+};
+
+// position of the entry of rank k out of max_size in the exact summary
+// [begin, end) of a feature: the last entry whose rmin is below k / (max_size - 1)
+// of the total weight, the first and the last entries are always selected
+__device__ size_t SelectByRank(const bst_float* d_rmin, const bst_float* d_weight,
+                               size_t begin, size_t end, size_t k, size_t max_size) {
+  if (k + 1 == max_size) return end - 1;
+  bst_float total = d_rmin[end - 1] + d_weight[end - 1];
+  bst_float rank = total * k / (max_size - 1);
+  const bst_float* pos = thrust::upper_bound(thrust::seq, d_rmin + begin,
+                                             d_rmin + end, rank);
+  size_t upper = pos - d_rmin;
+  return upper > begin ? upper - 1 : begin;
+}
+
+// Sketch the rows [row_begin, row_end) of the batch on the device. The
+// entries are sorted by feature and value, the weights of equal values are
+// summed into the exact weighted summary of each feature, which is then
+// pruned by rank to max_size entries. Returns the pruned summary of feature
+// fid at fid * max_size.
+std::vector<SketchEntry> SketchBatch(int device, const RowBatch& batch,
+                                     size_t row_begin, size_t row_end,
+                                     const MetaInfo& info, size_t max_size) {
+  dh::safe_cuda(cudaSetDevice(device));
+  const size_t ncol = info.num_col;
+  SketchEntry unused = {0.0f, 0.0f, -1.0f, 0.0f};
+  std::vector<SketchEntry> h_summary(ncol * max_size, unused);
+  const size_t entry_begin = batch.ind_ptr[row_begin];
+  const size_t n_entries = batch.ind_ptr[row_end] - entry_begin;
+  if (n_entries == 0) return h_summary;
+
+  dh::device_vector<SparseBatch::Entry> entries(
+      batch.data_ptr + entry_begin, batch.data_ptr + entry_begin + n_entries);
+  dh::device_vector<bst_uint> fid(n_entries);
+  dh::device_vector<bst_float> fvalue(n_entries);
+  dh::device_vector<bst_float> weight(n_entries, 1.0f);
+  auto d_entries = dh::raw(entries);
+  auto d_fid = dh::raw(fid);
+  auto d_fvalue = dh::raw(fvalue);
+  auto d_weight = dh::raw(weight);
+  dh::launch_n(device, n_entries, [=] __device__(size_t idx) {
+    d_fid[idx] = d_entries[idx].index;
+    d_fvalue[idx] = d_entries[idx].fvalue;
+  });
+  if (info.weights.size() != 0) {
+    // an entry has the weight of its row
+    const size_t n_rows = row_end - row_begin;
+    dh::device_vector<size_t> ind_ptr(batch.ind_ptr + row_begin,
+                                          batch.ind_ptr + row_end + 1);
+    dh::device_vector<bst_float> row_weight(
+        info.weights.begin() + batch.base_rowid + row_begin,
+        info.weights.begin() + batch.base_rowid + row_end);
+    auto d_ind_ptr = dh::raw(ind_ptr);
+    auto d_row_weight = dh::raw(row_weight);
+    dh::launch_n(device, n_rows, [=] __device__(size_t i) {
+      for (size_t j = d_ind_ptr[i]; j < d_ind_ptr[i + 1]; ++j) {
+        d_weight[j - entry_begin] = d_row_weight[i];
+      }
+    });
+  }
+
+  // segmented sort: by value, then stable by feature, the temporary storage
+  // of the algorithms is drawn from the memory pool
+  dh::CubMemory temp;
+  thrust::sort_by_key(thrust::cuda::par(temp), fvalue.begin(), fvalue.end(),
+                      thrust::make_zip_iterator(
+                          thrust::make_tuple(fid.begin(), weight.begin())));
+  thrust::stable_sort_by_key(thrust::cuda::par(temp), fid.begin(), fid.end(),
+                             thrust::make_zip_iterator(thrust::make_tuple(
+                                 fvalue.begin(), weight.begin())));
+
+  // exact summary: unique values with their weights and minimum ranks
+  dh::device_vector<bst_uint> unique_fid(n_entries);
+  dh::device_vector<bst_float> unique_value(n_entries);
+  dh::device_vector<bst_float> unique_weight(n_entries);
+  auto keys = thrust::make_zip_iterator(
+      thrust::make_tuple(fid.begin(), fvalue.begin()));
+  auto unique_end = thrust::reduce_by_key(
+      thrust::cuda::par(temp), keys, keys + n_entries, weight.begin(),
+      thrust::make_zip_iterator(
+          thrust::make_tuple(unique_fid.begin(), unique_value.begin())),
+      unique_weight.begin());
+  const size_t n_unique = unique_end.second - unique_weight.begin();
+  dh::device_vector<bst_float> unique_rmin(n_unique);
+  thrust::exclusive_scan_by_key(thrust::cuda::par(temp), unique_fid.begin(),
+                                unique_fid.begin() + n_unique,
+                                unique_weight.begin(), unique_rmin.begin());
+  dh::device_vector<size_t> feature_ptr(ncol + 1);
+  thrust::lower_bound(thrust::cuda::par(temp), unique_fid.begin(),
+                      unique_fid.begin() + n_unique,
+                      thrust::make_counting_iterator<bst_uint>(0),
+                      thrust::make_counting_iterator<bst_uint>(ncol + 1),
+                      feature_ptr.begin());
+
+  // prune each summary to max_size entries
+  dh::device_vector<SketchEntry> summary(h_summary);
+  auto d_summary = dh::raw(summary);
+  auto d_feature_ptr = dh::raw(feature_ptr);
+  auto d_value = dh::raw(unique_value);
+  auto d_unique_weight = dh::raw(unique_weight);
+  auto d_rmin = dh::raw(unique_rmin);
+  dh::launch_n(device, ncol * max_size, [=] __device__(size_t idx) {
+    size_t begin = d_feature_ptr[idx / max_size];
+    size_t end = d_feature_ptr[idx / max_size + 1];
+    size_t k = idx % max_size;
+    size_t pos = begin + k;
+    if (end - begin > max_size) {
+      pos = SelectByRank(d_rmin, d_unique_weight, begin, end, k, max_size);
+      // an entry selected for several ranks is kept once
+      if (k != 0 && pos == SelectByRank(d_rmin, d_unique_weight, begin, end,
+                                        k - 1, max_size)) {
+        return;
+      }
+    } else if (pos >= end) {
+      return;
+    }
+    SketchEntry e;
+    e.rmin = d_rmin[pos];
+    e.rmax = d_rmin[pos] + d_unique_weight[pos];
+    e.wmin = d_unique_weight[pos];
+    e.value = d_value[pos];
+    d_summary[idx] = e;
+  });
+  thrust::copy(summary.begin(), summary.end(), h_summary.begin());
+  return h_summary;
+}
+
+void DeviceSketch(const std::vector<int>& devices, DMatrix* p_fmat,
+                  uint32_t max_num_bins, HistCutMatrix* hmat) {
+  const MetaInfo& info = p_fmat->info();
+  const size_t max_size = max_num_bins * HistCutMatrix::kSketchFactor;
+  const int n_devices = static_cast<int>(devices.size());
+  std::vector<WXQSketch::SummaryContainer> summary_array(info.num_col);
+
+  dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    // each device sketches a slice of the rows of the batch
+    std::vector<std::vector<SketchEntry> > device_summaries(n_devices);
+    const size_t shard_size = dh::div_round_up(batch.size, n_devices);
+    #pragma omp parallel for schedule(static, 1) num_threads(n_devices)
+    for (int i = 0; i < n_devices; ++i) {
+      size_t begin = std::min(batch.size, i * shard_size);
+      size_t end = std::min(batch.size, begin + shard_size);
+      device_summaries[i] =
+          SketchBatch(devices[i], batch, begin, end, info, max_size);
+    }
+
+    // merge the summaries of the devices into the ones of the previous batches
+    const bst_omp_uint nfeature = static_cast<bst_omp_uint>(info.num_col);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (bst_omp_uint fid = 0; fid < nfeature; ++fid) {
+      WXQSketch::SummaryContainer& out = summary_array[fid];
+      for (const std::vector<SketchEntry>& h_summary : device_summaries) {
+        WXQSketch::SummaryContainer local;
+        local.Reserve(max_size);
+        for (size_t k = 0; k < max_size; ++k) {
+          const SketchEntry& e = h_summary[fid * max_size + k];
+          if (e.wmin < 0.0f) continue;
+          local.data[local.size++] =
+              WXQSketch::Entry(e.rmin, e.rmax, e.wmin, e.value);
+        }
+        if (local.size == 0) continue;
+        WXQSketch::SummaryContainer merged;
+        merged.Reserve(out.size + local.size);
+        merged.SetCombine(out, local);
+        out.Reserve(max_size);
+        out.SetPrune(merged, max_size);
+      }
+    }
+  }
+
+  hmat->Init(&summary_array, max_num_bins);
+}
+
+}  // namespace common
+}  // namespace xgboost
@@ -8,8 +8,18 @@
 #define XGBOOST_COMMON_HIST_UTIL_H_
 
 #include <xgboost/data.h>
+#include <dmlc/threadediter.h>
+#include <algorithm>
 #include <limits>
+#include <list>
+#include <memory>
+#include <string>
 #include <vector>
+#include "bitmap.h"
+#include "compressed_iterator.h"
+#include "first_touch.h"
+#include "memory_tracker.h"
+#include "quantile.h"
 #include "row_set.h"
 #include "../tree/fast_hist_param.h"
 
@@ -18,14 +28,18 @@ using xgboost::tree::FastHistParam;
 namespace xgboost {
 namespace common {
 
-/*! \brief sums of gradient statistics corresponding to a histogram bin */
-struct GHistEntry {
+/*!
+ * \brief sums of gradient statistics corresponding to a histogram bin
+ * \tparam GradientSumT type of the sums, float halves the size of the histograms
+ */
+template <typename GradientSumT>
+struct GHistEntryT {
   /*! \brief sum of first-order gradient statistics */
-  double sum_grad;
+  GradientSumT sum_grad;
   /*! \brief sum of second-order gradient statistics */
-  double sum_hess;
+  GradientSumT sum_hess;
 
-  GHistEntry() : sum_grad(0), sum_hess(0) {}
+  GHistEntryT() : sum_grad(0), sum_hess(0) {}
 
   inline void Clear() {
     sum_grad = sum_hess = 0;
@@ -38,18 +52,20 @@ struct GHistEntry {
   }
 
   /*! \brief add a GHistEntry to the sum */
-  inline void Add(const GHistEntry& e) {
+  inline void Add(const GHistEntryT& e) {
     sum_grad += e.sum_grad;
     sum_hess += e.sum_hess;
   }
 
   /*! \brief set sum to be difference of two GHistEntry's */
-  inline void SetSubtract(const GHistEntry& a, const GHistEntry& b) {
+  inline void SetSubtract(const GHistEntryT& a, const GHistEntryT& b) {
     sum_grad = a.sum_grad - b.sum_grad;
     sum_hess = a.sum_hess - b.sum_hess;
   }
 };
 
+typedef GHistEntryT<double> GHistEntry;
+
 
 /*! \brief Cut configuration for one feature */
 struct HistCutUnit {
@@ -66,6 +82,9 @@ struct HistCutUnit {
 
 /*! \brief cut configuration for all the features */
 struct HistCutMatrix {
+  typedef WXQuantileSketch<bst_float, bst_float> WXQSketch;
+  /*! \brief safe factor of the summary size over the number of bins, for better accuracy */
+  static const int kSketchFactor = 8;
   /*! \brief unit pointer to rows by element position */
   std::vector<uint32_t> row_ptr;
   /*! \brief minimum value of each feature */
@@ -78,10 +97,214 @@ struct HistCutMatrix {
                        row_ptr[fid + 1] - row_ptr[fid]);
   }
   // create histogram cut matrix given statistics from data
-  // using approximate quantile sketch approach
-  void Init(DMatrix* p_fmat, uint32_t max_num_bins);
+  // using approximate quantile sketch approach, from the given
+  // fraction of the rows
+  void Init(DMatrix* p_fmat, uint32_t max_num_bins, float sample_rate = 1.0f);
+  // create the cuts from the local summaries of the features, pruned to
+  // max_num_bins * kSketchFactor entries, the summaries are allreduced
+  void Init(std::vector<WXQSketch::SummaryContainer>* summary_array,
+            uint32_t max_num_bins);
+  // save the cuts into a binary stream
+  inline void Save(dmlc::Stream* fo) const {
+    fo->Write(row_ptr);
+    fo->Write(min_val);
+    fo->Write(cut);
+  }
+  // load the cuts saved by Save
+  inline void Load(dmlc::Stream* fi) {
+    CHECK(fi->Read(&row_ptr)) << "invalid histogram cuts";
+    CHECK(fi->Read(&min_val)) << "invalid histogram cuts";
+    CHECK(fi->Read(&cut)) << "invalid histogram cuts";
+  }
+};
+
+
+/*!
+ * \brief create the cuts with a weighted quantile sketch computed on the
+ *  devices, each device sketches a slice of the rows of every batch.
+ *  Defined in hist_util.cu, only available in builds with CUDA.
+ * \param devices ordinals of the devices to use
+ * \param p_fmat the data
+ * \param max_num_bins maximum number of bins of a feature
+ * \param hmat the cuts to create
+ */
+void DeviceSketch(const std::vector<int>& devices, DMatrix* p_fmat,
+                  uint32_t max_num_bins, HistCutMatrix* hmat);
+
+
+/*! \brief indicator of data type used for storing bin id's in a column. */
+enum DataType {
+  uint8 = 1,
+  uint16 = 2,
+  uint32 = 4
+};
+
+/*! \brief tag of the bit packed storage of BinIndex */
+struct PackedBin {};
+
+/*! \brief reads the bin ids of a BinIndex stored as T */
+template <typename T>
+struct BinReader {
+  const T* data;
+  inline uint32_t operator[](size_t i) const {
+    return data[i];
+  }
+  /*! \brief address of entry i, to prefetch it */
+  inline const void* Address(size_t i) const {
+    return data + i;
+  }
+};
+
+/*! \brief reads the bin ids of a bit packed BinIndex */
+template <>
+struct BinReader<PackedBin> {
+  CompressedIterator<uint32_t> data;
+  const compressed_byte_t* buffer;
+  size_t symbol_bits;
+  inline uint32_t operator[](size_t i) const {
+    return data[i];
+  }
+  inline const void* Address(size_t i) const {
+    return buffer + detail::padding + i * symbol_bits / 8;
+  }
+};
+
+/*!
+ * \brief bin ids of the entries of a quantized matrix, stored in the
+ *  narrowest unsigned type that holds every bin, e.g. one byte per entry
+ *  for at most 256 bins. The hot loops dispatch on dtype() once and read
+ *  data<T>(), operator[] widens a single entry.
+ *
+ *  Pack() bit packs a complete index to log2(nbins) bits per entry in the
+ *  layout of CompressedBufferWriter, the one of the gpu_hist matrix. The
+ *  packed index is read through Reader<PackedBin>(), the loops dispatch on
+ *  both with XGBOOST_BIN_INDEX_SWITCH.
+ */
+class BinIndex {
+ public:
+  /*! \brief choose the storage type for the bin ids [0, nbins), clears the index */
+  inline void SetBinCount(uint32_t nbins) {
+    if (nbins <= (1U << 8)) {
+      dtype_ = uint8;
+    } else if (nbins <= (1U << 16)) {
+      dtype_ = uint16;
+    } else {
+      dtype_ = uint32;
+    }
+    packed_ = false;
+    data_.clear();
+  }
+  inline void resize(size_t size) {
+    CHECK(!packed_) << "a packed bin index cannot be resized";
+    data_.resize(size * dtype_);
+  }
+  inline size_t size() const {
+    return packed_ ? packed_size_ : data_.size() / dtype_;
+  }
+  inline DataType dtype() const {
+    return dtype_;
+  }
+  inline bool packed() const {
+    return packed_;
+  }
+  inline size_t MemoryBytes() const {
+    return data_.capacity();
+  }
+  inline uint32_t operator[](size_t i) const {
+    if (packed_) return this->MakeReader(static_cast<PackedBin*>(nullptr))[i];
+    switch (dtype_) {
+      case uint8: return data_[i];
+      case uint16: return data<uint16_t>()[i];
+      default: return data<uint32_t>()[i];
+    }
+  }
+  /*! \brief bit pack the bin ids [0, nbins), nothing happens when it already is */
+  void Pack(uint32_t nbins);
+  /*! \brief go back to the storage chosen by SetBinCount */
+  void Unpack();
+  inline void Save(dmlc::Stream* fo) const {
+    CHECK(!packed_) << "a packed bin index cannot be saved";
+    const int dtype = static_cast<int>(dtype_);
+    fo->Write(&dtype, sizeof(dtype));
+    // the layout of a std::vector written by the stream
+    const uint64_t size = data_.size();
+    fo->Write(&size, sizeof(size));
+    if (size != 0) fo->Write(data_.data(), size);
+  }
+  inline void Load(dmlc::Stream* fi) {
+    int dtype;
+    CHECK_EQ(fi->Read(&dtype, sizeof(dtype)), sizeof(dtype)) << "invalid bin index";
+    CHECK(dtype == uint8 || dtype == uint16 || dtype == uint32) << "invalid bin index";
+    dtype_ = static_cast<DataType>(dtype);
+    packed_ = false;
+    uint64_t size;
+    CHECK_EQ(fi->Read(&size, sizeof(size)), sizeof(size)) << "invalid bin index";
+    data_.resize(size);
+    CHECK_EQ(fi->Read(data_.data(), size), size) << "invalid bin index";
+  }
+  template <typename T>
+  inline T* data() {
+    CHECK(!packed_) << "the bin index is packed";
+    CHECK_EQ(sizeof(T), static_cast<size_t>(dtype_));
+    return reinterpret_cast<T*>(data_.data());
+  }
+  template <typename T>
+  inline const T* data() const {
+    CHECK(!packed_) << "the bin index is packed";
+    CHECK_EQ(sizeof(T), static_cast<size_t>(dtype_));
+    return reinterpret_cast<const T*>(data_.data());
+  }
+  template <typename T>
+  inline BinReader<T> Reader() const {
+    return this->MakeReader(static_cast<T*>(nullptr));
+  }
+
+ private:
+  template <typename T>
+  inline BinReader<T> MakeReader(T*) const {
+    return BinReader<T>{this->data<T>()};
+  }
+  inline BinReader<PackedBin> MakeReader(PackedBin*) const {
+    CHECK(packed_) << "the bin index is not packed";
+    compressed_byte_t* buffer = const_cast<compressed_byte_t*>(data_.data());
+    return BinReader<PackedBin>{CompressedIterator<uint32_t>(buffer, nbins_), buffer,
+                                detail::SymbolBits(nbins_)};
+  }
+
+  DataType dtype_{uint32};
+  // number of bins of the packed index
+  uint32_t nbins_{0};
+  bool packed_{false};
+  // number of entries of the packed index
+  size_t packed_size_{0};
+  // resize leaves it unwritten, the quantization threads first touch it
+  FirstTouchVector<uint8_t> data_;
 };
 
+/*!
+ * \brief run OP with DType set to the reader type of bin_index, i.e.
+ *  PackedBin or the integral type of its entries
+ */
+#define XGBOOST_BIN_INDEX_SWITCH(bin_index, OP)                         \
+  if ((bin_index).packed()) {                                           \
+    typedef ::xgboost::common::PackedBin DType;                         \
+    OP;                                                                 \
+  } else {                                                              \
+    switch ((bin_index).dtype()) {                                      \
+      case ::xgboost::common::uint8: {                                  \
+        typedef uint8_t DType;                                          \
+        OP; break;                                                      \
+      }                                                                 \
+      case ::xgboost::common::uint16: {                                 \
+        typedef uint16_t DType;                                         \
+        OP; break;                                                      \
+      }                                                                 \
+      default: {                                                        \
+        typedef uint32_t DType;                                         \
+        OP; break;                                                      \
+      }                                                                 \
+    }                                                                   \
+  }
 
 /*!
  * \brief A single row in global histogram index.
@@ -106,16 +329,44 @@ struct GHistIndexMatrix {
   /*! \brief row pointer to rows by element position */
   std::vector<size_t> row_ptr;
   /*! \brief The index data */
-  std::vector<uint32_t> index;
+  BinIndex index;
   /*! \brief hit count of each index */
   std::vector<size_t> hit_count;
   /*! \brief The corresponding cuts */
   const HistCutMatrix* cut;
+  /*! \brief id of the first row, non zero for the pages of GHistIndexPagedMatrix */
+  size_t base_rowid{0};
   // Create a global histogram matrix, given cut
   void Init(DMatrix* p_fmat);
-  // get i-th row
-  inline GHistIndexRow operator[](size_t i) const {
-    return GHistIndexRow(&index[0] + row_ptr[i], row_ptr[i + 1] - row_ptr[i]);
+  // quantize the rows of the batch and append them to the matrix
+  void PushBatch(const RowBatch& batch);
+  // bit pack the index, see BinIndex::Pack
+  inline void Compress() {
+    CHECK(cut != nullptr);
+    index.Pack(cut->row_ptr.back());
+    memory_.Set(this->MemoryBytes());
+  }
+  // save the matrix into a binary stream, the cuts are saved separately
+  inline void Save(dmlc::Stream* fo) const {
+    fo->Write(&base_rowid, sizeof(base_rowid));
+    fo->Write(row_ptr);
+    index.Save(fo);
+    fo->Write(hit_count);
+  }
+  // load the matrix saved by Save, cut must be set by the caller,
+  // return false at the end of the stream
+  inline bool Load(dmlc::Stream* fi) {
+    if (fi->Read(&base_rowid, sizeof(base_rowid)) != sizeof(base_rowid)) return false;
+    CHECK(fi->Read(&row_ptr)) << "invalid quantized matrix";
+    index.Load(fi);
+    CHECK(fi->Read(&hit_count)) << "invalid quantized matrix";
+    memory_.Set(this->MemoryBytes());
+    return true;
+  }
+  // bytes held by the matrix
+  inline size_t MemoryBytes() const {
+    return (row_ptr.capacity() + hit_count.capacity() + hit_count_tloc_.capacity()) *
+        sizeof(size_t) + index.MemoryBytes();
   }
   inline void GetFeatureCounts(size_t* counts) const {
     auto nfeature = cut->row_ptr.size() - 1;
@@ -130,14 +381,55 @@ struct GHistIndexMatrix {
 
  private:
   std::vector<size_t> hit_count_tloc_;
+  TrackedBytes memory_{"GHistIndexMatrix"};
+};
+
+/*!
+ * \brief quantized matrix of external memory data. Every row batch of the
+ *  data is quantized once into a page, a GHistIndexMatrix over the rows of
+ *  the batch, and written to a cache file. The pages are then streamed back
+ *  one at a time while a background thread reads the next one.
+ */
+class GHistIndexPagedMatrix {
+ public:
+  GHistIndexPagedMatrix() : cut(nullptr), num_pages_(0), page_(nullptr) {}
+  ~GHistIndexPagedMatrix();
+  /*! \brief quantize the row batches of p_fmat into pages written to cache_file */
+  void Init(DMatrix* p_fmat, const std::string& cache_file);
+  /*! \brief go back to before the first page */
+  void BeforeFirst();
+  /*! \brief move to the next page, return false after the last one */
+  bool Next();
+  /*! \brief the current page */
+  inline const GHistIndexMatrix& Value() const {
+    return *page_;
+  }
+  inline size_t NumPages() const {
+    return num_pages_;
+  }
+  /*! \brief hit count of each index over all the pages */
+  std::vector<size_t> hit_count;
+  /*! \brief The corresponding cuts */
+  const HistCutMatrix* cut;
+
+ private:
+  size_t num_pages_;
+  std::unique_ptr<dmlc::SeekStream> fi_;
+  std::unique_ptr<dmlc::ThreadedIter<GHistIndexMatrix> > prefetcher_;
+  GHistIndexMatrix* page_;
 };
 
 struct GHistIndexBlock {
+  /*! \brief bin of a row without entry in a bundle */
+  static const uint32_t kNoBin = 0xFFFFFFFFU;
   const size_t* row_ptr;
   const uint32_t* index;
+  /*! \brief bin of each row of a bundle of exclusive features, nullptr for CSR blocks */
+  const uint32_t* bundle;
 
-  inline GHistIndexBlock(const size_t* row_ptr, const uint32_t* index)
-    : row_ptr(row_ptr), index(index) {}
+  inline GHistIndexBlock(const size_t* row_ptr, const uint32_t* index,
+                         const uint32_t* bundle = nullptr)
+    : row_ptr(row_ptr), index(index), bundle(bundle) {}
 
   // get i-th row
   inline GHistIndexRow operator[](size_t i) const {
@@ -154,24 +446,36 @@ class GHistIndexBlockMatrix {
             const FastHistParam& param);
 
   inline GHistIndexBlock operator[](size_t i) const {
-    return GHistIndexBlock(blocks[i].row_ptr_begin, blocks[i].index_begin);
+    return GHistIndexBlock(blocks[i].row_ptr_begin, blocks[i].index_begin,
+                           blocks[i].bundle_begin);
   }
 
   inline size_t GetNumBlock() const {
     return blocks.size();
   }
 
+  // bytes held by the matrix
+  inline size_t MemoryBytes() const {
+    return row_ptr.capacity() * sizeof(size_t) +
+        (index.capacity() + bundle.capacity()) * sizeof(uint32_t) +
+        blocks.capacity() * sizeof(Block);
+  }
+
  private:
   std::vector<size_t> row_ptr;
   std::vector<uint32_t> index;
+  // bin of each row in each bundle, one bundle after the other
+  std::vector<uint32_t> bundle;
   const HistCutMatrix* cut;
   struct Block {
     const size_t* row_ptr_begin;
     const size_t* row_ptr_end;
     const uint32_t* index_begin;
     const uint32_t* index_end;
+    const uint32_t* bundle_begin;
   };
   std::vector<Block> blocks;
+  TrackedBytes memory_{"GHistIndexBlockMatrix"};
 };
 
 /*!
@@ -180,22 +484,32 @@ class GHistIndexBlockMatrix {
  *     for that particular bin
  *  Uses global bin id so as to represent all features simultaneously
  */
-struct GHistRow {
+template <typename GradientSumT>
+struct GHistRowT {
   /*! \brief base pointer to first entry */
-  GHistEntry* begin;
+  GHistEntryT<GradientSumT>* begin;
   /*! \brief number of entries */
   uint32_t size;
 
-  GHistRow() {}
-  GHistRow(GHistEntry* begin, uint32_t size)
+  GHistRowT() {}
+  GHistRowT(GHistEntryT<GradientSumT>* begin, uint32_t size)
     : begin(begin), size(size) {}
 };
 
+typedef GHistRowT<double> GHistRow;
+
 /*!
- * \brief histogram of gradient statistics for multiple nodes
+ * \brief histogram of gradient statistics for multiple nodes.
+ *  Rows of released histograms are recycled. Evictable histograms are only
+ *  kept for the subtraction trick, the oldest one is evicted when the number
+ *  of evictable histograms reaches the limit.
  */
-class HistCollection {
+template <typename GradientSumT>
+class HistCollectionT {
  public:
+  typedef GHistEntryT<GradientSumT> GHistEntry;
+  typedef GHistRowT<GradientSumT> GHistRow;
+
   // access histogram for i-th node
   inline GHistRow operator[](bst_uint nid) const {
     const uint32_t kMax = std::numeric_limits<uint32_t>::max();
@@ -209,14 +523,19 @@ class HistCollection {
     return (nid < row_ptr_.size() && row_ptr_[nid] != kMax);
   }
 
-  // initialize histogram collection
-  inline void Init(uint32_t nbins) {
+  // initialize histogram collection, max_evictable = 0 means no limit
+  inline void Init(uint32_t nbins, size_t max_evictable = 0) {
     nbins_ = nbins;
+    max_evictable_ = max_evictable;
     row_ptr_.clear();
     data_.clear();
+    free_rows_.clear();
+    evictable_.clear();
+    memory_.Set(this->MemoryBytes());
   }
 
-  // create an empty histogram for i-th node
+  // create an empty histogram for i-th node,
+  // the histograms of the other nodes may move
   inline void AddHistRow(bst_uint nid) {
     const uint32_t kMax = std::numeric_limits<uint32_t>::max();
     if (nid >= row_ptr_.size()) {
@@ -224,29 +543,83 @@ class HistCollection {
     }
     CHECK_EQ(row_ptr_[nid], kMax);
 
-    row_ptr_[nid] = data_.size();
-    data_.resize(data_.size() + nbins_);
+    if (free_rows_.empty() && max_evictable_ != 0 &&
+        evictable_.size() >= max_evictable_) {
+      this->ReleaseHistRow(evictable_.front());
+    }
+    if (free_rows_.empty()) {
+      row_ptr_[nid] = data_.size();
+      data_.resize(data_.size() + nbins_);
+      memory_.Set(this->MemoryBytes());
+    } else {
+      row_ptr_[nid] = free_rows_.back();
+      free_rows_.pop_back();
+      std::fill(data_.begin() + row_ptr_[nid], data_.begin() + row_ptr_[nid] + nbins_,
+                GHistEntry());
+    }
+  }
+
+  // bytes held by the histograms
+  inline size_t MemoryBytes() const {
+    return data_.capacity() * sizeof(GHistEntry);
+  }
+
+  // give the histogram of i-th node back for reuse
+  inline void ReleaseHistRow(bst_uint nid) {
+    if (!this->RowExists(nid)) return;
+    this->UnmarkEvictable(nid);
+    free_rows_.push_back(row_ptr_[nid]);
+    row_ptr_[nid] = std::numeric_limits<uint32_t>::max();
+  }
+
+  // the histogram of i-th node may be evicted
+  inline void MarkEvictable(bst_uint nid) {
+    if (this->RowExists(nid)) evictable_.push_back(nid);
+  }
+
+  // keep the histogram of i-th node until it is released
+  inline void UnmarkEvictable(bst_uint nid) {
+    evictable_.remove(nid);
   }
 
  private:
   /*! \brief number of all bins over all features */
   uint32_t nbins_;
+  /*! \brief maximum number of evictable histograms, 0 means no limit */
+  size_t max_evictable_;
 
   std::vector<GHistEntry> data_;
 
   /*! \brief row_ptr_[nid] locates bin for historgram of node nid */
   std::vector<size_t> row_ptr_;
+  /*! \brief offsets of released histograms in data_ */
+  std::vector<size_t> free_rows_;
+  /*! \brief evictable nodes, oldest first */
+  std::list<bst_uint> evictable_;
+  TrackedBytes memory_{"HistCollection"};
 };
 
+typedef HistCollectionT<double> HistCollection;
+
 /*!
  * \brief builder for histograms of gradient statistics
+ * \tparam GradientSumT type of the sums in the histograms, float or double
  */
-class GHistBuilder {
+template <typename GradientSumT>
+class GHistBuilderT {
  public:
-  // initialize builder
-  inline void Init(size_t nthread, uint32_t nbins) {
+  typedef GHistEntryT<GradientSumT> GHistEntry;
+  typedef GHistRowT<GradientSumT> GHistRow;
+
+  // initialize builder, static_rows gives every thread the same part of
+  // the rows of a node as the quantization, for NUMA hosts. deterministic
+  // sums the rows by fixed blocks, whatever the number of threads.
+  inline void Init(size_t nthread, uint32_t nbins, bool static_rows = false,
+                   bool deterministic = false) {
     nthread_ = nthread;
     nbins_ = nbins;
+    static_rows_ = static_rows;
+    deterministic_ = deterministic;
   }
 
   // construct a histogram via histogram aggregation
@@ -261,17 +634,51 @@ class GHistBuilder {
                       const GHistIndexBlockMatrix& gmatb,
                       const std::vector<bst_uint>& feat_set,
                       GHistRow hist);
+  // construct the histograms of several nodes in one pass, a node holding
+  // at most 1/nthread of their rows is built by a single thread
+  void BuildHistBatch(const std::vector<bst_gpair>& gpair,
+                      const std::vector<RowSetCollection::Elem>& row_sets,
+                      const GHistIndexMatrix& gmat,
+                      const std::vector<bst_uint>& feat_set,
+                      const std::vector<GHistRow>& hists);
   // construct a histogram via subtraction trick
   void SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent);
+  // same, for several nodes in one parallel region
+  void SubtractionTrickBatch(const std::vector<GHistRow>& self,
+                             const std::vector<GHistRow>& sibling,
+                             const std::vector<GHistRow>& parent);
+  // same, only on the bins of the features set in the bitmap of each parent,
+  // cut_ptr gives the bins of each feature; the other bins of self are kept
+  void SubtractionTrickBatch(const std::vector<GHistRow>& self,
+                             const std::vector<GHistRow>& sibling,
+                             const std::vector<GHistRow>& parent,
+                             const std::vector<const BitMap*>& features,
+                             const std::vector<uint32_t>& cut_ptr);
 
  private:
   /*! \brief number of threads for parallel computation */
   size_t nthread_;
   /*! \brief number of all bins over all features */
   uint32_t nbins_;
-  std::vector<GHistEntry> data_;
+  /*! \brief whether the rows are split statically among the threads */
+  bool static_rows_{false};
+  /*! \brief whether the histograms do not depend on the number of threads */
+  bool deterministic_{false};
+  /*!
+   * \brief histogram of each thread, allocated and cleared by the thread,
+   *  or of each block of rows for the deterministic histograms
+   */
+  std::vector<std::vector<GHistEntry> > data_;
+  TrackedBytes memory_{"GHistBuilder"};
+  // record the bytes of the histograms of the threads
+  inline void UpdateMemory() {
+    size_t nbytes = 0;
+    for (const auto& hist : data_) nbytes += hist.capacity() * sizeof(GHistEntry);
+    memory_.Set(nbytes);
+  }
 };
 
+typedef GHistBuilderT<double> GHistBuilder;
 
 }  // namespace common
 }  // namespace xgboost
@@ -5,7 +5,9 @@
 
 // dummy implementation of HostDeviceVector in case CUDA is not used
 
+#include <dmlc/logging.h>
 #include <xgboost/base.h>
+#include <algorithm>
 #include "./host_device_vector.h"
 
 namespace xgboost {
@@ -51,9 +53,32 @@ int HostDeviceVector<T>::device() const { return -1; }
 template <typename T>
 T* HostDeviceVector<T>::ptr_d(int device) { return nullptr; }
 
+template <typename T>
+const T* HostDeviceVector<T>::const_ptr_d(int device) { return nullptr; }
+
+template <typename T>
+T* HostDeviceVector<T>::shard_ptr_d(int device, size_t begin, size_t end) {
+  return nullptr;
+}
+
+template <typename T>
+T* HostDeviceVector<T>::shard_ptr_h(size_t begin, size_t end) {
+  CHECK_LE(begin, end);
+  CHECK_LE(end, impl_->data_h_.size());
+  return impl_->data_h_.data() + begin;
+}
+
+template <typename T>
+void HostDeviceVector<T>::copy_to(T* out) {
+  std::copy(impl_->data_h_.begin(), impl_->data_h_.end(), out);
+}
+
 template <typename T>
 std::vector<T>& HostDeviceVector<T>::data_h() { return impl_->data_h_; }
 
+template <typename T>
+const std::vector<T>& HostDeviceVector<T>::const_data_h() { return impl_->data_h_; }
+
 template <typename T>
 void HostDeviceVector<T>::resize(size_t new_size, T v, int new_device) {
   impl_->data_h_.resize(new_size, v);
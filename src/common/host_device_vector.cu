@@ -2,32 +2,43 @@
  * Copyright 2017 XGBoost contributors
  */
 
+#include <algorithm>
 #include "./host_device_vector.h"
 #include "./device_helpers.cuh"
 
 namespace xgboost {
 
+// a range [begin, end) of the elements
+struct ElementRange {
+  size_t begin, end;
+  bool empty() const { return begin >= end; }
+};
+
 template <typename T>
 struct HostDeviceVectorImpl {
   HostDeviceVectorImpl(size_t size, T v, int device)
-    : device_(device), on_d_(device >= 0) {
-    if (on_d_) {
+    : size_(size), device_(device), stale_h_{0, 0}, stale_d_{0, 0} {
+    if (device_ >= 0) {
       dh::safe_cuda(cudaSetDevice(device_));
       data_d_.resize(size, v);
+      stale_h_ = ElementRange{0, size};
     } else {
       data_h_.resize(size, v);
+      stale_d_ = ElementRange{0, size};
     }
   }
   // Init can be std::vector<T> or std::initializer_list<T>
   template <class Init>
   HostDeviceVectorImpl(const Init& init, int device)
-    : device_(device), on_d_(device >= 0) {
-    if (on_d_) {
+    : size_(init.size()), device_(device), stale_h_{0, 0}, stale_d_{0, 0} {
+    if (device_ >= 0) {
       dh::safe_cuda(cudaSetDevice(device_));
       data_d_.resize(init.size());
       thrust::copy(init.begin(), init.end(), data_d_.begin());
+      stale_h_ = ElementRange{0, size_};
     } else {
       data_h_ = init;
+      stale_d_ = ElementRange{0, size_};
     }
   }
   HostDeviceVectorImpl(const HostDeviceVectorImpl<T>&) = delete;
@@ -35,14 +46,26 @@ struct HostDeviceVectorImpl {
   void operator=(const HostDeviceVectorImpl<T>&) = delete;
   void operator=(HostDeviceVectorImpl<T>&&) = delete;
 
-  size_t size() const { return on_d_ ? data_d_.size() : data_h_.size(); }
+  size_t size() const { return size_; }
 
   int device() const { return device_; }
 
   T* ptr_d(int device) {
-    lazy_sync_device(device);
+    return shard_ptr_d(device, 0, size_);
+  }
+  const T* const_ptr_d(int device) {
+    set_device(device);
+    pull(true, ElementRange{0, size_}, nullptr);
     return data_d_.data().get();
   }
+  T* shard_ptr_d(int device, size_t begin, size_t end) {
+    CHECK_LE(begin, end);
+    CHECK_LE(end, size_);
+    set_device(device);
+    pull(true, ElementRange{begin, end}, nullptr);
+    touch(true, ElementRange{begin, end});
+    return data_d_.data().get() + begin;
+  }
   thrust::device_ptr<T> tbegin(int device) {
     return thrust::device_ptr<T>(ptr_d(device));
   }
@@ -51,56 +74,129 @@ struct HostDeviceVectorImpl {
     return begin + size();
   }
   std::vector<T>& data_h() {
-    lazy_sync_host();
+    shard_ptr_h(0, size_);
     return data_h_;
   }
+  const std::vector<T>& const_data_h() {
+    pull(false, ElementRange{0, size_}, nullptr);
+    return data_h_;
+  }
+  T* shard_ptr_h(size_t begin, size_t end) {
+    CHECK_LE(begin, end);
+    CHECK_LE(end, size_);
+    pull(false, ElementRange{begin, end}, nullptr);
+    touch(false, ElementRange{begin, end});
+    return data_h_.data() + begin;
+  }
+  void copy_to_d_async(int device, cudaStream_t stream) {
+    set_device(device);
+    pull(true, ElementRange{0, size_}, stream);
+  }
+  void copy_to_h_async(cudaStream_t stream) {
+    pull(false, ElementRange{0, size_}, stream);
+  }
+  void copy_to(T* out) {
+    if (size_ == 0) return;
+    // cudaMemcpyDefault finds out whether out is on the host or a device
+    if (device_ >= 0 && stale_d_.empty()) {
+      dh::safe_cuda(cudaSetDevice(device_));
+      dh::safe_cuda(cudaMemcpy(out, data_d_.data().get(), size_ * sizeof(T),
+                               cudaMemcpyDefault));
+    } else {
+      pull(false, ElementRange{0, size_}, nullptr);
+      dh::safe_cuda(cudaMemcpy(out, data_h_.data(), size_ * sizeof(T), cudaMemcpyDefault));
+    }
+  }
   void resize(size_t new_size, T v, int new_device) {
     if (new_size == this->size() && new_device == device_)
       return;
     if (new_device != -1)
       device_ = new_device;
-    // if !on_d_, but the data size is 0 and the device is set,
+    if (new_size == size_)
+      return;
+    // if the host holds no data, but the device is set,
     // resize the data on device instead
-    if (!on_d_ && (data_h_.size() > 0 || device_ == -1)) {
+    const bool on_h = stale_h_.empty() && (data_h_.size() > 0 || device_ == -1);
+    ElementRange* stale_other = on_h ? &stale_d_ : &stale_h_;
+    if (on_h) {
       data_h_.resize(new_size, v);
     } else {
+      pull(true, ElementRange{0, size_}, nullptr);
       dh::safe_cuda(cudaSetDevice(device_));
       data_d_.resize(new_size, v);
-      on_d_ = true;
     }
+    stale_other->begin = std::min(stale_other->begin, new_size);
+    stale_other->end = std::min(stale_other->end, new_size);
+    if (new_size > size_) {
+      *stale_other = hull(*stale_other, ElementRange{size_, new_size});
+    }
+    size_ = new_size;
   }
 
-  void lazy_sync_host() {
-    if (!on_d_)
-      return;
-    if (data_h_.size() != this->size())
-      data_h_.resize(this->size());
-    dh::safe_cuda(cudaSetDevice(device_));
-    thrust::copy(data_d_.begin(), data_d_.end(), data_h_.begin());
-    on_d_ = false;
-  }
-
-  void lazy_sync_device(int device) {
-    if (on_d_)
-      return;
+  void set_device(int device) {
     if (device != device_) {
       CHECK_EQ(device_, -1);
       device_ = device;
     }
-    if (data_d_.size() != this->size()) {
-      dh::safe_cuda(cudaSetDevice(device_));
-      data_d_.resize(this->size());
-    }
+  }
+
+  static ElementRange hull(ElementRange a, ElementRange b) {
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+    return ElementRange{std::min(a.begin, b.begin), std::max(a.end, b.end)};
+  }
+
+  // copy the outdated elements in r to the device or to the host,
+  // synchronously if stream is null
+  void pull(bool to_d, ElementRange r, cudaStream_t stream) {
+    ElementRange* stale = to_d ? &stale_d_ : &stale_h_;
+    ElementRange copy{std::max(stale->begin, r.begin), std::min(stale->end, r.end)};
+    if (copy.empty())
+      return;
+    // the elements left outdated must stay a single range
+    if (stale->begin < copy.begin && copy.end < stale->end)
+      copy = *stale;
     dh::safe_cuda(cudaSetDevice(device_));
-    thrust::copy(data_h_.begin(), data_h_.end(), data_d_.begin());
-    on_d_ = true;
+    if (data_d_.size() != size_)
+      data_d_.resize(size_);
+    if (data_h_.size() != size_)
+      data_h_.resize(size_);
+    T* ptr_h = data_h_.data() + copy.begin;
+    T* ptr_d = data_d_.data().get() + copy.begin;
+    const size_t nbytes = (copy.end - copy.begin) * sizeof(T);
+    if (to_d) {
+      dh::safe_cuda(cudaMemcpyAsync(ptr_d, ptr_h, nbytes, cudaMemcpyHostToDevice, stream));
+    } else {
+      dh::safe_cuda(cudaMemcpyAsync(ptr_h, ptr_d, nbytes, cudaMemcpyDeviceToHost, stream));
+    }
+    if (stream == nullptr)
+      dh::safe_cuda(cudaStreamSynchronize(stream));
+    if (copy.begin <= stale->begin) {
+      stale->begin = copy.end;
+    } else {
+      stale->end = copy.begin;
+    }
+    if (stale->empty())
+      *stale = ElementRange{0, 0};
+  }
+
+  // mark the elements in r as written on the device or on the host
+  void touch(bool on_d, ElementRange r) {
+    ElementRange* stale_other = on_d ? &stale_h_ : &stale_d_;
+    ElementRange outdated = hull(*stale_other, r);
+    // this side must be valid for all the elements outdated on the other side
+    pull(on_d, outdated, nullptr);
+    *stale_other = outdated;
   }
 
   std::vector<T> data_h_;
-  thrust::device_vector<T> data_d_;
-  // true if there is an up-to-date copy of data on device, false otherwise
-  bool on_d_;
+  dh::device_vector<T> data_d_;
+  size_t size_;
   int device_;
+  // the elements which are outdated on the host and on the device;
+  // at most one side is outdated for any element
+  ElementRange stale_h_;
+  ElementRange stale_d_;
 };
 
 template <typename T>
@@ -146,9 +242,40 @@ thrust::device_ptr<T> HostDeviceVector<T>::tend(int device) {
   return impl_->tend(device);
 }
 
+template <typename T>
+const T* HostDeviceVector<T>::const_ptr_d(int device) { return impl_->const_ptr_d(device); }
+
+template <typename T>
+T* HostDeviceVector<T>::shard_ptr_d(int device, size_t begin, size_t end) {
+  return impl_->shard_ptr_d(device, begin, end);
+}
+
+template <typename T>
+T* HostDeviceVector<T>::shard_ptr_h(size_t begin, size_t end) {
+  return impl_->shard_ptr_h(begin, end);
+}
+
+template <typename T>
+void HostDeviceVector<T>::copy_to_d_async(int device, cudaStream_t stream) {
+  impl_->copy_to_d_async(device, stream);
+}
+
+template <typename T>
+void HostDeviceVector<T>::copy_to_h_async(cudaStream_t stream) {
+  impl_->copy_to_h_async(stream);
+}
+
+template <typename T>
+void HostDeviceVector<T>::copy_to(T* out) {
+  impl_->copy_to(out);
+}
+
 template <typename T>
 std::vector<T>& HostDeviceVector<T>::data_h() { return impl_->data_h(); }
 
+template <typename T>
+const std::vector<T>& HostDeviceVector<T>::const_data_h() { return impl_->const_data_h(); }
+
 template <typename T>
 void HostDeviceVector<T>::resize(size_t new_size, T v, int new_device) {
   impl_->resize(new_size, v, new_device);
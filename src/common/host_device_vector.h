@@ -48,6 +48,24 @@ template <typename T> struct HostDeviceVectorImpl;
  *                        (assuming 'data_h' is not called in between)
  * ptr_d and data on GPU  --> no problems, the device ptr will be returned immediately
  *
+ * Read-only and write access:<br/>
+ * 'data_h' and 'ptr_d' give write access: the copy on the other side is
+ * assumed to be outdated afterwards. If the data is only read, use
+ * 'const_data_h' or 'const_ptr_d' instead. These copy the outdated part, if
+ * any, but keep both copies valid, so that e.g. the predictions read by a CPU
+ * objective are not copied back to the GPU in the next iteration.
+ *
+ * Shards:<br/>
+ * 'shard_ptr_h' and 'shard_ptr_d' give write access to the elements
+ * [begin, end) only. Only the outdated part of this range is copied in, and
+ * only this range is marked as outdated on the other side, so that a shard of
+ * the rows may be updated on one side without moving the whole vector.
+ *
+ * Asynchronous copies:<br/>
+ * From a .cu file, 'copy_to_d_async' and 'copy_to_h_async' issue the copy of
+ * the outdated part on the given stream. The copy may be used once the
+ * stream is synchronized.
+ *
  * What if xgboost is compiled without CUDA?<br/>
  * In that case, there's a special implementation which always falls-back to
  * working with std::vector. This logic can be found in host_device_vector.cc
@@ -74,15 +92,27 @@ class HostDeviceVector {
   int device() const;
   T* ptr_d(int device);
   T* ptr_h() { return data_h().data(); }
+  const T* const_ptr_d(int device);
+  const T* const_ptr_h() { return const_data_h().data(); }
+  // write access to the elements [begin, end) only
+  T* shard_ptr_d(int device, size_t begin, size_t end);
+  T* shard_ptr_h(size_t begin, size_t end);
+  // copy the elements to out, which is host or device memory, from the
+  // device when its copy is up to date
+  void copy_to(T* out);
 
   // only define functions returning device_ptr
   // if HostDeviceVector.h is included from a .cu file
 #ifdef __CUDACC__
   thrust::device_ptr<T> tbegin(int device);
   thrust::device_ptr<T> tend(int device);
+  // copy the outdated part on the stream, the copy is valid after it is synchronized
+  void copy_to_d_async(int device, cudaStream_t stream);
+  void copy_to_h_async(cudaStream_t stream);
 #endif
 
   std::vector<T>& data_h();
+  const std::vector<T>& const_data_h();
 
   // passing in new_device == -1 keeps the device as is
   void resize(size_t new_size, T v = T(), int new_device = -1);
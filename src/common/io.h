@@ -9,7 +9,11 @@
 #define XGBOOST_COMMON_IO_H_
 
 #include <dmlc/io.h>
+#include <exception>
+#include <memory>
 #include <string>
+#include <thread>
+#include <utility>
 #include <cstring>
 #include "./sync.h"
 
@@ -70,6 +74,64 @@ class PeekableInStream : public dmlc::Stream {
   /*! \brief internal buffer */
   std::string buffer_;
 };
+
+/*!
+ * \brief Writes snapshots of objects to files on a background thread.
+ *  The object is serialized in memory by the caller, so it can change as soon
+ *  as Write returns, only the write to the storage overlaps the caller.
+ *  One file is written at a time.
+ */
+class AsyncFileWriter {
+ public:
+  AsyncFileWriter() = default;
+  AsyncFileWriter(const AsyncFileWriter&) = delete;
+  AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+  ~AsyncFileWriter() {
+    try {
+      this->Wait();
+    } catch (const std::exception& e) {
+      LOG(WARNING) << "AsyncFileWriter: " << e.what();
+    }
+  }
+  /*!
+   * \brief snapshot an object and write it to a file in the background,
+   *  after the previous file is written.
+   * \param obj the object, saved with obj.Save(dmlc::Stream*)
+   * \param uri the file to write
+   */
+  template<typename T>
+  inline void Write(const T& obj, const std::string& uri) {
+    std::shared_ptr<std::string> bytes(new std::string());
+    {
+      MemoryBufferStream fs(bytes.get());
+      obj.Save(&fs);
+    }
+    this->Wait();
+    writer_ = std::thread([this, bytes, uri]() {
+        try {
+          std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(uri.c_str(), "w"));
+          fo->Write(dmlc::BeginPtr(*bytes), bytes->length());
+        } catch (...) {
+          error_ = std::current_exception();
+        }
+      });
+  }
+  /*! \brief wait for the file being written, and rethrow its error if any */
+  inline void Wait() {
+    if (writer_.joinable()) writer_.join();
+    if (error_) {
+      std::exception_ptr error = std::move(error_);
+      error_ = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+
+ private:
+  /*! \brief the thread writing the last file */
+  std::thread writer_;
+  /*! \brief the error of the last file */
+  std::exception_ptr error_;
+};
 }  // namespace common
 }  // namespace xgboost
 #endif  // XGBOOST_COMMON_IO_H_
@@ -0,0 +1,142 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file memory_tracker.h
+ * \brief record of the memory held by each subsystem, current and peak
+ */
+#ifndef XGBOOST_COMMON_MEMORY_TRACKER_H_
+#define XGBOOST_COMMON_MEMORY_TRACKER_H_
+
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace xgboost {
+namespace common {
+/*!
+ * \brief Process wide record of the bytes held by the large containers,
+ *  tagged by subsystem. The containers report their size with a TrackedBytes
+ *  once they are built or grown; the tracker keeps the current and the peak
+ *  bytes of each tag and of all of them.
+ */
+class MemoryTracker {
+ public:
+  struct Usage {
+    size_t current{0};
+    size_t peak{0};
+  };
+  static MemoryTracker* Get() {
+    // never destroyed, the containers of static objects may outlive it
+    static MemoryTracker* inst = new MemoryTracker();
+    return inst;
+  }
+  /*! \brief memory of the tag goes from old_bytes to new_bytes */
+  void Update(const std::string& tag, size_t old_bytes, size_t new_bytes) {
+    if (old_bytes == new_bytes) return;
+    std::lock_guard<std::mutex> guard(mutex_);
+    Usage& u = usage_[tag];
+    CHECK_GE(u.current, old_bytes) << "memory of " << tag << " released twice";
+    u.current = u.current - old_bytes + new_bytes;
+    u.peak = std::max(u.peak, u.current);
+    total_.current = total_.current - old_bytes + new_bytes;
+    total_.peak = std::max(total_.peak, total_.current);
+  }
+  /*! \brief copy of the usage of each tag */
+  std::map<std::string, Usage> Usages() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return usage_;
+  }
+  /*! \brief usage of all the tags together */
+  Usage Total() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return total_;
+  }
+  /*! \brief start the peaks again from the current bytes */
+  void ResetPeak() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto& kv : usage_) kv.second.peak = kv.second.current;
+    total_.peak = total_.current;
+  }
+  /*! \brief the record as {"total": {"current": bytes, "peak": bytes}, tag: {...}, ...} */
+  std::string ToJSON() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::ostringstream os;
+    os << "{\"total\": {\"current\": " << total_.current << ", \"peak\": " << total_.peak << '}';
+    for (const auto& kv : usage_) {
+      os << ", \"" << kv.first << "\": {\"current\": " << kv.second.current
+         << ", \"peak\": " << kv.second.peak << '}';
+    }
+    os << '}';
+    return os.str();
+  }
+  /*! \brief print the current and the peak memory of each tag */
+  void Print() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    LOG(CONSOLE) << "======== Memory ========";
+    char buffer[255];
+    for (const auto& kv : usage_) {
+      snprintf(buffer, sizeof(buffer), "%s:\t current %.3fMB, peak %.3fMB",
+               kv.first.c_str(), kv.second.current / 1e6, kv.second.peak / 1e6);
+      LOG(CONSOLE) << buffer;
+    }
+    snprintf(buffer, sizeof(buffer), "total:\t current %.3fMB, peak %.3fMB",
+             total_.current / 1e6, total_.peak / 1e6);
+    LOG(CONSOLE) << buffer;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<std::string, Usage> usage_;
+  Usage total_;
+};
+
+/*!
+ * \brief bytes of a container recorded under a tag of the MemoryTracker,
+ *  given back when it is destroyed. A member next to the container, that
+ *  is copied and moved along with it.
+ */
+class TrackedBytes {
+ public:
+  explicit TrackedBytes(std::string tag) : tag_(std::move(tag)) {}
+  TrackedBytes(const TrackedBytes& other) : tag_(other.tag_) {
+    this->Set(other.bytes_);
+  }
+  TrackedBytes(TrackedBytes&& other) : tag_(other.tag_), bytes_(other.bytes_) {
+    other.bytes_ = 0;
+  }
+  TrackedBytes& operator=(const TrackedBytes& other) {
+    this->Set(other.bytes_);
+    return *this;
+  }
+  TrackedBytes& operator=(TrackedBytes&& other) {
+    if (this != &other) {
+      const size_t nbytes = other.bytes_;
+      other.Set(0);
+      this->Set(nbytes);
+    }
+    return *this;
+  }
+  ~TrackedBytes() {
+    this->Set(0);
+  }
+  /*! \brief the container now holds nbytes */
+  inline void Set(size_t nbytes) {
+    MemoryTracker::Get()->Update(tag_, bytes_, nbytes);
+    bytes_ = nbytes;
+  }
+  inline size_t Bytes() const {
+    return bytes_;
+  }
+
+ private:
+  std::string tag_;
+  size_t bytes_{0};
+};
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_MEMORY_TRACKER_H_
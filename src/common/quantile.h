@@ -8,6 +8,8 @@
 #define XGBOOST_COMMON_QUANTILE_H_
 
 #include <dmlc/base.h>
+#include <dmlc/omp.h>
+#include <xgboost/base.h>
 #include <xgboost/logging.h>
 #include <cmath>
 #include <vector>
@@ -822,6 +824,30 @@ template<typename DType, typename RType = unsigned>
 class GKQuantileSketch :
       public QuantileSketchTemplate<DType, RType, GKSummary<DType, RType> > {
 };
+
+/*!
+ * \brief get the summaries of the sketches pruned to at most max_size
+ *  entries, one sketch per task, as sketches are independent
+ * \param sketchs the sketches, one per feature (and node)
+ * \param max_size maximum size of a summary
+ * \param out the summaries, with space reserved for max_size entries
+ */
+template<typename TSketch, typename TSummary>
+inline void PruneSketchSummaries(std::vector<TSketch> *sketchs, size_t max_size,
+                                 std::vector<TSummary> *out) {
+  out->resize(sketchs->size());
+  const bst_omp_uint nsketch = static_cast<bst_omp_uint>(sketchs->size());
+  #pragma omp parallel
+  {
+    typename TSketch::SummaryContainer summary;
+    #pragma omp for schedule(dynamic, 1)
+    for (bst_omp_uint i = 0; i < nsketch; ++i) {
+      (*sketchs)[i].GetSummary(&summary);
+      (*out)[i].Reserve(max_size);
+      (*out)[i].SetPrune(summary, max_size);
+    }
+  }
+}
 }  // namespace common
 }  // namespace xgboost
 #endif  // XGBOOST_COMMON_QUANTILE_H_
@@ -0,0 +1,145 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file radix_sort.h
+ * \brief LSD radix sort of entries by their float value, used to sort the
+ *  columns of the column pages.
+ */
+#ifndef XGBOOST_COMMON_RADIX_SORT_H_
+#define XGBOOST_COMMON_RADIX_SORT_H_
+
+#include <dmlc/omp.h>
+#include <xgboost/base.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+/*!
+ * \brief map a float to an unsigned key of the same order,
+ *  the sign bit is flipped for positive values and all bits for negative ones.
+ */
+inline uint32_t FloatSortKey(bst_float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return (bits & 0x80000000U) != 0 ? ~bits : (bits | 0x80000000U);
+}
+
+/*!
+ * \brief stable sort of entries by fvalue, in four passes of eight bits.
+ *  A pass whose digit is the same for all the entries is skipped, so values
+ *  of a narrow range take fewer passes.
+ * \param data the entries, sorted in place
+ * \param n the number of entries
+ * \param tmp buffer of at least n entries
+ * \param nthread the number of threads counting and scattering each pass
+ * \tparam Entry entry with a fvalue field
+ */
+template<typename Entry>
+inline void RadixSortByValue(Entry* data, size_t n, Entry* tmp, int nthread) {
+  const int kBuckets = 256;
+  const size_t kMinChunk = 1 << 14;
+  nthread = static_cast<int>(
+      std::max(static_cast<size_t>(1),
+               std::min(static_cast<size_t>(nthread), n / kMinChunk)));
+  std::vector<size_t> count(static_cast<size_t>(nthread) * kBuckets);
+  const size_t chunk = (n + nthread - 1) / nthread;
+  Entry* src = data;
+  Entry* dst = tmp;
+  for (int shift = 0; shift < 32; shift += 8) {
+    auto count_chunk = [&](int tid) {
+      size_t* cnt = &count[tid * kBuckets];
+      std::fill(cnt, cnt + kBuckets, 0);
+      const size_t end = std::min(n, chunk * (tid + 1));
+      for (size_t i = chunk * tid; i < end; ++i) {
+        ++cnt[(FloatSortKey(src[i].fvalue) >> shift) & 0xff];
+      }
+    };
+    auto scatter_chunk = [&](int tid) {
+      size_t* pos = &count[tid * kBuckets];
+      const size_t end = std::min(n, chunk * (tid + 1));
+      for (size_t i = chunk * tid; i < end; ++i) {
+        dst[pos[(FloatSortKey(src[i].fvalue) >> shift) & 0xff]++] = src[i];
+      }
+    };
+    if (nthread == 1) {
+      count_chunk(0);
+    } else {
+      #pragma omp parallel num_threads(nthread)
+      count_chunk(omp_get_thread_num());
+    }
+    // exclusive prefix sum in the order (bucket, thread), keeps the sort stable
+    size_t sum = 0;
+    bool skip = false;
+    for (int b = 0; b < kBuckets && !skip; ++b) {
+      const size_t begin = sum;
+      for (int tid = 0; tid < nthread; ++tid) {
+        const size_t c = count[tid * kBuckets + b];
+        count[tid * kBuckets + b] = sum;
+        sum += c;
+      }
+      skip = sum - begin == n;
+    }
+    if (skip) continue;
+    if (nthread == 1) {
+      scatter_chunk(0);
+    } else {
+      #pragma omp parallel num_threads(nthread)
+      scatter_chunk(omp_get_thread_num());
+    }
+    std::swap(src, dst);
+  }
+  if (src != data) {
+    std::copy(src, src + n, data);
+  }
+}
+
+/*!
+ * \brief sort each group data[ptr[i]:ptr[i+1]] by fvalue.
+ *  The groups are sorted in parallel, one thread each, except the groups
+ *  holding more than a share of a thread of the entries, which are sorted one
+ *  after another by all the threads.
+ * \param ptr the group pointer
+ * \param data the entries of the groups
+ * \param nthread the number of threads
+ */
+template<typename Entry, typename SizeType>
+inline void SortGroupsByValue(const std::vector<SizeType>& ptr,
+                              std::vector<Entry>* data, int nthread) {
+  // below this length the comparison sort is faster
+  const size_t kRadixMinLength = 256;
+  if (ptr.size() < 2) return;
+  const size_t ngroup = ptr.size() - 1;
+  const size_t large = std::max(data->size() / std::max(nthread, 1), kRadixMinLength);
+  auto cmp = [](const Entry& a, const Entry& b) { return a.fvalue < b.fvalue; };
+  std::vector<size_t> large_groups;
+  for (size_t i = 0; i < ngroup; ++i) {
+    if (nthread > 1 && ptr[i + 1] - ptr[i] > large) large_groups.push_back(i);
+  }
+  const bst_omp_uint nsize = static_cast<bst_omp_uint>(ngroup);
+  #pragma omp parallel num_threads(nthread)
+  {
+    std::vector<Entry> tmp;
+    #pragma omp for schedule(dynamic, 1)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      const size_t len = ptr[i + 1] - ptr[i];
+      if (len < 2 || (nthread > 1 && len > large)) continue;
+      Entry* begin = dmlc::BeginPtr(*data) + ptr[i];
+      if (len < kRadixMinLength) {
+        std::sort(begin, begin + len, cmp);
+      } else {
+        tmp.resize(len);
+        RadixSortByValue(begin, len, dmlc::BeginPtr(tmp), 1);
+      }
+    }
+  }
+  std::vector<Entry> tmp;
+  for (size_t i : large_groups) {
+    const size_t len = ptr[i + 1] - ptr[i];
+    tmp.resize(len);
+    RadixSortByValue(dmlc::BeginPtr(*data) + ptr[i], len, dmlc::BeginPtr(tmp), nthread);
+  }
+}
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_RADIX_SORT_H_
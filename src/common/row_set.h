@@ -7,9 +7,11 @@
 #ifndef XGBOOST_COMMON_ROW_SET_H_
 #define XGBOOST_COMMON_ROW_SET_H_
 
+#include <dmlc/omp.h>
 #include <xgboost/data.h>
 #include <algorithm>
 #include <vector>
+#include "./first_touch.h"
 
 namespace xgboost {
 namespace common {
@@ -25,23 +27,21 @@ class RowSetCollection {
     const size_t* end;
     int node_id;
       // id of node associated with this instance set; -1 means uninitialized
+    // gradients of the rows [begin, end) in the same order, nullptr unless
+    // the collection keeps the gradients with the rows
+    const bst_gpair* gpair;
     Elem(void)
-        : begin(nullptr), end(nullptr), node_id(-1) {}
+        : begin(nullptr), end(nullptr), node_id(-1), gpair(nullptr) {}
     Elem(const size_t* begin,
          const size_t* end,
-         int node_id)
-        : begin(begin), end(end), node_id(node_id) {}
+         int node_id,
+         const bst_gpair* gpair = nullptr)
+        : begin(begin), end(end), node_id(node_id), gpair(gpair) {}
 
     inline size_t size() const {
       return end - begin;
     }
   };
-  /* \brief specifies how to split a rowset into two */
-  struct Split {
-    std::vector<size_t> left;
-    std::vector<size_t> right;
-  };
-
   inline std::vector<Elem>::const_iterator begin() const {
     return elem_of_each_node_.begin();
   }
@@ -60,6 +60,7 @@ class RowSetCollection {
   // clear up things
   inline void Clear() {
     row_indices_.clear();
+    gpair_.clear();
     elem_of_each_node_.clear();
   }
   // initialize node id 0->everything
@@ -78,31 +79,102 @@ class RowSetCollection {
       return;
     }
 
-    const size_t* begin = dmlc::BeginPtr(row_indices_);
-    const size_t* end = dmlc::BeginPtr(row_indices_) + row_indices_.size();
+    const size_t* begin = row_indices_.data();
+    const size_t* end = row_indices_.data() + row_indices_.size();
     elem_of_each_node_.emplace_back(Elem(begin, end, 0));
   }
-  // split rowset into two
-  inline void AddSplit(unsigned node_id,
-                       const std::vector<Split>& row_split_tloc,
-                       unsigned left_node_id,
-                       unsigned right_node_id) {
+  /*!
+   * \brief keep a copy of the gradients of the rows next to them, moved with
+   *  the rows by Partition, so that the gradients of a node are contiguous.
+   *  Called after Init, before the first split.
+   */
+  inline void InitGradients(const std::vector<bst_gpair>& gpair, int nthread) {
+    CHECK_EQ(elem_of_each_node_.size(), 1U);
+    const bst_omp_uint nrows = static_cast<bst_omp_uint>(row_indices_.size());
+    gpair_.resize(nrows);
+    #pragma omp parallel for num_threads(nthread) schedule(static)
+    for (bst_omp_uint i = 0; i < nrows; ++i) {
+      gpair_[i] = gpair[row_indices_[i]];
+    }
+    if (nrows != 0) elem_of_each_node_[0].gpair = gpair_.data();
+  }
+  /*!
+   * \brief split the rowset of node_id into two, in place and stable.
+   *  goes_left[i] tells whether the i-th row of the set goes to the left child.
+   *
+   *  The rows are processed in blocks in parallel. Each block writes its left
+   *  rows forward and its right rows backward into its part of a buffer. An
+   *  exclusive prefix sum over the left counts of the blocks gives the
+   *  destination of each block, which then copies its rows back in parallel.
+   */
+  inline void Partition(unsigned node_id,
+                        const std::vector<uint8_t>& goes_left,
+                        unsigned left_node_id,
+                        unsigned right_node_id,
+                        int nthread) {
     const Elem e = elem_of_each_node_[node_id];
-    const bst_omp_uint nthread = static_cast<bst_omp_uint>(row_split_tloc.size());
     CHECK(e.begin != nullptr);
-    size_t* all_begin = dmlc::BeginPtr(row_indices_);
+    const size_t kPartitionBlock = 2048;  // rows partitioned by one task
+    const size_t nrows = e.size();
+    CHECK_EQ(goes_left.size(), nrows);
+    size_t* all_begin = row_indices_.data();
     size_t* begin = all_begin + (e.begin - all_begin);
-
-    size_t* it = begin;
-    for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
-      std::copy(row_split_tloc[tid].left.begin(), row_split_tloc[tid].left.end(), it);
-      it += row_split_tloc[tid].left.size();
+    // the gradients of the rows follow them when they are kept
+    bst_gpair* gbegin = gpair_.empty() ? nullptr : gpair_.data() + (e.begin - all_begin);
+
+    const bst_omp_uint nblock =
+        static_cast<bst_omp_uint>((nrows + kPartitionBlock - 1) / kPartitionBlock);
+    partition_buffer_.resize(nrows);
+    block_left_.resize(nblock + 1);
+    size_t* buffer = partition_buffer_.data();
+    if (gbegin != nullptr) gpair_buffer_.resize(nrows);
+    bst_gpair* gbuffer = gpair_buffer_.data();
+
+    #pragma omp parallel for num_threads(nthread) schedule(static)
+    for (bst_omp_uint b = 0; b < nblock; ++b) {
+      const size_t ibegin = b * kPartitionBlock;
+      const size_t iend = std::min(ibegin + kPartitionBlock, nrows);
+      size_t nleft = 0, nright = 0;
+      if (gbegin == nullptr) {
+        for (size_t i = ibegin; i < iend; ++i) {
+          if (goes_left[i]) {
+            buffer[ibegin + nleft++] = begin[i];
+          } else {
+            buffer[iend - 1 - nright++] = begin[i];
+          }
+        }
+      } else {
+        for (size_t i = ibegin; i < iend; ++i) {
+          const size_t k = goes_left[i] ? ibegin + nleft++ : iend - 1 - nright++;
+          buffer[k] = begin[i];
+          gbuffer[k] = gbegin[i];
+        }
+      }
+      block_left_[b + 1] = nleft;
+    }
+    block_left_[0] = 0;
+    for (bst_omp_uint b = 0; b < nblock; ++b) {
+      block_left_[b + 1] += block_left_[b];
     }
-    size_t* split_pt = it;
-    for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
-      std::copy(row_split_tloc[tid].right.begin(), row_split_tloc[tid].right.end(), it);
-      it += row_split_tloc[tid].right.size();
+    const size_t nleft_total = block_left_[nblock];
+
+    #pragma omp parallel for num_threads(nthread) schedule(static)
+    for (bst_omp_uint b = 0; b < nblock; ++b) {
+      const size_t ibegin = b * kPartitionBlock;
+      const size_t iend = std::min(ibegin + kPartitionBlock, nrows);
+      const size_t nleft = block_left_[b + 1] - block_left_[b];
+      std::copy(buffer + ibegin, buffer + ibegin + nleft, begin + block_left_[b]);
+      // the rows before the block that are not left go right
+      size_t* right = begin + nleft_total + (ibegin - block_left_[b]);
+      std::reverse_copy(buffer + ibegin + nleft, buffer + iend, right);
+      if (gbegin != nullptr) {
+        std::copy(gbuffer + ibegin, gbuffer + ibegin + nleft, gbegin + block_left_[b]);
+        std::reverse_copy(gbuffer + ibegin + nleft, gbuffer + iend,
+                          gbegin + (right - begin));
+      }
     }
+    size_t* split_pt = begin + nleft_total;
+    const bst_gpair* gsplit_pt = gbegin == nullptr ? nullptr : gbegin + nleft_total;
 
     if (left_node_id >= elem_of_each_node_.size()) {
       elem_of_each_node_.resize(left_node_id + 1, Elem(nullptr, nullptr, -1));
@@ -111,17 +183,27 @@ class RowSetCollection {
       elem_of_each_node_.resize(right_node_id + 1, Elem(nullptr, nullptr, -1));
     }
 
-    elem_of_each_node_[left_node_id] = Elem(begin, split_pt, left_node_id);
-    elem_of_each_node_[right_node_id] = Elem(split_pt, e.end, right_node_id);
+    elem_of_each_node_[left_node_id] = Elem(begin, split_pt, left_node_id, gbegin);
+    elem_of_each_node_[right_node_id] = Elem(split_pt, e.end, right_node_id, gsplit_pt);
     elem_of_each_node_[node_id] = Elem(nullptr, nullptr, -1);
   }
 
-  // stores the row indices in the set
-  std::vector<size_t> row_indices_;
+  // stores the row indices in the set, left unwritten by resize so that
+  // a parallel loop places it
+  FirstTouchVector<size_t> row_indices_;
+  // gradients of the rows of row_indices_ in the same order, empty unless
+  // InitGradients was called
+  FirstTouchVector<bst_gpair> gpair_;
 
  private:
   // vector: node_id -> elements
   std::vector<Elem> elem_of_each_node_;
+  // temp space of Partition: the rows of each block, left and right
+  FirstTouchVector<size_t> partition_buffer_;
+  // temp space of Partition: prefix sum of the left counts of the blocks
+  std::vector<size_t> block_left_;
+  // temp space of Partition: the gradients of the rows of partition_buffer_
+  FirstTouchVector<bst_gpair> gpair_buffer_;
 };
 
 }  // namespace common
@@ -0,0 +1,77 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file task_queue.h
+ * \brief tasks run one after the other on a background thread
+ */
+#ifndef XGBOOST_COMMON_TASK_QUEUE_H_
+#define XGBOOST_COMMON_TASK_QUEUE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace xgboost {
+namespace common {
+/*!
+ * \brief Runs the pushed tasks in order on a thread of its own, started by
+ *  the first task. The destructor runs the pending tasks before it returns.
+ *  A task must not throw, it reports its errors itself.
+ */
+class TaskQueue {
+ public:
+  TaskQueue() = default;
+  TaskQueue(const TaskQueue&) = delete;
+  TaskQueue& operator=(const TaskQueue&) = delete;
+  ~TaskQueue() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+  }
+  /*! \brief run the task after the ones pushed before */
+  inline void Push(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      tasks_.push_back(std::move(task));
+      if (!worker_.joinable()) worker_ = std::thread([this]() { this->Run(); });
+    }
+    cv_.notify_all();
+  }
+  /*! \brief wait until the tasks pushed so far are done */
+  inline void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return tasks_.empty() && !running_; });
+  }
+
+ private:
+  inline void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+      if (tasks_.empty()) return;
+      std::function<void()> task = std::move(tasks_.front());
+      tasks_.pop_front();
+      running_ = true;
+      lock.unlock();
+      task();
+      lock.lock();
+      running_ = false;
+      cv_.notify_all();
+    }
+  }
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()> > tasks_;
+  // whether a task is running, it is no longer in tasks_
+  bool running_{false};
+  bool stop_{false};
+  std::thread worker_;
+};
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_TASK_QUEUE_H_
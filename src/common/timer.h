@@ -3,12 +3,21 @@
  */
 #pragma once
 #include <xgboost/logging.h>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <map>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#if defined(XGBOOST_USE_NVTX)
+#include <nvToolsExt.h>
+#endif
+
 namespace xgboost {
 namespace common {
 struct Timer {
@@ -36,11 +45,146 @@ struct Timer {
   }
 };
 
+/**
+ * \class  Profiler
+ *
+ * \brief Process wide record of named phase timings and counters, filled by
+ * the monitors of all components. The learner clears it at the start of each
+ * iteration, so it holds the profile of the current iteration.
+ *
+ * When tracing, every timing is also kept as an event of the thread that
+ * recorded it, ending when it is added, or of each GPU device it was
+ * synchronised on. The events are exported in the Chrome trace event format,
+ * for chrome://tracing or Perfetto, and are not cleared with the profile.
+ */
+class Profiler {
+ public:
+  typedef std::chrono::steady_clock ClockT;
+
+  static Profiler* Get() {
+    static Profiler inst;
+    return &inst;
+  }
+  void AddTime(const std::string &name, double seconds) {
+    this->AddTime(name, seconds, std::vector<int>());
+  }
+  /*! \brief the timing of a phase run on the devices, devices are traced
+   *  instead of the thread when not empty */
+  void AddTime(const std::string &name, double seconds, const std::vector<int>& devices) {
+    const ClockT::time_point end = ClockT::now();
+    std::lock_guard<std::mutex> guard(mutex_);
+    timings_[name] += seconds;
+    if (!tracing_) return;
+    TraceEvent e;
+    e.name = name;
+    e.end_us = std::chrono::duration_cast<std::chrono::microseconds>(end - origin_).count();
+    e.dur_us = static_cast<int64_t>(seconds * 1e6);
+    if (devices.empty()) {
+      auto it = thread_ids_.find(std::this_thread::get_id());
+      if (it == thread_ids_.end()) {
+        it = thread_ids_.emplace(std::this_thread::get_id(),
+                                 static_cast<int>(thread_ids_.size())).first;
+      }
+      e.tid = it->second;
+      e.device = false;
+      events_.push_back(e);
+    } else {
+      e.device = true;
+      for (int device : devices) {
+        e.tid = device;
+        events_.push_back(e);
+      }
+    }
+  }
+  /*! \brief start or stop recording the events, the trace is cleared when started */
+  void SetTracing(bool tracing) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (tracing && !tracing_) events_.clear();
+    tracing_ = tracing;
+  }
+  bool Tracing() const {
+    return tracing_;
+  }
+  /*! \brief the events as a Chrome trace, the host threads in process 0 and
+   *  the devices in process 1. Names are assumed free of quotes. */
+  std::string TraceJSON() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::ostringstream os;
+    os << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+       << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, "
+       << "\"args\": {\"name\": \"host\"}},\n"
+       << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+       << "\"args\": {\"name\": \"devices\"}}";
+    for (const TraceEvent& e : events_) {
+      const size_t dot = e.name.find('.');
+      os << ",\n{\"name\": \"" << e.name << "\", \"cat\": \""
+         << e.name.substr(0, dot) << "\", \"ph\": \"X\", \"ts\": " << e.end_us - e.dur_us
+         << ", \"dur\": " << e.dur_us << ", \"pid\": " << (e.device ? 1 : 0)
+         << ", \"tid\": " << e.tid << '}';
+    }
+    os << "\n]}\n";
+    return os.str();
+  }
+  void AddCount(const std::string &name, uint64_t count) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    counters_[name] += count;
+  }
+  void Clear() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    timings_.clear();
+    counters_.clear();
+  }
+  /*! \brief copy of the timings, in seconds */
+  std::map<std::string, double> Timings() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return timings_;
+  }
+  /*! \brief copy of the counters */
+  std::map<std::string, uint64_t> Counters() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return counters_;
+  }
+  /*! \brief the record as {"timings": {name: seconds}, "counters": {name: count}} */
+  std::string ToJSON() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::ostringstream os;
+    os << "{\"timings\": {";
+    for (auto it = timings_.begin(); it != timings_.end(); ++it) {
+      os << (it == timings_.begin() ? "" : ", ") << '"' << it->first << "\": " << it->second;
+    }
+    os << "}, \"counters\": {";
+    for (auto it = counters_.begin(); it != counters_.end(); ++it) {
+      os << (it == counters_.begin() ? "" : ", ") << '"' << it->first << "\": " << it->second;
+    }
+    os << "}}";
+    return os.str();
+  }
+
+ private:
+  struct TraceEvent {
+    std::string name;
+    // end and duration in microseconds since the creation of the profiler
+    int64_t end_us;
+    int64_t dur_us;
+    // the thread, or the device
+    int tid;
+    bool device;
+  };
+  std::mutex mutex_;
+  std::map<std::string, double> timings_;
+  std::map<std::string, uint64_t> counters_;
+  std::atomic<bool> tracing_{false};
+  ClockT::time_point origin_{ClockT::now()};
+  std::map<std::thread::id, int> thread_ids_;
+  std::vector<TraceEvent> events_;
+};
+
 /**
  * \struct  Monitor
  *
  * \brief Timing utility used to measure total method execution time over the
- * lifetime of the containing object.
+ * lifetime of the containing object. Every timing and counter is also
+ * recorded in the Profiler as label.name.
  */
 
 struct Monitor {
@@ -65,25 +209,48 @@ struct Monitor {
     this->debug_verbose = debug_verbose;
     this->label = label;
   }
-  void Start(const std::string &name) { timer_map[name].Start(); }
+  void Start(const std::string &name) {
+#if defined(XGBOOST_USE_NVTX)
+    nvtxRangePushA((label + "." + name).c_str());
+#endif
+    timer_map[name].Start();
+  }
   void Start(const std::string &name, std::vector<int> dList) {
-    if (debug_verbose) {
+    // the devices are synchronised when their timings are printed or traced
+    if (debug_verbose || Profiler::Get()->Tracing()) {
 #ifdef __CUDACC__
 #include "device_helpers.cuh"
       dh::synchronize_n_devices(dList.size(), dList);
 #endif
     }
-    timer_map[name].Start();
+    this->Start(name);
+  }
+  void Stop(const std::string &name) {
+    this->Stop(name, std::vector<int>(), false);
   }
-  void Stop(const std::string &name) { timer_map[name].Stop(); }
   void Stop(const std::string &name, std::vector<int> dList) {
-    if (debug_verbose) {
+    this->Stop(name, dList, true);
+  }
+  void AddCount(const std::string &name, uint64_t count) {
+    Profiler::Get()->AddCount(label + "." + name, count);
+  }
+
+ private:
+  void Stop(const std::string &name, const std::vector<int>& dList, bool sync) {
+    if (sync && (debug_verbose || Profiler::Get()->Tracing())) {
 #ifdef __CUDACC__
 #include "device_helpers.cuh"
       dh::synchronize_n_devices(dList.size(), dList);
 #endif
     }
-    timer_map[name].Stop();
+    Timer &timer = timer_map[name];
+    const Timer::DurationT before = timer.elapsed;
+    timer.Stop();
+#if defined(XGBOOST_USE_NVTX)
+    nvtxRangePop();
+#endif
+    Profiler::Get()->AddTime(label + "." + name,
+                             Timer::SecondsT(timer.elapsed - before).count(), dList);
   }
 };
 }  // namespace common
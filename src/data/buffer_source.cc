@@ -0,0 +1,153 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file buffer_source.cc
+ */
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include "./buffer_source.h"
+#include "../common/math.h"
+
+namespace xgboost {
+namespace data {
+
+bool BufferSource::Next() {
+  if (row_begin_ >= info.num_row) return false;
+  const size_t row_end = std::min(static_cast<size_t>(info.num_row),
+                                  row_begin_ + block_rows_);
+  this->ConvertRows(row_begin_, row_end, &row_ptr_, &row_data_);
+  batch_.size = row_end - row_begin_;
+  batch_.base_rowid = row_begin_;
+  batch_.ind_ptr = dmlc::BeginPtr(row_ptr_);
+  batch_.data_ptr = dmlc::BeginPtr(row_data_);
+  row_begin_ = row_end;
+  return true;
+}
+
+void BufferSource::BeforeFirst() {
+  row_begin_ = 0;
+}
+
+const RowBatch& BufferSource::Value() const {
+  return batch_;
+}
+
+DenseBufferSource::DenseBufferSource(const bst_float* data, size_t nrow,
+                                     size_t ncol, bst_float missing,
+                                     size_t block_rows)
+    : BufferSource(block_rows), data_(data), ncol_(ncol), missing_(missing),
+      nan_missing_(common::CheckNAN(missing)) {
+  const omp_ulong nelem = static_cast<omp_ulong>(nrow * ncol);
+  bool nan_error = false;
+  uint64_t nonzero = 0;
+  #pragma omp parallel for schedule(static) reduction(+:nonzero) reduction(||:nan_error)
+  for (omp_ulong i = 0; i < nelem; ++i) {
+    if (common::CheckNAN(data[i]) && !nan_missing_) nan_error = true;
+    if (this->IsValid(data[i])) ++nonzero;
+  }
+  CHECK(!nan_error)
+      << "There are NAN in the matrix, however, you did not set missing=NAN";
+  info.num_row = nrow;
+  info.num_col = ncol;
+  info.num_nonzero = nonzero;
+}
+
+inline bool DenseBufferSource::IsValid(bst_float v) const {
+  return !common::CheckNAN(v) && (nan_missing_ || v != missing_);
+}
+
+void DenseBufferSource::ConvertRows(size_t begin, size_t end,
+                                    std::vector<size_t>* row_ptr,
+                                    std::vector<RowBatch::Entry>* data) const {
+  const omp_ulong nrow = static_cast<omp_ulong>(end - begin);
+  row_ptr->resize(nrow + 1);
+  (*row_ptr)[0] = 0;
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    const bst_float* row = data_ + (begin + i) * ncol_;
+    size_t length = 0;
+    for (size_t j = 0; j < ncol_; ++j) {
+      if (this->IsValid(row[j])) ++length;
+    }
+    (*row_ptr)[i + 1] = length;
+  }
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    (*row_ptr)[i + 1] += (*row_ptr)[i];
+  }
+  data->resize(row_ptr->back());
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    const bst_float* row = data_ + (begin + i) * ncol_;
+    RowBatch::Entry* out = dmlc::BeginPtr(*data) + (*row_ptr)[i];
+    for (size_t j = 0; j < ncol_; ++j) {
+      if (this->IsValid(row[j])) {
+        *out++ = RowBatch::Entry(static_cast<bst_uint>(j), row[j]);
+      }
+    }
+  }
+}
+
+CSRBufferSource::CSRBufferSource(const size_t* indptr, const unsigned* indices,
+                                 const bst_float* data, size_t nindptr,
+                                 size_t num_col, size_t block_rows)
+    : BufferSource(block_rows), indptr_(indptr), indices_(indices),
+      data_(data) {
+  CHECK_GE(nindptr, 1U) << "CSRBufferSource: empty row pointer";
+  const omp_ulong nelem = static_cast<omp_ulong>(indptr[nindptr - 1] - indptr[0]);
+  uint64_t nonzero = 0;
+  size_t num_column = 0;
+  #pragma omp parallel
+  {
+    size_t max_column = 0;
+    #pragma omp for schedule(static) reduction(+:nonzero)
+    for (omp_ulong i = 0; i < nelem; ++i) {
+      const size_t j = indptr[0] + i;
+      if (!common::CheckNAN(data[j])) {
+        ++nonzero;
+        max_column = std::max(max_column, static_cast<size_t>(indices[j] + 1));
+      }
+    }
+    #pragma omp critical
+    num_column = std::max(num_column, max_column);
+  }
+  info.num_row = nindptr - 1;
+  info.num_col = num_column;
+  if (num_col > 0) {
+    CHECK_LE(info.num_col, num_col)
+        << "num_col=" << num_col << " vs " << info.num_col;
+    info.num_col = num_col;
+  }
+  info.num_nonzero = nonzero;
+}
+
+void CSRBufferSource::ConvertRows(size_t begin, size_t end,
+                                  std::vector<size_t>* row_ptr,
+                                  std::vector<RowBatch::Entry>* data) const {
+  const omp_ulong nrow = static_cast<omp_ulong>(end - begin);
+  row_ptr->resize(nrow + 1);
+  (*row_ptr)[0] = 0;
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    size_t length = 0;
+    for (size_t j = indptr_[begin + i]; j < indptr_[begin + i + 1]; ++j) {
+      if (!common::CheckNAN(data_[j])) ++length;
+    }
+    (*row_ptr)[i + 1] = length;
+  }
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    (*row_ptr)[i + 1] += (*row_ptr)[i];
+  }
+  data->resize(row_ptr->back());
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    RowBatch::Entry* out = dmlc::BeginPtr(*data) + (*row_ptr)[i];
+    for (size_t j = indptr_[begin + i]; j < indptr_[begin + i + 1]; ++j) {
+      if (!common::CheckNAN(data_[j])) {
+        *out++ = RowBatch::Entry(indices_[j], data_[j]);
+      }
+    }
+  }
+}
+
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,106 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file buffer_source.h
+ * \brief Data sources over dense or CSR buffers owned by the caller, the
+ *  entries are produced one block of rows at a time instead of copied.
+ */
+#ifndef XGBOOST_DATA_BUFFER_SOURCE_H_
+#define XGBOOST_DATA_BUFFER_SOURCE_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <vector>
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief Base class of the sources over caller owned buffers.
+ *  The buffers are not copied and must stay valid and unchanged for the
+ *  lifetime of the source, and of any DMatrix created from it. Each call to
+ *  Next converts the next block of rows into a reused entry buffer, so the
+ *  memory held by the source is bounded by the block size.
+ */
+class BufferSource : public DataSource {
+ public:
+  /*! \brief default number of rows converted per batch */
+  static const size_t kBlockRows = 1 << 16;
+  /*!
+   * \param block_rows The number of rows of each batch.
+   */
+  explicit BufferSource(size_t block_rows)
+      : block_rows_(block_rows), row_begin_(0) {}
+  // implement Next
+  bool Next() override;
+  // implement BeforeFirst
+  void BeforeFirst() override;
+  // implement Value
+  const RowBatch &Value() const override;
+
+ protected:
+  /*!
+   * \brief convert the rows [begin, end) into CSR form.
+   * \param begin The first row of the block.
+   * \param end The end of the block.
+   * \param row_ptr The row pointer of the block, starting at 0.
+   * \param data The entries of the block.
+   */
+  virtual void ConvertRows(size_t begin, size_t end,
+                           std::vector<size_t> *row_ptr,
+                           std::vector<RowBatch::Entry> *data) const = 0;
+
+ private:
+  /*! \brief rows per batch */
+  size_t block_rows_;
+  /*! \brief first row of the next batch */
+  size_t row_begin_;
+  /*! \brief row pointer of the current batch */
+  std::vector<size_t> row_ptr_;
+  /*! \brief entries of the current batch */
+  std::vector<RowBatch::Entry> row_data_;
+  /*! \brief the current batch */
+  RowBatch batch_;
+};
+
+/*!
+ * \brief Source over a row major dense matrix, the entries equal to missing
+ *  (or NaN) are skipped.
+ */
+class DenseBufferSource : public BufferSource {
+ public:
+  DenseBufferSource(const bst_float *data, size_t nrow, size_t ncol,
+                    bst_float missing, size_t block_rows = kBlockRows);
+
+ protected:
+  void ConvertRows(size_t begin, size_t end, std::vector<size_t> *row_ptr,
+                   std::vector<RowBatch::Entry> *data) const override;
+
+ private:
+  /*! \brief whether the value v is present */
+  inline bool IsValid(bst_float v) const;
+  const bst_float *data_;
+  size_t ncol_;
+  bst_float missing_;
+  bool nan_missing_;
+};
+
+/*!
+ * \brief Source over a CSR matrix, NaN entries are skipped.
+ */
+class CSRBufferSource : public BufferSource {
+ public:
+  CSRBufferSource(const size_t *indptr, const unsigned *indices,
+                  const bst_float *data, size_t nindptr, size_t num_col,
+                  size_t block_rows = kBlockRows);
+
+ protected:
+  void ConvertRows(size_t begin, size_t end, std::vector<size_t> *row_ptr,
+                   std::vector<RowBatch::Entry> *data) const override;
+
+ private:
+  const size_t *indptr_;
+  const unsigned *indices_;
+  const bst_float *data_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_BUFFER_SOURCE_H_
@@ -0,0 +1,139 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file columnar_source.cc
+ */
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include "./columnar_source.h"
+#include "../common/group_data.h"
+#include "../common/math.h"
+
+namespace xgboost {
+namespace data {
+namespace {
+// call fn(row, value) on the valid values of a column
+template <typename T, typename Fn>
+inline void VisitValues(const T* values, const uint8_t* validity,
+                        uint64_t offset, size_t nrow, Fn fn) {
+  for (size_t i = 0; i < nrow; ++i) {
+    const uint64_t j = offset + i;
+    if (validity != nullptr && ((validity[j >> 3] >> (j & 7)) & 1) == 0) continue;
+    const bst_float v = static_cast<bst_float>(values[j]);
+    if (common::CheckNAN(v)) continue;
+    fn(i, v);
+  }
+}
+
+template <typename Fn>
+inline void VisitColumn(const void* column, int type, const uint8_t* validity,
+                        uint64_t offset, size_t nrow, Fn fn) {
+  switch (type) {
+    case kFloat32:
+      VisitValues(static_cast<const float*>(column), validity, offset, nrow, fn);
+      break;
+    case kDouble:
+      VisitValues(static_cast<const double*>(column), validity, offset, nrow, fn);
+      break;
+    case kUInt32:
+      VisitValues(static_cast<const uint32_t*>(column), validity, offset, nrow, fn);
+      break;
+    case kUInt64:
+      VisitValues(static_cast<const uint64_t*>(column), validity, offset, nrow, fn);
+      break;
+  }
+}
+}  // namespace
+
+ColumnarSource::ColumnarSource(const void* const* columns, const int* types,
+                               const uint8_t* const* validity,
+                               const uint64_t* offsets, size_t ncol, size_t nrow,
+                               size_t block_rows)
+    : block_rows_(block_rows), row_begin_(0) {
+  CHECK_GT(block_rows_, 0U);
+  for (size_t c = 0; c < ncol; ++c) {
+    CHECK(types[c] == kFloat32 || types[c] == kDouble ||
+          types[c] == kUInt32 || types[c] == kUInt64)
+        << "ColumnarSource: unknown data type " << types[c] << " of column " << c;
+    CHECK(columns[c] != nullptr || nrow == 0)
+        << "ColumnarSource: no values in column " << c;
+  }
+  const bst_omp_uint ncolumn = static_cast<bst_omp_uint>(ncol);
+  col_ptr_.resize(ncol + 1);
+  col_ptr_[0] = 0;
+  // count the valid values of each column, then copy them
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (bst_omp_uint c = 0; c < ncolumn; ++c) {
+    size_t length = 0;
+    VisitColumn(columns[c], types[c], validity == nullptr ? nullptr : validity[c],
+                offsets == nullptr ? 0 : offsets[c], nrow,
+                [&](size_t, bst_float) { ++length; });
+    col_ptr_[c + 1] = length;
+  }
+  for (size_t c = 0; c < ncol; ++c) {
+    col_ptr_[c + 1] += col_ptr_[c];
+  }
+  col_data_.resize(col_ptr_.back());
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (bst_omp_uint c = 0; c < ncolumn; ++c) {
+    SparseBatch::Entry* out = dmlc::BeginPtr(col_data_) + col_ptr_[c];
+    VisitColumn(columns[c], types[c], validity == nullptr ? nullptr : validity[c],
+                offsets == nullptr ? 0 : offsets[c], nrow,
+                [&](size_t i, bst_float v) {
+                  *out++ = SparseBatch::Entry(static_cast<bst_uint>(i), v);
+                });
+  }
+  info.num_row = nrow;
+  info.num_col = ncol;
+  info.num_nonzero = col_data_.size();
+}
+
+bool ColumnarSource::Next() {
+  if (row_begin_ >= info.num_row) return false;
+  const size_t row_end = std::min(static_cast<size_t>(info.num_row),
+                                  row_begin_ + block_rows_);
+  const bst_omp_uint ncol = static_cast<bst_omp_uint>(info.num_col);
+  if (row_begin_ == 0) {
+    col_pos_.assign(col_ptr_.begin(), col_ptr_.end() - 1);
+  }
+  // transpose the block, the rows keep the entries ordered by column
+  const int nthread = omp_get_max_threads();
+  row_ptr_.clear();
+  common::ParallelGroupBuilder<RowBatch::Entry> builder(&row_ptr_, &row_data_);
+  builder.InitBudget(row_end - row_begin_, nthread);
+  #pragma omp parallel for schedule(static)
+  for (bst_omp_uint c = 0; c < ncol; ++c) {
+    const int tid = omp_get_thread_num();
+    for (size_t k = col_pos_[c]; k < col_ptr_[c + 1] && col_data_[k].index < row_end; ++k) {
+      builder.AddBudget(col_data_[k].index - row_begin_, tid);
+    }
+  }
+  builder.InitStorage();
+  #pragma omp parallel for schedule(static)
+  for (bst_omp_uint c = 0; c < ncol; ++c) {
+    const int tid = omp_get_thread_num();
+    size_t k = col_pos_[c];
+    for (; k < col_ptr_[c + 1] && col_data_[k].index < row_end; ++k) {
+      builder.Push(col_data_[k].index - row_begin_,
+                   RowBatch::Entry(c, col_data_[k].fvalue), tid);
+    }
+    col_pos_[c] = k;
+  }
+  batch_.size = row_end - row_begin_;
+  batch_.base_rowid = row_begin_;
+  batch_.ind_ptr = dmlc::BeginPtr(row_ptr_);
+  batch_.data_ptr = dmlc::BeginPtr(row_data_);
+  row_begin_ = row_end;
+  return true;
+}
+
+void ColumnarSource::BeforeFirst() {
+  row_begin_ = 0;
+}
+
+const RowBatch& ColumnarSource::Value() const {
+  return batch_;
+}
+
+}  // namespace data
+}  // namespace xgboost
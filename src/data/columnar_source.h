@@ -0,0 +1,79 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file columnar_source.h
+ * \brief Data source built from column oriented buffers, such as the
+ *  columns of an Arrow record batch.
+ */
+#ifndef XGBOOST_DATA_COLUMNAR_SOURCE_H_
+#define XGBOOST_DATA_COLUMNAR_SOURCE_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <vector>
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief In-memory data source that holds the data in column oriented format.
+ *  The columns are copied once into CSC storage, the rows are gathered from
+ *  it one block at a time. SimpleDMatrix builds its column pages straight
+ *  from the CSC storage instead of transposing the rows.
+ * \code
+ * // two float columns, the second with a validity bitmap
+ * const void* columns[] = {col0, col1};
+ * const int types[] = {kFloat32, kFloat32};
+ * const uint8_t* validity[] = {nullptr, bitmap1};
+ * std::unique_ptr<DataSource> source(
+ *     new ColumnarSource(columns, types, validity, nullptr, 2, nrow));
+ * DMatrix* dmat = DMatrix::Create(std::move(source));
+ * \endcode
+ */
+class ColumnarSource : public DataSource {
+ public:
+  /*! \brief default number of rows gathered per batch */
+  static const size_t kBlockRows = 1 << 16;
+  /*! \brief column pointer of CSC sparse storage */
+  std::vector<size_t> col_ptr_;
+  /*! \brief data in the CSC sparse storage, the index is the row */
+  std::vector<SparseBatch::Entry> col_data_;
+  /*!
+   * \brief copy the columns.
+   * \param columns The values of each column.
+   * \param types The DataType of each column.
+   * \param validity The validity bitmap of each column, in the bit order of
+   *  Arrow where bit i of byte j is the row j * 8 + i, and set bits are
+   *  valid values. nullptr or a nullptr entry when all the values are valid.
+   *  NaN values are missing as well.
+   * \param offsets The first row of each column in its buffers, nullptr when
+   *  all the columns start at 0.
+   * \param ncol The number of columns.
+   * \param nrow The number of rows.
+   * \param block_rows The number of rows of each batch.
+   */
+  ColumnarSource(const void* const* columns, const int* types,
+                 const uint8_t* const* validity, const uint64_t* offsets,
+                 size_t ncol, size_t nrow, size_t block_rows = kBlockRows);
+  // implement Next
+  bool Next() override;
+  // implement BeforeFirst
+  void BeforeFirst() override;
+  // implement Value
+  const RowBatch &Value() const override;
+
+ private:
+  /*! \brief rows per batch */
+  size_t block_rows_;
+  /*! \brief first row of the next batch */
+  size_t row_begin_;
+  /*! \brief position of each column at the first row of the next batch */
+  std::vector<size_t> col_pos_;
+  /*! \brief row pointer of the current batch */
+  std::vector<size_t> row_ptr_;
+  /*! \brief entries of the current batch */
+  std::vector<RowBatch::Entry> row_data_;
+  /*! \brief the current batch */
+  RowBatch batch_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_COLUMNAR_SOURCE_H_
@@ -5,14 +5,18 @@
 #include <xgboost/data.h>
 #include <xgboost/logging.h>
 #include <dmlc/registry.h>
+#include <algorithm>
 #include <cstring>
 #include "./sparse_batch_page.h"
 #include "./simple_dmatrix.h"
 #include "./simple_csr_source.h"
+#include "./mmap_csr_source.h"
+#include "./sectioned_binary.h"
+#include "./input_files.h"
 #include "../common/common.h"
 #include "../common/io.h"
 
-#if DMLC_ENABLE_STD_THREAD
+#if DMLC_ENABLE_STD_THREAD && !XGBOOST_PREDICT_ONLY
 #include "./sparse_page_source.h"
 #include "./sparse_page_dmatrix.h"
 #endif
@@ -60,35 +64,6 @@ void MetaInfo::LoadBinary(dmlc::Stream *fi) {
   CHECK(fi->Read(&base_margin)) << "MetaInfo: invalid format";
 }
 
-// try to load group information from file, if exists
-inline bool MetaTryLoadGroup(const std::string& fname,
-                             std::vector<unsigned>* group) {
-  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname.c_str(), "r", true));
-  if (fi.get() == nullptr) return false;
-  dmlc::istream is(fi.get());
-  group->clear();
-  group->push_back(0);
-  unsigned nline;
-  while (is >> nline) {
-    group->push_back(group->back() + nline);
-  }
-  return true;
-}
-
-// try to load weight information from file, if exists
-inline bool MetaTryLoadFloatInfo(const std::string& fname,
-                                 std::vector<bst_float>* data) {
-  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname.c_str(), "r", true));
-  if (fi.get() == nullptr) return false;
-  dmlc::istream is(fi.get());
-  data->clear();
-  bst_float value;
-  while (is >> value) {
-    data->push_back(value);
-  }
-  return true;
-}
-
 // macro to dispatch according to specified pointer types
 #define DISPATCH_CONST_PTR(dtype, old_ptr, cast_ptr, proc)              \
   switch (dtype) {                                                      \
@@ -136,6 +111,42 @@ void MetaInfo::SetInfo(const char* key, const void* dptr, DataType dtype, size_t
   }
 }
 
+void MetaInfo::Append(const MetaInfo& other) {
+  CHECK_EQ(labels.size() == 0, other.labels.size() == 0)
+      << "Append: labels are given for one matrix only";
+  CHECK_EQ(group_ptr.size() == 0, other.group_ptr.size() == 0)
+      << "Append: groups are given for one matrix only";
+  CHECK_EQ(base_margin.size() == 0, other.base_margin.size() == 0)
+      << "Append: base margins are given for one matrix only";
+  labels.insert(labels.end(), other.labels.begin(), other.labels.end());
+  base_margin.insert(base_margin.end(), other.base_margin.begin(), other.base_margin.end());
+  if (weights.size() != 0 || other.weights.size() != 0) {
+    weights.resize(num_row, 1.0f);
+    if (other.weights.size() != 0) {
+      weights.insert(weights.end(), other.weights.begin(), other.weights.end());
+    } else {
+      weights.resize(num_row + other.num_row, 1.0f);
+    }
+  }
+  if (root_index.size() != 0 || other.root_index.size() != 0) {
+    root_index.resize(num_row, 0U);
+    if (other.root_index.size() != 0) {
+      root_index.insert(root_index.end(), other.root_index.begin(), other.root_index.end());
+    } else {
+      root_index.resize(num_row + other.num_row, 0U);
+    }
+  }
+  if (group_ptr.size() != 0) {
+    CHECK_EQ(group_ptr.back(), num_row) << "Append: the groups do not cover the rows";
+    for (size_t i = 1; i < other.group_ptr.size(); ++i) {
+      group_ptr.push_back(static_cast<bst_uint>(num_row + other.group_ptr[i]));
+    }
+  }
+  num_row += other.num_row;
+  num_col = std::max(num_col, other.num_col);
+  num_nonzero += other.num_nonzero;
+}
+
 
 DMatrix* DMatrix::Load(const std::string& uri,
                        bool silent,
@@ -189,6 +200,29 @@ DMatrix* DMatrix::Load(const std::string& uri,
     LOG(CONSOLE) << "Load part of data " << partid
                  << " of " << npart << " parts";
   }
+  // a directory or a glob of text files, each file is parsed by a thread of its own
+  if (data::IsMultiFilePath(fname)) {
+    std::vector<std::string> files = data::ListInputFiles(fname);
+    DMatrix* dmat;
+    if (cache_file.length() == 0) {
+      std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+      data::LoadInputFiles(files, partid, npart, file_format, !load_row_split, source.get());
+      dmat = DMatrix::Create(std::move(source), cache_file);
+    } else {
+      data::MultiFileParser parser(files, partid, npart, file_format);
+      dmat = DMatrix::Create(&parser, cache_file);
+      if (!load_row_split) {
+        for (const std::string& f : files) data::AppendSideFiles(f, &dmat->info());
+      }
+    }
+    if (!silent) {
+      LOG(CONSOLE) << dmat->info().num_row << 'x' << dmat->info().num_col << " matrix with "
+                   << dmat->info().num_nonzero << " entries loaded from " << files.size()
+                   << " files of " << uri;
+    }
+    rabit::Allreduce<rabit::op::Max>(&dmat->info().num_col, 1);
+    return dmat;
+  }
   // legacy handling of binary data loading
   if (file_format == "auto" && npart == 1) {
     int magic;
@@ -207,6 +241,27 @@ DMatrix* DMatrix::Load(const std::string& uri,
         }
         return dmat;
       }
+      if (magic == data::SectionedBinary::kMagic) {
+        fi.reset();
+        std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+        data::SectionedBinary(fname).ReadAll(source.get());
+        DMatrix* dmat = DMatrix::Create(std::move(source), cache_file);
+        if (!silent) {
+          LOG(CONSOLE) << dmat->info().num_row << 'x' << dmat->info().num_col << " matrix with "
+                       << dmat->info().num_nonzero << " entries loaded from " << uri;
+        }
+        return dmat;
+      }
+      if (magic == data::MmapCSRSource::kMagic) {
+        fi.reset();
+        std::unique_ptr<data::MmapCSRSource> source(new data::MmapCSRSource(fname));
+        DMatrix* dmat = DMatrix::Create(std::move(source), cache_file);
+        if (!silent) {
+          LOG(CONSOLE) << dmat->info().num_row << 'x' << dmat->info().num_col << " matrix with "
+                       << dmat->info().num_nonzero << " entries mapped from " << uri;
+        }
+        return dmat;
+      }
     }
   }
 
@@ -226,15 +281,15 @@ DMatrix* DMatrix::Load(const std::string& uri,
   // backward compatiblity code.
   if (!load_row_split) {
     MetaInfo& info = dmat->info();
-    if (MetaTryLoadGroup(fname + ".group", &info.group_ptr) && !silent) {
+    if (data::MetaTryLoadGroup(fname + ".group", &info.group_ptr) && !silent) {
       LOG(CONSOLE) << info.group_ptr.size() - 1
                    << " groups are loaded from " << fname << ".group";
     }
-    if (MetaTryLoadFloatInfo(fname + ".base_margin", &info.base_margin) && !silent) {
+    if (data::MetaTryLoadFloatInfo(fname + ".base_margin", &info.base_margin) && !silent) {
       LOG(CONSOLE) << info.base_margin.size()
                    << " base_margin are loaded from " << fname << ".base_margin";
     }
-    if (MetaTryLoadFloatInfo(fname + ".weight", &info.weights) && !silent) {
+    if (data::MetaTryLoadFloatInfo(fname + ".weight", &info.weights) && !silent) {
       LOG(CONSOLE) << info.weights.size()
                    << " weights are loaded from " << fname << ".weight";
     }
@@ -250,24 +305,47 @@ DMatrix* DMatrix::Create(dmlc::Parser<uint32_t>* parser,
     source->CopyFrom(parser);
     return DMatrix::Create(std::move(source), cache_prefix);
   } else {
-#if DMLC_ENABLE_STD_THREAD
+#if DMLC_ENABLE_STD_THREAD && !XGBOOST_PREDICT_ONLY
     if (!data::SparsePageSource::CacheExist(cache_prefix)) {
       data::SparsePageSource::Create(parser, cache_prefix);
     }
     std::unique_ptr<data::SparsePageSource> source(new data::SparsePageSource(cache_prefix));
     return DMatrix::Create(std::move(source), cache_prefix);
 #else
-    LOG(FATAL) << "External memory is not enabled in mingw";
+    LOG(FATAL) << "External memory is not enabled in mingw and in the prediction only library";
     return nullptr;
 #endif
   }
 }
 
-void DMatrix::SaveToLocalFile(const std::string& fname) {
+void DMatrix::SaveSectioned(const std::string& uri, bool compress) {
+  data::SimpleCSRSource source;
+  source.CopyFrom(this);
+  std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(uri.c_str(), "w"));
+  data::SectionedBinary::Save(source, fo.get(), compress);
+}
+
+void DMatrix::Append(DMatrix* other) {
+  LOG(FATAL) << "Append is only supported by the in-memory DMatrix";
+}
+
+std::shared_ptr<void> DMatrix::DerivedData(
+    const std::string& key, const std::function<std::shared_ptr<void>()>& create) {
+  std::lock_guard<std::mutex> lock(derived_mutex_);
+  std::shared_ptr<void>& data = derived_[key];
+  if (data == nullptr) data = create();
+  return data;
+}
+
+void DMatrix::SaveToLocalFile(const std::string& fname, bool page_aligned) {
   data::SimpleCSRSource source;
   source.CopyFrom(this);
   std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname.c_str(), "w"));
-  source.SaveBinary(fo.get());
+  if (page_aligned) {
+    data::MmapCSRSource::SaveBinary(source, fo.get());
+  } else {
+    source.SaveBinary(fo.get());
+  }
 }
 
 DMatrix* DMatrix::Create(std::unique_ptr<DataSource>&& source,
@@ -275,10 +353,10 @@ DMatrix* DMatrix::Create(std::unique_ptr<DataSource>&& source,
   if (cache_prefix.length() == 0) {
     return new data::SimpleDMatrix(std::move(source));
   } else {
-#if DMLC_ENABLE_STD_THREAD
+#if DMLC_ENABLE_STD_THREAD && !XGBOOST_PREDICT_ONLY
     return new data::SparsePageDMatrix(std::move(source), cache_prefix);
 #else
-    LOG(FATAL) << "External memory is not enabled in mingw";
+    LOG(FATAL) << "External memory is not enabled in mingw and in the prediction only library";
     return nullptr;
 #endif
   }
@@ -315,5 +393,9 @@ SparsePage::Format::DecideFormat(const std::string& cache_prefix) {
 
 // List of files that will be force linked in static links.
 DMLC_REGISTRY_LINK_TAG(sparse_page_raw_format);
+#if !XGBOOST_PREDICT_ONLY
+DMLC_REGISTRY_LINK_TAG(sparse_page_dense_format);
+DMLC_REGISTRY_LINK_TAG(parallel_text_parser);
+#endif  // !XGBOOST_PREDICT_ONLY
 }  // namespace data
 }  // namespace xgboost
@@ -0,0 +1,247 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file input_files.cc
+ */
+#include <dmlc/io.h>
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <exception>
+#include "./input_files.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <glob.h>
+#include <sys/stat.h>
+#endif
+
+namespace xgboost {
+namespace data {
+namespace {
+bool EndsWith(const std::string& str, const std::string& suffix) {
+  return str.length() >= suffix.length() &&
+      str.compare(str.length() - suffix.length(), suffix.length(), suffix) == 0;
+}
+
+bool IsSideFile(const std::string& fname) {
+  return EndsWith(fname, ".group") || EndsWith(fname, ".weight") ||
+      EndsWith(fname, ".base_margin");
+}
+
+// the file name without the arguments of the parser
+std::string StripArgs(const std::string& fname) {
+  return fname.substr(0, fname.find('?'));
+}
+
+// the values of part appended to out, they must be in all parts or in none
+template <typename T>
+void AppendValues(const std::vector<T>& part, const std::string& fname, const char* name,
+                  bool first, std::vector<T>* out) {
+  CHECK(first || out->empty() == part.empty())
+      << "the " << name << " of " << fname
+      << (part.empty() ? " are missing, they are" : " are given, they are not")
+      << " given for the files before it";
+  out->insert(out->end(), part.begin(), part.end());
+}
+}  // namespace
+
+std::vector<std::string> ListInputFiles(const std::string& path) {
+  std::vector<std::string> files;
+#ifndef _WIN32
+  // only the local files are listed, the arguments of the parser go to each file
+  const std::string base = StripArgs(path);
+  const std::string args = path.substr(base.length());
+  if (base.find("://") != std::string::npos) return {path};
+  if (base.find_first_of("*[") != std::string::npos) {
+    glob_t matches;
+    if (glob(base.c_str(), 0, nullptr, &matches) == 0) {
+      for (size_t i = 0; i < matches.gl_pathc; ++i) {
+        std::string fname(matches.gl_pathv[i]);
+        struct stat st;
+        if (stat(fname.c_str(), &st) == 0 && S_ISREG(st.st_mode) && !IsSideFile(fname)) {
+          files.push_back(fname);
+        }
+      }
+    }
+    globfree(&matches);
+    CHECK_NE(files.size(), 0) << "no input file matches " << base;
+  } else {
+    struct stat st;
+    if (stat(base.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return {path};
+    DIR* dir = opendir(base.c_str());
+    CHECK(dir != nullptr) << "cannot list the directory " << base;
+    const std::string prefix = EndsWith(base, "/") ? base : base + '/';
+    while (struct dirent* entry = readdir(dir)) {
+      std::string name(entry->d_name);
+      if (name.empty() || name[0] == '.' || IsSideFile(name)) continue;
+      if (stat((prefix + name).c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        files.push_back(prefix + name);
+      }
+    }
+    closedir(dir);
+    CHECK_NE(files.size(), 0) << "the directory " << base << " has no input file";
+  }
+  std::sort(files.begin(), files.end());
+  for (std::string& fname : files) fname += args;
+#else
+  files.push_back(path);
+#endif
+  return files;
+}
+
+bool IsMultiFilePath(const std::string& path) {
+  std::vector<std::string> files = ListInputFiles(path);
+  return files.size() != 1 || files[0] != path;
+}
+
+bool MetaTryLoadGroup(const std::string& fname, std::vector<unsigned>* group) {
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname.c_str(), "r", true));
+  if (fi.get() == nullptr) return false;
+  dmlc::istream is(fi.get());
+  group->clear();
+  group->push_back(0);
+  unsigned nline;
+  while (is >> nline) {
+    group->push_back(group->back() + nline);
+  }
+  return true;
+}
+
+bool MetaTryLoadFloatInfo(const std::string& fname, std::vector<bst_float>* data) {
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname.c_str(), "r", true));
+  if (fi.get() == nullptr) return false;
+  dmlc::istream is(fi.get());
+  data->clear();
+  bst_float value;
+  while (is >> value) {
+    data->push_back(value);
+  }
+  return true;
+}
+
+int AppendSideFiles(const std::string& fname, MetaInfo* info) {
+  const std::string base = StripArgs(fname);
+  int nfound = 0;
+  std::vector<unsigned> group;
+  if (MetaTryLoadGroup(base + ".group", &group)) {
+    if (info->group_ptr.empty()) info->group_ptr.push_back(0);
+    const unsigned offset = info->group_ptr.back();
+    for (size_t i = 1; i < group.size(); ++i) {
+      info->group_ptr.push_back(offset + group[i]);
+    }
+    ++nfound;
+  }
+  std::vector<bst_float> values;
+  if (MetaTryLoadFloatInfo(base + ".base_margin", &values)) {
+    info->base_margin.insert(info->base_margin.end(), values.begin(), values.end());
+    ++nfound;
+  }
+  if (MetaTryLoadFloatInfo(base + ".weight", &values)) {
+    info->weights.insert(info->weights.end(), values.begin(), values.end());
+    ++nfound;
+  }
+  return nfound;
+}
+
+void LoadInputFiles(const std::vector<std::string>& files,
+                    unsigned partid, unsigned npart, const std::string& format,
+                    bool side_files, SimpleCSRSource* out) {
+  const bst_omp_uint nfile = static_cast<bst_omp_uint>(files.size());
+  std::vector<std::unique_ptr<SimpleCSRSource> > parts(nfile);
+  // the threads left by the files go to the parsers of the files
+  const int nthread = omp_get_max_threads();
+  const int njob = std::max(std::min(nthread, static_cast<int>(nfile)), 1);
+  std::exception_ptr error;
+#ifdef _OPENMP
+  const int max_levels = omp_get_max_active_levels();
+  omp_set_max_active_levels(2);
+#endif
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(njob)
+  for (bst_omp_uint k = 0; k < nfile; ++k) {
+    omp_set_num_threads(std::max(nthread / njob, 1));
+    try {
+      std::unique_ptr<dmlc::Parser<uint32_t> > parser(
+          dmlc::Parser<uint32_t>::Create(files[k].c_str(), partid, npart, format.c_str()));
+      parts[k].reset(new SimpleCSRSource());
+      parts[k]->CopyFrom(parser.get());
+      if (side_files) AppendSideFiles(files[k], &parts[k]->info);
+    } catch (...) {
+      #pragma omp critical
+      if (!error) error = std::current_exception();
+    }
+  }
+#ifdef _OPENMP
+  omp_set_max_active_levels(max_levels);
+#endif
+  if (error) std::rethrow_exception(error);
+
+  // the meta information, and where the rows of each file go
+  out->Clear();
+  MetaInfo& info = out->info;
+  std::vector<size_t> row_begin(nfile + 1, 0), entry_begin(nfile + 1, 0);
+  for (bst_omp_uint k = 0; k < nfile; ++k) {
+    const MetaInfo& part = parts[k]->info;
+    const bool first = k == 0;
+    AppendValues(part.labels, files[k], "labels", first, &info.labels);
+    AppendValues(part.weights, files[k], "weights", first, &info.weights);
+    AppendValues(part.base_margin, files[k], "base margins", first, &info.base_margin);
+    CHECK(first || info.group_ptr.empty() == part.group_ptr.empty())
+        << "the groups of " << files[k] << " do not match the files before it, "
+        << "the .group file must be given for all the files or for none";
+    if (!part.group_ptr.empty()) {
+      if (info.group_ptr.empty()) info.group_ptr.push_back(0);
+      const unsigned offset = info.group_ptr.back();
+      for (size_t i = 1; i < part.group_ptr.size(); ++i) {
+        info.group_ptr.push_back(offset + part.group_ptr[i]);
+      }
+    }
+    info.num_col = std::max(info.num_col, part.num_col);
+    row_begin[k + 1] = row_begin[k] + part.num_row;
+    entry_begin[k + 1] = entry_begin[k] + parts[k]->row_data_.size();
+  }
+  info.num_row = row_begin[nfile];
+  info.num_nonzero = entry_begin[nfile];
+  out->row_ptr_.resize(info.num_row + 1);
+  out->row_data_.resize(info.num_nonzero);
+  // copy the rows of the files in parallel, each file is freed once copied
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (bst_omp_uint k = 0; k < nfile; ++k) {
+    SimpleCSRSource& part = *parts[k];
+    std::copy(part.row_data_.begin(), part.row_data_.end(),
+              out->row_data_.begin() + entry_begin[k]);
+    for (size_t i = 0; i < part.info.num_row; ++i) {
+      out->row_ptr_[row_begin[k] + i + 1] = entry_begin[k] + part.row_ptr_[i + 1];
+    }
+    parts[k].reset();
+  }
+}
+
+void MultiFileParser::BeforeFirst() {
+  parser_.reset();
+  next_ = 0;
+  bytes_read_ = 0;
+}
+
+bool MultiFileParser::Next() {
+  while (true) {
+    if (parser_ == nullptr) {
+      if (next_ == files_.size()) return false;
+      parser_.reset(dmlc::Parser<uint32_t>::Create(
+          files_[next_++].c_str(), partid_, npart_, format_.c_str()));
+    }
+    if (parser_->Next()) return true;
+    bytes_read_ += parser_->BytesRead();
+    parser_.reset();
+  }
+}
+
+const dmlc::RowBlock<uint32_t>& MultiFileParser::Value() const {
+  CHECK(parser_ != nullptr) << "MultiFileParser: Value called before Next";
+  return parser_->Value();
+}
+
+size_t MultiFileParser::BytesRead() const {
+  return bytes_read_ + (parser_ == nullptr ? 0 : parser_->BytesRead());
+}
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,88 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file input_files.h
+ * \brief Loading of a data set given as a directory or a glob of text files.
+ */
+#ifndef XGBOOST_DATA_INPUT_FILES_H_
+#define XGBOOST_DATA_INPUT_FILES_H_
+
+#include <dmlc/data.h>
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "./simple_csr_source.h"
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief the files of a data set path, sorted by name.
+ *  A directory gives the files in it, except the hidden ones and the .group,
+ *  .weight and .base_margin side files, and a path with *, ? or [ gives the
+ *  files matching it. Any other path is returned as it is.
+ */
+std::vector<std::string> ListInputFiles(const std::string& path);
+
+/*! \brief whether ListInputFiles finds more than the path itself */
+bool IsMultiFilePath(const std::string& path);
+
+/*! \brief load the group sizes of fname, one per line, as group boundaries */
+bool MetaTryLoadGroup(const std::string& fname, std::vector<unsigned>* group);
+
+/*! \brief load the values of fname, one per line */
+bool MetaTryLoadFloatInfo(const std::string& fname, std::vector<bst_float>* data);
+
+/*!
+ * \brief add the .group, .weight and .base_margin side files of fname to info,
+ *  after the groups and the values of the files loaded before.
+ * \return the number of side files found.
+ */
+int AppendSideFiles(const std::string& fname, MetaInfo* info);
+
+/*!
+ * \brief parse the files concurrently, each one with a parser of its own,
+ *  and put their rows one after the other in out.
+ * \param files The files.
+ * \param partid The part of each file to read.
+ * \param npart The number of parts each file is split in.
+ * \param format The format of the files.
+ * \param side_files Whether to load the side files of each file.
+ * \param out The data set.
+ */
+void LoadInputFiles(const std::vector<std::string>& files,
+                    unsigned partid, unsigned npart, const std::string& format,
+                    bool side_files, SimpleCSRSource* out);
+
+/*!
+ * \brief Parser going through the parsers of the files one after the other,
+ *  for the external memory cache built from several files.
+ */
+class MultiFileParser : public dmlc::Parser<uint32_t> {
+ public:
+  MultiFileParser(const std::vector<std::string>& files,
+                  unsigned partid, unsigned npart, const std::string& format)
+      : files_(files), partid_(partid), npart_(npart), format_(format),
+        next_(0), bytes_read_(0) {}
+  // implement BeforeFirst
+  void BeforeFirst() override;
+  // implement Next
+  bool Next() override;
+  // implement Value
+  const dmlc::RowBlock<uint32_t>& Value() const override;
+  // implement BytesRead
+  size_t BytesRead() const override;
+
+ private:
+  std::vector<std::string> files_;
+  unsigned partid_, npart_;
+  std::string format_;
+  /*! \brief the file after the current one */
+  size_t next_;
+  /*! \brief bytes read from the files before the current one */
+  size_t bytes_read_;
+  std::unique_ptr<dmlc::Parser<uint32_t> > parser_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_INPUT_FILES_H_
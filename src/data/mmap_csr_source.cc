@@ -0,0 +1,186 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file mmap_csr_source.cc
+ */
+#include <dmlc/base.h>
+#include <xgboost/logging.h>
+#include <cstring>
+#include <vector>
+#include "./mmap_csr_source.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace xgboost {
+namespace data {
+namespace {
+// sections of the file, in the order they are written
+enum Section {
+  kRowPtr = 0,
+  kRowData,
+  kLabels,
+  kGroupPtr,
+  kWeights,
+  kRootIndex,
+  kBaseMargin,
+  kNumSections
+};
+
+// size of an element of each section
+const size_t kElemSize[kNumSections] = {
+    sizeof(size_t), sizeof(RowBatch::Entry), sizeof(bst_float),
+    sizeof(unsigned), sizeof(bst_float), sizeof(unsigned), sizeof(bst_float)};
+
+const int32_t kFormatVersion = 1;
+
+// header at the start of the file, the sections follow on page boundaries
+struct Header {
+  int32_t magic;
+  int32_t version;
+  uint64_t num_row;
+  uint64_t num_col;
+  uint64_t num_nonzero;
+  // byte offset and number of elements of each section
+  uint64_t offset[kNumSections];
+  uint64_t length[kNumSections];
+};
+
+inline size_t AlignUp(size_t n) {
+  return (n + MmapCSRSource::kPageAlign - 1) / MmapCSRSource::kPageAlign *
+         MmapCSRSource::kPageAlign;
+}
+
+// write the elements of a section and pad the stream to its next page
+template <typename T>
+void WriteSection(dmlc::Stream* fo, const std::vector<T>& vec, size_t* pos) {
+  const size_t bytes = vec.size() * sizeof(T);
+  if (bytes != 0) fo->Write(dmlc::BeginPtr(vec), bytes);
+  std::vector<char> padding(AlignUp(*pos + bytes) - *pos - bytes, 0);
+  if (padding.size() != 0) fo->Write(dmlc::BeginPtr(padding), padding.size());
+  *pos = AlignUp(*pos + bytes);
+}
+
+// copy a section of the mapping into a meta information vector
+template <typename T>
+void ReadSection(const char* base, const Header& header, Section s,
+                 std::vector<T>* out) {
+  const T* begin = reinterpret_cast<const T*>(base + header.offset[s]);
+  out->assign(begin, begin + header.length[s]);
+}
+}  // namespace
+
+void MmapCSRSource::SaveBinary(const SimpleCSRSource& src, dmlc::Stream* fo) {
+  const MetaInfo& info = src.info;
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kMagic;
+  header.version = kFormatVersion;
+  header.num_row = info.num_row;
+  header.num_col = info.num_col;
+  header.num_nonzero = info.num_nonzero;
+  header.length[kRowPtr] = src.row_ptr_.size();
+  header.length[kRowData] = src.row_data_.size();
+  header.length[kLabels] = info.labels.size();
+  header.length[kGroupPtr] = info.group_ptr.size();
+  header.length[kWeights] = info.weights.size();
+  header.length[kRootIndex] = info.root_index.size();
+  header.length[kBaseMargin] = info.base_margin.size();
+  size_t pos = AlignUp(sizeof(header));
+  for (int s = 0; s < kNumSections; ++s) {
+    header.offset[s] = pos;
+    pos = AlignUp(pos + header.length[s] * kElemSize[s]);
+  }
+
+  fo->Write(&header, sizeof(header));
+  std::vector<char> padding(AlignUp(sizeof(header)) - sizeof(header), 0);
+  fo->Write(dmlc::BeginPtr(padding), padding.size());
+  pos = AlignUp(sizeof(header));
+  WriteSection(fo, src.row_ptr_, &pos);
+  WriteSection(fo, src.row_data_, &pos);
+  WriteSection(fo, info.labels, &pos);
+  WriteSection(fo, info.group_ptr, &pos);
+  WriteSection(fo, info.weights, &pos);
+  WriteSection(fo, info.root_index, &pos);
+  WriteSection(fo, info.base_margin, &pos);
+}
+
+#ifndef _WIN32
+MmapCSRSource::MmapCSRSource(const std::string& fname)
+    : mapped_(nullptr), mapped_size_(0), at_first_(true) {
+  int fd = open(fname.c_str(), O_RDONLY);
+  CHECK_NE(fd, -1) << "MmapCSRSource: cannot open " << fname
+                   << ", the page aligned format must be a local file";
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0) << "MmapCSRSource: cannot stat " << fname;
+  mapped_size_ = static_cast<size_t>(st.st_size);
+  CHECK_GE(mapped_size_, sizeof(Header)) << "invalid input file format";
+  mapped_ = mmap(nullptr, mapped_size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  CHECK(mapped_ != MAP_FAILED) << "MmapCSRSource: cannot map " << fname;
+  const char* base = static_cast<const char*>(mapped_);
+
+  Header header;
+  std::memcpy(&header, base, sizeof(header));
+  CHECK_EQ(header.magic, kMagic) << "invalid format, magic number mismatch";
+  CHECK_EQ(header.version, kFormatVersion) << "MmapCSRSource: invalid format";
+  for (int s = 0; s < kNumSections; ++s) {
+    CHECK(header.offset[s] % kPageAlign == 0 &&
+          header.offset[s] + header.length[s] * kElemSize[s] <= mapped_size_)
+        << "MmapCSRSource: truncated or corrupted file " << fname;
+  }
+  CHECK_EQ(header.length[kRowPtr], header.num_row + 1)
+      << "MmapCSRSource: invalid format";
+  CHECK_EQ(header.length[kRowData], header.num_nonzero)
+      << "MmapCSRSource: invalid format";
+
+  info.num_row = header.num_row;
+  info.num_col = header.num_col;
+  info.num_nonzero = header.num_nonzero;
+  ReadSection(base, header, kLabels, &info.labels);
+  ReadSection(base, header, kGroupPtr, &info.group_ptr);
+  ReadSection(base, header, kWeights, &info.weights);
+  ReadSection(base, header, kRootIndex, &info.root_index);
+  ReadSection(base, header, kBaseMargin, &info.base_margin);
+
+  batch_.size = header.num_row;
+  batch_.base_rowid = 0;
+  batch_.ind_ptr = reinterpret_cast<const size_t*>(base + header.offset[kRowPtr]);
+  batch_.data_ptr =
+      reinterpret_cast<const RowBatch::Entry*>(base + header.offset[kRowData]);
+}
+
+MmapCSRSource::~MmapCSRSource() {
+  if (mapped_ != nullptr) {
+    munmap(mapped_, mapped_size_);
+  }
+}
+#else
+MmapCSRSource::MmapCSRSource(const std::string& fname)
+    : mapped_(nullptr), mapped_size_(0), at_first_(true) {
+  LOG(FATAL) << "MmapCSRSource: the page aligned binary format is not "
+                "supported on Windows";
+}
+
+MmapCSRSource::~MmapCSRSource() {}
+#endif
+
+void MmapCSRSource::BeforeFirst() {
+  at_first_ = true;
+}
+
+bool MmapCSRSource::Next() {
+  if (!at_first_) return false;
+  at_first_ = false;
+  return true;
+}
+
+const RowBatch& MmapCSRSource::Value() const {
+  return batch_;
+}
+
+}  // namespace data
+}  // namespace xgboost
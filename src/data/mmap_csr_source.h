@@ -0,0 +1,67 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file mmap_csr_source.h
+ * \brief Data source over a memory mapped binary file, the pages of the file
+ *  are shared through the page cache by all the processes opening it.
+ */
+#ifndef XGBOOST_DATA_MMAP_CSR_SOURCE_H_
+#define XGBOOST_DATA_MMAP_CSR_SOURCE_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <string>
+#include "./simple_csr_source.h"
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief Row data source reading a page aligned binary file in place.
+ *  The file starts with a header listing the offset and length of each
+ *  section, every section starts on a page boundary so the CSR arrays are
+ *  used straight from the mapping. The meta information is copied into info.
+ * \code
+ * // write a DMatrix in the page aligned format
+ * dmat->SaveToLocalFile(fname, true);
+ * // DMatrix::Load recognises the format by its magic number
+ * std::unique_ptr<DMatrix> loaded(DMatrix::Load(fname, true, false));
+ * \endcode
+ */
+class MmapCSRSource : public DataSource {
+ public:
+  /*!
+   * \brief map the local file fname.
+   * \param fname The local file written by SaveBinary.
+   */
+  explicit MmapCSRSource(const std::string& fname);
+  /*! \brief destructor, unmaps the file */
+  ~MmapCSRSource() override;
+  /*!
+   * \brief Save the content of a SimpleCSRSource in the page aligned format.
+   * \param src The data to save.
+   * \param fo The output stream.
+   */
+  static void SaveBinary(const SimpleCSRSource& src, dmlc::Stream* fo);
+  // implement Next
+  bool Next() override;
+  // implement BeforeFirst
+  void BeforeFirst() override;
+  // implement Value
+  const RowBatch& Value() const override;
+  /*! \brief magic number used to identify MmapCSRSource */
+  static const int kMagic = 0xffffab03;
+  /*! \brief alignment of the sections in the file */
+  static const size_t kPageAlign = 4096;
+
+ private:
+  /*! \brief start of the mapping */
+  void* mapped_;
+  /*! \brief size of the mapping */
+  size_t mapped_size_;
+  /*! \brief internal variable, used to support iterator interface */
+  bool at_first_;
+  /*! \brief the batch over the mapped CSR arrays */
+  RowBatch batch_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_MMAP_CSR_SOURCE_H_
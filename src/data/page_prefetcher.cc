@@ -0,0 +1,159 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file page_prefetcher.cc
+ */
+#include <dmlc/parameter.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <utility>
+#include "./page_prefetcher.h"
+#include "../common/timer.h"
+
+#if DMLC_ENABLE_STD_THREAD
+namespace xgboost {
+namespace data {
+
+const size_t PagePrefetcher::kMinDepth;
+
+PagePrefetcher::PagePrefetcher(std::vector<Shard> shards, const std::string& label)
+    : shards_(std::move(shards)), label_(label), states_(shards_.size()),
+      clock_ptr_(0), depth_(kMinDepth), num_reading_(0), pass_stalls_(0),
+      pass_pages_(0), paused_(false), stopped_(false) {
+  CHECK_NE(shards_.size(), 0U);
+  for (auto& state : states_) {
+    state.busy = state.end = false;
+  }
+  max_depth_ = std::max(kMinDepth, dmlc::GetEnv("XGBOOST_PREFETCH_DEPTH", size_t(8)));
+  // a shard is read by one thread at a time
+  size_t nthread = dmlc::GetEnv("XGBOOST_PREFETCH_NTHREAD", shards_.size());
+  nthread = std::max(size_t(1), std::min(nthread, shards_.size()));
+  for (size_t i = 0; i < nthread; ++i) {
+    workers_.emplace_back([this]() { this->Worker(); });
+  }
+}
+
+PagePrefetcher::~PagePrefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  for (auto& state : states_) {
+    for (SparsePage* page : state.ready) delete page;
+  }
+  for (SparsePage* page : free_pages_) delete page;
+}
+
+size_t PagePrefetcher::NextShard() const {
+  // the shards the consumer needs first come first
+  for (size_t k = 0; k < states_.size(); ++k) {
+    const size_t s = (clock_ptr_ + k) % states_.size();
+    const ShardState& state = states_[s];
+    if (!state.busy && !state.end && state.ready.size() < depth_) return s;
+  }
+  return states_.size();
+}
+
+void PagePrefetcher::Worker() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this]() {
+      return stopped_ || (!paused_ && this->NextShard() != states_.size());
+    });
+    if (stopped_) return;
+    const size_t s = this->NextShard();
+    states_[s].busy = true;
+    ++num_reading_;
+    SparsePage* page;
+    if (free_pages_.empty()) {
+      page = new SparsePage();
+    } else {
+      page = free_pages_.back();
+      free_pages_.pop_back();
+    }
+    lock.unlock();
+    common::Timer timer;
+    const bool has_page = shards_[s].read(page);
+    timer.Stop();
+    common::Profiler::Get()->AddTime(label_ + ".read", timer.ElapsedSeconds());
+    lock.lock();
+    states_[s].busy = false;
+    --num_reading_;
+    if (has_page) {
+      states_[s].ready.push_back(page);
+    } else {
+      states_[s].end = true;
+      free_pages_.push_back(page);
+    }
+    ready_cv_.notify_all();
+  }
+}
+
+bool PagePrefetcher::Next(SparsePage** out_page) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  ShardState& state = states_[clock_ptr_];
+  const bool stalled = state.ready.empty() && !state.end;
+  if (stalled) {
+    common::Timer timer;
+    ready_cv_.wait(lock, [&state]() { return !state.ready.empty() || state.end; });
+    timer.Stop();
+    common::Profiler::Get()->AddTime(label_ + ".stall", timer.ElapsedSeconds());
+  }
+  if (state.ready.empty()) return false;
+  // the first page of a pass is never ready in time
+  if (stalled && pass_pages_ != 0) {
+    common::Profiler::Get()->AddCount(label_ + ".stalls", 1);
+    ++pass_stalls_;
+    if (depth_ < max_depth_) ++depth_;
+  }
+  *out_page = state.ready.front();
+  state.ready.pop_front();
+  clock_ptr_ = (clock_ptr_ + 1) % states_.size();
+  ++pass_pages_;
+  common::Profiler::Get()->AddCount(label_ + ".pages", 1);
+  lock.unlock();
+  work_cv_.notify_all();
+  return true;
+}
+
+void PagePrefetcher::Recycle(SparsePage** page) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_pages_.push_back(*page);
+  }
+  *page = nullptr;
+}
+
+void PagePrefetcher::BeforeFirst() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    paused_ = true;
+    ready_cv_.wait(lock, [this]() { return num_reading_ == 0; });
+    for (auto& state : states_) {
+      free_pages_.insert(free_pages_.end(), state.ready.begin(), state.ready.end());
+      state.ready.clear();
+      state.end = false;
+    }
+    for (auto& shard : shards_) {
+      shard.before_first();
+    }
+    // a whole pass without a stall, the pages are ready ahead of need
+    if (pass_pages_ != 0 && pass_stalls_ == 0 && depth_ > kMinDepth) --depth_;
+    pass_pages_ = pass_stalls_ = 0;
+    clock_ptr_ = 0;
+    paused_ = false;
+  }
+  work_cv_.notify_all();
+}
+
+size_t PagePrefetcher::Depth() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return depth_;
+}
+
+}  // namespace data
+}  // namespace xgboost
+#endif  // DMLC_ENABLE_STD_THREAD
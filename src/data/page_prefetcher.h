@@ -0,0 +1,102 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file page_prefetcher.h
+ * \brief Prefetcher of the sparse pages of external memory, with a depth
+ *  adapted to the stalls of its consumer.
+ */
+#ifndef XGBOOST_DATA_PAGE_PREFETCHER_H_
+#define XGBOOST_DATA_PAGE_PREFETCHER_H_
+
+#include <dmlc/base.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./sparse_batch_page.h"
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief Reads the pages of several shards ahead of their consumer.
+ *  The pages are read and decoded by a pool of threads owned by the
+ *  prefetcher, apart from the OpenMP team of the computation, and handed out
+ *  in clock order over the shards. Each shard has at most one read in flight
+ *  and up to depth pages ready. The depth starts at kMinDepth and grows by
+ *  one every time the consumer has to wait for a page, up to the maximum
+ *  depth; it shrinks by one after a pass over the data without a stall.
+ *
+ *  The waits and reads are recorded in the profiler as label.stall and
+ *  label.read, with the counters label.stalls and label.pages.
+ *
+ *  The environment variables XGBOOST_PREFETCH_DEPTH and
+ *  XGBOOST_PREFETCH_NTHREAD set the maximum depth and the number of threads.
+ */
+class PagePrefetcher {
+ public:
+  /*! \brief a shard of pages */
+  struct Shard {
+    /*! \brief read the next page of the shard, false at its end */
+    std::function<bool(SparsePage*)> read;
+    /*! \brief rewind the shard */
+    std::function<void()> before_first;
+  };
+  /*! \brief initial depth of the prefetch */
+  static const size_t kMinDepth = 2;
+  /*!
+   * \brief start prefetching the shards.
+   * \param shards The shards, read in turn.
+   * \param label The name of the statistics in the profiler.
+   */
+  PagePrefetcher(std::vector<Shard> shards, const std::string& label);
+  /*! \brief stop the threads and free the pages */
+  ~PagePrefetcher();
+  /*!
+   * \brief get the next page.
+   * \param out_page The page, to pass back with Recycle once used.
+   * \return false when there is no more page.
+   */
+  bool Next(SparsePage** out_page);
+  /*! \brief give a page back to the prefetcher */
+  void Recycle(SparsePage** page);
+  /*! \brief rewind to the first page of every shard */
+  void BeforeFirst();
+  /*! \return the current depth of the prefetch */
+  size_t Depth();
+
+ private:
+  /*! \brief state of a shard, guarded by mutex_ */
+  struct ShardState {
+    std::deque<SparsePage*> ready;
+    bool busy;
+    bool end;
+  };
+  // the loop of the threads
+  void Worker();
+  // the shard to read next, or shards_.size() when there is none
+  size_t NextShard() const;
+
+  std::vector<Shard> shards_;
+  std::string label_;
+  std::vector<ShardState> states_;
+  std::vector<SparsePage*> free_pages_;
+  size_t clock_ptr_;
+  size_t depth_;
+  size_t max_depth_;
+  size_t num_reading_;
+  size_t pass_stalls_;
+  size_t pass_pages_;
+  bool paused_;
+  bool stopped_;
+  std::mutex mutex_;
+  /*! \brief signalled when a shard can be read */
+  std::condition_variable work_cv_;
+  /*! \brief signalled when a read finishes */
+  std::condition_variable ready_cv_;
+  std::vector<std::thread> workers_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_PAGE_PREFETCHER_H_
@@ -0,0 +1,326 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file parallel_text_parser.cc
+ */
+#include <dmlc/omp.h>
+#include <dmlc/registry.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include "./parallel_text_parser.h"
+#include "./text_number.h"
+
+namespace xgboost {
+namespace data {
+
+DMLC_REGISTRY_FILE_TAG(parallel_text_parser);
+DMLC_REGISTER_PARAMETER(ParallelTextParserParam);
+
+namespace {
+// parse an unsigned integer, return p when there is none
+inline const char* ParseUInt(const char* p, const char* end, uint64_t* out) {
+  uint64_t v = 0;
+  for (; p != end && IsDigit(*p); ++p) {
+    if (v <= std::numeric_limits<uint32_t>::max()) v = v * 10 + (*p - '0');
+  }
+  *out = v;
+  return p;
+}
+
+// output of a segment, starting at its row and entry of the block
+struct SegmentOutput {
+  size_t* offset;
+  bst_float* label;
+  bst_float* weight;
+  uint32_t* index;
+  bst_float* value;
+  size_t base_entry;
+  size_t nrow;
+  size_t nentry;
+  bool has_weight;
+  const char* error;
+};
+
+inline void PushEntry(SegmentOutput* out, uint32_t index, bst_float value) {
+  out->index[out->nentry] = index;
+  out->value[out->nentry] = value;
+  ++out->nentry;
+}
+
+inline void EndRow(SegmentOutput* out) {
+  out->offset[out->nrow + 1] = out->base_entry + out->nentry;
+  ++out->nrow;
+}
+
+// libsvm line: label[:weight] [qid:id] index[:value] ...
+bool ParseLibSVMLine(const char* p, const char* end, SegmentOutput* out) {
+  p = SkipSpace(p, end);
+  if (p == end) return true;
+  const char* q = ParseFloat(p, end, &out->label[out->nrow]);
+  if (q == p) return false;
+  p = q;
+  out->weight[out->nrow] = 1.0f;
+  if (p != end && *p == ':') {
+    q = ParseFloat(p + 1, end, &out->weight[out->nrow]);
+    if (q == p + 1) return false;
+    p = q;
+    out->has_weight = true;
+  }
+  while (true) {
+    if (p != end && !IsSpace(*p)) return false;
+    p = SkipSpace(p, end);
+    if (p == end) break;
+    uint64_t index;
+    if (end - p > 4 && std::strncmp(p, "qid:", 4) == 0) {
+      q = ParseUInt(p + 4, end, &index);
+      if (q == p + 4) return false;
+      p = q;
+      continue;
+    }
+    q = ParseUInt(p, end, &index);
+    if (q == p || index > std::numeric_limits<uint32_t>::max()) return false;
+    p = q;
+    bst_float value = 1.0f;
+    if (p != end && *p == ':') {
+      q = ParseFloat(p + 1, end, &value);
+      if (q == p + 1) return false;
+      p = q;
+    }
+    PushEntry(out, static_cast<uint32_t>(index), value);
+  }
+  EndRow(out);
+  return true;
+}
+
+// csv line: every field is a column, apart from the label column
+bool ParseCSVLine(const char* p, const char* end, int label_column,
+                  SegmentOutput* out) {
+  if (SkipSpace(p, end) == end) return true;
+  out->label[out->nrow] = 0.0f;
+  out->weight[out->nrow] = 1.0f;
+  uint32_t index = 0;
+  for (int column = 0; ; ++column) {
+    bst_float value = 0.0f;
+    ParseFloat(SkipSpace(p, end), end, &value);
+    if (column == label_column) {
+      out->label[out->nrow] = value;
+    } else {
+      PushEntry(out, index++, value);
+    }
+    const char* comma = static_cast<const char*>(std::memchr(p, ',', end - p));
+    if (comma == nullptr) break;
+    p = comma + 1;
+  }
+  EndRow(out);
+  return true;
+}
+
+// count the rows of [p, end) and bound the number of their entries
+void CountSegment(const char* p, const char* end, bool csv, size_t* nrow,
+                  size_t* nentry) {
+  *nrow = 0;
+  *nentry = 0;
+  while (p != end) {
+    const char* lend = LineEnd(p, end);
+    if (SkipSpace(p, lend) != lend) {
+      ++*nrow;
+      if (csv) {
+        *nentry += std::count(p, lend, ',') + 1;
+      } else {
+        // every token after the label
+        bool in_token = false;
+        for (const char* c = p; c != lend; ++c) {
+          const bool space = IsSpace(*c);
+          if (!space && !in_token) ++*nentry;
+          in_token = !space;
+        }
+        --*nentry;
+      }
+    }
+    p = lend == end ? end : lend + 1;
+  }
+}
+}  // namespace
+
+ParallelTextParser::ParallelTextParser(
+    dmlc::SeekStream* fi, bool csv, const std::map<std::string, std::string>& args)
+    : fi_(fi), csv_(csv), tail_(0), at_end_(false), bytes_read_(0) {
+  param_.InitAllowUnknown(args);
+}
+
+void ParallelTextParser::BeforeFirst() {
+  fi_->Seek(0);
+  buffer_.clear();
+  tail_ = 0;
+  at_end_ = false;
+  bytes_read_ = 0;
+}
+
+bool ParallelTextParser::Next() {
+  while (true) {
+    // the partial line of the previous chunk starts the next one
+    buffer_.erase(0, tail_);
+    tail_ = 0;
+    if (at_end_ && buffer_.empty()) return false;
+    size_t end = buffer_.size();
+    while (!at_end_) {
+      const size_t begin = buffer_.size();
+      buffer_.resize(begin + param_.chunk_size);
+      const size_t nread = fi_->Read(&buffer_[begin], param_.chunk_size);
+      buffer_.resize(begin + nread);
+      bytes_read_ += nread;
+      if (nread == 0) {
+        at_end_ = true;
+        break;
+      }
+      // cut the chunk after its last complete line
+      size_t pos = buffer_.size();
+      while (pos > begin && buffer_[pos - 1] != '\n') --pos;
+      if (pos > begin) {
+        end = pos;
+        break;
+      }
+    }
+    if (at_end_) end = buffer_.size();
+    tail_ = end;
+    this->ParseChunk(buffer_.data(), buffer_.data() + end);
+    if (block_.size != 0) return true;
+  }
+}
+
+void ParallelTextParser::ParseChunk(const char* begin, const char* end) {
+  const int nthread = param_.nthread > 0 ? param_.nthread : omp_get_max_threads();
+  const size_t nseg = std::max(1, nthread);
+  // one segment of complete lines per thread
+  std::vector<const char*> segments(nseg + 1, end);
+  segments[0] = begin;
+  for (size_t t = 1; t < nseg; ++t) {
+    const char* p = std::max(segments[t - 1], begin + (end - begin) * t / nseg);
+    const char* lend = LineEnd(p, end);
+    segments[t] = lend == end ? end : lend + 1;
+  }
+  std::vector<size_t> row_begin(nseg + 1, 0), entry_begin(nseg + 1, 0);
+  #pragma omp parallel for schedule(static, 1) num_threads(nthread)
+  for (omp_ulong t = 0; t < nseg; ++t) {
+    CountSegment(segments[t], segments[t + 1], csv_, &row_begin[t + 1],
+                 &entry_begin[t + 1]);
+  }
+  for (size_t t = 0; t < nseg; ++t) {
+    row_begin[t + 1] += row_begin[t];
+    entry_begin[t + 1] += entry_begin[t];
+  }
+  const size_t nrow = row_begin[nseg];
+  offset_.resize(nrow + 1);
+  offset_[0] = 0;
+  label_.resize(nrow);
+  weight_.resize(nrow);
+  index_.resize(entry_begin[nseg]);
+  value_.resize(entry_begin[nseg]);
+
+  // parse every segment into its range of the block
+  std::vector<SegmentOutput> outputs(nseg);
+  #pragma omp parallel for schedule(static, 1) num_threads(nthread)
+  for (omp_ulong t = 0; t < nseg; ++t) {
+    SegmentOutput& out = outputs[t];
+    out.offset = dmlc::BeginPtr(offset_) + row_begin[t];
+    out.label = dmlc::BeginPtr(label_) + row_begin[t];
+    out.weight = dmlc::BeginPtr(weight_) + row_begin[t];
+    out.index = dmlc::BeginPtr(index_) + entry_begin[t];
+    out.value = dmlc::BeginPtr(value_) + entry_begin[t];
+    out.base_entry = entry_begin[t];
+    out.nrow = out.nentry = 0;
+    out.has_weight = false;
+    out.error = nullptr;
+    const char* p = segments[t];
+    while (p != segments[t + 1] && out.error == nullptr) {
+      const char* lend = LineEnd(p, segments[t + 1]);
+      const bool ok = csv_ ? ParseCSVLine(p, lend, param_.label_column, &out)
+                           : ParseLibSVMLine(p, lend, &out);
+      if (!ok) out.error = p;
+      p = lend == segments[t + 1] ? lend : lend + 1;
+    }
+  }
+  bool has_weight = false;
+  for (size_t t = 0; t < nseg; ++t) {
+    if (outputs[t].error != nullptr) {
+      const char* error = outputs[t].error;
+      LOG(FATAL) << "ParallelTextParser: invalid line `"
+                 << std::string(error, LineEnd(error, end)) << "`";
+    }
+    CHECK_EQ(outputs[t].nrow, row_begin[t + 1] - row_begin[t]);
+    has_weight = has_weight || outputs[t].has_weight;
+  }
+  // close the gaps left by the entries bounded but not parsed
+  size_t nentry = 0;
+  for (size_t t = 0; t < nseg; ++t) {
+    const size_t shift = entry_begin[t] - nentry;
+    if (shift != 0) {
+      std::memmove(dmlc::BeginPtr(index_) + nentry,
+                   dmlc::BeginPtr(index_) + entry_begin[t],
+                   outputs[t].nentry * sizeof(uint32_t));
+      std::memmove(dmlc::BeginPtr(value_) + nentry,
+                   dmlc::BeginPtr(value_) + entry_begin[t],
+                   outputs[t].nentry * sizeof(bst_float));
+      for (size_t i = row_begin[t]; i < row_begin[t + 1]; ++i) {
+        offset_[i + 1] -= shift;
+      }
+    }
+    nentry += outputs[t].nentry;
+  }
+  index_.resize(nentry);
+  value_.resize(nentry);
+
+  block_.size = nrow;
+  block_.offset = dmlc::BeginPtr(offset_);
+  block_.label = dmlc::BeginPtr(label_);
+  block_.weight = has_weight ? dmlc::BeginPtr(weight_) : nullptr;
+  block_.index = dmlc::BeginPtr(index_);
+  block_.value = dmlc::BeginPtr(value_);
+}
+
+const dmlc::RowBlock<uint32_t>& ParallelTextParser::Value() const {
+  return block_;
+}
+
+size_t ParallelTextParser::BytesRead() const {
+  return bytes_read_;
+}
+
+namespace {
+dmlc::Parser<uint32_t>* CreateParser(const std::string& path,
+                                     const std::map<std::string, std::string>& args,
+                                     unsigned part_index, unsigned num_parts,
+                                     bool csv) {
+  if (num_parts != 1) {
+    // the input is split by the parsers of dmlc-core in distributed mode
+    return dmlc::Parser<uint32_t>::Create(path.c_str(), part_index, num_parts,
+                                          csv ? "csv" : "libsvm");
+  }
+  return new ParallelTextParser(dmlc::SeekStream::CreateForRead(path.c_str()),
+                                csv, args);
+}
+
+dmlc::Parser<uint32_t>* CreateLibSVMParser(
+    const std::string& path, const std::map<std::string, std::string>& args,
+    unsigned part_index, unsigned num_parts) {
+  return CreateParser(path, args, part_index, num_parts, false);
+}
+
+dmlc::Parser<uint32_t>* CreateCSVParser(
+    const std::string& path, const std::map<std::string, std::string>& args,
+    unsigned part_index, unsigned num_parts) {
+  return CreateParser(path, args, part_index, num_parts, true);
+}
+}  // namespace
+
+DMLC_REGISTRY_REGISTER(::dmlc::ParserFactoryReg<uint32_t>,
+                       ParserFactoryReg_uint32_t, fast_libsvm)
+.set_body(CreateLibSVMParser);
+DMLC_REGISTRY_REGISTER(::dmlc::ParserFactoryReg<uint32_t>,
+                       ParserFactoryReg_uint32_t, fast_csv)
+.set_body(CreateCSVParser);
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,98 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file parallel_text_parser.h
+ * \brief Multithreaded libsvm and csv parser, registered as the fast_libsvm
+ *  and fast_csv data formats.
+ */
+#ifndef XGBOOST_DATA_PARALLEL_TEXT_PARSER_H_
+#define XGBOOST_DATA_PARALLEL_TEXT_PARSER_H_
+
+#include <xgboost/base.h>
+#include <dmlc/data.h>
+#include <dmlc/io.h>
+#include <dmlc/parameter.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace xgboost {
+namespace data {
+/*! \brief parameters of the parallel text parser, given in the uri */
+struct ParallelTextParserParam : public dmlc::Parameter<ParallelTextParserParam> {
+  /*! \brief number of threads parsing a chunk */
+  int nthread;
+  /*! \brief bytes of text read per chunk */
+  uint64_t chunk_size;
+  /*! \brief column of the label in csv */
+  int label_column;
+  DMLC_DECLARE_PARAMETER(ParallelTextParserParam) {
+    DMLC_DECLARE_FIELD(nthread).set_default(0)
+        .describe("Number of threads parsing a chunk, 0 to use all the threads.");
+    DMLC_DECLARE_FIELD(chunk_size).set_default(64 << 20).set_lower_bound(1)
+        .describe("Number of bytes of text read and parsed at a time.");
+    DMLC_DECLARE_FIELD(label_column).set_default(-1)
+        .describe("Column of the label in csv, -1 when there is no label.");
+  }
+};
+
+/*!
+ * \brief Text parser reading the input one chunk of lines at a time.
+ *  Each chunk is cut on line boundaries into one segment per thread. A first
+ *  pass counts the rows and bounds the entries of the segments, then every
+ *  thread parses its segment straight into its range of the CSR arrays of
+ *  the block, which are compacted when the bound was not reached.
+ * \code
+ * // selected by the format in the uri
+ * DMatrix* dmat = DMatrix::Load("train.txt?format=fast_libsvm&nthread=16",
+ *                               true, false);
+ * \endcode
+ */
+class ParallelTextParser : public dmlc::Parser<uint32_t> {
+ public:
+  /*!
+   * \brief create the parser.
+   * \param fi The input stream, owned by the parser.
+   * \param csv Whether the input is csv instead of libsvm.
+   * \param args The arguments given in the uri.
+   */
+  ParallelTextParser(dmlc::SeekStream* fi, bool csv,
+                     const std::map<std::string, std::string>& args);
+  // implement BeforeFirst
+  void BeforeFirst() override;
+  // implement Next
+  bool Next() override;
+  // implement Value
+  const dmlc::RowBlock<uint32_t>& Value() const override;
+  // implement BytesRead
+  size_t BytesRead() const override;
+
+ protected:
+  /*!
+   * \brief parse the complete lines in [begin, end) into the block, the
+   *  formats of the plugins override it to reuse the reading of the chunks.
+   */
+  virtual void ParseChunk(const char* begin, const char* end);
+  /*! \brief the input */
+  std::unique_ptr<dmlc::SeekStream> fi_;
+  /*! \brief whether the input is csv */
+  bool csv_;
+  ParallelTextParserParam param_;
+  /*! \brief text of the current chunk */
+  std::string buffer_;
+  /*! \brief start of the the partial line carried over to the next chunk */
+  size_t tail_;
+  /*! \brief whether the input was read to the end */
+  bool at_end_;
+  size_t bytes_read_;
+  // CSR arrays of the block
+  std::vector<size_t> offset_;
+  std::vector<bst_float> label_;
+  std::vector<bst_float> weight_;
+  std::vector<uint32_t> index_;
+  std::vector<bst_float> value_;
+  dmlc::RowBlock<uint32_t> block_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_PARALLEL_TEXT_PARSER_H_
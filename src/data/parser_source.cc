@@ -0,0 +1,83 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file parser_source.cc
+ */
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include "./parser_source.h"
+
+namespace xgboost {
+namespace data {
+
+ParserSource::ParserSource(std::unique_ptr<dmlc::Parser<uint32_t> >&& parser)
+    : parser_(std::move(parser)), row_begin_(0) {
+  parser_->BeforeFirst();
+  while (parser_->Next()) {
+    const dmlc::RowBlock<uint32_t>& batch = parser_->Value();
+    if (batch.label != nullptr) {
+      info.labels.insert(info.labels.end(), batch.label, batch.label + batch.size);
+    }
+    if (batch.weight != nullptr) {
+      info.weights.insert(info.weights.end(), batch.weight, batch.weight + batch.size);
+    }
+    const size_t begin = batch.offset[0];
+    const omp_ulong nentry = static_cast<omp_ulong>(batch.offset[batch.size] - begin);
+    uint64_t num_col = info.num_col;
+    #pragma omp parallel
+    {
+      uint64_t max_col = 0;
+      #pragma omp for schedule(static)
+      for (omp_ulong i = 0; i < nentry; ++i) {
+        max_col = std::max(max_col, static_cast<uint64_t>(batch.index[begin + i] + 1));
+      }
+      #pragma omp critical
+      num_col = std::max(num_col, max_col);
+    }
+    info.num_col = num_col;
+    info.num_row += batch.size;
+    info.num_nonzero += nentry;
+  }
+  this->BeforeFirst();
+}
+
+bool ParserSource::Next() {
+  if (!parser_->Next()) {
+    CHECK_EQ(row_begin_, info.num_row)
+        << "ParserSource: the parser gave other rows than in the first pass";
+    return false;
+  }
+  const dmlc::RowBlock<uint32_t>& block = parser_->Value();
+  const size_t begin = block.offset[0];
+  row_ptr_.resize(block.size + 1);
+  for (size_t i = 0; i <= block.size; ++i) {
+    row_ptr_[i] = block.offset[i] - begin;
+  }
+  row_data_.resize(row_ptr_.back());
+  const omp_ulong nentry = static_cast<omp_ulong>(row_data_.size());
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nentry; ++i) {
+    row_data_[i] = RowBatch::Entry(
+        block.index[begin + i], block.value == nullptr ? 1.0f : block.value[begin + i]);
+  }
+  batch_.size = block.size;
+  batch_.base_rowid = row_begin_;
+  batch_.ind_ptr = dmlc::BeginPtr(row_ptr_);
+  batch_.data_ptr = dmlc::BeginPtr(row_data_);
+  row_begin_ += block.size;
+  CHECK_LE(row_begin_, info.num_row)
+      << "ParserSource: the parser gave other rows than in the first pass";
+  return true;
+}
+
+void ParserSource::BeforeFirst() {
+  parser_->BeforeFirst();
+  row_begin_ = 0;
+}
+
+const RowBatch& ParserSource::Value() const {
+  return batch_;
+}
+
+}  // namespace data
+}  // namespace xgboost
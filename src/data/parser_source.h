@@ -0,0 +1,55 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file parser_source.h
+ * \brief Data source reading its parser again on every pass over the rows.
+ */
+#ifndef XGBOOST_DATA_PARSER_SOURCE_H_
+#define XGBOOST_DATA_PARSER_SOURCE_H_
+
+#include <dmlc/data.h>
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <memory>
+#include <vector>
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief Row source that keeps the parser instead of a copy of the data.
+ *  Each batch of the parser becomes a row batch, and BeforeFirst rewinds the
+ *  parser, so only the current batch is held in memory. The meta information
+ *  is collected by a first pass in the constructor, and every later pass must
+ *  give the same rows.
+ *
+ *  The structures derived from the rows are still built by the consumers, for
+ *  tree_method=hist the quantized pages of several batches go to
+ *  hist_page_file.
+ */
+class ParserSource : public DataSource {
+ public:
+  /*!
+   * \param parser The parser, it must support BeforeFirst.
+   */
+  explicit ParserSource(std::unique_ptr<dmlc::Parser<uint32_t> >&& parser);
+  // implement Next
+  bool Next() override;
+  // implement BeforeFirst
+  void BeforeFirst() override;
+  // implement Value
+  const RowBatch &Value() const override;
+
+ private:
+  /*! \brief the parser */
+  std::unique_ptr<dmlc::Parser<uint32_t> > parser_;
+  /*! \brief first row of the next batch */
+  size_t row_begin_;
+  /*! \brief row pointer of the current batch */
+  std::vector<size_t> row_ptr_;
+  /*! \brief entries of the current batch */
+  std::vector<RowBatch::Entry> row_data_;
+  /*! \brief the current batch */
+  RowBatch batch_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_PARSER_SOURCE_H_
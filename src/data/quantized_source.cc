@@ -0,0 +1,144 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file quantized_source.cc
+ */
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <limits>
+#include "./quantized_source.h"
+#include "../common/quantile.h"
+
+namespace xgboost {
+namespace data {
+
+QuantizedSource::QuantizedSource(dmlc::Parser<uint32_t>* src, uint32_t max_bin,
+                                 size_t block_rows)
+    : max_bin(max_bin), block_rows_(block_rows), row_begin_(0) {
+  typedef common::HistCutMatrix::WXQSketch WXQSketch;
+  CHECK_GT(max_bin, 0U);
+  const int nthread = omp_get_max_threads();
+  const double eps = 1.0 / (max_bin * common::HistCutMatrix::kSketchFactor);
+  std::vector<WXQSketch> sketchs;
+
+  // first pass: sketch the features and collect the meta information, the
+  // number of rows is not known yet so the sketches are sized for the
+  // largest number of rows.
+  src->BeforeFirst();
+  while (src->Next()) {
+    const dmlc::RowBlock<uint32_t>& batch = src->Value();
+    if (batch.label != nullptr) {
+      info.labels.insert(info.labels.end(), batch.label, batch.label + batch.size);
+    }
+    if (batch.weight != nullptr) {
+      info.weights.insert(info.weights.end(), batch.weight, batch.weight + batch.size);
+    }
+    for (size_t i = batch.offset[0]; i < batch.offset[batch.size]; ++i) {
+      info.num_col = std::max(info.num_col, static_cast<uint64_t>(batch.index[i] + 1));
+    }
+    while (sketchs.size() < info.num_col) {
+      sketchs.emplace_back();
+      sketchs.back().Init(std::numeric_limits<bst_uint>::max(), eps);
+    }
+    const unsigned ncol = static_cast<unsigned>(info.num_col);
+    const unsigned nstep = static_cast<unsigned>((ncol + nthread - 1) / nthread);
+    #pragma omp parallel num_threads(nthread)
+    {
+      unsigned tid = static_cast<unsigned>(omp_get_thread_num());
+      unsigned begin = std::min(nstep * tid, ncol);
+      unsigned end = std::min(nstep * (tid + 1), ncol);
+      for (size_t i = 0; i < batch.size; ++i) {
+        const bst_float w = batch.weight == nullptr ? 1.0f : batch.weight[i];
+        for (size_t j = batch.offset[i]; j < batch.offset[i + 1]; ++j) {
+          const uint32_t fid = batch.index[j];
+          if (fid >= begin && fid < end) {
+            sketchs[fid].Push(batch.value == nullptr ? 1.0f : batch.value[j], w);
+          }
+        }
+      }
+    }
+    info.num_row += batch.size;
+    info.num_nonzero += batch.offset[batch.size] - batch.offset[0];
+  }
+  std::vector<WXQSketch::SummaryContainer> summary_array;
+  common::PruneSketchSummaries(
+      &sketchs, max_bin * common::HistCutMatrix::kSketchFactor, &summary_array);
+  sketchs.clear();
+  cut.Init(&summary_array, max_bin);
+  gmat.cut = &cut;
+
+  // second pass: quantize the rows, one parser block at a time.
+  std::vector<size_t> block_ptr;
+  std::vector<RowBatch::Entry> block_data;
+  src->BeforeFirst();
+  while (src->Next()) {
+    const dmlc::RowBlock<uint32_t>& batch = src->Value();
+    const size_t begin = batch.offset[0];
+    block_ptr.resize(batch.size + 1);
+    for (size_t i = 0; i <= batch.size; ++i) {
+      block_ptr[i] = batch.offset[i] - begin;
+    }
+    block_data.resize(block_ptr.back());
+    const omp_ulong nentry = static_cast<omp_ulong>(block_data.size());
+    #pragma omp parallel for schedule(static) num_threads(nthread)
+    for (omp_ulong i = 0; i < nentry; ++i) {
+      block_data[i] = RowBatch::Entry(
+          batch.index[begin + i], batch.value == nullptr ? 1.0f : batch.value[begin + i]);
+    }
+    RowBatch rows;
+    rows.size = batch.size;
+    rows.base_rowid = gmat.row_ptr.empty() ? 0 : gmat.row_ptr.size() - 1;
+    rows.ind_ptr = dmlc::BeginPtr(block_ptr);
+    rows.data_ptr = dmlc::BeginPtr(block_data);
+    gmat.PushBatch(rows);
+  }
+  CHECK_EQ(gmat.row_ptr.size(), info.num_row + 1)
+      << "QuantizedSource: the rows changed between the two passes";
+
+  // the representative value and the feature of each bin.
+  const uint32_t nbins = cut.row_ptr.back();
+  bin_value_.resize(nbins);
+  bin_feature_.resize(nbins);
+  for (bst_uint fid = 0; fid + 1 < cut.row_ptr.size(); ++fid) {
+    for (uint32_t bin = cut.row_ptr[fid]; bin < cut.row_ptr[fid + 1]; ++bin) {
+      bin_feature_[bin] = fid;
+      bin_value_[bin] = bin == cut.row_ptr[fid] ? cut.min_val[fid] : cut.cut[bin - 1];
+    }
+  }
+}
+
+bool QuantizedSource::Next() {
+  if (row_begin_ >= info.num_row) return false;
+  const size_t row_end = std::min(static_cast<size_t>(info.num_row),
+                                  row_begin_ + block_rows_);
+  const size_t offset = gmat.row_ptr[row_begin_];
+  const omp_ulong nrow = static_cast<omp_ulong>(row_end - row_begin_);
+  row_ptr_.resize(nrow + 1);
+  for (omp_ulong i = 0; i <= nrow; ++i) {
+    row_ptr_[i] = gmat.row_ptr[row_begin_ + i] - offset;
+  }
+  row_data_.resize(row_ptr_.back());
+  const omp_ulong nentry = static_cast<omp_ulong>(row_data_.size());
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nentry; ++i) {
+    const uint32_t bin = gmat.index[offset + i];
+    row_data_[i] = RowBatch::Entry(bin_feature_[bin], bin_value_[bin]);
+  }
+  batch_.size = nrow;
+  batch_.base_rowid = row_begin_;
+  batch_.ind_ptr = dmlc::BeginPtr(row_ptr_);
+  batch_.data_ptr = dmlc::BeginPtr(row_data_);
+  row_begin_ = row_end;
+  return true;
+}
+
+void QuantizedSource::BeforeFirst() {
+  row_begin_ = 0;
+}
+
+const RowBatch& QuantizedSource::Value() const {
+  return batch_;
+}
+
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,73 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file quantized_source.h
+ * \brief Data source holding the histogram bin of every entry instead of
+ *  its value, built from a stream of rows read twice.
+ */
+#ifndef XGBOOST_DATA_QUANTIZED_SOURCE_H_
+#define XGBOOST_DATA_QUANTIZED_SOURCE_H_
+
+#include <dmlc/data.h>
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <vector>
+#include "../common/hist_util.h"
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief Row data source quantized while it is read.
+ *  A first pass over the parser sketches the features and collects the meta
+ *  information, a second pass quantizes the rows straight into the bin index,
+ *  so the values of the whole data are never held in memory.
+ *
+ *  The rows are produced one block at a time with each value replaced by
+ *  the lower bound of its bin, min_val for the first bin of a feature. A
+ *  value quantized again with the same cuts falls into the same bin, so
+ *  tree_method=hist with the same max_bin reuses cut and gmat, and the
+ *  predictions of the trees it grows are the same as on the raw values.
+ */
+class QuantizedSource : public DataSource {
+ public:
+  /*! \brief default number of rows decoded per batch */
+  static const size_t kBlockRows = 1 << 16;
+  /*!
+   * \brief quantize the rows of src, which must support BeforeFirst.
+   * \param src The row source, read twice.
+   * \param max_bin The maximum number of bins of a feature.
+   * \param block_rows The number of rows of each batch.
+   */
+  QuantizedSource(dmlc::Parser<uint32_t>* src, uint32_t max_bin,
+                  size_t block_rows = kBlockRows);
+  // implement Next
+  bool Next() override;
+  // implement BeforeFirst
+  void BeforeFirst() override;
+  // implement Value
+  const RowBatch &Value() const override;
+  /*! \brief the maximum number of bins the data was quantized with */
+  uint32_t max_bin;
+  /*! \brief the cuts of the features */
+  common::HistCutMatrix cut;
+  /*! \brief the bins of the entries, its cut points to cut */
+  common::GHistIndexMatrix gmat;
+
+ private:
+  /*! \brief rows per batch */
+  size_t block_rows_;
+  /*! \brief first row of the next batch */
+  size_t row_begin_;
+  /*! \brief representative value of each bin */
+  std::vector<bst_float> bin_value_;
+  /*! \brief feature of each bin */
+  std::vector<bst_uint> bin_feature_;
+  /*! \brief row pointer of the current batch */
+  std::vector<size_t> row_ptr_;
+  /*! \brief entries of the current batch */
+  std::vector<RowBatch::Entry> row_data_;
+  /*! \brief the current batch */
+  RowBatch batch_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_QUANTIZED_SOURCE_H_
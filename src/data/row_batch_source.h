@@ -0,0 +1,64 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file row_batch_source.h
+ * \brief Data source that views a single row batch of another DMatrix,
+ *  used to process a DMatrix one page at a time.
+ */
+#ifndef XGBOOST_DATA_ROW_BATCH_SOURCE_H_
+#define XGBOOST_DATA_ROW_BATCH_SOURCE_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <vector>
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief Data source over one row batch, the batch content is not copied
+ *  and must stay valid while the source is in use.
+ *  Row ids are rebased to 0, the row dependent meta information
+ *  (root_index and base_margin) is sliced from the parent.
+ */
+class RowBatchSource : public DataSource {
+ public:
+  RowBatchSource(const RowBatch& batch, const MetaInfo& parent)
+      : batch_(batch), at_first_(true) {
+    batch_.base_rowid = 0;
+    info.num_row = batch.size;
+    info.num_col = parent.num_col;
+    info.num_nonzero = batch.ind_ptr[batch.size] - batch.ind_ptr[0];
+    const size_t begin = batch.base_rowid, end = batch.base_rowid + batch.size;
+    if (parent.root_index.size() != 0) {
+      info.root_index.assign(parent.root_index.begin() + begin,
+                             parent.root_index.begin() + end);
+    }
+    if (parent.base_margin.size() != 0) {
+      const size_t ngroup = parent.base_margin.size() / parent.num_row;
+      info.base_margin.assign(parent.base_margin.begin() + begin * ngroup,
+                              parent.base_margin.begin() + end * ngroup);
+    }
+  }
+  // implement Next
+  bool Next() override {
+    if (!at_first_) return false;
+    at_first_ = false;
+    return true;
+  }
+  // implement BeforeFirst
+  void BeforeFirst() override {
+    at_first_ = true;
+  }
+  // implement Value
+  const RowBatch& Value() const override {
+    return batch_;
+  }
+
+ private:
+  /*! \brief the batch view with row ids starting at 0 */
+  RowBatch batch_;
+  /*! \brief whether the iterator is at the beginning */
+  bool at_first_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_ROW_BATCH_SOURCE_H_
@@ -0,0 +1,109 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file row_sample.cc
+ */
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <utility>
+#include "./row_sample.h"
+#include "./simple_csr_source.h"
+#include "./slice_source.h"
+#include "../common/random.h"
+
+namespace xgboost {
+namespace data {
+namespace {
+// the rows [begin, end) of the unit u of a matrix, a group or a single row
+inline std::pair<size_t, size_t> UnitRows(const MetaInfo& info, size_t u) {
+  if (info.group_ptr.size() != 0) {
+    return std::make_pair(info.group_ptr[u], info.group_ptr[u + 1]);
+  }
+  return std::make_pair(u, u + 1);
+}
+}  // namespace
+
+void SampleRows(DMatrix* src, size_t nsample, bool stratify, unsigned seed,
+                unsigned nfold, RowSample* out) {
+  CHECK_GT(nfold, 0U) << "SampleRows: need at least one fold";
+  const MetaInfo& info = src->info();
+  const bool by_group = info.group_ptr.size() != 0;
+  const size_t nunit = by_group ? info.group_ptr.size() - 1 : info.num_row;
+  const double rate = info.num_row == 0 ? 1.0 :
+      std::min(1.0, static_cast<double>(nsample) / info.num_row);
+  // the units of each stratum, the groups are never stratified
+  std::map<bst_float, std::vector<bst_uint> > strata;
+  for (size_t u = 0; u < nunit; ++u) {
+    const bst_float key = stratify && !by_group && info.labels.size() != 0 ?
+        info.labels[u] : 0.0f;
+    strata[key].push_back(static_cast<bst_uint>(u));
+  }
+  // the sampled units and their folds
+  common::RandomEngine rnd(seed);
+  std::vector<std::pair<bst_uint, unsigned> > chosen;
+  for (auto& kv : strata) {
+    std::vector<bst_uint>& units = kv.second;
+    const size_t take = std::min(units.size(), std::max(
+        static_cast<size_t>(1), static_cast<size_t>(std::round(rate * units.size()))));
+    // partial Fisher-Yates shuffle, the units are dealt to the folds in turn
+    for (size_t i = 0; i < take; ++i) {
+      std::uniform_int_distribution<size_t> dist(i, units.size() - 1);
+      std::swap(units[i], units[dist(rnd)]);
+      chosen.emplace_back(units[i], static_cast<unsigned>(i % nfold));
+    }
+  }
+  std::sort(chosen.begin(), chosen.end());
+  std::vector<bst_uint> ridx;
+  out->fold.clear();
+  for (const auto& c : chosen) {
+    const std::pair<size_t, size_t> rows = UnitRows(info, c.first);
+    for (size_t r = rows.first; r < rows.second; ++r) {
+      ridx.push_back(static_cast<bst_uint>(r));
+      out->fold.push_back(c.second);
+    }
+  }
+  // gather the rows with one pass over the matrix, then keep them in memory
+  std::shared_ptr<DMatrix> parent(src, [](DMatrix*) {});
+  std::unique_ptr<DMatrix> slice(DMatrix::Create(std::unique_ptr<DataSource>(
+      new SliceSource(parent, std::move(ridx)))));
+  std::unique_ptr<SimpleCSRSource> source(new SimpleCSRSource());
+  source->CopyFrom(slice.get());
+  out->dmat.reset(DMatrix::Create(std::move(source)));
+  out->nfold = nfold;
+  out->source_rows = info.num_row;
+}
+
+void SelectFold(const RowSample& sample, unsigned k,
+                const std::vector<bst_float>& preds,
+                MetaInfo* out_info, std::vector<bst_float>* out_preds) {
+  const MetaInfo& info = sample.dmat->info();
+  CHECK_EQ(info.num_row, sample.fold.size()) << "SelectFold: invalid sample";
+  *out_info = MetaInfo();
+  out_preds->clear();
+  if (info.num_row == 0) return;
+  CHECK_EQ(preds.size() % info.num_row, 0U) << "SelectFold: invalid predictions";
+  const size_t stride = preds.size() / info.num_row;
+  CHECK_NE(stride, 0U) << "SelectFold: invalid predictions";
+  const size_t nunit = info.group_ptr.size() != 0 ? info.group_ptr.size() - 1 : info.num_row;
+  if (info.group_ptr.size() != 0) out_info->group_ptr.push_back(0);
+  for (size_t u = 0; u < nunit; ++u) {
+    const std::pair<size_t, size_t> rows = UnitRows(info, u);
+    if (rows.first == rows.second || sample.fold[rows.first] != k) continue;
+    for (size_t r = rows.first; r < rows.second; ++r) {
+      if (info.labels.size() != 0) out_info->labels.push_back(info.labels[r]);
+      if (info.weights.size() != 0) out_info->weights.push_back(info.weights[r]);
+    }
+    out_preds->insert(out_preds->end(), preds.begin() + rows.first * stride,
+                      preds.begin() + rows.second * stride);
+    if (info.group_ptr.size() != 0) {
+      out_info->group_ptr.push_back(static_cast<bst_uint>(
+          out_preds->size() / stride));
+    }
+  }
+  out_info->num_row = out_preds->size() / stride;
+  out_info->num_col = info.num_col;
+}
+}  // namespace data
+}  // namespace xgboost
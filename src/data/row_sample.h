@@ -0,0 +1,57 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file row_sample.h
+ * \brief Fixed random sample of the rows of a DMatrix, used to evaluate
+ *  the metrics of large evaluation sets on a fraction of their rows.
+ */
+#ifndef XGBOOST_DATA_ROW_SAMPLE_H_
+#define XGBOOST_DATA_ROW_SAMPLE_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <memory>
+#include <vector>
+
+namespace xgboost {
+namespace data {
+/*! \brief a sample of the rows of a matrix, dealt to folds */
+struct RowSample {
+  /*! \brief in memory copy of the sampled rows, in the order of the matrix */
+  std::shared_ptr<DMatrix> dmat;
+  /*! \brief fold of each row of the sample */
+  std::vector<unsigned> fold;
+  /*! \brief number of folds */
+  unsigned nfold;
+  /*! \brief number of rows of the sampled matrix */
+  uint64_t source_rows;
+};
+
+/*!
+ * \brief draw a random sample of about nsample rows of a matrix.
+ *  A matrix with groups is sampled by whole groups. When stratified, each
+ *  label keeps its fraction of the rows, and the rows of each label are
+ *  dealt evenly to the folds.
+ * \param src The matrix to sample.
+ * \param nsample The number of rows of the sample.
+ * \param stratify Whether to sample each label on its own.
+ * \param seed The seed of the sample.
+ * \param nfold The number of folds the rows, or groups, are dealt to.
+ * \param out The sample.
+ */
+void SampleRows(DMatrix* src, size_t nsample, bool stratify, unsigned seed,
+                unsigned nfold, RowSample* out);
+
+/*!
+ * \brief select the rows of a fold of a sample.
+ * \param sample The sample.
+ * \param k The fold.
+ * \param preds The predictions of the sample, one or more per row.
+ * \param out_info The labels, weights and groups of the rows of the fold.
+ * \param out_preds The predictions of the rows of the fold.
+ */
+void SelectFold(const RowSample& sample, unsigned k,
+                const std::vector<bst_float>& preds,
+                MetaInfo* out_info, std::vector<bst_float>* out_preds);
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_ROW_SAMPLE_H_
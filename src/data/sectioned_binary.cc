@@ -0,0 +1,327 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file sectioned_binary.cc
+ */
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include "./sectioned_binary.h"
+
+namespace xgboost {
+namespace data {
+namespace {
+const int32_t kSectionedFormatVersion = 1;
+
+// header at the start of the file, followed by the section table, the
+// checksums of the chunks of every section, the checksum of the table and
+// checksums, then the sections.
+struct FileHeader {
+  int32_t magic;
+  int32_t version;
+  uint64_t num_row;
+  uint64_t num_col;
+  uint64_t num_nonzero;
+  uint64_t chunk_bytes;
+  uint64_t num_sections;
+};
+
+inline uint32_t Crc32(const void* data, size_t n, uint32_t crc = 0) {
+  static const std::vector<uint32_t> table = [] {
+    std::vector<uint32_t> t(256);
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) != 0 ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      }
+      t[i] = c;
+    }
+    return t;
+  }();
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+  for (size_t i = 0; i < n; ++i) {
+    crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+inline size_t NumChunks(uint64_t bytes, uint64_t chunk_bytes) {
+  return static_cast<size_t>((bytes + chunk_bytes - 1) / chunk_bytes);
+}
+
+// varint of the differences of a non decreasing sequence
+template<typename T>
+std::string DeltaEncode(const std::vector<T>& vec) {
+  std::string out;
+  T prev = 0;
+  for (T v : vec) {
+    CHECK_GE(v, prev) << "SectionedBinary: the pointers must not decrease";
+    uint64_t delta = static_cast<uint64_t>(v - prev);
+    while (delta >= 0x80) {
+      out.push_back(static_cast<char>((delta & 0x7f) | 0x80));
+      delta >>= 7;
+    }
+    out.push_back(static_cast<char>(delta));
+    prev = v;
+  }
+  return out;
+}
+
+template<typename T>
+bool DeltaDecode(const std::string& in, size_t length, T* out) {
+  uint64_t value = 0;
+  size_t pos = 0;
+  for (size_t i = 0; i < length; ++i) {
+    uint64_t delta = 0;
+    for (int shift = 0; ; shift += 7) {
+      if (pos == in.size() || shift > 63) return false;
+      const uint8_t byte = static_cast<uint8_t>(in[pos++]);
+      delta |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) break;
+    }
+    value += delta;
+    out[i] = static_cast<T>(value);
+  }
+  return pos == in.size();
+}
+
+// a section as it is written
+struct SaveSection {
+  const char* data;
+  uint64_t elem_size;
+  uint64_t length;
+  uint32_t codec;
+  std::string encoded;
+};
+
+template<typename T>
+SaveSection RawSection(const std::vector<T>& vec) {
+  SaveSection s;
+  s.elem_size = sizeof(T);
+  s.length = vec.size();
+  s.codec = SectionedBinary::kRaw;
+  s.data = reinterpret_cast<const char*>(dmlc::BeginPtr(vec));
+  return s;
+}
+
+template<typename T>
+SaveSection PointerSection(const std::vector<T>& vec, bool compress) {
+  if (!compress) return RawSection(vec);
+  SaveSection s;
+  s.elem_size = sizeof(T);
+  s.length = vec.size();
+  s.codec = SectionedBinary::kDeltaVarint;
+  s.encoded = DeltaEncode(vec);
+  return s;
+}
+}  // namespace
+
+void SectionedBinary::Save(const SimpleCSRSource& src, dmlc::Stream* fo,
+                           bool compress, size_t chunk_bytes) {
+  CHECK_GT(chunk_bytes, 0U);
+  const MetaInfo& info = src.info;
+  std::vector<SaveSection> sections(kNumSections);
+  sections[kRowPtr] = PointerSection(src.row_ptr_, compress);
+  sections[kRowData] = RawSection(src.row_data_);
+  sections[kLabels] = RawSection(info.labels);
+  sections[kGroupPtr] = PointerSection(info.group_ptr, compress);
+  sections[kWeights] = RawSection(info.weights);
+  sections[kRootIndex] = RawSection(info.root_index);
+  sections[kBaseMargin] = RawSection(info.base_margin);
+  // the encoded sections point into their own buffer, set once they are in place
+  for (auto& s : sections) {
+    if (s.codec != kRaw) s.data = s.encoded.data();
+  }
+
+  std::vector<TableEntry> table(kNumSections);
+  std::vector<std::vector<uint32_t> > checksums(kNumSections);
+  size_t num_checksums = 0;
+  for (int i = 0; i < kNumSections; ++i) {
+    const SaveSection& s = sections[i];
+    table[i].id = i;
+    table[i].codec = s.codec;
+    table[i].elem_size = s.elem_size;
+    table[i].length = s.length;
+    table[i].stored_bytes = s.codec == kRaw ? s.length * s.elem_size : s.encoded.size();
+    checksums[i].resize(NumChunks(table[i].stored_bytes, chunk_bytes));
+    num_checksums += checksums[i].size();
+  }
+  uint64_t pos = sizeof(FileHeader) + kNumSections * sizeof(TableEntry) +
+      (num_checksums + 1) * sizeof(uint32_t);
+  for (int i = 0; i < kNumSections; ++i) {
+    table[i].offset = pos;
+    pos += table[i].stored_bytes;
+    const bst_omp_uint nchunk = static_cast<bst_omp_uint>(checksums[i].size());
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (bst_omp_uint c = 0; c < nchunk; ++c) {
+      const uint64_t begin = c * chunk_bytes;
+      const uint64_t end = std::min(table[i].stored_bytes, begin + chunk_bytes);
+      checksums[i][c] = Crc32(sections[i].data + begin, end - begin);
+    }
+  }
+
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kMagic;
+  header.version = kSectionedFormatVersion;
+  header.num_row = info.num_row;
+  header.num_col = info.num_col;
+  header.num_nonzero = info.num_nonzero;
+  header.chunk_bytes = chunk_bytes;
+  header.num_sections = kNumSections;
+  fo->Write(&header, sizeof(header));
+  fo->Write(dmlc::BeginPtr(table), table.size() * sizeof(TableEntry));
+  uint32_t table_crc = Crc32(dmlc::BeginPtr(table), table.size() * sizeof(TableEntry));
+  for (const auto& crcs : checksums) {
+    if (crcs.size() == 0) continue;
+    fo->Write(dmlc::BeginPtr(crcs), crcs.size() * sizeof(uint32_t));
+    table_crc = Crc32(dmlc::BeginPtr(crcs), crcs.size() * sizeof(uint32_t), table_crc);
+  }
+  fo->Write(&table_crc, sizeof(table_crc));
+  for (int i = 0; i < kNumSections; ++i) {
+    if (table[i].stored_bytes != 0) {
+      fo->Write(sections[i].data, table[i].stored_bytes);
+    }
+  }
+}
+
+SectionedBinary::SectionedBinary(const std::string& uri)
+    : uri_(uri), table_(kNumSections), checksums_(kNumSections) {
+  std::unique_ptr<dmlc::SeekStream> fi(dmlc::SeekStream::CreateForRead(uri.c_str()));
+  FileHeader header;
+  CHECK_EQ(fi->Read(&header, sizeof(header)), sizeof(header)) << "invalid input file format";
+  CHECK_EQ(header.magic, kMagic) << "invalid format, magic number mismatch";
+  CHECK_EQ(header.version, kSectionedFormatVersion)
+      << "SectionedBinary: unsupported format version " << header.version;
+  CHECK_GT(header.chunk_bytes, 0U) << "SectionedBinary: invalid format";
+  num_row_ = header.num_row;
+  num_col_ = header.num_col;
+  num_nonzero_ = header.num_nonzero;
+  chunk_bytes_ = header.chunk_bytes;
+
+  std::vector<TableEntry> table(header.num_sections);
+  const size_t table_bytes = table.size() * sizeof(TableEntry);
+  CHECK_EQ(fi->Read(dmlc::BeginPtr(table), table_bytes), table_bytes)
+      << "SectionedBinary: truncated file " << uri;
+  uint32_t table_crc = Crc32(dmlc::BeginPtr(table), table_bytes);
+  for (const TableEntry& e : table) {
+    std::vector<uint32_t> crcs(NumChunks(e.stored_bytes, chunk_bytes_));
+    const size_t crc_bytes = crcs.size() * sizeof(uint32_t);
+    if (crc_bytes != 0) {
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(crcs), crc_bytes), crc_bytes)
+          << "SectionedBinary: truncated file " << uri;
+      table_crc = Crc32(dmlc::BeginPtr(crcs), crc_bytes, table_crc);
+    }
+    // sections of later versions are skipped
+    if (e.id < kNumSections) {
+      table_[e.id] = e;
+      checksums_[e.id].swap(crcs);
+    }
+  }
+  uint32_t stored_crc;
+  CHECK_EQ(fi->Read(&stored_crc, sizeof(stored_crc)), sizeof(stored_crc))
+      << "SectionedBinary: truncated file " << uri;
+  CHECK_EQ(stored_crc, table_crc) << "SectionedBinary: corrupted section table in " << uri;
+  for (int i = 0; i < kNumSections; ++i) {
+    const TableEntry& e = table_[i];
+    CHECK(e.codec == kRaw || e.codec == kDeltaVarint)
+        << "SectionedBinary: unknown codec " << e.codec;
+    CHECK(e.codec != kRaw || e.stored_bytes == e.length * e.elem_size)
+        << "SectionedBinary: invalid format";
+  }
+}
+
+void SectionedBinary::ReadSections(const std::vector<Request>& requests, int nthread) {
+  // the chunks of all the requested sections, read from any stream
+  struct Task {
+    size_t request;
+    uint64_t chunk;
+  };
+  std::vector<Task> tasks;
+  std::vector<std::string> staging(requests.size());
+  std::vector<char*> buffers(requests.size());
+  for (size_t r = 0; r < requests.size(); ++r) {
+    const TableEntry& e = table_[requests[r].section];
+    if (e.codec == kRaw) {
+      buffers[r] = static_cast<char*>(requests[r].dst);
+    } else {
+      staging[r].resize(e.stored_bytes);
+      buffers[r] = &staging[r][0];
+    }
+    for (uint64_t c = 0; c < checksums_[requests[r].section].size(); ++c) {
+      tasks.push_back(Task{r, c});
+    }
+  }
+  if (nthread <= 0) nthread = omp_get_max_threads();
+  nthread = std::max(1, std::min(nthread, static_cast<int>(tasks.size())));
+  // 0: read, 1: failed to read, 2: checksum mismatch
+  std::vector<int> status(tasks.size(), 0);
+  const bst_omp_uint ntask = static_cast<bst_omp_uint>(tasks.size());
+  #pragma omp parallel num_threads(nthread)
+  {
+    std::unique_ptr<dmlc::SeekStream> fi;
+    #pragma omp for schedule(dynamic, 1)
+    for (bst_omp_uint t = 0; t < ntask; ++t) {
+      const Task& task = tasks[t];
+      const Section s = requests[task.request].section;
+      const TableEntry& e = table_[s];
+      const uint64_t begin = task.chunk * chunk_bytes_;
+      const size_t n = static_cast<size_t>(std::min(e.stored_bytes, begin + chunk_bytes_) - begin);
+      char* dst = buffers[task.request] + begin;
+      try {
+        if (fi == nullptr) fi.reset(dmlc::SeekStream::CreateForRead(uri_.c_str()));
+        fi->Seek(e.offset + begin);
+        if (fi->Read(dst, n) != n) {
+          status[t] = 1;
+        } else if (Crc32(dst, n) != checksums_[s][task.chunk]) {
+          status[t] = 2;
+        }
+      } catch (const dmlc::Error&) {
+        status[t] = 1;
+      }
+    }
+  }
+  for (size_t t = 0; t < tasks.size(); ++t) {
+    CHECK_NE(status[t], 1) << "SectionedBinary: cannot read section "
+                           << requests[tasks[t].request].section << " of " << uri_;
+    CHECK_NE(status[t], 2) << "SectionedBinary: checksum mismatch in chunk " << tasks[t].chunk
+                           << " of section " << requests[tasks[t].request].section
+                           << " of " << uri_;
+  }
+  for (size_t r = 0; r < requests.size(); ++r) {
+    const TableEntry& e = table_[requests[r].section];
+    if (e.codec != kDeltaVarint) continue;
+    bool valid = false;
+    if (e.elem_size == sizeof(uint64_t)) {
+      valid = DeltaDecode(staging[r], e.length, static_cast<uint64_t*>(requests[r].dst));
+    } else if (e.elem_size == sizeof(uint32_t)) {
+      valid = DeltaDecode(staging[r], e.length, static_cast<uint32_t*>(requests[r].dst));
+    }
+    CHECK(valid) << "SectionedBinary: invalid section " << requests[r].section
+                 << " of " << uri_;
+  }
+}
+
+void SectionedBinary::ReadAll(SimpleCSRSource* out, int nthread) {
+  out->Clear();
+  MetaInfo& info = out->info;
+  info.num_row = num_row_;
+  info.num_col = num_col_;
+  info.num_nonzero = num_nonzero_;
+  std::vector<Request> requests;
+  this->AddRequest(kRowPtr, &out->row_ptr_, &requests);
+  this->AddRequest(kRowData, &out->row_data_, &requests);
+  this->AddRequest(kLabels, &info.labels, &requests);
+  this->AddRequest(kGroupPtr, &info.group_ptr, &requests);
+  this->AddRequest(kWeights, &info.weights, &requests);
+  this->AddRequest(kRootIndex, &info.root_index, &requests);
+  this->AddRequest(kBaseMargin, &info.base_margin, &requests);
+  this->ReadSections(requests, nthread);
+  CHECK_EQ(out->row_ptr_.size(), num_row_ + 1) << "SectionedBinary: invalid format";
+  CHECK_EQ(out->row_ptr_.back(), out->row_data_.size()) << "SectionedBinary: invalid format";
+}
+
+}  // namespace data
+}  // namespace xgboost
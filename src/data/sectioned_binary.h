@@ -0,0 +1,134 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file sectioned_binary.h
+ * \brief Binary DMatrix format made of independent sections, read in
+ *  parallel by range reads of the stream.
+ */
+#ifndef XGBOOST_DATA_SECTIONED_BINARY_H_
+#define XGBOOST_DATA_SECTIONED_BINARY_H_
+
+#include <dmlc/io.h>
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <string>
+#include <vector>
+#include "./simple_csr_source.h"
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief Reader of the sectioned binary format.
+ *  The file starts with a header and a table giving the offset, the codec
+ *  and the checksums of each section. A section is stored as chunks of
+ *  chunk_bytes, each with a CRC32, so the chunks of all the sections are
+ *  read by several streams at once and checked as they arrive. The row and
+ *  group pointers are delta coded when compression is on.
+ *
+ *  Opening the file only reads the table, the sections are read when asked
+ *  for, so a section such as the labels can be read on its own.
+ * \code
+ * dmat->SaveSectioned(uri, true);
+ * data::SectionedBinary file(uri);
+ * std::vector<bst_float> labels;
+ * file.Read(data::SectionedBinary::kLabels, &labels);
+ * \endcode
+ */
+class SectionedBinary {
+ public:
+  /*! \brief the sections, their ids are part of the format */
+  enum Section {
+    kRowPtr = 0,
+    kRowData = 1,
+    kLabels = 2,
+    kGroupPtr = 3,
+    kWeights = 4,
+    kRootIndex = 5,
+    kBaseMargin = 6,
+    kNumSections = 7
+  };
+  /*! \brief encoding of a section */
+  enum Codec {
+    kRaw = 0,
+    kDeltaVarint = 1
+  };
+  /*! \brief magic number used to identify the format */
+  static const int kMagic = 0xffffab05;
+  /*! \brief default bytes of a chunk */
+  static const size_t kChunkBytes = 8 << 20;
+  /*!
+   * \brief read the header and the section table of uri.
+   * \param uri The file, any stream supporting seek.
+   */
+  explicit SectionedBinary(const std::string& uri);
+  /*!
+   * \brief save the content of a SimpleCSRSource in the sectioned format.
+   * \param src The data to save.
+   * \param fo The output stream.
+   * \param compress Whether to delta code the row and group pointers.
+   * \param chunk_bytes The bytes of a checksummed chunk.
+   */
+  static void Save(const SimpleCSRSource& src, dmlc::Stream* fo, bool compress,
+                   size_t chunk_bytes = kChunkBytes);
+  /*! \return the number of elements of section s */
+  size_t Length(Section s) const {
+    return table_[s].length;
+  }
+  /*!
+   * \brief read one section.
+   * \param s The section.
+   * \param out The elements of the section, resized to its length.
+   * \param nthread The number of streams reading it, 0 for the default.
+   */
+  template<typename T>
+  void Read(Section s, std::vector<T>* out, int nthread = 0) {
+    std::vector<Request> requests;
+    this->AddRequest(s, out, &requests);
+    this->ReadSections(requests, nthread);
+  }
+  /*!
+   * \brief read all the sections into a SimpleCSRSource.
+   * \param out The source, its rows and meta info are replaced.
+   * \param nthread The number of streams reading the file, 0 for the default.
+   */
+  void ReadAll(SimpleCSRSource* out, int nthread = 0);
+
+ private:
+  /*! \brief a section to read and its destination */
+  struct Request {
+    Section section;
+    void* dst;
+    Request(Section section, void* dst) : section(section), dst(dst) {}
+  };
+  /*! \brief entry of the section table */
+  struct TableEntry {
+    uint32_t id;
+    uint32_t codec;
+    uint64_t elem_size;
+    uint64_t length;
+    uint64_t offset;
+    uint64_t stored_bytes;
+  };
+  /*! \brief resize out to section s and request its content */
+  template<typename T>
+  void AddRequest(Section s, std::vector<T>* out, std::vector<Request>* requests) {
+    out->resize(table_[s].length);
+    if (out->size() == 0) return;
+    CHECK_EQ(table_[s].elem_size, sizeof(T)) << "SectionedBinary: wrong element type";
+    requests->emplace_back(s, dmlc::BeginPtr(*out));
+  }
+  /*! \brief read the requested sections, all the chunks in parallel */
+  void ReadSections(const std::vector<Request>& requests, int nthread);
+  /*! \brief the file */
+  std::string uri_;
+  /*! \brief shape of the matrix */
+  uint64_t num_row_, num_col_, num_nonzero_;
+  /*! \brief bytes of a chunk */
+  uint64_t chunk_bytes_;
+  /*! \brief the sections, indexed by id */
+  std::vector<TableEntry> table_;
+  /*! \brief CRC32 of the chunks of each section */
+  std::vector<std::vector<uint32_t> > checksums_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_SECTIONED_BINARY_H_
@@ -3,7 +3,9 @@
  * \file simple_csr_source.cc
  */
 #include <dmlc/base.h>
+#include <dmlc/omp.h>
 #include <xgboost/logging.h>
+#include <algorithm>
 #include "./simple_csr_source.h"
 
 namespace xgboost {
@@ -34,33 +36,48 @@ void SimpleCSRSource::CopyFrom(DMatrix* src) {
 void SimpleCSRSource::CopyFrom(dmlc::Parser<uint32_t>* parser) {
   this->Clear();
   while (parser->Next()) {
-    const dmlc::RowBlock<uint32_t>& batch = parser->Value();
-    if (batch.label != nullptr) {
-      info.labels.insert(info.labels.end(), batch.label, batch.label + batch.size);
-    }
-    if (batch.weight != nullptr) {
-      info.weights.insert(info.weights.end(), batch.weight, batch.weight + batch.size);
-    }
-    // Remove the assertion on batch.index, which can be null in the case that the data in this
-    // batch is entirely sparse. Although it's true that this indicates a likely issue with the
-    // user's data workflows, passing XGBoost entirely sparse data should not cause it to fail.
-    // See https://github.com/dmlc/xgboost/issues/1827 for complete detail.
-    // CHECK(batch.index != nullptr);
+    this->Push(parser->Value());
+  }
+}
 
-    // update information
-    this->info.num_row += batch.size;
-    // copy the data over
-    for (size_t i = batch.offset[0]; i < batch.offset[batch.size]; ++i) {
-      uint32_t index = batch.index[i];
-      bst_float fvalue = batch.value == nullptr ? 1.0f : batch.value[i];
-      row_data_.push_back(SparseBatch::Entry(index, fvalue));
-      this->info.num_col = std::max(this->info.num_col,
-                                    static_cast<uint64_t>(index + 1));
-    }
-    size_t top = row_ptr_.size();
-    for (size_t i = 0; i < batch.size; ++i) {
-      row_ptr_.push_back(row_ptr_[top - 1] + batch.offset[i + 1] - batch.offset[0]);
+void SimpleCSRSource::Push(const dmlc::RowBlock<uint32_t>& batch) {
+  if (batch.label != nullptr) {
+    info.labels.insert(info.labels.end(), batch.label, batch.label + batch.size);
+  }
+  if (batch.weight != nullptr) {
+    info.weights.insert(info.weights.end(), batch.weight, batch.weight + batch.size);
+  }
+  // Remove the assertion on batch.index, which can be null in the case that the data in this
+  // batch is entirely sparse. Although it's true that this indicates a likely issue with the
+  // user's data workflows, passing XGBoost entirely sparse data should not cause it to fail.
+  // See https://github.com/dmlc/xgboost/issues/1827 for complete detail.
+  // CHECK(batch.index != nullptr);
+
+  // update information
+  this->info.num_row += batch.size;
+  // copy the data over
+  const size_t begin = batch.offset[0];
+  const size_t top_data = row_data_.size();
+  const omp_ulong nentry = static_cast<omp_ulong>(batch.offset[batch.size] - begin);
+  row_data_.resize(top_data + nentry);
+  uint64_t num_col = this->info.num_col;
+  #pragma omp parallel
+  {
+    uint64_t max_col = 0;
+    #pragma omp for schedule(static)
+    for (omp_ulong i = 0; i < nentry; ++i) {
+      uint32_t index = batch.index[begin + i];
+      bst_float fvalue = batch.value == nullptr ? 1.0f : batch.value[begin + i];
+      row_data_[top_data + i] = SparseBatch::Entry(index, fvalue);
+      max_col = std::max(max_col, static_cast<uint64_t>(index + 1));
     }
+    #pragma omp critical
+    num_col = std::max(num_col, max_col);
+  }
+  this->info.num_col = num_col;
+  size_t top = row_ptr_.size();
+  for (size_t i = 0; i < batch.size; ++i) {
+    row_ptr_.push_back(row_ptr_[top - 1] + batch.offset[i + 1] - batch.offset[0]);
   }
   this->info.num_nonzero = static_cast<uint64_t>(row_data_.size());
 }
@@ -51,6 +51,11 @@ class SimpleCSRSource : public DataSource {
    * \param info The additional information reflected in the parser.
    */
   void CopyFrom(dmlc::Parser<uint32_t>* src);
+  /*!
+   * \brief append the rows of a block of a parser, with their labels and weights.
+   * \param batch the block, it can be reused by the parser once Push returns.
+   */
+  void Push(const dmlc::RowBlock<uint32_t>& batch);
   /*!
    * \brief Load data from binary stream.
    * \param fi the pointer to load data from.
@@ -9,8 +9,11 @@
 #include <algorithm>
 #include <vector>
 #include "./simple_dmatrix.h"
+#include "./simple_csr_source.h"
+#include "./columnar_source.h"
 #include "../common/random.h"
 #include "../common/group_data.h"
+#include "../common/radix_sort.h"
 
 namespace xgboost {
 namespace data {
@@ -56,17 +59,29 @@ void SimpleDMatrix::InitColAccess(const std::vector<bool> &enabled,
                                   float pkeep,
                                   size_t max_row_perbatch, bool sorted) {
   if (this->HaveColAccess(sorted)) return;
+  if (col_size_.size() != 0 && enabled == col_enabled_ && pkeep == col_pkeep_) {
+    // the columns of the same rows are there already, only sort them
+    for (auto& page : col_iter_.cpages_) {
+      common::SortGroupsByValue(page->offset, &page->data, omp_get_max_threads());
+    }
+    col_iter_.sorted = true;
+    return;
+  }
   col_iter_.sorted = sorted;
+  col_enabled_ = enabled;
+  col_pkeep_ = pkeep;
   col_iter_.cpages_.clear();
-    std::cout << "SimpleDMatrix::InitColAccess::max_row_perbatch= " << max_row_perbatch << std::endl;
-    std::cout << "SimpleDMatrix::InitColAccess::info::num_row = " << info().num_row << std::endl;
-  if (info().num_row < max_row_perbatch) {
-    std::cout << "SimpleDMatrix::InitColAccess make one batch"<< std::endl;
+  const ColumnarSource* columnar = dynamic_cast<const ColumnarSource*>(source_.get());
+  if (columnar != nullptr && pkeep == 1.0f && info().num_row < max_row_perbatch) {
+    // the source is column oriented already, no need to transpose the rows
+    std::unique_ptr<SparsePage> page(new SparsePage());
+    this->MakeColumnarBatch(*columnar, enabled, page.get(), sorted);
+    col_iter_.cpages_.push_back(std::move(page));
+  } else if (info().num_row < max_row_perbatch) {
     std::unique_ptr<SparsePage> page(new SparsePage());
     this->MakeOneBatch(enabled, pkeep, page.get(), sorted);
     col_iter_.cpages_.push_back(std::move(page));
   } else {
-    std::cout << "SimpleDMatrix::InitColAccess make many batch"<< std::endl;
     this->MakeManyBatch(enabled, pkeep, max_row_perbatch, sorted);
   }
   // setup col-size
@@ -78,20 +93,29 @@ void SimpleDMatrix::InitColAccess(const std::vector<bool> &enabled,
       col_size_[j] += pcol->offset[j + 1] - pcol->offset[j];
     }
   }
+  this->UpdateMemory();
 }
 
 // internal function to make one batch from row iter.
+// The rows are transposed in tiles of kRowTile rows. When the rows of a batch
+// have increasing indices, each tile is scattered one block of kColBlock
+// columns at a time so the columns written stay in cache on wide data.
 void SimpleDMatrix::MakeOneBatch(const std::vector<bool>& enabled, float pkeep,
                                  SparsePage* pcol, bool sorted) {
+  const size_t kRowTile = 1024;
+  const size_t kColBlock = 2048;
   // clear rowset
   buffered_rowset_.clear();
   // bit map
   const int nthread = omp_get_max_threads();
+  const size_t ncol = info().num_col;
   std::vector<bool> bmap;
+  // whether the rows of each batch have increasing indices
+  std::vector<bool> increasing;
   pcol->Clear();
   common::ParallelGroupBuilder<SparseBatch::Entry>
       builder(&pcol->offset, &pcol->data);
-  builder.InitBudget(info().num_col, nthread);
+  builder.InitBudget(ncol, nthread);
   // start working
   dmlc::DataIter<RowBatch>* iter = this->RowIterator();
   iter->BeforeFirst();
@@ -107,39 +131,60 @@ void SimpleDMatrix::MakeOneBatch(const std::vector<bool>& enabled, float pkeep,
       if (pkeep == 1.0f || coin_flip(rnd)) {
         buffered_rowset_.push_back(ridx);
       } else {
-        bmap[i] = false;
+        bmap[ridx] = false;
       }
     }
-    #pragma omp parallel for schedule(static)
-    for (long i = 0; i < batch_size; ++i) { // NOLINT(*)
+    const bst_omp_uint ntile =
+        static_cast<bst_omp_uint>((batch.size + kRowTile - 1) / kRowTile);
+    bool unordered = false;
+    #pragma omp parallel for schedule(static) num_threads(nthread) reduction(||:unordered)
+    for (bst_omp_uint t = 0; t < ntile; ++t) {
       int tid = omp_get_thread_num();
-      bst_uint ridx = static_cast<bst_uint>(batch.base_rowid + i);
-      if (bmap[ridx]) {
+      const size_t end = std::min(batch.size, (t + 1) * kRowTile);
+      for (size_t i = t * kRowTile; i < end; ++i) {
+        if (!bmap[batch.base_rowid + i]) continue;
         RowBatch::Inst inst = batch[i];
         for (bst_uint j = 0; j < inst.length; ++j) {
+          if (j != 0 && inst[j].index <= inst[j - 1].index) unordered = true;
           if (enabled[inst[j].index]) {
             builder.AddBudget(inst[j].index, tid);
           }
         }
       }
     }
+    increasing.push_back(!unordered);
   }
   builder.InitStorage();
 
   iter->BeforeFirst();
+  size_t batch_id = 0;
   while (iter->Next()) {
     const RowBatch& batch = iter->Value();
-    #pragma omp parallel for schedule(static)
-    for (long i = 0; i < static_cast<long>(batch.size); ++i) { // NOLINT(*)
+    const size_t nblock = increasing[batch_id++] ? (ncol + kColBlock - 1) / kColBlock : 1;
+    const bst_omp_uint ntile =
+        static_cast<bst_omp_uint>((batch.size + kRowTile - 1) / kRowTile);
+    // the tiles go to the threads as in the budget pass
+    #pragma omp parallel num_threads(nthread)
+    {
       int tid = omp_get_thread_num();
-      bst_uint ridx = static_cast<bst_uint>(batch.base_rowid + i);
-      if (bmap[ridx]) {
-        RowBatch::Inst inst = batch[i];
-        for (bst_uint j = 0; j < inst.length; ++j) {
-          if (enabled[inst[j].index]) {
-            builder.Push(inst[j].index,
-                         SparseBatch::Entry((bst_uint)(batch.base_rowid+i),
-                                            inst[j].fvalue), tid);
+      std::vector<bst_uint> cursor(kRowTile);
+      #pragma omp for schedule(static)
+      for (bst_omp_uint t = 0; t < ntile; ++t) {
+        const size_t begin = t * kRowTile;
+        const size_t end = std::min(batch.size, begin + kRowTile);
+        std::fill(cursor.begin(), cursor.end(), 0);
+        for (size_t b = 0; b < nblock; ++b) {
+          const size_t col_end = nblock == 1 ? ncol : std::min(ncol, (b + 1) * kColBlock);
+          for (size_t i = begin; i < end; ++i) {
+            const bst_uint ridx = static_cast<bst_uint>(batch.base_rowid + i);
+            if (!bmap[ridx]) continue;
+            RowBatch::Inst inst = batch[i];
+            bst_uint& j = cursor[i - begin];
+            for (; j < inst.length && inst[j].index < col_end; ++j) {
+              if (enabled[inst[j].index]) {
+                builder.Push(inst[j].index, SparseBatch::Entry(ridx, inst[j].fvalue), tid);
+              }
+            }
           }
         }
       }
@@ -149,17 +194,36 @@ void SimpleDMatrix::MakeOneBatch(const std::vector<bool>& enabled, float pkeep,
   CHECK_EQ(pcol->Size(), info().num_col);
 
   if (sorted) {
-    // sort columns
-    bst_omp_uint ncol = static_cast<bst_omp_uint>(pcol->Size());
-#pragma omp parallel for schedule(dynamic, 1) num_threads(nthread)
-    for (bst_omp_uint i = 0; i < ncol; ++i) {
-      if (pcol->offset[i] < pcol->offset[i + 1]) {
-        std::sort(dmlc::BeginPtr(pcol->data) + pcol->offset[i],
-          dmlc::BeginPtr(pcol->data) + pcol->offset[i + 1],
-          SparseBatch::Entry::CmpValue);
-      }
+    common::SortGroupsByValue(pcol->offset, &pcol->data, nthread);
+  }
+}
+
+void SimpleDMatrix::MakeColumnarBatch(const ColumnarSource& source,
+                                      const std::vector<bool>& enabled,
+                                      SparsePage* pcol, bool sorted) {
+  buffered_rowset_.clear();
+  for (size_t i = 0; i < info().num_row; ++i) {
+    buffered_rowset_.push_back(static_cast<bst_uint>(i));
+  }
+  const bst_omp_uint ncol = static_cast<bst_omp_uint>(info().num_col);
+  pcol->Clear();
+  pcol->offset.resize(ncol + 1);
+  for (bst_omp_uint i = 0; i < ncol; ++i) {
+    const size_t length = enabled[i] ? source.col_ptr_[i + 1] - source.col_ptr_[i] : 0;
+    pcol->offset[i + 1] = pcol->offset[i] + length;
+  }
+  pcol->data.resize(pcol->offset.back());
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (bst_omp_uint i = 0; i < ncol; ++i) {
+    if (pcol->offset[i] < pcol->offset[i + 1]) {
+      std::copy(source.col_data_.begin() + source.col_ptr_[i],
+                source.col_data_.begin() + source.col_ptr_[i + 1],
+                pcol->data.begin() + pcol->offset[i]);
     }
   }
+  if (sorted) {
+    common::SortGroupsByValue(pcol->offset, &pcol->data, omp_get_max_threads());
+  }
 }
 
 void SimpleDMatrix::MakeManyBatch(const std::vector<bool>& enabled,
@@ -229,29 +293,121 @@ void SimpleDMatrix::MakeColPage(const RowBatch& batch,
     RowBatch::Inst inst = batch[i];
     for (bst_uint j = 0; j < inst.length; ++j) {
       const SparseBatch::Entry &e = inst[j];
-      builder.Push(
-          e.index,
-          SparseBatch::Entry(buffered_rowset_[i + buffer_begin], e.fvalue),
-          tid);
+      if (enabled[e.index]) {
+        builder.Push(
+            e.index,
+            SparseBatch::Entry(buffered_rowset_[i + buffer_begin], e.fvalue),
+            tid);
+      }
     }
   }
   CHECK_EQ(pcol->Size(), info().num_col);
   // sort columns
   if (sorted) {
-    bst_omp_uint ncol = static_cast<bst_omp_uint>(pcol->Size());
-#pragma omp parallel for schedule(dynamic, 1) num_threads(nthread)
-    for (bst_omp_uint i = 0; i < ncol; ++i) {
-      if (pcol->offset[i] < pcol->offset[i + 1]) {
-        std::sort(dmlc::BeginPtr(pcol->data) + pcol->offset[i],
-          dmlc::BeginPtr(pcol->data) + pcol->offset[i + 1],
-          SparseBatch::Entry::CmpValue);
-      }
-    }
+    common::SortGroupsByValue(pcol->offset, &pcol->data, nthread);
   }
 }
 
 bool SimpleDMatrix::SingleColBlock() const {
   return col_iter_.cpages_.size() <= 1;
 }
+
+void SimpleDMatrix::Append(DMatrix* other) {
+  CHECK(other != this) << "Append: cannot append a matrix to itself";
+  SimpleCSRSource* csr = dynamic_cast<SimpleCSRSource*>(source_.get());
+  if (csr == nullptr) {
+    std::unique_ptr<SimpleCSRSource> copy(new SimpleCSRSource());
+    copy->CopyFrom(this);
+    csr = copy.get();
+    source_ = std::move(copy);
+  }
+  const size_t nrow = csr->row_ptr_.size() - 1;
+  CHECK_EQ(nrow, info().num_row);
+  dmlc::DataIter<RowBatch>* iter = other->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const RowBatch &batch = iter->Value();
+    for (size_t i = 0; i < batch.size; ++i) {
+      RowBatch::Inst inst = batch[i];
+      csr->row_data_.insert(csr->row_data_.end(), inst.data, inst.data + inst.length);
+      csr->row_ptr_.push_back(csr->row_ptr_.back() + inst.length);
+    }
+  }
+  this->info().Append(other->info());
+  CHECK_EQ(csr->row_ptr_.size() - 1, info().num_row)
+      << "Append: the number of rows does not match the meta info";
+  if (col_size_.size() != 0) {
+    RowBatch batch;
+    batch.base_rowid = nrow;
+    batch.size = info().num_row - nrow;
+    batch.ind_ptr = dmlc::BeginPtr(csr->row_ptr_) + nrow;
+    batch.data_ptr = dmlc::BeginPtr(csr->row_data_);
+    this->AppendColumns(batch);
+  }
+  this->UpdateMemory();
+}
+
+void SimpleDMatrix::UpdateMemory() {
+  size_t row_bytes = 0;
+  source_->BeforeFirst();
+  while (source_->Next()) {
+    const RowBatch& batch = source_->Value();
+    row_bytes += (batch.size + 1) * sizeof(size_t) +
+        (batch.ind_ptr[batch.size] - batch.ind_ptr[0]) * sizeof(RowBatch::Entry);
+  }
+  source_->BeforeFirst();
+  row_memory_.Set(row_bytes);
+  size_t col_bytes = 0;
+  for (const auto& page : col_iter_.cpages_) col_bytes += page->MemCostBytes();
+  col_memory_.Set(col_bytes);
+}
+
+void SimpleDMatrix::AppendColumns(const RowBatch& batch) {
+  const size_t ncol = info().num_col;
+  col_enabled_.resize(ncol, true);
+  // the pages of the previous rows get empty columns for the new features
+  for (auto& page : col_iter_.cpages_) {
+    page->offset.resize(ncol + 1, page->offset.back());
+  }
+  col_size_.resize(ncol, 0);
+  const size_t buffer_begin = buffered_rowset_.size();
+  for (size_t i = 0; i < batch.size; ++i) {
+    buffered_rowset_.push_back(static_cast<bst_uint>(batch.base_rowid + i));
+  }
+  std::unique_ptr<SparsePage> page(new SparsePage());
+  this->MakeColPage(batch, buffer_begin, col_enabled_, page.get(), col_iter_.sorted);
+  for (size_t i = 0; i < ncol; ++i) {
+    col_size_[i] += page->offset[i + 1] - page->offset[i];
+  }
+  if (col_iter_.cpages_.size() != 1) {
+    col_iter_.cpages_.push_back(std::move(page));
+    return;
+  }
+  // merge into the single page, the appended rows of a column come after
+  // the previous ones and are merged by value when the columns are sorted.
+  SparsePage* pcol = col_iter_.cpages_[0].get();
+  SparsePage merged;
+  merged.offset.resize(ncol + 1);
+  for (size_t i = 0; i < ncol; ++i) {
+    merged.offset[i + 1] = merged.offset[i] + (pcol->offset[i + 1] - pcol->offset[i]) +
+        (page->offset[i + 1] - page->offset[i]);
+  }
+  merged.data.resize(merged.offset.back());
+  const bool sorted = col_iter_.sorted;
+  const bst_omp_uint nsize = static_cast<bst_omp_uint>(ncol);
+  #pragma omp parallel for schedule(dynamic, 256)
+  for (bst_omp_uint i = 0; i < nsize; ++i) {
+    auto out = merged.data.begin() + merged.offset[i];
+    auto mid = std::copy(pcol->data.begin() + pcol->offset[i],
+                         pcol->data.begin() + pcol->offset[i + 1], out);
+    auto end = std::copy(page->data.begin() + page->offset[i],
+                         page->data.begin() + page->offset[i + 1], mid);
+    if (sorted && out != mid && mid != end) {
+      std::inplace_merge(out, mid, end, SparseBatch::Entry::CmpValue);
+    }
+  }
+  pcol->offset.swap(merged.offset);
+  pcol->data.swap(merged.data);
+}
 }  // namespace data
 }  // namespace xgboost
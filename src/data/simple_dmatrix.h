@@ -13,14 +13,19 @@
 #include <algorithm>
 #include <cstring>
 #include "./sparse_batch_page.h"
+#include "../common/memory_tracker.h"
 
 namespace xgboost {
 namespace data {
 
+class ColumnarSource;
+
 class SimpleDMatrix : public DMatrix {
  public:
   explicit SimpleDMatrix(std::unique_ptr<DataSource>&& source)
-      : source_(std::move(source)) {}
+      : source_(std::move(source)), col_pkeep_(1.0f) {
+    this->UpdateMemory();
+  }
 
   MetaInfo& info() override {
     return source_->info;
@@ -30,6 +35,11 @@ class SimpleDMatrix : public DMatrix {
     return source_->info;
   }
 
+  /*! \brief the source of the rows */
+  const DataSource* source() const {
+    return source_.get();
+  }
+
   dmlc::DataIter<RowBatch>* RowIterator() override {
     dmlc::DataIter<RowBatch>* iter = source_.get();
     iter->BeforeFirst();
@@ -37,7 +47,8 @@ class SimpleDMatrix : public DMatrix {
   }
 
   bool HaveColAccess(bool sorted) const override {
-    return col_size_.size() != 0 && col_iter_.sorted == sorted;
+    // sorted columns also serve the unsorted access
+    return col_size_.size() != 0 && (col_iter_.sorted || !sorted);
   }
 
   const RowSet& buffered_rowset() const override {
@@ -63,6 +74,14 @@ class SimpleDMatrix : public DMatrix {
 
   bool SingleColBlock() const override;
 
+  /*!
+   * \brief Append the rows of other, the rows are copied into a CSR source
+   *  first when the source is not one. All the appended rows are buffered in
+   *  the column access, their columns are merged into the last column page
+   *  when there is a single page and form a new page otherwise.
+   */
+  void Append(DMatrix* other) override;
+
  private:
   // in-memory column batch iterator.
   struct ColBatchIter: dmlc::DataIter<ColBatch> {
@@ -101,12 +120,24 @@ class SimpleDMatrix : public DMatrix {
   RowSet buffered_rowset_;
   /*! \brief sizeof column data */
   std::vector<size_t> col_size_;
+  /*! \brief features enabled in the column access */
+  std::vector<bool> col_enabled_;
+  /*! \brief probability of a row to be kept in the column access */
+  float col_pkeep_;
+  /*! \brief bytes of the rows of the source and of the column pages */
+  common::TrackedBytes row_memory_{"DMatrix.rows"};
+  common::TrackedBytes col_memory_{"DMatrix.columns"};
 
   // internal function to make one batch from row iter.
   void MakeOneBatch(const std::vector<bool>& enabled,
                     float pkeep,
                     SparsePage *pcol, bool sorted);
 
+  // copy the columns of a column oriented source into one batch.
+  void MakeColumnarBatch(const ColumnarSource& source,
+                         const std::vector<bool>& enabled,
+                         SparsePage* pcol, bool sorted);
+
   void MakeManyBatch(const std::vector<bool>& enabled,
                      float pkeep,
                      size_t max_row_perbatch, bool sorted);
@@ -115,6 +146,12 @@ class SimpleDMatrix : public DMatrix {
                    size_t buffer_begin,
                    const std::vector<bool>& enabled,
                    SparsePage* pcol, bool sorted);
+
+  // add the columns of the appended rows to the column access.
+  void AppendColumns(const RowBatch& batch);
+
+  // record the bytes of the rows and the columns in the memory tracker.
+  void UpdateMemory();
 };
 }  // namespace data
 }  // namespace xgboost
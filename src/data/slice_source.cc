@@ -0,0 +1,141 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file slice_source.cc
+ */
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <utility>
+#include "./slice_source.h"
+
+namespace xgboost {
+namespace data {
+namespace {
+// subset a per row meta information vector, k values per row
+template <typename T>
+void SliceInfo(const std::vector<T>& src, const std::vector<bst_uint>& ridx,
+               size_t num_row, std::vector<T>* out) {
+  out->clear();
+  if (src.size() == 0) return;
+  CHECK_EQ(src.size() % num_row, 0U) << "SliceSource: invalid meta information";
+  const size_t k = src.size() / num_row;
+  out->resize(ridx.size() * k);
+  for (size_t i = 0; i < ridx.size(); ++i) {
+    std::copy(src.begin() + ridx[i] * k, src.begin() + (ridx[i] + 1) * k,
+              out->begin() + i * k);
+  }
+}
+
+// positions of [begin, end) in ridx, ordered by their row in the parent
+std::vector<size_t> SortedPositions(const std::vector<bst_uint>& ridx,
+                                    size_t begin, size_t end) {
+  std::vector<size_t> order(end - begin);
+  std::iota(order.begin(), order.end(), begin);
+  std::stable_sort(order.begin(), order.end(),
+                   [&ridx](size_t a, size_t b) { return ridx[a] < ridx[b]; });
+  return order;
+}
+}  // namespace
+
+SliceSource::SliceSource(std::shared_ptr<DMatrix> parent,
+                         std::vector<bst_uint> ridx, size_t block_rows)
+    : parent_(std::move(parent)), ridx_(std::move(ridx)),
+      block_rows_(block_rows), row_begin_(0) {
+  CHECK_GT(block_rows_, 0U);
+  const MetaInfo& src = parent_->info();
+  for (bst_uint r : ridx_) {
+    CHECK_LT(r, src.num_row) << "SliceSource: row index out of range";
+  }
+  info.num_row = ridx_.size();
+  info.num_col = src.num_col;
+  SliceInfo(src.labels, ridx_, src.num_row, &info.labels);
+  SliceInfo(src.weights, ridx_, src.num_row, &info.weights);
+  SliceInfo(src.root_index, ridx_, src.num_row, &info.root_index);
+  SliceInfo(src.base_margin, ridx_, src.num_row, &info.base_margin);
+  // consecutive rows from the same group of the parent form a group
+  if (src.group_ptr.size() != 0) {
+    info.group_ptr.push_back(0);
+    size_t last = 0;
+    for (size_t i = 0; i < ridx_.size(); ++i) {
+      size_t gid = std::upper_bound(src.group_ptr.begin(), src.group_ptr.end(),
+                                    ridx_[i]) - src.group_ptr.begin() - 1;
+      if (i != 0 && gid != last) {
+        info.group_ptr.push_back(static_cast<bst_uint>(i));
+      }
+      last = gid;
+    }
+    if (ridx_.size() != 0) {
+      info.group_ptr.push_back(static_cast<bst_uint>(ridx_.size()));
+    }
+  }
+  // count the entries of the slice with one pass over the parent
+  std::vector<size_t> order = SortedPositions(ridx_, 0, ridx_.size());
+  dmlc::DataIter<RowBatch>* iter = parent_->RowIterator();
+  iter->BeforeFirst();
+  size_t k = 0;
+  while (k < order.size() && iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    for (; k < order.size() && ridx_[order[k]] < batch.base_rowid + batch.size; ++k) {
+      info.num_nonzero += batch[ridx_[order[k]] - batch.base_rowid].length;
+    }
+  }
+}
+
+bool SliceSource::Next() {
+  if (row_begin_ >= ridx_.size()) return false;
+  const size_t row_end = std::min(ridx_.size(), row_begin_ + block_rows_);
+  const size_t nrow = row_end - row_begin_;
+  // gather the rows of the block in the order of the parent
+  std::vector<size_t> order = SortedPositions(ridx_, row_begin_, row_end);
+  std::vector<size_t> staged_ptr(nrow + 1, 0);
+  std::vector<RowBatch::Entry> staged;
+  row_ptr_.resize(nrow + 1);
+  row_ptr_[0] = 0;
+  dmlc::DataIter<RowBatch>* iter = parent_->RowIterator();
+  iter->BeforeFirst();
+  size_t k = 0;
+  while (k < nrow && iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    for (; k < nrow && ridx_[order[k]] < batch.base_rowid + batch.size; ++k) {
+      RowBatch::Inst inst = batch[ridx_[order[k]] - batch.base_rowid];
+      staged.insert(staged.end(), inst.data, inst.data + inst.length);
+      staged_ptr[k + 1] = staged.size();
+      row_ptr_[order[k] - row_begin_ + 1] = inst.length;
+    }
+  }
+  CHECK_EQ(k, nrow) << "SliceSource: the parent matrix has fewer rows than its info";
+  // lay the rows out in the order of the slice
+  for (size_t i = 0; i < nrow; ++i) {
+    row_ptr_[i + 1] += row_ptr_[i];
+  }
+  row_data_.resize(row_ptr_.back());
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < static_cast<omp_ulong>(nrow); ++i) {
+    const size_t pos = order[i] - row_begin_;
+    const size_t length = staged_ptr[i + 1] - staged_ptr[i];
+    if (length != 0) {
+      std::memcpy(dmlc::BeginPtr(row_data_) + row_ptr_[pos],
+                  dmlc::BeginPtr(staged) + staged_ptr[i],
+                  sizeof(RowBatch::Entry) * length);
+    }
+  }
+  batch_.size = nrow;
+  batch_.base_rowid = row_begin_;
+  batch_.ind_ptr = dmlc::BeginPtr(row_ptr_);
+  batch_.data_ptr = dmlc::BeginPtr(row_data_);
+  row_begin_ = row_end;
+  return true;
+}
+
+void SliceSource::BeforeFirst() {
+  row_begin_ = 0;
+}
+
+const RowBatch& SliceSource::Value() const {
+  return batch_;
+}
+
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,61 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file slice_source.h
+ * \brief Data source viewing a subset of the rows of another DMatrix.
+ */
+#ifndef XGBOOST_DATA_SLICE_SOURCE_H_
+#define XGBOOST_DATA_SLICE_SOURCE_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <memory>
+#include <vector>
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief Row data source over a list of rows of a parent DMatrix.
+ *  The rows are not copied up front, each call to Next gathers the next
+ *  block of the list with a single pass over the row batches of the parent,
+ *  so the parent can be in memory or external memory. The meta information
+ *  is subset when the source is created, a group partly in the slice keeps
+ *  the rows of it that were selected.
+ */
+class SliceSource : public DataSource {
+ public:
+  /*! \brief default number of rows gathered per batch */
+  static const size_t kBlockRows = 1 << 16;
+  /*!
+   * \brief create the slice.
+   * \param parent The matrix to slice, kept alive by the source.
+   * \param ridx The rows of the parent, in the order of the slice.
+   * \param block_rows The number of rows of each batch.
+   */
+  SliceSource(std::shared_ptr<DMatrix> parent, std::vector<bst_uint> ridx,
+              size_t block_rows = kBlockRows);
+  // implement Next
+  bool Next() override;
+  // implement BeforeFirst
+  void BeforeFirst() override;
+  // implement Value
+  const RowBatch &Value() const override;
+
+ private:
+  /*! \brief the sliced matrix */
+  std::shared_ptr<DMatrix> parent_;
+  /*! \brief rows of the parent */
+  std::vector<bst_uint> ridx_;
+  /*! \brief rows per batch */
+  size_t block_rows_;
+  /*! \brief first row of the next batch */
+  size_t row_begin_;
+  /*! \brief row pointer of the current batch */
+  std::vector<size_t> row_ptr_;
+  /*! \brief entries of the current batch */
+  std::vector<RowBatch::Entry> row_data_;
+  /*! \brief the current batch */
+  RowBatch batch_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_SLICE_SOURCE_H_
@@ -21,6 +21,7 @@
 
 #if DMLC_ENABLE_STD_THREAD
 #include <dmlc/concurrency.h>
+#include <mutex>
 #include <thread>
 #endif
 
@@ -183,6 +184,8 @@ class SparsePage::Format {
 #if DMLC_ENABLE_STD_THREAD
 /*!
  * \brief A threaded writer to write sparse batch page to sharded files.
+ *  The write time and written bytes are recorded in the profiler as
+ *  SparsePage::Writer.write and SparsePage::Writer.bytes.
  */
 class SparsePage::Writer {
  public:
@@ -205,10 +208,18 @@ class SparsePage::Writer {
    * \param page The page to be written
    */
   void PushWrite(std::shared_ptr<SparsePage>&& page);
+  /*!
+   * \brief Push a write job to a given shard.
+   *  The pages of a shard are written in the order they are pushed, so
+   *  several threads may each fill their own shard concurrently.
+   * \param page The page to be written
+   * \param shard The index of the shard file.
+   */
+  void PushWrite(std::shared_ptr<SparsePage>&& page, size_t shard);
   /*!
    * \brief Allocate a page to store results.
    *  This function can block when the writer is too slow and buffer pages
-   *  have not yet been recycled.
+   *  have not yet been recycled. It is safe to call from several threads.
    * \param out_page Used to store the allocated pages.
    */
   void Alloc(std::shared_ptr<SparsePage>* out_page);
@@ -216,6 +227,8 @@ class SparsePage::Writer {
  private:
   /*! \brief number of allocated pages */
   size_t num_free_buffer_;
+  /*! \brief guards num_free_buffer_ */
+  std::mutex alloc_mutex_;
   /*! \brief clock_pointer */
   size_t clock_ptr_;
   /*! \brief writer threads */
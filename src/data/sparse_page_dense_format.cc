@@ -0,0 +1,181 @@
+/*!
+ * Copyright (c) 2018 by Contributors
+ * \file sparse_page_dense_format.cc
+ *  Binary format of sparse page storing only the values of dense pages.
+ */
+#include <xgboost/data.h>
+#include <dmlc/registry.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "./sparse_batch_page.h"
+
+namespace xgboost {
+namespace data {
+
+DMLC_REGISTRY_FILE_TAG(sparse_page_dense_format);
+
+/*!
+ * \brief Format picking for each page the smallest of three layouts.
+ *  A page whose segments all hold the same contiguous range of indices is
+ *  stored as a matrix of values. When most of the range is present, the
+ *  values are stored as such a matrix plus a presence bitmap. Otherwise the
+ *  page is stored as in the raw format.
+ */
+class SparsePageDenseFormat : public SparsePage::Format {
+ public:
+  bool Read(SparsePage* page, dmlc::SeekStream* fi) override {
+    int32_t layout;
+    if (fi->Read(&layout, sizeof(layout)) == 0) return false;
+    if (layout == kSparse) {
+      CHECK(fi->Read(&(page->offset))) << "Invalid SparsePage file";
+      CHECK_NE(page->offset.size(), 0U) << "Invalid SparsePage file";
+      page->data.resize(page->offset.back());
+      this->ReadArray(fi, &(page->data));
+      return true;
+    }
+    CHECK(layout == kDense || layout == kMasked) << "Invalid SparsePage file";
+    uint64_t nseg, first, width;
+    CHECK_EQ(fi->Read(&nseg, sizeof(nseg)), sizeof(nseg)) << "Invalid SparsePage file";
+    CHECK_EQ(fi->Read(&first, sizeof(first)), sizeof(first)) << "Invalid SparsePage file";
+    CHECK_EQ(fi->Read(&width, sizeof(width)), sizeof(width)) << "Invalid SparsePage file";
+    value_.resize(nseg * width);
+    this->ReadArray(fi, &value_);
+    page->offset.resize(nseg + 1);
+    page->offset[0] = 0;
+    if (layout == kDense) {
+      page->data.resize(nseg * width);
+      for (size_t i = 0; i < nseg; ++i) {
+        page->offset[i + 1] = page->offset[i] + width;
+        for (size_t j = 0; j < width; ++j) {
+          page->data[i * width + j] = SparseBatch::Entry(
+              static_cast<bst_uint>(first + j), value_[i * width + j]);
+        }
+      }
+      return true;
+    }
+    mask_.resize((nseg * width + 7) / 8);
+    this->ReadArray(fi, &mask_);
+    page->data.clear();
+    for (size_t i = 0; i < nseg; ++i) {
+      for (size_t j = 0; j < width; ++j) {
+        const size_t k = i * width + j;
+        if ((mask_[k >> 3] >> (k & 7)) & 1) {
+          page->data.push_back(SparseBatch::Entry(
+              static_cast<bst_uint>(first + j), value_[k]));
+        }
+      }
+      page->offset[i + 1] = page->data.size();
+    }
+    return true;
+  }
+
+  bool Read(SparsePage* page,
+            dmlc::SeekStream* fi,
+            const std::vector<bst_uint>& sorted_index_set) override {
+    if (!this->Read(&tmp_, fi)) return false;
+    page->offset.clear();
+    page->offset.push_back(0);
+    for (bst_uint fid : sorted_index_set) {
+      CHECK_LT(fid + 1, tmp_.offset.size());
+      page->offset.push_back(
+          page->offset.back() + tmp_.offset[fid + 1] - tmp_.offset[fid]);
+    }
+    page->data.resize(page->offset.back());
+    for (size_t i = 0; i < sorted_index_set.size(); ++i) {
+      bst_uint fid = sorted_index_set[i];
+      std::copy(tmp_.data.begin() + tmp_.offset[fid],
+                tmp_.data.begin() + tmp_.offset[fid + 1],
+                page->data.begin() + page->offset[i]);
+    }
+    return true;
+  }
+
+  void Write(const SparsePage& page, dmlc::Stream* fo) override {
+    CHECK(page.offset.size() != 0 && page.offset[0] == 0);
+    CHECK_EQ(page.offset.back(), page.data.size());
+    const size_t nseg = page.offset.size() - 1;
+    // the range of indices, the dense layouts require strictly increasing
+    // indices within each segment.
+    bool increasing = true;
+    size_t first = std::numeric_limits<size_t>::max(), last = 0;
+    for (size_t i = 0; i < nseg && increasing; ++i) {
+      for (size_t j = page.offset[i]; j < page.offset[i + 1]; ++j) {
+        if (j != page.offset[i] && page.data[j].index <= page.data[j - 1].index) {
+          increasing = false;
+          break;
+        }
+      }
+      if (page.offset[i] != page.offset[i + 1]) {
+        first = std::min(first, static_cast<size_t>(page.data[page.offset[i]].index));
+        last = std::max(last, static_cast<size_t>(page.data[page.offset[i + 1] - 1].index));
+      }
+    }
+    const size_t nnz = page.data.size();
+    const size_t width = nnz == 0 ? 0 : last - first + 1;
+    int32_t layout = kSparse;
+    if (increasing && nnz != 0) {
+      const size_t sparse_bytes =
+          (nseg + 1) * sizeof(size_t) + nnz * sizeof(SparseBatch::Entry);
+      const size_t masked_bytes =
+          nseg * width * sizeof(bst_float) + (nseg * width + 7) / 8;
+      if (nnz == nseg * width) {
+        layout = kDense;
+      } else if (masked_bytes < sparse_bytes) {
+        layout = kMasked;
+      }
+    }
+    fo->Write(&layout, sizeof(layout));
+    if (layout == kSparse) {
+      fo->Write(page.offset);
+      if (nnz != 0) {
+        fo->Write(dmlc::BeginPtr(page.data), nnz * sizeof(SparseBatch::Entry));
+      }
+      return;
+    }
+    uint64_t header[3] = {nseg, first, width};
+    fo->Write(header, sizeof(header));
+    value_.assign(nseg * width, 0.0f);
+    if (layout == kMasked) mask_.assign((nseg * width + 7) / 8, 0);
+    for (size_t i = 0; i < nseg; ++i) {
+      for (size_t j = page.offset[i]; j < page.offset[i + 1]; ++j) {
+        const size_t k = i * width + page.data[j].index - first;
+        value_[k] = page.data[j].fvalue;
+        if (layout == kMasked) mask_[k >> 3] |= static_cast<uint8_t>(1 << (k & 7));
+      }
+    }
+    fo->Write(dmlc::BeginPtr(value_), value_.size() * sizeof(bst_float));
+    if (layout == kMasked) {
+      fo->Write(dmlc::BeginPtr(mask_), mask_.size());
+    }
+  }
+
+ private:
+  /*! \brief layout of a page */
+  enum Layout {
+    kSparse = 0,
+    kDense = 1,
+    kMasked = 2
+  };
+  template<typename T>
+  inline void ReadArray(dmlc::SeekStream* fi, std::vector<T>* out) {
+    if (out->size() == 0) return;
+    const size_t nbytes = out->size() * sizeof(T);
+    CHECK_EQ(fi->Read(dmlc::BeginPtr(*out), nbytes), nbytes)
+        << "Invalid SparsePage file";
+  }
+  /*! \brief values of a dense page */
+  std::vector<bst_float> value_;
+  /*! \brief presence bitmap of a masked page */
+  std::vector<uint8_t> mask_;
+  /*! \brief page read in full when reading a subset of the segments */
+  SparsePage tmp_;
+};
+
+XGBOOST_REGISTER_SPARSE_PAGE_FORMAT(dense)
+.describe("Binary data format storing only the values of dense pages.")
+.set_body([]() {
+    return new SparsePageDenseFormat();
+  });
+}  // namespace data
+}  // namespace xgboost
@@ -5,25 +5,30 @@
  * \author Tianqi Chen
  */
 #include <dmlc/base.h>
+#include <dmlc/parameter.h>
 #include <dmlc/timer.h>
 #include <xgboost/logging.h>
+#include <atomic>
 #include <memory>
+#include <thread>
 
 #if DMLC_ENABLE_STD_THREAD
 #include "./sparse_page_dmatrix.h"
 #include "../common/random.h"
 #include "../common/common.h"
 #include "../common/group_data.h"
+#include "../common/radix_sort.h"
+#include "../common/timer.h"
 
 namespace xgboost {
 namespace data {
 
 SparsePageDMatrix::ColPageIter::ColPageIter(
     std::vector<std::unique_ptr<dmlc::SeekStream> >&& files)
-    : page_(nullptr), clock_ptr_(0), files_(std::move(files)) {
+    : page_(nullptr), files_(std::move(files)) {
   load_all_ = false;
   formats_.resize(files_.size());
-  prefetchers_.resize(files_.size());
+  std::vector<PagePrefetcher::Shard> shards(files_.size());
 
   for (size_t i = 0; i < files_.size(); ++i) {
     dmlc::SeekStream* fi = files_[i].get();
@@ -32,35 +37,36 @@ SparsePageDMatrix::ColPageIter::ColPageIter(
     formats_[i].reset(SparsePage::Format::Create(format));
     SparsePage::Format* fmt = formats_[i].get();
     size_t fbegin = fi->Tell();
-    prefetchers_[i].reset(new dmlc::ThreadedIter<SparsePage>(4));
-    prefetchers_[i]->Init([this, fi, fmt] (SparsePage** dptr) {
-        if (*dptr == nullptr) {
-          *dptr = new SparsePage();
-        }
-        if (load_all_) {
-          return fmt->Read(*dptr, fi);
-        } else {
-          return fmt->Read(*dptr, fi, index_set_);
-        }
-      },  [this, fi, fbegin] () {
-        fi->Seek(fbegin);
-        index_set_ = set_index_set_;
-        load_all_ = set_load_all_;
-      });
+    shards[i].read = [this, fi, fmt] (SparsePage* page) {
+      if (load_all_) {
+        return fmt->Read(page, fi);
+      } else {
+        return fmt->Read(page, fi, index_set_);
+      }
+    };
+    shards[i].before_first = [this, fi, fbegin] () {
+      fi->Seek(fbegin);
+      index_set_ = set_index_set_;
+      load_all_ = set_load_all_;
+    };
   }
+  prefetcher_.reset(new PagePrefetcher(std::move(shards), "ColPageIter"));
 }
 
 SparsePageDMatrix::ColPageIter::~ColPageIter() {
   delete page_;
 }
 
+size_t SparsePageDMatrix::PageSize() {
+  return dmlc::GetEnv("XGBOOST_PAGE_SIZE_MB", kPageSize >> 20UL) << 20UL;
+}
+
 bool SparsePageDMatrix::ColPageIter::Next() {
-  // doing clock rotation over shards.
+  // the prefetcher does the clock rotation over shards.
   if (page_ != nullptr) {
-    size_t n = prefetchers_.size();
-    prefetchers_[(clock_ptr_ + n - 1) % n]->Recycle(&page_);
+    prefetcher_->Recycle(&page_);
   }
-  if (prefetchers_[clock_ptr_]->Next(&page_)) {
+  if (prefetcher_->Next(&page_)) {
     out_.col_index = dmlc::BeginPtr(index_set_);
     col_data_.resize(page_->offset.size() - 1, SparseBatch::Inst(nullptr, 0));
     for (size_t i = 0; i < col_data_.size(); ++i) {
@@ -70,8 +76,6 @@ bool SparsePageDMatrix::ColPageIter::Next() {
     }
     out_.col_data = dmlc::BeginPtr(col_data_);
     out_.size = col_data_.size();
-    // advance clock
-    clock_ptr_ = (clock_ptr_ + 1) % prefetchers_.size();
     return true;
   } else {
     return false;
@@ -79,10 +83,10 @@ bool SparsePageDMatrix::ColPageIter::Next() {
 }
 
 void SparsePageDMatrix::ColPageIter::BeforeFirst() {
-  clock_ptr_ = 0;
-  for (auto& p : prefetchers_) {
-    p->BeforeFirst();
+  if (page_ != nullptr) {
+    prefetcher_->Recycle(&page_);
   }
+  prefetcher_->BeforeFirst();
 }
 
 void SparsePageDMatrix::ColPageIter::Init(const std::vector<bst_uint>& index_set,
@@ -160,26 +164,42 @@ void SparsePageDMatrix::InitColAccess(const std::vector<bool>& enabled,
   dmlc::DataIter<RowBatch>* iter = this->RowIterator();
   std::bernoulli_distribution coin_flip(pkeep);
   size_t batch_ptr = 0, batch_top = 0;
-  SparsePage tmp;
+  const size_t page_size = PageSize();
   auto& rnd = common::GlobalRandom();
 
+  std::vector<std::string> cache_shards = common::Split(cache_info_, ':');
+  std::vector<std::string> name_shards, format_shards;
+  for (const std::string& prefix : cache_shards) {
+    name_shards.push_back(prefix + ".col.page");
+    format_shards.push_back(SparsePage::Format::DecideFormat(prefix).second);
+  }
+  // one transpose thread per shard, they share the OpenMP threads.
+  const size_t nshard = name_shards.size();
+  const int nthread = std::max(
+      std::max(omp_get_max_threads(), std::max(omp_get_num_procs() / 2 - 1, 1)) /
+      static_cast<int>(nshard), 1);
+
+  // the sampled rows of a column page.
+  struct RowPage {
+    SparsePage rows;
+    std::vector<bst_uint> ridx;
+  };
+
   // function to create the page.
   auto make_col_batch = [&] (
-      const SparsePage& prow,
-      size_t begin,
+      const RowPage& prow,
       SparsePage *pcol) {
     pcol->Clear();
-    pcol->min_index = buffered_rowset_[begin];
-    const int nthread = std::max(omp_get_max_threads(), std::max(omp_get_num_procs() / 2 - 1, 1));
+    pcol->min_index = prow.ridx[0];
     common::ParallelGroupBuilder<SparseBatch::Entry>
     builder(&pcol->offset, &pcol->data);
     builder.InitBudget(info.num_col, nthread);
-    bst_omp_uint ndata = static_cast<bst_uint>(prow.Size());
+    bst_omp_uint ndata = static_cast<bst_uint>(prow.rows.Size());
     #pragma omp parallel for schedule(static) num_threads(nthread)
     for (bst_omp_uint i = 0; i < ndata; ++i) {
       int tid = omp_get_thread_num();
-      for (size_t j = prow.offset[i]; j < prow.offset[i+1]; ++j) {
-        const SparseBatch::Entry &e = prow.data[j];
+      for (size_t j = prow.rows.offset[i]; j < prow.rows.offset[i+1]; ++j) {
+        const SparseBatch::Entry &e = prow.rows.data[j];
         if (enabled[e.index]) {
           builder.AddBudget(e.index, tid);
         }
@@ -189,31 +209,24 @@ void SparsePageDMatrix::InitColAccess(const std::vector<bool>& enabled,
     #pragma omp parallel for schedule(static) num_threads(nthread)
     for (bst_omp_uint i = 0; i < ndata; ++i) {
       int tid = omp_get_thread_num();
-      for (size_t j = prow.offset[i]; j < prow.offset[i+1]; ++j) {
-        const SparseBatch::Entry &e = prow.data[j];
+      for (size_t j = prow.rows.offset[i]; j < prow.rows.offset[i+1]; ++j) {
+        const SparseBatch::Entry &e = prow.rows.data[j];
         builder.Push(e.index,
-                     SparseBatch::Entry(buffered_rowset_[i + begin], e.fvalue),
+                     SparseBatch::Entry(prow.ridx[i], e.fvalue),
                      tid);
       }
     }
     CHECK_EQ(pcol->Size(), info.num_col);
     // sort columns
     if (sorted) {
-      bst_omp_uint ncol = static_cast<bst_omp_uint>(pcol->Size());
-#pragma omp parallel for schedule(dynamic, 1) num_threads(nthread)
-      for (bst_omp_uint i = 0; i < ncol; ++i) {
-        if (pcol->offset[i] < pcol->offset[i + 1]) {
-          std::sort(dmlc::BeginPtr(pcol->data) + pcol->offset[i],
-            dmlc::BeginPtr(pcol->data) + pcol->offset[i + 1],
-            SparseBatch::Entry::CmpValue);
-        }
-      }
+      common::SortGroupsByValue(pcol->offset, &pcol->data, nthread);
     }
   };
 
-  auto make_next_col = [&] (SparsePage* dptr) {
-    tmp.Clear();
-    size_t btop = buffered_rowset_.size();
+  // gather the sampled rows of the next page.
+  auto make_next_rows = [&] (RowPage* dptr) {
+    dptr->rows.Clear();
+    dptr->ridx.clear();
 
     while (true) {
       if (batch_ptr != batch_top) {
@@ -223,12 +236,12 @@ void SparsePageDMatrix::InitColAccess(const std::vector<bool>& enabled,
           bst_uint ridx = static_cast<bst_uint>(batch.base_rowid + i);
           if (pkeep == 1.0f || coin_flip(rnd)) {
             buffered_rowset_.push_back(ridx);
-            tmp.Push(batch[i]);
+            dptr->ridx.push_back(ridx);
+            dptr->rows.Push(batch[i]);
           }
 
-          if (tmp.Size() >= max_row_perbatch ||
-              tmp.MemCostBytes() >= kPageSize) {
-            make_col_batch(tmp, btop, dptr);
+          if (dptr->rows.Size() >= max_row_perbatch ||
+              dptr->rows.MemCostBytes() >= page_size) {
             batch_ptr = i + 1;
             return true;
           }
@@ -239,51 +252,77 @@ void SparsePageDMatrix::InitColAccess(const std::vector<bool>& enabled,
       batch_ptr = 0;
       batch_top = iter->Value().size;
     }
-
-    if (tmp.Size() != 0) {
-      make_col_batch(tmp, btop, dptr);
-      return true;
-    } else {
-      return false;
-    }
+    return dptr->rows.Size() != 0;
   };
 
-  std::vector<std::string> cache_shards = common::Split(cache_info_, ':');
-  std::vector<std::string> name_shards, format_shards;
-  for (const std::string& prefix : cache_shards) {
-    name_shards.push_back(prefix + ".col.page");
-    format_shards.push_back(SparsePage::Format::DecideFormat(prefix).second);
-  }
-
   {
     SparsePage::Writer writer(name_shards, format_shards, 6);
-    std::shared_ptr<SparsePage> page;
-    writer.Alloc(&page); page->Clear();
+    // the pages of rows go round the shards, the transpose thread of a shard
+    // pushes its column pages in order so the shard files keep clock order.
+    dmlc::ConcurrentBlockingQueue<std::shared_ptr<RowPage> > qfree;
+    std::vector<dmlc::ConcurrentBlockingQueue<std::shared_ptr<RowPage> > > qrows(nshard);
+    for (size_t i = 0; i < 2 * nshard; ++i) {
+      qfree.Push(std::make_shared<RowPage>());
+    }
+    std::vector<std::vector<size_t> > col_size(nshard);
+    std::atomic<size_t> bytes_write(0);
+    std::vector<std::thread> workers;
+    for (size_t s = 0; s < nshard; ++s) {
+      workers.emplace_back([&, s] () {
+        col_size[s].resize(info.num_col, 0);
+        std::shared_ptr<RowPage> prow;
+        while (qrows[s].Pop(&prow) && prow != nullptr) {
+          std::shared_ptr<SparsePage> page;
+          writer.Alloc(&page);
+          common::Timer timer;
+          make_col_batch(*prow, page.get());
+          timer.Stop();
+          common::Profiler::Get()->AddTime("SparsePageDMatrix.transpose",
+                                           timer.ElapsedSeconds());
+          for (size_t i = 0; i < page->Size(); ++i) {
+            col_size[s][i] += page->offset[i + 1] - page->offset[i];
+          }
+          bytes_write += page->MemCostBytes();
+          writer.PushWrite(std::move(page), s);
+          qfree.Push(std::move(prow));
+        }
+      });
+    }
 
     double tstart = dmlc::GetTime();
-    size_t bytes_write = 0;
     // print every 4 sec.
     const double kStep = 4.0;
     size_t tick_expected = kStep;
+    size_t clock_ptr = 0;
+    std::shared_ptr<RowPage> prow;
+    CHECK(qfree.Pop(&prow));
 
-    while (make_next_col(page.get())) {
-      for (size_t i = 0; i < page->Size(); ++i) {
-        col_size_[i] += page->offset[i + 1] - page->offset[i];
-      }
-
-      bytes_write += page->MemCostBytes();
-      writer.PushWrite(std::move(page));
-      writer.Alloc(&page);
-      page->Clear();
+    while (make_next_rows(prow.get())) {
+      common::Profiler::Get()->AddCount("SparsePageDMatrix.rows", prow->rows.Size());
+      qrows[clock_ptr].Push(std::move(prow));
+      clock_ptr = (clock_ptr + 1) % nshard;
+      CHECK(qfree.Pop(&prow));
 
       double tdiff = dmlc::GetTime() - tstart;
       if (tdiff >= tick_expected) {
         LOG(CONSOLE) << "Writing col.page file to " << cache_info_
                      << " in " << ((bytes_write >> 20UL) / tdiff) << " MB/s, "
-                     << (bytes_write >> 20UL) << " MB writen";
+                     << (bytes_write >> 20UL) << " MB writen, "
+                     << buffered_rowset_.size() << " rows read";
         tick_expected += kStep;
       }
     }
+    for (auto& q : qrows) {
+      q.Push(std::shared_ptr<RowPage>(nullptr));
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    for (size_t s = 0; s < nshard; ++s) {
+      for (size_t i = 0; i < col_size[s].size(); ++i) {
+        col_size_[i] += col_size[s][i];
+      }
+    }
     // save meta data
     std::string col_meta_name = cache_shards[0] + ".col.meta";
     std::unique_ptr<dmlc::Stream> fo(
@@ -9,11 +9,11 @@
 
 #include <xgboost/base.h>
 #include <xgboost/data.h>
-#include <dmlc/threadediter.h>
 #include <vector>
 #include <algorithm>
 #include <string>
 #include "./sparse_batch_page.h"
+#include "./page_prefetcher.h"
 #include "../common/common.h"
 
 namespace xgboost {
@@ -69,8 +69,13 @@ class SparsePageDMatrix : public DMatrix {
                      float subsample,
                      size_t max_row_perbatch, bool sorted) override;
 
-  /*! \brief page size 256 MB */
+  /*! \brief default page size 256 MB */
   static const size_t kPageSize = 256UL << 20UL;
+  /*!
+   * \brief size of the column pages written to the cache, set in MB by the
+   *  environment variable XGBOOST_PAGE_SIZE_MB.
+   */
+  static size_t PageSize();
   /*! \brief Maximum number of rows per batch. */
   static const size_t kMaxRowPerBatch = 64UL << 10UL;
 
@@ -93,14 +98,12 @@ class SparsePageDMatrix : public DMatrix {
    private:
     // the temp page.
     SparsePage* page_;
-    // internal clock ptr.
-    size_t clock_ptr_;
     // data file pointer.
     std::vector<std::unique_ptr<dmlc::SeekStream> > files_;
     // page format.
     std::vector<std::unique_ptr<SparsePage::Format> > formats_;
     /*! \brief internal prefetcher. */
-    std::vector<std::unique_ptr<dmlc::ThreadedIter<SparsePage> > > prefetchers_;
+    std::unique_ptr<PagePrefetcher> prefetcher_;
     // The index set to be loaded.
     std::vector<bst_uint> index_set_;
     // The index set by the outsiders
@@ -3,6 +3,7 @@
  * \file sparse_page_source.cc
  */
 #include <dmlc/base.h>
+#include <dmlc/parameter.h>
 #include <dmlc/timer.h>
 #include <xgboost/logging.h>
 #include <memory>
@@ -15,7 +16,7 @@ namespace xgboost {
 namespace data {
 
 SparsePageSource::SparsePageSource(const std::string& cache_info)
-    : base_rowid_(0), page_(nullptr), clock_ptr_(0) {
+    : base_rowid_(0), page_(nullptr) {
   // read in the info files
   std::vector<std::string> cache_shards = common::Split(cache_info, ':');
   CHECK_NE(cache_shards.size(), 0U);
@@ -28,7 +29,7 @@ SparsePageSource::SparsePageSource(const std::string& cache_info)
   }
   files_.resize(cache_shards.size());
   formats_.resize(cache_shards.size());
-  prefetchers_.resize(cache_shards.size());
+  std::vector<PagePrefetcher::Shard> shards(cache_shards.size());
 
   // read in the cache files.
   for (size_t i = 0; i < cache_shards.size(); ++i) {
@@ -40,31 +41,30 @@ SparsePageSource::SparsePageSource(const std::string& cache_info)
     formats_[i].reset(SparsePage::Format::Create(format));
     SparsePage::Format* fmt = formats_[i].get();
     size_t fbegin = fi->Tell();
-    prefetchers_[i].reset(new dmlc::ThreadedIter<SparsePage>(4));
-    prefetchers_[i]->Init([fi, fmt] (SparsePage** dptr) {
-        if (*dptr == nullptr) {
-          *dptr = new SparsePage();
-        }
-        return fmt->Read(*dptr, fi);
-      }, [fi, fbegin] () { fi->Seek(fbegin); });
+    shards[i].read = [fi, fmt] (SparsePage* page) {
+      return fmt->Read(page, fi);
+    };
+    shards[i].before_first = [fi, fbegin] () { fi->Seek(fbegin); };
   }
+  prefetcher_.reset(new PagePrefetcher(std::move(shards), "SparsePageSource"));
 }
 
 SparsePageSource::~SparsePageSource() {
   delete page_;
 }
 
+size_t SparsePageSource::PageSize() {
+  return dmlc::GetEnv("XGBOOST_PAGE_SIZE_MB", kPageSize >> 20UL) << 20UL;
+}
+
 bool SparsePageSource::Next() {
-  // doing clock rotation over shards.
+  // the prefetcher does the clock rotation over shards.
   if (page_ != nullptr) {
-    size_t n = prefetchers_.size();
-    prefetchers_[(clock_ptr_ + n - 1) % n]->Recycle(&page_);
+    prefetcher_->Recycle(&page_);
   }
-  if (prefetchers_[clock_ptr_]->Next(&page_)) {
+  if (prefetcher_->Next(&page_)) {
     batch_ = page_->GetRowBatch(base_rowid_);
     base_rowid_ += batch_.size;
-    // advance clock
-    clock_ptr_ = (clock_ptr_ + 1) % prefetchers_.size();
     return true;
   } else {
     return false;
@@ -73,10 +73,10 @@ bool SparsePageSource::Next() {
 
 void SparsePageSource::BeforeFirst() {
   base_rowid_ = 0;
-  clock_ptr_ = 0;
-  for (auto& p : prefetchers_) {
-    p->BeforeFirst();
+  if (page_ != nullptr) {
+    prefetcher_->Recycle(&page_);
   }
+  prefetcher_->BeforeFirst();
 }
 
 const RowBatch& SparsePageSource::Value() const {
@@ -112,6 +112,7 @@ void SparsePageSource::Create(dmlc::Parser<uint32_t>* src,
   }
   {
     SparsePage::Writer writer(name_shards, format_shards, 6);
+    const size_t page_size = PageSize();
     std::shared_ptr<SparsePage> page;
     writer.Alloc(&page); page->Clear();
 
@@ -138,7 +139,7 @@ void SparsePageSource::Create(dmlc::Parser<uint32_t>* src,
                                 static_cast<uint64_t>(index + 1));
       }
       page->Push(batch);
-      if (page->MemCostBytes() >= kPageSize) {
+      if (page->MemCostBytes() >= page_size) {
         bytes_write += page->MemCostBytes();
         writer.PushWrite(std::move(page));
         writer.Alloc(&page);
@@ -180,6 +181,7 @@ void SparsePageSource::Create(DMatrix* src,
   }
   {
     SparsePage::Writer writer(name_shards, format_shards, 6);
+    const size_t page_size = PageSize();
     std::shared_ptr<SparsePage> page;
     writer.Alloc(&page); page->Clear();
 
@@ -190,7 +192,7 @@ void SparsePageSource::Create(DMatrix* src,
 
     while (iter->Next()) {
       page->Push(iter->Value());
-      if (page->MemCostBytes() >= kPageSize) {
+      if (page->MemCostBytes() >= page_size) {
         bytes_write += page->MemCostBytes();
         writer.PushWrite(std::move(page));
         writer.Alloc(&page);
@@ -9,11 +9,11 @@
 
 #include <xgboost/base.h>
 #include <xgboost/data.h>
-#include <dmlc/threadediter.h>
 #include <vector>
 #include <algorithm>
 #include <string>
 #include "./sparse_batch_page.h"
+#include "./page_prefetcher.h"
 
 namespace xgboost {
 namespace data {
@@ -59,8 +59,13 @@ class SparsePageSource : public DataSource {
    * \return Whether cache file already exists.
    */
   static bool CacheExist(const std::string& cache_info);
-  /*! \brief page size 32 MB */
+  /*! \brief default page size 32 MB */
   static const size_t kPageSize = 32UL << 20UL;
+  /*!
+   * \brief size of the pages written to the cache, set in MB by the
+   *  environment variable XGBOOST_PAGE_SIZE_MB.
+   */
+  static size_t PageSize();
   /*! \brief magic number used to identify Page */
   static const int kMagic = 0xffffab02;
 
@@ -71,14 +76,12 @@ class SparsePageSource : public DataSource {
   RowBatch batch_;
   /*! \brief page currently on hold. */
   SparsePage *page_;
-  /*! \brief internal clock ptr */
-  size_t clock_ptr_;
   /*! \brief file pointer to the row blob file. */
   std::vector<std::unique_ptr<dmlc::SeekStream> > files_;
   /*! \brief Sparse page format file. */
   std::vector<std::unique_ptr<SparsePage::Format> > formats_;
   /*! \brief internal prefetcher. */
-  std::vector<std::unique_ptr<dmlc::ThreadedIter<SparsePage> > > prefetchers_;
+  std::unique_ptr<PagePrefetcher> prefetcher_;
 };
 }  // namespace data
 }  // namespace xgboost
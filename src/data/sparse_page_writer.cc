@@ -6,6 +6,7 @@
 #include <xgboost/base.h>
 #include <xgboost/logging.h>
 #include "./sparse_batch_page.h"
+#include "../common/timer.h"
 
 #if DMLC_ENABLE_STD_THREAD
 namespace xgboost {
@@ -35,7 +36,13 @@ SparsePage::Writer::Writer(
           std::shared_ptr<SparsePage> page;
           while (wqueue->Pop(&page)) {
             if (page.get() == nullptr) break;
+            common::Timer timer;
             fmt->Write(*page, fo.get());
+            timer.Stop();
+            common::Profiler::Get()->AddTime("SparsePage::Writer.write",
+                                             timer.ElapsedSeconds());
+            common::Profiler::Get()->AddCount("SparsePage::Writer.bytes",
+                                              page->MemCostBytes());
             qrecycle_.Push(std::move(page));
           }
           fo.reset(nullptr);
@@ -60,14 +67,22 @@ void SparsePage::Writer::PushWrite(std::shared_ptr<SparsePage>&& page) {
   clock_ptr_ = (clock_ptr_ + 1) % workers_.size();
 }
 
+void SparsePage::Writer::PushWrite(std::shared_ptr<SparsePage>&& page, size_t shard) {
+  CHECK_LT(shard, qworkers_.size());
+  qworkers_[shard].Push(std::move(page));
+}
+
 void SparsePage::Writer::Alloc(std::shared_ptr<SparsePage>* out_page) {
   CHECK(out_page->get() == nullptr);
-  if (num_free_buffer_ != 0) {
-    out_page->reset(new SparsePage());
-    --num_free_buffer_;
-  } else {
-    CHECK(qrecycle_.Pop(out_page));
+  {
+    std::lock_guard<std::mutex> lock(alloc_mutex_);
+    if (num_free_buffer_ != 0) {
+      --num_free_buffer_;
+      out_page->reset(new SparsePage());
+      return;
+    }
   }
+  CHECK(qrecycle_.Pop(out_page));
 }
 }  // namespace data
 }  // namespace xgboost
@@ -0,0 +1,112 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file text_number.h
+ * \brief Scanning of the lines and the numbers of text data, shared by the
+ *  text parsers.
+ */
+#ifndef XGBOOST_DATA_TEXT_NUMBER_H_
+#define XGBOOST_DATA_TEXT_NUMBER_H_
+
+#include <xgboost/base.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace xgboost {
+namespace data {
+inline bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+inline const char* SkipSpace(const char* p, const char* end) {
+  while (p != end && IsSpace(*p)) ++p;
+  return p;
+}
+
+// end of the line starting at p, the newline is not included
+inline const char* LineEnd(const char* p, const char* end) {
+  const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+  return nl == nullptr ? end : nl;
+}
+
+/*!
+ * \brief parse a decimal number in [p, end), without going through the
+ *  locale of strtof. Numbers it does not handle, such as nan and inf, are
+ *  passed to strtof.
+ * \return the end of the number, p when there is none.
+ */
+inline const char* ParseFloat(const char* p, const char* end, bst_float* out) {
+  static const double kPow10[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const char* begin = p;
+  bool negative = false;
+  if (p != end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+  if (p != end && (*p == 'n' || *p == 'N' || *p == 'i' || *p == 'I')) {
+    // the buffer is null terminated and the word cannot span a line
+    char* endptr;
+    const float v = std::strtof(begin, &endptr);
+    if (endptr == begin || endptr > end) return begin;
+    *out = v;
+    return endptr;
+  }
+  uint64_t mantissa = 0;
+  int digits = 0, exp10 = 0;
+  bool any = false;
+  for (; p != end && IsDigit(*p); ++p) {
+    any = true;
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa != 0) ++digits;
+    } else {
+      ++exp10;
+    }
+  }
+  if (p != end && *p == '.') {
+    for (++p; p != end && IsDigit(*p); ++p) {
+      any = true;
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        if (mantissa != 0) ++digits;
+        --exp10;
+      }
+    }
+  }
+  if (!any) return begin;
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    const char* q = p + 1;
+    bool exp_negative = false;
+    if (q != end && (*q == '-' || *q == '+')) {
+      exp_negative = *q == '-';
+      ++q;
+    }
+    if (q != end && IsDigit(*q)) {
+      int e = 0;
+      for (; q != end && IsDigit(*q); ++q) {
+        if (e < 10000) e = e * 10 + (*q - '0');
+      }
+      exp10 += exp_negative ? -e : e;
+      p = q;
+    }
+  }
+  double v = static_cast<double>(mantissa);
+  if (exp10 >= 0 && exp10 <= 22) {
+    v *= kPow10[exp10];
+  } else if (exp10 < 0 && exp10 >= -22) {
+    v /= kPow10[-exp10];
+  } else if (mantissa != 0) {
+    v *= std::pow(10.0, exp10);
+  }
+  *out = static_cast<bst_float>(negative ? -v : v);
+  return p;
+}
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_TEXT_NUMBER_H_
@@ -14,6 +14,7 @@
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include "../common/blocked_sum.h"
 #include "../common/timer.h"
 
 namespace xgboost {
@@ -67,9 +68,10 @@ class GBLinear : public GradientBooster {
       model.param.InitAllowUnknown(cfg);
     }
     param.InitAllowUnknown(cfg);
-    updater.reset(LinearUpdater::Create(param.updater));
-    updater->Init(cfg);
-    monitor.Init("GBLinear ", param.debug_verbose);
+    // the updater is created by the first DoBoost, prediction does not need it
+    cfg_ = cfg;
+    updater.reset();
+    monitor.Init("GBLinear", param.debug_verbose);
   }
   void Load(dmlc::Stream* fi) override {
     model.Load(fi);
@@ -92,6 +94,10 @@ class GBLinear : public GradientBooster {
     this->LazySumWeights(p_fmat);
 
     if (!this->CheckConvergence()) {
+      if (updater == nullptr) {
+        updater.reset(LinearUpdater::Create(param.updater));
+        updater->Init(cfg_);
+      }
       updater->Update(&in_gpair->data_h(), p_fmat, &model, sum_instance_weight);
     }
     this->UpdatePredictionCache();
@@ -108,7 +114,9 @@ class GBLinear : public GradientBooster {
 
     // Try to predict from cache
     auto it = cache_.find(p_fmat);
-    if (it != cache_.end() && it->second.predictions.size() != 0) {
+    if (it != cache_.end() && it->second.predictions.size() != 0 &&
+        it->second.predictions.size() ==
+        model.param.num_output_group * p_fmat->info().num_row) {
       std::vector<bst_float> &y = it->second.predictions;
       out_preds->resize(y.size());
       std::copy(y.begin(), y.end(), out_preds->data_h().begin());
@@ -122,10 +130,14 @@ class GBLinear : public GradientBooster {
                std::vector<bst_float> *out_preds,
                unsigned ntree_limit,
                unsigned root_index) override {
+    model.LazyInitModel();
     const int ngroup = model.param.num_output_group;
+    out_preds->resize(ngroup);
+    bst_float *preds = dmlc::BeginPtr(*out_preds);
     for (int gid = 0; gid < ngroup; ++gid) {
-      this->Pred(inst, dmlc::BeginPtr(*out_preds), gid, base_margin_);
+      preds[gid] = model.bias()[gid] + base_margin_;
     }
+    this->AddRowDot<true>(inst, dmlc::BeginPtr(model.weight), preds);
   }
 
   void PredictLeaf(DMatrix *p_fmat,
@@ -197,41 +209,88 @@ class GBLinear : public GradientBooster {
   void PredictBatchInternal(DMatrix *p_fmat,
                std::vector<bst_float> *out_preds) {
     monitor.Start("PredictBatchInternal");
-      model.LazyInitModel();
+    model.LazyInitModel();
     std::vector<bst_float> &preds = *out_preds;
     const std::vector<bst_float>& base_margin = p_fmat->info().base_margin;
-    // start collecting the prediction
-    dmlc::DataIter<RowBatch> *iter = p_fmat->RowIterator();
     const int ngroup = model.param.num_output_group;
     preds.resize(p_fmat->info().num_row * ngroup);
+    // output convention: nrow * k, where nrow is number of rows
+    // k is number of group
+    const omp_ulong nrow = static_cast<omp_ulong>(p_fmat->info().num_row);
+    const bst_float *bias = model.bias();
+    #pragma omp parallel for schedule(static)
+    for (omp_ulong ridx = 0; ridx < nrow; ++ridx) {
+      for (int gid = 0; gid < ngroup; ++gid) {
+        preds[ridx * ngroup + gid] = bias[gid] + ((base_margin.size() != 0) ?
+            base_margin[ridx * ngroup + gid] : base_margin_);
+      }
+    }
+    this->AddBatchDot(p_fmat, dmlc::BeginPtr(model.weight), &preds);
+    monitor.Stop("PredictBatchInternal");
+  }
+  /*!
+   * \brief add the product of the rows of a matrix with the weights to their
+   *  predictions, all the output groups of an entry at once.
+   * \param weight the weights laid out as the model, the bias last.
+   */
+  void AddBatchDot(DMatrix *p_fmat, const bst_float *weight,
+                   std::vector<bst_float> *out_preds) {
+    std::vector<bst_float> &preds = *out_preds;
+    const int ngroup = model.param.num_output_group;
+    // the features beyond the model are only checked when the matrix has them
+    const bool check_bound = p_fmat->info().num_col > model.param.num_feature;
+    dmlc::DataIter<RowBatch> *iter = p_fmat->RowIterator();
+    iter->BeforeFirst();
     while (iter->Next()) {
       const RowBatch &batch = iter->Value();
-      // output convention: nrow * k, where nrow is number of rows
-      // k is number of group
       // parallel over local batch
       const omp_ulong nsize = static_cast<omp_ulong>(batch.size);
       #pragma omp parallel for schedule(static)
       for (omp_ulong i = 0; i < nsize; ++i) {
-        const size_t ridx = batch.base_rowid + i;
-        // loop over output groups
-        for (int gid = 0; gid < ngroup; ++gid) {
-          bst_float margin =  (base_margin.size() != 0) ?
-              base_margin[ridx * ngroup + gid] : base_margin_;
-          this->Pred(batch[i], &preds[ridx * ngroup], gid, margin);
+        bst_float *p_preds = &preds[(batch.base_rowid + i) * ngroup];
+        if (check_bound) {
+          this->AddRowDot<true>(batch[i], weight, p_preds);
+        } else {
+          this->AddRowDot<false>(batch[i], weight, p_preds);
         }
       }
     }
-    monitor.Stop("PredictBatchInternal");
   }
+  /*!
+   * \brief update the predictions of the cached matrices. A matrix predicted
+   *  before only gets the product of its rows with the change of the weights.
+   */
   void UpdatePredictionCache() {
-    // update cache entry
+    model.LazyInitModel();
+    const int ngroup = model.param.num_output_group;
     for (auto &kv : cache_) {
       PredictionCacheEntry &e = kv.second;
-      if (e.predictions.size() == 0) {
-        size_t n = model.param.num_output_group * e.data->info().num_row;
-        e.predictions.resize(n);
+      const size_t n = ngroup * e.data->info().num_row;
+      if (e.predictions.size() != n || e.weight.size() != model.weight.size()) {
+        this->PredictBatchInternal(e.data.get(), &e.predictions);
+        e.weight = model.weight;
+        continue;
       }
-      this->PredictBatchInternal(e.data.get(), &e.predictions);
+      std::vector<bst_float> delta(model.weight.size());
+      bool changed = false;
+      for (size_t i = 0; i < delta.size(); ++i) {
+        delta[i] = model.weight[i] - e.weight[i];
+        changed = changed || delta[i] != 0.0f;
+      }
+      if (!changed) continue;
+      monitor.Start("UpdatePredictionCache");
+      std::vector<bst_float> &preds = e.predictions;
+      const bst_float *dbias = &delta[model.param.num_feature * ngroup];
+      const omp_ulong nrow = static_cast<omp_ulong>(e.data->info().num_row);
+      #pragma omp parallel for schedule(static)
+      for (omp_ulong ridx = 0; ridx < nrow; ++ridx) {
+        for (int gid = 0; gid < ngroup; ++gid) {
+          preds[ridx * ngroup + gid] += dbias[gid];
+        }
+      }
+      this->AddBatchDot(e.data.get(), dmlc::BeginPtr(delta), &preds);
+      e.weight = model.weight;
+      monitor.Stop("UpdatePredictionCache");
     }
   }
 
@@ -256,21 +315,41 @@ class GBLinear : public GradientBooster {
   void LazySumWeights(DMatrix *p_fmat) {
     if (!sum_weight_complete) {
       auto &info = p_fmat->info();
-      for (size_t i = 0; i < info.num_row; i++) {
-        sum_instance_weight += info.GetWeight(i);
-      }
+      double sum_weight;
+      common::BlockedSum(info.num_row, 1, [&](size_t begin, size_t end, double* sum) {
+          for (size_t i = begin; i < end; ++i) {
+            *sum += info.GetWeight(i);
+          }
+        }, &sum_weight);
+      sum_instance_weight += sum_weight;
       sum_weight_complete = true;
     }
   }
 
-  inline void Pred(const RowBatch::Inst &inst, bst_float *preds, int gid,
-                   bst_float base) {
-    bst_float psum = model.bias()[gid] + base;
+  // add the product of a row with the weights to the predictions of its groups
+  template <bool CheckBound>
+  inline void AddRowDot(const RowBatch::Inst &inst, const bst_float *weight,
+                        bst_float *preds) const {
+    const int ngroup = model.param.num_output_group;
+    const unsigned nfeature = model.param.num_feature;
+    if (ngroup == 1) {
+      bst_float psum = 0.0f;
+      for (bst_uint i = 0; i < inst.length; ++i) {
+        if (CheckBound && inst[i].index >= nfeature) continue;
+        psum += inst[i].fvalue * weight[inst[i].index];
+      }
+      preds[0] += psum;
+      return;
+    }
+    // the weights of a feature are contiguous over the groups
     for (bst_uint i = 0; i < inst.length; ++i) {
-      if (inst[i].index >= model.param.num_feature) continue;
-      psum += inst[i].fvalue * model[inst[i].index][gid];
+      if (CheckBound && inst[i].index >= nfeature) continue;
+      const bst_float fvalue = inst[i].fvalue;
+      const bst_float *w = weight + static_cast<size_t>(inst[i].index) * ngroup;
+      for (int gid = 0; gid < ngroup; ++gid) {
+        preds[gid] += fvalue * w[gid];
+      }
     }
-    preds[gid] = psum;
   }
   // biase margin score
   bst_float base_margin_;
@@ -279,6 +358,8 @@ class GBLinear : public GradientBooster {
   GBLinearModel previous_model;
   GBLinearTrainParam param;
   std::unique_ptr<LinearUpdater> updater;
+  // configuration of the updater
+  std::vector<std::pair<std::string, std::string> > cfg_;
   double sum_instance_weight;
   bool sum_weight_complete;
   common::Monitor monitor;
@@ -292,6 +373,8 @@ class GBLinear : public GradientBooster {
   struct PredictionCacheEntry {
     std::shared_ptr<DMatrix> data;
     std::vector<bst_float> predictions;
+    /*! \brief the weights of the model the predictions were made with */
+    std::vector<bst_float> weight;
   };
 
   /**
@@ -73,11 +73,13 @@ class GBLinearModel {
 
   std::vector<std::string> DumpModel(const FeatureMap& fmap, bool with_stats,
                                      std::string format) const {
+    CHECK_NE(format, "c") << "C source dump is only supported by tree boosters";
     const int ngroup = param.num_output_group;
     const unsigned nfeature = param.num_feature;
 
     std::stringstream fo("");
-    if (format == "json") {
+    // the json dump of a linear model already holds arrays
+    if (format == "json" || format == "json_compact") {
       fo << "  { \"bias\": [" << std::endl;
       for (int gid = 0; gid < ngroup; ++gid) {
         if (gid != 0) fo << "," << std::endl;
@@ -22,6 +22,21 @@ GradientBooster* GradientBooster::Create(
   return (e->body)(cache_mats, base_margin);
 }
 
+void GradientBooster::PredictBatch(DMatrix* dmat,
+                                   HostDeviceVector<bst_float>* out_preds,
+                                   unsigned ntree_limit,
+                                   PredictionContext* ctx) const {
+  LOG(FATAL) << "The booster does not support reentrant prediction";
+}
+
+void GradientBooster::PredictInstance(const SparseBatch::Inst& inst,
+                                      std::vector<bst_float>* out_preds,
+                                      unsigned ntree_limit,
+                                      unsigned root_index,
+                                      PredictionContext* ctx) const {
+  LOG(FATAL) << "The booster does not support reentrant prediction";
+}
+
 }  // namespace xgboost
 
 namespace xgboost {
@@ -7,6 +7,7 @@
 #include <dmlc/omp.h>
 #include <dmlc/parameter.h>
 #include <dmlc/timer.h>
+#include <rabit/rabit.h>
 #include <xgboost/logging.h>
 #include <xgboost/gbm.h>
 #include <xgboost/predictor.h>
@@ -16,12 +17,18 @@
 #include <utility>
 #include <string>
 #include <limits>
+#include <unordered_map>
 #include <algorithm>
+#include <exception>
+#include <iomanip>
+#include <sstream>
 #include "../common/common.h"
 #include "../common/host_device_vector.h"
 #include "../common/random.h"
 #include "gbtree_model.h"
+#include "group_gradients.h"
 #include "../common/timer.h"
+#include "../tree/param.h"
 
 namespace xgboost {
 namespace gbm {
@@ -45,6 +52,8 @@ struct GBTreeTrainParam : public dmlc::Parameter<GBTreeTrainParam> {
   std::string updater_seq;
   /*! \brief type of boosting process to run */
   int process_type;
+  /*! \brief number of trees of an iteration built at the same time */
+  int concurrent_trees;
   // flag to print out detailed breakdown of runtime
   int debug_verbose;
   std::string predictor;
@@ -64,6 +73,12 @@ struct GBTreeTrainParam : public dmlc::Parameter<GBTreeTrainParam> {
         .add_enum("update", kUpdate)
         .describe("Whether to run the normal boosting process that creates new trees,"\
                   " or to update the trees in an existing model.");
+    DMLC_DECLARE_FIELD(concurrent_trees)
+        .set_default(1)
+        .set_lower_bound(1)
+        .describe("Number of the trees of an iteration, the parallel trees of all"\
+                  " the output groups, built at the same time, each with a share"\
+                  " of the threads.");
     DMLC_DECLARE_FIELD(debug_verbose)
         .set_lower_bound(0)
         .set_default(0)
@@ -92,6 +107,8 @@ struct DartTrainParam : public dmlc::Parameter<DartTrainParam> {
   float skip_drop;
   /*! \brief learning step size for a time */
   float learning_rate;
+  /*! \brief whether to keep the output of every tree for the cached matrices */
+  bool cache_tree_output;
   // declare parameters
   DMLC_DECLARE_PARAMETER(DartTrainParam) {
     DMLC_DECLARE_FIELD(silent)
@@ -122,6 +139,11 @@ struct DartTrainParam : public dmlc::Parameter<DartTrainParam> {
         .set_lower_bound(0.0f)
         .set_default(0.3f)
         .describe("Learning rate(step size) of update.");
+    DMLC_DECLARE_FIELD(cache_tree_output)
+        .set_default(false)
+        .describe("Keep the output of every tree for each row of the cached matrices, "
+                  "so the dropped trees are read back instead of traversed again. "
+                  "Takes 4 bytes per row and tree.");
     DMLC_DECLARE_ALIAS(learning_rate, eta);
   }
 };
@@ -136,7 +158,8 @@ struct CacheEntry {
 // gradient boosted trees
 class GBTree : public GradientBooster {
  public:
-   explicit GBTree(bst_float base_margin) : model_(base_margin) {
+   explicit GBTree(bst_float base_margin)
+       : model_(base_margin), jobs_warm_(false), jobs_unshared_(false) {
      std::cout << "create GBtree" << std::endl;
    }
 
@@ -155,6 +178,9 @@ class GBTree : public GradientBooster {
     for (const auto& up : updaters) {
       up->Init(cfg);
     }
+    // the concurrent jobs are set up again with the new configuration
+    job_updaters_.clear();
+    jobs_unshared_ = false;
     // for the 'update' process_type, move trees into trees_to_update
     if (tparam.process_type == kUpdate) {
       model_.InitTreesToUpdate();
@@ -190,26 +216,18 @@ class GBTree : public GradientBooster {
     const int ngroup = model_.param.num_output_group;
     monitor.Start("BoostNewTrees");
     std::cout << "DoBoost::ngroup = " << ngroup << std::endl;
-    if (ngroup == 1) {
+    const int njob = this->ConcurrentJobs();
+    if (njob > 1) {
+      this->BoostConcurrent(in_gpair, p_fmat, njob, &new_trees);
+    } else if (ngroup == 1) {
       std::vector<std::unique_ptr<RegTree> > ret;
       BoostNewTrees(in_gpair, p_fmat, 0, &ret);
       new_trees.push_back(std::move(ret));
     } else {
-      CHECK_EQ(in_gpair->size() % ngroup, 0U)
-          << "must have exactly ngroup*nrow gpairs";
-      // TODO(canonizer): perform this on GPU if HostDeviceVector has device set.
-      HostDeviceVector<bst_gpair> tmp(in_gpair->size() / ngroup,
-                                      bst_gpair(), in_gpair->device());
-      std::vector<bst_gpair>& gpair_h = in_gpair->data_h();
-      bst_omp_uint nsize = static_cast<bst_omp_uint>(tmp.size());
+      group_gpair_.Split(in_gpair, ngroup);
       for (int gid = 0; gid < ngroup; ++gid) {
-        std::vector<bst_gpair>& tmp_h = tmp.data_h();
-        #pragma omp parallel for schedule(static)
-        for (bst_omp_uint i = 0; i < nsize; ++i) {
-          tmp_h[i] = gpair_h[i * ngroup + gid];
-        }
         std::vector<std::unique_ptr<RegTree> > ret;
-        BoostNewTrees(&tmp, p_fmat, gid, &ret);
+        BoostNewTrees(group_gpair_.Group(gid), p_fmat, gid, &ret);
         new_trees.push_back(std::move(ret));
       }
     }
@@ -225,6 +243,13 @@ class GBTree : public GradientBooster {
     predictor->PredictBatch(p_fmat, out_preds, model_, 0, ntree_limit);
   }
 
+  void PredictBatch(DMatrix* p_fmat,
+                    HostDeviceVector<bst_float>* out_preds,
+                    unsigned ntree_limit,
+                    PredictionContext* ctx) const override {
+    predictor->PredictBatch(p_fmat, out_preds, model_, 0, ntree_limit, ctx);
+  }
+
   void PredictInstance(const SparseBatch::Inst& inst,
                std::vector<bst_float>* out_preds,
                unsigned ntree_limit,
@@ -233,12 +258,30 @@ class GBTree : public GradientBooster {
                                ntree_limit, root_index);
   }
 
+  void PredictInstance(const SparseBatch::Inst& inst,
+                       std::vector<bst_float>* out_preds,
+                       unsigned ntree_limit,
+                       unsigned root_index,
+                       PredictionContext* ctx) const override {
+    predictor->PredictInstance(inst, out_preds, model_,
+                               ntree_limit, root_index, ctx);
+  }
+
   void PredictLeaf(DMatrix* p_fmat,
                    std::vector<bst_float>* out_preds,
                    unsigned ntree_limit) override {
     predictor->PredictLeaf(p_fmat, out_preds, model_, ntree_limit);
   }
 
+  void PredictLeafIndex(DMatrix* p_fmat, unsigned ntree_limit,
+                        const LeafIndexCallback& callback) override {
+    predictor->PredictLeafIndex(p_fmat, model_, ntree_limit, callback);
+  }
+
+  const GBTreeModel* TreeModel() const override {
+    return &model_;
+  }
+
   void PredictContribution(DMatrix* p_fmat,
                            std::vector<bst_float>* out_contribs,
                            unsigned ntree_limit, bool approximate, int condition,
@@ -256,10 +299,38 @@ class GBTree : public GradientBooster {
   std::vector<std::string> DumpModel(const FeatureMap& fmap,
                                      bool with_stats,
                                      std::string format) const override {
-    return model_.DumpModel(fmap, with_stats, format);
+    std::vector<std::string> dump = model_.DumpModel(fmap, with_stats, format);
+    if (format == "c") {
+      dump.push_back(model_.DumpPredictCode(std::vector<bst_float>()));
+    }
+    return dump;
+  }
+  void DumpModelTo(const FeatureMap& fmap, bool with_stats, std::string format,
+                   const std::function<void(const std::string&)>& visit) const override {
+    model_.DumpModelTo(fmap, with_stats, format, visit);
+    if (format == "c") {
+      visit(model_.DumpPredictCode(std::vector<bst_float>()));
+    }
+  }
+
+  void Slice(int layer_begin, int layer_end, int group,
+             GradientBooster* out) const override {
+    std::vector<size_t> index;
+    this->SliceTrees(layer_begin, layer_end, group, out, &index);
   }
 
  protected:
+  // the trees of the rounds [layer_begin, layer_end) in out, a round being
+  // the num_parallel_tree trees of every output group
+  inline void SliceTrees(int layer_begin, int layer_end, int group,
+                         GradientBooster* out, std::vector<size_t>* index) const {
+    GBTree* tree_out = dynamic_cast<GBTree*>(out);
+    CHECK(tree_out != nullptr) << "Slice: the booster is not a gbtree";
+    const int layer_trees = model_.param.num_output_group * tparam.num_parallel_tree;
+    model_.Slice(layer_begin, layer_end, layer_trees, group, &tree_out->model_, index);
+    tree_out->tparam = tparam;
+    tree_out->cfg = cfg;
+  }
   // initialize updater before using them
   inline void InitUpdater() {
     if (updaters.size() != 0) return;
@@ -272,15 +343,12 @@ class GBTree : public GradientBooster {
     }
   }
 
-  // do group specific group
-  inline void BoostNewTrees(HostDeviceVector<bst_gpair>* gpair,
-                            DMatrix *p_fmat,
-                            int bst_group,
-                            std::vector<std::unique_ptr<RegTree> >* ret) {
-    this->InitUpdater();
-    std::vector<RegTree*> new_trees;
+  // create the trees of a group, or take the ones to update
+  inline void CreateNewTrees(int bst_group,
+                             std::vector<std::unique_ptr<RegTree> >* ret,
+                             std::vector<RegTree*>* new_trees) {
     ret->clear();
-    // create the trees
+    new_trees->clear();
     std::cout << "BoostNewTrees::num_parallel_tree = " << tparam.num_parallel_tree << std::endl;
     for (int i = 0; i < tparam.num_parallel_tree; ++i) {
       if (tparam.process_type == kDefault) {
@@ -288,22 +356,169 @@ class GBTree : public GradientBooster {
         std::unique_ptr<RegTree> ptr(new RegTree());
         ptr->param.InitAllowUnknown(this->cfg);
         ptr->InitModel();
-        new_trees.push_back(ptr.get());
+        new_trees->push_back(ptr.get());
         ret->push_back(std::move(ptr));
       } else if (tparam.process_type == kUpdate) {
         CHECK_LT(model_.trees.size(), model_.trees_to_update.size());
         // move an existing tree from trees_to_update
         auto t = std::move(model_.trees_to_update[model_.trees.size() +
                            bst_group * tparam.num_parallel_tree + i]);
-        new_trees.push_back(t.get());
+        new_trees->push_back(t.get());
         ret->push_back(std::move(t));
       }
     }
+  }
+
+  // do group specific group
+  inline void BoostNewTrees(HostDeviceVector<bst_gpair>* gpair,
+                            DMatrix *p_fmat,
+                            int bst_group,
+                            std::vector<std::unique_ptr<RegTree> >* ret) {
+    this->InitUpdater();
+    std::vector<RegTree*> new_trees;
+    this->CreateNewTrees(bst_group, ret, &new_trees);
     // update the trees
     for (auto& up : updaters)
       up->Update(gpair, p_fmat, new_trees);
   }
 
+  // number of jobs building the trees of an iteration, 1 when they are built in turn
+  inline int ConcurrentJobs() {
+    const int ntask = model_.param.num_output_group * tparam.num_parallel_tree;
+    const int njob = std::min(std::min(tparam.concurrent_trees, ntask), omp_get_max_threads());
+    if (njob <= 1 || jobs_unshared_ ||
+        tparam.process_type == kUpdate || rabit::IsDistributed()) {
+      return 1;
+    }
+    if (job_updaters_.size() != static_cast<size_t>(njob)) {
+      this->InitJobUpdaters(njob);
+    }
+    return jobs_unshared_ ? 1 : njob;
+  }
+
+  // create the updaters of each job, they share the data built from the training matrix
+  inline void InitJobUpdaters(int njob) {
+    job_updaters_.clear();
+    jobs_warm_ = false;
+    // a job builds one tree at a time, with the learning rate the updaters
+    // give to each of the parallel trees of a group
+    tree::TrainParam train_param;
+    train_param.InitAllowUnknown(this->cfg);
+    std::ostringstream lr;
+    lr << std::setprecision(std::numeric_limits<float>::max_digits10)
+       << train_param.learning_rate / tparam.num_parallel_tree;
+    std::vector<std::pair<std::string, std::string> > job_cfg;
+    for (const auto& kv : this->cfg) {
+      if (kv.first != "eta" && kv.first != "learning_rate") job_cfg.push_back(kv);
+    }
+    job_cfg.emplace_back("learning_rate", lr.str());
+    const std::vector<std::string> ups = common::Split(tparam.updater_seq, ',');
+    job_updaters_.resize(njob);
+    for (int j = 0; j < njob; ++j) {
+      for (const std::string& pstr : ups) {
+        std::unique_ptr<TreeUpdater> up(TreeUpdater::Create(pstr.c_str()));
+        up->Init(job_cfg);
+        job_updaters_[j].push_back(std::move(up));
+      }
+    }
+    if (!this->ShareJobData()) {
+      job_updaters_.clear();
+      jobs_unshared_ = true;
+    }
+  }
+
+  // share the data of the updaters of the first job with the other jobs,
+  // false when an updater cannot build trees concurrently
+  inline bool ShareJobData() {
+    const std::vector<std::string> ups = common::Split(tparam.updater_seq, ',');
+    for (size_t k = 0; k < ups.size(); ++k) {
+      for (size_t j = 1; j < job_updaters_.size(); ++j) {
+        if (!job_updaters_[0][k]->ShareWith(job_updaters_[j][k].get())) {
+          LOG(WARNING) << "updater " << ups[k] << " cannot build trees concurrently, "
+                       << "concurrent_trees is ignored";
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // build the trees of all the groups with several jobs, each with a share of the threads
+  inline void BoostConcurrent(HostDeviceVector<bst_gpair>* in_gpair,
+                              DMatrix* p_fmat, int njob,
+                              std::vector<std::vector<std::unique_ptr<RegTree> > >* new_trees) {
+    const int ngroup = model_.param.num_output_group;
+    const int npt = tparam.num_parallel_tree;
+    // the gradients of each group
+    std::vector<HostDeviceVector<bst_gpair>*> gpair(ngroup, in_gpair);
+    if (ngroup != 1) {
+      group_gpair_.Split(in_gpair, ngroup);
+      for (int gid = 0; gid < ngroup; ++gid) {
+        gpair[gid] = group_gpair_.Group(gid);
+      }
+    }
+    // the trees, each with a seed drawn in order so they do not depend on the jobs
+    std::vector<RegTree*> tasks;
+    new_trees->resize(ngroup);
+    for (int gid = 0; gid < ngroup; ++gid) {
+      std::vector<RegTree*> trees;
+      this->CreateNewTrees(gid, &(*new_trees)[gid], &trees);
+      tasks.insert(tasks.end(), trees.begin(), trees.end());
+    }
+    std::vector<uint32_t> seeds(tasks.size());
+    for (size_t t = 0; t < tasks.size(); ++t) {
+      seeds[t] = static_cast<uint32_t>(common::GlobalRandom()());
+    }
+    const common::GlobalRandomEngine engine = common::GlobalRandom();
+    auto run_task = [&](int job, size_t t) {
+      common::GlobalRandom().seed(seeds[t]);
+      std::vector<RegTree*> trees(1, tasks[t]);
+      for (auto& up : job_updaters_[job]) {
+        up->Update(gpair[t / npt], p_fmat, trees);
+      }
+    };
+    // the first tree builds the shared data with all the threads
+    bst_omp_uint begin = 0;
+    if (!jobs_warm_) {
+      run_task(0, 0);
+      jobs_warm_ = true;
+      begin = 1;
+      // the data built may not be readable by several jobs at once, e.g. the
+      // pages of external memory data, the trees are then built in turn
+      if (!this->ShareJobData()) {
+        for (size_t t = 1; t < tasks.size(); ++t) {
+          run_task(0, t);
+        }
+        common::GlobalRandom() = engine;
+        job_updaters_.clear();
+        jobs_unshared_ = true;
+        return;
+      }
+    }
+    const int nthread = omp_get_max_threads();
+    const bst_omp_uint ntask = static_cast<bst_omp_uint>(tasks.size());
+    std::exception_ptr error;
+#ifdef _OPENMP
+    const int max_levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(2);
+#endif
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(njob)
+    for (bst_omp_uint t = begin; t < ntask; ++t) {
+      omp_set_num_threads(std::max(nthread / njob, 1));
+      try {
+        run_task(omp_get_thread_num(), t);
+      } catch (...) {
+        #pragma omp critical
+        if (!error) error = std::current_exception();
+      }
+    }
+#ifdef _OPENMP
+    omp_set_max_active_levels(max_levels);
+#endif
+    common::GlobalRandom() = engine;
+    if (error) std::rethrow_exception(error);
+  }
+
   // commit new trees all at once
   virtual void
   CommitModel(std::vector<std::vector<std::unique_ptr<RegTree>>>&& new_trees) {
@@ -324,6 +539,14 @@ class GBTree : public GradientBooster {
   std::vector<std::pair<std::string, std::string> > cfg;
   // the updaters that can be applied to each of tree
   std::vector<std::unique_ptr<TreeUpdater>> updaters;
+  // the updaters of each job building trees concurrently
+  std::vector<std::vector<std::unique_ptr<TreeUpdater> > > job_updaters_;
+  // whether the shared data of the jobs is built
+  bool jobs_warm_;
+  // whether the updaters cannot build trees concurrently
+  bool jobs_unshared_;
+  // the gradients of each group when there are several
+  GroupGradients group_gpair_;
   // Cached matrices
   std::vector<std::shared_ptr<DMatrix>> cache_;
   std::unique_ptr<Predictor> predictor;
@@ -342,12 +565,28 @@ class Dart : public GBTree {
     }
   }
 
+  /*! \brief register the matrices whose margins are kept between the iterations */
+  void InitDropoutCache(const std::vector<std::shared_ptr<DMatrix> >& cache) {
+    for (const std::shared_ptr<DMatrix>& d : cache) {
+      dropout_cache_[d.get()].data = d;
+    }
+  }
+
+  // the trees are weighted by the dropout
+  const GBTreeModel* TreeModel() const override {
+    return nullptr;
+  }
+
   void Load(dmlc::Stream* fi) override {
     GBTree::Load(fi);
     weight_drop.resize(model_.param.num_trees);
     if (model_.param.num_trees != 0) {
       fi->Read(&weight_drop);
     }
+    // the cached margins belong to the previous model
+    for (auto& kv : dropout_cache_) {
+      kv.second.margin.clear();
+    }
   }
 
   void Save(dmlc::Stream* fo) const override {
@@ -357,12 +596,47 @@ class Dart : public GBTree {
     }
   }
 
+  std::vector<std::string> DumpModel(const FeatureMap& fmap,
+                                     bool with_stats,
+                                     std::string format) const override {
+    std::vector<std::string> dump = model_.DumpModel(fmap, with_stats, format);
+    if (format == "c") {
+      dump.push_back(model_.DumpPredictCode(weight_drop));
+    }
+    return dump;
+  }
+  void DumpModelTo(const FeatureMap& fmap, bool with_stats, std::string format,
+                   const std::function<void(const std::string&)>& visit) const override {
+    model_.DumpModelTo(fmap, with_stats, format, visit);
+    if (format == "c") {
+      visit(model_.DumpPredictCode(weight_drop));
+    }
+  }
+
+  void Slice(int layer_begin, int layer_end, int group,
+             GradientBooster* out) const override {
+    Dart* dart_out = dynamic_cast<Dart*>(out);
+    CHECK(dart_out != nullptr) << "Slice: the booster is not a dart";
+    std::vector<size_t> index;
+    this->SliceTrees(layer_begin, layer_end, group, out, &index);
+    dart_out->dparam = dparam;
+    dart_out->weight_drop.clear();
+    for (size_t i : index) {
+      dart_out->weight_drop.push_back(weight_drop[i]);
+    }
+  }
+
   // predict the leaf scores with dropout if ntree_limit = 0
   void PredictBatch(DMatrix* p_fmat,
                     HostDeviceVector<bst_float>* out_preds,
                     unsigned ntree_limit) override {
     DropTrees(ntree_limit);
-    PredLoopInternal<Dart>(p_fmat, &out_preds->data_h(), 0, ntree_limit, true);
+    auto it = dropout_cache_.find(p_fmat);
+    if (ntree_limit == 0 && it != dropout_cache_.end()) {
+      PredictCached(&it->second, &out_preds->data_h());
+    } else {
+      PredLoopInternal<Dart>(p_fmat, &out_preds->data_h(), 0, ntree_limit, true);
+    }
   }
 
   void PredictInstance(const SparseBatch::Inst& inst,
@@ -387,6 +661,65 @@ class Dart : public GBTree {
     }
   }
 
+  // reentrant prediction never drops trees
+  void PredictBatch(DMatrix* p_fmat,
+                    HostDeviceVector<bst_float>* out_preds,
+                    unsigned ntree_limit,
+                    PredictionContext* ctx) const override {
+    const MetaInfo& info = p_fmat->info();
+    const int num_group = model_.param.num_output_group;
+    const int nthread = omp_get_max_threads();
+    ntree_limit *= num_group;
+    if (ntree_limit == 0 || ntree_limit > model_.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model_.trees.size());
+    }
+    size_t n = num_group * info.num_row;
+    const std::vector<bst_float>& base_margin = info.base_margin;
+    out_preds->resize(n);
+    std::vector<bst_float>& preds = out_preds->data_h();
+    if (base_margin.size() != 0) {
+      CHECK_EQ(preds.size(), n);
+      std::copy(base_margin.begin(), base_margin.end(), preds.begin());
+    } else {
+      std::fill(preds.begin(), preds.end(), model_.base_margin);
+    }
+    InitThreadTemp(nthread, &ctx->thread_temp);
+    dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const RowBatch &batch = iter->Value();
+      // parallel over local batch
+      const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        RegTree::FVec& feats = ctx->thread_temp[omp_get_thread_num()];
+        const size_t ridx = static_cast<size_t>(batch.base_rowid + i);
+        for (int gid = 0; gid < num_group; ++gid) {
+          preds[ridx * num_group + gid] +=
+              WeightedValue(batch[i], gid, info.GetRoot(ridx), &feats, ntree_limit);
+        }
+      }
+    }
+  }
+
+  void PredictInstance(const SparseBatch::Inst& inst,
+                       std::vector<bst_float>* out_preds,
+                       unsigned ntree_limit,
+                       unsigned root_index,
+                       PredictionContext* ctx) const override {
+    InitThreadTemp(1, &ctx->thread_temp);
+    out_preds->resize(model_.param.num_output_group);
+    ntree_limit *= model_.param.num_output_group;
+    if (ntree_limit == 0 || ntree_limit > model_.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model_.trees.size());
+    }
+    for (int gid = 0; gid < model_.param.num_output_group; ++gid) {
+      (*out_preds)[gid]
+          = WeightedValue(inst, gid, root_index,
+                          &ctx->thread_temp[0], ntree_limit) + model_.base_margin;
+    }
+  }
+
  protected:
   friend class GBTree;
   // internal prediction loop
@@ -485,6 +818,121 @@ class Dart : public GBTree {
     }
   }
 
+  /*!
+   * \brief cached margin of a matrix, the sum of all the trees at the weights
+   *  they had when it was last predicted
+   */
+  struct DropoutCacheEntry {
+    std::shared_ptr<DMatrix> data;
+    /*! \brief base margin plus the weighted trees, per row and output group */
+    std::vector<double> margin;
+    /*! \brief weight of each tree in margin */
+    std::vector<bst_float> weights;
+    /*! \brief output of each tree for each row, empty for a tree not kept */
+    std::vector<std::vector<bst_float> > tree_output;
+  };
+  /*! \brief how a tree enters a cached prediction */
+  enum CachedTreeFlag {
+    kNewTree = 1,
+    kReweighted = 2,
+    kDropped = 4
+  };
+
+  // predict from the cached margin of a matrix: the new trees and the change
+  // of weight of the trees rescaled by the last dropout are added to it,
+  // then the dropped trees are taken out of the prediction. Only these trees
+  // are traversed, or none but the new ones when their outputs are kept.
+  inline void PredictCached(DropoutCacheEntry* e, std::vector<bst_float>* out_preds) {
+    DMatrix* p_fmat = e->data.get();
+    const MetaInfo& info = p_fmat->info();
+    const int num_group = model_.param.num_output_group;
+    const size_t n = num_group * info.num_row;
+    const size_t ntree = model_.trees.size();
+    if (e->margin.size() != n || e->weights.size() > ntree) {
+      e->margin.resize(n);
+      if (info.base_margin.size() != 0) {
+        CHECK_EQ(info.base_margin.size(), n);
+        std::copy(info.base_margin.begin(), info.base_margin.end(), e->margin.begin());
+      } else {
+        std::fill(e->margin.begin(), e->margin.end(), model_.base_margin);
+      }
+      e->weights.clear();
+      e->tree_output.clear();
+    }
+    // the trees to visit, in increasing order
+    std::vector<std::pair<size_t, int> > visit;
+    size_t k = 0;
+    for (size_t i = 0; i < ntree; ++i) {
+      int flag = 0;
+      if (i >= e->weights.size()) {
+        flag |= kNewTree;
+      } else if (e->weights[i] != weight_drop[i]) {
+        flag |= kReweighted;
+      }
+      for (; k < idx_drop.size() && idx_drop[k] < i; ++k) {}
+      if (k < idx_drop.size() && idx_drop[k] == i) flag |= kDropped;
+      if (flag != 0) visit.emplace_back(i, flag);
+    }
+    e->tree_output.resize(ntree);
+    if (dparam.cache_tree_output) {
+      for (size_t i = e->weights.size(); i < ntree; ++i) {
+        e->tree_output[i].resize(info.num_row);
+      }
+    }
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread);
+    // the dropped outputs of the row of each thread
+    std::vector<std::vector<double> > thread_drop(nthread, std::vector<double>(num_group));
+    out_preds->resize(n);
+    std::vector<bst_float>& preds = *out_preds;
+    dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const RowBatch &batch = iter->Value();
+      const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        RegTree::FVec& feats = thread_temp[omp_get_thread_num()];
+        const size_t ridx = static_cast<size_t>(batch.base_rowid + i);
+        const RowBatch::Inst inst = batch[i];
+        double* margin = &e->margin[ridx * num_group];
+        std::vector<double>& drop = thread_drop[omp_get_thread_num()];
+        std::fill(drop.begin(), drop.end(), 0.0);
+        bool filled = false;
+        for (const std::pair<size_t, int>& v : visit) {
+          const size_t t = v.first;
+          const int gid = model_.tree_info[t];
+          std::vector<bst_float>& kept = e->tree_output[t];
+          bst_float out;
+          if (kept.size() != 0 && !(v.second & kNewTree)) {
+            out = kept[ridx];
+          } else {
+            if (!filled) {
+              feats.Fill(inst);
+              filled = true;
+            }
+            out = (*model_.trees[t])[model_.trees[t]->GetLeafIndex(
+                feats, info.GetRoot(ridx))].leaf_value();
+            if (kept.size() != 0) kept[ridx] = out;
+          }
+          if (v.second & kNewTree) {
+            margin[gid] += static_cast<double>(weight_drop[t]) * out;
+          } else if (v.second & kReweighted) {
+            margin[gid] += (static_cast<double>(weight_drop[t]) - e->weights[t]) * out;
+          }
+          if (v.second & kDropped) {
+            drop[gid] += static_cast<double>(weight_drop[t]) * out;
+          }
+        }
+        if (filled) feats.Drop(inst);
+        for (int gid = 0; gid < num_group; ++gid) {
+          preds[ridx * num_group + gid] = static_cast<bst_float>(margin[gid] - drop[gid]);
+        }
+      }
+    }
+    e->weights = weight_drop;
+  }
+
   // commit new trees all at once
   void
   CommitModel(std::vector<std::vector<std::unique_ptr<RegTree>>>&& new_trees) override {
@@ -522,6 +970,24 @@ class Dart : public GBTree {
     return psum;
   }
 
+  // predict the leaf scores of the first tree_end trees, none dropped
+  inline bst_float WeightedValue(const RowBatch::Inst &inst,
+                                 int bst_group,
+                                 unsigned root_index,
+                                 RegTree::FVec *p_feats,
+                                 unsigned tree_end) const {
+    bst_float psum = 0.0f;
+    p_feats->Fill(inst);
+    for (size_t i = 0; i < tree_end; ++i) {
+      if (model_.tree_info[i] == bst_group) {
+        int tid = model_.trees[i]->GetLeafIndex(*p_feats, root_index);
+        psum += weight_drop[i] * (*model_.trees[i])[tid].leaf_value();
+      }
+    }
+    p_feats->Drop(inst);
+    return psum;
+  }
+
   // select which trees to drop
   inline void DropTrees(unsigned ntree_limit_drop) {
     idx_drop.clear();
@@ -604,11 +1070,15 @@ class Dart : public GBTree {
 
   // init thread buffers
   inline void InitThreadTemp(int nthread) {
-    int prev_thread_temp_size = thread_temp.size();
+    InitThreadTemp(nthread, &thread_temp);
+  }
+  inline void InitThreadTemp(int nthread, std::vector<RegTree::FVec>* p_temp) const {
+    std::vector<RegTree::FVec>& temp = *p_temp;
+    int prev_thread_temp_size = temp.size();
     if (prev_thread_temp_size < nthread) {
-      thread_temp.resize(nthread, RegTree::FVec());
+      temp.resize(nthread, RegTree::FVec());
       for (int i = prev_thread_temp_size; i < nthread; ++i) {
-        thread_temp[i].Init(model_.param.num_feature);
+        temp[i].Init(model_.param.num_feature);
       }
     }
   }
@@ -622,6 +1092,8 @@ class Dart : public GBTree {
   std::vector<size_t> idx_drop;
   // temporal storage for per thread
   std::vector<RegTree::FVec> thread_temp;
+  // cached margins of the matrices given at creation
+  std::unordered_map<DMatrix*, DropoutCacheEntry> dropout_cache_;
 };
 
 // register the objective functions
@@ -639,7 +1111,8 @@ XGBOOST_REGISTER_GBM(GBTree, "gbtree")
 XGBOOST_REGISTER_GBM(Dart, "dart")
 .describe("Tree booster, dart.")
 .set_body([](const std::vector<std::shared_ptr<DMatrix> >& cached_mats, bst_float base_margin) {
-    GBTree* p = new Dart(base_margin);
+    Dart* p = new Dart(base_margin);
+    p->InitDropoutCache(cached_mats);
     return p;
   });
 }  // namespace gbm
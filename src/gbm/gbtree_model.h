@@ -2,9 +2,17 @@
  * Copyright by Contributors 2017
  */
 #pragma once
+#include <dmlc/omp.h>
 #include <dmlc/parameter.h>
 #include <dmlc/io.h>
 #include <xgboost/tree_model.h>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <sstream>
 #include <utility>
 #include <string>
 #include <vector>
@@ -59,6 +67,275 @@ struct GBTreeModelParam : public dmlc::Parameter<GBTreeModelParam> {
   }
 };
 
+/*!
+ * \brief read-only copy of the trees in a flattened, structure-of-arrays
+ *  layout used by the predictors. Nodes of each tree are stored in
+ *  depth-first order, so the left child of a split node is always the
+ *  node right after it and only the position of the right child is kept.
+ *
+ *  The nodes are compact, 8 bytes each: a word packing the default
+ *  direction, the split feature and the offset of the right child, next to
+ *  the value. When a tree has a feature or a right child out of the range
+ *  of the word, all the nodes are kept wide, 12 bytes each, in sindex and
+ *  cright instead.
+ */
+struct CompiledTrees {
+  /*! \brief bits of the split feature in a compact node */
+  static const unsigned kCompactFidBits = 16;
+  /*! \brief bits of the offset of the right child in a compact node, 0 marks a leaf */
+  static const unsigned kCompactOffsetBits = 15;
+  /*!
+   * \brief compact nodes: the highest bit indicates default left, then the
+   *  split feature, then the offset of the right child from the node.
+   */
+  std::vector<unsigned> node;
+  /*! \brief split feature index of wide nodes, highest bit indicates default left */
+  std::vector<unsigned> sindex;
+  /*! \brief split condition of split nodes, leaf value of leaf nodes */
+  std::vector<bst_float> value;
+  /*! \brief position of the right child of wide nodes, -1 for leaf nodes */
+  std::vector<int> cright;
+  /*! \brief position of every root, roots of tree i start at root_ptr[i] */
+  std::vector<int> roots;
+  /*! \brief offset of each tree into roots */
+  std::vector<size_t> root_ptr{0};
+  /*! \brief whether the nodes are compact */
+  bool compact{true};
+  /*! \brief bumped on every change, lets predictors cache derived layouts */
+  uint64_t version{0};
+
+  /*! \brief number of trees that have been compiled */
+  inline size_t Size() const {
+    return root_ptr.size() - 1;
+  }
+  /*! \brief bytes taken by one node */
+  inline size_t NodeBytes() const {
+    return compact ? sizeof(unsigned) + sizeof(bst_float) :
+        sizeof(unsigned) + sizeof(bst_float) + sizeof(int);
+  }
+  /*! \brief remove all the compiled trees */
+  inline void Clear() {
+    node.clear();
+    sindex.clear();
+    value.clear();
+    cright.clear();
+    roots.clear();
+    root_ptr.resize(1);
+    compact = true;
+    ++version;
+  }
+  /*!
+   * \brief compile a tree and append it to the end
+   * \param tree the tree to be appended
+   */
+  inline void Append(const RegTree& tree) {
+    const RegTree* ptree = &tree;
+    this->Append(&ptree, &ptree + 1);
+  }
+  /*!
+   * \brief compile the trees [begin, end) and append them to the end.
+   *  The room of all the trees is made at once, then the trees are
+   *  compiled into their own ranges in parallel.
+   * \param begin,end iterators over pointers to the trees to be appended
+   */
+  template<typename TreeIter>
+  inline void Append(TreeIter begin, TreeIter end) {
+    const size_t ntree = static_cast<size_t>(end - begin);
+    if (ntree == 0) return;
+    // the first node and the first root of each new tree
+    const size_t base = value.size();
+    std::vector<size_t> node_ptr(ntree + 1, base);
+    std::vector<size_t> tree_roots(ntree + 1, roots.size());
+    for (size_t i = 0; i < ntree; ++i) {
+      const RegTree& tree = *begin[i];
+      node_ptr[i + 1] = node_ptr[i] + CompiledSize(tree);
+      tree_roots[i + 1] = tree_roots[i] + tree.param.num_roots;
+      root_ptr.push_back(tree_roots[i + 1]);
+    }
+    CHECK_LT(node_ptr[ntree], static_cast<size_t>(std::numeric_limits<int>::max()))
+        << "number of compiled nodes exceed 2^31";
+    // the new nodes are compiled wide, then packed when they all fit
+    std::vector<unsigned> new_sindex(node_ptr[ntree] - base);
+    std::vector<int> new_cright(node_ptr[ntree] - base, -1);
+    value.resize(node_ptr[ntree]);
+    roots.resize(tree_roots[ntree]);
+    const bst_omp_uint nsize = static_cast<bst_omp_uint>(ntree);
+    #pragma omp parallel for schedule(dynamic) if (nsize > 1)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      this->Compile(*begin[i], static_cast<int>(node_ptr[i]), tree_roots[i],
+                    static_cast<int>(base), &new_sindex, &new_cright);
+    }
+    if (compact && !FitsCompact(new_sindex, new_cright, base)) {
+      this->Widen();
+    }
+    if (compact) {
+      node.resize(node_ptr[ntree]);
+      for (size_t i = 0; i < new_sindex.size(); ++i) {
+        node[base + i] = Pack(new_sindex[i], new_cright[i], static_cast<int>(base + i));
+      }
+    } else {
+      sindex.insert(sindex.end(), new_sindex.begin(), new_sindex.end());
+      cright.insert(cright.end(), new_cright.begin(), new_cright.end());
+    }
+    ++version;
+  }
+  /*!
+   * \brief get the leaf value of a compiled tree
+   * \param tree_id index of the tree
+   * \param feat feature vector, a RegTree::FVec or a RegTree::SparseFVec
+   * \param root_id starting root index of the instance
+   */
+  template <typename FeatVec>
+  inline bst_float Predict(size_t tree_id, const FeatVec& feat,
+                           unsigned root_id = 0) const {
+    int pos = roots[root_ptr[tree_id] + root_id];
+    if (compact) {
+      const unsigned offset_mask = (1U << kCompactOffsetBits) - 1U;
+      const unsigned fid_mask = (1U << kCompactFidBits) - 1U;
+      while ((node[pos] & offset_mask) != 0) {
+        const unsigned word = node[pos];
+        const unsigned fid = (word >> kCompactOffsetBits) & fid_mask;
+        bst_float fvalue;
+        bool go_left;
+        if (!FeatureValue(feat, fid, &fvalue)) {
+          go_left = (word >> 31) != 0;
+        } else {
+          go_left = fvalue < value[pos];
+        }
+        pos = go_left ? pos + 1 : pos + static_cast<int>(word & offset_mask);
+      }
+      return value[pos];
+    }
+    while (cright[pos] != -1) {
+      const unsigned sidx = sindex[pos];
+      const unsigned fid = sidx & ((1U << 31) - 1U);
+      bst_float fvalue;
+      bool go_left;
+      if (!FeatureValue(feat, fid, &fvalue)) {
+        go_left = (sidx >> 31) != 0;
+      } else {
+        go_left = fvalue < value[pos];
+      }
+      pos = go_left ? pos + 1 : cright[pos];
+    }
+    return value[pos];
+  }
+
+ private:
+  // the value of a feature, false when it is missing
+  inline static bool FeatureValue(const RegTree::FVec& feat, unsigned fid, bst_float* out) {
+    if (feat.is_missing(fid)) return false;
+    *out = feat.fvalue(fid);
+    return true;
+  }
+  inline static bool FeatureValue(const RegTree::SparseFVec& feat, unsigned fid,
+                                  bst_float* out) {
+    return feat.Find(fid, out);
+  }
+  /*! \brief number of nodes reachable from the roots of a tree */
+  inline static size_t CompiledSize(const RegTree& tree) {
+    size_t n = 0;
+    std::vector<int> stack;
+    for (int rid = 0; rid < tree.param.num_roots; ++rid) {
+      stack.push_back(rid);
+      while (!stack.empty()) {
+        const RegTree::Node& node = tree[stack.back()];
+        stack.pop_back();
+        ++n;
+        if (!node.is_leaf()) {
+          stack.push_back(node.cright());
+          stack.push_back(node.cleft());
+        }
+      }
+    }
+    return n;
+  }
+  /*! \brief whether the wide nodes from base fit into compact nodes */
+  inline static bool FitsCompact(const std::vector<unsigned>& wide_sindex,
+                                 const std::vector<int>& wide_cright, size_t base) {
+    for (size_t i = 0; i < wide_sindex.size(); ++i) {
+      if (wide_cright[i] == -1) continue;
+      const unsigned fid = wide_sindex[i] & ((1U << 31) - 1U);
+      const size_t offset = static_cast<size_t>(wide_cright[i]) - (base + i);
+      if (fid >> kCompactFidBits != 0 || offset >> kCompactOffsetBits != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+  /*! \brief the compact node of the wide node at pos */
+  inline static unsigned Pack(unsigned wide_sindex, int wide_cright, int pos) {
+    if (wide_cright == -1) return 0;
+    const unsigned fid = wide_sindex & ((1U << 31) - 1U);
+    return (wide_sindex & (1U << 31)) | (fid << kCompactOffsetBits) |
+        static_cast<unsigned>(wide_cright - pos);
+  }
+  /*! \brief turn the compact nodes into wide nodes */
+  inline void Widen() {
+    const unsigned offset_mask = (1U << kCompactOffsetBits) - 1U;
+    const unsigned fid_mask = (1U << kCompactFidBits) - 1U;
+    sindex.resize(node.size());
+    cright.resize(node.size());
+    for (size_t i = 0; i < node.size(); ++i) {
+      const unsigned word = node[i];
+      if ((word & offset_mask) == 0) {
+        sindex[i] = 0;
+        cright[i] = -1;
+      } else {
+        sindex[i] = (word & (1U << 31)) | ((word >> kCompactOffsetBits) & fid_mask);
+        cright[i] = static_cast<int>(i + (word & offset_mask));
+      }
+    }
+    std::vector<unsigned>().swap(node);
+    compact = false;
+  }
+  /*!
+   * \brief compile a tree into the nodes from pos and the roots from root_begin,
+   *  the room of which is already made. The split features and the right
+   *  children are written wide, from position base of out_sindex and out_cright.
+   */
+  inline void Compile(const RegTree& tree, int pos, size_t root_begin, int base,
+                      std::vector<unsigned>* out_sindex, std::vector<int>* out_cright) {
+    std::vector<unsigned>& wide_sindex = *out_sindex;
+    std::vector<int>& wide_cright = *out_cright;
+    // compiled position of each node, the right children are filled in after the walk
+    std::vector<int> node_pos(tree.param.num_nodes, -1);
+    std::vector<int> stack;
+    const int begin = pos;
+    for (int rid = 0; rid < tree.param.num_roots; ++rid) {
+      roots[root_begin + rid] = pos;
+      stack.push_back(rid);
+      // pre-order walk, the left child of a split is the node right after it
+      while (!stack.empty()) {
+        const int nid = stack.back();
+        stack.pop_back();
+        node_pos[nid] = pos;
+        const RegTree::Node& node = tree[nid];
+        if (node.is_leaf()) {
+          wide_sindex[pos - base] = 0;
+          value[pos] = node.leaf_value();
+          wide_cright[pos - base] = -1;
+        } else {
+          unsigned sidx = node.split_index();
+          if (node.default_left()) sidx |= (1U << 31);
+          wide_sindex[pos - base] = sidx;
+          value[pos] = node.split_cond();
+          // the id of the right child until its position is known
+          wide_cright[pos - base] = node.cright();
+          stack.push_back(node.cright());
+          stack.push_back(node.cleft());
+        }
+        ++pos;
+      }
+    }
+    for (int i = begin; i < pos; ++i) {
+      if (wide_cright[i - base] != -1) {
+        wide_cright[i - base] = node_pos[wide_cright[i - base]];
+      }
+    }
+  }
+};
+
 struct GBTreeModel {
   explicit GBTreeModel(bst_float base_margin) : base_margin(base_margin) {}
   void Configure(const std::vector<std::pair<std::string, std::string> >& cfg) {
@@ -72,10 +349,12 @@ struct GBTreeModel {
     std::cout << "trees_to_update.size() = " << trees_to_update.size() << std::endl;
     if (trees_to_update.size() == 0u) {
       std::cout << "trees.size() = " << trees.size() << std::endl;
+      // the trees are copied, they may be shared with the slices of the model
       for (size_t i = 0; i < trees.size(); ++i) {
-        trees_to_update.push_back(std::move(trees[i]));
+        trees_to_update.emplace_back(new RegTree(*trees[i]));
       }
       trees.clear();
+      compiled_trees.Clear();
       param.num_trees = 0;
       tree_info.clear();
     }
@@ -86,11 +365,14 @@ struct GBTreeModel {
         << "GBTree: invalid model file";
     trees.clear();
     trees_to_update.clear();
+    compiled_trees.Clear();
+    trees.reserve(param.num_trees);
     for (int i = 0; i < param.num_trees; ++i) {
       std::unique_ptr<RegTree> ptr(new RegTree());
       ptr->Load(fi);
       trees.push_back(std::move(ptr));
     }
+    compiled_trees.Append(trees.begin(), trees.end());
     tree_info.resize(param.num_trees);
     if (param.num_trees != 0) {
       CHECK_EQ(
@@ -112,14 +394,122 @@ struct GBTreeModel {
 
   std::vector<std::string> DumpModel(const FeatureMap& fmap, bool with_stats,
                                      std::string format) const {
-    std::vector<std::string> dump;
-    for (size_t i = 0; i < trees.size(); i++) {
-      dump.push_back(trees[i]->DumpModel(fmap, with_stats, format));
+    return this->DumpTrees(fmap, with_stats, format, 0, trees.size());
+  }
+  /*!
+   * \brief dump the trees one block at a time, the trees of a block are
+   *  dumped in parallel, then visited in order.
+   * \param visit called with the dump of each tree, in order.
+   */
+  void DumpModelTo(const FeatureMap& fmap, bool with_stats, std::string format,
+                   const std::function<void(const std::string&)>& visit) const {
+    const size_t block = std::max(static_cast<size_t>(64),
+                                  4 * static_cast<size_t>(omp_get_max_threads()));
+    for (size_t begin = 0; begin < trees.size(); begin += block) {
+      const size_t end = std::min(begin + block, trees.size());
+      for (const std::string& dump : this->DumpTrees(fmap, with_stats, format, begin, end)) {
+        visit(dump);
+      }
+    }
+  }
+  /*! \brief dump the trees [begin, end) in parallel */
+  std::vector<std::string> DumpTrees(const FeatureMap& fmap, bool with_stats,
+                                     const std::string& format,
+                                     size_t begin, size_t end) const {
+    std::vector<std::string> dump(end - begin);
+    const bst_omp_uint ntree = static_cast<bst_omp_uint>(end - begin);
+    std::exception_ptr error;
+    #pragma omp parallel for schedule(dynamic) if (ntree > 1)
+    for (bst_omp_uint k = 0; k < ntree; ++k) {
+      const size_t i = begin + k;
+      try {
+        if (format == "c") {
+          std::ostringstream os;
+          os << "static float tree_" << i << "(const float* f) {\n"
+             << trees[i]->DumpModel(fmap, with_stats, format) << "}\n";
+          dump[k] = os.str();
+        } else {
+          dump[k] = trees[i]->DumpModel(fmap, with_stats, format);
+        }
+      } catch (...) {
+        #pragma omp critical
+        if (!error) error = std::current_exception();
+      }
     }
+    if (error) std::rethrow_exception(error);
     return dump;
   }
+  /*!
+   * \brief generate the C source of the predict function that sums up
+   *  the tree functions emitted by DumpModel with format "c".
+   *  The result is the margin, one value per output group.
+   * \param weight the weight of each tree, empty means all 1.
+   */
+  std::string DumpPredictCode(const std::vector<bst_float>& weight) const {
+    const int ngroup = param.num_output_group;
+    std::ostringstream os;
+    os << std::scientific
+       << std::setprecision(std::numeric_limits<bst_float>::max_digits10);
+    if (ngroup == 1) {
+      os << "float predict(const float* f) {\n"
+         << "  float psum = 0.0f;\n";
+    } else {
+      os << "void predict(const float* f, float* out) {\n"
+         << "  float psum[" << ngroup << "] = {0.0f};\n";
+    }
+    for (size_t i = 0; i < trees.size(); ++i) {
+      os << "  psum";
+      if (ngroup != 1) os << "[" << tree_info[i] << "]";
+      os << " += ";
+      if (weight.size() != 0) os << weight[i] << "f * ";
+      os << "tree_" << i << "(f);\n";
+    }
+    if (ngroup == 1) {
+      os << "  return psum + " << base_margin << "f;\n";
+    } else {
+      for (int gid = 0; gid < ngroup; ++gid) {
+        os << "  out[" << gid << "] = psum[" << gid << "] + " << base_margin << "f;\n";
+      }
+    }
+    os << "}\n";
+    return os.str();
+  }
+  /*!
+   * \brief put the trees of the layers [layer_begin, layer_end) in out,
+   *  shared with this model. A layer is the layer_trees trees of a round.
+   * \param group the output group whose trees are kept, -1 for all of
+   *  them. The model of a single group has one output group.
+   * \param out_index set to the positions of the kept trees in this model.
+   */
+  void Slice(int layer_begin, int layer_end, int layer_trees, int group,
+             GBTreeModel* out, std::vector<size_t>* out_index) const {
+    const int nlayer = layer_trees > 0 ? param.num_trees / layer_trees : 0;
+    CHECK(layer_begin >= 0 && layer_begin < layer_end && layer_end <= nlayer)
+        << "Slice: the layers [" << layer_begin << ", " << layer_end
+        << ") are not in the " << nlayer << " layers of the model";
+    CHECK(group >= -1 && group < param.num_output_group)
+        << "Slice: the model has no output group " << group;
+    out->base_margin = base_margin;
+    out->param = param;
+    out->trees.clear();
+    out->trees_to_update.clear();
+    out->tree_info.clear();
+    out->compiled_trees.Clear();
+    out_index->clear();
+    const size_t end = static_cast<size_t>(layer_end) * layer_trees;
+    for (size_t i = static_cast<size_t>(layer_begin) * layer_trees; i < end; ++i) {
+      if (group >= 0 && tree_info[i] != group) continue;
+      out->trees.push_back(trees[i]);
+      out->tree_info.push_back(group >= 0 ? 0 : tree_info[i]);
+      out_index->push_back(i);
+    }
+    if (group >= 0) out->param.num_output_group = 1;
+    out->param.num_trees = static_cast<int>(out->trees.size());
+    out->compiled_trees.Append(out->trees.begin(), out->trees.end());
+  }
   void CommitModel(std::vector<std::unique_ptr<RegTree> >&& new_trees,
                    int bst_group) {
+    compiled_trees.Append(new_trees.begin(), new_trees.end());
     for (size_t i = 0; i < new_trees.size(); ++i) {
       trees.push_back(std::move(new_trees[i]));
       tree_info.push_back(bst_group);
@@ -131,12 +521,14 @@ struct GBTreeModel {
   bst_float base_margin;
   // model parameter
   GBTreeModelParam param;
-  /*! \brief vector of trees stored in the model */
-  std::vector<std::unique_ptr<RegTree> > trees;
+  /*! \brief vector of trees stored in the model, shared with its slices */
+  std::vector<std::shared_ptr<RegTree> > trees;
   /*! \brief for the update process, a place to keep the initial trees */
   std::vector<std::unique_ptr<RegTree> > trees_to_update;
   /*! \brief some information indicator of the tree, reserved */
   std::vector<int> tree_info;
+  /*! \brief flattened copy of trees, kept in sync with trees */
+  CompiledTrees compiled_trees;
 };
 }  // namespace gbm
 }  // namespace xgboost
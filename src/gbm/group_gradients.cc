@@ -0,0 +1,50 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file group_gradients.cc
+ * \brief the split of the gradients on the host.
+ */
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include "./group_gradients.h"
+
+namespace xgboost {
+namespace gbm {
+void GroupGradients::Resize(size_t nrow, int ngroup, int device) {
+  groups_.resize(ngroup);
+  for (auto& group : groups_) {
+    if (group == nullptr) {
+      group.reset(new HostDeviceVector<bst_gpair>(nrow, bst_gpair(), device));
+    } else if (group->size() != nrow || group->device() != device) {
+      group->resize(nrow, bst_gpair(), device);
+    }
+  }
+}
+
+void GroupGradients::SplitHost(HostDeviceVector<bst_gpair>* in_gpair, int ngroup) {
+  const size_t nrow = in_gpair->size() / ngroup;
+  this->Resize(nrow, ngroup, in_gpair->device());
+  const bst_gpair* in = dmlc::BeginPtr(in_gpair->const_data_h());
+  std::vector<bst_gpair*> out(ngroup);
+  for (int gid = 0; gid < ngroup; ++gid) {
+    out[gid] = groups_[gid]->ptr_h();
+  }
+  // the gradients of a row are read together
+  const bst_omp_uint nsize = static_cast<bst_omp_uint>(nrow);
+  #pragma omp parallel for schedule(static)
+  for (bst_omp_uint i = 0; i < nsize; ++i) {
+    const bst_gpair* row = in + static_cast<size_t>(i) * ngroup;
+    for (int gid = 0; gid < ngroup; ++gid) {
+      out[gid][i] = row[gid];
+    }
+  }
+}
+
+#ifndef XGBOOST_USE_CUDA
+void GroupGradients::Split(HostDeviceVector<bst_gpair>* in_gpair, int ngroup) {
+  CHECK_EQ(in_gpair->size() % ngroup, 0U)
+      << "must have exactly ngroup*nrow gpairs";
+  this->SplitHost(in_gpair, ngroup);
+}
+#endif
+}  // namespace gbm
+}  // namespace xgboost
@@ -0,0 +1,32 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file group_gradients.cu
+ * \brief the split of the gradients on their device.
+ */
+#include <xgboost/logging.h>
+#include "../common/device_helpers.cuh"
+#include "./group_gradients.h"
+
+namespace xgboost {
+namespace gbm {
+void GroupGradients::Split(HostDeviceVector<bst_gpair>* in_gpair, int ngroup) {
+  CHECK_EQ(in_gpair->size() % ngroup, 0U)
+      << "must have exactly ngroup*nrow gpairs";
+  const int device = in_gpair->device();
+  if (device < 0) {
+    this->SplitHost(in_gpair, ngroup);
+    return;
+  }
+  const size_t nrow = in_gpair->size() / ngroup;
+  this->Resize(nrow, ngroup, device);
+  const bst_gpair* in = in_gpair->const_ptr_d(device);
+  for (int gid = 0; gid < ngroup; ++gid) {
+    bst_gpair* out = groups_[gid]->ptr_d(device);
+    dh::launch_n(device, nrow, [=] __device__(size_t i) {
+      out[i] = in[i * ngroup + gid];
+    });
+  }
+  dh::safe_cuda(cudaGetLastError());
+}
+}  // namespace gbm
+}  // namespace xgboost
@@ -0,0 +1,44 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file group_gradients.h
+ * \brief the gradients of each output group, split from the gradients of the
+ *  rows, in which the groups are interleaved.
+ */
+#ifndef XGBOOST_GBM_GROUP_GRADIENTS_H_
+#define XGBOOST_GBM_GROUP_GRADIENTS_H_
+
+#include <xgboost/base.h>
+#include <memory>
+#include <vector>
+#include "../common/host_device_vector.h"
+
+namespace xgboost {
+namespace gbm {
+/*!
+ * \brief the gradients of the groups, kept from one iteration to the next so
+ *  that they are not allocated again. All the groups are split in one pass
+ *  over the gradients, on the device of the gradients when they have one, so
+ *  that the gradients of a GPU objective are not copied to the host.
+ */
+class GroupGradients {
+ public:
+  /*!
+   * \brief split the gradients of the rows into the gradients of the groups
+   * \param in_gpair ngroup gradients per row
+   * \param ngroup number of groups
+   */
+  void Split(HostDeviceVector<bst_gpair>* in_gpair, int ngroup);
+  /*! \brief the gradients of group gid, valid until the next Split */
+  inline HostDeviceVector<bst_gpair>* Group(int gid) {
+    return groups_[gid].get();
+  }
+
+ private:
+  // size the groups to nrow on device, before they are written
+  void Resize(size_t nrow, int ngroup, int device);
+  void SplitHost(HostDeviceVector<bst_gpair>* in_gpair, int ngroup);
+  std::vector<std::unique_ptr<HostDeviceVector<bst_gpair> > > groups_;
+};
+}  // namespace gbm
+}  // namespace xgboost
+#endif  // XGBOOST_GBM_GROUP_GRADIENTS_H_
@@ -8,9 +8,12 @@
 #include <dmlc/timer.h>
 #include <xgboost/learner.h>
 #include <xgboost/logging.h>
+#include <xgboost/predictor.h>
 #include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <limits>
+#include <map>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -18,7 +21,10 @@
 #include "./common/common.h"
 #include "./common/host_device_vector.h"
 #include "./common/io.h"
+#include "./common/memory_tracker.h"
 #include "./common/random.h"
+#include "./data/row_sample.h"
+#include "./tree/cost_model.h"
 #include "common/timer.h"
 
 namespace xgboost {
@@ -33,6 +39,35 @@ std::vector<std::string> Learner::DumpModel(const FeatureMap& fmap,
   return gbm_->DumpModel(fmap, with_stats, format);
 }
 
+void Learner::DumpModel(const FeatureMap& fmap,
+                        bool with_stats,
+                        std::string format,
+                        const std::function<void(const std::string&)>& visit) const {
+  gbm_->DumpModelTo(fmap, with_stats, format, visit);
+}
+
+void Learner::DumpModel(const FeatureMap& fmap,
+                        bool with_stats,
+                        std::string format,
+                        dmlc::Stream* fo) const {
+  const bool json = format == "json" || format == "json_compact";
+  size_t nbooster = 0;
+  if (json) fo->Write("[\n", 2);
+  this->DumpModel(fmap, with_stats, format, [&](const std::string& dump) {
+    std::ostringstream os;
+    if (json) {
+      if (nbooster != 0) os << ",\n";
+    } else if (format != "c") {
+      os << "booster[" << nbooster << "]:\n";
+    }
+    const std::string head = os.str();
+    fo->Write(head.c_str(), head.length());
+    fo->Write(dump.c_str(), dump.length());
+    ++nbooster;
+  });
+  if (json) fo->Write("\n]\n", 3);
+}
+
 /*! \brief training parameter for regression */
 struct LearnerModelParam : public dmlc::Parameter<LearnerModelParam> {
   /* \brief global bias */
@@ -88,6 +123,18 @@ struct LearnerTrainParam : public dmlc::Parameter<LearnerTrainParam> {
   int nthread;
   // flag to print out detailed breakdown of runtime
   int debug_verbose;
+  // number of rows of each evaluation set the metrics are computed on
+  size_t eval_sample_rows;
+  // whether the evaluation sample keeps the fraction of each label
+  bool eval_sample_stratify;
+  // evaluations without improvement before the training stops, 0 means no early stopping
+  int early_stopping_rounds;
+  // metric watched by the early stopping, the last metric when empty
+  std::string early_stopping_metric;
+  // evaluation set watched by the early stopping, the last set when empty
+  std::string early_stopping_data;
+  // file the Chrome trace of the timings is written to, empty means no trace
+  std::string trace_file;
   // declare parameters
   DMLC_DECLARE_PARAMETER(LearnerTrainParam) {
     DMLC_DECLARE_FIELD(seed).set_default(0).describe(
@@ -123,11 +170,38 @@ struct LearnerTrainParam : public dmlc::Parameter<LearnerTrainParam> {
         .set_default(std::numeric_limits<size_t>::max())
         .describe("maximum row per batch.");
     DMLC_DECLARE_FIELD(nthread).set_default(0).describe(
-        "Number of threads to use.");
+        "Number of threads used by the calls of the booster, 0 uses the "
+        "number of threads of the calling thread.");
     DMLC_DECLARE_FIELD(debug_verbose)
         .set_lower_bound(0)
         .set_default(0)
-        .describe("flag to print out detailed breakdown of runtime");
+        .describe("flag to print out detailed breakdown of runtime and of "
+                  "the memory of each component after every iteration");
+    DMLC_DECLARE_FIELD(eval_sample_rows)
+        .set_default(0)
+        .describe("Evaluate the metrics of larger evaluation sets on a fixed random "
+                  "sample of this many rows, with their standard errors. "
+                  "0 evaluates all the rows.");
+    DMLC_DECLARE_FIELD(eval_sample_stratify)
+        .set_default(false)
+        .describe("Whether the evaluation sample keeps the fraction of each label.");
+    DMLC_DECLARE_FIELD(early_stopping_rounds)
+        .set_default(0)
+        .set_lower_bound(0)
+        .describe("Stop the training when the watched metric has not improved for "
+                  "this many evaluations, 0 disables early stopping.");
+    DMLC_DECLARE_FIELD(early_stopping_metric)
+        .set_default("")
+        .describe("Metric watched by the early stopping, the last metric by default.");
+    DMLC_DECLARE_FIELD(early_stopping_data)
+        .set_default("")
+        .describe("Name of the evaluation set watched by the early stopping, "
+                  "the last evaluated set by default.");
+    DMLC_DECLARE_FIELD(trace_file)
+        .set_default("")
+        .describe("File the timings of every phase of every thread and device are "
+                  "written to in the Chrome trace event format when the booster is "
+                  "freed, empty means no trace.");
   }
 };
 
@@ -141,11 +215,18 @@ DMLC_REGISTER_PARAMETER(LearnerTrainParam);
 class LearnerImpl : public Learner {
  public:
   explicit LearnerImpl(const std::vector<std::shared_ptr<DMatrix> >& cache)
-      : cache_(cache) {
+      : cache_(cache), best_iteration_(-1), best_score_(0.0f), early_stopped_(false) {
     // boosted tree
     name_obj_ = "reg:linear";
     name_gbm_ = "gbtree";
   }
+  ~LearnerImpl() {
+    if (tparam.trace_file.length() == 0) return;
+    const std::string trace = common::Profiler::Get()->TraceJSON();
+    common::Profiler::Get()->SetTracing(false);
+    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(tparam.trace_file.c_str(), "w"));
+    fo->Write(trace.data(), trace.length());
+  }
 
   static void AssertGPUSupport() {
 #ifndef XGBOOST_USE_CUDA
@@ -196,6 +277,7 @@ class LearnerImpl : public Learner {
     // add to configurations
     tparam.InitAllowUnknown(args);
     monitor.Init("Learner", tparam.debug_verbose);
+    if (tparam.trace_file.length() != 0) common::Profiler::Get()->SetTracing(true);
     cfg_.clear();
     for (const auto& kv : args) {
       if (kv.first == "eval_metric") {
@@ -211,10 +293,6 @@ class LearnerImpl : public Learner {
         cfg_[kv.first] = kv.second;
       }
     }
-    if (tparam.nthread != 0) {
-      omp_set_num_threads(tparam.nthread);
-    }
-
     // add additional parameters
     // These are cosntraints that need to be satisfied.
     if (tparam.dsplit == 0 && rabit::IsDistributed()) {
@@ -302,7 +380,7 @@ class LearnerImpl : public Learner {
     CHECK(fi->Read(&name_gbm_)) << "BoostLearner: wrong model format";
     // duplicated code with LazyInitModel
     obj_.reset(ObjFunction::Create(name_obj_));
-    gbm_.reset(GradientBooster::Create(name_gbm_, cache_, mparam.base_score));
+    gbm_.reset(GradientBooster::Create(name_gbm_, this->BoosterCache(), mparam.base_score));
     gbm_->Load(fi);
     if (mparam.contain_extra_attrs != 0) {
       std::vector<std::pair<std::string, std::string> > attr;
@@ -310,6 +388,13 @@ class LearnerImpl : public Learner {
       attributes_ =
           std::map<std::string, std::string>(attr.begin(), attr.end());
     }
+    // the early stopping goes on from the best iteration of the model
+    best_iteration_ = -1;
+    early_stopped_ = false;
+    if (attributes_.count("best_iteration") != 0 && attributes_.count("best_score") != 0) {
+      best_iteration_ = std::stoi(attributes_["best_iteration"]);
+      best_score_ = std::stof(attributes_["best_score"]);
+    }
     if (name_obj_ == "count:poisson") {
       std::string max_delta_step;
       fi->Read(&max_delta_step);
@@ -353,6 +438,8 @@ class LearnerImpl : public Learner {
   }
 
   void UpdateOneIter(int iter, DMatrix* train) override {
+    common::OMPThreadScope threads(tparam.nthread);
+    common::Profiler::Get()->Clear();
     monitor.Start("UpdateOneIter");
     CHECK(ModelInitialized())
         << "Always call InitModel or LoadModel before update";
@@ -368,12 +455,16 @@ class LearnerImpl : public Learner {
     std::cout << "preds_.size() = " << preds_.size() << std::endl;
     obj_->GetGradient(&preds_, train->info(), iter, &gpair_);
     monitor.Stop("GetGradient");
+    monitor.AddCount("rows", train->info().num_row);
     gbm_->DoBoost(train, &gpair_, obj_.get());
     monitor.Stop("UpdateOneIter");
+    if (tparam.debug_verbose) common::MemoryTracker::Get()->Print();
   }
 
   void BoostOneIter(int iter, DMatrix* train,
                     HostDeviceVector<bst_gpair>* in_gpair) override {
+    common::OMPThreadScope threads(tparam.nthread);
+    common::Profiler::Get()->Clear();
     monitor.Start("BoostOneIter");
     if (tparam.seed_per_iteration || rabit::IsDistributed()) {
       common::GlobalRandom().seed(tparam.seed * kRandSeedMagic + iter);
@@ -381,30 +472,86 @@ class LearnerImpl : public Learner {
     this->LazyInitDMatrix(train);
     gbm_->DoBoost(train, in_gpair);
     monitor.Stop("BoostOneIter");
+    monitor.AddCount("rows", train->info().num_row);
+    if (tparam.debug_verbose) common::MemoryTracker::Get()->Print();
   }
 
   std::string EvalOneIter(int iter, const std::vector<DMatrix*>& data_sets,
                           const std::vector<std::string>& data_names) override {
-    monitor.Start("EvalOneIter");
+    std::vector<bst_float> results, stderrs;
+    this->EvalDataSets(iter, data_sets, data_names, &results, &stderrs);
     std::ostringstream os;
     os << '[' << iter << ']' << std::setiosflags(std::ios::fixed);
-    if (metrics_.size() == 0) {
-      metrics_.emplace_back(Metric::Create(obj_->DefaultEvalMetric()));
-    }
     for (size_t i = 0; i < data_sets.size(); ++i) {
-      this->PredictRaw(data_sets[i], &preds_);
-      obj_->EvalTransform(&preds_);
-      for (auto& ev : metrics_) {
-        os << '\t' << data_names[i] << '-' << ev->Name() << ':'
-           << ev->Eval(preds_.data_h(), data_sets[i]->info(),
-                       tparam.dsplit == 2);
+      const bool sampled = this->GetEvalSample(data_sets[i]) != nullptr;
+      for (size_t k = 0; k < metrics_.size(); ++k) {
+        const size_t j = i * metrics_.size() + k;
+        // the standard error goes first, the entry of the metric stays last
+        if (sampled) {
+          os << '\t' << data_names[i] << '-' << metrics_[k]->Name() << "-stderr:"
+             << stderrs[j];
+        }
+        os << '\t' << data_names[i] << '-' << metrics_[k]->Name() << ':'
+           << results[j];
       }
     }
-
-    monitor.Stop("EvalOneIter");
     return os.str();
   }
 
+  void EvalOneIter(int iter, const std::vector<DMatrix*>& data_sets,
+                   const std::vector<std::string>& data_names,
+                   std::vector<bst_float>* out_results) override {
+    std::vector<bst_float> stderrs;
+    this->EvalDataSets(iter, data_sets, data_names, out_results, &stderrs);
+  }
+
+  std::vector<std::string> GetMetricNames() const override {
+    std::vector<std::string> names;
+    for (const auto& m : metrics_) names.emplace_back(m->Name());
+    // the default metric is only created by the first evaluation
+    if (names.size() == 0 && obj_ != nullptr) names.emplace_back(obj_->DefaultEvalMetric());
+    return names;
+  }
+
+  bool EarlyStopped() const override {
+    return early_stopped_;
+  }
+
+  Learner* Slice(int layer_begin, int layer_end, int group) const override {
+    CHECK(gbm_.get() != nullptr) << "Slice must happen after Load or InitModel";
+    std::unique_ptr<LearnerImpl> out(
+        new LearnerImpl(std::vector<std::shared_ptr<DMatrix> >()));
+    out->mparam = mparam;
+    out->tparam = tparam;
+    out->cfg_ = cfg_;
+    out->attributes_ = attributes_;
+    out->name_gbm_ = name_gbm_;
+    out->name_obj_ = name_obj_;
+    // the best round of the early stopping is the one of the whole model
+    for (const char* key : {"best_iteration", "best_score", "best_ntree_limit"}) {
+      out->attributes_.erase(key);
+    }
+    if (group >= 0 && mparam.num_class > 1) {
+      // a single output group predicts its margin
+      out->name_obj_ = "reg:linear";
+      out->mparam.num_class = 0;
+      out->mparam.contain_eval_metrics = 0;
+      out->cfg_["objective"] = out->name_obj_;
+      out->cfg_["num_class"] = "0";
+      out->cfg_.erase("num_output_group");
+    } else {
+      for (const auto& m : metrics_) {
+        out->metrics_.emplace_back(Metric::Create(m->Name()));
+      }
+    }
+    out->obj_.reset(ObjFunction::Create(out->name_obj_));
+    out->obj_->Configure(out->cfg_.begin(), out->cfg_.end());
+    out->gbm_.reset(GradientBooster::Create(name_gbm_, out->BoosterCache(), mparam.base_score));
+    gbm_->Slice(layer_begin, layer_end, group, out->gbm_.get());
+    out->gbm_->Configure(out->cfg_.begin(), out->cfg_.end());
+    return out.release();
+  }
+
   void SetAttr(const std::string& key, const std::string& value) override {
     attributes_[key] = value;
     mparam.contain_extra_attrs = 1;
@@ -435,18 +582,22 @@ class LearnerImpl : public Learner {
 
   std::pair<std::string, bst_float> Evaluate(DMatrix* data,
                                              std::string metric) {
+    common::OMPThreadScope threads(tparam.nthread);
     if (metric == "auto") metric = obj_->DefaultEvalMetric();
-    std::unique_ptr<Metric> ev(Metric::Create(metric.c_str()));
+    std::vector<std::unique_ptr<Metric> > ev;
+    ev.emplace_back(Metric::Create(metric.c_str()));
     this->PredictRaw(data, &preds_);
     obj_->EvalTransform(&preds_);
-    return std::make_pair(
-        metric, ev->Eval(preds_.data_h(), data->info(), tparam.dsplit == 2));
+    std::vector<bst_float> result;
+    Metric::EvalAll(ev, &preds_, data->info(), tparam.dsplit == 2, &result);
+    return std::make_pair(metric, result[0]);
   }
 
   void Predict(DMatrix* data, bool output_margin,
                HostDeviceVector<bst_float>* out_preds, unsigned ntree_limit,
                bool pred_leaf, bool pred_contribs, bool approx_contribs,
                bool pred_interactions) const override {
+    common::OMPThreadScope threads(tparam.nthread);
     if (pred_contribs) {
       gbm_->PredictContribution(data, &out_preds->data_h(), ntree_limit,
                                 approx_contribs);
@@ -463,10 +614,59 @@ class LearnerImpl : public Learner {
     }
   }
 
+  void PredictLeafIndex(DMatrix* data, unsigned ntree_limit,
+                        const LeafIndexCallback& callback) const override {
+    common::OMPThreadScope threads(tparam.nthread);
+    CHECK(gbm_.get() != nullptr)
+        << "Predict must happen after Load or InitModel";
+    gbm_->PredictLeafIndex(data, ntree_limit, callback);
+  }
+
+  void Predict(DMatrix* data, bool output_margin,
+               HostDeviceVector<bst_float>* out_preds, unsigned ntree_limit,
+               PredictionContext* ctx) const override {
+    common::OMPThreadScope threads(tparam.nthread);
+    CHECK(gbm_.get() != nullptr)
+        << "Predict must happen after Load or InitModel";
+    gbm_->PredictBatch(data, out_preds, ntree_limit, ctx);
+    if (!output_margin) {
+      obj_->PredTransform(out_preds);
+    }
+  }
+
  protected:
   // check if p_train is ready to used by training.
   // if not, initialize the column access.
+  // tree_method=auto picks the cheapest method by the cost model, unless the
+  // updaters are given or the training is distributed
+  inline void SelectTreeMethod(DMatrix* p_train) {
+    if (cfg_.count("updater") != 0 || tparam.dsplit != 0 || name_gbm_ == "gblinear") {
+      return;
+    }
+    const int max_depth = cfg_.count("max_depth") != 0 ? std::stoi(cfg_["max_depth"]) : 6;
+    const int max_bin = cfg_.count("max_bin") != 0 ? std::stoi(cfg_["max_bin"]) : 256;
+    int ngpu = common::AllVisibleGPUs();
+    if (cfg_.count("n_gpus") != 0 && std::stoi(cfg_["n_gpus"]) >= 0) {
+      ngpu = std::min(ngpu, std::stoi(cfg_["n_gpus"]));
+    }
+    const tree::TreeMethodCost cost = tree::TreeMethodCost::Estimate(
+        p_train->info(), omp_get_max_threads(), max_depth, max_bin, ngpu);
+    const std::string method = cost.Best();
+    LOG(CONSOLE) << "Tree method is automatically selected to be \'" << method
+                 << "\', the estimated cost of an iteration in millions of entry visits"
+                 << " per thread is " << cost.ToString();
+    tparam.tree_method = method == "hist" ? 3 : (method == "gpu_hist" ? 5 : 2);
+    cfg_["tree_method"] = method;
+    this->ConfigureUpdaters();
+    if (gbm_.get() != nullptr) {
+      gbm_->Configure(cfg_.begin(), cfg_.end());
+    }
+  }
+
   inline void LazyInitDMatrix(DMatrix* p_train) {
+    if (tparam.tree_method == 0) {
+      this->SelectTreeMethod(p_train);
+    }
     if (tparam.tree_method == 3 || tparam.tree_method == 4 ||
         tparam.tree_method == 5 || name_gbm_ == "gblinear") {
       return;
@@ -518,6 +718,161 @@ class LearnerImpl : public Learner {
     monitor.Stop("LazyInitDMatrix");
   }
 
+  // evaluate the metrics on each data set, with their standard errors on the
+  // sampled sets, then track the best iteration of the early stopping
+  inline void EvalDataSets(int iter, const std::vector<DMatrix*>& data_sets,
+                           const std::vector<std::string>& data_names,
+                           std::vector<bst_float>* out_results,
+                           std::vector<bst_float>* out_stderrs) {
+    common::OMPThreadScope threads(tparam.nthread);
+    monitor.Start("EvalOneIter");
+    CHECK_EQ(data_sets.size(), data_names.size());
+    if (metrics_.size() == 0) {
+      metrics_.emplace_back(Metric::Create(obj_->DefaultEvalMetric()));
+    }
+    out_results->clear();
+    out_stderrs->clear();
+    std::vector<bst_float> results, stderrs;
+    for (size_t i = 0; i < data_sets.size(); ++i) {
+      const data::RowSample* sample = this->GetEvalSample(data_sets[i]);
+      DMatrix* dmat = sample != nullptr ? sample->dmat.get() : data_sets[i];
+      this->PredictRaw(dmat, &preds_);
+      obj_->EvalTransform(&preds_);
+      Metric::EvalAll(metrics_, &preds_, dmat->info(), tparam.dsplit == 2, &results);
+      if (sample != nullptr) {
+        this->EvalStdErr(*sample, &stderrs);
+      } else {
+        stderrs.assign(metrics_.size(), std::numeric_limits<bst_float>::quiet_NaN());
+      }
+      out_results->insert(out_results->end(), results.begin(), results.end());
+      out_stderrs->insert(out_stderrs->end(), stderrs.begin(), stderrs.end());
+    }
+    this->TrackEarlyStopping(iter, data_names, *out_results);
+    monitor.Stop("EvalOneIter");
+  }
+  // keep the best iteration of the watched metric, and stop once it is too old
+  inline void TrackEarlyStopping(int iter, const std::vector<std::string>& data_names,
+                                 const std::vector<bst_float>& results) {
+    if (tparam.early_stopping_rounds == 0 || data_names.size() == 0) return;
+    size_t set = data_names.size() - 1;
+    if (tparam.early_stopping_data.length() != 0) {
+      auto it = std::find(data_names.begin(), data_names.end(), tparam.early_stopping_data);
+      CHECK(it != data_names.end())
+          << "early_stopping_data " << tparam.early_stopping_data << " is not evaluated";
+      set = it - data_names.begin();
+    }
+    size_t metric = metrics_.size() - 1;
+    if (tparam.early_stopping_metric.length() != 0) {
+      auto match = [this](const std::unique_ptr<Metric>& m) {
+        return tparam.early_stopping_metric == m->Name();
+      };
+      auto it = std::find_if(metrics_.begin(), metrics_.end(), match);
+      CHECK(it != metrics_.end())
+          << "early_stopping_metric " << tparam.early_stopping_metric << " is not evaluated";
+      metric = it - metrics_.begin();
+    }
+    const bst_float score = results[set * metrics_.size() + metric];
+    const bool better = metrics_[metric]->Maximize() ? score > best_score_ : score < best_score_;
+    if (best_iteration_ < 0 || iter < best_iteration_ || better) {
+      best_iteration_ = iter;
+      best_score_ = score;
+      const int num_parallel_tree = cfg_.count("num_parallel_tree") != 0 ?
+          std::atoi(cfg_["num_parallel_tree"].c_str()) : 1;
+      std::ostringstream os;
+      os << std::setprecision(std::numeric_limits<bst_float>::max_digits10) << score;
+      this->SetAttr("best_iteration", common::ToString(iter));
+      this->SetAttr("best_score", os.str());
+      this->SetAttr("best_ntree_limit", common::ToString((iter + 1) * num_parallel_tree));
+    }
+    early_stopped_ = iter - best_iteration_ >= tparam.early_stopping_rounds;
+  }
+  // get the evaluation sample of a matrix, nullptr when all its rows are evaluated
+  inline const data::RowSample* GetEvalSample(DMatrix* dmat) {
+    if (tparam.eval_sample_rows == 0 ||
+        dmat->info().num_row <= tparam.eval_sample_rows) {
+      return nullptr;
+    }
+    auto it = eval_samples_.find(dmat);
+    // the matrix was freed and another one took its address, or rows were appended
+    if (it != eval_samples_.end() && (it->second.source.lock().get() != dmat ||
+                                      it->second.rows.source_rows != dmat->info().num_row)) {
+      eval_samples_.erase(it);
+      it = eval_samples_.end();
+    }
+    if (it == eval_samples_.end()) {
+      // only the matrices of the cache are sampled, the sample of a matrix
+      // is then dropped before another one can take its address
+      auto cached = std::find_if(cache_.begin(), cache_.end(),
+                                 [dmat](const std::shared_ptr<DMatrix>& d) {
+                                   return d.get() == dmat;
+                                 });
+      if (cached == cache_.end()) return nullptr;
+      EvalSample& sample = eval_samples_[dmat];
+      sample.source = *cached;
+      data::SampleRows(dmat, tparam.eval_sample_rows, tparam.eval_sample_stratify,
+                       static_cast<unsigned>(tparam.seed), kEvalSampleFolds, &sample.rows);
+      return &sample.rows;
+    }
+    return &it->second.rows;
+  }
+  // the matrices of the booster prediction cache, with the samples of the cached
+  // matrices so their predictions are updated with each new tree
+  inline std::vector<std::shared_ptr<DMatrix> > BoosterCache() {
+    std::vector<std::shared_ptr<DMatrix> > cache = cache_;
+    for (const std::shared_ptr<DMatrix>& d : cache_) {
+      const data::RowSample* sample = this->GetEvalSample(d.get());
+      if (sample != nullptr) cache.push_back(sample->dmat);
+    }
+    return cache;
+  }
+  // standard errors of the metrics on a sample, from the spread of the folds
+  inline void EvalStdErr(const data::RowSample& sample, std::vector<bst_float>* out) {
+    std::vector<MetaInfo> fold_info(sample.nfold);
+    std::vector<std::vector<bst_float> > fold_preds(sample.nfold);
+    // whether a fold is empty on any worker, then the lowest and the highest
+    // label of each fold, negated for the lowest, all reduced with max
+    std::vector<double> check(1 + 2 * sample.nfold, -std::numeric_limits<double>::infinity());
+    check[0] = 0.0;
+    for (unsigned k = 0; k < sample.nfold; ++k) {
+      data::SelectFold(sample, k, preds_.const_data_h(), &fold_info[k], &fold_preds[k]);
+      const std::vector<bst_float>& labels = fold_info[k].labels;
+      if (labels.size() == 0) check[0] = 1.0;
+      for (bst_float label : labels) {
+        check[1 + 2 * k] = std::max(check[1 + 2 * k], -static_cast<double>(label));
+        check[2 + 2 * k] = std::max(check[2 + 2 * k], static_cast<double>(label));
+      }
+    }
+    // the workers agree on the folds before the metrics run their collectives
+    if (tparam.dsplit == 2) {
+      rabit::Allreduce<rabit::op::Max>(dmlc::BeginPtr(check), check.size());
+    }
+    bool unusable = check[0] != 0.0;
+    for (unsigned k = 0; k < sample.nfold; ++k) {
+      unusable = unusable || -check[1 + 2 * k] == check[2 + 2 * k];
+    }
+    if (unusable) {
+      // a fold too small for a metric, such as a fold without positives for auc
+      out->assign(metrics_.size(), std::numeric_limits<bst_float>::quiet_NaN());
+      return;
+    }
+    std::vector<double> sum(metrics_.size(), 0.0), sum_sq(metrics_.size(), 0.0);
+    std::vector<bst_float> fold_results;
+    for (unsigned k = 0; k < sample.nfold; ++k) {
+      Metric::EvalAll(metrics_, fold_preds[k], fold_info[k], tparam.dsplit == 2, &fold_results);
+      for (size_t m = 0; m < metrics_.size(); ++m) {
+        sum[m] += fold_results[m];
+        sum_sq[m] += static_cast<double>(fold_results[m]) * fold_results[m];
+      }
+    }
+    // the sample has nfold times the rows of a fold, so the variance of its
+    // metric is about a fraction 1 / nfold of the variance between the folds
+    const double nfold = sample.nfold;
+    out->resize(metrics_.size());
+    for (size_t m = 0; m < metrics_.size(); ++m) {
+      const double var = std::max(0.0, (sum_sq[m] - sum[m] * sum[m] / nfold) / (nfold - 1));
+      (*out)[m] = static_cast<bst_float>(std::sqrt(var / nfold));
+    }
+  }
   // return whether model is already initialized.
   inline bool ModelInitialized() const { return gbm_.get() != nullptr; }
   // lazily initialize the model if it haven't yet been initialized.
@@ -543,7 +898,7 @@ class LearnerImpl : public Learner {
     obj_->Configure(cfg_.begin(), cfg_.end());
     // reset the base score
     mparam.base_score = obj_->ProbToMargin(mparam.base_score);
-    gbm_.reset(GradientBooster::Create(name_gbm_, cache_, mparam.base_score));
+    gbm_.reset(GradientBooster::Create(name_gbm_, this->BoosterCache(), mparam.base_score));
     gbm_->Configure(cfg_.begin(), cfg_.end());
   }
   /*!
@@ -580,12 +935,71 @@ class LearnerImpl : public Learner {
  private:
   /*! \brief random number transformation seed. */
   static const int kRandSeedMagic = 127;
+  /*! \brief number of folds of an evaluation sample */
+  static const unsigned kEvalSampleFolds = 10;
   // internal cached dmatrix
   std::vector<std::shared_ptr<DMatrix> > cache_;
+  // fixed row sample of an evaluation matrix of the cache
+  struct EvalSample {
+    std::weak_ptr<DMatrix> source;
+    data::RowSample rows;
+  };
+  std::map<DMatrix*, EvalSample> eval_samples_;
+  // best iteration of the metric watched by the early stopping, -1 before the first
+  int best_iteration_;
+  bst_float best_score_;
+  // whether the watched metric has not improved for early_stopping_rounds evaluations
+  bool early_stopped_;
 
   common::Monitor monitor;
 };
 
+void Learner::PredictMulti(const std::vector<const Learner*>& learners,
+                           DMatrix* data,
+                           bool output_margin,
+                           unsigned ntree_limit,
+                           std::vector<bst_float>* out_preds,
+                           std::vector<size_t>* out_offsets) {
+  const MetaInfo& info = data->info();
+  std::vector<HostDeviceVector<bst_float> > preds(learners.size());
+  std::vector<const gbm::GBTreeModel*> models;
+  std::vector<bst_float*> margins;
+  for (size_t k = 0; k < learners.size(); ++k) {
+    GradientBooster* gbm = learners[k]->gbm_.get();
+    CHECK(gbm != nullptr) << "Predict must happen after Load or InitModel";
+    const gbm::GBTreeModel* model = gbm->TreeModel();
+    if (model == nullptr) {
+      gbm->PredictBatch(data, &preds[k], ntree_limit);
+      continue;
+    }
+    // the margins start from the base margin, as in the predictors
+    const size_t n = model->param.num_output_group * info.num_row;
+    preds[k].resize(n);
+    std::vector<bst_float>& margin = preds[k].data_h();
+    if (info.base_margin.size() != 0) {
+      CHECK_EQ(info.base_margin.size(), n);
+      std::copy(info.base_margin.begin(), info.base_margin.end(), margin.begin());
+    } else {
+      std::fill(margin.begin(), margin.end(), model->base_margin);
+    }
+    models.push_back(model);
+    margins.push_back(dmlc::BeginPtr(margin));
+  }
+  if (models.size() != 0) {
+    Predictor::PredictMultiModel(data, models, ntree_limit, margins);
+  }
+  out_preds->clear();
+  out_offsets->assign(1, 0);
+  for (size_t k = 0; k < learners.size(); ++k) {
+    if (!output_margin) {
+      learners[k]->obj_->PredTransform(&preds[k]);
+    }
+    const std::vector<bst_float>& pred = preds[k].data_h();
+    out_preds->insert(out_preds->end(), pred.begin(), pred.end());
+    out_offsets->push_back(out_preds->size());
+  }
+}
+
 Learner* Learner::Create(
     const std::vector<std::shared_ptr<DMatrix> >& cache_data) {
   return new LearnerImpl(cache_data);
@@ -8,6 +8,7 @@
 #include <utility>
 #include <vector>
 #include <limits>
+#include "../common/blocked_sum.h"
 #include "../common/random.h"
 
 namespace xgboost {
@@ -81,6 +82,34 @@ inline std::pair<double, double> GetGradient(int group_idx, int num_group, int f
   return std::make_pair(sum_grad, sum_hess);
 }
 
+/**
+ * \brief Get the gradient with respect to a single feature over one column,
+ *        or the part of a column in a page. Row-wise multithreaded.
+ *
+ * \param group_idx Zero-based index of the group.
+ * \param num_group Number of groups.
+ * \param col       The entries of the feature.
+ * \param gpair     Gradients.
+ *
+ * \return  The gradient and diagonal Hessian entry for the entries.
+ */
+inline std::pair<double, double> GetColumnGradientParallel(int group_idx, int num_group,
+                                                           const ColBatch::Inst &col,
+                                                           const std::vector<bst_gpair> &gpair) {
+  // summed by blocks, the same way for any number of threads
+  double sum[2];
+  common::BlockedSum(col.length, 2, [&](size_t begin, size_t end, double* out) {
+      for (size_t j = begin; j < end; ++j) {
+        const bst_float v = col[j].fvalue;
+        auto &p = gpair[col[j].index * num_group + group_idx];
+        if (p.GetHess() < 0.0f) continue;
+        out[0] += p.GetGrad() * v;
+        out[1] += p.GetHess() * v * v;
+      }
+    }, sum);
+  return std::make_pair(sum[0], sum[1]);
+}
+
 /**
  * \brief Get the gradient with respect to a single feature. Row-wise multithreaded.
  *
@@ -98,17 +127,9 @@ inline std::pair<double, double> GetGradientParallel(int group_idx, int num_grou
   double sum_grad = 0.0, sum_hess = 0.0;
   dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator({static_cast<bst_uint>(fidx)});
   while (iter->Next()) {
-    const ColBatch &batch = iter->Value();
-    ColBatch::Inst col = batch[0];
-    const bst_omp_uint ndata = static_cast<bst_omp_uint>(col.length);
-#pragma omp parallel for schedule(static) reduction(+ : sum_grad, sum_hess)
-    for (bst_omp_uint j = 0; j < ndata; ++j) {
-      const bst_float v = col[j].fvalue;
-      auto &p = gpair[col[j].index * num_group + group_idx];
-      if (p.GetHess() < 0.0f) continue;
-      sum_grad += p.GetGrad() * v;
-      sum_hess += p.GetHess() * v * v;
-    }
+    auto grad = GetColumnGradientParallel(group_idx, num_group, iter->Value()[0], gpair);
+    sum_grad += grad.first;
+    sum_hess += grad.second;
   }
   return std::make_pair(sum_grad, sum_hess);
 }
@@ -127,17 +148,41 @@ inline std::pair<double, double> GetBiasGradientParallel(int group_idx, int num_
                                                          const std::vector<bst_gpair> &gpair,
                                                          DMatrix *p_fmat) {
   const RowSet &rowset = p_fmat->buffered_rowset();
-  double sum_grad = 0.0, sum_hess = 0.0;
-  const bst_omp_uint ndata = static_cast<bst_omp_uint>(rowset.size());
-#pragma omp parallel for schedule(static) reduction(+ : sum_grad, sum_hess)
-  for (bst_omp_uint i = 0; i < ndata; ++i) {
-    auto &p = gpair[rowset[i] * num_group + group_idx];
-    if (p.GetHess() >= 0.0f) {
-      sum_grad += p.GetGrad();
-      sum_hess += p.GetHess();
-    }
+  double sum[2];
+  common::BlockedSum(rowset.size(), 2, [&](size_t begin, size_t end, double* out) {
+      for (size_t i = begin; i < end; ++i) {
+        auto &p = gpair[rowset[i] * num_group + group_idx];
+        if (p.GetHess() >= 0.0f) {
+          out[0] += p.GetGrad();
+          out[1] += p.GetHess();
+        }
+      }
+    }, sum);
+  return std::make_pair(sum[0], sum[1]);
+}
+
+/**
+ * \brief Updates the gradient vector of the rows of one column, or the part of
+ *        a column in a page, with respect to a change in weight.
+ *
+ * \param col       The entries of the feature.
+ * \param group_idx Zero-based index of the group.
+ * \param num_group Number of groups.
+ * \param dw        The change in weight.
+ * \param in_gpair  The gradient vector to be updated.
+ */
+inline void UpdateColumnResidualParallel(const ColBatch::Inst &col, int group_idx,
+                                         int num_group, float dw,
+                                         std::vector<bst_gpair> *in_gpair) {
+  if (dw == 0.0f) return;
+  // update grad value
+  const bst_omp_uint num_row = static_cast<bst_omp_uint>(col.length);
+#pragma omp parallel for schedule(static)
+  for (bst_omp_uint j = 0; j < num_row; ++j) {
+    bst_gpair &p = (*in_gpair)[col[j].index * num_group + group_idx];
+    if (p.GetHess() < 0.0f) continue;
+    p += bst_gpair(p.GetHess() * col[j].fvalue * dw, 0);
   }
-  return std::make_pair(sum_grad, sum_hess);
 }
 
 /**
@@ -156,16 +201,7 @@ inline void UpdateResidualParallel(int fidx, int group_idx, int num_group,
   if (dw == 0.0f) return;
   dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator({static_cast<bst_uint>(fidx)});
   while (iter->Next()) {
-    const ColBatch &batch = iter->Value();
-    ColBatch::Inst col = batch[0];
-    // update grad value
-    const bst_omp_uint num_row = static_cast<bst_omp_uint>(col.length);
-#pragma omp parallel for schedule(static)
-    for (bst_omp_uint j = 0; j < num_row; ++j) {
-      bst_gpair &p = (*in_gpair)[col[j].index * num_group + group_idx];
-      if (p.GetHess() < 0.0f) continue;
-      p += bst_gpair(p.GetHess() * col[j].fvalue * dw, 0);
-    }
+    UpdateColumnResidualParallel(iter->Value()[0], group_idx, num_group, dw, in_gpair);
   }
 }
 
@@ -192,6 +228,54 @@ inline void UpdateBiasResidualParallel(int group_idx, int num_group, float dbias
   }
 }
 
+/**
+ * \brief The whole columns of a block of features, gathered from the pages
+ *        of an external memory matrix with one pass over the pages. The
+ *        feature updates of a block then read no page, so each column is read
+ *        once per block instead of twice per update of its feature.
+ */
+class ColumnBlock {
+ public:
+  /*! \brief whether the block holds the column of a feature of a matrix */
+  inline bool Contains(const DMatrix *p_fmat, int fidx) const {
+    return p_fmat == p_fmat_ && fidx >= 0 && static_cast<size_t>(fidx) < slot_.size() &&
+           slot_[fidx] >= 0;
+  }
+  /*!
+   * \brief replace the block with the columns of the features in fset.
+   *  The pages are prefetched while the columns are gathered.
+   */
+  inline void Load(const std::vector<bst_uint> &fset, DMatrix *p_fmat) {
+    p_fmat_ = p_fmat;
+    slot_.assign(p_fmat->info().num_col, -1);
+    for (auto &col : columns_) col.clear();
+    columns_.resize(fset.size());
+    for (size_t i = 0; i < fset.size(); ++i) {
+      if (fset[i] < slot_.size()) slot_[fset[i]] = static_cast<int>(i);
+    }
+    dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator(fset);
+    while (iter->Next()) {
+      const ColBatch &batch = iter->Value();
+      for (size_t i = 0; i < batch.size; ++i) {
+        const ColBatch::Inst col = batch[i];
+        std::vector<SparseBatch::Entry> &out = columns_[slot_[batch.col_index[i]]];
+        out.insert(out.end(), col.data, col.data + col.length);
+      }
+    }
+  }
+  /*! \brief the column of a feature in the block */
+  inline ColBatch::Inst Column(int fidx) const {
+    const std::vector<SparseBatch::Entry> &col = columns_[slot_[fidx]];
+    return ColBatch::Inst(dmlc::BeginPtr(col), static_cast<bst_uint>(col.size()));
+  }
+
+ private:
+  const DMatrix *p_fmat_{nullptr};
+  // the position of each feature in columns_, or -1
+  std::vector<int> slot_;
+  std::vector<std::vector<SparseBatch::Entry> > columns_;
+};
+
 /**
  * \brief Abstract class for stateful feature selection or ordering
  *        in coordinate descent algorithms.
@@ -234,6 +318,31 @@ class FeatureSelector {
                           int group_idx,
                           const std::vector<bst_gpair> &gpair,
                           DMatrix *p_fmat, float alpha, float lambda) = 0;
+  /**
+   * \brief The feature NextFeature() selects at an iteration, when the order of
+   *        the features does not depend on the updates.
+   *
+   * \param iteration The iteration in a loop through features
+   * \param model     The model.
+   *
+   * \return  The index of the feature. -1 indicates it is not known in advance.
+   */
+  virtual int PeekFeature(int iteration, const gbm::GBLinearModel &model) const {
+    return -1;
+  }
+  /**
+   * \brief Notify the selector that the residuals were updated after a change in weight,
+   *        as done by UpdateResidualParallel.
+   *
+   * \param fidx      The updated feature.
+   * \param group_idx Zero-based index of the group.
+   * \param dw        The change in weight.
+   * \param gpair     The updated gpair.
+   * \param p_fmat    The feature matrix.
+   */
+  virtual void UpdateResidual(int fidx, int group_idx, float dw,
+                              const std::vector<bst_gpair> &gpair,
+                              DMatrix *p_fmat) {}
 };
 
 /**
@@ -246,6 +355,9 @@ class CyclicFeatureSelector : public FeatureSelector {
                   DMatrix *p_fmat, float alpha, float lambda) override {
     return iteration % model.param.num_feature;
   }
+  int PeekFeature(int iteration, const gbm::GBLinearModel &model) const override {
+    return iteration % model.param.num_feature;
+  }
 };
 
 /**
@@ -269,6 +381,9 @@ class ShuffleFeatureSelector : public FeatureSelector {
                   DMatrix *p_fmat, float alpha, float lambda) override {
     return feat_index[iteration % model.param.num_feature];
   }
+  int PeekFeature(int iteration, const gbm::GBLinearModel &model) const override {
+    return feat_index[iteration % model.param.num_feature];
+  }
 
  protected:
   std::vector<bst_uint> feat_index;
@@ -289,7 +404,11 @@ class RandomFeatureSelector : public FeatureSelector {
 
 /**
  * \brief Select coordinate with the greatest gradient magnitude.
- * \note It has O(num_feature^2) complexity. It is fully deterministic.
+ * \note The univariate gradient sums are computed once per round, then kept up
+ * to date through UpdateResidual(). A weight change only moves the sums of the
+ * features sharing rows with the updated feature, they are found through a
+ * row-major copy of the matrix. A selection costs O(num_feature) plus the
+ * entries of the rows of the updated feature. It is fully deterministic.
  *
  * \note It allows restricting the selection to top_k features per group with
  * the largest magnitude of univariate weight change, by passing the top_k value
@@ -303,14 +422,38 @@ class GreedyFeatureSelector : public FeatureSelector {
              DMatrix *p_fmat, float alpha, float lambda, int param) override {
     top_k = static_cast<bst_uint>(param);
     const bst_uint ngroup = model.param.num_output_group;
+    const bst_omp_uint nfeat = model.param.num_feature;
     if (param <= 0) top_k = std::numeric_limits<bst_uint>::max();
     if (counter.size() == 0) {
       counter.resize(ngroup);
-      gpair_sums.resize(model.param.num_feature * ngroup);
+      gpair_sums.resize(nfeat * ngroup);
     }
     for (bst_uint gid = 0u; gid < ngroup; ++gid) {
       counter[gid] = 0u;
     }
+    // Calculate univariate gradient sums
+    std::fill(gpair_sums.begin(), gpair_sums.end(), std::make_pair(0., 0.));
+    dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator();
+    while (iter->Next()) {
+      const ColBatch &batch = iter->Value();
+      const bst_omp_uint ncol = static_cast<bst_omp_uint>(batch.size);
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < ncol; ++i) {
+        const ColBatch::Inst col = batch[i];
+        const bst_uint fidx = batch.col_index[i];
+        for (bst_uint gid = 0u; gid < ngroup; ++gid) {
+          auto &sums = gpair_sums[gid * nfeat + fidx];
+          for (bst_uint j = 0u; j < col.length; ++j) {
+            const bst_float v = col[j].fvalue;
+            auto &p = gpair[col[j].index * ngroup + gid];
+            if (p.GetHess() < 0.f) continue;
+            sums.first += p.GetGrad() * v;
+            sums.second += p.GetHess() * v * v;
+          }
+        }
+      }
+    }
+    this->InitRows(p_fmat);
   }
 
   int NextFeature(int iteration, const gbm::GBLinearModel &model,
@@ -321,27 +464,7 @@ class GreedyFeatureSelector : public FeatureSelector {
     // stop after either reaching top-K or going through all the features in a group
     if (k >= top_k || counter[group_idx] == model.param.num_feature) return -1;
 
-    const int ngroup = model.param.num_output_group;
     const bst_omp_uint nfeat = model.param.num_feature;
-    // Calculate univariate gradient sums
-    std::fill(gpair_sums.begin(), gpair_sums.end(), std::make_pair(0., 0.));
-    dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator();
-    while (iter->Next()) {
-      const ColBatch &batch = iter->Value();
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nfeat; ++i) {
-        const ColBatch::Inst col = batch[i];
-        const bst_uint ndata = col.length;
-        auto &sums = gpair_sums[group_idx * nfeat + i];
-        for (bst_uint j = 0u; j < ndata; ++j) {
-          const bst_float v = col[j].fvalue;
-          auto &p = gpair[col[j].index * ngroup + group_idx];
-          if (p.GetHess() < 0.f) continue;
-          sums.first += p.GetGrad() * v;
-          sums.second += p.GetHess() * v * v;
-        }
-      }
-    }
     // Find a feature with the largest magnitude of weight change
     int best_fidx = 0;
     double best_weight_update = 0.0f;
@@ -357,10 +480,70 @@ class GreedyFeatureSelector : public FeatureSelector {
     return best_fidx;
   }
 
+  void UpdateResidual(int fidx, int group_idx, float dw,
+                      const std::vector<bst_gpair> &gpair,
+                      DMatrix *p_fmat) override {
+    if (dw == 0.0f) return;
+    const int ngroup = static_cast<int>(counter.size());
+    const bst_omp_uint nfeat = static_cast<bst_omp_uint>(gpair_sums.size() / ngroup);
+    std::pair<double, double> *sums = &gpair_sums[group_idx * nfeat];
+    dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator({static_cast<bst_uint>(fidx)});
+    while (iter->Next()) {
+      const ColBatch::Inst col = iter->Value()[0];
+      const bst_omp_uint ndata = static_cast<bst_omp_uint>(col.length);
+      // the gradient of row i moved by hess * v * dw, and so did the sums of its features
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint j = 0; j < ndata; ++j) {
+        const bst_uint ridx = col[j].index;
+        const bst_gpair &p = gpair[ridx * ngroup + group_idx];
+        if (p.GetHess() < 0.0f) continue;
+        const double delta = p.GetHess() * col[j].fvalue * dw;
+        for (size_t k = row_ptr[ridx]; k < row_ptr[ridx + 1]; ++k) {
+          const double change = delta * row_data[k].fvalue;
+          #pragma omp atomic
+          sums[row_data[k].index].first += change;
+        }
+      }
+    }
+  }
+
  protected:
+  // build the row-major copy of the matrix, once per matrix
+  inline void InitRows(DMatrix *p_fmat) {
+    if (row_fmat == p_fmat && row_ptr.size() == p_fmat->info().num_row + 1) return;
+    const size_t nrow = p_fmat->info().num_row;
+    row_ptr.assign(nrow + 1, 0);
+    dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator();
+    while (iter->Next()) {
+      const ColBatch &batch = iter->Value();
+      for (size_t i = 0; i < batch.size; ++i) {
+        const ColBatch::Inst col = batch[i];
+        for (bst_uint j = 0u; j < col.length; ++j) ++row_ptr[col[j].index + 1];
+      }
+    }
+    for (size_t i = 0; i < nrow; ++i) row_ptr[i + 1] += row_ptr[i];
+    row_data.resize(row_ptr[nrow]);
+    std::vector<size_t> fill(row_ptr.begin(), row_ptr.end() - 1);
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const ColBatch &batch = iter->Value();
+      for (size_t i = 0; i < batch.size; ++i) {
+        const ColBatch::Inst col = batch[i];
+        for (bst_uint j = 0u; j < col.length; ++j) {
+          row_data[fill[col[j].index]++] = SparseBatch::Entry(batch.col_index[i], col[j].fvalue);
+        }
+      }
+    }
+    row_fmat = p_fmat;
+  }
+
   bst_uint top_k;
   std::vector<bst_uint> counter;
   std::vector<std::pair<double, double>> gpair_sums;
+  // the features of each row, used to move the sums of the features sharing rows
+  std::vector<size_t> row_ptr;
+  std::vector<SparseBatch::Entry> row_data;
+  const DMatrix *row_fmat{nullptr};
 };
 
 /**
@@ -23,7 +23,12 @@ LinearUpdater* LinearUpdater::Create(const std::string& name) {
 namespace xgboost {
 namespace linear {
 // List of files that will be force linked in static links.
+#if !XGBOOST_PREDICT_ONLY
 DMLC_REGISTRY_LINK_TAG(updater_shotgun);
 DMLC_REGISTRY_LINK_TAG(updater_coordinate);
+#ifdef XGBOOST_USE_CUDA
+DMLC_REGISTRY_LINK_TAG(updater_gpu_coordinate);
+#endif
+#endif  // !XGBOOST_PREDICT_ONLY
 }  // namespace linear
 }  // namespace xgboost
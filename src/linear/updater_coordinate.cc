@@ -4,6 +4,8 @@
  */
 
 #include <xgboost/linear_updater.h>
+#include <algorithm>
+#include <vector>
 #include "../common/timer.h"
 #include "coordinate_common.h"
 
@@ -22,6 +24,7 @@ struct CoordinateTrainParam : public dmlc::Parameter<CoordinateTrainParam> {
   float reg_alpha;
   int feature_selector;
   int top_k;
+  int feature_block_size;
   int debug_verbose;
   // declare parameters
   DMLC_DECLARE_PARAMETER(CoordinateTrainParam) {
@@ -50,6 +53,11 @@ struct CoordinateTrainParam : public dmlc::Parameter<CoordinateTrainParam> {
         .set_default(0)
         .describe("The number of top features to select in 'thrifty' feature_selector. "
                   "The value of zero means using all the features.");
+    DMLC_DECLARE_FIELD(feature_block_size)
+        .set_lower_bound(1)
+        .set_default(256)
+        .describe("The number of features whose columns are read together from "
+                  "an external memory matrix.");
     DMLC_DECLARE_FIELD(debug_verbose)
         .set_lower_bound(0)
         .set_default(0)
@@ -106,6 +114,9 @@ class CoordinateUpdater : public LinearUpdater {
         int fidx = selector->NextFeature(i, *model, group_idx, *in_gpair, p_fmat,
                                          param.reg_alpha_denorm, param.reg_lambda_denorm);
         if (fidx < 0) break;
+        if (!p_fmat->SingleColBlock() && !block.Contains(p_fmat, fidx)) {
+          this->LoadBlock(i, fidx, *model, p_fmat);
+        }
         this->UpdateFeature(fidx, group_idx, in_gpair, p_fmat, model);
       }
     }
@@ -115,8 +126,12 @@ class CoordinateUpdater : public LinearUpdater {
                             DMatrix *p_fmat, gbm::GBLinearModel *model) {
     const int ngroup = model->param.num_output_group;
     bst_float &w = (*model)[fidx][group_idx];
+    // the pages of an external memory matrix are read by LoadBlock only
+    const bool in_block = block.Contains(p_fmat, fidx);
     monitor.Start("GetGradientParallel");
-    auto gradient = GetGradientParallel(group_idx, ngroup, fidx, *in_gpair, p_fmat);
+    auto gradient = in_block ?
+        GetColumnGradientParallel(group_idx, ngroup, block.Column(fidx), *in_gpair) :
+        GetGradientParallel(group_idx, ngroup, fidx, *in_gpair, p_fmat);
     monitor.Stop("GetGradientParallel");
     auto dw = static_cast<float>(
         param.learning_rate *
@@ -124,14 +139,53 @@ class CoordinateUpdater : public LinearUpdater {
                         param.reg_lambda_denorm));
     w += dw;
     monitor.Start("UpdateResidualParallel");
-    UpdateResidualParallel(fidx, group_idx, ngroup, dw, in_gpair, p_fmat);
+    if (in_block) {
+      UpdateColumnResidualParallel(block.Column(fidx), group_idx, ngroup, dw, in_gpair);
+    } else {
+      UpdateResidualParallel(fidx, group_idx, ngroup, dw, in_gpair, p_fmat);
+    }
+    selector->UpdateResidual(fidx, group_idx, dw, *in_gpair, p_fmat);
     monitor.Stop("UpdateResidualParallel");
   }
 
+  /*!
+   * \brief load the columns of the feature selected at an iteration and of the
+   *  features the selector picks next, or of the following features when the
+   *  selector does not know its next picks.
+   */
+  inline void LoadBlock(unsigned iteration, int fidx, const gbm::GBLinearModel &model,
+                        DMatrix *p_fmat) {
+    monitor.Start("LoadBlock");
+    const unsigned nfeat = model.param.num_feature;
+    const size_t block_size = std::min(static_cast<size_t>(param.feature_block_size),
+                                       static_cast<size_t>(nfeat));
+    std::vector<bool> taken(nfeat, false);
+    std::vector<bst_uint> fset(1, static_cast<bst_uint>(fidx));
+    taken[fidx] = true;
+    for (unsigned i = iteration + 1; i < iteration + nfeat && fset.size() < block_size; ++i) {
+      const int next = selector->PeekFeature(i, model);
+      if (next < 0) break;
+      if (!taken[next]) {
+        taken[next] = true;
+        fset.push_back(static_cast<bst_uint>(next));
+      }
+    }
+    for (unsigned f = fidx + 1; f < fidx + nfeat && fset.size() < block_size; ++f) {
+      if (!taken[f % nfeat]) {
+        taken[f % nfeat] = true;
+        fset.push_back(f % nfeat);
+      }
+    }
+    block.Load(fset, p_fmat);
+    monitor.Stop("LoadBlock");
+  }
+
   // training parameter
   CoordinateTrainParam param;
   std::unique_ptr<FeatureSelector> selector;
   common::Monitor monitor;
+  // the columns of the features being updated, for an external memory matrix
+  ColumnBlock block;
 };
 
 DMLC_REGISTER_PARAMETER(CoordinateTrainParam);
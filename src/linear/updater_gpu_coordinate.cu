@@ -0,0 +1,324 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file updater_gpu_coordinate.cu
+ * \brief Coordinate descent on the device. The columns of the matrix and the
+ *  gradients stay on the device, the sums of a feature are device-wide
+ *  reductions over the segment of its column.
+ */
+#include <dmlc/parameter.h>
+#include <xgboost/data.h>
+#include <xgboost/linear_updater.h>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "../common/device_helpers.cuh"
+#include "../common/timer.h"
+#include "coordinate_common.h"
+
+namespace xgboost {
+namespace linear {
+
+DMLC_REGISTRY_FILE_TAG(updater_gpu_coordinate);
+
+// training parameter
+struct GPUCoordinateTrainParam
+    : public dmlc::Parameter<GPUCoordinateTrainParam> {
+  /*! \brief learning_rate */
+  float learning_rate;
+  /*! \brief regularization weight for L2 norm */
+  float reg_lambda;
+  /*! \brief regularization weight for L1 norm */
+  float reg_alpha;
+  int feature_selector;
+  int top_k;
+  int debug_verbose;
+  int gpu_id;
+  bool silent;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(GPUCoordinateTrainParam) {
+    DMLC_DECLARE_FIELD(learning_rate)
+        .set_lower_bound(0.0f)
+        .set_default(1.0f)
+        .describe("Learning rate of each update.");
+    DMLC_DECLARE_FIELD(reg_lambda)
+        .set_lower_bound(0.0f)
+        .set_default(0.0f)
+        .describe("L2 regularization on weights.");
+    DMLC_DECLARE_FIELD(reg_alpha)
+        .set_lower_bound(0.0f)
+        .set_default(0.0f)
+        .describe("L1 regularization on weights.");
+    DMLC_DECLARE_FIELD(feature_selector)
+        .set_default(kCyclic)
+        .add_enum("cyclic", kCyclic)
+        .add_enum("shuffle", kShuffle)
+        .add_enum("thrifty", kThrifty)
+        .add_enum("greedy", kGreedy)
+        .add_enum("random", kRandom)
+        .describe("Feature selection or ordering method.");
+    DMLC_DECLARE_FIELD(top_k)
+        .set_lower_bound(0)
+        .set_default(0)
+        .describe("The number of top features to select in 'thrifty' feature_selector. "
+                  "The value of zero means using all the features.");
+    DMLC_DECLARE_FIELD(debug_verbose)
+        .set_lower_bound(0)
+        .set_default(0)
+        .describe("flag to print out detailed breakdown of runtime");
+    DMLC_DECLARE_FIELD(gpu_id)
+        .set_lower_bound(0)
+        .set_default(0)
+        .describe("Device ordinal.");
+    DMLC_DECLARE_FIELD(silent).set_default(true).describe(
+        "Do not print information during training.");
+    DMLC_DECLARE_ALIAS(learning_rate, eta);
+    DMLC_DECLARE_ALIAS(reg_lambda, lambda);
+    DMLC_DECLARE_ALIAS(reg_alpha, alpha);
+  }
+  /*! \brief Denormalizes the regularization penalties - to be called at each update */
+  void DenormalizePenalties(double sum_instance_weight) {
+    reg_lambda_denorm = reg_lambda * sum_instance_weight;
+    reg_alpha_denorm = reg_alpha * sum_instance_weight;
+  }
+  float reg_lambda_denorm;
+  float reg_alpha_denorm;
+};
+
+// the gradient terms of an entry of a column, the deleted rows count as zero
+struct ColumnGradient {
+  const bst_gpair *gpair;
+  int group_idx;
+  int num_group;
+  XGBOOST_DEVICE bst_gpair_precise operator()(const SparseBatch::Entry &e) const {
+    const bst_gpair &p = gpair[e.index * num_group + group_idx];
+    if (p.GetHess() < 0.0f) return bst_gpair_precise();
+    return bst_gpair_precise(p.GetGrad() * e.fvalue,
+                             p.GetHess() * e.fvalue * e.fvalue);
+  }
+};
+
+// the gradient of a row for the bias, the deleted rows count as zero
+struct BiasGradient {
+  const bst_gpair *gpair;
+  int group_idx;
+  int num_group;
+  XGBOOST_DEVICE bst_gpair_precise operator()(const size_t &ridx) const {
+    const bst_gpair &p = gpair[ridx * num_group + group_idx];
+    if (p.GetHess() < 0.0f) return bst_gpair_precise();
+    return bst_gpair_precise(p.GetGrad(), p.GetHess());
+  }
+};
+
+/**
+ * \brief The columns of a matrix and the gradients in the memory of a device.
+ */
+class DeviceShard {
+ public:
+  DeviceShard(int device_idx, DMatrix *p_fmat, bool silent)
+      : device_idx_(device_idx) {
+    const size_t nfeat = p_fmat->info().num_col;
+    // gather the columns in the order of the features
+    std::vector<std::vector<SparseBatch::Entry> > columns(nfeat);
+    dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator();
+    while (iter->Next()) {
+      const ColBatch &batch = iter->Value();
+      for (size_t i = 0; i < batch.size; ++i) {
+        const ColBatch::Inst col = batch[i];
+        std::vector<SparseBatch::Entry> &out = columns[batch.col_index[i]];
+        out.insert(out.end(), col.data, col.data + col.length);
+      }
+    }
+    column_ptr_.resize(nfeat + 1, 0);
+    for (size_t f = 0; f < nfeat; ++f) {
+      column_ptr_[f + 1] = column_ptr_[f] + columns[f].size();
+    }
+    std::vector<SparseBatch::Entry> data;
+    data.reserve(column_ptr_.back());
+    for (auto &col : columns) data.insert(data.end(), col.begin(), col.end());
+    num_row_ = p_fmat->info().num_row;
+    const RowSet &rowset = p_fmat->buffered_rowset();
+    std::vector<size_t> rows(rowset.size());
+    for (size_t i = 0; i < rows.size(); ++i) rows[i] = rowset[i];
+    ba_.allocate(device_idx_, silent, &data_, data.size(), &rows_, rows.size(),
+                 &sum_, 1);
+    data_ = data;
+    rows_ = rows;
+  }
+
+  // copy the gradients to the device
+  inline void UpdateGpair(const std::vector<bst_gpair> &host_gpair) {
+    dh::safe_cuda(cudaSetDevice(device_idx_));
+    if (gpair_.size() != host_gpair.size()) {
+      gpair_ba_.reset(new dh::bulk_allocator<dh::memory_type::DEVICE>());
+      gpair_ = dh::dvec<bst_gpair>();
+      gpair_ba_->allocate(device_idx_, true, &gpair_, host_gpair.size());
+    }
+    gpair_ = host_gpair;
+  }
+  // copy the residual gradients back to the host
+  inline void GetGpair(std::vector<bst_gpair> *host_gpair) const {
+    dh::safe_cuda(cudaSetDevice(device_idx_));
+    dh::safe_cuda(cudaMemcpy(dmlc::BeginPtr(*host_gpair), gpair_.data(),
+                             host_gpair->size() * sizeof(bst_gpair),
+                             cudaMemcpyDeviceToHost));
+  }
+
+  inline std::pair<double, double> GetBiasGradient(int group_idx, int num_group) {
+    BiasGradient op{gpair_.data(), group_idx, num_group};
+    cub::TransformInputIterator<bst_gpair_precise, BiasGradient, const size_t *>
+        in(rows_.data(), op);
+    const bst_gpair_precise sum = this->Reduce(in, rows_.size());
+    return std::make_pair(sum.GetGrad(), sum.GetHess());
+  }
+
+  inline std::pair<double, double> GetGradient(int group_idx, int num_group, int fidx) {
+    ColumnGradient op{gpair_.data(), group_idx, num_group};
+    cub::TransformInputIterator<bst_gpair_precise, ColumnGradient,
+                                const SparseBatch::Entry *>
+        in(data_.data() + column_ptr_[fidx], op);
+    const bst_gpair_precise sum =
+        this->Reduce(in, column_ptr_[fidx + 1] - column_ptr_[fidx]);
+    return std::make_pair(sum.GetGrad(), sum.GetHess());
+  }
+
+  inline void UpdateBiasResidual(float dbias, int group_idx, int num_group) {
+    if (dbias == 0.0f) return;
+    bst_gpair *d_gpair = gpair_.data();
+    const size_t *d_rows = rows_.data();
+    dh::launch_n(device_idx_, rows_.size(), [=] __device__(size_t idx) {
+      bst_gpair &g = d_gpair[d_rows[idx] * num_group + group_idx];
+      if (g.GetHess() < 0.0f) return;
+      g += bst_gpair(g.GetHess() * dbias, 0);
+    });
+  }
+
+  inline void UpdateResidual(float dw, int group_idx, int num_group, int fidx) {
+    if (dw == 0.0f) return;
+    bst_gpair *d_gpair = gpair_.data();
+    const SparseBatch::Entry *d_col = data_.data() + column_ptr_[fidx];
+    // a row is at most once in a column, the updates do not collide
+    dh::launch_n(device_idx_, column_ptr_[fidx + 1] - column_ptr_[fidx],
+                 [=] __device__(size_t idx) {
+      const SparseBatch::Entry e = d_col[idx];
+      bst_gpair &g = d_gpair[e.index * num_group + group_idx];
+      if (g.GetHess() < 0.0f) return;
+      g += bst_gpair(g.GetHess() * e.fvalue * dw, 0);
+    });
+  }
+
+ private:
+  // device-wide sum of n terms
+  template <typename IterT>
+  inline bst_gpair_precise Reduce(IterT in, size_t n) {
+    dh::safe_cuda(cudaSetDevice(device_idx_));
+    if (n == 0) return bst_gpair_precise();
+    size_t tmp_bytes = 0;
+    dh::safe_cuda(cub::DeviceReduce::Sum(nullptr, tmp_bytes, in, sum_.data(),
+                                         static_cast<int>(n)));
+    tmp_mem_.LazyAllocate(tmp_bytes);
+    dh::safe_cuda(cub::DeviceReduce::Sum(tmp_mem_.d_temp_storage, tmp_bytes, in,
+                                         sum_.data(), static_cast<int>(n)));
+    return sum_.as_vector()[0];
+  }
+
+  int device_idx_;
+  size_t num_row_;
+  // offset of the column of each feature into data_
+  std::vector<size_t> column_ptr_;
+  dh::bulk_allocator<dh::memory_type::DEVICE> ba_;
+  std::unique_ptr<dh::bulk_allocator<dh::memory_type::DEVICE> > gpair_ba_;
+  dh::dvec<SparseBatch::Entry> data_;
+  dh::dvec<size_t> rows_;
+  dh::dvec<bst_gpair_precise> sum_;
+  dh::dvec<bst_gpair> gpair_;
+  dh::CubMemory tmp_mem_;
+};
+
+/**
+ * \class GPUCoordinateUpdater
+ *
+ * \brief Coordinate descent algorithm that updates one feature per iteration,
+ *  with the sums and the residual updates of the features on the device.
+ */
+class GPUCoordinateUpdater : public LinearUpdater {
+ public:
+  // set training parameter
+  void Init(
+      const std::vector<std::pair<std::string, std::string> > &args) override {
+    param.InitAllowUnknown(args);
+    selector.reset(FeatureSelector::Create(param.feature_selector));
+    monitor.Init("GPUCoordinateUpdater", param.debug_verbose);
+  }
+
+  void Update(std::vector<bst_gpair> *in_gpair, DMatrix *p_fmat,
+              gbm::GBLinearModel *model, double sum_instance_weight) override {
+    param.DenormalizePenalties(sum_instance_weight);
+    monitor.Start("LazyInitShard");
+    if (shard == nullptr || p_last_fmat != p_fmat) {
+      shard.reset(new DeviceShard(param.gpu_id, p_fmat, param.silent));
+      p_last_fmat = p_fmat;
+    }
+    monitor.Stop("LazyInitShard");
+    monitor.Start("UpdateGpair");
+    shard->UpdateGpair(*in_gpair);
+    monitor.Stop("UpdateGpair");
+
+    monitor.Start("UpdateBias");
+    const int ngroup = model->param.num_output_group;
+    for (int group_idx = 0; group_idx < ngroup; ++group_idx) {
+      auto grad = shard->GetBiasGradient(group_idx, ngroup);
+      auto dbias = static_cast<float>(param.learning_rate *
+                                      CoordinateDeltaBias(grad.first, grad.second));
+      model->bias()[group_idx] += dbias;
+      shard->UpdateBiasResidual(dbias, group_idx, ngroup);
+    }
+    monitor.Stop("UpdateBias");
+    // the selectors rank the features from the gradients on the host
+    shard->GetGpair(in_gpair);
+    selector->Setup(*model, *in_gpair, p_fmat, param.reg_alpha_denorm,
+                    param.reg_lambda_denorm, param.top_k);
+    monitor.Start("UpdateFeature");
+    for (int group_idx = 0; group_idx < ngroup; ++group_idx) {
+      for (unsigned i = 0U; i < model->param.num_feature; i++) {
+        int fidx = selector->NextFeature(i, *model, group_idx, *in_gpair, p_fmat,
+                                         param.reg_alpha_denorm, param.reg_lambda_denorm);
+        if (fidx < 0) break;
+        this->UpdateFeature(fidx, group_idx, in_gpair, p_fmat, model);
+      }
+    }
+    monitor.Stop("UpdateFeature");
+    shard->GetGpair(in_gpair);
+  }
+
+  inline void UpdateFeature(int fidx, int group_idx, std::vector<bst_gpair> *in_gpair,
+                            DMatrix *p_fmat, gbm::GBLinearModel *model) {
+    const int ngroup = model->param.num_output_group;
+    bst_float &w = (*model)[fidx][group_idx];
+    auto gradient = shard->GetGradient(group_idx, ngroup, fidx);
+    auto dw = static_cast<float>(
+        param.learning_rate *
+        CoordinateDelta(gradient.first, gradient.second, w, param.reg_alpha_denorm,
+                        param.reg_lambda_denorm));
+    w += dw;
+    shard->UpdateResidual(dw, group_idx, ngroup, fidx);
+    // the selectors only read the hessians, which stay the same on the host
+    selector->UpdateResidual(fidx, group_idx, dw, *in_gpair, p_fmat);
+  }
+
+  // training parameter
+  GPUCoordinateTrainParam param;
+  std::unique_ptr<FeatureSelector> selector;
+  common::Monitor monitor;
+  std::unique_ptr<DeviceShard> shard;
+  DMatrix *p_last_fmat{nullptr};
+};
+
+DMLC_REGISTER_PARAMETER(GPUCoordinateTrainParam);
+
+XGBOOST_REGISTER_LINEAR_UPDATER(GPUCoordinateUpdater, "gpu_coord_descent")
+    .describe(
+        "Update linear model according to coordinate descent algorithm. GPU "
+        "accelerated.")
+    .set_body([]() { return new GPUCoordinateUpdater(); });
+}  // namespace linear
+}  // namespace xgboost
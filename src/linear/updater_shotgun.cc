@@ -4,6 +4,8 @@
  */
 
 #include <xgboost/linear_updater.h>
+#include <algorithm>
+#include <vector>
 #include "coordinate_common.h"
 
 namespace xgboost {
@@ -11,6 +13,15 @@ namespace linear {
 
 DMLC_REGISTRY_FILE_TAG(updater_shotgun);
 
+/*! \brief how the features updated in parallel share the residuals */
+enum ShotgunParallelMode {
+  // the residuals are updated atomically as soon as a weight changes
+  kHogwild = 0,
+  // the weights of a block are computed from the residuals at its start,
+  // then the residuals are updated in the order of the features
+  kBlocked = 1
+};
+
 // training parameter
 struct ShotgunTrainParam : public dmlc::Parameter<ShotgunTrainParam> {
   /*! \brief learning_rate */
@@ -20,6 +31,10 @@ struct ShotgunTrainParam : public dmlc::Parameter<ShotgunTrainParam> {
   /*! \brief regularization weight for L1 norm */
   float reg_alpha;
   int feature_selector;
+  /*! \brief how the parallel updates share the residuals */
+  int parallel_mode;
+  /*! \brief number of features updated from the same residuals in blocked mode */
+  int block_size;
   // declare parameters
   DMLC_DECLARE_PARAMETER(ShotgunTrainParam) {
     DMLC_DECLARE_FIELD(learning_rate)
@@ -39,6 +54,17 @@ struct ShotgunTrainParam : public dmlc::Parameter<ShotgunTrainParam> {
         .add_enum("cyclic", kCyclic)
         .add_enum("shuffle", kShuffle)
         .describe("Feature selection or ordering method.");
+    DMLC_DECLARE_FIELD(parallel_mode)
+        .set_default(kHogwild)
+        .add_enum("hogwild", kHogwild)
+        .add_enum("blocked", kBlocked)
+        .describe("hogwild: lock-free updates with atomic residual updates, "
+                  "blocked: the features of a block are updated from the same "
+                  "residuals, the result does not depend on the number of threads.");
+    DMLC_DECLARE_FIELD(block_size)
+        .set_lower_bound(1)
+        .set_default(256)
+        .describe("Number of features updated from the same residuals in blocked mode.");
     // alias of parameters
     DMLC_DECLARE_ALIAS(learning_rate, eta);
     DMLC_DECLARE_ALIAS(reg_lambda, lambda);
@@ -77,44 +103,92 @@ class ShotgunUpdater : public LinearUpdater {
       UpdateBiasResidualParallel(gid, ngroup, dbias, in_gpair, p_fmat);
     }
 
-    // lock-free parallel updates of weights
+    // parallel updates of weights on a copy of the residual gradients
+    residual_.resize(gpair.size());
+    for (size_t i = 0; i < gpair.size(); ++i) residual_[i] = gpair[i].GetGrad();
     selector->Setup(*model, *in_gpair, p_fmat, param.reg_alpha_denorm, param.reg_lambda_denorm, 0);
     dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator();
     while (iter->Next()) {
       const ColBatch &batch = iter->Value();
       const bst_omp_uint nfeat = static_cast<bst_omp_uint>(batch.size);
+      if (param.parallel_mode == kHogwild) {
+#pragma omp parallel for schedule(static)
+        for (bst_omp_uint i = 0; i < nfeat; ++i) {
+          int ii = selector->NextFeature(i, *model, 0, *in_gpair, p_fmat,
+                                         param.reg_alpha_denorm, param.reg_lambda_denorm);
+          if (ii < 0) continue;
+          for (int gid = 0; gid < ngroup; ++gid) {
+            const bst_float dw = this->UpdateWeight(batch, ii, gid, ngroup, gpair, model);
+            if (dw != 0.f) this->UpdateResidual(batch[ii], gid, ngroup, gpair, dw);
+          }
+        }
+      } else {
+        std::vector<int> feat(param.block_size);
+        std::vector<bst_float> dw(param.block_size * ngroup);
+        for (bst_omp_uint begin = 0; begin < nfeat; begin += param.block_size) {
+          const bst_omp_uint nblock = std::min(nfeat - begin,
+                                               static_cast<bst_omp_uint>(param.block_size));
 #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nfeat; ++i) {
-        int ii = selector->NextFeature(i, *model, 0, *in_gpair, p_fmat,
-                                       param.reg_alpha_denorm, param.reg_lambda_denorm);
-        if (ii < 0) continue;
-        const bst_uint fid = batch.col_index[ii];
-        ColBatch::Inst col = batch[ii];
-        for (int gid = 0; gid < ngroup; ++gid) {
-          double sum_grad = 0.0, sum_hess = 0.0;
-          for (bst_uint j = 0; j < col.length; ++j) {
-            bst_gpair &p = gpair[col[j].index * ngroup + gid];
-            if (p.GetHess() < 0.0f) continue;
-            const bst_float v = col[j].fvalue;
-            sum_grad += p.GetGrad() * v;
-            sum_hess += p.GetHess() * v * v;
+          for (bst_omp_uint k = 0; k < nblock; ++k) {
+            feat[k] = selector->NextFeature(begin + k, *model, 0, *in_gpair, p_fmat,
+                                            param.reg_alpha_denorm, param.reg_lambda_denorm);
+            for (int gid = 0; gid < ngroup; ++gid) {
+              dw[k * ngroup + gid] = feat[k] < 0 ? 0.f :
+                  this->UpdateWeight(batch, feat[k], gid, ngroup, gpair, model);
+            }
           }
-          bst_float &w = (*model)[fid][gid];
-          bst_float dw = static_cast<bst_float>(
-              param.learning_rate *
-              CoordinateDelta(sum_grad, sum_hess, w, param.reg_alpha_denorm,
-                              param.reg_lambda_denorm));
-          if (dw == 0.f) continue;
-          w += dw;
-          // update grad values
-          for (bst_uint j = 0; j < col.length; ++j) {
-            bst_gpair &p = gpair[col[j].index * ngroup + gid];
-            if (p.GetHess() < 0.0f) continue;
-            p += bst_gpair(p.GetHess() * col[j].fvalue * dw, 0);
+          for (bst_omp_uint k = 0; k < nblock; ++k) {
+            for (int gid = 0; gid < ngroup; ++gid) {
+              if (dw[k * ngroup + gid] == 0.f) continue;
+              this->UpdateResidual(batch[feat[k]], gid, ngroup, gpair,
+                                   dw[k * ngroup + gid]);
+            }
           }
         }
       }
     }
+    for (size_t i = 0; i < gpair.size(); ++i) {
+      gpair[i] = bst_gpair(residual_[i], gpair[i].GetHess());
+    }
+  }
+
+ private:
+  // update the weight of the feature at column ii of a batch from the residuals
+  inline bst_float UpdateWeight(const ColBatch &batch, int ii, int gid, int ngroup,
+                                const std::vector<bst_gpair> &gpair,
+                                gbm::GBLinearModel *model) {
+    ColBatch::Inst col = batch[ii];
+    double sum_grad = 0.0, sum_hess = 0.0;
+    for (bst_uint j = 0; j < col.length; ++j) {
+      const size_t idx = col[j].index * ngroup + gid;
+      const bst_float hess = gpair[idx].GetHess();
+      if (hess < 0.0f) continue;
+      bst_float grad;
+#pragma omp atomic read
+      grad = residual_[idx];
+      const bst_float v = col[j].fvalue;
+      sum_grad += grad * v;
+      sum_hess += hess * v * v;
+    }
+    bst_float &w = (*model)[batch.col_index[ii]][gid];
+    bst_float dw = static_cast<bst_float>(
+        param.learning_rate *
+        CoordinateDelta(sum_grad, sum_hess, w, param.reg_alpha_denorm,
+                        param.reg_lambda_denorm));
+    w += dw;
+    return dw;
+  }
+  // add the change of the weight of a column to the residuals of its rows
+  inline void UpdateResidual(const ColBatch::Inst &col, int gid, int ngroup,
+                             const std::vector<bst_gpair> &gpair, bst_float dw) {
+    for (bst_uint j = 0; j < col.length; ++j) {
+      const size_t idx = col[j].index * ngroup + gid;
+      const bst_float hess = gpair[idx].GetHess();
+      if (hess < 0.0f) continue;
+      const bst_float delta = hess * col[j].fvalue * dw;
+#pragma omp atomic
+      residual_[idx] += delta;
+    }
   }
 
  protected:
@@ -122,6 +196,8 @@ class ShotgunUpdater : public LinearUpdater {
   ShotgunTrainParam param;
 
   std::unique_ptr<FeatureSelector> selector;
+  // residual gradients updated by the parallel threads
+  std::vector<bst_float> residual_;
 };
 
 DMLC_REGISTER_PARAMETER(ShotgunTrainParam);
@@ -0,0 +1,231 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file auc.h
+ * \brief exact ROC and PR AUC on runs of sorted predictions, computed in
+ *  parallel and merged between workers.
+ */
+#ifndef XGBOOST_METRIC_AUC_H_
+#define XGBOOST_METRIC_AUC_H_
+
+#include <dmlc/omp.h>
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+#include "../common/math.h"
+#include "../common/sync.h"
+
+namespace xgboost {
+namespace metric {
+/*! \brief summed weights of the positive and the negative rows of a prediction */
+struct PredBucket {
+  bst_float pred;
+  double pos;
+  double neg;
+};
+
+/*! \brief rows from which a run is sorted and swept by several threads */
+const size_t kMinParallelRun = 1 << 16;
+
+/*! \brief the chunks [bound[c], bound[c + 1]) of n items split among nthread threads */
+inline std::vector<size_t> RunChunks(size_t n, int nthread) {
+  const size_t nchunk = n < kMinParallelRun ? 1 : static_cast<size_t>(std::max(nthread, 1));
+  std::vector<size_t> bound(nchunk + 1);
+  for (size_t c = 0; c <= nchunk; ++c) bound[c] = n * c / nchunk;
+  return bound;
+}
+
+/*!
+ * \brief collapse the rows [begin, end) into buckets of distinct predictions,
+ *  by decreasing prediction.
+ * \param nthread number of threads sorting and collapsing the rows.
+ * \param out the run of buckets.
+ */
+inline void MakeRun(const std::vector<bst_float> &preds, const MetaInfo &info,
+                    unsigned begin, unsigned end, int nthread,
+                    std::vector<PredBucket> *out) {
+  const size_t n = end - begin;
+  std::vector<std::pair<bst_float, unsigned> > rec(n);
+  std::vector<size_t> bound = RunChunks(n, nthread);
+  const bst_omp_uint nchunk = static_cast<bst_omp_uint>(bound.size() - 1);
+  #pragma omp parallel for schedule(static) num_threads(nchunk)
+  for (bst_omp_uint c = 0; c < nchunk; ++c) {
+    for (size_t i = bound[c]; i < bound[c + 1]; ++i) {
+      rec[i] = std::make_pair(preds[begin + i], static_cast<unsigned>(begin + i));
+    }
+  }
+  if (nchunk > 1) {
+    XGBOOST_PARALLEL_SORT(rec.begin(), rec.end(), common::CmpFirst);
+  } else {
+    std::sort(rec.begin(), rec.end(), common::CmpFirst);
+  }
+  // move the chunk bounds past the ties, each chunk gets whole buckets
+  for (size_t c = 1; c < nchunk; ++c) {
+    bound[c] = std::max(bound[c], bound[c - 1]);
+    while (bound[c] != 0 && bound[c] < n && rec[bound[c]].first == rec[bound[c] - 1].first) {
+      ++bound[c];
+    }
+  }
+  std::vector<std::vector<PredBucket> > chunk_runs(nchunk);
+  #pragma omp parallel for schedule(static) num_threads(nchunk)
+  for (bst_omp_uint c = 0; c < nchunk; ++c) {
+    std::vector<PredBucket> &run = chunk_runs[c];
+    for (size_t i = bound[c]; i < bound[c + 1]; ++i) {
+      const bst_float wt = info.GetWeight(rec[i].second);
+      const bst_float ctr = info.labels[rec[i].second];
+      if (run.empty() || run.back().pred != rec[i].first) {
+        run.push_back(PredBucket{rec[i].first, 0.0, 0.0});
+      }
+      run.back().pos += ctr * wt;
+      run.back().neg += (1.0f - ctr) * wt;
+    }
+  }
+  out->clear();
+  for (const std::vector<PredBucket> &run : chunk_runs) {
+    out->insert(out->end(), run.begin(), run.end());
+  }
+}
+
+/*! \brief merge two runs into one by decreasing prediction, the equal predictions summed */
+inline void MergeRuns(const std::vector<PredBucket> &a, const std::vector<PredBucket> &b,
+                      std::vector<PredBucket> *out) {
+  out->clear();
+  out->reserve(a.size() + b.size());
+  size_t i = 0, j = 0;
+  while (i < a.size() || j < b.size()) {
+    if (j == b.size() || (i < a.size() && a[i].pred > b[j].pred)) {
+      out->push_back(a[i++]);
+    } else if (i == a.size() || b[j].pred > a[i].pred) {
+      out->push_back(b[j++]);
+    } else {
+      out->push_back(PredBucket{a[i].pred, a[i].pos + b[j].pos, a[i].neg + b[j].neg});
+      ++i; ++j;
+    }
+  }
+}
+
+/*!
+ * \brief replace the run of each worker with the merge of the runs of all
+ *  the workers. Every worker receives all the runs, so it takes the memory
+ *  of the buckets of the whole data.
+ */
+inline void AllMergeRuns(std::vector<PredBucket> *run) {
+  const int world = rabit::GetWorldSize();
+  if (world == 1) return;
+  std::vector<std::vector<PredBucket> > runs(world);
+  for (int r = 0; r < world; ++r) {
+    if (r == rabit::GetRank()) runs[r] = *run;
+    rabit::Broadcast(&runs[r], r);
+  }
+  // merge pairs of runs until one is left
+  std::vector<PredBucket> merged;
+  for (size_t step = 1; step < runs.size(); step *= 2) {
+    for (size_t r = 0; r + step < runs.size(); r += 2 * step) {
+      MergeRuns(runs[r], runs[r + step], &merged);
+      runs[r].swap(merged);
+      std::vector<PredBucket>().swap(runs[r + step]);
+    }
+  }
+  run->swap(runs[0]);
+}
+
+/*!
+ * \brief area under the ROC curve of a run, the ties counting half.
+ * \param p_pos,p_neg set to the total weights of the positive and negative rows.
+ */
+inline double RunAUC(const std::vector<PredBucket> &run, int nthread,
+                     double *p_pos, double *p_neg) {
+  const std::vector<size_t> bound = RunChunks(run.size(), nthread);
+  const bst_omp_uint nchunk = static_cast<bst_omp_uint>(bound.size() - 1);
+  // per chunk: the pairs of a negative below a positive of the chunk,
+  // and the weights of the chunk
+  std::vector<double> pospair(nchunk), npos(nchunk), nneg(nchunk);
+  #pragma omp parallel for schedule(static) num_threads(nchunk)
+  for (bst_omp_uint c = 0; c < nchunk; ++c) {
+    double sum_pospair = 0.0, sum_npos = 0.0, sum_nneg = 0.0;
+    for (size_t i = bound[c]; i < bound[c + 1]; ++i) {
+      sum_pospair += run[i].neg * (sum_npos + run[i].pos * 0.5);
+      sum_npos += run[i].pos;
+      sum_nneg += run[i].neg;
+    }
+    pospair[c] = sum_pospair;
+    npos[c] = sum_npos;
+    nneg[c] = sum_nneg;
+  }
+  double sum_pospair = 0.0, sum_npos = 0.0, sum_nneg = 0.0;
+  for (bst_omp_uint c = 0; c < nchunk; ++c) {
+    // the negatives of the chunk are also below the positives of the chunks before
+    sum_pospair += pospair[c] + nneg[c] * sum_npos;
+    sum_npos += npos[c];
+    sum_nneg += nneg[c];
+  }
+  *p_pos = sum_npos;
+  *p_neg = sum_nneg;
+  return sum_pospair / (sum_npos * sum_nneg);
+}
+
+/*!
+ * \brief area under the precision recall curve of a run, interpolated
+ *  between the predictions as in the PRROC R package.
+ * \param p_pos,p_neg set to the total weights of the positive and negative rows.
+ */
+inline double RunAUCPR(const std::vector<PredBucket> &run, int nthread,
+                       double *p_pos, double *p_neg) {
+  const std::vector<size_t> bound = RunChunks(run.size(), nthread);
+  const bst_omp_uint nchunk = static_cast<bst_omp_uint>(bound.size() - 1);
+  // the weights of each chunk, then the true and false positives before it
+  std::vector<double> tp_before(nchunk + 1, 0.0), fp_before(nchunk + 1, 0.0);
+  #pragma omp parallel for schedule(static) num_threads(nchunk)
+  for (bst_omp_uint c = 0; c < nchunk; ++c) {
+    double tp = 0.0, fp = 0.0;
+    for (size_t i = bound[c]; i < bound[c + 1]; ++i) {
+      tp += run[i].pos;
+      fp += run[i].neg;
+    }
+    tp_before[c + 1] = tp;
+    fp_before[c + 1] = fp;
+  }
+  for (bst_omp_uint c = 0; c < nchunk; ++c) {
+    tp_before[c + 1] += tp_before[c];
+    fp_before[c + 1] += fp_before[c];
+  }
+  const double total_pos = tp_before[nchunk];
+  std::vector<double> area(nchunk);
+  #pragma omp parallel for schedule(static) num_threads(nchunk)
+  for (bst_omp_uint c = 0; c < nchunk; ++c) {
+    double prevtp = tp_before[c], prevfp = fp_before[c], auc = 0.0;
+    for (size_t i = bound[c]; i < bound[c + 1]; ++i) {
+      const double tp = prevtp + run[i].pos, fp = prevfp + run[i].neg;
+      double h, a, b;
+      if (tp == prevtp) {
+        h = 1.0;
+        a = 1.0;
+        b = 0.0;
+      } else {
+        h = (fp - prevfp) / (tp - prevtp);
+        a = 1.0 + h;
+        b = (prevfp - h * prevtp) / total_pos;
+      }
+      if (0.0 != b) {
+        auc += (tp / total_pos - prevtp / total_pos -
+                b / a * (std::log(a * tp / total_pos + b) -
+                         std::log(a * prevtp / total_pos + b))) / a;
+      } else {
+        auc += (tp / total_pos - prevtp / total_pos) / a;
+      }
+      prevtp = tp;
+      prevfp = fp;
+    }
+    area[c] = auc;
+  }
+  double auc = 0.0;
+  for (double a : area) auc += a;
+  *p_pos = total_pos;
+  *p_neg = fp_before[nchunk];
+  return auc;
+}
+}  // namespace metric
+}  // namespace xgboost
+#endif  // XGBOOST_METRIC_AUC_H_
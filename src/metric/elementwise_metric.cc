@@ -6,9 +6,15 @@
  */
 #include <xgboost/metric.h>
 #include <dmlc/registry.h>
+#include <algorithm>
 #include <cmath>
-#include "../common/math.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include "../common/blocked_sum.h"
 #include "../common/sync.h"
+#include "./elementwise_metric.h"
+#include "./metric_gpu.h"
 
 namespace xgboost {
 namespace metric {
@@ -16,210 +22,202 @@ namespace metric {
 DMLC_REGISTRY_FILE_TAG(elementwise_metric);
 
 /*!
- * \brief base class of element-wise evaluation
- * \tparam Derived the name of subclass
+ * \brief interface of the element-wise metrics, the weighted row statistics
+ *  are summed over blocks of rows so several metrics share one pass.
  */
-template<typename Derived>
-struct EvalEWiseBase : public Metric {
+struct EvalEWise : public Metric {
+  /*!
+   * \brief add the weighted statistics of the rows [begin, end) to sum
+   * \param preds prediction
+   * \param info information, including label etc.
+   */
+  virtual void SumRows(const std::vector<bst_float>& preds, const MetaInfo& info,
+                       omp_ulong begin, omp_ulong end, double* sum) const = 0;
+  /*! \brief final transformation of the summed statistics and weights */
+  virtual bst_float Final(double esum, double wsum) const = 0;
+};
+
+/*!
+ * \brief evaluate element-wise metrics together in one pass over the rows,
+ *  each block of rows is read by all the metrics while it is in cache.
+ * \param out the results, in the order of metrics.
+ */
+inline void EvalFused(const std::vector<const EvalEWise*>& metrics,
+                      const std::vector<bst_float>& preds,
+                      const MetaInfo& info,
+                      bool distributed,
+                      std::vector<bst_float>* out) {
+  CHECK_NE(info.labels.size(), 0U) << "label set cannot be empty";
+  CHECK_EQ(preds.size(), info.labels.size())
+      << "label and prediction size not match, "
+      << "hint: use merror or mlogloss for multi-class classification";
+  const size_t ndata = info.labels.size();
+  const size_t nmetric = metrics.size();
+  // the sums of the metrics then the weight, the blocks of rows are added
+  // in the same order for any number of threads
+  std::vector<double> dat(nmetric + 1, 0.0);
+  common::BlockedSum(ndata, nmetric + 1, [&](size_t begin, size_t end, double* sum) {
+      for (size_t m = 0; m < nmetric; ++m) {
+        metrics[m]->SumRows(preds, info, begin, end, &sum[m]);
+      }
+      double wsum = 0.0;
+      for (size_t i = begin; i < end; ++i) {
+        wsum += info.GetWeight(i);
+      }
+      sum[nmetric] += wsum;
+    }, dmlc::BeginPtr(dat));
+  if (distributed) {
+    rabit::Allreduce<rabit::op::Sum>(dmlc::BeginPtr(dat), dat.size());
+  }
+  out->resize(nmetric);
+  for (size_t m = 0; m < nmetric; ++m) {
+    (*out)[m] = metrics[m]->Final(dat[m], dat[nmetric]);
+  }
+}
+
+/*!
+ * \brief element-wise evaluation of the statistics of the rows of Row
+ * \tparam Row the rows of the metric, see elementwise_metric.h
+ */
+template<typename Row>
+struct EvalEWiseBase : public EvalEWise {
+  explicit EvalEWiseBase(const Row& row) : row_(row), name_(row.Name()) {}
+  const char *Name() const override {
+    return name_.c_str();
+  }
   bst_float Eval(const std::vector<bst_float>& preds,
                  const MetaInfo& info,
                  bool distributed) const override {
+    std::vector<bst_float> out;
+    EvalFused({this}, preds, info, distributed, &out);
+    return out[0];
+  }
+#ifdef XGBOOST_USE_CUDA
+  bool EvalDevice(HostDeviceVector<bst_float>* preds,
+                  const MetaInfo& info,
+                  bool distributed,
+                  bst_float* out) const override {
     CHECK_NE(info.labels.size(), 0U) << "label set cannot be empty";
-    CHECK_EQ(preds.size(), info.labels.size())
+    CHECK_EQ(preds->size(), info.labels.size())
         << "label and prediction size not match, "
         << "hint: use merror or mlogloss for multi-class classification";
-    const omp_ulong ndata = static_cast<omp_ulong>(info.labels.size());
-    double sum = 0.0, wsum = 0.0;
-    #pragma omp parallel for reduction(+: sum, wsum) schedule(static)
-    for (omp_ulong i = 0; i < ndata; ++i) {
-      const bst_float wt = info.GetWeight(i);
-      sum += static_cast<const Derived*>(this)->EvalRow(info.labels[i], preds[i]) * wt;
-      wsum += wt;
-    }
-    double dat[2]; dat[0] = sum, dat[1] = wsum;
+    const int device = preds->device();
+    double dat[2];
+    EWiseSumDevice(row_, preds->const_ptr_d(device), info, device, &device_info_, dat);
     if (distributed) {
       rabit::Allreduce<rabit::op::Sum>(dat, 2);
     }
-    return Derived::GetFinal(dat[0], dat[1]);
-  }
-  /*!
-   * \brief to be implemented by subclass,
-   *   get evaluation result from one row
-   * \param label label of current instance
-   * \param pred prediction value of current instance
-   */
-  inline bst_float EvalRow(bst_float label, bst_float pred) const;
-  /*!
-   * \brief to be overridden by subclass, final transformation
-   * \param esum the sum statistics returned by EvalRow
-   * \param wsum sum of weight
-   */
-  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
-    return esum / wsum;
-  }
-};
-
-struct EvalRMSE : public EvalEWiseBase<EvalRMSE> {
-  const char *Name() const override {
-    return "rmse";
-  }
-  inline bst_float EvalRow(bst_float label, bst_float pred) const {
-    bst_float diff = label - pred;
-    return diff * diff;
-  }
-  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
-    return std::sqrt(esum / wsum);
-  }
-};
-
-struct EvalMAE : public EvalEWiseBase<EvalMAE> {
-  const char *Name() const override {
-    return "mae";
-  }
-  inline bst_float EvalRow(bst_float label, bst_float pred) const {
-    return std::abs(label - pred);
-  }
-};
-
-struct EvalLogLoss : public EvalEWiseBase<EvalLogLoss> {
-  const char *Name() const override {
-    return "logloss";
-  }
-  inline bst_float EvalRow(bst_float y, bst_float py) const {
-    const bst_float eps = 1e-16f;
-    const bst_float pneg = 1.0f - py;
-    if (py < eps) {
-      return -y * std::log(eps) - (1.0f - y)  * std::log(1.0f - eps);
-    } else if (pneg < eps) {
-      return -y * std::log(1.0f - eps) - (1.0f - y)  * std::log(eps);
-    } else {
-      return -y * std::log(py) - (1.0f - y) * std::log(pneg);
-    }
-  }
-};
-
-struct EvalError : public EvalEWiseBase<EvalError> {
-  explicit EvalError(const char* param) {
-    if (param != nullptr) {
-      std::ostringstream os;
-      os << "error";
-      CHECK_EQ(sscanf(param, "%f", &threshold_), 1)
-        << "unable to parse the threshold value for the error metric";
-      if (threshold_ != 0.5f) os << '@' << threshold_;
-      name_ = os.str();
-    } else {
-      threshold_ = 0.5f;
-      name_ = "error";
+    *out = Row::GetFinal(dat[0], dat[1]);
+    return true;
+  }
+#endif
+  void SumRows(const std::vector<bst_float>& preds, const MetaInfo& info,
+               omp_ulong begin, omp_ulong end, double* sum) const override {
+    double esum = 0.0;
+    for (omp_ulong i = begin; i < end; ++i) {
+      esum += row_.EvalRow(info.labels[i], preds[i]) * info.GetWeight(i);
     }
+    *sum += esum;
   }
-  const char *Name() const override {
-    return name_.c_str();
-  }
-  inline bst_float EvalRow(bst_float label, bst_float pred) const {
-    // assume label is in [0,1]
-    return pred > threshold_ ? 1.0f - label : label;
+  bst_float Final(double esum, double wsum) const override {
+    return Row::GetFinal(esum, wsum);
   }
- protected:
-  bst_float threshold_;
-  std::string name_;
-};
-
-struct EvalPoissonNegLogLik : public EvalEWiseBase<EvalPoissonNegLogLik> {
-  const char *Name() const override {
-    return "poisson-nloglik";
-  }
-  inline bst_float EvalRow(bst_float y, bst_float py) const {
-    const bst_float eps = 1e-16f;
-    if (py < eps) py = eps;
-    return common::LogGamma(y + 1.0f) + py - std::log(py) * y;
-  }
-};
-
-struct EvalGammaDeviance : public EvalEWiseBase<EvalGammaDeviance> {
-  const char *Name() const override {
-    return "gamma-deviance";
-  }
-  inline bst_float EvalRow(bst_float label, bst_float pred) const {
-    bst_float epsilon = 1.0e-9;
-    bst_float tmp = label / (pred + epsilon);
-    return tmp - std::log(tmp) - 1;
-  }
-  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
-    return 2 * esum;
-  }
-};
-
-struct EvalGammaNLogLik: public EvalEWiseBase<EvalGammaNLogLik> {
-  const char *Name() const override {
-    return "gamma-nloglik";
-  }
-  inline bst_float EvalRow(bst_float y, bst_float py) const {
-    bst_float psi = 1.0;
-    bst_float theta = -1. / py;
-    bst_float a = psi;
-    bst_float b = -std::log(-theta);
-    bst_float c = 1. / psi * std::log(y/psi) - std::log(y) - common::LogGamma(1. / psi);
-    return -((y * theta - b) / a + c);
-  }
-};
 
-struct EvalTweedieNLogLik: public EvalEWiseBase<EvalTweedieNLogLik> {
-  explicit EvalTweedieNLogLik(const char* param) {
-    CHECK(param != nullptr)
-        << "tweedie-nloglik must be in format tweedie-nloglik@rho";
-    rho_ = atof(param);
-    CHECK(rho_ < 2 && rho_ >= 1)
-        << "tweedie variance power must be in interval [1, 2)";
-    std::ostringstream os;
-    os << "tweedie-nloglik@" << rho_;
-    name_ = os.str();
-  }
-  const char *Name() const override {
-    return name_.c_str();
-  }
-  inline bst_float EvalRow(bst_float y, bst_float p) const {
-    bst_float a = y * std::exp((1 - rho_) * std::log(p)) / (1 - rho_);
-    bst_float b = std::exp((2 - rho_) * std::log(p)) / (2 - rho_);
-    return -a + b;
-  }
  protected:
+  Row row_;
   std::string name_;
-  bst_float rho_;
+#ifdef XGBOOST_USE_CUDA
+  mutable std::shared_ptr<DeviceInfoCache> device_info_;
+#endif
 };
 
 XGBOOST_REGISTER_METRIC(RMSE, "rmse")
 .describe("Rooted mean square error.")
-.set_body([](const char* param) { return new EvalRMSE(); });
+.set_body([](const char* param) { return new EvalEWiseBase<EvalRMSE>(EvalRMSE()); });
 
 XGBOOST_REGISTER_METRIC(MAE, "mae")
 .describe("Mean absolute error.")
-.set_body([](const char* param) { return new EvalMAE(); });
+.set_body([](const char* param) { return new EvalEWiseBase<EvalMAE>(EvalMAE()); });
 
 XGBOOST_REGISTER_METRIC(LogLoss, "logloss")
 .describe("Negative loglikelihood for logistic regression.")
-.set_body([](const char* param) { return new EvalLogLoss(); });
+.set_body([](const char* param) { return new EvalEWiseBase<EvalLogLoss>(EvalLogLoss()); });
 
 XGBOOST_REGISTER_METRIC(Error, "error")
 .describe("Binary classification error.")
-.set_body([](const char* param) { return new EvalError(param); });
+.set_body([](const char* param) { return new EvalEWiseBase<EvalError>(EvalError(param)); });
 
 XGBOOST_REGISTER_METRIC(PossionNegLoglik, "poisson-nloglik")
 .describe("Negative loglikelihood for poisson regression.")
-.set_body([](const char* param) { return new EvalPoissonNegLogLik(); });
+.set_body([](const char* param) {
+  return new EvalEWiseBase<EvalPoissonNegLogLik>(EvalPoissonNegLogLik());
+});
 
 XGBOOST_REGISTER_METRIC(GammaDeviance, "gamma-deviance")
 .describe("Residual deviance for gamma regression.")
-.set_body([](const char* param) { return new EvalGammaDeviance(); });
+.set_body([](const char* param) {
+  return new EvalEWiseBase<EvalGammaDeviance>(EvalGammaDeviance());
+});
 
 XGBOOST_REGISTER_METRIC(GammaNLogLik, "gamma-nloglik")
 .describe("Negative log-likelihood for gamma regression.")
-.set_body([](const char* param) { return new EvalGammaNLogLik(); });
+.set_body([](const char* param) {
+  return new EvalEWiseBase<EvalGammaNLogLik>(EvalGammaNLogLik());
+});
 
 XGBOOST_REGISTER_METRIC(TweedieNLogLik, "tweedie-nloglik")
 .describe("tweedie-nloglik@rho for tweedie regression.")
 .set_body([](const char* param) {
-  return new EvalTweedieNLogLik(param);
+  return new EvalEWiseBase<EvalTweedieNLogLik>(EvalTweedieNLogLik(param));
 });
 
 }  // namespace metric
+
+void Metric::EvalAll(const std::vector<std::unique_ptr<Metric> >& metrics,
+                     const std::vector<bst_float>& preds,
+                     const MetaInfo& info,
+                     bool distributed,
+                     std::vector<bst_float>* out) {
+  out->resize(metrics.size());
+  std::vector<const metric::EvalEWise*> ewise;
+  std::vector<size_t> ewise_index;
+  for (size_t i = 0; i < metrics.size(); ++i) {
+    auto* ev = dynamic_cast<const metric::EvalEWise*>(metrics[i].get());
+    if (ev != nullptr) {
+      ewise.push_back(ev);
+      ewise_index.push_back(i);
+    } else {
+      (*out)[i] = metrics[i]->Eval(preds, info, distributed);
+    }
+  }
+  if (ewise.size() != 0) {
+    std::vector<bst_float> ewise_out;
+    metric::EvalFused(ewise, preds, info, distributed, &ewise_out);
+    for (size_t k = 0; k < ewise.size(); ++k) {
+      (*out)[ewise_index[k]] = ewise_out[k];
+    }
+  }
+}
+
+void Metric::EvalAll(const std::vector<std::unique_ptr<Metric> >& metrics,
+                     HostDeviceVector<bst_float>* preds,
+                     const MetaInfo& info,
+                     bool distributed,
+                     std::vector<bst_float>* out) {
+  if (preds->device() < 0) {
+    Metric::EvalAll(metrics, preds->const_data_h(), info, distributed, out);
+    return;
+  }
+  // the predictions are only copied to the host for the metrics left
+  out->resize(metrics.size());
+  std::vector<size_t> host_index;
+  for (size_t i = 0; i < metrics.size(); ++i) {
+    if (!metrics[i]->EvalDevice(preds, info, distributed, &(*out)[i])) {
+      host_index.push_back(i);
+    }
+  }
+  for (size_t i : host_index) {
+    (*out)[i] = metrics[i]->Eval(preds->const_data_h(), info, distributed);
+  }
+}
 }  // namespace xgboost
@@ -0,0 +1,178 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file elementwise_metric.h
+ * \brief the rows of the element-wise metrics, evaluated on the host and on
+ *  the device.
+ */
+#ifndef XGBOOST_METRIC_ELEMENTWISE_METRIC_H_
+#define XGBOOST_METRIC_ELEMENTWISE_METRIC_H_
+
+#include <dmlc/logging.h>
+#include <xgboost/base.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include "../common/math.h"
+
+namespace xgboost {
+namespace metric {
+
+/*! \brief log gamma of the rows, lgammaf of CUDA in the device code */
+XGBOOST_DEVICE inline bst_float RowLogGamma(bst_float v) {
+#ifdef __CUDA_ARCH__
+  return lgammaf(v);
+#else
+  return common::LogGamma(v);
+#endif
+}
+
+/*
+ * A row gives the statistics of one row by EvalRow, which runs on the host
+ * and the device, and the final transformation of the sums by GetFinal.
+ * It is copied to the kernels, so it only holds plain values.
+ */
+struct EvalRMSE {
+  std::string Name() const {
+    return "rmse";
+  }
+  XGBOOST_DEVICE bst_float EvalRow(bst_float label, bst_float pred) const {
+    bst_float diff = label - pred;
+    return diff * diff;
+  }
+  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
+    return std::sqrt(esum / wsum);
+  }
+};
+
+struct EvalMAE {
+  std::string Name() const {
+    return "mae";
+  }
+  XGBOOST_DEVICE bst_float EvalRow(bst_float label, bst_float pred) const {
+    return std::abs(label - pred);
+  }
+  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
+    return esum / wsum;
+  }
+};
+
+struct EvalLogLoss {
+  std::string Name() const {
+    return "logloss";
+  }
+  XGBOOST_DEVICE bst_float EvalRow(bst_float y, bst_float py) const {
+    const bst_float eps = 1e-16f;
+    const bst_float pneg = 1.0f - py;
+    if (py < eps) {
+      return -y * std::log(eps) - (1.0f - y)  * std::log(1.0f - eps);
+    } else if (pneg < eps) {
+      return -y * std::log(1.0f - eps) - (1.0f - y)  * std::log(eps);
+    } else {
+      return -y * std::log(py) - (1.0f - y) * std::log(pneg);
+    }
+  }
+  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
+    return esum / wsum;
+  }
+};
+
+struct EvalError {
+  explicit EvalError(const char* param) {
+    if (param != nullptr) {
+      CHECK_EQ(sscanf(param, "%f", &threshold_), 1)
+        << "unable to parse the threshold value for the error metric";
+    } else {
+      threshold_ = 0.5f;
+    }
+  }
+  std::string Name() const {
+    std::ostringstream os;
+    os << "error";
+    if (threshold_ != 0.5f) os << '@' << threshold_;
+    return os.str();
+  }
+  XGBOOST_DEVICE bst_float EvalRow(bst_float label, bst_float pred) const {
+    // assume label is in [0,1]
+    return pred > threshold_ ? 1.0f - label : label;
+  }
+  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
+    return esum / wsum;
+  }
+ protected:
+  bst_float threshold_;
+};
+
+struct EvalPoissonNegLogLik {
+  std::string Name() const {
+    return "poisson-nloglik";
+  }
+  XGBOOST_DEVICE bst_float EvalRow(bst_float y, bst_float py) const {
+    const bst_float eps = 1e-16f;
+    if (py < eps) py = eps;
+    return RowLogGamma(y + 1.0f) + py - std::log(py) * y;
+  }
+  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
+    return esum / wsum;
+  }
+};
+
+struct EvalGammaDeviance {
+  std::string Name() const {
+    return "gamma-deviance";
+  }
+  XGBOOST_DEVICE bst_float EvalRow(bst_float label, bst_float pred) const {
+    bst_float epsilon = 1.0e-9;
+    bst_float tmp = label / (pred + epsilon);
+    return tmp - std::log(tmp) - 1;
+  }
+  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
+    return 2 * esum;
+  }
+};
+
+struct EvalGammaNLogLik {
+  std::string Name() const {
+    return "gamma-nloglik";
+  }
+  XGBOOST_DEVICE bst_float EvalRow(bst_float y, bst_float py) const {
+    bst_float psi = 1.0;
+    bst_float theta = -1. / py;
+    bst_float a = psi;
+    bst_float b = -std::log(-theta);
+    bst_float c = 1. / psi * std::log(y/psi) - std::log(y) - RowLogGamma(1. / psi);
+    return -((y * theta - b) / a + c);
+  }
+  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
+    return esum / wsum;
+  }
+};
+
+struct EvalTweedieNLogLik {
+  explicit EvalTweedieNLogLik(const char* param) {
+    CHECK(param != nullptr)
+        << "tweedie-nloglik must be in format tweedie-nloglik@rho";
+    rho_ = atof(param);
+    CHECK(rho_ < 2 && rho_ >= 1)
+        << "tweedie variance power must be in interval [1, 2)";
+  }
+  std::string Name() const {
+    std::ostringstream os;
+    os << "tweedie-nloglik@" << rho_;
+    return os.str();
+  }
+  XGBOOST_DEVICE bst_float EvalRow(bst_float y, bst_float p) const {
+    bst_float a = y * std::exp((1 - rho_) * std::log(p)) / (1 - rho_);
+    bst_float b = std::exp((2 - rho_) * std::log(p)) / (2 - rho_);
+    return -a + b;
+  }
+  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
+    return esum / wsum;
+  }
+ protected:
+  bst_float rho_;
+};
+}  // namespace metric
+}  // namespace xgboost
+#endif  // XGBOOST_METRIC_ELEMENTWISE_METRIC_H_
@@ -0,0 +1,217 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file metric_gpu.cu
+ * \brief evaluation of the metrics on the predictions in the device memory,
+ *  so that the predictions of the gpu predictor are not copied to the host.
+ */
+#include <thrust/functional.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/sequence.h>
+#include <thrust/sort.h>
+#include <thrust/transform.h>
+#include <thrust/transform_reduce.h>
+#include <xgboost/logging.h>
+#include <list>
+#include <memory>
+#include "../common/device_helpers.cuh"
+#include "./elementwise_metric.h"
+#include "./metric_gpu.h"
+#include "./multiclass_metric.h"
+
+namespace xgboost {
+namespace metric {
+
+/*! \brief number of data sets whose labels are kept by a metric */
+const size_t kMaxDeviceInfo = 8;
+
+/*! \brief the labels and the weights of a data set on a device */
+struct DeviceInfo {
+  // the data set, found again by the address and the size of its labels
+  const MetaInfo* info;
+  const bst_float* labels_h;
+  size_t nlabel;
+  const bst_float* weights_h;
+  size_t nweight;
+  int device;
+  dh::device_vector<bst_float> labels;
+  dh::device_vector<bst_float> weights;
+
+  bool Matches(const MetaInfo& other, int other_device) const {
+    return info == &other && device == other_device &&
+        labels_h == other.labels.data() && nlabel == other.labels.size() &&
+        weights_h == other.weights.data() && nweight == other.weights.size();
+  }
+  // null when the rows are not weighted
+  const bst_float* weights_d() const {
+    return weights.empty() ? nullptr : dh::raw(weights);
+  }
+};
+
+struct DeviceInfoCache {
+  // the most recently used first
+  std::list<DeviceInfo> entries;
+};
+
+const DeviceInfo& GetDeviceInfo(const MetaInfo& info, int device,
+                                std::shared_ptr<DeviceInfoCache>* p_cache) {
+  dh::safe_cuda(cudaSetDevice(device));
+  if (*p_cache == nullptr) p_cache->reset(new DeviceInfoCache());
+  std::list<DeviceInfo>& entries = (*p_cache)->entries;
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it->Matches(info, device)) {
+      entries.splice(entries.begin(), entries, it);
+      return entries.front();
+    }
+  }
+  if (entries.size() == kMaxDeviceInfo) entries.pop_back();
+  entries.emplace_front();
+  DeviceInfo& d = entries.front();
+  d.info = &info;
+  d.labels_h = info.labels.data();
+  d.nlabel = info.labels.size();
+  d.weights_h = info.weights.data();
+  d.nweight = info.weights.size();
+  d.device = device;
+  d.labels.assign(info.labels.begin(), info.labels.end());
+  d.weights.assign(info.weights.begin(), info.weights.end());
+  return d;
+}
+
+/*! \brief sums of the statistics and of the weights of rows */
+struct RowSums {
+  double esum;
+  double wsum;
+  // a label out of range, 0 if there is none
+  int label_error;
+};
+
+struct AddRowSums {
+  XGBOOST_DEVICE RowSums operator()(const RowSums& a, const RowSums& b) const {
+    return RowSums{a.esum + b.esum, a.wsum + b.wsum,
+                   a.label_error != 0 ? a.label_error : b.label_error};
+  }
+};
+
+template <typename Row>
+void EWiseSumDevice(const Row& row, const bst_float* preds, const MetaInfo& info,
+                    int device, std::shared_ptr<DeviceInfoCache>* cache, double* out) {
+  const DeviceInfo& d = GetDeviceInfo(info, device, cache);
+  const bst_float* labels = dh::raw(d.labels);
+  const bst_float* weights = d.weights_d();
+  const size_t n = info.labels.size();
+  RowSums sums = thrust::transform_reduce(
+      thrust::counting_iterator<size_t>(0), thrust::counting_iterator<size_t>(n),
+      [=] __device__(size_t i) {
+        const bst_float wt = weights == nullptr ? 1.0f : weights[i];
+        return RowSums{row.EvalRow(labels[i], preds[i]) * wt, wt, 0};
+      }, RowSums{0.0, 0.0, 0}, AddRowSums());
+  dh::safe_cuda(cudaGetLastError());
+  out[0] = sums.esum;
+  out[1] = sums.wsum;
+}
+
+template <typename Row>
+int MClassSumDevice(const bst_float* preds, size_t nclass, const MetaInfo& info,
+                    int device, std::shared_ptr<DeviceInfoCache>* cache, double* out) {
+  const DeviceInfo& d = GetDeviceInfo(info, device, cache);
+  const bst_float* labels = dh::raw(d.labels);
+  const bst_float* weights = d.weights_d();
+  const size_t n = info.labels.size();
+  RowSums sums = thrust::transform_reduce(
+      thrust::counting_iterator<size_t>(0), thrust::counting_iterator<size_t>(n),
+      [=] __device__(size_t i) {
+        const bst_float wt = weights == nullptr ? 1.0f : weights[i];
+        const int label = static_cast<int>(labels[i]);
+        if (label < 0 || label >= static_cast<int>(nclass)) {
+          return RowSums{0.0, 0.0, label};
+        }
+        return RowSums{Row::EvalRow(label, preds + i * nclass, nclass) * wt, wt, 0};
+      }, RowSums{0.0, 0.0, 0}, AddRowSums());
+  dh::safe_cuda(cudaGetLastError());
+  out[0] = sums.esum;
+  out[1] = sums.wsum;
+  return sums.label_error;
+}
+
+double DeviceAUC(const bst_float* preds, const MetaInfo& info, int device,
+                 std::shared_ptr<DeviceInfoCache>* cache, double* p_pos, double* p_neg) {
+  const DeviceInfo& d = GetDeviceInfo(info, device, cache);
+  const bst_float* labels = dh::raw(d.labels);
+  const bst_float* weights = d.weights_d();
+  const size_t n = info.labels.size();
+  // the rows by decreasing prediction
+  dh::device_vector<bst_float> sorted_preds(thrust::device_ptr<const bst_float>(preds),
+                                            thrust::device_ptr<const bst_float>(preds) + n);
+  dh::device_vector<unsigned> rows(n);
+  thrust::sequence(rows.begin(), rows.end());
+  thrust::sort_by_key(sorted_preds.begin(), sorted_preds.end(), rows.begin(),
+                      thrust::greater<bst_float>());
+  // the weights of the positive and the negative part of each row
+  dh::device_vector<double> pos(n), neg(n);
+  thrust::transform(rows.begin(), rows.end(),
+                    thrust::make_zip_iterator(thrust::make_tuple(pos.begin(), neg.begin())),
+                    [=] __device__(unsigned r) {
+                      const bst_float wt = weights == nullptr ? 1.0f : weights[r];
+                      const bst_float ctr = labels[r];
+                      return thrust::make_tuple(static_cast<double>(ctr * wt),
+                                                static_cast<double>((1.0f - ctr) * wt));
+                    });
+  // collapse the equal predictions into buckets, as MakeRun
+  dh::device_vector<bst_float> bucket_preds(n);
+  dh::device_vector<double> bucket_pos(n), bucket_neg(n);
+  auto bucket_end = thrust::reduce_by_key(
+      sorted_preds.begin(), sorted_preds.end(),
+      thrust::make_zip_iterator(thrust::make_tuple(pos.begin(), neg.begin())),
+      bucket_preds.begin(),
+      thrust::make_zip_iterator(thrust::make_tuple(bucket_pos.begin(), bucket_neg.begin())),
+      thrust::equal_to<bst_float>(),
+      [] __device__(thrust::tuple<double, double> a, thrust::tuple<double, double> b) {
+        return thrust::make_tuple(thrust::get<0>(a) + thrust::get<0>(b),
+                                  thrust::get<1>(a) + thrust::get<1>(b));
+      });
+  const size_t nbucket = bucket_end.first - bucket_preds.begin();
+  // the weight of the positives above each bucket, then the pairs as RunAUC
+  dh::device_vector<double> pos_above(nbucket);
+  thrust::exclusive_scan(bucket_pos.begin(), bucket_pos.begin() + nbucket,
+                         pos_above.begin(), 0.0);
+  const double* bpos = dh::raw(bucket_pos);
+  const double* bneg = dh::raw(bucket_neg);
+  const double* above = dh::raw(pos_above);
+  const double sum_pospair = thrust::transform_reduce(
+      thrust::counting_iterator<size_t>(0), thrust::counting_iterator<size_t>(nbucket),
+      [=] __device__(size_t i) {
+        return bneg[i] * (above[i] + bpos[i] * 0.5);
+      }, 0.0, thrust::plus<double>());
+  const double sum_npos = thrust::reduce(bucket_pos.begin(), bucket_pos.begin() + nbucket);
+  const double sum_nneg = thrust::reduce(bucket_neg.begin(), bucket_neg.begin() + nbucket);
+  dh::safe_cuda(cudaGetLastError());
+  *p_pos = sum_npos;
+  *p_neg = sum_nneg;
+  return sum_pospair / (sum_npos * sum_nneg);
+}
+
+// the rows evaluated on the device
+#define XGBOOST_EWISE_DEVICE(Row)                                       \
+  template void EWiseSumDevice<Row>(const Row&, const bst_float*,       \
+                                    const MetaInfo&, int,               \
+                                    std::shared_ptr<DeviceInfoCache>*,  \
+                                    double*);
+XGBOOST_EWISE_DEVICE(EvalRMSE)
+XGBOOST_EWISE_DEVICE(EvalMAE)
+XGBOOST_EWISE_DEVICE(EvalLogLoss)
+XGBOOST_EWISE_DEVICE(EvalError)
+XGBOOST_EWISE_DEVICE(EvalPoissonNegLogLik)
+XGBOOST_EWISE_DEVICE(EvalGammaDeviance)
+XGBOOST_EWISE_DEVICE(EvalGammaNLogLik)
+XGBOOST_EWISE_DEVICE(EvalTweedieNLogLik)
+#undef XGBOOST_EWISE_DEVICE
+
+template int MClassSumDevice<EvalMatchError>(const bst_float*, size_t, const MetaInfo&, int,
+                                             std::shared_ptr<DeviceInfoCache>*, double*);
+template int MClassSumDevice<EvalMultiLogLoss>(const bst_float*, size_t, const MetaInfo&, int,
+                                               std::shared_ptr<DeviceInfoCache>*, double*);
+}  // namespace metric
+}  // namespace xgboost
@@ -0,0 +1,53 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file metric_gpu.h
+ * \brief evaluation of the metrics on the predictions in the device memory.
+ */
+#ifndef XGBOOST_METRIC_METRIC_GPU_H_
+#define XGBOOST_METRIC_METRIC_GPU_H_
+
+#ifdef XGBOOST_USE_CUDA
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <memory>
+
+namespace xgboost {
+namespace metric {
+/*!
+ * \brief the labels and the weights of the last data sets evaluated by a
+ *  metric, copied once to the device like the labels of the gpu objectives.
+ */
+struct DeviceInfoCache;
+
+/*!
+ * \brief sum the weighted statistics of the rows and the weights on a device.
+ * \param preds the predictions, in the memory of the device.
+ * \param cache the labels kept by the metric, created by the first call.
+ * \param out the sum of the statistics, then the sum of the weights.
+ */
+template <typename Row>
+void EWiseSumDevice(const Row& row, const bst_float* preds, const MetaInfo& info,
+                    int device, std::shared_ptr<DeviceInfoCache>* cache, double* out);
+
+/*!
+ * \brief sum the weighted statistics of the rows and the weights on a device.
+ * \param preds the nclass predictions of each row, in the memory of the device.
+ * \param out the sum of the statistics, then the sum of the weights.
+ * \return a label out of [0, nclass), 0 if there is none.
+ */
+template <typename Row>
+int MClassSumDevice(const bst_float* preds, size_t nclass, const MetaInfo& info,
+                    int device, std::shared_ptr<DeviceInfoCache>* cache, double* out);
+
+/*!
+ * \brief area under the ROC curve of all the rows, the predictions sorted
+ *  on a device, the ties counting half.
+ * \param preds the predictions, in the memory of the device.
+ * \param p_pos,p_neg set to the total weights of the positive and negative rows.
+ */
+double DeviceAUC(const bst_float* preds, const MetaInfo& info, int device,
+                 std::shared_ptr<DeviceInfoCache>* cache, double* p_pos, double* p_neg);
+}  // namespace metric
+}  // namespace xgboost
+#endif  // XGBOOST_USE_CUDA
+#endif  // XGBOOST_METRIC_METRIC_GPU_H_
@@ -6,8 +6,12 @@
  */
 #include <xgboost/metric.h>
 #include <cmath>
+#include <memory>
+#include <vector>
+#include "../common/blocked_sum.h"
 #include "../common/sync.h"
-#include "../common/math.h"
+#include "./metric_gpu.h"
+#include "./multiclass_metric.h"
 
 namespace xgboost {
 namespace metric {
@@ -15,105 +19,84 @@ namespace metric {
 DMLC_REGISTRY_FILE_TAG(multiclass_metric);
 
 /*!
- * \brief base class of multi-class evaluation
- * \tparam Derived the name of subclass
+ * \brief multi-class evaluation of the statistics of the rows of Row
+ * \tparam Row the rows of the metric, see multiclass_metric.h
  */
-template<typename Derived>
+template<typename Row>
 struct EvalMClassBase : public Metric {
+  const char* Name() const override {
+    return Row::Name();
+  }
   bst_float Eval(const std::vector<bst_float> &preds,
                  const MetaInfo &info,
                  bool distributed) const override {
+    const size_t nclass = NumClass(preds.size(), info);
+    double dat[2];
+    int label_error = 0;
+    // summed by blocks of rows, the same way for any number of threads
+    common::BlockedSum(info.labels.size(), 2, [&](size_t begin, size_t end, double* sum) {
+        for (size_t i = begin; i < end; ++i) {
+          const bst_float wt = info.GetWeight(i);
+          int label =  static_cast<int>(info.labels[i]);
+          if (label >= 0 && label < static_cast<int>(nclass)) {
+            sum[0] += Row::EvalRow(label,
+                                   dmlc::BeginPtr(preds) + i * nclass,
+                                   nclass) * wt;
+            sum[1] += wt;
+          } else {
+            label_error = label;
+          }
+        }
+      }, dat);
+    return Final(dat, label_error, nclass, distributed);
+  }
+#ifdef XGBOOST_USE_CUDA
+  bool EvalDevice(HostDeviceVector<bst_float>* preds,
+                  const MetaInfo& info,
+                  bool distributed,
+                  bst_float* out) const override {
+    const size_t nclass = NumClass(preds->size(), info);
+    const int device = preds->device();
+    double dat[2];
+    const int label_error = MClassSumDevice<Row>(preds->const_ptr_d(device), nclass,
+                                                 info, device, &device_info_, dat);
+    *out = Final(dat, label_error, nclass, distributed);
+    return true;
+  }
+#endif
+
+ private:
+  static size_t NumClass(size_t npred, const MetaInfo &info) {
     CHECK_NE(info.labels.size(), 0U) << "label set cannot be empty";
-    CHECK(preds.size() % info.labels.size() == 0)
+    CHECK(npred % info.labels.size() == 0)
         << "label and prediction size not match";
-    const size_t nclass = preds.size() / info.labels.size();
+    const size_t nclass = npred / info.labels.size();
     CHECK_GE(nclass, 1U)
         << "mlogloss and merror are only used for multi-class classification,"
         << " use logloss for binary classification";
-    const bst_omp_uint ndata = static_cast<bst_omp_uint>(info.labels.size());
-    double sum = 0.0, wsum = 0.0;
-    int label_error = 0;
-    #pragma omp parallel for reduction(+: sum, wsum) schedule(static)
-    for (bst_omp_uint i = 0; i < ndata; ++i) {
-      const bst_float wt = info.GetWeight(i);
-      int label =  static_cast<int>(info.labels[i]);
-      if (label >= 0 && label < static_cast<int>(nclass)) {
-        sum += Derived::EvalRow(label,
-                                dmlc::BeginPtr(preds) + i * nclass,
-                                nclass) * wt;
-        wsum += wt;
-      } else {
-        label_error = label;
-      }
-    }
+    return nclass;
+  }
+  static bst_float Final(double* dat, int label_error, size_t nclass, bool distributed) {
     CHECK(label_error >= 0 && label_error < static_cast<int>(nclass))
         << "MultiClassEvaluation: label must be in [0, num_class),"
         << " num_class=" << nclass << " but found " << label_error << " in label";
 
-    double dat[2]; dat[0] = sum, dat[1] = wsum;
     if (distributed) {
       rabit::Allreduce<rabit::op::Sum>(dat, 2);
     }
-    return Derived::GetFinal(dat[0], dat[1]);
-  }
-  /*!
-   * \brief to be implemented by subclass,
-   *   get evaluation result from one row
-   * \param label label of current instance
-   * \param pred prediction value of current instance
-   * \param nclass number of class in the prediction
-   */
-  inline static bst_float EvalRow(int label,
-                                  const bst_float *pred,
-                                  size_t nclass);
-  /*!
-   * \brief to be overridden by subclass, final transformation
-   * \param esum the sum statistics returned by EvalRow
-   * \param wsum sum of weight
-   */
-  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
-    return esum / wsum;
-  }
-  // used to store error message
-  const char *error_msg_;
-};
-
-/*! \brief match error */
-struct EvalMatchError : public EvalMClassBase<EvalMatchError> {
-  const char* Name() const override {
-    return "merror";
-  }
-  inline static bst_float EvalRow(int label,
-                                  const bst_float *pred,
-                                  size_t nclass) {
-    return common::FindMaxIndex(pred, pred + nclass) != pred + static_cast<int>(label);
-  }
-};
-
-/*! \brief match error */
-struct EvalMultiLogLoss : public EvalMClassBase<EvalMultiLogLoss> {
-  const char* Name() const override {
-    return "mlogloss";
-  }
-  inline static bst_float EvalRow(int label,
-                                  const bst_float *pred,
-                                  size_t nclass) {
-    const bst_float eps = 1e-16f;
-    size_t k = static_cast<size_t>(label);
-    if (pred[k] > eps) {
-      return -std::log(pred[k]);
-    } else {
-      return -std::log(eps);
-    }
+    return Row::GetFinal(dat[0], dat[1]);
   }
+#ifdef XGBOOST_USE_CUDA
+  mutable std::shared_ptr<DeviceInfoCache> device_info_;
+#endif
 };
 
 XGBOOST_REGISTER_METRIC(MatchError, "merror")
 .describe("Multiclass classification error.")
-.set_body([](const char* param) { return new EvalMatchError(); });
+.set_body([](const char* param) { return new EvalMClassBase<EvalMatchError>(); });
 
 XGBOOST_REGISTER_METRIC(MultiLogLoss, "mlogloss")
 .describe("Multiclass negative loglikelihood.")
-.set_body([](const char* param) { return new EvalMultiLogLoss(); });
+.set_body([](const char* param) { return new EvalMClassBase<EvalMultiLogLoss>(); });
 }  // namespace metric
 }  // namespace xgboost
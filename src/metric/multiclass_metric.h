@@ -0,0 +1,65 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file multiclass_metric.h
+ * \brief the rows of the multi-class metrics, evaluated on the host and on
+ *  the device.
+ */
+#ifndef XGBOOST_METRIC_MULTICLASS_METRIC_H_
+#define XGBOOST_METRIC_MULTICLASS_METRIC_H_
+
+#include <xgboost/base.h>
+#include <cmath>
+
+namespace xgboost {
+namespace metric {
+
+/*! \brief match error */
+struct EvalMatchError {
+  static const char* Name() {
+    return "merror";
+  }
+  /*!
+   * \brief get evaluation result from one row
+   * \param label label of current instance
+   * \param pred prediction value of current instance
+   * \param nclass number of class in the prediction
+   */
+  XGBOOST_DEVICE static bst_float EvalRow(int label,
+                                          const bst_float *pred,
+                                          size_t nclass) {
+    // the first of the largest predictions, as common::FindMaxIndex
+    size_t imax = 0;
+    for (size_t k = 1; k < nclass; ++k) {
+      if (pred[k] > pred[imax]) imax = k;
+    }
+    return imax != static_cast<size_t>(label);
+  }
+  /*! \brief final transformation of the sums of the rows and of the weights */
+  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
+    return esum / wsum;
+  }
+};
+
+/*! \brief multi-class negative log likelihood */
+struct EvalMultiLogLoss {
+  static const char* Name() {
+    return "mlogloss";
+  }
+  XGBOOST_DEVICE static bst_float EvalRow(int label,
+                                          const bst_float *pred,
+                                          size_t nclass) {
+    const bst_float eps = 1e-16f;
+    size_t k = static_cast<size_t>(label);
+    if (pred[k] > eps) {
+      return -std::log(pred[k]);
+    } else {
+      return -std::log(eps);
+    }
+  }
+  inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
+    return esum / wsum;
+  }
+};
+}  // namespace metric
+}  // namespace xgboost
+#endif  // XGBOOST_METRIC_MULTICLASS_METRIC_H_
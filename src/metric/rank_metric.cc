@@ -6,9 +6,18 @@
  */
 #include <xgboost/metric.h>
 #include <dmlc/registry.h>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "../common/sync.h"
 #include "../common/math.h"
+#include "./auc.h"
+#include "./metric_gpu.h"
 
 namespace xgboost {
 namespace metric {
@@ -73,6 +82,9 @@ struct EvalAMS : public Metric {
   const char* Name() const override {
     return name_.c_str();
   }
+  bool Maximize() const override {
+    return true;
+  }
 
  private:
   std::string name_;
@@ -94,60 +106,168 @@ struct EvalAuc : public Metric {
     CHECK_EQ(gptr.back(), info.labels.size())
         << "EvalAuc: group structure must match number of prediction";
     const bst_omp_uint ngroup = static_cast<bst_omp_uint>(gptr.size() - 1);
+    // without groups the runs of the workers are merged into an exact AUC
+    const bool merge = distributed && info.group_ptr.size() == 0;
     // sum statistics
-    bst_float sum_auc = 0.0f;
+    double sum_auc = 0.0;
     int auc_error = 0;
-    // each thread takes a local rec
-    std::vector< std::pair<bst_float, unsigned> > rec;
-    for (bst_omp_uint k = 0; k < ngroup; ++k) {
-      rec.clear();
-      for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
-        rec.push_back(std::make_pair(preds[j], j));
-      }
-      XGBOOST_PARALLEL_SORT(rec.begin(), rec.end(), common::CmpFirst);
-      // calculate AUC
-      double sum_pospair = 0.0;
-      double sum_npos = 0.0, sum_nneg = 0.0, buf_pos = 0.0, buf_neg = 0.0;
-      for (size_t j = 0; j < rec.size(); ++j) {
-        const bst_float wt = info.GetWeight(rec[j].second);
-        const bst_float ctr = info.labels[rec[j].second];
-        // keep bucketing predictions in same bucket
-        if (j != 0 && rec[j].first != rec[j - 1].first) {
-          sum_pospair += buf_neg * (sum_npos + buf_pos *0.5);
-          sum_npos += buf_pos;
-          sum_nneg += buf_neg;
-          buf_neg = buf_pos = 0.0f;
+    if (ngroup == 1) {
+      // a single group is sorted and swept by all the threads
+      const int nthread = omp_get_max_threads();
+      std::vector<PredBucket> run;
+      MakeRun(preds, info, gptr[0], gptr[1], nthread, &run);
+      if (merge) AllMergeRuns(&run);
+      double sum_npos, sum_nneg;
+      sum_auc = RunAUC(run, nthread, &sum_npos, &sum_nneg);
+      auc_error = sum_npos <= 0.0 || sum_nneg <= 0.0;
+    } else {
+      #pragma omp parallel reduction(+:sum_auc)
+      {
+        // each thread takes a local run
+        std::vector<PredBucket> run;
+        #pragma omp for schedule(static)
+        for (bst_omp_uint k = 0; k < ngroup; ++k) {
+          MakeRun(preds, info, gptr[k], gptr[k + 1], 1, &run);
+          double sum_npos, sum_nneg;
+          const double auc = RunAUC(run, 1, &sum_npos, &sum_nneg);
+          // check weird conditions
+          if (sum_npos <= 0.0 || sum_nneg <= 0.0) {
+            auc_error = 1;
+            continue;
+          }
+          sum_auc += auc;
         }
-        buf_pos += ctr * wt;
-        buf_neg += (1.0f - ctr) * wt;
-      }
-      sum_pospair += buf_neg * (sum_npos + buf_pos *0.5);
-      sum_npos += buf_pos;
-      sum_nneg += buf_neg;
-      // check weird conditions
-      if (sum_npos <= 0.0 || sum_nneg <= 0.0) {
-        auc_error = 1;
-        continue;
       }
-      // this is the AUC
-      sum_auc += sum_pospair / (sum_npos*sum_nneg);
     }
     CHECK(!auc_error)
       << "AUC: the dataset only contains pos or neg samples";
-    if (distributed) {
+    if (merge) {
+      return static_cast<bst_float>(sum_auc);
+    } else if (distributed) {
       bst_float dat[2];
       dat[0] = static_cast<bst_float>(sum_auc);
       dat[1] = static_cast<bst_float>(ngroup);
-      // approximately estimate auc using mean
+      // the groups of the workers are distinct, average their auc
       rabit::Allreduce<rabit::op::Sum>(dat, 2);
       return dat[0] / dat[1];
     } else {
       return static_cast<bst_float>(sum_auc) / ngroup;
     }
   }
+#ifdef XGBOOST_USE_CUDA
+  bool EvalDevice(HostDeviceVector<bst_float>* preds,
+                  const MetaInfo& info,
+                  bool distributed,
+                  bst_float* out) const override {
+    // the groups, and the runs merged between the workers, are left to the host
+    if (info.group_ptr.size() > 2 || distributed) return false;
+    CHECK_NE(info.labels.size(), 0U) << "label set cannot be empty";
+    CHECK_EQ(preds->size(), info.labels.size())
+        << "label size predict size not match";
+    CHECK(info.group_ptr.size() == 0 || info.group_ptr.back() == info.labels.size())
+        << "EvalAuc: group structure must match number of prediction";
+    const int device = preds->device();
+    double sum_npos, sum_nneg;
+    const double auc = DeviceAUC(preds->const_ptr_d(device), info, device,
+                                 &device_info_, &sum_npos, &sum_nneg);
+    CHECK(sum_npos > 0.0 && sum_nneg > 0.0)
+      << "AUC: the dataset only contains pos or neg samples";
+    *out = static_cast<bst_float>(auc);
+    return true;
+  }
+#endif
   const char* Name() const override {
     return "auc";
   }
+  bool Maximize() const override {
+    return true;
+  }
+
+#ifdef XGBOOST_USE_CUDA
+ private:
+  mutable std::shared_ptr<DeviceInfoCache> device_info_;
+#endif
+};
+
+/*!
+ * \brief positions of the groups of the last evaluated predictions, sorted by
+ *  decreasing prediction down to a depth. The rank metrics of an evaluation
+ *  run one after another on the same predictions, so the first one sorts the
+ *  top of each group and the next ones reuse it unless they need more of it.
+ *  It is shared by the rank list metrics alive.
+ */
+class RankOrderCache {
+ public:
+  /*! \brief to hold while the order is used */
+  std::mutex& Mutex() {
+    return mutex_;
+  }
+  /*!
+   * \brief get the order of the groups, sorted again if the predictions or
+   *  the groups changed or more than the sorted depth is needed.
+   * \param depth number of positions needed sorted in each group
+   * \return the positions in group k are at order[gptr[k]:gptr[k+1]], the
+   *  first depth of them by decreasing prediction and then by position.
+   */
+  const std::vector<unsigned>& Order(const std::vector<bst_float> &preds,
+                                     const std::vector<unsigned> &gptr,
+                                     unsigned depth) {
+    if (preds.size() != preds_.size() || gptr != gptr_ ||
+        (preds.size() != 0 &&
+         std::memcmp(dmlc::BeginPtr(preds), dmlc::BeginPtr(preds_),
+                     preds.size() * sizeof(bst_float)) != 0)) {
+      preds_ = preds;
+      gptr_ = gptr;
+      order_.resize(preds.size());
+      depth_ = 0;
+    }
+    if (depth_ < depth) {
+      this->Sort(depth);
+      depth_ = depth;
+    }
+    return order_;
+  }
+  /*! \return the cache shared by the metrics alive, created if there is none */
+  static std::shared_ptr<RankOrderCache> Shared() {
+    static std::mutex mutex;
+    static std::weak_ptr<RankOrderCache> shared;
+    std::lock_guard<std::mutex> guard(mutex);
+    std::shared_ptr<RankOrderCache> cache = shared.lock();
+    if (cache == nullptr) {
+      cache.reset(new RankOrderCache());
+      shared = cache;
+    }
+    return cache;
+  }
+
+ private:
+  // the top depth positions of each group, by nth_element then sort
+  void Sort(unsigned depth) {
+    const bst_omp_uint ngroup = static_cast<bst_omp_uint>(gptr_.size() - 1);
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint k = 0; k < ngroup; ++k) {
+      unsigned *begin = dmlc::BeginPtr(order_) + gptr_[k];
+      const unsigned n = gptr_[k + 1] - gptr_[k];
+      const bst_float *pred = dmlc::BeginPtr(preds_) + gptr_[k];
+      for (unsigned i = 0; i < n; ++i) begin[i] = i;
+      auto cmp = [pred](unsigned a, unsigned b) {
+        return pred[a] > pred[b] || (pred[a] == pred[b] && a < b);
+      };
+      if (depth < n) {
+        std::nth_element(begin, begin + depth, begin + n, cmp);
+        std::sort(begin, begin + depth, cmp);
+      } else {
+        std::sort(begin, begin + n, cmp);
+      }
+    }
+  }
+  std::mutex mutex_;
+  /*! \brief the predictions and the groups the order is of */
+  std::vector<bst_float> preds_;
+  std::vector<unsigned> gptr_;
+  std::vector<unsigned> order_;
+  /*! \brief number of positions sorted in each group */
+  unsigned depth_{0};
 };
 
 /*! \brief Evaluate rank list */
@@ -168,17 +288,21 @@ struct EvalRankList : public Metric {
     const bst_omp_uint ngroup = static_cast<bst_omp_uint>(gptr.size() - 1);
     // sum statistics
     double sum_metric = 0.0f;
-    #pragma omp parallel reduction(+:sum_metric)
     {
-      // each thread takes a local rec
-      std::vector< std::pair<bst_float, unsigned> > rec;
-      #pragma omp for schedule(static)
-      for (bst_omp_uint k = 0; k < ngroup; ++k) {
-        rec.clear();
-        for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
-          rec.push_back(std::make_pair(preds[j], static_cast<int>(info.labels[j])));
+      std::lock_guard<std::mutex> guard(order_cache_->Mutex());
+      const std::vector<unsigned> &order = order_cache_->Order(preds, gptr, topn_);
+      #pragma omp parallel reduction(+:sum_metric)
+      {
+        // each thread takes a local rec
+        std::vector<unsigned> rec;
+        #pragma omp for schedule(static)
+        for (bst_omp_uint k = 0; k < ngroup; ++k) {
+          rec.clear();
+          for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
+            rec.push_back(static_cast<int>(info.labels[j]));
+          }
+          sum_metric += this->EvalMetric(rec, &order[gptr[k]]);
         }
-        sum_metric += this->EvalMetric(rec);
       }
     }
     if (distributed) {
@@ -195,9 +319,13 @@ struct EvalRankList : public Metric {
   const char* Name() const override {
     return name_.c_str();
   }
+  bool Maximize() const override {
+    return true;
+  }
 
  protected:
-  explicit EvalRankList(const char* name, const char* param) {
+  explicit EvalRankList(const char* name, const char* param)
+      : order_cache_(RankOrderCache::Shared()) {
     using namespace std;  // NOLINT(*)
     minus_ = false;
     if (param != nullptr) {
@@ -215,13 +343,29 @@ struct EvalRankList : public Metric {
       topn_ = std::numeric_limits<unsigned>::max();
     }
   }
-  /*! \return evaluation metric, given the pair_sort record, (pred,label) */
-  virtual bst_float EvalMetric(std::vector<std::pair<bst_float, unsigned> > &pair_sort) const = 0; // NOLINT(*)
+  /*!
+   * \return evaluation metric of a group
+   * \param labels the labels of the group, may be reordered
+   * \param order the positions of the group by decreasing prediction, only
+   *  the first topn_ of them are sorted
+   */
+  virtual bst_float EvalMetric(std::vector<unsigned> &labels,  // NOLINT(*)
+                               const unsigned *order) const = 0;
+  /*! \brief move the topn_ largest labels to the front, decreasing */
+  inline size_t SortTopLabels(std::vector<unsigned> *labels) const {
+    const size_t n = std::min(labels->size(), static_cast<size_t>(topn_));
+    std::nth_element(labels->begin(), labels->begin() + n, labels->end(),
+                     std::greater<unsigned>());
+    std::sort(labels->begin(), labels->begin() + n, std::greater<unsigned>());
+    return n;
+  }
 
  protected:
   unsigned topn_;
   std::string name_;
   bool minus_;
+  /*! \brief the order of the groups, shared with the other rank list metrics */
+  std::shared_ptr<RankOrderCache> order_cache_;
 };
 
 /*! \brief Precision at N, for both classification and rank */
@@ -230,12 +374,12 @@ struct EvalPrecision : public EvalRankList{
   explicit EvalPrecision(const char *name) : EvalRankList("pre", name) {}
 
  protected:
-  virtual bst_float EvalMetric(std::vector< std::pair<bst_float, unsigned> > &rec) const {
+  bst_float EvalMetric(std::vector<unsigned> &labels,  // NOLINT(*)
+                       const unsigned *order) const override {
     // calculate Precision
-    std::sort(rec.begin(), rec.end(), common::CmpFirst);
     unsigned nhit = 0;
-    for (size_t j = 0; j < rec.size() && j < this->topn_; ++j) {
-      nhit += (rec[j].second != 0);
+    for (size_t j = 0; j < labels.size() && j < this->topn_; ++j) {
+      nhit += (labels[order[j]] != 0);
     }
     return static_cast<bst_float>(nhit) / topn_;
   }
@@ -247,21 +391,22 @@ struct EvalNDCG : public EvalRankList{
   explicit EvalNDCG(const char *name) : EvalRankList("ndcg", name) {}
 
  protected:
-  inline bst_float CalcDCG(const std::vector<std::pair<bst_float, unsigned> > &rec) const {
+  inline static double Gain(unsigned rel, size_t i) {
+    return rel != 0 ? ((1 << rel) - 1) / std::log2(i + 2.0) : 0.0;
+  }
+  bst_float EvalMetric(std::vector<unsigned> &labels,  // NOLINT(*)
+                       const unsigned *order) const override {
     double sumdcg = 0.0;
-    for (size_t i = 0; i < rec.size() && i < this->topn_; ++i) {
-      const unsigned rel = rec[i].second;
-      if (rel != 0) {
-        sumdcg += ((1 << rel) - 1) / std::log2(i + 2.0);
-      }
+    for (size_t i = 0; i < labels.size() && i < this->topn_; ++i) {
+      sumdcg += Gain(labels[order[i]], i);
     }
-    return sumdcg;
-  }
-  virtual bst_float EvalMetric(std::vector<std::pair<bst_float, unsigned> > &rec) const { // NOLINT(*)
-    XGBOOST_PARALLEL_STABLE_SORT(rec.begin(), rec.end(), common::CmpFirst);
-    bst_float dcg = this->CalcDCG(rec);
-    XGBOOST_PARALLEL_STABLE_SORT(rec.begin(), rec.end(), common::CmpSecond);
-    bst_float idcg = this->CalcDCG(rec);
+    bst_float dcg = static_cast<bst_float>(sumdcg);
+    const size_t ntop = this->SortTopLabels(&labels);
+    double sumidcg = 0.0;
+    for (size_t i = 0; i < ntop; ++i) {
+      sumidcg += Gain(labels[i], i);
+    }
+    bst_float idcg = static_cast<bst_float>(sumidcg);
     if (idcg == 0.0f) {
       if (minus_) {
         return 0.0f;
@@ -279,18 +424,21 @@ struct EvalMAP : public EvalRankList {
   explicit EvalMAP(const char *name) : EvalRankList("map", name) {}
 
  protected:
-  virtual bst_float EvalMetric(std::vector< std::pair<bst_float, unsigned> > &rec) const {
-    std::sort(rec.begin(), rec.end(), common::CmpFirst);
+  bst_float EvalMetric(std::vector<unsigned> &labels,  // NOLINT(*)
+                       const unsigned *order) const override {
     unsigned nhits = 0;
     double sumap = 0.0;
-    for (size_t i = 0; i < rec.size(); ++i) {
-      if (rec[i].second != 0) {
+    const size_t ntop = std::min(labels.size(), static_cast<size_t>(this->topn_));
+    for (size_t i = 0; i < ntop; ++i) {
+      if (labels[order[i]] != 0) {
         nhits += 1;
-        if (i < this->topn_) {
-          sumap += static_cast<bst_float>(nhits) / (i + 1);
-        }
+        sumap += static_cast<bst_float>(nhits) / (i + 1);
       }
     }
+    // the hits below the top only count in the mean
+    for (size_t i = ntop; i < labels.size(); ++i) {
+      nhits += (labels[order[i]] != 0);
+    }
     if (nhits != 0) {
       sumap /= nhits;
       return static_cast<bst_float>(sumap);
@@ -368,66 +516,47 @@ struct EvalAucPR : public Metric {
     CHECK_EQ(gptr.back(), info.labels.size())
         << "EvalAucPR: group structure must match number of prediction";
     const bst_omp_uint ngroup = static_cast<bst_omp_uint>(gptr.size() - 1);
+    // without groups the runs of the workers are merged into an exact AUC-PR
+    const bool merge = distributed && info.group_ptr.size() == 0;
     // sum statistics
     double auc = 0.0;
     int auc_error = 0, auc_gt_one = 0;
-    // each thread takes a local rec
-    std::vector<std::pair<bst_float, unsigned>> rec;
-    for (bst_omp_uint k = 0; k < ngroup; ++k) {
-      double total_pos = 0.0;
-      double total_neg = 0.0;
-      rec.clear();
-      for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
-        total_pos += info.GetWeight(j) * info.labels[j];
-        total_neg += info.GetWeight(j) * (1.0f - info.labels[j]);
-        rec.push_back(std::make_pair(preds[j], j));
-      }
-      XGBOOST_PARALLEL_SORT(rec.begin(), rec.end(), common::CmpFirst);
+    if (ngroup == 1) {
+      // a single group is sorted and swept by all the threads
+      const int nthread = omp_get_max_threads();
+      std::vector<PredBucket> run;
+      MakeRun(preds, info, gptr[0], gptr[1], nthread, &run);
+      if (merge) AllMergeRuns(&run);
+      double total_pos, total_neg;
+      auc = RunAUCPR(run, nthread, &total_pos, &total_neg);
       // we need pos > 0 && neg > 0
-      if (0.0 == total_pos || 0.0 == total_neg) {
-        auc_error = 1;
-      }
-      // calculate AUC
-      double tp = 0.0, prevtp = 0.0, fp = 0.0, prevfp = 0.0, h = 0.0, a = 0.0, b = 0.0;
-      for (size_t j = 0; j < rec.size(); ++j) {
-        tp += info.GetWeight(rec[j].second) * info.labels[rec[j].second];
-        fp += info.GetWeight(rec[j].second) * (1.0f - info.labels[rec[j].second]);
-        if ((j < rec.size() - 1 && rec[j].first != rec[j + 1].first) || j  == rec.size() - 1) {
-          if (tp == prevtp) {
-            h = 1.0;
-            a = 1.0;
-            b = 0.0;
-          } else {
-            h = (fp - prevfp) / (tp - prevtp);
-            a = 1.0 + h;
-            b = (prevfp - h * prevtp) / total_pos;
-          }
-          if (0.0 != b) {
-            auc += (tp / total_pos - prevtp / total_pos -
-                    b / a * (std::log(a * tp / total_pos + b) -
-                             std::log(a * prevtp / total_pos + b))) / a;
-          } else {
-            auc += (tp / total_pos - prevtp / total_pos) / a;
-          }
-          if (auc > 1.0) {
-            auc_gt_one = 1;
-          }
-          prevtp = tp;
-          prevfp = fp;
+      auc_error = 0.0 == total_pos || 0.0 == total_neg;
+      auc_gt_one = auc > 1.0;
+    } else {
+      #pragma omp parallel reduction(+:auc)
+      {
+        // each thread takes a local run
+        std::vector<PredBucket> run;
+        #pragma omp for schedule(static)
+        for (bst_omp_uint k = 0; k < ngroup; ++k) {
+          MakeRun(preds, info, gptr[k], gptr[k + 1], 1, &run);
+          double total_pos, total_neg;
+          const double group_auc = RunAUCPR(run, 1, &total_pos, &total_neg);
+          if (0.0 == total_pos || 0.0 == total_neg) auc_error = 1;
+          if (group_auc > 1.0) auc_gt_one = 1;
+          auc += group_auc;
         }
       }
-      // sanity check
-      if (tp < 0 || prevtp < 0 || fp < 0 || prevfp < 0) {
-        CHECK(!auc_error) << "AUC-PR: error in calculation";
-      }
     }
     CHECK(!auc_error) << "AUC-PR: the dataset only contains pos or neg samples";
     CHECK(!auc_gt_one) << "AUC-PR: AUC > 1.0";
-    if (distributed) {
+    if (merge) {
+      return static_cast<bst_float>(auc);
+    } else if (distributed) {
       bst_float dat[2];
       dat[0] = static_cast<bst_float>(auc);
       dat[1] = static_cast<bst_float>(ngroup);
-      // approximately estimate auc using mean
+      // the groups of the workers are distinct, average their auc
       rabit::Allreduce<rabit::op::Sum>(dat, 2);
       return dat[0] / dat[1];
     } else {
@@ -435,6 +564,7 @@ struct EvalAucPR : public Metric {
     }
   }
   const char *Name() const override { return "aucpr"; }
+  bool Maximize() const override { return true; }
 };
 
 
@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <utility>
 #include "../common/math.h"
+#include "../common/avx_helpers.h"
 
 namespace xgboost {
 namespace obj {
@@ -43,36 +44,51 @@ class SoftmaxMultiClassObj : public ObjFunction {
     CHECK_NE(info.labels.size(), 0U) << "label set cannot be empty";
     CHECK(preds->size() == (static_cast<size_t>(param_.num_class) * info.labels.size()))
         << "SoftmaxMultiClassObj: label size and pred size does not match";
-    std::vector<bst_float>& preds_h = preds->data_h();
+    const std::vector<bst_float>& preds_h = preds->const_data_h();
     out_gpair->resize(preds_h.size());
     std::vector<bst_gpair>& gpair = out_gpair->data_h();
     const int nclass = param_.num_class;
     const omp_ulong ndata = static_cast<omp_ulong>(preds_h.size() / nclass);
+    // rows of few classes go through softmax kLanes rows at a time
+    const bool blocked = nclass < kMinRowClasses;
+    const omp_ulong nblock = blocked ? (ndata + kLanes - 1) / kLanes : 0;
 
     int label_error = 0;
     #pragma omp parallel
     {
-      std::vector<bst_float> rec(nclass);
+      std::vector<bst_float> rec(blocked ? nclass * kLanes : nclass);
       #pragma omp for schedule(static)
-      for (omp_ulong i = 0; i < ndata; ++i) {
-        for (int k = 0; k < nclass; ++k) {
-          rec[k] = preds_h[i * nclass + k];
+      for (omp_ulong b = 0; b < nblock; ++b) {
+        const omp_ulong begin = b * kLanes;
+        const int nrow = static_cast<int>(std::min<omp_ulong>(kLanes, ndata - begin));
+        LoadBlock(&preds_h[begin * nclass], nrow, nclass, dmlc::BeginPtr(rec));
+        SoftmaxBlock(dmlc::BeginPtr(rec), nclass);
+        for (int r = 0; r < nrow; ++r) {
+          const omp_ulong i = begin + r;
+          int label = static_cast<int>(info.labels[i]);
+          if (label < 0 || label >= nclass)  {
+            label_error = label; label = 0;
+          }
+          const bst_float wt = info.GetWeight(i);
+          for (int k = 0; k < nclass; ++k) {
+            const bst_float p = rec[k * kLanes + r];
+            const bst_float h = 2.0f * p * (1.0f - p) * wt;
+            gpair[i * nclass + k] = bst_gpair((label == k ? p - 1.0f : p) * wt, h);
+          }
         }
-        common::Softmax(&rec);
+      }
+      #pragma omp for schedule(static)
+      for (omp_ulong i = blocked ? ndata : 0; i < ndata; ++i) {
+        std::copy(&preds_h[i * nclass], &preds_h[i * nclass] + nclass, rec.begin());
+        SoftmaxRow(dmlc::BeginPtr(rec), nclass);
         int label = static_cast<int>(info.labels[i]);
         if (label < 0 || label >= nclass)  {
           label_error = label; label = 0;
         }
         const bst_float wt = info.GetWeight(i);
-        for (int k = 0; k < nclass; ++k) {
-          bst_float p = rec[k];
-          const bst_float h = 2.0f * p * (1.0f - p) * wt;
-          if (label == k) {
-            gpair[i * nclass + k] = bst_gpair((p - 1.0f) * wt, h);
-          } else {
-            gpair[i * nclass + k] = bst_gpair(p* wt, h);
-          }
-        }
+        RowGradient(dmlc::BeginPtr(rec), nclass, wt, &gpair[i * nclass]);
+        const bst_float p = rec[label];
+        gpair[i * nclass + label] = bst_gpair((p - 1.0f) * wt, 2.0f * p * (1.0f - p) * wt);
       }
     }
     CHECK(label_error >= 0 && label_error < nclass)
@@ -96,28 +112,118 @@ class SoftmaxMultiClassObj : public ObjFunction {
     std::vector<bst_float> tmp;
     const int nclass = param_.num_class;
     const omp_ulong ndata = static_cast<omp_ulong>(preds.size() / nclass);
-    if (!prob) tmp.resize(ndata);
-
+    if (!prob) {
+      tmp.resize(ndata);
+      #pragma omp parallel for schedule(static)
+      for (omp_ulong j = 0; j < ndata; ++j) {
+        const bst_float* row = &preds[j * nclass];
+        tmp[j] = static_cast<bst_float>(common::FindMaxIndex(row, row + nclass) - row);
+      }
+      preds = tmp;
+      return;
+    }
+    const bool blocked = nclass < kMinRowClasses;
+    const omp_ulong nblock = blocked ? (ndata + kLanes - 1) / kLanes : 0;
     #pragma omp parallel
     {
-      std::vector<bst_float> rec(nclass);
+      std::vector<bst_float> rec(blocked ? nclass * kLanes : 0);
       #pragma omp for schedule(static)
-      for (omp_ulong j = 0; j < ndata; ++j) {
-        for (int k = 0; k < nclass; ++k) {
-          rec[k] = preds[j * nclass + k];
-        }
-        if (!prob) {
-          tmp[j] = static_cast<bst_float>(
-              common::FindMaxIndex(rec.begin(), rec.end()) - rec.begin());
-        } else {
-          common::Softmax(&rec);
+      for (omp_ulong b = 0; b < nblock; ++b) {
+        bst_float* rows = &preds[b * kLanes * nclass];
+        const int nrow = static_cast<int>(std::min<omp_ulong>(kLanes, ndata - b * kLanes));
+        LoadBlock(rows, nrow, nclass, dmlc::BeginPtr(rec));
+        SoftmaxBlock(dmlc::BeginPtr(rec), nclass);
+        for (int r = 0; r < nrow; ++r) {
           for (int k = 0; k < nclass; ++k) {
-            preds[j * nclass + k] = rec[k];
+            rows[r * nclass + k] = rec[k * kLanes + r];
           }
         }
       }
+      #pragma omp for schedule(static)
+      for (omp_ulong j = blocked ? ndata : 0; j < ndata; ++j) {
+        SoftmaxRow(&preds[j * nclass], nclass);
+      }
+    }
+  }
+  /*! \brief rows per block, one in each lane of a Float8 */
+  static const int kLanes = 8;
+  /*! \brief number of classes from which a row goes through softmax alone */
+  static const int kMinRowClasses = 16;
+  // copy nrow <= kLanes rows into block, class major: block[k * kLanes + r],
+  // the missing rows are zero so a row gets the same result wherever it is
+  static inline void LoadBlock(const bst_float* rows, int nrow, int nclass,
+                               bst_float* block) {
+    for (int r = 0; r < kLanes; ++r) {
+      for (int k = 0; k < nclass; ++k) {
+        block[k * kLanes + r] = r < nrow ? rows[r * nclass + k] : 0.0f;
+      }
+    }
+  }
+  // softmax of the kLanes rows of a class major block, in place
+  static inline void SoftmaxBlock(bst_float* block, int nclass) {
+    avx::Float8 wmax(block);
+    for (int k = 1; k < nclass; ++k) {
+      wmax = std::max(wmax, avx::Float8(block + k * kLanes));
+    }
+    avx::Float8 wsum(0.0f);
+    for (int k = 0; k < nclass; ++k) {
+      avx::Float8 e = avx::Exp(avx::Float8(block + k * kLanes) - wmax);
+      avx::Store(block + k * kLanes, e);
+      wsum += e;
+    }
+    const avx::Float8 scale = avx::Float8(1.0f) / wsum;
+    for (int k = 0; k < nclass; ++k) {
+      avx::Store(block + k * kLanes, avx::Float8(block + k * kLanes) * scale);
+    }
+  }
+  // softmax of one row in place, kLanes classes at a time
+  static inline void SoftmaxRow(bst_float* row, int nclass) {
+    const int nvec = nclass / kLanes * kLanes;
+    bst_float wmax = row[0];
+    if (nvec != 0) {
+      avx::Float8 vmax(row);
+      for (int k = kLanes; k < nvec; k += kLanes) {
+        vmax = std::max(vmax, avx::Float8(row + k));
+      }
+      wmax = avx::HorizontalMax(vmax);
+    }
+    for (int k = nvec; k < nclass; ++k) {
+      wmax = std::max(wmax, row[k]);
+    }
+    const avx::Float8 vwmax(wmax);
+    avx::Float8 vsum(0.0f);
+    for (int k = 0; k < nvec; k += kLanes) {
+      avx::Float8 e = avx::Exp(avx::Float8(row + k) - vwmax);
+      avx::Store(row + k, e);
+      vsum += e;
+    }
+    bst_float wsum = nvec != 0 ? avx::HorizontalSum(vsum) : 0.0f;
+    for (int k = nvec; k < nclass; ++k) {
+      row[k] = std::exp(row[k] - wmax);
+      wsum += row[k];
+    }
+    const bst_float scale = 1.0f / wsum;
+    const avx::Float8 vscale(scale);
+    for (int k = 0; k < nvec; k += kLanes) {
+      avx::Store(row + k, avx::Float8(row + k) * vscale);
+    }
+    for (int k = nvec; k < nclass; ++k) {
+      row[k] *= scale;
+    }
+  }
+  // gradient of the probabilities of a row as if none was the label
+  static inline void RowGradient(const bst_float* prob, int nclass, bst_float wt,
+                                 bst_gpair* out) {
+    const int nvec = nclass / kLanes * kLanes;
+    const avx::Float8 w(wt), two_w(2.0f * wt), one(1.0f);
+    for (int k = 0; k < nvec; k += kLanes) {
+      const avx::Float8 p(prob + k);
+      avx::StoreGpair(out + k, p * w, p * (one - p) * two_w);
+    }
+    for (int k = nvec; k < nclass; ++k) {
+      const bst_float p = prob[k];
+      out[k] = bst_gpair(p * wt, 2.0f * p * (1.0f - p) * wt);
     }
-    if (!prob) preds = tmp;
   }
   // output probability
   bool output_prob_;
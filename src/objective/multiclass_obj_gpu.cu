@@ -0,0 +1,206 @@
+/*!
+ * Copyright 2018 XGBoost contributors
+ */
+// GPU implementation of the multi-class softmax objective.
+// Keeps the predictions and the gradients on the device between iterations.
+#include <dmlc/parameter.h>
+#include <thrust/copy.h>
+#include <xgboost/logging.h>
+#include <xgboost/objective.h>
+#include <vector>
+#include <utility>
+
+#include "../common/device_helpers.cuh"
+#include "../common/host_device_vector.h"
+
+namespace xgboost {
+namespace obj {
+
+DMLC_REGISTRY_FILE_TAG(multiclass_obj_gpu);
+
+struct GPUSoftmaxMultiClassParam
+    : public dmlc::Parameter<GPUSoftmaxMultiClassParam> {
+  int num_class;
+  int gpu_id;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(GPUSoftmaxMultiClassParam) {
+    DMLC_DECLARE_FIELD(num_class).set_lower_bound(1)
+        .describe("Number of output class in the multi-class classification.");
+    DMLC_DECLARE_FIELD(gpu_id)
+        .set_lower_bound(0)
+        .set_default(0)
+        .describe("gpu to use for objective function evaluation");
+  }
+};
+
+// softmax of the nclass margins at rec into out, the same arithmetic as
+// common::Softmax
+__device__ void SoftmaxRow(const float* rec, float* out, int nclass) {
+  float wmax = rec[0];
+  for (int k = 1; k < nclass; ++k) {
+    wmax = fmaxf(rec[k], wmax);
+  }
+  double wsum = 0.0;
+  for (int k = 0; k < nclass; ++k) {
+    out[k] = expf(rec[k] - wmax);
+    wsum += out[k];
+  }
+  for (int k = 0; k < nclass; ++k) {
+    out[k] /= static_cast<float>(wsum);
+  }
+}
+
+// GPU kernel for gradient computation, one thread per row
+__global__ void softmax_gradient_k(bst_gpair* __restrict__ out_gpair,
+                                   int* __restrict__ label_error,
+                                   const float* __restrict__ preds,
+                                   const float* __restrict__ labels,
+                                   const float* __restrict__ weights,
+                                   size_t ndata, int nclass) {
+  size_t i = threadIdx.x + static_cast<size_t>(blockIdx.x) * blockDim.x;
+  if (i >= ndata) return;
+  const float* rec = preds + i * nclass;
+  float wmax = rec[0];
+  for (int k = 1; k < nclass; ++k) {
+    wmax = fmaxf(rec[k], wmax);
+  }
+  double wsum = 0.0;
+  for (int k = 0; k < nclass; ++k) {
+    wsum += expf(rec[k] - wmax);
+  }
+  int label = static_cast<int>(labels[i]);
+  if (label < 0 || label >= nclass) {
+    *label_error = label;
+    label = 0;
+  }
+  const float wt = weights == nullptr ? 1.0f : weights[i];
+  for (int k = 0; k < nclass; ++k) {
+    float p = expf(rec[k] - wmax) / static_cast<float>(wsum);
+    const float h = 2.0f * p * (1.0f - p) * wt;
+    if (label == k) {
+      out_gpair[i * nclass + k] = bst_gpair((p - 1.0f) * wt, h);
+    } else {
+      out_gpair[i * nclass + k] = bst_gpair(p * wt, h);
+    }
+  }
+}
+
+// GPU kernel for the probability transformation, in place
+__global__ void softmax_transform_k(float* __restrict__ preds, size_t ndata,
+                                    int nclass) {
+  size_t i = threadIdx.x + static_cast<size_t>(blockIdx.x) * blockDim.x;
+  if (i >= ndata) return;
+  float* rec = preds + i * nclass;
+  SoftmaxRow(rec, rec, nclass);
+}
+
+// GPU kernel for the class index of the largest margin, the first one on ties
+__global__ void softmax_max_index_k(float* __restrict__ out,
+                                    const float* __restrict__ preds,
+                                    size_t ndata, int nclass) {
+  size_t i = threadIdx.x + static_cast<size_t>(blockIdx.x) * blockDim.x;
+  if (i >= ndata) return;
+  const float* rec = preds + i * nclass;
+  int max_k = 0;
+  for (int k = 1; k < nclass; ++k) {
+    if (rec[k] > rec[max_k]) max_k = k;
+  }
+  out[i] = static_cast<float>(max_k);
+}
+
+class GPUSoftmaxMultiClassObj : public ObjFunction {
+ public:
+  explicit GPUSoftmaxMultiClassObj(bool output_prob)
+      : output_prob_(output_prob) {}
+
+  void Configure(const std::vector<std::pair<std::string, std::string> >& args) override {
+    param_.InitAllowUnknown(args);
+  }
+
+  void GetGradient(HostDeviceVector<bst_float>* preds,
+                   const MetaInfo& info,
+                   int iter,
+                   HostDeviceVector<bst_gpair>* out_gpair) override {
+    CHECK_NE(info.labels.size(), 0U) << "label set cannot be empty";
+    CHECK(preds->size() == (static_cast<size_t>(param_.num_class) * info.labels.size()))
+        << "SoftmaxMultiClassObj: label size and pred size does not match";
+    const int nclass = param_.num_class;
+    const size_t ndata = info.labels.size();
+    out_gpair->resize(preds->size(), bst_gpair(), param_.gpu_id);
+    dh::safe_cuda(cudaSetDevice(param_.gpu_id));
+    // only copy the labels and weights once, similar to how the data is copied
+    if (labels_.size() != ndata) {
+      labels_.assign(info.labels.begin(), info.labels.end());
+      weights_.assign(info.weights.begin(), info.weights.end());
+    }
+    label_error_.assign(1, 0);
+
+    const int block = 256;
+    softmax_gradient_k<<<dh::div_round_up(ndata, block), block>>>(
+        out_gpair->ptr_d(param_.gpu_id), dh::raw(label_error_),
+        preds->const_ptr_d(param_.gpu_id), dh::raw(labels_),
+        weights_.size() > 0 ? dh::raw(weights_) : nullptr, ndata, nclass);
+    dh::safe_cuda(cudaGetLastError());
+
+    int label_error = label_error_[0];
+    CHECK(label_error >= 0 && label_error < nclass)
+        << "SoftmaxMultiClassObj: label must be in [0, num_class),"
+        << " num_class=" << nclass
+        << " but found " << label_error << " in label.";
+  }
+
+  void PredTransform(HostDeviceVector<bst_float>* io_preds) override {
+    this->Transform(io_preds, output_prob_);
+  }
+  void EvalTransform(HostDeviceVector<bst_float>* io_preds) override {
+    this->Transform(io_preds, true);
+  }
+  const char* DefaultEvalMetric() const override {
+    return "merror";
+  }
+
+ private:
+  inline void Transform(HostDeviceVector<bst_float>* io_preds, bool prob) {
+    const int nclass = param_.num_class;
+    const size_t ndata = io_preds->size() / nclass;
+    dh::safe_cuda(cudaSetDevice(param_.gpu_id));
+    const int block = 256;
+    if (prob) {
+      softmax_transform_k<<<dh::div_round_up(ndata, block), block>>>(
+          io_preds->ptr_d(param_.gpu_id), ndata, nclass);
+      dh::safe_cuda(cudaGetLastError());
+    } else {
+      dh::device_vector<bst_float> max_index(ndata);
+      softmax_max_index_k<<<dh::div_round_up(ndata, block), block>>>(
+          dh::raw(max_index), io_preds->ptr_d(param_.gpu_id), ndata, nclass);
+      dh::safe_cuda(cudaGetLastError());
+      io_preds->resize(ndata, 0.0f, param_.gpu_id);
+      thrust::copy(max_index.begin(), max_index.end(),
+                   io_preds->tbegin(param_.gpu_id));
+    }
+    dh::safe_cuda(cudaDeviceSynchronize());
+  }
+  // output probability
+  bool output_prob_;
+  dh::device_vector<bst_float> labels_;
+  dh::device_vector<bst_float> weights_;
+  dh::device_vector<int> label_error_;
+  // parameter
+  GPUSoftmaxMultiClassParam param_;
+};
+
+// register the objective functions
+DMLC_REGISTER_PARAMETER(GPUSoftmaxMultiClassParam);
+
+XGBOOST_REGISTER_OBJECTIVE(GPUSoftmaxMultiClass, "gpu:multi:softmax")
+.describe("Softmax for multi-class classification, output class index "
+          "(computed on GPU).")
+.set_body([]() { return new GPUSoftmaxMultiClassObj(false); });
+
+XGBOOST_REGISTER_OBJECTIVE(GPUSoftprobMultiClass, "gpu:multi:softprob")
+.describe("Softmax for multi-class classification, output probability "
+          "distribution (computed on GPU).")
+.set_body([]() { return new GPUSoftmaxMultiClassObj(true); });
+
+}  // namespace obj
+}  // namespace xgboost
@@ -33,6 +33,8 @@ namespace obj {
 DMLC_REGISTRY_LINK_TAG(regression_obj);
 #ifdef XGBOOST_USE_CUDA
   DMLC_REGISTRY_LINK_TAG(regression_obj_gpu);
+  DMLC_REGISTRY_LINK_TAG(multiclass_obj_gpu);
+  DMLC_REGISTRY_LINK_TAG(rank_obj_gpu);
 #endif
 DMLC_REGISTRY_LINK_TAG(multiclass_obj);
 DMLC_REGISTRY_LINK_TAG(rank_obj);
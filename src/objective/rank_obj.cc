@@ -9,7 +9,9 @@
 #include <xgboost/objective.h>
 #include <vector>
 #include <algorithm>
+#include <functional>
 #include <utility>
+#include "../common/arena.h"
 #include "../common/math.h"
 #include "../common/random.h"
 
@@ -42,7 +44,7 @@ class LambdaRankObj : public ObjFunction {
                    int iter,
                    HostDeviceVector<bst_gpair>* out_gpair) override {
     CHECK_EQ(preds->size(), info.labels.size()) << "label size predict size not match";
-    auto& preds_h = preds->data_h();
+    const auto& preds_h = preds->const_data_h();
     out_gpair->resize(preds_h.size());
     std::vector<bst_gpair>& gpair = out_gpair->data_h();
     // quick consistency when group is not available
@@ -51,70 +53,44 @@ class LambdaRankObj : public ObjFunction {
     CHECK(gptr.size() != 0 && gptr.back() == info.labels.size())
         << "group structure not consistent with #rows";
     const bst_omp_uint ngroup = static_cast<bst_omp_uint>(gptr.size() - 1);
+    const int nthread = omp_get_max_threads();
+    if (buffers_.size() < static_cast<size_t>(nthread)) buffers_.resize(nthread);
+    // a group holding more than a share of a thread of the rows is processed
+    // after the others by all the threads, so it does not hold up the loop
+    const size_t large = std::max(info.labels.size() / nthread,
+                                  static_cast<size_t>(kMinParallelGroup));
+    std::vector<bst_omp_uint> large_groups;
+    if (nthread > 1) {
+      for (bst_omp_uint k = 0; k < ngroup; ++k) {
+        if (gptr[k + 1] - gptr[k] > large) large_groups.push_back(k);
+      }
+    }
     #pragma omp parallel
     {
       // parall construct, declare random number generator here, so that each
       // thread use its own random number generator, seed by thread id and current iteration
       common::RandomEngine rnd(iter * 1111 + omp_get_thread_num());
-
-      std::vector<LambdaPair> pairs;
-      std::vector<ListEntry>  lst;
-      std::vector< std::pair<bst_float, unsigned> > rec;
+      GroupBuffer* buf = &buffers_[omp_get_thread_num()];
       #pragma omp for schedule(static)
       for (bst_omp_uint k = 0; k < ngroup; ++k) {
-        lst.clear(); pairs.clear();
-        for (unsigned j = gptr[k]; j < gptr[k+1]; ++j) {
-          lst.push_back(ListEntry(preds_h[j], info.labels[j], j));
-          gpair[j] = bst_gpair(0.0f, 0.0f);
-        }
-        std::sort(lst.begin(), lst.end(), ListEntry::CmpPred);
-        rec.resize(lst.size());
-        for (unsigned i = 0; i < lst.size(); ++i) {
-          rec[i] = std::make_pair(lst[i].label, i);
-        }
-        std::sort(rec.begin(), rec.end(), common::CmpFirst);
-        // enumerate buckets with same label, for each item in the lst, grab another sample randomly
-        for (unsigned i = 0; i < rec.size(); ) {
-          unsigned j = i + 1;
-          while (j < rec.size() && rec[j].first == rec[i].first) ++j;
-          // bucket in [i,j), get a sample outside bucket
-          unsigned nleft = i, nright = static_cast<unsigned>(rec.size() - j);
-          if (nleft + nright != 0) {
-            int nsample = param_.num_pairsample;
-            while (nsample --) {
-              for (unsigned pid = i; pid < j; ++pid) {
-                unsigned ridx = std::uniform_int_distribution<unsigned>(0, nleft + nright - 1)(rnd);
-                if (ridx < nleft) {
-                  pairs.push_back(LambdaPair(rec[ridx].second, rec[pid].second));
-                } else {
-                  pairs.push_back(LambdaPair(rec[pid].second, rec[ridx+j-i].second));
-                }
-              }
-            }
-          }
-          i = j;
-        }
-        // get lambda weight for the pairs
-        this->GetLambdaWeight(lst, &pairs);
-        // rescale each gradient and hessian so that the lst have constant weighted
-        float scale = 1.0f / param_.num_pairsample;
-        if (param_.fix_list_weight != 0.0f) {
-          scale *= param_.fix_list_weight / (gptr[k + 1] - gptr[k]);
-        }
-        for (size_t i = 0; i < pairs.size(); ++i) {
-          const ListEntry &pos = lst[pairs[i].pos_index];
-          const ListEntry &neg = lst[pairs[i].neg_index];
-          const bst_float w = pairs[i].weight * scale;
-          const float eps = 1e-16f;
-          bst_float p = common::Sigmoid(pos.pred - neg.pred);
-          bst_float g = p - 1.0f;
-          bst_float h = std::max(p * (1.0f - p), eps);
+        if (nthread > 1 && gptr[k + 1] - gptr[k] > large) continue;
+        this->InitGroup(preds_h, info, gptr[k], gptr[k + 1], 1, buf, &gpair);
+        this->SamplePairs(0, buf->rec.size(), &rnd, buf);
+        this->GetLambdaWeight(buf->lst, &buf->pairs, 1, &buf->arena);
+        const bst_float scale = this->ListScale(gptr[k + 1] - gptr[k]);
+        for (const LambdaPair& pair : buf->pairs) {
+          const ListEntry &pos = buf->lst[pair.pos_index];
+          const ListEntry &neg = buf->lst[pair.neg_index];
+          const bst_gpair g = PairGradient(pos, neg, pair.weight * scale);
           // accumulate gradient and hessian in both pid, and nid
-          gpair[pos.rindex] += bst_gpair(g * w, 2.0f*w*h);
-          gpair[neg.rindex] += bst_gpair(-g * w, 2.0f*w*h);
+          gpair[pos.rindex] += g;
+          gpair[neg.rindex] += bst_gpair(-g.GetGrad(), g.GetHess());
         }
       }
     }
+    for (bst_omp_uint k : large_groups) {
+      this->ParallelGroup(preds_h, info, iter, gptr[k], gptr[k + 1], nthread, &gpair);
+    }
   }
   const char* DefaultEvalMetric(void) const override {
     return "map";
@@ -153,22 +129,229 @@ class LambdaRankObj : public ObjFunction {
     LambdaPair(unsigned pos_index, unsigned neg_index)
         : pos_index(pos_index), neg_index(neg_index), weight(1.0f) {}
   };
+  /*! \brief run f(i) for i in [0, n), split among nthread threads if more than one */
+  template<typename Func>
+  inline static void ForEachPair(size_t n, int nthread, Func f) {
+    if (nthread > 1) {
+      const bst_omp_uint nsize = static_cast<bst_omp_uint>(n);
+      #pragma omp parallel for schedule(static) num_threads(nthread)
+      for (bst_omp_uint i = 0; i < nsize; ++i) f(i);
+    } else {
+      for (size_t i = 0; i < n; ++i) f(i);
+    }
+  }
   /*!
    * \brief get lambda weight for existing pairs
    * \param list a list that is sorted by pred score
    * \param io_pairs record of pairs, containing the pairs to fill in weights
+   * \param nthread the number of threads filling the weights
+   * \param arena scratch memory of the caller thread
    */
   virtual void GetLambdaWeight(const std::vector<ListEntry> &sorted_list,
-                               std::vector<LambdaPair> *io_pairs) = 0;
+                               std::vector<LambdaPair> *io_pairs, int nthread,
+                               common::Arena *arena) = 0;
 
  private:
+  /*! \brief buffers of a group, kept by each thread across iterations */
+  struct GroupBuffer {
+    /*! \brief the group sorted by prediction */
+    std::vector<ListEntry> lst;
+    /*! \brief positions in lst bucketed by label, in decreasing label order */
+    std::vector<unsigned> rec;
+    /*! \brief label bucket of each position in lst */
+    std::vector<unsigned> bucket;
+    /*! \brief start of each label bucket in rec */
+    std::vector<unsigned> bucket_ptr;
+    /*! \brief the distinct labels of the group, decreasing */
+    std::vector<bst_float> bucket_label;
+    /*! \brief the sampled pairs */
+    std::vector<LambdaPair> pairs;
+    /*! \brief gradient of each position of lst, when a group is split among threads */
+    std::vector<bst_gpair> partial;
+    /*! \brief scratch of the lambda weights of a group */
+    common::Arena arena;
+  };
+  /*! \brief groups up to this size are never split among threads */
+  static const size_t kMinParallelGroup = 2048;
+  /*! \brief positions sampled from the same seed when a group is split */
+  static const unsigned kSampleChunk = 1024;
+  /*! \brief above this many distinct labels, they are found by sorting */
+  static const unsigned kMaxLabelBuckets = 16;
+  /*! \brief gradient of the positive entry of a pair of weight w, the negative one gets -grad */
+  inline static bst_gpair PairGradient(const ListEntry &pos, const ListEntry &neg,
+                                       bst_float w) {
+    const float eps = 1e-16f;
+    bst_float p = common::Sigmoid(pos.pred - neg.pred);
+    bst_float g = p - 1.0f;
+    bst_float h = std::max(p * (1.0f - p), eps);
+    return bst_gpair(g * w, 2.0f * w * h);
+  }
+  // rescale each gradient and hessian so that the lst have constant weighted
+  inline bst_float ListScale(size_t group_size) const {
+    bst_float scale = 1.0f / param_.num_pairsample;
+    if (param_.fix_list_weight != 0.0f) {
+      scale *= param_.fix_list_weight / group_size;
+    }
+    return scale;
+  }
+  /*!
+   * \brief sort the rows [begin, end) of a group by prediction into buf->lst,
+   *  bucket them by label and reserve its pairs. The buckets are counted
+   *  against the few distinct labels a group usually has, without sorting
+   *  the entries by label.
+   */
+  inline void InitGroup(const std::vector<bst_float> &preds, const MetaInfo &info,
+                        unsigned begin, unsigned end, int nthread, GroupBuffer *buf,
+                        std::vector<bst_gpair> *gpair) {
+    std::vector<ListEntry> &lst = buf->lst;
+    lst.clear();
+    for (unsigned j = begin; j < end; ++j) {
+      lst.push_back(ListEntry(preds[j], info.labels[j], j));
+      (*gpair)[j] = bst_gpair(0.0f, 0.0f);
+    }
+    if (nthread > 1) {
+      XGBOOST_PARALLEL_SORT(lst.begin(), lst.end(), ListEntry::CmpPred);
+    } else {
+      std::sort(lst.begin(), lst.end(), ListEntry::CmpPred);
+    }
+    // bucket of each entry, against the distinct labels in order of appearance
+    std::vector<bst_float> &values = buf->bucket_label;
+    std::vector<unsigned> &bucket = buf->bucket;
+    values.clear();
+    bucket.resize(lst.size());
+    for (size_t i = 0; i < lst.size(); ++i) {
+      unsigned b = 0;
+      while (b < values.size() && values[b] != lst[i].label) ++b;
+      if (b == values.size()) {
+        if (values.size() == kMaxLabelBuckets) break;
+        values.push_back(lst[i].label);
+      }
+      bucket[i] = b;
+    }
+    // renumber the buckets by decreasing label, the many labels case sorts them
+    if (values.size() == kMaxLabelBuckets) {
+      values.clear();
+      for (const ListEntry &e : lst) values.push_back(e.label);
+      std::sort(values.begin(), values.end(), std::greater<bst_float>());
+      values.resize(std::unique(values.begin(), values.end()) - values.begin());
+      for (size_t i = 0; i < lst.size(); ++i) {
+        bucket[i] = static_cast<unsigned>(
+            std::lower_bound(values.begin(), values.end(), lst[i].label,
+                             std::greater<bst_float>()) - values.begin());
+      }
+    } else {
+      unsigned order[kMaxLabelBuckets], rank[kMaxLabelBuckets];
+      for (unsigned b = 0; b < values.size(); ++b) order[b] = b;
+      std::sort(order, order + values.size(), [&values](unsigned a, unsigned b) {
+          return values[a] > values[b];
+        });
+      for (unsigned b = 0; b < values.size(); ++b) rank[order[b]] = b;
+      for (size_t i = 0; i < lst.size(); ++i) bucket[i] = rank[bucket[i]];
+      std::sort(values.begin(), values.end(), std::greater<bst_float>());
+    }
+    // counting sort of the positions by bucket
+    std::vector<unsigned> &bucket_ptr = buf->bucket_ptr;
+    std::vector<unsigned> &rec = buf->rec;
+    bucket_ptr.assign(values.size() + 1, 0);
+    rec.resize(lst.size());
+    for (size_t i = 0; i < lst.size(); ++i) ++bucket_ptr[bucket[i] + 1];
+    for (size_t b = 1; b < bucket_ptr.size(); ++b) bucket_ptr[b] += bucket_ptr[b - 1];
+    for (unsigned i = 0; i < lst.size(); ++i) rec[bucket_ptr[bucket[i]]++] = i;
+    for (size_t b = bucket_ptr.size() - 1; b > 0; --b) bucket_ptr[b] = bucket_ptr[b - 1];
+    bucket_ptr[0] = 0;
+    // with a single label there is no pair, otherwise each entry gets
+    // num_pairsample pairs with entries of the other buckets
+    buf->pairs.resize(values.size() > 1 ? lst.size() * param_.num_pairsample : 0,
+                      LambdaPair(0, 0));
+  }
+  /*!
+   * \brief for each entry at rec[begin, end), grab num_pairsample entries
+   *  randomly outside its bucket. The pairs of rec[i] are at
+   *  pairs[i * num_pairsample].
+   */
+  template<typename Engine>
+  inline void SamplePairs(unsigned begin, unsigned end, Engine *rnd, GroupBuffer *buf) {
+    if (buf->pairs.empty() || begin == end) return;
+    const std::vector<unsigned> &rec = buf->rec;
+    const std::vector<unsigned> &bucket_ptr = buf->bucket_ptr;
+    const unsigned n = static_cast<unsigned>(rec.size());
+    const int nsample = param_.num_pairsample;
+    size_t b = std::upper_bound(bucket_ptr.begin(), bucket_ptr.end(), begin)
+        - bucket_ptr.begin() - 1;
+    for (unsigned pid = begin; pid < end; ++pid) {
+      while (bucket_ptr[b + 1] <= pid) ++b;
+      // bucket in [i,j), get a sample outside bucket
+      const unsigned i = bucket_ptr[b], j = bucket_ptr[b + 1];
+      const unsigned nleft = i, nright = n - j;
+      LambdaPair *out = &buf->pairs[static_cast<size_t>(pid) * nsample];
+      for (int s = 0; s < nsample; ++s) {
+        unsigned ridx = std::uniform_int_distribution<unsigned>(0, nleft + nright - 1)(*rnd);
+        if (ridx < nleft) {
+          out[s] = LambdaPair(rec[ridx], rec[pid]);
+        } else {
+          out[s] = LambdaPair(rec[pid], rec[ridx + j - i]);
+        }
+      }
+    }
+  }
+  /*!
+   * \brief gradient of a large group with all the threads: the sort, the
+   *  sampling and the gradient are split among them. The sampling is seeded
+   *  per chunk of kSampleChunk entries, so it does not depend on the threads.
+   */
+  inline void ParallelGroup(const std::vector<bst_float> &preds, const MetaInfo &info,
+                            int iter, unsigned begin, unsigned end, int nthread,
+                            std::vector<bst_gpair> *gpair) {
+    GroupBuffer *buf = &buffers_[0];
+    this->InitGroup(preds, info, begin, end, nthread, buf, gpair);
+    const bst_omp_uint nchunk =
+        static_cast<bst_omp_uint>((buf->rec.size() + kSampleChunk - 1) / kSampleChunk);
+    #pragma omp parallel for schedule(static) num_threads(nthread)
+    for (bst_omp_uint c = 0; c < nchunk; ++c) {
+      std::seed_seq seed{iter, static_cast<int>(begin), static_cast<int>(c)};
+      common::RandomEngine rnd(seed);
+      const unsigned cbegin = c * kSampleChunk;
+      const unsigned cend = std::min(cbegin + kSampleChunk,
+                                     static_cast<unsigned>(buf->rec.size()));
+      this->SamplePairs(cbegin, cend, &rnd, buf);
+    }
+    this->GetLambdaWeight(buf->lst, &buf->pairs, nthread, &buf->arena);
+    const bst_float scale = this->ListScale(end - begin);
+    const std::vector<ListEntry> &lst = buf->lst;
+    const std::vector<LambdaPair> &pairs = buf->pairs;
+    const size_t npair = pairs.size();
+    #pragma omp parallel num_threads(nthread)
+    {
+      const int tid = omp_get_thread_num();
+      const int nt = omp_get_num_threads();
+      std::vector<bst_gpair> &partial = buffers_[tid].partial;
+      partial.assign(lst.size(), bst_gpair(0.0f, 0.0f));
+      const size_t pbegin = npair * tid / nt, pend = npair * (tid + 1) / nt;
+      for (size_t i = pbegin; i < pend; ++i) {
+        const bst_gpair g = PairGradient(lst[pairs[i].pos_index], lst[pairs[i].neg_index],
+                                         pairs[i].weight * scale);
+        partial[pairs[i].pos_index] += g;
+        partial[pairs[i].neg_index] += bst_gpair(-g.GetGrad(), g.GetHess());
+      }
+      #pragma omp barrier
+      #pragma omp for schedule(static)
+      for (bst_omp_uint i = 0; i < static_cast<bst_omp_uint>(lst.size()); ++i) {
+        bst_gpair sum(0.0f, 0.0f);
+        for (int t = 0; t < nt; ++t) sum += buffers_[t].partial[i];
+        (*gpair)[lst[i].rindex] = sum;
+      }
+    }
+  }
+
   LambdaRankParam param_;
+  /*! \brief the buffers of each thread */
+  std::vector<GroupBuffer> buffers_;
 };
 
 class PairwiseRankObj: public LambdaRankObj{
  protected:
   void GetLambdaWeight(const std::vector<ListEntry> &sorted_list,
-      std::vector<LambdaPair> *io_pairs) override {
+      std::vector<LambdaPair> *io_pairs, int nthread, common::Arena *arena) override {
     std::cout << "construct pair wise rank obj" << std::endl;
   }
 };
@@ -177,11 +360,14 @@ class PairwiseRankObj: public LambdaRankObj{
 class LambdaRankObjNDCG : public LambdaRankObj {
  protected:
   void GetLambdaWeight(const std::vector<ListEntry> &sorted_list,
-                       std::vector<LambdaPair> *io_pairs) override {
+                       std::vector<LambdaPair> *io_pairs, int nthread,
+                       common::Arena *arena) override {
     std::vector<LambdaPair> &pairs = *io_pairs;
     float IDCG;
     {
-      std::vector<bst_float> labels(sorted_list.size());
+      common::Arena::Scope scope(arena);
+      common::ArenaVector<bst_float> labels =
+          common::MakeArenaVector<bst_float>(arena, sorted_list.size());
       for (size_t i = 0; i < sorted_list.size(); ++i) {
         labels[i] = sorted_list[i].label;
       }
@@ -194,7 +380,7 @@ class LambdaRankObjNDCG : public LambdaRankObj {
       }
     } else {
       IDCG = 1.0f / IDCG;
-      for (size_t i = 0; i < pairs.size(); ++i) {
+      ForEachPair(pairs.size(), nthread, [&](size_t i) {
         unsigned pos_idx = pairs[i].pos_index;
         unsigned neg_idx = pairs[i].neg_index;
         float pos_loginv = 1.0f / std::log2(pos_idx + 2.0f);
@@ -208,10 +394,10 @@ class LambdaRankObjNDCG : public LambdaRankObj {
         bst_float delta = (original - changed) * IDCG;
         if (delta < 0.0f) delta = - delta;
         pairs[i].weight = delta;
-      }
+      });
     }
   }
-  inline static bst_float CalcDCG(const std::vector<bst_float> &labels) {
+  inline static bst_float CalcDCG(const common::ArenaVector<bst_float> &labels) {
     double sumdcg = 0.0;
     for (size_t i = 0; i < labels.size(); ++i) {
       const unsigned rel = static_cast<unsigned>(labels[i]);
@@ -253,8 +439,8 @@ class LambdaRankObjMAP : public LambdaRankObj {
    */
   inline bst_float GetLambdaMAP(const std::vector<ListEntry> &sorted_list,
                                 int index1, int index2,
-                                std::vector<MAPStats> *p_map_stats) {
-    std::vector<MAPStats> &map_stats = *p_map_stats;
+                                common::ArenaVector<MAPStats> *p_map_stats) {
+    common::ArenaVector<MAPStats> &map_stats = *p_map_stats;
     if (index1 == index2 || map_stats[map_stats.size() - 1].hits == 0) {
       return 0.0f;
     }
@@ -283,8 +469,8 @@ class LambdaRankObjMAP : public LambdaRankObj {
    * \param map_stats a vector containing the accumulated precisions for each position in a list
    */
   inline void GetMAPStats(const std::vector<ListEntry> &sorted_list,
-                          std::vector<MAPStats> *p_map_acc) {
-    std::vector<MAPStats> &map_acc = *p_map_acc;
+                          common::ArenaVector<MAPStats> *p_map_acc) {
+    common::ArenaVector<MAPStats> &map_acc = *p_map_acc;
     map_acc.resize(sorted_list.size());
     bst_float hit = 0, acc1 = 0, acc2 = 0, acc3 = 0;
     for (size_t i = 1; i <= sorted_list.size(); ++i) {
@@ -298,15 +484,17 @@ class LambdaRankObjMAP : public LambdaRankObj {
     }
   }
   void GetLambdaWeight(const std::vector<ListEntry> &sorted_list,
-                       std::vector<LambdaPair> *io_pairs) override {
+                       std::vector<LambdaPair> *io_pairs, int nthread,
+                       common::Arena *arena) override {
     std::vector<LambdaPair> &pairs = *io_pairs;
-    std::vector<MAPStats> map_stats;
+    common::Arena::Scope scope(arena);
+    common::ArenaVector<MAPStats> map_stats = common::MakeArenaVector<MAPStats>(arena);
     GetMAPStats(sorted_list, &map_stats);
-    for (size_t i = 0; i < pairs.size(); ++i) {
+    ForEachPair(pairs.size(), nthread, [&](size_t i) {
       pairs[i].weight =
           GetLambdaMAP(sorted_list, pairs[i].pos_index,
                        pairs[i].neg_index, &map_stats);
-    }
+    });
   }
 };
 
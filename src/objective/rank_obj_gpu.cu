@@ -0,0 +1,277 @@
+/*!
+ * Copyright 2018 XGBoost contributors
+ */
+// GPU implementation of the pairwise and NDCG lambda rank objectives.
+// Keeps the predictions and the gradients on the device between iterations.
+#include <dmlc/parameter.h>
+#include <thrust/binary_search.h>
+#include <thrust/execution_policy.h>
+#include <thrust/functional.h>
+#include <thrust/gather.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/random.h>
+#include <thrust/sequence.h>
+#include <thrust/sort.h>
+#include <xgboost/logging.h>
+#include <xgboost/objective.h>
+#include <vector>
+#include <utility>
+
+#include "../common/device_helpers.cuh"
+#include "../common/host_device_vector.h"
+#include "../common/math.h"
+
+namespace xgboost {
+namespace obj {
+
+DMLC_REGISTRY_FILE_TAG(rank_obj_gpu);
+
+struct GPULambdaRankParam : public dmlc::Parameter<GPULambdaRankParam> {
+  int num_pairsample;
+  float fix_list_weight;
+  int gpu_id;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(GPULambdaRankParam) {
+    DMLC_DECLARE_FIELD(num_pairsample).set_lower_bound(1).set_default(1)
+        .describe("Number of pair generated for each instance.");
+    DMLC_DECLARE_FIELD(fix_list_weight).set_lower_bound(0.0f).set_default(0.0f)
+        .describe("Normalize the weight of each list by this value,"
+                  " if equals 0, no effect will happen");
+    DMLC_DECLARE_FIELD(gpu_id)
+        .set_lower_bound(0)
+        .set_default(0)
+        .describe("gpu to use for objective function evaluation");
+  }
+};
+
+// lambda weight of the pairwise objective
+struct PairwiseLambdaWeight {
+  static const bool kUseIDCG = false;
+  __device__ static float Weight(unsigned pos_idx, unsigned neg_idx,
+                                 float pos_label, float neg_label,
+                                 float inv_idcg) {
+    return 1.0f;
+  }
+};
+
+// lambda weight of NDCG, the change of NDCG from swapping the two entries at
+// positions pos_idx and neg_idx of the list sorted by prediction
+struct NDCGLambdaWeight {
+  static const bool kUseIDCG = true;
+  __device__ static float Weight(unsigned pos_idx, unsigned neg_idx,
+                                 float pos_label, float neg_label,
+                                 float inv_idcg) {
+    if (inv_idcg == 0.0f) return 0.0f;
+    float pos_loginv = 1.0f / log2f(pos_idx + 2.0f);
+    float neg_loginv = 1.0f / log2f(neg_idx + 2.0f);
+    int pos_rel = static_cast<int>(pos_label);
+    int neg_rel = static_cast<int>(neg_label);
+    float original =
+        ((1 << pos_rel) - 1) * pos_loginv + ((1 << neg_rel) - 1) * neg_loginv;
+    float changed =
+        ((1 << neg_rel) - 1) * pos_loginv + ((1 << pos_rel) - 1) * neg_loginv;
+    return fabsf((original - changed) * inv_idcg);
+  }
+};
+
+// Lambda rank on the device. The entries of every group are sorted by
+// prediction, then by label, and each entry samples num_pairsample partners
+// with a different label of its group as the CPU objective does, from a
+// counter based random stream instead of one generator per thread.
+template <typename LambdaWeight>
+class GPULambdaRankObj : public ObjFunction {
+ public:
+  void Configure(const std::vector<std::pair<std::string, std::string> >& args) override {
+    param_.InitAllowUnknown(args);
+  }
+
+  void GetGradient(HostDeviceVector<bst_float>* preds,
+                   const MetaInfo& info,
+                   int iter,
+                   HostDeviceVector<bst_gpair>* out_gpair) override {
+    CHECK_EQ(preds->size(), info.labels.size()) << "label size predict size not match";
+    const size_t ndata = preds->size();
+    // quick consistency when group is not available
+    std::vector<unsigned> tgptr(2, 0); tgptr[1] = static_cast<unsigned>(ndata);
+    const std::vector<unsigned> &gptr = info.group_ptr.size() == 0 ? tgptr : info.group_ptr;
+    CHECK(gptr.size() != 0 && gptr.back() == info.labels.size())
+        << "group structure not consistent with #rows";
+    out_gpair->resize(ndata, bst_gpair(), param_.gpu_id);
+    dh::safe_cuda(cudaSetDevice(param_.gpu_id));
+    // only copy the labels and groups once, similar to how the data is copied
+    if (labels_.size() != ndata) {
+      this->InitGroups(info, gptr);
+    }
+    auto policy = thrust::cuda::par(temp_memory_);
+
+    // positions of the rows sorted by prediction within the groups
+    thrust::sequence(order_.begin(), order_.end());
+    thrust::device_ptr<const float> preds_begin(preds->const_ptr_d(param_.gpu_id));
+    thrust::copy(preds_begin, preds_begin + ndata, sort_keys_.begin());
+    thrust::sort_by_key(policy, sort_keys_.begin(), sort_keys_.end(),
+                        order_.begin(), thrust::greater<bst_float>());
+    thrust::gather(policy, order_.begin(), order_.end(), group_idx_.begin(),
+                   sort_groups_.begin());
+    thrust::stable_sort_by_key(policy, sort_groups_.begin(),
+                               sort_groups_.end(), order_.begin());
+
+    // the same positions sorted by label within the groups, with their labels
+    thrust::sequence(label_order_.begin(), label_order_.end());
+    thrust::gather(policy, order_.begin(), order_.end(), labels_.begin(),
+                   sort_keys_.begin());
+    thrust::stable_sort_by_key(policy, sort_keys_.begin(), sort_keys_.end(),
+                               label_order_.begin(),
+                               thrust::greater<bst_float>());
+    thrust::gather(policy, label_order_.begin(), label_order_.end(),
+                   sort_groups_.begin(), label_groups_.begin());
+    thrust::stable_sort_by_key(
+        policy, label_groups_.begin(), label_groups_.end(),
+        thrust::make_zip_iterator(
+            thrust::make_tuple(label_order_.begin(), sort_keys_.begin())));
+
+    thrust::fill(out_gpair->tbegin(param_.gpu_id),
+                 out_gpair->tend(param_.gpu_id), bst_gpair());
+    auto d_gpair = reinterpret_cast<float*>(out_gpair->ptr_d(param_.gpu_id));
+    auto d_preds = preds->const_ptr_d(param_.gpu_id);
+    auto d_order = dh::raw(order_);
+    auto d_label_order = dh::raw(label_order_);
+    auto d_sorted_label = dh::raw(sort_keys_);
+    auto d_group = dh::raw(label_groups_);
+    auto d_group_ptr = dh::raw(group_ptr_);
+    auto d_inv_idcg = dh::raw(inv_idcg_);
+    const int num_pairsample = param_.num_pairsample;
+    const float fix_list_weight = param_.fix_list_weight;
+    const unsigned seed = static_cast<unsigned>(iter * 1111);
+    dh::launch_n(param_.gpu_id, ndata, [=] __device__(size_t q) {
+      const unsigned g = d_group[q];
+      const unsigned gbegin = d_group_ptr[g], gend = d_group_ptr[g + 1];
+      // bucket [i, j) of the entries with the same label
+      const float label = d_sorted_label[q];
+      const unsigned i =
+          thrust::lower_bound(thrust::seq, d_sorted_label + gbegin,
+                              d_sorted_label + gend, label,
+                              thrust::greater<float>()) - d_sorted_label;
+      const unsigned j =
+          thrust::upper_bound(thrust::seq, d_sorted_label + gbegin,
+                              d_sorted_label + gend, label,
+                              thrust::greater<float>()) - d_sorted_label;
+      const unsigned nleft = i - gbegin, nright = gend - j;
+      if (nleft + nright == 0) return;
+      // rescale each gradient and hessian so that the list has constant weight
+      float scale = 1.0f / num_pairsample;
+      if (fix_list_weight != 0.0f) {
+        scale *= fix_list_weight / (gend - gbegin);
+      }
+      thrust::default_random_engine rng(seed);
+      rng.discard(q * num_pairsample);
+      for (int s = 0; s < num_pairsample; ++s) {
+        unsigned ridx = thrust::uniform_int_distribution<unsigned>(
+            0, nleft + nright - 1)(rng);
+        unsigned pos_q = q, neg_q = q;
+        if (ridx < nleft) {
+          pos_q = gbegin + ridx;
+        } else {
+          neg_q = j + ridx - nleft;
+        }
+        const unsigned pos_idx = d_label_order[pos_q];
+        const unsigned neg_idx = d_label_order[neg_q];
+        const float w =
+            LambdaWeight::Weight(pos_idx - gbegin, neg_idx - gbegin,
+                                 d_sorted_label[pos_q], d_sorted_label[neg_q],
+                                 d_inv_idcg[g]) * scale;
+        const unsigned pos_row = d_order[pos_idx];
+        const unsigned neg_row = d_order[neg_idx];
+        const float eps = 1e-16f;
+        float p = common::Sigmoid(d_preds[pos_row] - d_preds[neg_row]);
+        float grad = p - 1.0f;
+        float h = fmaxf(p * (1.0f - p), eps);
+        // accumulate gradient and hessian in both pid, and nid
+        atomicAdd(d_gpair + 2 * pos_row, grad * w);
+        atomicAdd(d_gpair + 2 * pos_row + 1, 2.0f * w * h);
+        atomicAdd(d_gpair + 2 * neg_row, -grad * w);
+        atomicAdd(d_gpair + 2 * neg_row + 1, 2.0f * w * h);
+      }
+    });
+  }
+
+  const char* DefaultEvalMetric(void) const override {
+    return "map";
+  }
+
+  // copy the labels and the group structure to the device, the ideal DCG of
+  // the groups only depends on the labels. Public since it launches a device
+  // lambda.
+  void InitGroups(const MetaInfo& info, const std::vector<unsigned>& gptr) {
+    const size_t ndata = info.labels.size();
+    const size_t ngroup = gptr.size() - 1;
+    labels_.assign(info.labels.begin(), info.labels.end());
+    group_ptr_.assign(gptr.begin(), gptr.end());
+    group_idx_.resize(ndata);
+    order_.resize(ndata);
+    label_order_.resize(ndata);
+    sort_keys_.resize(ndata);
+    sort_groups_.resize(ndata);
+    label_groups_.resize(ndata);
+    inv_idcg_.assign(ngroup, 0.0f);
+    auto policy = thrust::cuda::par(temp_memory_);
+    thrust::upper_bound(policy, group_ptr_.begin() + 1, group_ptr_.end(),
+                        thrust::make_counting_iterator<unsigned>(0),
+                        thrust::make_counting_iterator<unsigned>(ndata),
+                        group_idx_.begin());
+    if (!LambdaWeight::kUseIDCG) return;
+
+    thrust::copy(labels_.begin(), labels_.end(), sort_keys_.begin());
+    thrust::copy(group_idx_.begin(), group_idx_.end(), sort_groups_.begin());
+    thrust::sort_by_key(policy, sort_keys_.begin(), sort_keys_.end(),
+                        sort_groups_.begin(), thrust::greater<bst_float>());
+    thrust::stable_sort_by_key(policy, sort_groups_.begin(),
+                               sort_groups_.end(), sort_keys_.begin());
+    auto d_sorted_label = dh::raw(sort_keys_);
+    auto d_group_ptr = dh::raw(group_ptr_);
+    auto d_inv_idcg = dh::raw(inv_idcg_);
+    dh::launch_n(param_.gpu_id, ngroup, [=] __device__(size_t g) {
+      double sumdcg = 0.0;
+      for (unsigned i = d_group_ptr[g]; i < d_group_ptr[g + 1]; ++i) {
+        const unsigned rel = static_cast<unsigned>(d_sorted_label[i]);
+        if (rel != 0) {
+          sumdcg += ((1 << rel) - 1) /
+                    log2f(static_cast<float>(i - d_group_ptr[g] + 2));
+        }
+      }
+      float idcg = static_cast<float>(sumdcg);
+      d_inv_idcg[g] = idcg == 0.0f ? 0.0f : 1.0f / idcg;
+    });
+  }
+
+ private:
+  GPULambdaRankParam param_;
+  dh::device_vector<bst_float> labels_;
+  dh::device_vector<unsigned> group_ptr_;
+  // group of each row
+  dh::device_vector<unsigned> group_idx_;
+  // inverse of the ideal DCG of each group, 0 when the ideal DCG is 0
+  dh::device_vector<bst_float> inv_idcg_;
+  // rows in the order of their prediction within the groups
+  dh::device_vector<unsigned> order_;
+  // positions into order_ in the order of their label within the groups
+  dh::device_vector<unsigned> label_order_;
+  dh::device_vector<bst_float> sort_keys_;
+  dh::device_vector<unsigned> sort_groups_;
+  dh::device_vector<unsigned> label_groups_;
+  dh::CubMemory temp_memory_;
+};
+
+// register the objective functions
+DMLC_REGISTER_PARAMETER(GPULambdaRankParam);
+
+XGBOOST_REGISTER_OBJECTIVE(GPUPairwiseRankObj, "gpu:rank:pairwise")
+.describe("Pairwise rank objective (computed on GPU).")
+.set_body([]() { return new GPULambdaRankObj<PairwiseLambdaWeight>(); });
+
+XGBOOST_REGISTER_OBJECTIVE(GPULambdaRankNDCG, "gpu:rank:ndcg")
+.describe("LambdaRank with NDCG as objective (computed on GPU).")
+.set_body([]() { return new GPULambdaRankObj<NDCGLambdaWeight>(); });
+
+}  // namespace obj
+}  // namespace xgboost
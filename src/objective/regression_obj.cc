@@ -51,7 +51,7 @@ class RegLossObj : public ObjFunction {
     std::cout << "info.labels().size() = " << info.labels.size() << std::endl;
     std::cout << "preds->size() = " << preds->size() << std::endl;
 
-    auto& preds_h = preds->data_h();
+    const auto& preds_h = preds->const_data_h();
 
     this->LazyCheckLabels(info.labels);
     out_gpair->resize(preds_h.size());
@@ -94,9 +94,18 @@ class RegLossObj : public ObjFunction {
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
     std::vector<bst_float> &preds = io_preds->data_h();
     const bst_omp_uint ndata = static_cast<bst_omp_uint>(preds.size());
+    const bst_omp_uint nvec = ndata / 8 * 8;
 #pragma omp parallel for schedule(static)
-    for (bst_omp_uint j = 0; j < ndata; ++j) {
-      preds[j] = Loss::PredTransform(preds[j]);
+    for (bst_omp_uint j = 0; j < nvec; j += 8) {
+      avx::Store(&preds[j], Loss::PredTransform(avx::Float8(&preds[j])));
+    }
+    // the last ones through a padded vector, a row is transformed the same
+    // wherever it is
+    if (nvec != ndata) {
+      bst_float tail[8] = {0};
+      std::copy(preds.begin() + nvec, preds.end(), tail);
+      avx::Store(tail, Loss::PredTransform(avx::Float8(tail)));
+      std::copy(tail, tail + (ndata - nvec), preds.begin() + nvec);
     }
   }
   bst_float ProbToMargin(bst_float base_score) const override {
@@ -144,6 +153,65 @@ struct PoissonRegressionParam : public dmlc::Parameter<PoissonRegressionParam> {
   }
 };
 
+/*!
+ * \brief compute the gradient of an objective with nonnegative labels, eight
+ *  rows at a time. The last rows go through zero padded vectors.
+ * \param gradient functor setting the gradient and hessian of the rows from
+ *  their prediction and label, before weighting.
+ * \return false if a label is negative.
+ */
+template <typename Gradient>
+inline bool NonNegativeLabelGradient(const std::vector<bst_float>& preds,
+                                     const MetaInfo& info, Gradient gradient,
+                                     std::vector<bst_gpair>* out_gpair) {
+  const omp_ulong ndata = static_cast<omp_ulong>(preds.size());
+  const omp_ulong nvec = ndata / 8 * 8;
+  bst_gpair* gpair = dmlc::BeginPtr(*out_gpair);
+  bool label_correct = true;
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nvec; i += 8) {
+    avx::Float8 y(&info.labels[i]);
+    avx::Float8 w = info.weights.empty() ? avx::Float8(1.0f)
+                                         : avx::Float8(&info.weights[i]);
+    if (avx::HorizontalMin(y) < 0.0f) label_correct = false;
+    avx::Float8 grad, hess;
+    gradient(avx::Float8(&preds[i]), y, &grad, &hess);
+    avx::StoreGpair(gpair + i, grad * w, hess * w);
+  }
+  if (nvec != ndata) {
+    bst_float p[8] = {0}, y[8] = {0}, w[8] = {0};
+    for (omp_ulong i = nvec; i < ndata; ++i) {
+      p[i - nvec] = preds[i];
+      y[i - nvec] = info.labels[i];
+      w[i - nvec] = info.GetWeight(i);
+      if (y[i - nvec] < 0.0f) label_correct = false;
+    }
+    avx::Float8 grad, hess;
+    gradient(avx::Float8(p), avx::Float8(y), &grad, &hess);
+    bst_gpair tail[8];
+    avx::StoreGpair(tail, grad * avx::Float8(w), hess * avx::Float8(w));
+    std::copy(tail, tail + (ndata - nvec), gpair + nvec);
+  }
+  return label_correct;
+}
+
+// preds[i] = exp(preds[i]), eight at a time and the last ones padded
+inline void ExpTransform(std::vector<bst_float>* preds) {
+  const omp_ulong ndata = static_cast<omp_ulong>(preds->size());
+  const omp_ulong nvec = ndata / 8 * 8;
+  bst_float* ptr = dmlc::BeginPtr(*preds);
+#pragma omp parallel for schedule(static)
+  for (omp_ulong j = 0; j < nvec; j += 8) {
+    avx::Store(ptr + j, avx::Exp(avx::Float8(ptr + j)));
+  }
+  if (nvec != ndata) {
+    bst_float tail[8] = {0};
+    std::copy(ptr + nvec, ptr + ndata, tail);
+    avx::Store(tail, avx::Exp(avx::Float8(tail)));
+    std::copy(tail, tail + (ndata - nvec), ptr + nvec);
+  }
+}
+
 // poisson regression for count
 class PoissonRegression : public ObjFunction {
  public:
@@ -158,34 +226,22 @@ class PoissonRegression : public ObjFunction {
                    HostDeviceVector<bst_gpair> *out_gpair) override {
     CHECK_NE(info.labels.size(), 0U) << "label set cannot be empty";
     CHECK_EQ(preds->size(), info.labels.size()) << "labels are not correctly provided";
-    auto& preds_h = preds->data_h();
+    const auto& preds_h = preds->const_data_h();
     out_gpair->resize(preds->size());
     auto& gpair = out_gpair->data_h();
-    // check if label in range
-    bool label_correct = true;
-    // start calculating gradient
-    const omp_ulong ndata = static_cast<omp_ulong>(preds_h.size()); // NOLINT(*)
-#pragma omp parallel for schedule(static)
-    for (omp_ulong i = 0; i < ndata; ++i) { // NOLINT(*)
-      bst_float p = preds_h[i];
-      bst_float w = info.GetWeight(i);
-      bst_float y = info.labels[i];
-      if (y >= 0.0f) {
-        gpair[i] = bst_gpair((std::exp(p) - y) * w,
-                             std::exp(p + param_.max_delta_step) * w);
-      } else {
-        label_correct = false;
-      }
-    }
+    // exp(p + max_delta_step) = exp(p) * exp(max_delta_step)
+    const avx::Float8 delta_scale(std::exp(param_.max_delta_step));
+    bool label_correct = NonNegativeLabelGradient(
+        preds_h, info,
+        [&](avx::Float8 p, avx::Float8 y, avx::Float8* grad, avx::Float8* hess) {
+          avx::Float8 exp_p = avx::Exp(p);
+          *grad = exp_p - y;
+          *hess = exp_p * delta_scale;
+        }, &gpair);
     CHECK(label_correct) << "PoissonRegression: label must be nonnegative";
   }
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
-    std::vector<bst_float> &preds = io_preds->data_h();
-    const long ndata = static_cast<long>(preds.size()); // NOLINT(*)
-#pragma omp parallel for schedule(static)
-    for (long j = 0; j < ndata; ++j) {  // NOLINT(*)
-      preds[j] = std::exp(preds[j]);
-    }
+    ExpTransform(&io_preds->data_h());
   }
   void EvalTransform(HostDeviceVector<bst_float> *io_preds) override {
     PredTransform(io_preds);
@@ -219,17 +275,21 @@ class CoxRegression : public ObjFunction {
                    HostDeviceVector<bst_gpair> *out_gpair) override {
     CHECK_NE(info.labels.size(), 0U) << "label set cannot be empty";
     CHECK_EQ(preds->size(), info.labels.size()) << "labels are not correctly provided";
-    auto& preds_h = preds->data_h();
+    const auto& preds_h = preds->const_data_h();
     out_gpair->resize(preds_h.size());
     auto& gpair = out_gpair->data_h();
     const std::vector<size_t> &label_order = info.LabelAbsSort();
 
     const omp_ulong ndata = static_cast<omp_ulong>(preds_h.size()); // NOLINT(*)
 
+    // exp of the predictions, computed once for both passes
+    std::vector<bst_float> exp_preds(preds_h);
+    ExpTransform(&exp_preds);
+
     // pre-compute a sum
     double exp_p_sum = 0;  // we use double because we might need the precision with large datasets
     for (omp_ulong i = 0; i < ndata; ++i) {
-      exp_p_sum += std::exp(preds_h[label_order[i]]);
+      exp_p_sum += exp_preds[label_order[i]];
     }
 
     // start calculating grad and hess
@@ -240,8 +300,7 @@ class CoxRegression : public ObjFunction {
     double accumulated_sum = 0;
     for (omp_ulong i = 0; i < ndata; ++i) { // NOLINT(*)
       const size_t ind = label_order[i];
-      const double p = preds_h[ind];
-      const double exp_p = std::exp(p);
+      const double exp_p = exp_preds[ind];
       const double w = info.GetWeight(ind);
       const double y = info.labels[ind];
       const double abs_y = std::abs(y);
@@ -271,12 +330,7 @@ class CoxRegression : public ObjFunction {
     }
   }
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
-    std::vector<bst_float> &preds = io_preds->data_h();
-    const long ndata = static_cast<long>(preds.size()); // NOLINT(*)
-    #pragma omp parallel for schedule(static)
-    for (long j = 0; j < ndata; ++j) {  // NOLINT(*)
-      preds[j] = std::exp(preds[j]);
-    }
+    ExpTransform(&io_preds->data_h());
   }
   void EvalTransform(HostDeviceVector<bst_float> *io_preds) override {
     PredTransform(io_preds);
@@ -307,33 +361,21 @@ class GammaRegression : public ObjFunction {
                    HostDeviceVector<bst_gpair> *out_gpair) override {
     CHECK_NE(info.labels.size(), 0U) << "label set cannot be empty";
     CHECK_EQ(preds->size(), info.labels.size()) << "labels are not correctly provided";
-    auto& preds_h = preds->data_h();
+    const auto& preds_h = preds->const_data_h();
     out_gpair->resize(preds_h.size());
     auto& gpair = out_gpair->data_h();
-    // check if label in range
-    bool label_correct = true;
-    // start calculating gradient
-    const omp_ulong ndata = static_cast<omp_ulong>(preds_h.size()); // NOLINT(*)
-    #pragma omp parallel for schedule(static)
-    for (omp_ulong i = 0; i < ndata; ++i) { // NOLINT(*)
-      bst_float p = preds_h[i];
-      bst_float w = info.GetWeight(i);
-      bst_float y = info.labels[i];
-      if (y >= 0.0f) {
-        gpair[i] = bst_gpair((1 - y / std::exp(p)) * w, y / std::exp(p) * w);
-      } else {
-        label_correct = false;
-      }
-    }
+    bool label_correct = NonNegativeLabelGradient(
+        preds_h, info,
+        [](avx::Float8 p, avx::Float8 y, avx::Float8* grad, avx::Float8* hess) {
+          // y / exp(p) = y * exp(-p)
+          avx::Float8 y_exp_neg_p = y * avx::Exp(avx::Float8(0.0f) - p);
+          *grad = avx::Float8(1.0f) - y_exp_neg_p;
+          *hess = y_exp_neg_p;
+        }, &gpair);
     CHECK(label_correct) << "GammaRegression: label must be positive";
   }
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
-    std::vector<bst_float> &preds = io_preds->data_h();
-    const long ndata = static_cast<long>(preds.size()); // NOLINT(*)
-    #pragma omp parallel for schedule(static)
-    for (long j = 0; j < ndata; ++j) {  // NOLINT(*)
-      preds[j] = std::exp(preds[j]);
-    }
+    ExpTransform(&io_preds->data_h());
   }
   void EvalTransform(HostDeviceVector<bst_float> *io_preds) override {
     PredTransform(io_preds);
@@ -374,37 +416,23 @@ class TweedieRegression : public ObjFunction {
                    HostDeviceVector<bst_gpair> *out_gpair) override {
     CHECK_NE(info.labels.size(), 0U) << "label set cannot be empty";
     CHECK_EQ(preds->size(), info.labels.size()) << "labels are not correctly provided";
-    auto& preds_h = preds->data_h();
+    const auto& preds_h = preds->const_data_h();
     out_gpair->resize(preds->size());
     auto& gpair = out_gpair->data_h();
-    // check if label in range
-    bool label_correct = true;
-    // start calculating gradient
-    const omp_ulong ndata = static_cast<omp_ulong>(preds->size()); // NOLINT(*)
-    #pragma omp parallel for schedule(static)
-    for (omp_ulong i = 0; i < ndata; ++i) { // NOLINT(*)
-      bst_float p = preds_h[i];
-      bst_float w = info.GetWeight(i);
-      bst_float y = info.labels[i];
-      float rho = param_.tweedie_variance_power;
-      if (y >= 0.0f) {
-        bst_float grad = -y * std::exp((1 - rho) * p) + std::exp((2 - rho) * p);
-        bst_float hess = -y * (1 - rho) * \
-          std::exp((1 - rho) * p) + (2 - rho) * std::exp((2 - rho) * p);
-        gpair[i] = bst_gpair(grad * w, hess * w);
-      } else {
-        label_correct = false;
-      }
-    }
+    const float rho = param_.tweedie_variance_power;
+    const avx::Float8 one_minus_rho(1 - rho), two_minus_rho(2 - rho);
+    bool label_correct = NonNegativeLabelGradient(
+        preds_h, info,
+        [&](avx::Float8 p, avx::Float8 y, avx::Float8* grad, avx::Float8* hess) {
+          avx::Float8 a = avx::Exp(one_minus_rho * p);
+          avx::Float8 b = avx::Exp(two_minus_rho * p);
+          *grad = b - y * a;
+          *hess = two_minus_rho * b - y * one_minus_rho * a;
+        }, &gpair);
     CHECK(label_correct) << "TweedieRegression: label must be nonnegative";
   }
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
-    std::vector<bst_float> &preds = io_preds->data_h();
-    const long ndata = static_cast<long>(preds.size()); // NOLINT(*)
-#pragma omp parallel for schedule(static)
-    for (long j = 0; j < ndata; ++j) {  // NOLINT(*)
-      preds[j] = std::exp(preds[j]);
-    }
+    ExpTransform(&io_preds->data_h());
   }
   const char* DefaultEvalMetric(void) const override {
     std::ostringstream os;
@@ -126,12 +126,12 @@ class GPURegLossObj : public ObjFunction {
     size_t ndata = preds->size();
     out_gpair->resize(ndata, bst_gpair(), param_.gpu_id);
     LazyResize(ndata);
-    GetGradientDevice(preds->ptr_d(param_.gpu_id), info, iter,
+    GetGradientDevice(preds->const_ptr_d(param_.gpu_id), info, iter,
                       out_gpair->ptr_d(param_.gpu_id), ndata);
   }
 
  private:
-  void GetGradientDevice(float* preds,
+  void GetGradientDevice(const float* preds,
                          const MetaInfo &info,
                          int iter,
                          bst_gpair* out_gpair, size_t n) {
@@ -0,0 +1,395 @@
+/*!
+ * Copyright by Contributors 2018
+ * \file binned_predictor.cc
+ * \brief predictor traversing the trees on bin ids. The split thresholds of
+ *  every feature are collected from the model into a sorted table, the
+ *  features of a row are turned into their bins once, and the split nodes
+ *  compare small integers instead of floats.
+ */
+#include <xgboost/predictor.h>
+#include <xgboost/tree_model.h>
+#include <xgboost/tree_updater.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "dmlc/logging.h"
+#include "../common/host_device_vector.h"
+#include "../common/memory_tracker.h"
+
+namespace xgboost {
+namespace predictor {
+
+DMLC_REGISTRY_FILE_TAG(binned_predictor);
+
+/*!
+ * \brief the thresholds of a model and the split bin of every compiled node.
+ *  The bin of a value is the number of thresholds of its feature not greater
+ *  than it, so a value goes left exactly when its bin is below the split bin
+ *  of the node. A NaN value is in the bin past all the thresholds, and the
+ *  highest bin marks the missing values.
+ */
+struct BinnedModel {
+  /*! \brief thresholds of feature f in [cut_ptr[f], cut_ptr[f + 1]), sorted */
+  std::vector<size_t> cut_ptr;
+  std::vector<bst_float> cuts;
+  /*! \brief split bin of every compiled node, 0 for the leaves */
+  std::vector<uint16_t> split_bin;
+  /*! \brief whether a feature has more thresholds than uint8_t bins hold */
+  bool wide_bins{false};
+  /*! \brief the model this layout was built from */
+  const gbm::GBTreeModel* model{nullptr};
+  uint64_t version{0};
+
+  /*! \brief whether the layout is up to date with the model */
+  inline bool Matches(const gbm::GBTreeModel& m) const {
+    return model == &m && version == m.compiled_trees.version &&
+        split_bin.size() == m.compiled_trees.value.size();
+  }
+  /*! \brief whether the bins of the model fit into uint16_t */
+  inline static bool Supports(const gbm::GBTreeModel& m) {
+    return m.param.size_leaf_vector == 0 && m.compiled_trees.compact;
+  }
+  /*!
+   * \brief build the tables of the model
+   * \return false when a feature has too many thresholds
+   */
+  inline bool Build(const gbm::GBTreeModel& m) {
+    const gbm::CompiledTrees& trees = m.compiled_trees;
+    const unsigned offset_mask = (1U << gbm::CompiledTrees::kCompactOffsetBits) - 1U;
+    const unsigned fid_mask = (1U << gbm::CompiledTrees::kCompactFidBits) - 1U;
+    std::vector<std::vector<bst_float> > by_feat(std::max(m.param.num_feature, 0));
+    for (size_t pos = 0; pos < trees.node.size(); ++pos) {
+      const unsigned word = trees.node[pos];
+      if ((word & offset_mask) == 0) continue;
+      const unsigned fid = (word >> gbm::CompiledTrees::kCompactOffsetBits) & fid_mask;
+      if (fid >= by_feat.size()) by_feat.resize(fid + 1);
+      by_feat[fid].push_back(trees.value[pos]);
+    }
+    cut_ptr.assign(1, 0);
+    cuts.clear();
+    size_t max_cuts = 0;
+    for (std::vector<bst_float>& list : by_feat) {
+      std::sort(list.begin(), list.end());
+      list.erase(std::unique(list.begin(), list.end()), list.end());
+      max_cuts = std::max(max_cuts, list.size());
+      cuts.insert(cuts.end(), list.begin(), list.end());
+      cut_ptr.push_back(cuts.size());
+    }
+    // the bin past the thresholds and the missing bin are taken
+    if (max_cuts + 2 > static_cast<size_t>(std::numeric_limits<uint16_t>::max()) + 1) {
+      return false;
+    }
+    wide_bins = max_cuts + 2 > static_cast<size_t>(std::numeric_limits<uint8_t>::max()) + 1;
+    split_bin.assign(trees.value.size(), 0);
+    for (size_t pos = 0; pos < trees.node.size(); ++pos) {
+      const unsigned word = trees.node[pos];
+      if ((word & offset_mask) == 0) continue;
+      const unsigned fid = (word >> gbm::CompiledTrees::kCompactOffsetBits) & fid_mask;
+      const bst_float* begin = dmlc::BeginPtr(cuts) + cut_ptr[fid];
+      const bst_float* end = dmlc::BeginPtr(cuts) + cut_ptr[fid + 1];
+      split_bin[pos] = static_cast<uint16_t>(
+          std::lower_bound(begin, end, trees.value[pos]) - begin + 1);
+    }
+    model = &m;
+    version = trees.version;
+    return true;
+  }
+  /*! \brief number of features of the tables */
+  inline size_t NumFeature() const {
+    return cut_ptr.size() - 1;
+  }
+  /*! \brief the bin of a value of feature fid */
+  template <typename BinT>
+  inline BinT Bin(size_t fid, bst_float fvalue) const {
+    const bst_float* begin = dmlc::BeginPtr(cuts) + cut_ptr[fid];
+    const bst_float* end = dmlc::BeginPtr(cuts) + cut_ptr[fid + 1];
+    // NaN never compares less than the split condition
+    if (std::isnan(fvalue)) return static_cast<BinT>(end - begin);
+    return static_cast<BinT>(std::upper_bound(begin, end, fvalue) - begin);
+  }
+  /*! \brief the leaf value of a compiled tree for the bins of a row */
+  template <typename BinT>
+  inline bst_float Predict(const gbm::CompiledTrees& trees, size_t tree_id,
+                           const BinT* bins, unsigned root_id) const {
+    const unsigned offset_bits = gbm::CompiledTrees::kCompactOffsetBits;
+    const unsigned offset_mask = (1U << offset_bits) - 1U;
+    const unsigned fid_mask = (1U << gbm::CompiledTrees::kCompactFidBits) - 1U;
+    const BinT missing = std::numeric_limits<BinT>::max();
+    int pos = trees.roots[trees.root_ptr[tree_id] + root_id];
+    while ((trees.node[pos] & offset_mask) != 0) {
+      const unsigned word = trees.node[pos];
+      const BinT bin = bins[(word >> offset_bits) & fid_mask];
+      const bool go_left = bin == missing ? (word >> 31) != 0 : bin < split_bin[pos];
+      pos = go_left ? pos + 1 : pos + static_cast<int>(word & offset_mask);
+    }
+    return trees.value[pos];
+  }
+};
+
+class BinnedPredictor : public Predictor {
+ protected:
+  // init thread buffers
+  inline void InitThreadTemp(int nthread, int num_feature) {
+    int prev_thread_temp_size = thread_temp.size();
+    if (prev_thread_temp_size < nthread) {
+      thread_temp.resize(nthread, RegTree::FVec());
+      for (int i = prev_thread_temp_size; i < nthread; ++i) {
+        thread_temp[i].Init(num_feature);
+      }
+    }
+  }
+  template <typename BinT>
+  inline void PredLoopBinned(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
+                             const gbm::GBTreeModel& model, int num_group,
+                             unsigned tree_begin, unsigned tree_end) {
+    const MetaInfo& info = p_fmat->info();
+    const int nthread = omp_get_max_threads();
+    const size_t num_feature = binned.NumFeature();
+    const BinT missing = std::numeric_limits<BinT>::max();
+    // the bins of the features of a row, missing outside of the row
+    std::vector<BinT> thread_bins(nthread * num_feature, missing);
+    thread_psum.resize(nthread * num_group);
+    std::vector<bst_float>& preds = *out_preds;
+    CHECK_EQ(preds.size(), p_fmat->info().num_row * num_group);
+    const gbm::CompiledTrees& trees = model.compiled_trees;
+    dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const RowBatch& batch = iter->Value();
+      // parallel over local batch
+      const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const int tid = omp_get_thread_num();
+        BinT* bins = dmlc::BeginPtr(thread_bins) + tid * num_feature;
+        bst_float* psum = &thread_psum[tid * num_group];
+        const size_t ridx = static_cast<size_t>(batch.base_rowid + i);
+        const unsigned root_index = info.GetRoot(ridx);
+        const RowBatch::Inst inst = batch[i];
+        std::fill(psum, psum + num_group, 0.0f);
+        for (bst_uint k = 0; k < inst.length; ++k) {
+          if (inst[k].index < num_feature) {
+            bins[inst[k].index] = binned.Bin<BinT>(inst[k].index, inst[k].fvalue);
+          }
+        }
+        for (unsigned j = tree_begin; j < tree_end; ++j) {
+          psum[model.tree_info[j]] += binned.Predict(trees, j, bins, root_index);
+        }
+        for (bst_uint k = 0; k < inst.length; ++k) {
+          if (inst[k].index < num_feature) bins[inst[k].index] = missing;
+        }
+        for (int gid = 0; gid < num_group; ++gid) {
+          preds[ridx * num_group + gid] += psum[gid];
+        }
+      }
+    }
+  }
+  // plain traversal, used for the few trees added when updating the
+  // cache and for models the bin tables do not support
+  inline void PredLoopTraverse(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
+                               const gbm::GBTreeModel& model, int num_group,
+                               unsigned tree_begin, unsigned tree_end) {
+    const MetaInfo& info = p_fmat->info();
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
+    thread_psum.resize(nthread * num_group);
+    std::vector<bst_float>& preds = *out_preds;
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "size_leaf_vector is enforced to 0 so far";
+    CHECK_EQ(preds.size(), p_fmat->info().num_row * num_group);
+    CHECK_EQ(model.compiled_trees.Size(), model.trees.size());
+    dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const RowBatch& batch = iter->Value();
+      // parallel over local batch
+      const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const int tid = omp_get_thread_num();
+        RegTree::FVec& feats = thread_temp[tid];
+        bst_float* psum = &thread_psum[tid * num_group];
+        const size_t ridx = static_cast<size_t>(batch.base_rowid + i);
+        const unsigned root_index = info.GetRoot(ridx);
+        std::fill(psum, psum + num_group, 0.0f);
+        feats.Fill(batch[i]);
+        for (unsigned j = tree_begin; j < tree_end; ++j) {
+          psum[model.tree_info[j]] += model.compiled_trees.Predict(j, feats, root_index);
+        }
+        feats.Drop(batch[i]);
+        for (int gid = 0; gid < num_group; ++gid) {
+          preds[ridx * num_group + gid] += psum[gid];
+        }
+      }
+    }
+  }
+
+  void PredLoopInternal(DMatrix* dmat, std::vector<bst_float>* out_preds,
+                        const gbm::GBTreeModel& model, unsigned tree_begin,
+                        unsigned tree_end) {
+    if (!binned.Matches(model)) {
+      supported = BinnedModel::Supports(model) && binned.Build(model);
+    }
+    const int num_group = model.param.num_output_group;
+    if (!supported) {
+      PredLoopTraverse(dmat, out_preds, model, num_group, tree_begin, tree_end);
+    } else if (binned.wide_bins) {
+      PredLoopBinned<uint16_t>(dmat, out_preds, model, num_group, tree_begin, tree_end);
+    } else {
+      PredLoopBinned<uint8_t>(dmat, out_preds, model, num_group, tree_begin, tree_end);
+    }
+  }
+
+  bool PredictFromCache(DMatrix* dmat,
+                        HostDeviceVector<bst_float>* out_preds,
+                        const gbm::GBTreeModel& model,
+                        unsigned ntree_limit) {
+    if (ntree_limit == 0 ||
+        ntree_limit * model.param.num_output_group >= model.trees.size()) {
+      auto it = cache_.find(dmat);
+      if (it != cache_.end()) {
+        HostDeviceVector<bst_float>& y = it->second.predictions;
+        if (CacheCoversRows(dmat, it->second, model.param.num_output_group)) {
+          out_preds->resize(y.size());
+          std::copy(y.const_data_h().begin(), y.const_data_h().end(),
+                    out_preds->data_h().begin());
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  void InitOutPredictions(const MetaInfo& info,
+                          HostDeviceVector<bst_float>* out_preds,
+                          const gbm::GBTreeModel& model) const {
+    size_t n = model.param.num_output_group * info.num_row;
+    const std::vector<bst_float>& base_margin = info.base_margin;
+    out_preds->resize(n);
+    std::vector<bst_float>& out_preds_h = out_preds->data_h();
+    if (base_margin.size() != 0) {
+      CHECK_EQ(out_preds->size(), n);
+      std::copy(base_margin.begin(), base_margin.end(), out_preds_h.begin());
+    } else {
+      std::fill(out_preds_h.begin(), out_preds_h.end(), model.base_margin);
+    }
+  }
+
+ public:
+  BinnedPredictor() : cpu_predictor(Predictor::Create("cpu_predictor")) {}
+
+  void PredictBatch(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
+                    const gbm::GBTreeModel& model, int tree_begin,
+                    unsigned ntree_limit = 0) override {
+    if (this->PredictFromCache(dmat, out_preds, model, ntree_limit)) {
+      return;
+    }
+
+    this->InitOutPredictions(dmat->info(), out_preds, model);
+
+    ntree_limit *= model.param.num_output_group;
+    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model.trees.size());
+    }
+
+    this->PredLoopInternal(dmat, &out_preds->data_h(), model,
+                           tree_begin, ntree_limit);
+  }
+
+  void UpdatePredictionCache(
+      const gbm::GBTreeModel& model,
+      std::vector<std::unique_ptr<TreeUpdater>>* updaters,
+      int num_new_trees) override {
+    int old_ntree = model.trees.size() - num_new_trees;
+    // update cache entry
+    for (auto& kv : cache_) {
+      PredictionCacheEntry& e = kv.second;
+
+      if (e.predictions.size() !=
+          model.param.num_output_group * e.data->info().num_row) {
+        InitOutPredictions(e.data->info(), &(e.predictions), model);
+        PredLoopInternal(e.data.get(), &(e.predictions.data_h()), model, 0,
+                         model.trees.size());
+      } else if (model.param.num_output_group == 1 && num_new_trees == 1 &&
+                 UpdateCacheByUpdaters(updaters, e.data.get(), &(e.predictions))) {
+        {}  // do nothing
+      } else {
+        // only a few new trees, not worth rebuilding the bin tables
+        PredLoopTraverse(e.data.get(), &(e.predictions.data_h()), model,
+                         model.param.num_output_group, old_ntree, model.trees.size());
+      }
+    }
+    size_t nbytes = 0;
+    for (const auto& kv : cache_) nbytes += kv.second.predictions.size() * sizeof(bst_float);
+    cache_memory_.Set(nbytes);
+  }
+
+  // reentrant prediction goes through cpu_predictor, the bin tables are
+  // built lazily and so are mutable state of this predictor
+  void PredictBatch(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
+                    const gbm::GBTreeModel& model, int tree_begin,
+                    unsigned ntree_limit, PredictionContext* ctx) const override {
+    cpu_predictor->PredictBatch(dmat, out_preds, model, tree_begin, ntree_limit, ctx);
+  }
+
+  void PredictInstance(const SparseBatch::Inst& inst,
+                       std::vector<bst_float>* out_preds,
+                       const gbm::GBTreeModel& model, unsigned ntree_limit,
+                       unsigned root_index) override {
+    cpu_predictor->PredictInstance(inst, out_preds, model, ntree_limit, root_index);
+  }
+
+  void PredictInstance(const SparseBatch::Inst& inst,
+                       std::vector<bst_float>* out_preds,
+                       const gbm::GBTreeModel& model, unsigned ntree_limit,
+                       unsigned root_index, PredictionContext* ctx) const override {
+    cpu_predictor->PredictInstance(inst, out_preds, model, ntree_limit, root_index, ctx);
+  }
+  void PredictLeaf(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
+                   const gbm::GBTreeModel& model,
+                   unsigned ntree_limit) override {
+    cpu_predictor->PredictLeaf(p_fmat, out_preds, model, ntree_limit);
+  }
+
+  void PredictContribution(DMatrix* p_fmat,
+                           std::vector<bst_float>* out_contribs,
+                           const gbm::GBTreeModel& model, unsigned ntree_limit,
+                           bool approximate, int condition,
+                           unsigned condition_feature) override {
+    cpu_predictor->PredictContribution(p_fmat, out_contribs, model, ntree_limit,
+                                       approximate, condition,
+                                       condition_feature);
+  }
+
+  void PredictInteractionContributions(DMatrix* p_fmat,
+                                       std::vector<bst_float>* out_contribs,
+                                       const gbm::GBTreeModel& model,
+                                       unsigned ntree_limit,
+                                       bool approximate) override {
+    cpu_predictor->PredictInteractionContributions(p_fmat, out_contribs, model,
+                                                   ntree_limit, approximate);
+  }
+
+  void Init(const std::vector<std::pair<std::string, std::string>>& cfg,
+            const std::vector<std::shared_ptr<DMatrix>>& cache) override {
+    Predictor::Init(cfg, cache);
+    cpu_predictor->Init(cfg, {});
+  }
+
+ private:
+  std::unique_ptr<Predictor> cpu_predictor;
+  BinnedModel binned;
+  bool supported{false};
+  std::vector<RegTree::FVec> thread_temp;
+  std::vector<bst_float> thread_psum;
+  common::TrackedBytes cache_memory_{"PredictionCache"};
+};
+
+XGBOOST_REGISTER_PREDICTOR(BinnedPredictor, "cpu_binned")
+    .describe("Make predictions on CPU by comparing bin ids against the split thresholds "
+              "of the model.")
+    .set_body([]() { return new BinnedPredictor(); });
+}  // namespace predictor
+}  // namespace xgboost
@@ -1,30 +1,175 @@
 /*!
  * Copyright by Contributors 2017
  */
+#include <dmlc/parameter.h>
 #include <xgboost/predictor.h>
 #include <xgboost/tree_model.h>
 #include <xgboost/tree_updater.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include "dmlc/logging.h"
 #include "../common/host_device_vector.h"
+#include "../common/memory_tracker.h"
+
+#if defined(XGBOOST_USE_AVX) && defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 namespace xgboost {
 namespace predictor {
 
 DMLC_REGISTRY_FILE_TAG(cpu_predictor);
 
+/*! \brief how PredictContribution splits the work among threads */
+enum ContribParallel {
+  kContribParallelAuto = 0,
+  kContribParallelRows = 1,
+  kContribParallelTrees = 2
+};
+
+/*! \brief prediction parameters */
+struct CPUPredictionParam : public dmlc::Parameter<CPUPredictionParam> {
+  /*! \brief number of rows scored together against a block of trees */
+  int row_block_size;
+  /*! \brief number of trees kept cache resident while rows stream past */
+  int tree_block_size;
+  /*! \brief whether to use the multi-row kernel for dense batches */
+  int dense_kernel;
+  /*! \brief parallelism of feature contributions, one of ContribParallel */
+  int contrib_parallel;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(CPUPredictionParam) {
+    DMLC_DECLARE_FIELD(row_block_size).set_default(0).set_lower_bound(0).describe(
+        "Number of rows traversed together in batch prediction, 0 means auto.");
+    DMLC_DECLARE_FIELD(tree_block_size).set_default(0).set_lower_bound(0).describe(
+        "Number of trees traversed together in batch prediction, 0 means auto.");
+    DMLC_DECLARE_FIELD(dense_kernel).set_default(1).set_range(0, 1).describe(
+        "Traverse rows of dense batches several at a time with the lane kernel.");
+    DMLC_DECLARE_FIELD(contrib_parallel).set_default(kContribParallelAuto)
+        .add_enum("auto", kContribParallelAuto)
+        .add_enum("rows", kContribParallelRows)
+        .add_enum("trees", kContribParallelTrees)
+        .describe("Parallelize feature contributions over rows or over trees, "
+                  "auto goes over trees for small batches.");
+  }
+};
+DMLC_REGISTER_PARAMETER(CPUPredictionParam);
+
+/*! \brief number of dense rows traversed together by PredictDenseLanes */
+static const int kDenseLanes = 8;
+
+/*!
+ * \brief traverse one compiled tree for kDenseLanes dense rows at once,
+ *  every lane evaluates its own node in the same step.
+ *  Missing values are stored as NaN and follow the default direction.
+ * \tparam kCompact whether the nodes of the trees are compact
+ * \param trees compiled trees
+ * \param tree_id index of the tree
+ * \param rows row major features of kDenseLanes rows, num_feature per row
+ * \param num_feature number of columns of each row
+ * \param root_index starting root index of each row
+ * \param out_leaf output leaf value of each row
+ */
+template <bool kCompact>
+inline void PredictDenseLanes(const gbm::CompiledTrees& trees, size_t tree_id,
+                              const bst_float* rows, int num_feature,
+                              const unsigned* root_index, bst_float* out_leaf) {
+  const int* roots = &trees.roots[trees.root_ptr[tree_id]];
+  const bst_float* value = trees.value.data();
+  const unsigned offset_bits = gbm::CompiledTrees::kCompactOffsetBits;
+  const unsigned offset_mask = (1U << offset_bits) - 1U;
+  const unsigned compact_fid_mask = (1U << gbm::CompiledTrees::kCompactFidBits) - 1U;
+#if defined(XGBOOST_USE_AVX) && defined(__AVX2__)
+  const int* cright = trees.cright.data();
+  // the compact words also keep the default direction in the highest bit
+  const int* sindex = reinterpret_cast<const int*>(
+      kCompact ? trees.node.data() : trees.sindex.data());
+  __m256i pos = _mm256_setr_epi32(
+      roots[root_index[0]], roots[root_index[1]], roots[root_index[2]], roots[root_index[3]],
+      roots[root_index[4]], roots[root_index[5]], roots[root_index[6]], roots[root_index[7]]);
+  const __m256i row_offset = _mm256_mullo_epi32(
+      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(num_feature));
+  const __m256i fid_mask = _mm256_set1_epi32(
+      kCompact ? compact_fid_mask : (1U << 31) - 1U);
+  const __m256i right_mask = _mm256_set1_epi32(offset_mask);
+  const __m256i all_ones = _mm256_set1_epi32(-1);
+  const __m256i zero = _mm256_setzero_si256();
+  while (true) {
+    __m256i sidx, right, active;
+    if (kCompact) {
+      sidx = _mm256_i32gather_epi32(sindex, pos, 4);
+      const __m256i offset = _mm256_and_si256(sidx, right_mask);
+      active = _mm256_xor_si256(_mm256_cmpeq_epi32(offset, zero), all_ones);
+      if (_mm256_testz_si256(active, active)) break;
+      right = _mm256_add_epi32(pos, offset);
+    } else {
+      right = _mm256_i32gather_epi32(cright, pos, 4);
+      active = _mm256_xor_si256(_mm256_cmpeq_epi32(right, all_ones), all_ones);
+      if (_mm256_testz_si256(active, active)) break;
+      sidx = _mm256_i32gather_epi32(sindex, pos, 4);
+    }
+    const __m256 cond = _mm256_i32gather_ps(value, pos, 4);
+    const __m256i fid = kCompact ? _mm256_srli_epi32(sidx, offset_bits) : sidx;
+    const __m256i fidx = _mm256_add_epi32(_mm256_and_si256(fid, fid_mask), row_offset);
+    const __m256 fvalue = _mm256_i32gather_ps(rows, fidx, 4);
+    // a NaN never compares less, it goes left only when the default is left
+    const __m256i less = _mm256_castps_si256(_mm256_cmp_ps(fvalue, cond, _CMP_LT_OQ));
+    const __m256i missing = _mm256_castps_si256(_mm256_cmp_ps(fvalue, fvalue, _CMP_UNORD_Q));
+    const __m256i go_left = _mm256_or_si256(
+        less, _mm256_and_si256(missing, _mm256_srai_epi32(sidx, 31)));
+    const __m256i next = _mm256_blendv_epi8(
+        right, _mm256_sub_epi32(pos, all_ones), go_left);
+    pos = _mm256_blendv_epi8(pos, next, active);
+  }
+  _mm256_storeu_ps(out_leaf, _mm256_i32gather_ps(value, pos, 4));
+#else
+  int pos[kDenseLanes];
+  for (int k = 0; k < kDenseLanes; ++k) {
+    pos[k] = roots[root_index[k]];
+  }
+  bool active = true;
+  while (active) {
+    active = false;
+    for (int k = 0; k < kDenseLanes; ++k) {
+      unsigned sidx, fid;
+      int right;
+      if (kCompact) {
+        sidx = trees.node[pos[k]];
+        if ((sidx & offset_mask) == 0) continue;
+        right = pos[k] + static_cast<int>(sidx & offset_mask);
+        fid = (sidx >> offset_bits) & compact_fid_mask;
+      } else {
+        right = trees.cright[pos[k]];
+        if (right == -1) continue;
+        sidx = trees.sindex[pos[k]];
+        fid = sidx & ((1U << 31) - 1U);
+      }
+      active = true;
+      const bst_float fvalue = rows[k * num_feature + fid];
+      const bool go_left = std::isnan(fvalue) ? (sidx >> 31) != 0 : fvalue < value[pos[k]];
+      pos[k] = go_left ? pos[k] + 1 : right;
+    }
+  }
+  for (int k = 0; k < kDenseLanes; ++k) {
+    out_leaf[k] = value[pos[k]];
+  }
+#endif
+}
+
 class CPUPredictor : public Predictor {
  protected:
+  template <typename FeatVec>
   static bst_float PredValue(const RowBatch::Inst& inst,
-                             const std::vector<std::unique_ptr<RegTree>>& trees,
+                             const gbm::CompiledTrees& trees,
                              const std::vector<int>& tree_info, int bst_group,
-                             unsigned root_index, RegTree::FVec* p_feats,
+                             unsigned root_index, FeatVec* p_feats,
                              unsigned tree_begin, unsigned tree_end) {
     bst_float psum = 0.0f;
     p_feats->Fill(inst);
     for (size_t i = tree_begin; i < tree_end; ++i) {
       if (tree_info[i] == bst_group) {
-        int tid = trees[i]->GetLeafIndex(*p_feats, root_index);
-        psum += (*trees[i])[tid].leaf_value();
+        psum += trees.Predict(i, *p_feats, root_index);
       }
     }
     p_feats->Drop(inst);
@@ -32,7 +177,8 @@ class CPUPredictor : public Predictor {
   }
 
   // init thread buffers
-  inline void InitThreadTemp(int nthread, int num_feature) {
+  inline static void InitThreadTemp(int nthread, int num_feature, PredictionContext* ctx) {
+    std::vector<RegTree::FVec>& thread_temp = ctx->thread_temp;
     int prev_thread_temp_size = thread_temp.size();
     if (prev_thread_temp_size < nthread) {
       thread_temp.resize(nthread, RegTree::FVec());
@@ -41,67 +187,256 @@ class CPUPredictor : public Predictor {
       }
     }
   }
+  // number of rows in one block, the feature vectors of a block are
+  // kept within budget so they stay in cache next to the tree block
+  inline size_t RowBlockSize(const gbm::GBTreeModel& model) const {
+    if (param.row_block_size != 0) {
+      return static_cast<size_t>(param.row_block_size);
+    }
+    const size_t kMaxRows = 64;
+    const size_t kFVecBudget = 1 << 20;
+    size_t fvec_bytes = std::max(static_cast<size_t>(model.param.num_feature), size_t(1)) *
+        sizeof(bst_float);
+    return std::min(kMaxRows, std::max(kFVecBudget / fvec_bytes, size_t(1)));
+  }
+  // number of trees in one block, chosen so the compiled nodes of the
+  // block fit into the per-core L2 cache
+  inline size_t TreeBlockSize(const gbm::GBTreeModel& model,
+                              unsigned tree_begin, unsigned tree_end) const {
+    if (param.tree_block_size != 0) {
+      return static_cast<size_t>(param.tree_block_size);
+    }
+    if (tree_end <= tree_begin) return 1;
+    const size_t kNodeBudget = 256 << 10;
+    const gbm::CompiledTrees& trees = model.compiled_trees;
+    size_t nodes_begin = trees.roots[trees.root_ptr[tree_begin]];
+    size_t nodes_end = tree_end == trees.Size() ?
+        trees.value.size() : trees.roots[trees.root_ptr[tree_end]];
+    size_t node_bytes = trees.NodeBytes();
+    size_t avg_tree_bytes =
+        std::max((nodes_end - nodes_begin) * node_bytes / (tree_end - tree_begin), size_t(1));
+    return std::max(kNodeBudget / avg_tree_bytes, size_t(1));
+  }
+  // whether the batch is dense enough for the lane kernel, filling the
+  // missing slots with NaN is cheap compared to one row at a time
+  // traversal once at least half of the features are present
+  inline static bool IsDense(const RowBatch& batch, int num_feature) {
+    const size_t nnz = batch.ind_ptr[batch.size] - batch.ind_ptr[0];
+    return nnz * 2 >= batch.size * static_cast<size_t>(num_feature);
+  }
+  // scatter rows [begin, end) into a row major buffer with missing slots
+  // set to NaN, return false if a row holds a feature outside of the model
+  // or a stored value is NaN, since NaN marks missing in the lane kernel
+  inline static bool FillDense(const RowBatch& batch, size_t begin, size_t end,
+                               int num_feature, bst_float* rows) {
+    std::fill(rows, rows + (end - begin) * num_feature,
+              std::numeric_limits<bst_float>::quiet_NaN());
+    for (size_t i = begin; i < end; ++i) {
+      const RowBatch::Inst inst = batch[i];
+      bst_float* row = rows + (i - begin) * num_feature;
+      for (bst_uint j = 0; j < inst.length; ++j) {
+        if (inst[j].index >= static_cast<bst_uint>(num_feature) ||
+            std::isnan(inst[j].fvalue)) {
+          return false;
+        }
+        row[inst[j].index] = inst[j].fvalue;
+      }
+    }
+    return true;
+  }
+  // whether the rows look their features up in sparse feature vectors: for
+  // very wide models on sparse rows, the dense vectors of a thread take the
+  // memory of all the features while a row touches few of them
+  inline static bool UseSparseLookup(const gbm::GBTreeModel& model, const MetaInfo& info) {
+    const size_t kMinFeature = 1 << 16;
+    const size_t kMinSparsity = 64;
+    const size_t num_feature = static_cast<size_t>(model.param.num_feature);
+    if (num_feature < kMinFeature || info.num_row == 0) return false;
+    return info.num_nonzero / info.num_row * kMinSparsity < num_feature;
+  }
   inline void PredLoopSpecalize(DMatrix* p_fmat,
                                 std::vector<bst_float>* out_preds,
                                 const gbm::GBTreeModel& model, int num_group,
-                                unsigned tree_begin, unsigned tree_end) {
+                                unsigned tree_begin, unsigned tree_end,
+                                PredictionContext* ctx) const {
+    const int nthread = omp_get_max_threads();
+    if (UseSparseLookup(model, p_fmat->info())) {
+      const size_t row_block = param.row_block_size != 0 ?
+          static_cast<size_t>(param.row_block_size) : 64;
+      if (ctx->thread_sparse.size() < nthread * row_block) {
+        ctx->thread_sparse.resize(nthread * row_block);
+      }
+      this->PredLoopRows(p_fmat, out_preds, model, num_group, tree_begin, tree_end,
+                         row_block, false, &ctx->thread_sparse, ctx);
+    } else {
+      const size_t row_block = this->RowBlockSize(model);
+      InitThreadTemp(nthread * row_block, model.param.num_feature, ctx);
+      this->PredLoopRows(p_fmat, out_preds, model, num_group, tree_begin, tree_end,
+                         row_block, param.dense_kernel != 0, &ctx->thread_temp, ctx);
+    }
+  }
+  // predict the rows block by block, the rows outside of the lane kernel
+  // fill the feature vectors of thread_feats, row_block per thread
+  template <typename FeatVec>
+  inline void PredLoopRows(DMatrix* p_fmat,
+                           std::vector<bst_float>* out_preds,
+                           const gbm::GBTreeModel& model, int num_group,
+                           unsigned tree_begin, unsigned tree_end,
+                           size_t row_block, bool use_dense_kernel,
+                           std::vector<FeatVec>* thread_feats,
+                           PredictionContext* ctx) const {
     const MetaInfo& info = p_fmat->info();
     const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread, model.param.num_feature);
+    const size_t tree_block = this->TreeBlockSize(model, tree_begin, tree_end);
+    std::vector<FeatVec>& thread_temp = *thread_feats;
+    std::vector<bst_float>& thread_psum = ctx->thread_psum;
+    std::vector<bst_float>& thread_dense = ctx->thread_dense;
+    thread_psum.resize(nthread * row_block * num_group);
+    const int num_feature = model.param.num_feature;
+    // lane offsets of the dense kernel are 32 bit
+    const bool dense_kernel = use_dense_kernel && num_feature > 0 &&
+        num_feature < std::numeric_limits<int>::max() / kDenseLanes;
+    if (dense_kernel) {
+      thread_dense.resize(nthread * row_block * num_feature);
+    }
     std::vector<bst_float>& preds = *out_preds;
     CHECK_EQ(model.param.size_leaf_vector, 0)
         << "size_leaf_vector is enforced to 0 so far";
     CHECK_EQ(preds.size(), p_fmat->info().num_row * num_group);
+    CHECK_EQ(model.compiled_trees.Size(), model.trees.size());
+    const gbm::CompiledTrees& trees = model.compiled_trees;
     // start collecting the prediction
     dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
     iter->BeforeFirst();
     while (iter->Next()) {
       const RowBatch& batch = iter->Value();
-      // parallel over local batch
-      const int K = 8;
+      const bool dense = dense_kernel && IsDense(batch, num_feature);
+      // parallel over blocks of rows, each block goes through all the trees
+      // one tree block at a time so the tree block stays in cache.
       const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
-      const bst_omp_uint rest = nsize % K;
+      const bst_omp_uint nblock =
+          static_cast<bst_omp_uint>((nsize + row_block - 1) / row_block);
 #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nsize - rest; i += K) {
+      for (bst_omp_uint block_id = 0; block_id < nblock; ++block_id) {
         const int tid = omp_get_thread_num();
-        RegTree::FVec& feats = thread_temp[tid];
-        int64_t ridx[K];
-        RowBatch::Inst inst[K];
-        for (int k = 0; k < K; ++k) {
-          ridx[k] = static_cast<int64_t>(batch.base_rowid + i + k);
+        FeatVec* feats = &thread_temp[tid * row_block];
+        bst_float* psum = &thread_psum[tid * row_block * num_group];
+        const size_t begin = block_id * row_block;
+        const size_t end = std::min(begin + row_block, static_cast<size_t>(nsize));
+        std::fill(psum, psum + (end - begin) * num_group, 0.0f);
+        // groups of kDenseLanes dense rows go through the lane kernel,
+        // the remaining rows go through the feature vectors.
+        bst_float* rows = dense ? &thread_dense[tid * row_block * num_feature] : nullptr;
+        size_t dense_end = begin;
+        if (dense && FillDense(batch, begin, end, num_feature, rows)) {
+          dense_end = begin + (end - begin) / kDenseLanes * kDenseLanes;
         }
-        for (int k = 0; k < K; ++k) {
-          inst[k] = batch[i + k];
+        for (size_t i = dense_end; i < end; ++i) {
+          feats[i - begin].Fill(batch[i]);
         }
-        for (int k = 0; k < K; ++k) {
+        for (size_t tree_id = tree_begin; tree_id < tree_end; tree_id += tree_block) {
+          const size_t block_end = std::min(tree_id + tree_block, static_cast<size_t>(tree_end));
+          for (size_t i = begin; i < dense_end; i += kDenseLanes) {
+            unsigned root_index[kDenseLanes];
+            bst_float leaf[kDenseLanes];
+            for (int k = 0; k < kDenseLanes; ++k) {
+              root_index[k] = info.GetRoot(batch.base_rowid + i + k);
+            }
+            bst_float* lane_psum = psum + (i - begin) * num_group;
+            for (size_t j = tree_id; j < block_end; ++j) {
+              if (trees.compact) {
+                PredictDenseLanes<true>(trees, j, rows + (i - begin) * num_feature,
+                                        num_feature, root_index, leaf);
+              } else {
+                PredictDenseLanes<false>(trees, j, rows + (i - begin) * num_feature,
+                                         num_feature, root_index, leaf);
+              }
+              for (int k = 0; k < kDenseLanes; ++k) {
+                lane_psum[k * num_group + model.tree_info[j]] += leaf[k];
+              }
+            }
+          }
+          for (size_t i = dense_end; i < end; ++i) {
+            const unsigned root_index = info.GetRoot(batch.base_rowid + i);
+            bst_float* row_psum = psum + (i - begin) * num_group;
+            for (size_t j = tree_id; j < block_end; ++j) {
+              row_psum[model.tree_info[j]] += trees.Predict(j, feats[i - begin], root_index);
+            }
+          }
+        }
+        for (size_t i = begin; i < end; ++i) {
+          if (i >= dense_end) {
+            feats[i - begin].Drop(batch[i]);
+          }
+          const size_t offset = (batch.base_rowid + i) * num_group;
           for (int gid = 0; gid < num_group; ++gid) {
-            const size_t offset = ridx[k] * num_group + gid;
-            preds[offset] += this->PredValue(
-                inst[k], model.trees, model.tree_info, gid,
-                info.GetRoot(ridx[k]), &feats, tree_begin, tree_end);
+            preds[offset + gid] += psum[(i - begin) * num_group + gid];
           }
         }
       }
-      for (bst_omp_uint i = nsize - rest; i < nsize; ++i) {
-        RegTree::FVec& feats = thread_temp[0];
-        const int64_t ridx = static_cast<int64_t>(batch.base_rowid + i);
-        const RowBatch::Inst inst = batch[i];
-        for (int gid = 0; gid < num_group; ++gid) {
-          const size_t offset = ridx * num_group + gid;
-          preds[offset] +=
-              this->PredValue(inst, model.trees, model.tree_info, gid,
-                              info.GetRoot(ridx), &feats, tree_begin, tree_end);
+    }
+  }
+
+  // contributions of a small batch, parallel over trees: every thread
+  // accumulates its share of the trees into a private buffer and the
+  // buffers are reduced into contribs at the end
+  inline void ContributionOverTrees(const RowBatch& batch, const MetaInfo& info,
+                                    const gbm::GBTreeModel& model,
+                                    unsigned ntree_limit, bool approximate, int condition,
+                                    unsigned condition_feature, bst_float* contribs,
+                                    PredictionContext* ctx) const {
+    std::vector<RegTree::FVec>& thread_temp = ctx->thread_temp;
+    std::vector<std::vector<PathElement> >& thread_path = ctx->thread_path;
+    std::vector<bst_float>& thread_contribs = ctx->thread_contribs;
+    const int nthread = omp_get_max_threads();
+    const int ngroup = model.param.num_output_group;
+    const size_t ncolumns = model.param.num_feature + 1;
+    const size_t row_size = ngroup * ncolumns;
+    const size_t nsize = batch.size;
+    thread_contribs.resize(nthread * nsize * row_size);
+    std::fill(thread_contribs.begin(), thread_contribs.end(), 0.0f);
+#pragma omp parallel num_threads(nthread)
+    {
+      const int tid = omp_get_thread_num();
+      const int nthread_run = omp_get_num_threads();
+      const unsigned chunk = (ntree_limit + nthread_run - 1) / nthread_run;
+      const unsigned tree_begin = std::min(ntree_limit, chunk * tid);
+      const unsigned tree_end = std::min(ntree_limit, tree_begin + chunk);
+      RegTree::FVec& feats = thread_temp[tid];
+      bst_float* buffer = &thread_contribs[tid * nsize * row_size];
+      for (size_t i = 0; i < nsize && tree_begin < tree_end; ++i) {
+        const unsigned root_id = info.GetRoot(batch.base_rowid + i);
+        feats.Fill(batch[i]);
+        for (unsigned j = tree_begin; j < tree_end; ++j) {
+          bst_float* p_contribs = buffer + i * row_size + model.tree_info[j] * ncolumns;
+          if (!approximate) {
+            model.trees[j]->CalculateContributions(feats, root_id, p_contribs,
+                                                   condition, condition_feature,
+                                                   thread_path[tid].data());
+          } else {
+            model.trees[j]->CalculateContributionsApprox(feats, root_id, p_contribs);
+          }
         }
+        feats.Drop(batch[i]);
+      }
+    }
+    // reduce in thread order
+    const bst_omp_uint nelem = static_cast<bst_omp_uint>(nsize * row_size);
+    bst_float* out = contribs + batch.base_rowid * row_size;
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint k = 0; k < nelem; ++k) {
+      for (int tid = 0; tid < nthread; ++tid) {
+        out[k] += thread_contribs[tid * nelem + k];
       }
     }
   }
 
   void PredLoopInternal(DMatrix* dmat, std::vector<bst_float>* out_preds,
                         const gbm::GBTreeModel& model, int tree_begin,
-                        unsigned ntree_limit) {
+                        unsigned ntree_limit, PredictionContext* ctx) const {
     // TODO(Rory): Check if this specialisation actually improves performance
     PredLoopSpecalize(dmat, out_preds, model, model.param.num_output_group,
-                      tree_begin, ntree_limit);
+                      tree_begin, ntree_limit, ctx);
   }
 
   bool PredictFromCache(DMatrix* dmat,
@@ -113,9 +448,9 @@ class CPUPredictor : public Predictor {
       auto it = cache_.find(dmat);
       if (it != cache_.end()) {
         HostDeviceVector<bst_float>& y = it->second.predictions;
-        if (y.size() != 0) {
+        if (CacheCoversRows(dmat, it->second, model.param.num_output_group)) {
           out_preds->resize(y.size());
-          std::copy(y.data_h().begin(), y.data_h().end(),
+          std::copy(y.const_data_h().begin(), y.const_data_h().end(),
                     out_preds->data_h().begin());
           return true;
         }
@@ -147,6 +482,12 @@ class CPUPredictor : public Predictor {
       return;
     }
 
+    this->PredictBatch(dmat, out_preds, model, tree_begin, ntree_limit, &default_context);
+  }
+
+  void PredictBatch(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
+                    const gbm::GBTreeModel& model, int tree_begin,
+                    unsigned ntree_limit, PredictionContext* ctx) const override {
     this->InitOutPredictions(dmat->info(), out_preds, model);
 
     ntree_limit *= model.param.num_output_group;
@@ -155,7 +496,7 @@ class CPUPredictor : public Predictor {
     }
 
     this->PredLoopInternal(dmat, &out_preds->data_h(), model,
-                           tree_begin, ntree_limit);
+                           tree_begin, ntree_limit, ctx);
   }
 
   void UpdatePredictionCache(
@@ -167,27 +508,48 @@ class CPUPredictor : public Predictor {
     for (auto& kv : cache_) {
       PredictionCacheEntry& e = kv.second;
 
-      if (e.predictions.size() == 0) {
+      if (e.predictions.size() !=
+          model.param.num_output_group * e.data->info().num_row) {
         InitOutPredictions(e.data->info(), &(e.predictions), model);
         PredLoopInternal(e.data.get(), &(e.predictions.data_h()), model, 0,
-                         model.trees.size());
-      } else if (model.param.num_output_group == 1 && updaters->size() > 0 &&
-                 num_new_trees == 1 &&
-                 updaters->back()->UpdatePredictionCache(e.data.get(),
-                                                         &(e.predictions))) {
+                         model.trees.size(), &default_context);
+      } else if (model.param.num_output_group == 1 && num_new_trees == 1 &&
+                 UpdateCacheByUpdaters(updaters, e.data.get(), &(e.predictions))) {
         {}  // do nothing
       } else {
         PredLoopInternal(e.data.get(), &(e.predictions.data_h()), model, old_ntree,
-                         model.trees.size());
+                         model.trees.size(), &default_context);
       }
     }
+    this->UpdateCacheMemory();
+  }
+
+  // record the bytes of the cached predictions
+  void UpdateCacheMemory() {
+    size_t nbytes = 0;
+    for (const auto& kv : cache_) nbytes += kv.second.predictions.size() * sizeof(bst_float);
+    cache_memory_.Set(nbytes);
   }
 
   void PredictInstance(const SparseBatch::Inst& inst,
                        std::vector<bst_float>* out_preds,
                        const gbm::GBTreeModel& model, unsigned ntree_limit,
                        unsigned root_index) override {
-    if (thread_temp.size() == 0) {
+    this->PredictInstance(inst, out_preds, model, ntree_limit, root_index, &default_context);
+  }
+  void PredictInstance(const SparseBatch::Inst& inst,
+                       std::vector<bst_float>* out_preds,
+                       const gbm::GBTreeModel& model, unsigned ntree_limit,
+                       unsigned root_index, PredictionContext* ctx) const override {
+    // a sparse row of a very wide model is looked up in a sparse feature vector
+    const size_t kMinFeature = 1 << 16;
+    const size_t kMinSparsity = 64;
+    const bool sparse = model.param.num_feature >= kMinFeature &&
+        inst.length * kMinSparsity < static_cast<size_t>(model.param.num_feature);
+    std::vector<RegTree::FVec>& thread_temp = ctx->thread_temp;
+    if (sparse) {
+      if (ctx->thread_sparse.size() == 0) ctx->thread_sparse.resize(1);
+    } else if (thread_temp.size() == 0) {
       thread_temp.resize(1, RegTree::FVec());
       thread_temp[0].Init(model.param.num_feature);
     }
@@ -197,46 +559,32 @@ class CPUPredictor : public Predictor {
     }
     out_preds->resize(model.param.num_output_group *
                       (model.param.size_leaf_vector + 1));
+    CHECK_EQ(model.compiled_trees.Size(), model.trees.size());
     // loop over output groups
     for (int gid = 0; gid < model.param.num_output_group; ++gid) {
-      (*out_preds)[gid] =
-          PredValue(inst, model.trees, model.tree_info, gid, root_index,
-                    &thread_temp[0], 0, ntree_limit) +
+      (*out_preds)[gid] = (sparse ?
+          PredValue(inst, model.compiled_trees, model.tree_info, gid, root_index,
+                    &ctx->thread_sparse[0], 0, ntree_limit) :
+          PredValue(inst, model.compiled_trees, model.tree_info, gid, root_index,
+                    &thread_temp[0], 0, ntree_limit)) +
           model.base_margin;
     }
   }
   void PredictLeaf(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
                    const gbm::GBTreeModel& model, unsigned ntree_limit) override {
-    const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread, model.param.num_feature);
-    const MetaInfo& info = p_fmat->info();
-    // number of valid trees
-    ntree_limit *= model.param.num_output_group;
-    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
-      ntree_limit = static_cast<unsigned>(model.trees.size());
-    }
     std::vector<bst_float>& preds = *out_preds;
-    preds.resize(info.num_row * ntree_limit);
-    // start collecting the prediction
-    dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
-    iter->BeforeFirst();
-    while (iter->Next()) {
-      const RowBatch& batch = iter->Value();
-      // parallel over local batch
-      const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
-#pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nsize; ++i) {
-        const int tid = omp_get_thread_num();
-        size_t ridx = static_cast<size_t>(batch.base_rowid + i);
-        RegTree::FVec& feats = thread_temp[tid];
-        feats.Fill(batch[i]);
-        for (unsigned j = 0; j < ntree_limit; ++j) {
-          int tid = model.trees[j]->GetLeafIndex(feats, info.GetRoot(ridx));
-          preds[ridx * ntree_limit + j] = static_cast<bst_float>(tid);
-        }
-        feats.Drop(batch[i]);
+    preds.clear();
+    // the compact indices widened block by block
+    this->PredictLeafIndex(p_fmat, model, ntree_limit, [&](const LeafIndexBlock& block) {
+      const size_t nindex = block.nrow * block.ntree;
+      preds.resize(p_fmat->info().num_row * block.ntree);
+      bst_float* out = dmlc::BeginPtr(preds) + block.base_rowid * block.ntree;
+      if (block.index_size == sizeof(uint16_t)) {
+        std::copy_n(static_cast<const uint16_t*>(block.data), nindex, out);
+      } else {
+        std::copy_n(static_cast<const uint32_t*>(block.data), nindex, out);
       }
-    }
+    });
   }
 
   void PredictContribution(DMatrix* p_fmat, std::vector<bst_float>* out_contribs,
@@ -245,7 +593,9 @@ class CPUPredictor : public Predictor {
                            int condition,
                            unsigned condition_feature) override {
     const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread,  model.param.num_feature);
+    InitThreadTemp(nthread, model.param.num_feature, &default_context);
+    std::vector<RegTree::FVec>& thread_temp = default_context.thread_temp;
+    std::vector<std::vector<PathElement> >& thread_path = default_context.thread_path;
     const MetaInfo& info = p_fmat->info();
     // number of valid trees
     ntree_limit *= model.param.num_output_group;
@@ -260,10 +610,21 @@ class CPUPredictor : public Predictor {
     // make sure contributions is zeroed, we could be reusing a previously
     // allocated one
     std::fill(contribs.begin(), contribs.end(), 0);
-    // initialize tree node mean values
+    // initialize tree node mean values and the depth bounding the path buffers
+    std::vector<int> max_depth(ntree_limit);
     #pragma omp parallel for schedule(static)
     for (bst_omp_uint i = 0; i < ntree_limit; ++i) {
       model.trees[i]->FillNodeMeanValues();
+      max_depth[i] = model.trees[i]->MaxDepth();
+    }
+    // per thread unique path buffer, reused across rows and trees
+    size_t path_size = 0;
+    for (int depth : max_depth) {
+      path_size = std::max(path_size, RegTree::UniquePathSize(depth));
+    }
+    thread_path.resize(nthread);
+    for (auto& path : thread_path) {
+      path.resize(std::max(path.size(), path_size));
     }
     // start collecting the contributions
     dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
@@ -271,32 +632,52 @@ class CPUPredictor : public Predictor {
     iter->BeforeFirst();
     while (iter->Next()) {
       const RowBatch& batch = iter->Value();
-      // parallel over local batch
       const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+      // small batches leave most threads idle when parallel over rows,
+      // as long as the per thread buffers stay small go over trees instead
+      const size_t buffer_size = static_cast<size_t>(nthread) * nsize * ngroup * ncolumns;
+      const bool over_trees = param.contrib_parallel == kContribParallelTrees ||
+          (param.contrib_parallel == kContribParallelAuto && nthread > 1 &&
+           nsize < static_cast<bst_omp_uint>(nthread) * 4 && ntree_limit > nsize &&
+           buffer_size <= (1 << 24));
+      if (over_trees) {
+        this->ContributionOverTrees(batch, info, model, ntree_limit, approximate, condition,
+                                    condition_feature, contribs.data(), &default_context);
+      } else {
+        // parallel over local batch
 #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nsize; ++i) {
-        size_t row_idx = static_cast<size_t>(batch.base_rowid + i);
-        unsigned root_id = info.GetRoot(row_idx);
-        RegTree::FVec& feats = thread_temp[omp_get_thread_num()];
-        // loop over all classes
-        for (int gid = 0; gid < ngroup; ++gid) {
-          bst_float* p_contribs =
-              &contribs[(row_idx * ngroup + gid) * ncolumns];
+        for (bst_omp_uint i = 0; i < nsize; ++i) {
+          size_t row_idx = static_cast<size_t>(batch.base_rowid + i);
+          unsigned root_id = info.GetRoot(row_idx);
+          const int tid = omp_get_thread_num();
+          RegTree::FVec& feats = thread_temp[tid];
           feats.Fill(batch[i]);
-          // calculate contributions
-          for (unsigned j = 0; j < ntree_limit; ++j) {
-            if (model.tree_info[j] != gid) {
-              continue;
-            }
-            if (!approximate) {
-              model.trees[j]->CalculateContributions(feats, root_id, p_contribs,
-                                                     condition, condition_feature);
-            } else {
-              model.trees[j]->CalculateContributionsApprox(feats, root_id, p_contribs);
+          // loop over all classes
+          for (int gid = 0; gid < ngroup; ++gid) {
+            bst_float* p_contribs =
+                &contribs[(row_idx * ngroup + gid) * ncolumns];
+            // calculate contributions
+            for (unsigned j = 0; j < ntree_limit; ++j) {
+              if (model.tree_info[j] != gid) {
+                continue;
+              }
+              if (!approximate) {
+                model.trees[j]->CalculateContributions(feats, root_id, p_contribs,
+                                                       condition, condition_feature,
+                                                       thread_path[tid].data());
+              } else {
+                model.trees[j]->CalculateContributionsApprox(feats, root_id, p_contribs);
+              }
             }
           }
           feats.Drop(batch[i]);
-          // add base margin to BIAS
+        }
+      }
+      // add base margin to BIAS
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        size_t row_idx = static_cast<size_t>(batch.base_rowid + i);
+        for (int gid = 0; gid < ngroup; ++gid) {
+          bst_float* p_contribs = &contribs[(row_idx * ngroup + gid) * ncolumns];
           if (base_margin.size() != 0) {
             p_contribs[ncolumns - 1] += base_margin[row_idx * ngroup + gid];
           } else {
@@ -350,7 +731,16 @@ class CPUPredictor : public Predictor {
       }
     }
   }
-  std::vector<RegTree::FVec> thread_temp;
+  void Init(const std::vector<std::pair<std::string, std::string>>& cfg,
+            const std::vector<std::shared_ptr<DMatrix>>& cache) override {
+    Predictor::Init(cfg, cache);
+    param.InitAllowUnknown(cfg);
+  }
+
+  CPUPredictionParam param;
+  // scratch space of the calls that do not take a context
+  PredictionContext default_context;
+  common::TrackedBytes cache_memory_{"PredictionCache"};
 };
 
 XGBOOST_REGISTER_PREDICTOR(CPUPredictor, "cpu_predictor")
@@ -1,6 +1,7 @@
 /*!
  * Copyright by Contributors 2017
  */
+#include <dmlc/omp.h>
 #include <dmlc/parameter.h>
 #include <thrust/copy.h>
 #include <thrust/device_ptr.h>
@@ -10,28 +11,57 @@
 #include <xgboost/predictor.h>
 #include <xgboost/tree_model.h>
 #include <xgboost/tree_updater.h>
+#include <algorithm>
 #include <memory>
+#include <vector>
 #include "../common/device_helpers.cuh"
 #include "../common/host_device_vector.h"
+#include "../common/memory_tracker.h"
 
 namespace xgboost {
 namespace predictor {
 
 DMLC_REGISTRY_FILE_TAG(gpu_predictor);
 
+/*! \brief what PredictKernel keeps in shared memory */
+enum PredictTiling {
+  kTilingAuto = 0,
+  kTilingRows = 1,
+  kTilingTrees = 2
+};
+
 /*! \brief prediction parameters */
 struct GPUPredictionParam : public dmlc::Parameter<GPUPredictionParam> {
   int gpu_id;
   int n_gpus;
   bool silent;
+  int n_streams;
+  int stream_rows;
+  /*! \brief tiling of the prediction kernel, one of PredictTiling */
+  int tiling;
+  /*! \brief keep the cached matrices in managed memory */
+  bool gpu_managed_memory;
   // declare parameters
   DMLC_DECLARE_PARAMETER(GPUPredictionParam) {
     DMLC_DECLARE_FIELD(gpu_id).set_default(0).describe(
         "Device ordinal for GPU prediction.");
     DMLC_DECLARE_FIELD(n_gpus).set_default(1).describe(
-        "Number of devices to use for prediction (NOT IMPLEMENTED).");
+        "Number of devices to use for prediction, -1 means all visible devices.");
     DMLC_DECLARE_FIELD(silent).set_default(false).describe(
         "Do not print information during trainig.");
+    DMLC_DECLARE_FIELD(n_streams).set_default(2).set_lower_bound(1).describe(
+        "Number of CUDA streams used to overlap input copies with prediction.");
+    DMLC_DECLARE_FIELD(stream_rows).set_default(1 << 16).set_lower_bound(1).describe(
+        "Number of rows copied to the device at a time when streaming input.");
+    DMLC_DECLARE_FIELD(tiling).set_default(kTilingAuto)
+        .add_enum("auto", kTilingAuto)
+        .add_enum("rows", kTilingRows)
+        .add_enum("trees", kTilingTrees)
+        .describe("Keep the features of a block of rows or a tile of trees in "
+                  "shared memory, auto picks trees for large models with short rows.");
+    DMLC_DECLARE_FIELD(gpu_managed_memory).set_default(false).describe(
+        "Keep the matrices predicted every iteration in CUDA managed memory, "
+        "so they may exceed the memory of a device paging it on demand.");
   }
 };
 DMLC_REGISTER_PARAMETER(GPUPredictionParam);
@@ -53,11 +83,14 @@ struct DeviceMatrix {
   dh::bulk_allocator<dh::memory_type::DEVICE> ba;
   dh::dvec<size_t> row_ptr;
   dh::dvec<SparseBatch::Entry> data;
-  thrust::device_vector<float> predictions;
 
-  DeviceMatrix(DMatrix* dmat, int device_idx, bool silent) : p_mat(dmat) {
+  DeviceMatrix(DMatrix* dmat, int device_idx, bool silent, bool managed)
+      : p_mat(dmat) {
     dh::safe_cuda(cudaSetDevice(device_idx));
     auto info = dmat->info();
+    if (managed) {
+      ba.set_memory_type(dh::memory_type::DEVICE_MANAGED);
+    }
     ba.allocate(device_idx, silent, &row_ptr, info.num_row + 1, &data,
                 info.num_nonzero);
     auto iter = dmat->RowIterator();
@@ -78,6 +111,10 @@ struct DeviceMatrix {
                    data.tbegin() + data_offset);
       data_offset += batch.ind_ptr[batch.size];
     }
+    if (managed) {
+      row_ptr.advise_managed(true);
+      data.advise_managed(true);
+    }
   }
 };
 
@@ -138,13 +175,13 @@ struct DevicePredictionNode {
 
 struct ElementLoader {
   bool use_shared;
-  size_t* d_row_ptr;
-  SparseBatch::Entry* d_data;
+  const size_t* d_row_ptr;
+  const SparseBatch::Entry* d_data;
   int num_features;
   float* smem;
 
-  __device__ ElementLoader(bool use_shared, size_t* row_ptr,
-                           SparseBatch::Entry* entry, int num_features,
+  __device__ ElementLoader(bool use_shared, const size_t* row_ptr,
+                           const SparseBatch::Entry* entry, int num_features,
                            float* smem, int num_rows)
       : use_shared(use_shared),
         d_row_ptr(row_ptr),
@@ -175,7 +212,7 @@ struct ElementLoader {
       // Binary search
       auto begin_ptr = d_data + d_row_ptr[ridx];
       auto end_ptr = d_data + d_row_ptr[ridx + 1];
-      SparseBatch::Entry* previous_middle = nullptr;
+      const SparseBatch::Entry* previous_middle = nullptr;
       while (end_ptr != begin_ptr) {
         auto middle = begin_ptr + (end_ptr - begin_ptr) / 2;
         if (middle == previous_middle) {
@@ -219,9 +256,10 @@ __device__ float GetLeafWeight(bst_uint ridx, const DevicePredictionNode* tree,
 
 template <int BLOCK_THREADS>
 __global__ void PredictKernel(const DevicePredictionNode* d_nodes,
-                              float* d_out_predictions, size_t* d_tree_segments,
-                              int* d_tree_group, size_t* d_row_ptr,
-                              SparseBatch::Entry* d_data, size_t tree_begin,
+                              float* d_out_predictions,
+                              const size_t* d_tree_segments,
+                              const int* d_tree_group, const size_t* d_row_ptr,
+                              const SparseBatch::Entry* d_data, size_t tree_begin,
                               size_t tree_end, size_t num_features,
                               size_t num_rows, bool use_shared, int num_group) {
   extern __shared__ float smem[];
@@ -233,7 +271,7 @@ __global__ void PredictKernel(const DevicePredictionNode* d_nodes,
     float sum = 0;
     for (int tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
       const DevicePredictionNode* d_tree =
-          d_nodes + d_tree_segments[tree_idx - tree_begin];
+          d_nodes + d_tree_segments[tree_idx];
       sum += GetLeafWeight(global_idx, d_tree, &loader);
     }
     d_out_predictions[global_idx] += sum;
@@ -241,7 +279,7 @@ __global__ void PredictKernel(const DevicePredictionNode* d_nodes,
     for (int tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
       int tree_group = d_tree_group[tree_idx];
       const DevicePredictionNode* d_tree =
-          d_nodes + d_tree_segments[tree_idx - tree_begin];
+          d_nodes + d_tree_segments[tree_idx];
       bst_uint out_prediction_idx = global_idx * num_group + tree_group;
       d_out_predictions[out_prediction_idx] +=
           GetLeafWeight(global_idx, d_tree, &loader);
@@ -249,95 +287,609 @@ __global__ void PredictKernel(const DevicePredictionNode* d_nodes,
   }
 }
 
-class GPUPredictor : public xgboost::Predictor {
- protected:
-  struct DevicePredictionCacheEntry {
-    std::shared_ptr<DMatrix> data;
-    HostDeviceVector<bst_float> predictions;
-  };
+/*! \brief rows scored by each thread of PredictKernelTreeTiled */
+const int kTreeTileRowsPerThread = 8;
+/*! \brief longest average row for which auto tiling goes over trees */
+const size_t kTreeTileMaxRowLength = 32;
 
- private:
-  void DevicePredictInternal(DMatrix* dmat,
-                             HostDeviceVector<bst_float>* out_preds,
-                             const gbm::GBTreeModel& model, size_t tree_begin,
-                             size_t tree_end) {
-    if (tree_end - tree_begin == 0) {
-      return;
+// Trees are loaded into shared memory a tile at a time and every block scores
+// its rows against the resident tile, features are searched in global memory.
+// Each tree must fit in tile_nodes nodes.
+template <int BLOCK_THREADS>
+__global__ void PredictKernelTreeTiled(const DevicePredictionNode* d_nodes,
+                                       float* d_out_predictions,
+                                       const size_t* d_tree_segments,
+                                       const int* d_tree_group,
+                                       const size_t* d_row_ptr,
+                                       const SparseBatch::Entry* d_data,
+                                       size_t tree_begin, size_t tree_end,
+                                       size_t num_rows, int num_group,
+                                       size_t tile_nodes) {
+  extern __shared__ float smem[];
+  DevicePredictionNode* s_nodes = reinterpret_cast<DevicePredictionNode*>(smem);
+  ElementLoader loader(false, d_row_ptr, d_data, 0, nullptr, num_rows);
+  const size_t row_begin =
+      static_cast<size_t>(blockIdx.x) * BLOCK_THREADS * kTreeTileRowsPerThread;
+  for (size_t tile_begin = tree_begin; tile_begin < tree_end;) {
+    // the longest run of trees fitting in shared memory
+    const size_t node_begin = d_tree_segments[tile_begin];
+    size_t tile_end = tile_begin + 1;
+    while (tile_end < tree_end &&
+           d_tree_segments[tile_end + 1] - node_begin <= tile_nodes) {
+      ++tile_end;
+    }
+    const size_t num_nodes = d_tree_segments[tile_end] - node_begin;
+    // the previous tile is released by every thread before it is replaced
+    __syncthreads();
+    for (size_t i = threadIdx.x; i < num_nodes; i += BLOCK_THREADS) {
+      s_nodes[i] = d_nodes[node_begin + i];
     }
+    __syncthreads();
+    for (int r = 0; r < kTreeTileRowsPerThread; ++r) {
+      const size_t ridx = row_begin + r * BLOCK_THREADS + threadIdx.x;
+      if (ridx >= num_rows) break;
+      if (num_group == 1) {
+        float sum = 0;
+        for (size_t tree_idx = tile_begin; tree_idx < tile_end; tree_idx++) {
+          sum += GetLeafWeight(ridx, s_nodes + d_tree_segments[tree_idx] - node_begin,
+                               &loader);
+        }
+        d_out_predictions[ridx] += sum;
+      } else {
+        for (size_t tree_idx = tile_begin; tree_idx < tile_end; tree_idx++) {
+          d_out_predictions[ridx * num_group + d_tree_group[tree_idx]] +=
+              GetLeafWeight(ridx, s_nodes + d_tree_segments[tree_idx] - node_begin,
+                            &loader);
+        }
+      }
+    }
+    tile_begin = tile_end;
+  }
+}
+
+/*! \brief deepest tree handled by the device TreeSHAP, bounds its node stack */
+const int kShapMaxDepth = 32;
+/*! \brief bytes of unique path buffers of one TreeSHAP launch */
+const size_t kShapPathBytes = static_cast<size_t>(1) << 28;
+
+/*! \brief a node waiting to be visited by TreeShapDevice */
+struct ShapFrame {
+  int node_idx;
+  unsigned unique_depth;
+  /*! \brief offset of the unique path of the parent in the path buffer */
+  unsigned path_offset;
+  float zero_fraction;
+  float one_fraction;
+  int feature_index;
+  float condition_fraction;
+};
 
-    std::shared_ptr<DeviceMatrix> device_matrix;
-    // Matrix is not in host cache, create a temporary matrix
-    if (this->cache_.find(dmat) != this->cache_.end()) {
-      device_matrix = std::shared_ptr<DeviceMatrix>(
-          new DeviceMatrix(dmat, param.gpu_id, param.silent));
+// Iterative version of RegTree::TreeShap. The children are pushed cold first,
+// the hot subtree is done before the cold child copies the path of their
+// parent, so the path buffer is laid out exactly as in the recursion.
+__device__ void TreeShapDevice(const DevicePredictionNode* tree,
+                               const float* cover, ElementLoader* loader,
+                               bst_uint ridx, float* phi, PathElement* path,
+                               int condition, unsigned condition_feature) {
+  ShapFrame stack[kShapMaxDepth + 1];
+  int top = 0;
+  stack[top++] = ShapFrame{0, 0, 0, 1.0f, 1.0f, -1, 1.0f};
+  while (top > 0) {
+    const ShapFrame frame = stack[--top];
+    // stop if we have no weight coming down to us
+    if (frame.condition_fraction == 0) continue;
+    unsigned unique_depth = frame.unique_depth;
+    const unsigned path_offset = frame.path_offset + unique_depth + 1;
+    PathElement* parent_unique_path = path + frame.path_offset;
+    PathElement* unique_path = path + path_offset;
+    for (unsigned i = 0; i < unique_depth + 1; ++i) {
+      unique_path[i] = parent_unique_path[i];
+    }
+    if (condition == 0 ||
+        condition_feature != static_cast<unsigned>(frame.feature_index)) {
+      ExtendPath(unique_path, unique_depth, frame.zero_fraction,
+                 frame.one_fraction, frame.feature_index);
+    }
+    const DevicePredictionNode n = tree[frame.node_idx];
+    if (n.IsLeaf()) {
+      for (unsigned i = 1; i <= unique_depth; ++i) {
+        const float w = UnwoundPathSum(unique_path, unique_depth, i);
+        const PathElement& el = unique_path[i];
+        atomicAdd(phi + el.feature_index,
+                  w * (el.one_fraction - el.zero_fraction) * n.GetWeight() *
+                      frame.condition_fraction);
+      }
+      continue;
+    }
+    const unsigned split_index = n.GetFidx();
+    const float fvalue = loader->GetFvalue(ridx, split_index);
+    int hot_index = 0;
+    if (isnan(fvalue)) {
+      hot_index = n.MissingIdx();
+    } else if (fvalue < n.GetFvalue()) {
+      hot_index = n.left_child_idx;
     } else {
-      // Create this matrix on device if doesn't exist
-      if (this->device_matrix_cache_.find(dmat) ==
-          this->device_matrix_cache_.end()) {
-        this->device_matrix_cache_.emplace(
-            dmat, std::shared_ptr<DeviceMatrix>(
-                      new DeviceMatrix(dmat, param.gpu_id, param.silent)));
+      hot_index = n.right_child_idx;
+    }
+    const int cold_index = hot_index == n.left_child_idx ? n.right_child_idx
+                                                         : n.left_child_idx;
+    const float w = cover[frame.node_idx];
+    const float hot_zero_fraction = cover[hot_index] / w;
+    const float cold_zero_fraction = cover[cold_index] / w;
+    float incoming_zero_fraction = 1;
+    float incoming_one_fraction = 1;
+    // undo a previous split on the same feature so that it can be redone
+    unsigned path_index = 0;
+    for (; path_index <= unique_depth; ++path_index) {
+      if (static_cast<unsigned>(unique_path[path_index].feature_index) ==
+          split_index) {
+        break;
       }
-      device_matrix = device_matrix_cache_.find(dmat)->second;
     }
+    if (path_index != unique_depth + 1) {
+      incoming_zero_fraction = unique_path[path_index].zero_fraction;
+      incoming_one_fraction = unique_path[path_index].one_fraction;
+      UnwindPath(unique_path, unique_depth, path_index);
+      unique_depth -= 1;
+    }
+    float hot_condition_fraction = frame.condition_fraction;
+    float cold_condition_fraction = frame.condition_fraction;
+    if (condition > 0 && split_index == condition_feature) {
+      cold_condition_fraction = 0;
+      unique_depth -= 1;
+    } else if (condition < 0 && split_index == condition_feature) {
+      hot_condition_fraction *= hot_zero_fraction;
+      cold_condition_fraction *= cold_zero_fraction;
+      unique_depth -= 1;
+    }
+    stack[top++] = ShapFrame{cold_index, unique_depth + 1, path_offset,
+                             cold_zero_fraction * incoming_zero_fraction, 0,
+                             static_cast<int>(split_index),
+                             cold_condition_fraction};
+    stack[top++] = ShapFrame{hot_index, unique_depth + 1, path_offset,
+                             hot_zero_fraction * incoming_zero_fraction,
+                             incoming_one_fraction,
+                             static_cast<int>(split_index),
+                             hot_condition_fraction};
+  }
+}
+
+// One thread per (tree, row) pair, the threads of a warp walk the same tree.
+__global__ void TreeShapKernel(const DevicePredictionNode* d_nodes,
+                               const float* d_cover,
+                               const size_t* d_tree_segments,
+                               const int* d_tree_group,
+                               const float* d_tree_mean,
+                               const size_t* d_row_ptr,
+                               const SparseBatch::Entry* d_data,
+                               size_t num_rows, size_t num_trees,
+                               PathElement* d_path, size_t path_size,
+                               float* d_contribs, int num_group,
+                               size_t ncolumns, int condition,
+                               unsigned condition_feature) {
+  const size_t item_idx = static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x;
+  if (item_idx >= num_rows * num_trees) return;
+  const size_t tree_idx = item_idx / num_rows;
+  const bst_uint ridx = static_cast<bst_uint>(item_idx % num_rows);
+  ElementLoader loader(false, d_row_ptr, d_data, 0, nullptr, num_rows);
+  float* phi = d_contribs +
+      (static_cast<size_t>(ridx) * num_group + d_tree_group[tree_idx]) * ncolumns;
+  // the expected value of the tree goes to the bias
+  if (condition == 0) {
+    atomicAdd(phi + ncolumns - 1, d_tree_mean[tree_idx]);
+  }
+  const size_t segment = d_tree_segments[tree_idx];
+  TreeShapDevice(d_nodes + segment, d_cover + segment, &loader, ridx, phi,
+                 d_path + item_idx * path_size, condition, condition_feature);
+}
+
+/**
+ * \struct  DeviceModel
+ *
+ * \brief The flattened trees of a model resident on the device. It is kept
+ * across calls and only the trees appended since the last call are copied.
+ */
 
-    dh::safe_cuda(cudaSetDevice(param.gpu_id));
-    CHECK_EQ(model.param.size_leaf_vector, 0);
-    // Copy decision trees to device
+struct DeviceModel {
+  dh::device_vector<DevicePredictionNode> nodes;
+  /*! \brief sum of hessian of the nodes, used by TreeSHAP */
+  dh::device_vector<float> node_cover;
+  dh::device_vector<size_t> tree_segments;
+  dh::device_vector<int> tree_group;
+  /*! \brief host copy of tree_segments */
+  std::vector<size_t> host_tree_segments;
+  /*! \brief number of nodes of the largest tree */
+  size_t max_tree_nodes{0};
+  const gbm::GBTreeModel* model{nullptr};
+  uint64_t version{0};
+  size_t num_trees{0};
+
+  void Sync(const gbm::GBTreeModel& m, int device_idx) {
+    CHECK_EQ(m.param.size_leaf_vector, 0);
+    // every append bumps the version once, anything else invalidates
+    const bool appended = model == &m && m.trees.size() >= num_trees &&
+        m.compiled_trees.version - version == m.trees.size() - num_trees;
+    if (appended && m.trees.size() == num_trees) return;
+    size_t tree_begin = appended ? num_trees : 0;
+    dh::safe_cuda(cudaSetDevice(device_idx));
     thrust::host_vector<size_t> h_tree_segments;
-    h_tree_segments.reserve((tree_end - tree_begin) + 1);
-    size_t sum = 0;
+    h_tree_segments.reserve(m.trees.size() - tree_begin + 1);
+    size_t sum = tree_begin == 0 ? 0 : host_tree_segments[tree_begin];
+    if (tree_begin == 0) max_tree_nodes = 0;
     h_tree_segments.push_back(sum);
-    for (auto tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
-      sum += model.trees[tree_idx]->GetNodes().size();
+    for (auto tree_idx = tree_begin; tree_idx < m.trees.size(); tree_idx++) {
+      sum += m.trees[tree_idx]->GetNodes().size();
       h_tree_segments.push_back(sum);
+      max_tree_nodes = std::max(max_tree_nodes, m.trees[tree_idx]->GetNodes().size());
     }
+    const size_t node_begin = h_tree_segments.front();
+    thrust::host_vector<DevicePredictionNode> h_nodes(sum - node_begin);
+    thrust::host_vector<float> h_cover(sum - node_begin);
+    for (auto tree_idx = tree_begin; tree_idx < m.trees.size(); tree_idx++) {
+      auto& src_nodes = m.trees[tree_idx]->GetNodes();
+      const size_t offset = h_tree_segments[tree_idx - tree_begin] - node_begin;
+      std::copy(src_nodes.begin(), src_nodes.end(), h_nodes.begin() + offset);
+      for (size_t nid = 0; nid < src_nodes.size(); ++nid) {
+        h_cover[offset + nid] = m.trees[tree_idx]->stat(nid).sum_hess;
+      }
+    }
+    nodes.resize(sum);
+    thrust::copy(h_nodes.begin(), h_nodes.end(), nodes.begin() + node_begin);
+    node_cover.resize(sum);
+    thrust::copy(h_cover.begin(), h_cover.end(), node_cover.begin() + node_begin);
+    // the first segment offset of the new trees is the end of the old ones
+    tree_segments.resize(m.trees.size() + 1);
+    thrust::copy(h_tree_segments.begin(), h_tree_segments.end(),
+                 tree_segments.begin() + tree_begin);
+    host_tree_segments.resize(tree_begin);
+    host_tree_segments.insert(host_tree_segments.end(), h_tree_segments.begin(),
+                              h_tree_segments.end());
+    tree_group.resize(m.tree_info.size());
+    thrust::copy(m.tree_info.begin() + tree_begin, m.tree_info.end(),
+                 tree_group.begin() + tree_begin);
+    model = &m;
+    version = m.compiled_trees.version;
+    num_trees = m.trees.size();
+  }
+};
+
+/**
+ * \struct  StreamSlot
+ *
+ * \brief A CUDA stream with its pinned host staging buffers and device
+ * buffers. A chunk of rows is copied and scored on one slot while the host
+ * fills the next slot.
+ */
 
-    thrust::host_vector<DevicePredictionNode> h_nodes(h_tree_segments.back());
-    for (auto tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
-      auto& src_nodes = model.trees[tree_idx]->GetNodes();
-      std::copy(src_nodes.begin(), src_nodes.end(),
-                h_nodes.begin() + h_tree_segments[tree_idx - tree_begin]);
+struct StreamSlot {
+  int device_idx;
+  cudaStream_t stream;
+  size_t row_capacity{0};
+  size_t data_capacity{0};
+  size_t* h_row_ptr{nullptr};
+  size_t* d_row_ptr{nullptr};
+  SparseBatch::Entry* h_data{nullptr};
+  SparseBatch::Entry* d_data{nullptr};
+
+  explicit StreamSlot(int device_idx) : device_idx(device_idx) {
+    dh::safe_cuda(cudaSetDevice(device_idx));
+    dh::safe_cuda(cudaStreamCreate(&stream));
+  }
+  StreamSlot(const StreamSlot&) = delete;
+  void operator=(const StreamSlot&) = delete;
+  ~StreamSlot() {
+    dh::safe_cuda(cudaSetDevice(device_idx));
+    this->FreeRows();
+    this->FreeData();
+    dh::safe_cuda(cudaStreamDestroy(stream));
+  }
+  void FreeRows() {
+    if (h_row_ptr != nullptr) dh::safe_cuda(cudaFreeHost(h_row_ptr));
+    dh::GlobalMemoryPool().Free(d_row_ptr);
+    h_row_ptr = d_row_ptr = nullptr;
+  }
+  void FreeData() {
+    if (h_data != nullptr) dh::safe_cuda(cudaFreeHost(h_data));
+    dh::GlobalMemoryPool().Free(d_data);
+    h_data = d_data = nullptr;
+  }
+  // grow the buffers, the slot must be idle
+  void Reserve(size_t num_rows, size_t num_elements) {
+    dh::safe_cuda(cudaSetDevice(device_idx));
+    if (num_rows + 1 > row_capacity) {
+      this->FreeRows();
+      row_capacity = num_rows + 1;
+      dh::safe_cuda(cudaMallocHost(&h_row_ptr, row_capacity * sizeof(size_t)));
+      d_row_ptr = static_cast<size_t*>(dh::GlobalMemoryPool().Allocate(
+          device_idx, row_capacity * sizeof(size_t), stream));
     }
+    if (num_elements > data_capacity) {
+      this->FreeData();
+      data_capacity = num_elements;
+      dh::safe_cuda(cudaMallocHost(&h_data, data_capacity * sizeof(SparseBatch::Entry)));
+      d_data = static_cast<SparseBatch::Entry*>(dh::GlobalMemoryPool().Allocate(
+          device_idx, data_capacity * sizeof(SparseBatch::Entry), stream));
+    }
+  }
+  // queue the copy of rows [begin, end) of the batch to the device buffers,
+  // the slot must be idle
+  void Stage(const RowBatch& batch, size_t begin, size_t end) {
+    const size_t elem_begin = batch.ind_ptr[begin];
+    const size_t num_elements = batch.ind_ptr[end] - elem_begin;
+    this->Reserve(end - begin, num_elements);
+    for (size_t i = begin; i <= end; ++i) {
+      h_row_ptr[i - begin] = batch.ind_ptr[i] - elem_begin;
+    }
+    std::copy(batch.data_ptr + elem_begin,
+              batch.data_ptr + elem_begin + num_elements, h_data);
+    dh::safe_cuda(cudaMemcpyAsync(d_row_ptr, h_row_ptr,
+                                  (end - begin + 1) * sizeof(size_t),
+                                  cudaMemcpyHostToDevice, stream));
+    dh::safe_cuda(cudaMemcpyAsync(d_data, h_data,
+                                  num_elements * sizeof(SparseBatch::Entry),
+                                  cudaMemcpyHostToDevice, stream));
+  }
+};
 
-    nodes.resize(h_nodes.size());
-    thrust::copy(h_nodes.begin(), h_nodes.end(), nodes.begin());
-    tree_segments.resize(h_tree_segments.size());
-    thrust::copy(h_tree_segments.begin(), h_tree_segments.end(),
-                 tree_segments.begin());
-    tree_group.resize(model.tree_info.size());
-    thrust::copy(model.tree_info.begin(), model.tree_info.end(),
-                 tree_group.begin());
+/**
+ * \struct  DeviceShard
+ *
+ * \brief The state of prediction on one device: a replica of the model and
+ * the streams used to copy rows to the device.
+ */
 
-    device_matrix->predictions.resize(out_preds->size());
-    thrust::copy(out_preds->tbegin(param.gpu_id), out_preds->tend(param.gpu_id),
-                 device_matrix->predictions.begin());
+struct DeviceShard {
+  int device_idx;
+  size_t max_shared_memory_bytes;
+  /*! \brief tiling of the prediction kernel, one of PredictTiling */
+  int tiling;
+  DeviceModel model;
+  std::vector<std::unique_ptr<StreamSlot>> streams;
+  /*! \brief predictions of the rows of this shard when gathering on host */
+  dh::device_vector<float> predictions;
+  /*! \brief expected value of each tree, used by TreeSHAP */
+  dh::device_vector<float> tree_mean;
+  /*! \brief unique path buffers of TreeSHAP */
+  dh::device_vector<PathElement> shap_path;
 
+  DeviceShard(int device_idx, int n_streams, int tiling)
+      : device_idx(device_idx),
+        max_shared_memory_bytes(dh::max_shared_memory(device_idx)),
+        tiling(tiling) {
+    for (int i = 0; i < n_streams; ++i) {
+      streams.push_back(std::unique_ptr<StreamSlot>(new StreamSlot(device_idx)));
+    }
+  }
+
+  void LaunchPredictKernel(const size_t* d_row_ptr,
+                           const SparseBatch::Entry* d_data, float* d_out,
+                           size_t tree_begin, size_t tree_end,
+                           size_t num_features, size_t num_rows,
+                           size_t num_elements, int num_group,
+                           cudaStream_t stream) {
     const int BLOCK_THREADS = 128;
-    const int GRID_SIZE = static_cast<int>(
-        dh::div_round_up(device_matrix->row_ptr.size() - 1, BLOCK_THREADS));
+    const int GRID_SIZE =
+        static_cast<int>(dh::div_round_up(num_rows, BLOCK_THREADS));
+    if (GRID_SIZE == 0) {
+      return;
+    }
 
-    int shared_memory_bytes = static_cast<int>(
-        sizeof(float) * device_matrix->p_mat->info().num_col * BLOCK_THREADS);
+    int shared_memory_bytes =
+        static_cast<int>(sizeof(float) * num_features * BLOCK_THREADS);
     bool use_shared = true;
     if (shared_memory_bytes > max_shared_memory_bytes) {
       shared_memory_bytes = 0;
       use_shared = false;
     }
 
+    // Tiling trees needs every tree to fit in shared memory. It pays off when
+    // the features of a row block do not fit either, or when the model does
+    // not fit and the rows are short enough to be searched in global memory.
+    const size_t tile_nodes = max_shared_memory_bytes / sizeof(DevicePredictionNode);
+    const size_t model_nodes = model.host_tree_segments[tree_end] -
+        model.host_tree_segments[tree_begin];
+    bool tile_trees = tiling == kTilingTrees;
+    if (tiling == kTilingAuto) {
+      tile_trees = !use_shared || (model_nodes > tile_nodes &&
+                                   num_elements <= kTreeTileMaxRowLength * num_rows);
+    }
+    if (tile_trees && model.max_tree_nodes <= tile_nodes) {
+      const int TILED_GRID_SIZE = static_cast<int>(
+          dh::div_round_up(num_rows, BLOCK_THREADS * kTreeTileRowsPerThread));
+      const size_t tile_bytes =
+          std::min(tile_nodes, model_nodes) * sizeof(DevicePredictionNode);
+      PredictKernelTreeTiled<BLOCK_THREADS>
+          <<<TILED_GRID_SIZE, BLOCK_THREADS, tile_bytes, stream>>>(
+              dh::raw(model.nodes), d_out, dh::raw(model.tree_segments),
+              dh::raw(model.tree_group), d_row_ptr, d_data, tree_begin,
+              tree_end, num_rows, num_group, tile_nodes);
+      return;
+    }
+
     PredictKernel<BLOCK_THREADS>
-        <<<GRID_SIZE, BLOCK_THREADS, shared_memory_bytes>>>(
-            dh::raw(nodes), dh::raw(device_matrix->predictions),
-            dh::raw(tree_segments), dh::raw(tree_group),
-            device_matrix->row_ptr.data(), device_matrix->data.data(),
-            tree_begin, tree_end, device_matrix->p_mat->info().num_col,
-            device_matrix->p_mat->info().num_row, use_shared,
-            model.param.num_output_group);
+        <<<GRID_SIZE, BLOCK_THREADS, shared_memory_bytes, stream>>>(
+            dh::raw(model.nodes), d_out, dh::raw(model.tree_segments),
+            dh::raw(model.tree_group), d_row_ptr, d_data, tree_begin, tree_end,
+            num_features, num_rows, use_shared, num_group);
+  }
+
+  // Predict rows [row_begin, row_end) of the batch into d_out, which points
+  // at the output of row_begin. Chunks of rows are copied through pinned
+  // buffers, round robin over the streams so that the copy of a chunk
+  // overlaps with the kernel of the previous one.
+  void StreamRows(const RowBatch& batch, size_t row_begin, size_t row_end,
+                  float* d_out, size_t tree_begin, size_t tree_end,
+                  size_t num_features, int num_group, size_t stream_rows) {
+    dh::safe_cuda(cudaSetDevice(device_idx));
+    size_t chunk_idx = 0;
+    for (size_t begin = row_begin; begin < row_end; begin += stream_rows) {
+      const size_t end = std::min(begin + stream_rows, row_end);
+      StreamSlot& slot = *streams[chunk_idx++ % streams.size()];
+      // the buffers of the slot are reused once its previous chunk is done
+      dh::safe_cuda(cudaStreamSynchronize(slot.stream));
+      slot.Stage(batch, begin, end);
+      LaunchPredictKernel(slot.d_row_ptr, slot.d_data,
+                          d_out + (begin - row_begin) * num_group, tree_begin,
+                          tree_end, num_features, end - begin,
+                          batch.ind_ptr[end] - batch.ind_ptr[begin], num_group,
+                          slot.stream);
+    }
+    for (auto& slot : streams) {
+      dh::safe_cuda(cudaStreamSynchronize(slot->stream));
+    }
+  }
+
+  // Predict rows [row_begin, row_end) of the batch on host memory h_out,
+  // which points at the output of row_begin.
+  void PredictRowsToHost(const RowBatch& batch, size_t row_begin,
+                         size_t row_end, float* h_out, size_t tree_begin,
+                         size_t tree_end, size_t num_features, int num_group,
+                         size_t stream_rows) {
+    dh::safe_cuda(cudaSetDevice(device_idx));
+    const size_t n = (row_end - row_begin) * num_group;
+    predictions.resize(n);
+    thrust::copy(h_out, h_out + n, predictions.begin());
+    StreamRows(batch, row_begin, row_end, dh::raw(predictions), tree_begin,
+               tree_end, num_features, num_group, stream_rows);
+    thrust::copy(predictions.begin(), predictions.begin() + n, h_out);
+  }
+
+  // Contributions of the first num_trees trees for the rows of the batch into
+  // h_out, bias excluded. The rows are processed in chunks bounding the unique
+  // path buffers of the (tree, row) pairs.
+  void ContributionToHost(const RowBatch& batch, float* h_out,
+                          size_t num_trees, size_t path_size, int num_group,
+                          size_t ncolumns, int condition,
+                          unsigned condition_feature) {
+    dh::safe_cuda(cudaSetDevice(device_idx));
+    const size_t row_size = num_group * ncolumns;
+    const size_t chunk_rows = std::max(
+        kShapPathBytes / (sizeof(PathElement) * path_size * num_trees),
+        static_cast<size_t>(1));
+    StreamSlot& slot = *streams.front();
+    for (size_t begin = 0; begin < batch.size; begin += chunk_rows) {
+      const size_t end = std::min(begin + chunk_rows, batch.size);
+      const size_t num_items = (end - begin) * num_trees;
+      if (shap_path.size() < num_items * path_size) {
+        shap_path.resize(num_items * path_size);
+      }
+      predictions.resize((end - begin) * row_size);
+      slot.Stage(batch, begin, end);
+      dh::safe_cuda(cudaMemsetAsync(dh::raw(predictions), 0,
+                                    predictions.size() * sizeof(float),
+                                    slot.stream));
+      const int BLOCK_THREADS = 128;
+      const int GRID_SIZE =
+          static_cast<int>(dh::div_round_up(num_items, BLOCK_THREADS));
+      TreeShapKernel<<<GRID_SIZE, BLOCK_THREADS, 0, slot.stream>>>(
+          dh::raw(model.nodes), dh::raw(model.node_cover),
+          dh::raw(model.tree_segments), dh::raw(model.tree_group),
+          dh::raw(tree_mean), slot.d_row_ptr, slot.d_data, end - begin,
+          num_trees, dh::raw(shap_path), path_size, dh::raw(predictions),
+          num_group, ncolumns, condition, condition_feature);
+      dh::safe_cuda(cudaMemcpyAsync(h_out + begin * row_size,
+                                    dh::raw(predictions),
+                                    predictions.size() * sizeof(float),
+                                    cudaMemcpyDeviceToHost, slot.stream));
+      dh::safe_cuda(cudaStreamSynchronize(slot.stream));
+    }
+  }
+};
+
+class GPUPredictor : public xgboost::Predictor {
+ protected:
+  struct DevicePredictionCacheEntry {
+    std::shared_ptr<DMatrix> data;
+    HostDeviceVector<bst_float> predictions;
+  };
+
+ private:
+  // Rows of each page are split evenly over the shards, every shard holds a
+  // replica of the model and the outputs are gathered on host.
+  void MultiDevicePredictInternal(DMatrix* dmat,
+                                  HostDeviceVector<bst_float>* out_preds,
+                                  const gbm::GBTreeModel& model,
+                                  size_t tree_begin, size_t tree_end) {
+    const int n_shards = static_cast<int>(shards.size());
+    const int num_group = model.param.num_output_group;
+    const size_t num_features = dmat->info().num_col;
+    std::vector<bst_float>& h_out = out_preds->data_h();
+#pragma omp parallel for schedule(static, 1) num_threads(n_shards)
+    for (int shard = 0; shard < n_shards; ++shard) {
+      shards[shard]->model.Sync(model, shards[shard]->device_idx);
+    }
+    auto iter = dmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const RowBatch& batch = iter->Value();
+      const size_t shard_size = dh::div_round_up(batch.size, n_shards);
+#pragma omp parallel for schedule(static, 1) num_threads(n_shards)
+      for (int shard = 0; shard < n_shards; ++shard) {
+        const size_t row_begin = std::min(shard * shard_size, batch.size);
+        const size_t row_end = std::min(row_begin + shard_size, batch.size);
+        if (row_begin == row_end) continue;
+        shards[shard]->PredictRowsToHost(
+            batch, row_begin, row_end,
+            dmlc::BeginPtr(h_out) + (batch.base_rowid + row_begin) * num_group,
+            tree_begin, tree_end, num_features, num_group, param.stream_rows);
+      }
+    }
+  }
 
+  void DevicePredictInternal(DMatrix* dmat,
+                             HostDeviceVector<bst_float>* out_preds,
+                             const gbm::GBTreeModel& model, size_t tree_begin,
+                             size_t tree_end) {
+    if (tree_end - tree_begin == 0) {
+      return;
+    }
+    if (shards.size() > 1) {
+      MultiDevicePredictInternal(dmat, out_preds, model, tree_begin, tree_end);
+      return;
+    }
+
+    DeviceShard& shard = *shards.front();
+    dh::safe_cuda(cudaSetDevice(shard.device_idx));
+    shard.model.Sync(model, shard.device_idx);
+    const int num_group = model.param.num_output_group;
+    float* d_out = out_preds->ptr_d(param.gpu_id);
+
+    if (this->cache_.find(dmat) == this->cache_.end()) {
+      // The matrix is not owned by the cache, stream it through the device.
+      auto iter = dmat->RowIterator();
+      iter->BeforeFirst();
+      while (iter->Next()) {
+        const RowBatch& batch = iter->Value();
+        shard.StreamRows(batch, 0, batch.size,
+                         d_out + batch.base_rowid * num_group, tree_begin,
+                         tree_end, dmat->info().num_col, num_group,
+                         param.stream_rows);
+      }
+      return;
+    }
+    // Matrices in the cache are predicted every iteration, keep them on the
+    // device for as long as the cache holds them.
+    if (this->device_matrix_cache_.find(dmat) ==
+        this->device_matrix_cache_.end()) {
+      this->device_matrix_cache_.emplace(
+          dmat, std::shared_ptr<DeviceMatrix>(
+                    new DeviceMatrix(dmat, shard.device_idx, param.silent,
+                                     param.gpu_managed_memory)));
+    }
+    std::shared_ptr<DeviceMatrix> device_matrix =
+        device_matrix_cache_.find(dmat)->second;
+    if (param.gpu_managed_memory) {
+      // the training step in between may have evicted the matrix
+      device_matrix->row_ptr.prefetch_managed();
+      device_matrix->data.prefetch_managed();
+    }
+    shard.LaunchPredictKernel(device_matrix->row_ptr.data(),
+                              device_matrix->data.data(), d_out, tree_begin,
+                              tree_end, device_matrix->p_mat->info().num_col,
+                              device_matrix->p_mat->info().num_row,
+                              device_matrix->p_mat->info().num_nonzero,
+                              num_group, nullptr);
     dh::safe_cuda(cudaDeviceSynchronize());
-    thrust::copy(device_matrix->predictions.begin(),
-                 device_matrix->predictions.end(),
-                 out_preds->tbegin(param.gpu_id));
   }
 
  public:
@@ -384,11 +936,11 @@ class GPUPredictor : public xgboost::Predictor {
       auto it = cache_.find(dmat);
       if (it != cache_.end()) {
         HostDeviceVector<bst_float>& y = it->second.predictions;
-        if (y.size() != 0) {
+        if (CacheCoversRows(dmat, it->second, model.param.num_output_group)) {
           dh::safe_cuda(cudaSetDevice(param.gpu_id));
           out_preds->resize(y.size(), 0.0f, param.gpu_id);
           dh::safe_cuda(cudaMemcpy(
-              out_preds->ptr_d(param.gpu_id), y.ptr_d(param.gpu_id),
+              out_preds->ptr_d(param.gpu_id), y.const_ptr_d(param.gpu_id),
               out_preds->size() * sizeof(bst_float), cudaMemcpyDefault));
           return true;
         }
@@ -409,21 +961,23 @@ class GPUPredictor : public xgboost::Predictor {
       DMatrix* dmat = kv.first;
       HostDeviceVector<bst_float>& predictions = e.predictions;
 
-      if (predictions.size() == 0) {
+      if (predictions.size() !=
+          model.param.num_output_group * dmat->info().num_row) {
         // ensure that the device in predictions is correct
         predictions.resize(0, 0.0f, param.gpu_id);
         cpu_predictor->PredictBatch(dmat, &predictions, model, 0,
                                     static_cast<bst_uint>(model.trees.size()));
-      } else if (model.param.num_output_group == 1 && updaters->size() > 0 &&
-                 num_new_trees == 1 &&
-                 updaters->back()->UpdatePredictionCache(e.data.get(),
-                                                         &predictions)) {
+      } else if (model.param.num_output_group == 1 && num_new_trees == 1 &&
+                 UpdateCacheByUpdaters(updaters, e.data.get(), &predictions)) {
         // do nothing
       } else {
         DevicePredictInternal(dmat, &predictions, model, old_ntree,
                               model.trees.size());
       }
     }
+    size_t nbytes = 0;
+    for (const auto& kv : cache_) nbytes += kv.second.predictions.size() * sizeof(bst_float);
+    cache_memory_.Set(nbytes);
   }
 
   void PredictInstance(const SparseBatch::Inst& inst,
@@ -443,18 +997,110 @@ class GPUPredictor : public xgboost::Predictor {
                            const gbm::GBTreeModel& model, unsigned ntree_limit,
                            bool approximate, int condition,
                            unsigned condition_feature) override {
-    cpu_predictor->PredictContribution(p_fmat, out_contribs, model, ntree_limit,
-                                       approximate, condition,
-                                       condition_feature);
+    const MetaInfo& info = p_fmat->info();
+    // number of valid trees
+    unsigned num_trees = ntree_limit * model.param.num_output_group;
+    if (num_trees == 0 || num_trees > model.trees.size()) {
+      num_trees = static_cast<unsigned>(model.trees.size());
+    }
+    // initialize tree node mean values and the depth bounding the path buffers
+    std::vector<int> max_depth(num_trees);
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < num_trees; ++i) {
+      model.trees[i]->FillNodeMeanValues();
+      max_depth[i] = model.trees[i]->MaxDepth();
+    }
+    const int depth = num_trees == 0 ? 0 :
+        *std::max_element(max_depth.begin(), max_depth.end());
+    // the device only does exact TreeSHAP of single rooted trees
+    if (approximate || info.root_index.size() != 0 ||
+        model.param.num_roots != 1 || model.param.size_leaf_vector != 0 ||
+        depth > kShapMaxDepth) {
+      cpu_predictor->PredictContribution(p_fmat, out_contribs, model,
+                                         ntree_limit, approximate, condition,
+                                         condition_feature);
+      return;
+    }
+    const int ngroup = model.param.num_output_group;
+    size_t ncolumns = model.param.num_feature + 1;
+    std::vector<bst_float>& contribs = *out_contribs;
+    contribs.resize(info.num_row * ncolumns * ngroup);
+    if (num_trees != 0) {
+      DeviceShard& shard = *shards.front();
+      dh::safe_cuda(cudaSetDevice(shard.device_idx));
+      shard.model.Sync(model, shard.device_idx);
+      std::vector<float> h_tree_mean(num_trees);
+      for (unsigned i = 0; i < num_trees; ++i) {
+        h_tree_mean[i] = model.trees[i]->node_mean_values[0];
+      }
+      shard.tree_mean = h_tree_mean;
+      dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+      iter->BeforeFirst();
+      while (iter->Next()) {
+        const RowBatch& batch = iter->Value();
+        shard.ContributionToHost(
+            batch, dmlc::BeginPtr(contribs) + batch.base_rowid * ngroup * ncolumns,
+            num_trees, RegTree::UniquePathSize(depth), ngroup, ncolumns,
+            condition, condition_feature);
+      }
+    } else {
+      std::fill(contribs.begin(), contribs.end(), 0);
+    }
+    // add base margin to BIAS
+    const std::vector<bst_float>& base_margin = info.base_margin;
+    for (size_t row_idx = 0; row_idx < info.num_row; ++row_idx) {
+      for (int gid = 0; gid < ngroup; ++gid) {
+        bst_float* p_contribs = &contribs[(row_idx * ngroup + gid) * ncolumns];
+        if (base_margin.size() != 0) {
+          p_contribs[ncolumns - 1] += base_margin[row_idx * ngroup + gid];
+        } else {
+          p_contribs[ncolumns - 1] += model.base_margin;
+        }
+      }
+    }
   }
 
+  // same composition as the cpu predictor over the device contributions
   void PredictInteractionContributions(DMatrix* p_fmat,
                                        std::vector<bst_float>* out_contribs,
                                        const gbm::GBTreeModel& model,
                                        unsigned ntree_limit,
                                        bool approximate) override {
-    cpu_predictor->PredictInteractionContributions(p_fmat, out_contribs, model,
-                                                   ntree_limit, approximate);
+    const MetaInfo& info = p_fmat->info();
+    const int ngroup = model.param.num_output_group;
+    size_t ncolumns = model.param.num_feature;
+    const unsigned row_chunk = ngroup * (ncolumns + 1) * (ncolumns + 1);
+    const unsigned mrow_chunk = (ncolumns + 1) * (ncolumns + 1);
+    const unsigned crow_chunk = ngroup * (ncolumns + 1);
+
+    std::vector<bst_float>& contribs = *out_contribs;
+    contribs.resize(info.num_row * ngroup * (ncolumns + 1) * (ncolumns + 1));
+    std::vector<bst_float> contribs_off(info.num_row * ngroup * (ncolumns + 1));
+    std::vector<bst_float> contribs_on(info.num_row * ngroup * (ncolumns + 1));
+    std::vector<bst_float> contribs_diag(info.num_row * ngroup * (ncolumns + 1));
+
+    PredictContribution(p_fmat, &contribs_diag, model, ntree_limit, approximate, 0, 0);
+    for (size_t i = 0; i < ncolumns + 1; ++i) {
+      PredictContribution(p_fmat, &contribs_off, model, ntree_limit, approximate, -1, i);
+      PredictContribution(p_fmat, &contribs_on, model, ntree_limit, approximate, 1, i);
+
+      for (size_t j = 0; j < info.num_row; ++j) {
+        for (int l = 0; l < ngroup; ++l) {
+          const unsigned o_offset = j * row_chunk + l * mrow_chunk + i * (ncolumns + 1);
+          const unsigned c_offset = j * crow_chunk + l * (ncolumns + 1);
+          contribs[o_offset + i] = 0;
+          for (size_t k = 0; k < ncolumns + 1; ++k) {
+            // fill in the diagonal with additive effects, and off-diagonal with the interactions
+            if (k == i) {
+              contribs[o_offset + i] += contribs_diag[c_offset + k];
+            } else {
+              contribs[o_offset + k] = (contribs_on[c_offset + k] - contribs_off[c_offset + k])/2.0;
+              contribs[o_offset + i] -= contribs[o_offset + k];
+            }
+          }
+        }
+      }
+    }
   }
 
   void Init(const std::vector<std::pair<std::string, std::string>>& cfg,
@@ -462,7 +1108,15 @@ class GPUPredictor : public xgboost::Predictor {
     Predictor::Init(cfg, cache);
     cpu_predictor->Init(cfg, cache);
     param.InitAllowUnknown(cfg);
-    max_shared_memory_bytes = dh::max_shared_memory(param.gpu_id);
+    // the shards are laid out on consecutive devices starting at gpu_id
+    const int n_devices = dh::n_devices_all(param.n_gpus);
+    CHECK_GT(n_devices, 0) << "No GPU is used for prediction";
+    shards.clear();
+    for (int d_idx = 0; d_idx < n_devices; ++d_idx) {
+      int device_idx = (param.gpu_id + d_idx) % dh::n_visible_devices();
+      shards.push_back(std::unique_ptr<DeviceShard>(
+          new DeviceShard(device_idx, param.n_streams, param.tiling)));
+    }
   }
 
  private:
@@ -470,10 +1124,8 @@ class GPUPredictor : public xgboost::Predictor {
   std::unique_ptr<Predictor> cpu_predictor;
   std::unordered_map<DMatrix*, std::shared_ptr<DeviceMatrix>>
       device_matrix_cache_;
-  thrust::device_vector<DevicePredictionNode> nodes;
-  thrust::device_vector<size_t> tree_segments;
-  thrust::device_vector<int> tree_group;
-  size_t max_shared_memory_bytes;
+  std::vector<std::unique_ptr<DeviceShard>> shards;
+  common::TrackedBytes cache_memory_{"PredictionCache"};
 };
 XGBOOST_REGISTER_PREDICTOR(GPUPredictor, "gpu_predictor")
     .describe("Make predictions using GPU.")
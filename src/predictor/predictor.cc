@@ -1,8 +1,12 @@
 /*!
  * Copyright by Contributors 2017
  */
+#include <dmlc/omp.h>
 #include <dmlc/registry.h>
 #include <xgboost/predictor.h>
+#include <xgboost/tree_updater.h>
+#include <algorithm>
+#include <limits>
 
 namespace dmlc {
 DMLC_REGISTRY_ENABLE(::xgboost::PredictorReg);
@@ -14,6 +18,138 @@ void Predictor::Init(
   for (const std::shared_ptr<DMatrix>& d : cache)
     cache_[d.get()].data = d;
 }
+void Predictor::PredictBatch(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
+                             const gbm::GBTreeModel& model, int tree_begin,
+                             unsigned ntree_limit, PredictionContext* ctx) const {
+  LOG(FATAL) << "The predictor does not support reentrant prediction";
+}
+void Predictor::PredictInstance(const SparseBatch::Inst& inst,
+                                std::vector<bst_float>* out_preds,
+                                const gbm::GBTreeModel& model,
+                                unsigned ntree_limit, unsigned root_index,
+                                PredictionContext* ctx) const {
+  LOG(FATAL) << "The predictor does not support reentrant prediction";
+}
+namespace {
+// bytes of the leaf indices of a block of rows
+const size_t kLeafIndexBlockBytes = 16 << 20;
+
+template <typename T>
+void PredictLeafBlocks(DMatrix* p_fmat, const gbm::GBTreeModel& model, unsigned ntree,
+                       const LeafIndexCallback& callback) {
+  const MetaInfo& info = p_fmat->info();
+  const int nthread = omp_get_max_threads();
+  std::vector<RegTree::FVec> thread_temp(nthread);
+  for (RegTree::FVec& feats : thread_temp) feats.Init(model.param.num_feature);
+  const size_t block_rows =
+      std::max(kLeafIndexBlockBytes / (std::max(ntree, 1U) * sizeof(T)), static_cast<size_t>(1));
+  std::vector<T> leaves;
+  dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    for (size_t begin = 0; begin < batch.size; begin += block_rows) {
+      const size_t nrow = std::min(block_rows, batch.size - begin);
+      leaves.resize(nrow * ntree);
+      const bst_omp_uint nsize = static_cast<bst_omp_uint>(nrow);
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        RegTree::FVec& feats = thread_temp[omp_get_thread_num()];
+        const size_t ridx = static_cast<size_t>(batch.base_rowid + begin + i);
+        feats.Fill(batch[begin + i]);
+        T* out = dmlc::BeginPtr(leaves) + static_cast<size_t>(i) * ntree;
+        for (unsigned j = 0; j < ntree; ++j) {
+          out[j] = static_cast<T>(model.trees[j]->GetLeafIndex(feats, info.GetRoot(ridx)));
+        }
+        feats.Drop(batch[begin + i]);
+      }
+      LeafIndexBlock block;
+      block.base_rowid = static_cast<size_t>(batch.base_rowid + begin);
+      block.nrow = nrow;
+      block.ntree = ntree;
+      block.index_size = static_cast<int>(sizeof(T));
+      block.data = dmlc::BeginPtr(leaves);
+      callback(block);
+    }
+  }
+}
+}  // namespace
+
+void Predictor::PredictLeafIndex(DMatrix* dmat, const gbm::GBTreeModel& model,
+                                 unsigned ntree_limit, const LeafIndexCallback& callback) {
+  // number of valid trees
+  ntree_limit *= model.param.num_output_group;
+  if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+    ntree_limit = static_cast<unsigned>(model.trees.size());
+  }
+  int max_nodes = 0;
+  for (unsigned j = 0; j < ntree_limit; ++j) {
+    max_nodes = std::max(max_nodes, model.trees[j]->param.num_nodes);
+  }
+  if (max_nodes <= std::numeric_limits<uint16_t>::max() + 1) {
+    PredictLeafBlocks<uint16_t>(dmat, model, ntree_limit, callback);
+  } else {
+    PredictLeafBlocks<uint32_t>(dmat, model, ntree_limit, callback);
+  }
+}
+void Predictor::PredictMultiModel(DMatrix* dmat,
+                                  const std::vector<const gbm::GBTreeModel*>& models,
+                                  unsigned ntree_limit,
+                                  const std::vector<bst_float*>& out_margins) {
+  CHECK_EQ(models.size(), out_margins.size());
+  const size_t nmodel = models.size();
+  // number of valid trees of each model, the feature vector fits all the models
+  std::vector<unsigned> tree_end(nmodel);
+  int num_feature = 0;
+  for (size_t k = 0; k < nmodel; ++k) {
+    const gbm::GBTreeModel& model = *models[k];
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "size_leaf_vector is enforced to 0 so far";
+    CHECK_EQ(model.compiled_trees.Size(), model.trees.size());
+    const unsigned ntree = ntree_limit * model.param.num_output_group;
+    tree_end[k] = ntree == 0 || ntree > model.trees.size() ?
+        static_cast<unsigned>(model.trees.size()) : ntree;
+    num_feature = std::max(num_feature, model.param.num_feature);
+  }
+  const MetaInfo& info = dmat->info();
+  const int nthread = omp_get_max_threads();
+  std::vector<RegTree::FVec> thread_temp(nthread);
+  for (RegTree::FVec& feats : thread_temp) feats.Init(num_feature);
+  dmlc::DataIter<RowBatch>* iter = dmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      RegTree::FVec& feats = thread_temp[omp_get_thread_num()];
+      const size_t ridx = static_cast<size_t>(batch.base_rowid + i);
+      const unsigned root_index = info.GetRoot(ridx);
+      feats.Fill(batch[i]);
+      for (size_t k = 0; k < nmodel; ++k) {
+        const gbm::GBTreeModel& model = *models[k];
+        bst_float* margin = out_margins[k] + ridx * model.param.num_output_group;
+        for (unsigned j = 0; j < tree_end[k]; ++j) {
+          margin[model.tree_info[j]] += model.compiled_trees.Predict(j, feats, root_index);
+        }
+      }
+      feats.Drop(batch[i]);
+    }
+  }
+}
+bool Predictor::UpdateCacheByUpdaters(
+    std::vector<std::unique_ptr<TreeUpdater>>* updaters, const DMatrix* data,
+    HostDeviceVector<bst_float>* out_preds) {
+  for (const std::unique_ptr<TreeUpdater>& up : *updaters) {
+    if (up->UpdatePredictionCache(data, out_preds)) return true;
+  }
+  return false;
+}
+bool Predictor::CacheCoversRows(const DMatrix* data, const PredictionCacheEntry& entry,
+                                int num_output_group) {
+  const size_t size = entry.predictions.size();
+  return size != 0 && size == num_output_group * data->info().num_row;
+}
 Predictor* Predictor::Create(std::string name) {
   auto* e = ::dmlc::Registry<PredictorReg>::Get()->Find(name);
   if (e == nullptr) {
@@ -30,5 +166,7 @@ namespace predictor {
 DMLC_REGISTRY_LINK_TAG(gpu_predictor);
 #endif
 DMLC_REGISTRY_LINK_TAG(cpu_predictor);
+DMLC_REGISTRY_LINK_TAG(quickscorer_predictor);
+DMLC_REGISTRY_LINK_TAG(binned_predictor);
 }  // namespace predictor
 }  // namespace xgboost
@@ -0,0 +1,434 @@
+/*!
+ * Copyright by Contributors 2018
+ * \file quickscorer_predictor.cc
+ * \brief QuickScorer style predictor, the exit leaf of every tree is found by
+ *  AND-ing bitvectors of the leaves that each false node eliminates, so the
+ *  traversal has no data dependent branches.
+ */
+#include <xgboost/predictor.h>
+#include <xgboost/tree_model.h>
+#include <xgboost/tree_updater.h>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+#include "dmlc/logging.h"
+#include "../common/host_device_vector.h"
+#include "../common/memory_tracker.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace xgboost {
+namespace predictor {
+
+DMLC_REGISTRY_FILE_TAG(quickscorer_predictor);
+
+/*! \brief index of the lowest set bit, x must be non zero */
+inline int LowestBit(uint64_t x) {
+#if defined(_MSC_VER) && defined(_WIN64)
+  unsigned long idx;  // NOLINT(*)
+  _BitScanForward64(&idx, x);
+  return static_cast<int>(idx);
+#elif defined(__GNUC__)
+  return __builtin_ctzll(x);
+#else
+  int idx = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    ++idx;
+  }
+  return idx;
+#endif
+}
+
+/*!
+ * \brief bitvector layout of a tree ensemble.
+ *  Leaves of every tree are numbered from left to right, a split node that
+ *  evaluates to false (the instance goes right) eliminates the leaves of its
+ *  left subtree, and the exit leaf is the lowest leaf that survives.
+ */
+struct QuickScorerModel {
+  /*! \brief maximum number of leaves of a tree */
+  static const int kMaxLeaves = 64;
+  /*! \brief a split node, grouped by feature */
+  struct Node {
+    bst_float threshold;
+    unsigned tree_id;
+    uint64_t mask;
+  };
+  /*! \brief split nodes of feature f in [feat_ptr[f], feat_ptr[f + 1]), by threshold */
+  std::vector<size_t> feat_ptr;
+  std::vector<Node> nodes;
+  /*! \brief split nodes that send missing values right, grouped by feature */
+  std::vector<size_t> miss_ptr;
+  std::vector<Node> miss_nodes;
+  /*! \brief leaf values of tree i start at leaf_ptr[i] */
+  std::vector<size_t> leaf_ptr;
+  std::vector<bst_float> leaf_value;
+  /*! \brief the model this layout was built from */
+  const gbm::GBTreeModel* model{nullptr};
+  uint64_t version{0};
+
+  /*! \brief whether the layout is up to date with the model */
+  inline bool Matches(const gbm::GBTreeModel& m) const {
+    return model == &m && version == m.compiled_trees.version &&
+        leaf_ptr.size() == m.trees.size() + 1;
+  }
+  /*! \brief whether every tree of the model fits into the layout */
+  inline static bool Supports(const gbm::GBTreeModel& m) {
+    if (m.param.size_leaf_vector != 0) return false;
+    for (const auto& tree : m.trees) {
+      if (tree->param.num_roots != 1) return false;
+      // every split node has two children
+      const int num_leaves = (tree->param.num_nodes - tree->param.num_deleted + 1) / 2;
+      if (num_leaves > kMaxLeaves) return false;
+    }
+    return true;
+  }
+  /*! \brief build the layout of all the trees of the model */
+  inline void Build(const gbm::GBTreeModel& m) {
+    const int num_feature = m.param.num_feature;
+    std::vector<std::vector<Node> > by_feat(num_feature), miss_by_feat(num_feature);
+    leaf_ptr.assign(1, 0);
+    leaf_value.clear();
+    for (size_t i = 0; i < m.trees.size(); ++i) {
+      this->AddNode(*m.trees[i], 0, static_cast<unsigned>(i), &by_feat, &miss_by_feat);
+      leaf_ptr.push_back(leaf_value.size());
+    }
+    Flatten(&by_feat, &feat_ptr, &nodes, true);
+    Flatten(&miss_by_feat, &miss_ptr, &miss_nodes, false);
+    model = &m;
+    version = m.compiled_trees.version;
+  }
+
+ private:
+  // in order walk, returns the number of leaves below nid
+  inline int AddNode(const RegTree& tree, int nid, unsigned tree_id,
+                     std::vector<std::vector<Node> >* by_feat,
+                     std::vector<std::vector<Node> >* miss_by_feat) {
+    const RegTree::Node& node = tree[nid];
+    if (node.is_leaf()) {
+      leaf_value.push_back(node.leaf_value());
+      return 1;
+    }
+    const int first = static_cast<int>(leaf_value.size() - leaf_ptr.back());
+    const int nleft = this->AddNode(tree, node.cleft(), tree_id, by_feat, miss_by_feat);
+    const int nright = this->AddNode(tree, node.cright(), tree_id, by_feat, miss_by_feat);
+    uint64_t left = (nleft == kMaxLeaves ? ~uint64_t(0) : ((uint64_t(1) << nleft) - 1)) << first;
+    Node e;
+    e.threshold = node.split_cond();
+    e.tree_id = tree_id;
+    e.mask = ~left;
+    CHECK_LT(node.split_index(), by_feat->size())
+        << "split feature index exceed num_feature of the model";
+    (*by_feat)[node.split_index()].push_back(e);
+    if (!node.default_left()) {
+      (*miss_by_feat)[node.split_index()].push_back(e);
+    }
+    return nleft + nright;
+  }
+  inline static void Flatten(std::vector<std::vector<Node> >* by_feat,
+                             std::vector<size_t>* ptr, std::vector<Node>* out,
+                             bool sort) {
+    ptr->assign(1, 0);
+    out->clear();
+    for (std::vector<Node>& list : *by_feat) {
+      if (sort) {
+        std::stable_sort(list.begin(), list.end(), [](const Node& a, const Node& b) {
+            return a.threshold < b.threshold;
+          });
+      }
+      out->insert(out->end(), list.begin(), list.end());
+      ptr->push_back(out->size());
+    }
+  }
+};
+
+class QuickScorerPredictor : public Predictor {
+ protected:
+  // init thread buffers
+  inline void InitThreadTemp(int nthread, int num_feature) {
+    int prev_thread_temp_size = thread_temp.size();
+    if (prev_thread_temp_size < nthread) {
+      thread_temp.resize(nthread, RegTree::FVec());
+      for (int i = prev_thread_temp_size; i < nthread; ++i) {
+        thread_temp[i].Init(num_feature);
+      }
+    }
+  }
+  // evaluate all the split nodes of one instance and leave the
+  // surviving leaves of every tree in leaves
+  inline void ScoreBitvectors(const RegTree::FVec& feats, uint64_t* leaves) const {
+    const int num_feature = static_cast<int>(qs.feat_ptr.size()) - 1;
+    for (int fid = 0; fid < num_feature; ++fid) {
+      if (feats.is_missing(fid)) {
+        for (size_t k = qs.miss_ptr[fid]; k < qs.miss_ptr[fid + 1]; ++k) {
+          leaves[qs.miss_nodes[k].tree_id] &= qs.miss_nodes[k].mask;
+        }
+        continue;
+      }
+      const bst_float fvalue = feats.fvalue(fid);
+      const size_t end = qs.feat_ptr[fid + 1];
+      size_t k = qs.feat_ptr[fid];
+      if (std::isnan(fvalue)) {
+        // NaN never compares less than the split condition
+        for (; k < end; ++k) {
+          leaves[qs.nodes[k].tree_id] &= qs.nodes[k].mask;
+        }
+        continue;
+      }
+      // false nodes are those with threshold <= fvalue, a sorted prefix
+      for (; k < end && qs.nodes[k].threshold <= fvalue; ++k) {
+        leaves[qs.nodes[k].tree_id] &= qs.nodes[k].mask;
+      }
+    }
+  }
+  inline void PredLoopQuickScorer(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
+                                  const gbm::GBTreeModel& model, int num_group,
+                                  unsigned tree_begin, unsigned tree_end) {
+    const int nthread = omp_get_max_threads();
+    const size_t ntree = model.trees.size();
+    InitThreadTemp(nthread, model.param.num_feature);
+    thread_leaves.resize(nthread * ntree);
+    thread_psum.resize(nthread * num_group);
+    std::vector<bst_float>& preds = *out_preds;
+    CHECK_EQ(preds.size(), p_fmat->info().num_row * num_group);
+    dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const RowBatch& batch = iter->Value();
+      // parallel over local batch
+      const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const int tid = omp_get_thread_num();
+        RegTree::FVec& feats = thread_temp[tid];
+        uint64_t* leaves = &thread_leaves[tid * ntree];
+        bst_float* psum = &thread_psum[tid * num_group];
+        std::fill(leaves, leaves + ntree, ~uint64_t(0));
+        std::fill(psum, psum + num_group, 0.0f);
+        feats.Fill(batch[i]);
+        this->ScoreBitvectors(feats, leaves);
+        feats.Drop(batch[i]);
+        for (unsigned j = tree_begin; j < tree_end; ++j) {
+          psum[model.tree_info[j]] += qs.leaf_value[qs.leaf_ptr[j] + LowestBit(leaves[j])];
+        }
+        const size_t offset = (batch.base_rowid + i) * num_group;
+        for (int gid = 0; gid < num_group; ++gid) {
+          preds[offset + gid] += psum[gid];
+        }
+      }
+    }
+  }
+  // plain traversal, used for the few trees added when updating the
+  // cache and for models the bitvector layout does not support
+  inline void PredLoopTraverse(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
+                               const gbm::GBTreeModel& model, int num_group,
+                               unsigned tree_begin, unsigned tree_end) {
+    const MetaInfo& info = p_fmat->info();
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
+    thread_psum.resize(nthread * num_group);
+    std::vector<bst_float>& preds = *out_preds;
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "size_leaf_vector is enforced to 0 so far";
+    CHECK_EQ(preds.size(), p_fmat->info().num_row * num_group);
+    CHECK_EQ(model.compiled_trees.Size(), model.trees.size());
+    dmlc::DataIter<RowBatch>* iter = p_fmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const RowBatch& batch = iter->Value();
+      // parallel over local batch
+      const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const int tid = omp_get_thread_num();
+        RegTree::FVec& feats = thread_temp[tid];
+        bst_float* psum = &thread_psum[tid * num_group];
+        const size_t ridx = static_cast<size_t>(batch.base_rowid + i);
+        const unsigned root_index = info.GetRoot(ridx);
+        std::fill(psum, psum + num_group, 0.0f);
+        feats.Fill(batch[i]);
+        for (unsigned j = tree_begin; j < tree_end; ++j) {
+          psum[model.tree_info[j]] += model.compiled_trees.Predict(j, feats, root_index);
+        }
+        feats.Drop(batch[i]);
+        for (int gid = 0; gid < num_group; ++gid) {
+          preds[ridx * num_group + gid] += psum[gid];
+        }
+      }
+    }
+  }
+
+  void PredLoopInternal(DMatrix* dmat, std::vector<bst_float>* out_preds,
+                        const gbm::GBTreeModel& model, unsigned tree_begin,
+                        unsigned tree_end) {
+    if (!qs.Matches(model)) {
+      supported = QuickScorerModel::Supports(model);
+      if (supported) {
+        qs.Build(model);
+      }
+    }
+    if (supported) {
+      PredLoopQuickScorer(dmat, out_preds, model, model.param.num_output_group,
+                          tree_begin, tree_end);
+    } else {
+      PredLoopTraverse(dmat, out_preds, model, model.param.num_output_group,
+                       tree_begin, tree_end);
+    }
+  }
+
+  bool PredictFromCache(DMatrix* dmat,
+                        HostDeviceVector<bst_float>* out_preds,
+                        const gbm::GBTreeModel& model,
+                        unsigned ntree_limit) {
+    if (ntree_limit == 0 ||
+        ntree_limit * model.param.num_output_group >= model.trees.size()) {
+      auto it = cache_.find(dmat);
+      if (it != cache_.end()) {
+        HostDeviceVector<bst_float>& y = it->second.predictions;
+        if (CacheCoversRows(dmat, it->second, model.param.num_output_group)) {
+          out_preds->resize(y.size());
+          std::copy(y.const_data_h().begin(), y.const_data_h().end(),
+                    out_preds->data_h().begin());
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  void InitOutPredictions(const MetaInfo& info,
+                          HostDeviceVector<bst_float>* out_preds,
+                          const gbm::GBTreeModel& model) const {
+    size_t n = model.param.num_output_group * info.num_row;
+    const std::vector<bst_float>& base_margin = info.base_margin;
+    out_preds->resize(n);
+    std::vector<bst_float>& out_preds_h = out_preds->data_h();
+    if (base_margin.size() != 0) {
+      CHECK_EQ(out_preds->size(), n);
+      std::copy(base_margin.begin(), base_margin.end(), out_preds_h.begin());
+    } else {
+      std::fill(out_preds_h.begin(), out_preds_h.end(), model.base_margin);
+    }
+  }
+
+ public:
+  QuickScorerPredictor() : cpu_predictor(Predictor::Create("cpu_predictor")) {}
+
+  void PredictBatch(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
+                    const gbm::GBTreeModel& model, int tree_begin,
+                    unsigned ntree_limit = 0) override {
+    if (this->PredictFromCache(dmat, out_preds, model, ntree_limit)) {
+      return;
+    }
+
+    this->InitOutPredictions(dmat->info(), out_preds, model);
+
+    ntree_limit *= model.param.num_output_group;
+    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model.trees.size());
+    }
+
+    this->PredLoopInternal(dmat, &out_preds->data_h(), model,
+                           tree_begin, ntree_limit);
+  }
+
+  void UpdatePredictionCache(
+      const gbm::GBTreeModel& model,
+      std::vector<std::unique_ptr<TreeUpdater>>* updaters,
+      int num_new_trees) override {
+    int old_ntree = model.trees.size() - num_new_trees;
+    // update cache entry
+    for (auto& kv : cache_) {
+      PredictionCacheEntry& e = kv.second;
+
+      if (e.predictions.size() !=
+          model.param.num_output_group * e.data->info().num_row) {
+        InitOutPredictions(e.data->info(), &(e.predictions), model);
+        PredLoopInternal(e.data.get(), &(e.predictions.data_h()), model, 0,
+                         model.trees.size());
+      } else if (model.param.num_output_group == 1 && num_new_trees == 1 &&
+                 UpdateCacheByUpdaters(updaters, e.data.get(), &(e.predictions))) {
+        {}  // do nothing
+      } else {
+        // only a few new trees, not worth rebuilding the bitvector layout
+        PredLoopTraverse(e.data.get(), &(e.predictions.data_h()), model,
+                         model.param.num_output_group, old_ntree, model.trees.size());
+      }
+    }
+    size_t nbytes = 0;
+    for (const auto& kv : cache_) nbytes += kv.second.predictions.size() * sizeof(bst_float);
+    cache_memory_.Set(nbytes);
+  }
+
+  // reentrant prediction goes through cpu_predictor, the bitvector
+  // layout is built lazily and so is mutable state of this predictor
+  void PredictBatch(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
+                    const gbm::GBTreeModel& model, int tree_begin,
+                    unsigned ntree_limit, PredictionContext* ctx) const override {
+    cpu_predictor->PredictBatch(dmat, out_preds, model, tree_begin, ntree_limit, ctx);
+  }
+
+  void PredictInstance(const SparseBatch::Inst& inst,
+                       std::vector<bst_float>* out_preds,
+                       const gbm::GBTreeModel& model, unsigned ntree_limit,
+                       unsigned root_index) override {
+    cpu_predictor->PredictInstance(inst, out_preds, model, ntree_limit, root_index);
+  }
+
+  void PredictInstance(const SparseBatch::Inst& inst,
+                       std::vector<bst_float>* out_preds,
+                       const gbm::GBTreeModel& model, unsigned ntree_limit,
+                       unsigned root_index, PredictionContext* ctx) const override {
+    cpu_predictor->PredictInstance(inst, out_preds, model, ntree_limit, root_index, ctx);
+  }
+  void PredictLeaf(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
+                   const gbm::GBTreeModel& model,
+                   unsigned ntree_limit) override {
+    cpu_predictor->PredictLeaf(p_fmat, out_preds, model, ntree_limit);
+  }
+
+  void PredictContribution(DMatrix* p_fmat,
+                           std::vector<bst_float>* out_contribs,
+                           const gbm::GBTreeModel& model, unsigned ntree_limit,
+                           bool approximate, int condition,
+                           unsigned condition_feature) override {
+    cpu_predictor->PredictContribution(p_fmat, out_contribs, model, ntree_limit,
+                                       approximate, condition,
+                                       condition_feature);
+  }
+
+  void PredictInteractionContributions(DMatrix* p_fmat,
+                                       std::vector<bst_float>* out_contribs,
+                                       const gbm::GBTreeModel& model,
+                                       unsigned ntree_limit,
+                                       bool approximate) override {
+    cpu_predictor->PredictInteractionContributions(p_fmat, out_contribs, model,
+                                                   ntree_limit, approximate);
+  }
+
+  void Init(const std::vector<std::pair<std::string, std::string>>& cfg,
+            const std::vector<std::shared_ptr<DMatrix>>& cache) override {
+    Predictor::Init(cfg, cache);
+    cpu_predictor->Init(cfg, {});
+  }
+
+ private:
+  std::unique_ptr<Predictor> cpu_predictor;
+  QuickScorerModel qs;
+  bool supported{false};
+  std::vector<RegTree::FVec> thread_temp;
+  // per thread surviving leaves of every tree
+  std::vector<uint64_t> thread_leaves;
+  std::vector<bst_float> thread_psum;
+  common::TrackedBytes cache_memory_{"PredictionCache"};
+};
+
+XGBOOST_REGISTER_PREDICTOR(QuickScorerPredictor, "cpu_quickscorer")
+    .describe("Make predictions using bitvector traversal of shallow trees on CPU.")
+    .set_body([]() { return new QuickScorerPredictor(); });
+}  // namespace predictor
+}  // namespace xgboost
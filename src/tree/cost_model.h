@@ -0,0 +1,98 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file cost_model.h
+ * \brief rough cost of one boosting iteration of each tree method, from the
+ *  shape of the training matrix and the resources, used by tree_method=auto.
+ */
+#ifndef XGBOOST_TREE_COST_MODEL_H_
+#define XGBOOST_TREE_COST_MODEL_H_
+
+#include <xgboost/data.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+
+namespace xgboost {
+namespace tree {
+/*!
+ * \brief the estimated cost of one iteration of the tree methods, in millions of
+ *  visits of a matrix entry by one thread. The exact method scans the sorted
+ *  columns at every level, one column per thread. approx does the same and
+ *  sketches the columns again. hist adds the rows of the smaller child to
+ *  histograms, the other child is the difference, then scans max_bin bins of
+ *  every feature of every node. gpu_hist builds the histograms on the devices,
+ *  each worth kGPUThreads threads, after a fixed launch overhead.
+ */
+struct TreeMethodCost {
+  /*! \brief threads of the host a device is worth when building histograms */
+  static constexpr double kGPUThreads = 64.0;
+  /*! \brief fixed cost of the kernels and the copies of an iteration */
+  static constexpr double kGPUOverhead = 1.0;
+  /*! \brief visits of a sorted column entry, which gathers its gradient */
+  static constexpr double kExactVisit = 2.0;
+  /*! \brief visits of an entry by the sketch of approx */
+  static constexpr double kSketchVisit = 1.0;
+
+  double exact;
+  double approx;
+  double hist;
+  /*! \brief infinite without a device */
+  double gpu_hist;
+
+  /*!
+   * \brief estimate the costs
+   * \param info the training matrix
+   * \param nthread number of threads
+   * \param max_depth maximum depth of the trees
+   * \param max_bin maximum number of bins of hist
+   * \param ngpu number of devices gpu_hist would use
+   */
+  static TreeMethodCost Estimate(const MetaInfo& info, int nthread, int max_depth,
+                                 int max_bin, int ngpu) {
+    // the sources that do not count the entries are taken as dense
+    const double nnz = static_cast<double>(info.num_nonzero != 0 ? info.num_nonzero :
+                                           info.num_row * info.num_col) / 1e6;
+    const double ncol = static_cast<double>(std::max<uint64_t>(info.num_col, 1));
+    const double depth = std::max(max_depth, 1);
+    const double threads = std::max(nthread, 1);
+    // the column methods do not use more threads than columns
+    const double col_threads = std::min(threads, ncol);
+    // the candidate splits of one level are scanned for every node
+    const double nodes = std::pow(2.0, std::min(depth, 16.0));
+    const double split_scan = nodes * ncol * std::max(max_bin, 1) / 1e6;
+    TreeMethodCost cost;
+    cost.exact = kExactVisit * nnz * depth / col_threads;
+    cost.approx = (kExactVisit + kSketchVisit) * nnz * depth / col_threads;
+    cost.hist = (nnz * depth / 2 + split_scan) / threads;
+    cost.gpu_hist = ngpu <= 0 ? std::numeric_limits<double>::infinity() :
+        kGPUOverhead + (nnz * depth / 2 + split_scan) / (kGPUThreads * ngpu);
+    return cost;
+  }
+  /*! \brief name of the cheapest method */
+  inline std::string Best() const {
+    std::string best = "exact";
+    double best_cost = exact;
+    if (hist < best_cost) {
+      best = "hist";
+      best_cost = hist;
+    }
+    if (gpu_hist < best_cost) {
+      best = "gpu_hist";
+      best_cost = gpu_hist;
+    }
+    // approx only pays when the columns do not fit in one block
+    return best;
+  }
+  /*! \brief the costs, for the log */
+  inline std::string ToString() const {
+    std::ostringstream os;
+    os << "exact " << exact << ", approx " << approx << ", hist " << hist;
+    if (!std::isinf(gpu_hist)) os << ", gpu_hist " << gpu_hist;
+    return os.str();
+  }
+};
+}  // namespace tree
+}  // namespace xgboost
+#endif  // XGBOOST_TREE_COST_MODEL_H_
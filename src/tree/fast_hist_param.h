@@ -7,6 +7,8 @@
 #ifndef XGBOOST_TREE_FAST_HIST_PARAM_H_
 #define XGBOOST_TREE_FAST_HIST_PARAM_H_
 
+#include <string>
+
 namespace xgboost {
 namespace tree {
 
@@ -18,6 +20,8 @@ struct FastHistParam : public dmlc::Parameter<FastHistParam> {
   // percentage threshold for treating a feature as sparse
   // e.g. 0.2 indicates a feature with fewer than 20% nonzeros is considered sparse
   double sparse_threshold;
+  // whether the column matrix picks the threshold from the size of its bin ids
+  bool adaptive_sparse_threshold;
   // use feature grouping? (default yes)
   int enable_feature_grouping;
   // when grouping features, how many "conflicts" to allow.
@@ -29,6 +33,36 @@ struct FastHistParam : public dmlc::Parameter<FastHistParam> {
   // for that feature; to save time, only up to (max_search_group) of existing groups
   // will be considered. If set to zero, ALL existing groups will be examined
   unsigned max_search_group;
+  // maximum number of node histograms kept for the subtraction trick, 0 means no limit
+  unsigned max_cached_hist_node;
+  // file caching the quantized matrix across runs, empty means no cache
+  std::string hist_cache_file;
+  // file storing the pages of the quantized matrix of external memory data
+  std::string hist_page_file;
+  // whether the gradient histograms are summed in float instead of double
+  bool single_precision_histogram;
+  // fraction of the rows used to sketch the histogram cuts
+  float sketch_subsample;
+  // data split mode of distributed training, the one of the learner
+  int dsplit;
+  // whether each thread builds its histograms from the rows it quantized
+  bool numa_aware;
+  // whether the bin ids of the quantized matrix are bit packed
+  bool compressed_bin_index;
+  // whether the feature groups are bundles of mutually exclusive features
+  bool exclusive_feature_bundling;
+  // whether the gradients are moved with the rows, contiguous for each node
+  bool contiguous_gradients;
+  // whether the quantized matrix is kept with the training matrix for other boosters
+  bool share_quantized_data;
+  // whether the root histogram is updated from the one of the previous tree
+  bool incremental_root_histogram;
+  // change of the gradient or the hessian of a row ignored by the update
+  float root_delta_eps;
+  // fraction of the rows with changed gradients above which the root is rebuilt
+  float root_delta_max_fraction;
+  // density of sparse data below which each node keeps the bitmap of its features
+  double node_feature_threshold;
 
   // declare the parameters
   DMLC_DECLARE_PARAMETER(FastHistParam) {
@@ -42,6 +76,10 @@ struct FastHistParam : public dmlc::Parameter<FastHistParam> {
                   "advanced use");
     DMLC_DECLARE_FIELD(sparse_threshold).set_range(0, 1.0).set_default(0.2)
         .describe("percentage threshold for treating a feature as sparse");
+    DMLC_DECLARE_FIELD(adaptive_sparse_threshold).set_default(false)
+        .describe("Store a feature of the column matrix as sparse whenever that takes "
+                  "less memory than dense, given the size of colmat_dtype, instead of "
+                  "comparing its density with sparse_threshold.");
     DMLC_DECLARE_FIELD(enable_feature_grouping).set_lower_bound(0).set_default(0)
         .describe("if >0, enable feature grouping to ameliorate work imbalance "
                   "among worker threads");
@@ -55,6 +93,80 @@ struct FastHistParam : public dmlc::Parameter<FastHistParam> {
                   "groups before creating a new group for that feature; to save time, "
                   "only up to (max_search_group) of existing groups will be "
                   "considered. If set to zero, ALL existing groups will be examined.");
+    DMLC_DECLARE_FIELD(max_cached_hist_node).set_lower_bound(0).set_default(0)
+        .describe("Maximum number of histograms of nodes waiting to be split that are "
+                  "kept for the subtraction trick, 0 means no limit. The oldest ones "
+                  "are evicted first, the children of an evicted node are built from "
+                  "their rows.");
+    DMLC_DECLARE_FIELD(hist_cache_file).set_default("")
+        .describe("File caching the histogram cuts and the quantized matrix across "
+                  "runs. It is loaded when it was built for the same data, checked "
+                  "with their shape and a hash of their entries and weights, and the "
+                  "same max_bin, and written otherwise. In distributed training each "
+                  "worker has its own file, with .r<rank>-<world size> added before "
+                  "the extension as for the external memory cache.");
+    DMLC_DECLARE_FIELD(hist_page_file).set_default("")
+        .describe("File storing the pages of the quantized matrix when the data "
+                  "are in external memory, it is written at the first iteration "
+                  "and read back at every level of the trees.");
+    DMLC_DECLARE_FIELD(single_precision_histogram).set_default(false)
+        .describe("Sum the gradient histograms in single precision. This halves "
+                  "the memory and the bandwidth of the histograms, at the cost of "
+                  "rounding errors on large nodes.");
+    DMLC_DECLARE_FIELD(sketch_subsample).set_range(0.0f, 1.0f).set_default(1.0f)
+        .describe("Fraction of the rows, sampled at random, from which the histogram "
+                  "cuts are sketched. The first entry of every feature is always "
+                  "used. The hist_cache_file does not record it.");
+    DMLC_DECLARE_FIELD(dsplit)
+        .set_default(0)
+        .add_enum("auto", 0)
+        .add_enum("col", 1)
+        .add_enum("row", 2)
+        .describe("Data split mode for distributed training. With col, every worker "
+                  "has all the rows and some of the features, it finds the splits "
+                  "of its features and the best ones are reduced over the workers.");
+    DMLC_DECLARE_FIELD(numa_aware).set_default(false)
+        .describe("Build the histogram of a node with each thread taking the same "
+                  "contiguous part of its rows as when the matrix was quantized, so "
+                  "that the threads read the memory of their own NUMA node. The "
+                  "threads should be bound to cores, e.g. with OMP_PROC_BIND=true.");
+    DMLC_DECLARE_FIELD(compressed_bin_index).set_default(false)
+        .describe("Bit pack the bin ids of the quantized matrix to log2(number of "
+                  "bins) bits each, in the layout of the gpu_hist matrix. It saves "
+                  "memory on large data at the cost of slower histograms. It does "
+                  "not apply to external memory data.");
+    DMLC_DECLARE_FIELD(exclusive_feature_bundling).set_default(false)
+        .describe("With enable_feature_grouping, only bundle features that never "
+                  "have entries in the same row, e.g. one-hot encoded ones, as if "
+                  "max_conflict_rate were 0. A row has then at most one bin in a "
+                  "bundle, which is stored as one bin per row without row pointers.");
+    DMLC_DECLARE_FIELD(contiguous_gradients).set_default(false)
+        .describe("Keep a copy of the gradients next to the rows of the nodes, "
+                  "reordered with the rows when a node is split, so that the "
+                  "histograms read the gradients of a node sequentially.");
+    DMLC_DECLARE_FIELD(share_quantized_data).set_default(false)
+        .describe("Keep the cuts and the quantized matrix with the training matrix, "
+                  "so that every booster trained on the same matrix with the same "
+                  "max_bin and quantization parameters uses them instead of building "
+                  "them again, e.g. in a parameter sweep. They are freed with the "
+                  "training matrix. External memory data is not shared.");
+    DMLC_DECLARE_FIELD(incremental_root_histogram).set_default(false)
+        .describe("Build the root histogram of a tree from the one of the previous "
+                  "tree, adding the changes of the gradients of the rows whose "
+                  "gradients changed. It applies to in-memory data on a single "
+                  "machine without row sampling, the root is rebuilt otherwise.");
+    DMLC_DECLARE_FIELD(root_delta_eps).set_lower_bound(0.0f).set_default(0.0f)
+        .describe("With incremental_root_histogram, a row whose gradient and hessian "
+                  "both changed by at most this much since they were last added to the "
+                  "root histogram is left as it is. 0 keeps the histogram exact.");
+    DMLC_DECLARE_FIELD(root_delta_max_fraction).set_range(0.0f, 1.0f).set_default(0.25f)
+        .describe("With incremental_root_histogram, the root histogram is rebuilt "
+                  "from all the rows when more than this fraction of them changed.");
+    DMLC_DECLARE_FIELD(node_feature_threshold).set_range(0, 1.0).set_default(0.2)
+        .describe("Density of sparse data below which each node keeps the bitmap of "
+                  "the features with entries in its rows, so that the other features "
+                  "are skipped by the subtraction trick and the split evaluation. "
+                  "0 turns the bitmaps off.");
   }
 };
 
@@ -0,0 +1,97 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file leaf_position.h
+ * \brief the node each training row ends in, kept by the tree makers so the
+ *  prediction cache of the training matrix is updated without prediction.
+ */
+#ifndef XGBOOST_TREE_LEAF_POSITION_H_
+#define XGBOOST_TREE_LEAF_POSITION_H_
+
+#include <dmlc/omp.h>
+#include <xgboost/data.h>
+#include <xgboost/tree_model.h>
+#include <vector>
+#include "./param.h"
+#include "../common/host_device_vector.h"
+
+namespace xgboost {
+namespace tree {
+/*!
+ * \brief the positions of the rows of a matrix in the last tree grown on it.
+ *  A position is the id of the node of the row, or ~nid when the row stopped
+ *  expanding at node nid, as encoded by the tree makers.
+ */
+class LeafPosition {
+ public:
+  LeafPosition() : data_(nullptr), tree_(nullptr), position_(nullptr) {}
+  /*! \brief forget the last tree */
+  inline void Clear() {
+    data_ = nullptr;
+    tree_ = nullptr;
+    position_ = nullptr;
+  }
+  /*!
+   * \brief remember the positions of the rows in a grown tree. They are kept
+   *  only when every row was placed, that is no row was sampled out, left out
+   *  of the column access or deleted by a negative hessian.
+   * \param position the positions, valid until the next update of the maker
+   */
+  inline void Set(const DMatrix* data, const std::vector<bst_gpair>& gpair,
+                  const TrainParam& param, const RegTree* tree,
+                  const std::vector<int>* position) {
+    this->Clear();
+    if (!AllRowsPlaced(*data, gpair, param) || position->size() != data->info().num_row) {
+      return;
+    }
+    data_ = data;
+    tree_ = tree;
+    position_ = position;
+  }
+  /*! \brief whether the maker places every row of the matrix in the tree */
+  inline static bool AllRowsPlaced(const DMatrix& data, const std::vector<bst_gpair>& gpair,
+                                   const TrainParam& param) {
+    if (param.subsample < 1.0f || data.buffered_rowset().size() != data.info().num_row) {
+      return false;
+    }
+    for (const bst_gpair& g : gpair) {
+      if (g.GetHess() < 0.0f) return false;
+    }
+    return true;
+  }
+  /*!
+   * \brief add the leaf value of each row to its prediction. The rows of the
+   *  nodes removed by the pruner get the value of the leaf that replaced them.
+   * \return false when the positions are not known for the matrix
+   */
+  inline bool AddLeafValues(const DMatrix* data,
+                            HostDeviceVector<bst_float>* out_preds) const {
+    if (data_ == nullptr || data != data_) return false;
+    const RegTree& tree = *tree_;
+    const std::vector<int>& position = *position_;
+    std::vector<bst_float>& preds = out_preds->data_h();
+    CHECK_EQ(preds.size(), position.size());
+    // the value of the leaf standing for each node, or of none
+    std::vector<int> leaf(tree.param.num_nodes);
+    for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+      int pid = nid;
+      while (tree[pid].is_deleted()) pid = tree[pid].parent();
+      leaf[nid] = tree[pid].is_leaf() ? pid : -1;
+    }
+    const bst_omp_uint nrow = static_cast<bst_omp_uint>(position.size());
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nrow; ++i) {
+      const int pos = position[i] < 0 ? ~position[i] : position[i];
+      CHECK_GE(leaf[pos], 0) << "row " << i << " is not placed in a leaf";
+      preds[i] += tree[leaf[pos]].leaf_value();
+    }
+    return true;
+  }
+
+ private:
+  const DMatrix* data_;
+  const RegTree* tree_;
+  const std::vector<int>* position_;
+};
+}  // namespace tree
+}  // namespace xgboost
+#endif  // XGBOOST_TREE_LEAF_POSITION_H_
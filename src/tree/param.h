@@ -51,6 +51,13 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   // whether we want to do subsample
   // 行采样
   float subsample;
+  // how the rows of a tree are sampled
+  enum SamplingMethod { kUniformSampling = 0, kGOSS = 1 };
+  int sampling_method;
+  // fraction of the rows with the largest gradients kept by goss
+  float goss_top_rate;
+  // fraction of the rows sampled from the others by goss
+  float goss_other_rate;
   // whether to subsample columns each split, in each level
   float colsample_bylevel;
   // whether to subsample columns during tree construction
@@ -61,10 +68,18 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   float sketch_eps;
   // accuracy of sketch
   float sketch_ratio;
+  // number of trees the global proposal of the root is reused for
+  int max_proposal_reuse;
+  // whether the histograms are allreduced in single precision
+  bool hist_allreduce_float;
+  // whether only the bins non empty on some worker are allreduced
+  bool hist_allreduce_sparse;
   // leaf vector size
   int size_leaf_vector;
   // option for parallelization
   int parallel_option;
+  // whether the sums of the statistics do not depend on the number of threads
+  bool deterministic_reduction;
   // option to open cacheline optimization
   bool cache_opt;
   // whether to not print info during training.
@@ -77,6 +92,18 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   int gpu_id;
   // number of GPUs to use
   int n_gpus;
+  // rows per page of the quantized matrix in gpu_hist, 0 keeps it on device
+  int gpu_page_rows;
+  // whether gpu_hist computes the quantile sketch on the devices
+  bool gpu_sketch;
+  // number of candidates expanded together by gpu_hist in lossguide mode
+  int gpu_lossguide_batch;
+  // whether the GPU updaters allocate their large buffers in managed memory
+  bool gpu_managed_memory;
+  // whether gpu_hist builds the histograms of a block in shared memory
+  bool gpu_shared_memory_histogram;
+  // whether gpu_hist sums the gradients in fixed point
+  bool gpu_quantized_histogram;
   // declare the parameters
   DMLC_DECLARE_PARAMETER(TrainParam) {
     DMLC_DECLARE_FIELD(learning_rate)
@@ -137,6 +164,22 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
         .set_range(0.0f, 1.0f)
         .set_default(1.0f)
         .describe("Row subsample ratio of training instance.");
+    DMLC_DECLARE_FIELD(sampling_method)
+        .set_default(kUniformSampling)
+        .add_enum("uniform", kUniformSampling)
+        .add_enum("goss", kGOSS)
+        .describe("Row sampling of the hist and gpu_hist tree methods. uniform keeps "
+                  "each row with probability subsample, goss keeps the rows with the "
+                  "largest absolute gradients and reweights a random part of the others.");
+    DMLC_DECLARE_FIELD(goss_top_rate)
+        .set_range(0.0f, 1.0f)
+        .set_default(0.2f)
+        .describe("Fraction of the rows with the largest absolute gradients that goss keeps.");
+    DMLC_DECLARE_FIELD(goss_other_rate)
+        .set_range(0.0f, 1.0f)
+        .set_default(0.1f)
+        .describe("Fraction of all the rows that goss samples from the other rows, their "
+                  "gradients are scaled by (1 - goss_top_rate) / goss_other_rate.");
     DMLC_DECLARE_FIELD(colsample_bylevel)
         .set_range(0.0f, 1.0f)
         .set_default(1.0f)
@@ -157,13 +200,38 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
         .set_lower_bound(0.0f)
         .set_default(2.0f)
         .describe("EXP Param: Sketch accuracy related parameter of approximate algorithm.");
+    DMLC_DECLARE_FIELD(max_proposal_reuse)
+        .set_lower_bound(0)
+        .set_default(0)
+        .describe("EXP Param: Number of following trees the global proposal of the "
+                  "root is reused for by grow_histmaker, 0 sketches it for every tree. "
+                  "It is sketched again earlier when the share of the hessian in a "
+                  "bin moves by more than sketch_eps.");
+    DMLC_DECLARE_FIELD(hist_allreduce_float)
+        .set_default(false)
+        .describe("EXP Param: Allreduce the gradient histograms in single precision, "
+                  "which halves the traffic at the cost of rounding errors. Used by "
+                  "grow_histmaker and gpu_hist.");
+    DMLC_DECLARE_FIELD(hist_allreduce_sparse)
+        .set_default(false)
+        .describe("EXP Param: Allreduce the gradient histograms of grow_histmaker "
+                  "as a bitmap of the bins that are non empty on some worker, "
+                  "followed by the sums of those bins only.");
     DMLC_DECLARE_FIELD(size_leaf_vector)
         .set_lower_bound(0)
         .set_default(0)
         .describe("Size of leaf vectors, reserved for vector trees");
     DMLC_DECLARE_FIELD(parallel_option)
         .set_default(0)
-        .describe("Different types of parallelization algorithm.");
+        .describe("Different types of parallelization algorithm: 0 over the "
+                  "features, 1 within each feature, 2 by a cost model that "
+                  "splits the largest features and packs the others.");
+    DMLC_DECLARE_FIELD(deterministic_reduction)
+        .set_default(false)
+        .describe("Sum the gradient statistics in an order that does not depend on "
+                  "the number of threads, so that the trees are the same bit for bit "
+                  "on any machine. The histograms are built by fixed blocks of rows "
+                  "and the exact method does not split a feature among the threads.");
     DMLC_DECLARE_FIELD(cache_opt)
         .set_default(true)
         .describe("EXP Param: Cache aware optimization.");
@@ -184,6 +252,43 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
         .set_lower_bound(-1)
         .set_default(1)
         .describe("Number of GPUs to use for multi-gpu algorithms: -1=use all GPUs");
+    DMLC_DECLARE_FIELD(gpu_page_rows)
+        .set_lower_bound(0)
+        .set_default(0)
+        .describe("EXP Param: Number of rows per page of the quantized matrix "
+                  "in gpu_hist. When a device has more rows, its compressed "
+                  "matrix stays in pinned host memory and is streamed to the "
+                  "device page by page; 0 keeps the whole matrix on device.");
+    DMLC_DECLARE_FIELD(gpu_sketch)
+        .set_default(false)
+        .describe("EXP Param: Compute the quantile sketch of gpu_hist on the "
+                  "devices instead of the host cores.");
+    DMLC_DECLARE_FIELD(gpu_lossguide_batch)
+        .set_lower_bound(1)
+        .set_default(1)
+        .describe("EXP Param: Number of the best candidates that gpu_hist "
+                  "expands together with grow_policy=lossguide. Batches "
+                  "above 1 save kernel launches and copies, but may grow a "
+                  "different tree than strict best first expansion.");
+    DMLC_DECLARE_FIELD(gpu_managed_memory)
+        .set_default(false)
+        .describe("EXP Param: Allocate the quantized matrix, gradients and "
+                  "positions of gpu_hist in CUDA managed memory, so a device "
+                  "with on demand paging may train on slightly more data than "
+                  "fits in its memory.");
+    DMLC_DECLARE_FIELD(gpu_shared_memory_histogram)
+        .set_default(false)
+        .describe("EXP Param: Let every block of the gpu_hist histogram kernel "
+                  "sum its rows into a histogram in shared memory, added to the "
+                  "node once, when the bins fit in the shared memory of a block. "
+                  "It saves the contention of the global atomics on features with "
+                  "few bins.");
+    DMLC_DECLARE_FIELD(gpu_quantized_histogram)
+        .set_default(false)
+        .describe("EXP Param: Sum the gradients of the gpu_hist histograms as 64 "
+                  "bit fixed point numbers, with a scale chosen for each iteration "
+                  "from the largest gradient, so that the integer atomics give the "
+                  "same histograms on every run.");
     // add alias of parameters
     DMLC_DECLARE_ALIAS(reg_lambda, lambda);
     DMLC_DECLARE_ALIAS(reg_alpha, alpha);
@@ -4,6 +4,9 @@
  * \brief model structure for tree
  */
 #include <xgboost/tree_model.h>
+#include <functional>
+#include <iomanip>
+#include <limits>
 #include <sstream>
 #include "./param.h"
 
@@ -140,10 +143,102 @@ void DumpRegTree(std::stringstream& fo,  // NOLINT(*)
   }
 }
 
+// internal function to dump regression tree as C source,
+// the child with larger cover is placed on the likely branch
+void DumpRegTreeCode(std::stringstream& fo,  // NOLINT(*)
+                     const RegTree& tree,
+                     int nid, int depth, bool with_stats) {
+  for (int i = 0; i < depth + 1; ++i) fo << "  ";
+  if (tree[nid].is_leaf()) {
+    fo << "return " << tree[nid].leaf_value() << "f;";
+    if (with_stats) {
+      fo << "  /* cover=" << tree.stat(nid).sum_hess << " */";
+    }
+    fo << '\n';
+    return;
+  }
+  const unsigned split_index = tree[nid].split_index();
+  const int cleft = tree[nid].cleft(), cright = tree[nid].cright();
+  const bool left_first = tree.stat(cleft).sum_hess >= tree.stat(cright).sum_hess;
+  fo << "if (XGB_LIKELY(" << (left_first ? "" : "!")
+     << "(XGB_ISNAN(f[" << split_index << "]) ? "
+     << (tree[nid].default_left() ? 1 : 0)
+     << " : f[" << split_index << "] < " << tree[nid].split_cond() << "f))) {";
+  if (with_stats) {
+    fo << "  /* gain=" << tree.stat(nid).loss_chg
+       << ", cover=" << tree.stat(nid).sum_hess << " */";
+  }
+  fo << '\n';
+  DumpRegTreeCode(fo, tree, left_first ? cleft : cright, depth + 1, with_stats);
+  for (int i = 0; i < depth + 1; ++i) fo << "  ";
+  fo << "} else {\n";
+  DumpRegTreeCode(fo, tree, left_first ? cright : cleft, depth + 1, with_stats);
+  for (int i = 0; i < depth + 1; ++i) fo << "  ";
+  fo << "}\n";
+}
+
+// internal function to dump regression tree as json arrays indexed by node id,
+// the deleted nodes are written as leaves of value 0
+void DumpRegTreeArrays(std::stringstream& fo,  // NOLINT(*)
+                       const RegTree& tree, bool with_stats) {
+  const int nnode = tree.param.num_nodes;
+  auto write_array = [&](const char* name, std::function<void(int)> write_node) {
+    fo << ", \"" << name << "\": [";
+    for (int nid = 0; nid < nnode; ++nid) {
+      if (nid != 0) fo << ", ";
+      write_node(nid);
+    }
+    fo << "]";
+  };
+  auto is_split = [&](int nid) {
+    return !tree[nid].is_deleted() && !tree[nid].is_leaf();
+  };
+  fo << "{ \"num_roots\": " << tree.param.num_roots
+     << ", \"num_nodes\": " << nnode;
+  write_array("left_children", [&](int nid) {
+    fo << (is_split(nid) ? tree[nid].cleft() : -1);
+  });
+  write_array("right_children", [&](int nid) {
+    fo << (is_split(nid) ? tree[nid].cright() : -1);
+  });
+  write_array("default_left", [&](int nid) {
+    fo << (is_split(nid) && tree[nid].default_left() ? 1 : 0);
+  });
+  write_array("split_indices", [&](int nid) {
+    fo << (is_split(nid) ? tree[nid].split_index() : 0U);
+  });
+  // the split condition of a split, the value of a leaf
+  write_array("split_conditions", [&](int nid) {
+    if (tree[nid].is_deleted()) {
+      fo << 0;
+    } else {
+      fo << (tree[nid].is_leaf() ? tree[nid].leaf_value() : tree[nid].split_cond());
+    }
+  });
+  if (with_stats) {
+    write_array("loss_changes", [&](int nid) { fo << tree.stat(nid).loss_chg; });
+    write_array("sum_hessians", [&](int nid) { fo << tree.stat(nid).sum_hess; });
+  }
+  fo << " }";
+}
+
 std::string RegTree::DumpModel(const FeatureMap& fmap,
                                bool with_stats,
                                std::string format) const {
   std::stringstream fo("");
+  if (format == "c") {
+    CHECK_EQ(param.num_roots, 1)
+        << "C source dump does not support trees with multiple roots";
+    fo << std::scientific
+       << std::setprecision(std::numeric_limits<bst_float>::max_digits10);
+    DumpRegTreeCode(fo, *this, 0, 0, with_stats);
+    return fo.str();
+  }
+  if (format == "json_compact") {
+    fo << std::setprecision(std::numeric_limits<bst_float>::max_digits10);
+    DumpRegTreeArrays(fo, *this, with_stats);
+    return fo.str();
+  }
   for (int i = 0; i < param.num_roots; ++i) {
     DumpRegTree(fo, *this, fmap, i, 0, false, with_stats, format);
   }
@@ -27,6 +27,7 @@ TreeUpdater* TreeUpdater::Create(const std::string& name) {
 namespace xgboost {
 namespace tree {
 // List of files that will be force linked in static links.
+#if !XGBOOST_PREDICT_ONLY
 DMLC_REGISTRY_LINK_TAG(updater_colmaker);
 DMLC_REGISTRY_LINK_TAG(updater_skmaker);
 DMLC_REGISTRY_LINK_TAG(updater_refresh);
@@ -38,5 +39,6 @@ DMLC_REGISTRY_LINK_TAG(updater_sync);
 DMLC_REGISTRY_LINK_TAG(updater_gpu);
 DMLC_REGISTRY_LINK_TAG(updater_gpu_hist);
 #endif
+#endif  // !XGBOOST_PREDICT_ONLY
 }  // namespace tree
 }  // namespace xgboost
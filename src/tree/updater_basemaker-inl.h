@@ -15,6 +15,7 @@
 #include <limits>
 #include <utility>
 #include "./param.h"
+#include "./leaf_position.h"
 #include "../common/sync.h"
 #include "../common/io.h"
 #include "../common/random.h"
@@ -32,6 +33,11 @@ class BaseMaker: public TreeUpdater {
     param.InitAllowUnknown(args);
   }
 
+  bool UpdatePredictionCache(const DMatrix* data,
+                             HostDeviceVector<bst_float>* out_preds) override {
+    return leaf_position_.AddLeafValues(data, out_preds);
+  }
+
  protected:
   // helper to collect and query feature meta information
   struct FMetaHelper {
@@ -475,6 +481,8 @@ class BaseMaker: public TreeUpdater {
    *   see also Decode/EncodePosition
    */
   std::vector<int> position;
+  /*! \brief leaf of each instance in the last tree, set by the makers keeping position up to date */
+  LeafPosition leaf_position_;
 
  private:
   inline void UpdateNode2WorkIndex(const RegTree &tree) {
@@ -8,7 +8,10 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <memory>
 #include "./param.h"
+#include "./leaf_position.h"
+#include "../common/arena.h"
 #include "../common/random.h"
 #include "../common/bitmap.h"
 #include "../common/sync.h"
@@ -37,14 +40,22 @@ class ColMaker: public TreeUpdater {
     std::cout << "ColMaker::trees.size() = " << trees.size() << std::endl;
     param.learning_rate = lr / trees.size();
     TConstraint::Init(&param, dmat->info().num_col);
-    // build tree
+    // build tree, the builder keeps its buffers across the trees
+    if (!builder_) {
+      builder_.reset(new Builder(param));
+    }
     for (size_t i = 0; i < trees.size(); ++i) {
-      Builder builder(param);
-      builder.Update(gpair->data_h(), dmat, trees[i]);
+      builder_->Update(gpair->const_data_h(), dmat, trees[i]);
     }
+    leaf_position_.Set(dmat, gpair->const_data_h(), param, trees.back(), &builder_->Position());
     param.learning_rate = lr;
   }
 
+  bool UpdatePredictionCache(const DMatrix* data,
+                             HostDeviceVector<bst_float>* out_preds) override {
+    return leaf_position_.AddLeafValues(data, out_preds);
+  }
+
  protected:
   // training parameter
   TrainParam param;
@@ -86,16 +97,19 @@ class ColMaker: public TreeUpdater {
   struct Builder {
    public:
     // constructor
-    explicit Builder(const TrainParam& param) : param(param), nthread(omp_get_max_threads()) {}
+    explicit Builder(const TrainParam& param)
+        : param(param), nthread(omp_get_max_threads()), live_cached_(false), live_rows_(0) {}
     // update one tree, growing
     virtual void Update(const std::vector<bst_gpair>& gpair,
                         DMatrix* p_fmat,
                         RegTree* p_tree) {
       this->InitData(gpair, *p_fmat, *p_tree);
+      this->CompactColumns(p_fmat);
       this->InitNewNode(qexpand_, gpair, *p_fmat, *p_tree);
       for (int depth = 0; depth < param.max_depth; ++depth) {
         this->FindSplit(depth, qexpand_, gpair, p_fmat, p_tree);
         this->ResetPosition(qexpand_, p_fmat, *p_tree);
+        this->CompactColumns(p_fmat);
         this->UpdateQueueExpand(*p_tree, &qexpand_);
         this->InitNewNode(qexpand_, gpair, *p_fmat, *p_tree);
         // if nothing left to be expand, break
@@ -114,6 +128,10 @@ class ColMaker: public TreeUpdater {
         snode[nid].stats.SetLeafVec(param, p_tree->leafvec(nid));
       }
     }
+    // the node each row ends in, see also DecodePosition
+    inline const std::vector<int>& Position() const {
+      return position;
+    }
 
    protected:
     // initialize temp data structure
@@ -159,6 +177,7 @@ class ColMaker: public TreeUpdater {
       {
         // initialize feature index
         unsigned ncol = static_cast<unsigned>(fmat.info().num_col);
+        feat_index.clear();
         std::cout << "Builder::InitData::ncol = " << ncol << std::endl;
         for (unsigned i = 0; i < ncol; ++i) {
           if (fmat.GetColSize(i) != 0) {
@@ -176,12 +195,19 @@ class ColMaker: public TreeUpdater {
       {
         // setup temp space for each thread
         // reserve a small space
-        stemp.clear();
-        stemp.resize(this->nthread, std::vector<ThreadEntry>());
+        // the buffers of the previous tree are kept with their capacity
+        stemp.resize(this->nthread);
         for (size_t i = 0; i < stemp.size(); ++i) {
           stemp[i].clear(); stemp[i].reserve(256);
         }
+        snode.clear();
         snode.reserve(256);
+        constraints_.clear();
+      }
+      {
+        // the columns of the previous tree are no longer compacted
+        live_cached_ = false;
+        live_rows_ = rowset.size();
       }
       {
         // expand query
@@ -217,7 +243,8 @@ class ColMaker: public TreeUpdater {
       // setup position
       const bst_omp_uint ndata = static_cast<bst_omp_uint>(rowset.size());
       // 并行将每个节点划分到各个叶子节点上, 累积一阶导和二阶导
-      #pragma omp parallel for schedule(static)
+      // a single thread sums the rows in order for deterministic reductions
+      #pragma omp parallel for schedule(static) if (!param.deterministic_reduction)
       for (bst_omp_uint i = 0; i < ndata; ++i) {
         const bst_uint ridx = rowset[i];
         const int tid = omp_get_thread_num();
@@ -277,7 +304,7 @@ class ColMaker: public TreeUpdater {
                                   const std::vector<bst_gpair> &gpair) {
       // TODO(tqchen): double check stats order.
       const MetaInfo& info = fmat.info();
-      const bool ind = col.length != 0 && col.data[0].fvalue == col.data[col.length - 1].fvalue;
+      const bool ind = this->IsIndicator(fid, col);
       bool need_forward = param.need_forward_search(fmat.GetColDensity(fid), ind);
       bool need_backward = param.need_backward_search(fmat.GetColDensity(fid), ind);
       const std::vector<int> &qexpand = qexpand_;
@@ -634,15 +661,19 @@ class ColMaker: public TreeUpdater {
     virtual void UpdateSolution(const ColBatch& batch,
                                 const std::vector<bst_gpair>& gpair,
                                 const DMatrix& fmat) {
-      const MetaInfo& info = fmat.info();
       // start enumeration
       const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
       #if defined(_OPENMP)
       const int batch_size = std::max(static_cast<int>(nsize / this->nthread / 32), 1);
       #endif
       int poption = param.parallel_option;
+      // the statistics of a feature split among the threads depend on their number
+      if (param.deterministic_reduction && poption == 1) {
+        poption = 0;
+      }
       if (poption == 2) {
-        poption = static_cast<int>(nsize) * 2 < this->nthread ? 1 : 0;
+        this->UpdateSolutionBalanced(batch, gpair, fmat);
+        return;
       }
       if (poption == 0) {
         std::cout << "poption = 0" << std::endl;
@@ -650,19 +681,8 @@ class ColMaker: public TreeUpdater {
         // 每个线程处理一维特征，遍历数据累计统计量(grad/hess)得到最佳分裂点split_point
         #pragma omp parallel for schedule(dynamic, batch_size)
         for (bst_omp_uint i = 0; i < nsize; ++i) {
-          // feature id
-          const bst_uint fid = batch.col_index[i];
           const int tid = omp_get_thread_num();
-          const ColBatch::Inst c = batch[i];
-          const bool ind = c.length != 0 && c.data[0].fvalue == c.data[c.length - 1].fvalue;
-          if (param.need_forward_search(fmat.GetColDensity(fid), ind)) {
-            this->EnumerateSplit(c.data, c.data + c.length, +1,
-                                 fid, gpair, info, stemp[tid]);
-          }
-          if (param.need_backward_search(fmat.GetColDensity(fid), ind)) {
-            this->EnumerateSplit(c.data + c.length - 1, c.data - 1, -1,
-                                 fid, gpair, info, stemp[tid]);
-          }
+          this->EnumerateColumn(batch[i], batch.col_index[i], gpair, fmat, stemp[tid]);
         }
       } else {
         //特征内并行方式
@@ -675,6 +695,84 @@ class ColMaker: public TreeUpdater {
         }
       }
     }
+    // enumerate the splits of one column in the needed directions
+    inline void EnumerateColumn(const ColBatch::Inst &c,
+                                bst_uint fid,
+                                const std::vector<bst_gpair> &gpair,
+                                const DMatrix &fmat,
+                                std::vector<ThreadEntry> &temp) {  // NOLINT(*)
+      const bool ind = this->IsIndicator(fid, c);
+      if (param.need_forward_search(fmat.GetColDensity(fid), ind)) {
+        this->EnumerateSplit(c.data, c.data + c.length, +1,
+                             fid, gpair, fmat.info(), temp);
+      }
+      if (param.need_backward_search(fmat.GetColDensity(fid), ind)) {
+        this->EnumerateSplit(c.data + c.length - 1, c.data - 1, -1,
+                             fid, gpair, fmat.info(), temp);
+      }
+    }
+    // schedule the columns by their cost, the number of entries scanned.
+    // A column costing more than the share of one thread is split among
+    // the threads, the others are packed into tasks of similar cost, the
+    // most expensive ones first, that the threads take dynamically.
+    inline void UpdateSolutionBalanced(const ColBatch& batch,
+                                       const std::vector<bst_gpair>& gpair,
+                                       const DMatrix& fmat) {
+      // a column split among the threads has at least that many entries per thread
+      const size_t kMinThreadEntries = 1024;
+      // number of tasks per thread for the other columns
+      const size_t kTasksPerThread = 16;
+      const size_t nsize = batch.size;
+      const size_t nthread = static_cast<size_t>(this->nthread);
+      common::Arena::Scope scope(&arena_);
+      common::ArenaVector<size_t> cost = common::MakeArenaVector<size_t>(&arena_, nsize);
+      size_t total_cost = 0;
+      for (size_t i = 0; i < nsize; ++i) {
+        const bst_uint fid = batch.col_index[i];
+        const bool ind = this->IsIndicator(fid, batch[i]);
+        const size_t ndir =
+            static_cast<size_t>(param.need_forward_search(fmat.GetColDensity(fid), ind)) +
+            static_cast<size_t>(param.need_backward_search(fmat.GetColDensity(fid), ind));
+        cost[i] = batch[i].length * ndir;
+        total_cost += cost[i];
+      }
+      common::ArenaVector<size_t> light = common::MakeArenaVector<size_t>(&arena_);
+      light.reserve(nsize);
+      for (size_t i = 0; i < nsize; ++i) {
+        if (nthread > 1 && cost[i] * nthread > total_cost &&
+            batch[i].length >= kMinThreadEntries * nthread &&
+            !param.deterministic_reduction) {
+          this->ParallelFindSplit(batch[i], batch.col_index[i], fmat, gpair);
+        } else {
+          light.push_back(i);
+        }
+      }
+      std::stable_sort(light.begin(), light.end(), [&cost](size_t a, size_t b) {
+          return cost[a] > cost[b];
+        });
+      // task k is the columns light[task_ptr[k], task_ptr[k + 1])
+      const size_t task_cost = std::max(total_cost / (nthread * kTasksPerThread),
+                                        static_cast<size_t>(1));
+      common::ArenaVector<size_t> task_ptr = common::MakeArenaVector<size_t>(&arena_, 1, 0);
+      size_t acc = 0;
+      for (size_t j = 0; j < light.size(); ++j) {
+        acc += cost[light[j]];
+        if (acc >= task_cost) {
+          task_ptr.push_back(j + 1);
+          acc = 0;
+        }
+      }
+      if (task_ptr.back() != light.size()) task_ptr.push_back(light.size());
+      const bst_omp_uint ntask = static_cast<bst_omp_uint>(task_ptr.size() - 1);
+      #pragma omp parallel for schedule(dynamic, 1)
+      for (bst_omp_uint k = 0; k < ntask; ++k) {
+        const int tid = omp_get_thread_num();
+        for (size_t j = task_ptr[k]; j < task_ptr[k + 1]; ++j) {
+          this->EnumerateColumn(batch[light[j]], batch.col_index[light[j]], gpair, fmat,
+                                stemp[tid]);
+        }
+      }
+    }
     // find splits at current level, do split per level
     inline void FindSplit(int depth,
                           const std::vector<int> &qexpand,
@@ -691,12 +789,18 @@ class ColMaker: public TreeUpdater {
         feat_set.resize(n);
       }
       std::cout << "Builder::FindSplit::feat_set.size = " << feat_set.size() << std::endl;
-      dmlc::DataIter<ColBatch>* iter = p_fmat->ColIterator(feat_set);
-      while (iter->Next()) {
-        std::cout << "Builder::FindSplit::ColBatch::size = " << iter->Value().size << std::endl;
-        std::cout << "Builder::FindSplit::ColBatch::col_data->length = " << iter->Value().col_data->length<< std::endl;
-        // 找到分裂点,有两种并行方式
-        this->UpdateSolution(iter->Value(), gpair, *p_fmat);
+      if (live_cached_) {
+        common::Arena::Scope scope(&arena_);
+        common::ArenaVector<ColBatch::Inst> cols = common::MakeArenaVector<ColBatch::Inst>(&arena_);
+        this->UpdateSolution(this->LiveColumns(feat_set, &cols), gpair, *p_fmat);
+      } else {
+        dmlc::DataIter<ColBatch>* iter = p_fmat->ColIterator(feat_set);
+        while (iter->Next()) {
+          std::cout << "Builder::FindSplit::ColBatch::size = " << iter->Value().size << std::endl;
+          std::cout << "Builder::FindSplit::ColBatch::col_data->length = " << iter->Value().col_data->length<< std::endl;
+          // 找到分裂点,有两种并行方式
+          this->UpdateSolution(iter->Value(), gpair, *p_fmat);
+        }
       }
       // after this each thread's stemp will get the best candidates, aggregate results
       this->SyncBestSolution(qexpand);
@@ -775,30 +879,128 @@ class ColMaker: public TreeUpdater {
       // 当前数据已经前一次分裂的节点上，所以这一次只需要往下走一层
       std::sort(fsplits.begin(), fsplits.end());
       fsplits.resize(std::unique(fsplits.begin(), fsplits.end()) - fsplits.begin());
+      if (live_cached_) {
+        // the rows left out of the live columns are finished or sampled out,
+        // their position is not used any more
+        common::Arena::Scope scope(&arena_);
+        common::ArenaVector<ColBatch::Inst> cols = common::MakeArenaVector<ColBatch::Inst>(&arena_);
+        this->SetNonDefaultPositionBatch(this->LiveColumns(fsplits, &cols), tree);
+        return;
+      }
       dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator(fsplits);
       while (iter->Next()) {
-        const ColBatch &batch = iter->Value();
-        for (size_t i = 0; i < batch.size; ++i) {
-          ColBatch::Inst col = batch[i];
-          const bst_uint fid = batch.col_index[i];
-          const bst_omp_uint ndata = static_cast<bst_omp_uint>(col.length);
-          #pragma omp parallel for schedule(static)
-          for (bst_omp_uint j = 0; j < ndata; ++j) {
-            const bst_uint ridx = col[j].index;
-            const int nid = this->DecodePosition(ridx);
-            const bst_float fvalue = col[j].fvalue;
-            // go back to parent, correct those who are not default
-            if (!tree[nid].is_leaf() && tree[nid].split_index() == fid) {
-              if (fvalue < tree[nid].split_cond()) {
-                this->SetEncodePosition(ridx, tree[nid].cleft());
-              } else {
-                this->SetEncodePosition(ridx, tree[nid].cright());
-              }
+        this->SetNonDefaultPositionBatch(iter->Value(), tree);
+      }
+    }
+    inline void SetNonDefaultPositionBatch(const ColBatch &batch, const RegTree &tree) {
+      for (size_t i = 0; i < batch.size; ++i) {
+        ColBatch::Inst col = batch[i];
+        const bst_uint fid = batch.col_index[i];
+        const bst_omp_uint ndata = static_cast<bst_omp_uint>(col.length);
+        #pragma omp parallel for schedule(static)
+        for (bst_omp_uint j = 0; j < ndata; ++j) {
+          const bst_uint ridx = col[j].index;
+          const int nid = this->DecodePosition(ridx);
+          const bst_float fvalue = col[j].fvalue;
+          // go back to parent, correct those who are not default
+          if (!tree[nid].is_leaf() && tree[nid].split_index() == fid) {
+            if (fvalue < tree[nid].split_cond()) {
+              this->SetEncodePosition(ridx, tree[nid].cleft());
+            } else {
+              this->SetEncodePosition(ridx, tree[nid].cright());
             }
           }
         }
       }
     }
+    // compact the columns of feat_index to the entries of the live rows, once
+    // at most half of the rows live at the last compaction are left. Later
+    // levels then only scan the live entries. Only in memory columns are
+    // compacted, the copy is at most half of their size.
+    inline void CompactColumns(DMatrix *p_fmat) {
+      if (!p_fmat->SingleColBlock()) return;
+      const RowSet &rowset = p_fmat->buffered_rowset();
+      const bst_omp_uint ndata = static_cast<bst_omp_uint>(rowset.size());
+      size_t nlive = 0;
+      #pragma omp parallel for schedule(static) reduction(+:nlive)
+      for (bst_omp_uint i = 0; i < ndata; ++i) {
+        if (position[rowset[i]] >= 0) ++nlive;
+      }
+      if (nlive * 2 > live_rows_) return;
+      live_rows_ = nlive;
+
+      const size_t ncol = p_fmat->info().num_col;
+      common::Arena::Scope scope(&arena_);
+      common::ArenaVector<ColBatch::Inst> src = common::MakeArenaVector<ColBatch::Inst>(&arena_);
+      if (live_cached_) {
+        this->LiveColumns(feat_index, &src);
+      } else {
+        // the first compaction reads the columns of the DMatrix, whose
+        // indicator flags are kept as they do not depend on the rows
+        src.resize(feat_index.size());
+        live_col_.resize(ncol);
+        live_indicator_.resize(ncol);
+        dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator(feat_index);
+        while (iter->Next()) {
+          const ColBatch &batch = iter->Value();
+          for (size_t i = 0; i < batch.size; ++i) {
+            live_col_[batch.col_index[i]] = batch[i];
+          }
+        }
+        for (size_t j = 0; j < feat_index.size(); ++j) {
+          src[j] = live_col_[feat_index[j]];
+          live_indicator_[feat_index[j]] = src[j].length != 0 &&
+              src[j].data[0].fvalue == src[j].data[src[j].length - 1].fvalue;
+        }
+      }
+      const bst_omp_uint nfeature = static_cast<bst_omp_uint>(src.size());
+      common::ArenaVector<size_t> col_ptr = common::MakeArenaVector<size_t>(&arena_, nfeature + 1, 0);
+      #pragma omp parallel for schedule(dynamic)
+      for (bst_omp_uint j = 0; j < nfeature; ++j) {
+        size_t cnt = 0;
+        for (bst_uint k = 0; k < src[j].length; ++k) {
+          if (position[src[j][k].index] >= 0) ++cnt;
+        }
+        col_ptr[j + 1] = cnt;
+      }
+      for (bst_omp_uint j = 0; j < nfeature; ++j) {
+        col_ptr[j + 1] += col_ptr[j];
+      }
+      live_buffer_.resize(col_ptr[nfeature]);
+      #pragma omp parallel for schedule(dynamic)
+      for (bst_omp_uint j = 0; j < nfeature; ++j) {
+        ColBatch::Entry *out = dmlc::BeginPtr(live_buffer_) + col_ptr[j];
+        for (bst_uint k = 0; k < src[j].length; ++k) {
+          if (position[src[j][k].index] >= 0) *out++ = src[j][k];
+        }
+      }
+      live_data_.swap(live_buffer_);
+      for (bst_omp_uint j = 0; j < nfeature; ++j) {
+        live_col_[feat_index[j]] = ColBatch::Inst(
+            dmlc::BeginPtr(live_data_) + col_ptr[j],
+            static_cast<bst_uint>(col_ptr[j + 1] - col_ptr[j]));
+      }
+      live_cached_ = true;
+    }
+    // batch over the live columns of the features in fset, cols keeps the columns
+    inline ColBatch LiveColumns(const std::vector<bst_uint> &fset,
+                                common::ArenaVector<ColBatch::Inst> *cols) const {
+      cols->resize(fset.size());
+      for (size_t i = 0; i < fset.size(); ++i) {
+        (*cols)[i] = live_col_[fset[i]];
+      }
+      ColBatch batch;
+      batch.size = fset.size();
+      batch.col_index = dmlc::BeginPtr(fset);
+      batch.col_data = cols->data();
+      return batch;
+    }
+    // whether all the values of column fid are the same,
+    // a compacted column is judged on all its rows
+    inline bool IsIndicator(bst_uint fid, const ColBatch::Inst &col) const {
+      if (live_cached_) return live_indicator_[fid] != 0;
+      return col.length != 0 && col.data[0].fvalue == col.data[col.length - 1].fvalue;
+    }
     // utils to get/set position, with encoded format
     // return decoded position
     inline int DecodePosition(bst_uint ridx) const {
@@ -836,7 +1038,23 @@ class ColMaker: public TreeUpdater {
     // constraint value
     // 大小为当前节点数目
     std::vector<TConstraint> constraints_;
+    // whether live_col_ holds the compacted columns of feat_index
+    bool live_cached_;
+    // number of live rows at the last compaction
+    size_t live_rows_;
+    // per feature: the entries of the live rows, in live_data_
+    std::vector<ColBatch::Inst> live_col_;
+    // per feature: whether all the values of the full column are the same
+    std::vector<char> live_indicator_;
+    // storage of the compacted columns, and the one of the next compaction
+    std::vector<ColBatch::Entry> live_data_, live_buffer_;
+    // scratch of the levels, kept across the trees
+    common::Arena arena_;
   };
+  // builder reused by the trees
+  std::unique_ptr<Builder> builder_;
+  // leaf of each row in the last tree
+  LeafPosition leaf_position_;
 };
 
 // distributed column maker
@@ -856,7 +1074,7 @@ class DistColMaker : public ColMaker<TStats, TConstraint> {
     TStats::CheckInfo(dmat->info());
     CHECK_EQ(trees.size(), 1U) << "DistColMaker: only support one tree at a time";
     // build the tree
-    builder.Update(gpair->data_h(), dmat, trees[0]);
+    builder.Update(gpair->const_data_h(), dmat, trees[0]);
     //// prune the tree, note that pruner will sync the tree
     pruner->Update(gpair, dmat, trees);
     // update position after the tree is pruned
@@ -1020,6 +1238,11 @@ class TreeUpdaterSwitch : public TreeUpdater {
     inner_->Update(gpair, data, trees);
   }
 
+  bool UpdatePredictionCache(const DMatrix* data,
+                             HostDeviceVector<bst_float>* out_preds) override {
+    return inner_ != nullptr && inner_->UpdatePredictionCache(data, out_preds);
+  }
+
  private:
   //  monotone constraints
   bool monotone_;
@@ -4,22 +4,33 @@
  * \brief use quantized feature values to construct a tree
  * \author Philip Cho, Tianqi Checn
  */
-#include <dmlc/timer.h>
 #include <xgboost/tree_updater.h>
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <random>
 #include <queue>
-#include <iomanip>
+#include <set>
 #include <numeric>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
 #include "./param.h"
 #include "./fast_hist_param.h"
+#include "../common/arena.h"
 #include "../common/random.h"
 #include "../common/bitmap.h"
 #include "../common/sync.h"
 #include "../common/hist_util.h"
+#include "../common/timer.h"
 #include "../common/row_set.h"
 #include "../common/column_matrix.h"
+#include "../data/simple_dmatrix.h"
+#include "../data/quantized_source.h"
 
 namespace xgboost {
 namespace tree {
@@ -27,12 +38,12 @@ namespace tree {
 using xgboost::common::HistCutMatrix;
 using xgboost::common::GHistIndexMatrix;
 using xgboost::common::GHistIndexBlockMatrix;
-using xgboost::common::GHistIndexRow;
-using xgboost::common::GHistEntry;
-using xgboost::common::HistCollection;
+using xgboost::common::GHistIndexPagedMatrix;
+using xgboost::common::GHistEntryT;
+using xgboost::common::HistCollectionT;
 using xgboost::common::RowSetCollection;
-using xgboost::common::GHistRow;
-using xgboost::common::GHistBuilder;
+using xgboost::common::GHistRowT;
+using xgboost::common::GHistBuilderT;
 using xgboost::common::ColumnMatrix;
 using xgboost::common::Column;
 
@@ -40,6 +51,32 @@ DMLC_REGISTRY_FILE_TAG(updater_fast_hist);
 
 DMLC_REGISTER_PARAMETER(FastHistParam);
 
+// the quantized training matrix, read by all the instances sharing it
+struct QuantizedData {
+  // data sketch
+  HistCutMatrix hmat;
+  // quantized data matrix
+  GHistIndexMatrix gmat;
+  // (optional) data matrix with feature grouping
+  GHistIndexBlockMatrix gmatb;
+  // column accessor
+  ColumnMatrix column_matrix;
+  // quantized matrix of external memory data, used instead of gmat when paged
+  GHistIndexPagedMatrix gpages;
+  bool paged;
+  bool initialized;
+  // a new one each time the bins are built or extended, unique across the
+  // instances, so that state kept from the previous bins is not reused
+  uint64_t version;
+  // held while the data is built or extended
+  std::mutex mutex;
+  QuantizedData() : paged(false), initialized(false), version(0) {}
+  inline void NewVersion() {
+    static std::atomic<uint64_t> last(0);
+    version = ++last;
+  }
+};
+
 /*! \brief construct a tree using quantized feature values */
 template<typename TStats, typename TConstraint>
 class FastHistMaker: public TreeUpdater {
@@ -52,64 +89,276 @@ class FastHistMaker: public TreeUpdater {
     pruner_->Init(args);
     param.InitAllowUnknown(args);
     fhparam.InitAllowUnknown(args);
-    is_gmat_initialized_ = false;
+#if defined(_OPENMP) && _OPENMP >= 201307
+    if (fhparam.numa_aware && omp_get_proc_bind() == omp_proc_bind_false) {
+      LOG(WARNING) << "numa_aware: the threads are not bound to cores, "
+                   << "set OMP_PROC_BIND=true so that they stay next to their memory";
+    }
+#endif  // _OPENMP
+    monitor_.Init("FastHistMaker", param.debug_verbose > 0);
+    qdata_.reset(new QuantizedData());
+    shared_ = false;
   }
 
   void Update(HostDeviceVector<bst_gpair>* gpair,
               DMatrix* dmat,
               const std::vector<RegTree*>& trees) override {
     TStats::CheckInfo(dmat->info());
-    if (is_gmat_initialized_ == false) {
-      double tstart = dmlc::GetTime();
-      hmat_.Init(dmat, static_cast<uint32_t>(param.max_bin));
-      gmat_.cut = &hmat_;
-      gmat_.Init(dmat);
-      column_matrix_.Init(gmat_, fhparam);
-      if (fhparam.enable_feature_grouping > 0) {
-        gmatb_.Init(gmat_, column_matrix_, fhparam);
-      }
-      is_gmat_initialized_ = true;
-      if (param.debug_verbose > 0) {
-        LOG(INFO) << "Generating gmat: " << dmlc::GetTime() - tstart << " sec";
-      }
-    }
+    this->AttachSharedData(dmat);
+    this->InitQuantizedData(dmat);
     // rescale learning rate according to size of trees
     float lr = param.learning_rate;
     param.learning_rate = lr / trees.size();
     TConstraint::Init(&param, dmat->info().num_col);
     // build tree
-    if (!builder_) {
-      builder_.reset(new Builder(param, fhparam, std::move(pruner_)));
-    }
-    for (size_t i = 0; i < trees.size(); ++i) {
-      builder_->Update
-        (gmat_, gmatb_, column_matrix_, gpair, dmat, trees[i]);
+    if (fhparam.single_precision_histogram) {
+      this->UpdateTrees(&float_builder_, gpair, dmat, trees);
+    } else {
+      this->UpdateTrees(&double_builder_, gpair, dmat, trees);
     }
     param.learning_rate = lr;
   }
 
+  bool ShareWith(TreeUpdater* other) override {
+    auto* maker = dynamic_cast<FastHistMaker*>(other);
+    // the pages of external memory data are read by one iterator
+    if (maker == nullptr || qdata_->paged) return false;
+    maker->qdata_ = qdata_;
+    maker->shared_ = shared_;
+    return true;
+  }
+
   bool UpdatePredictionCache(const DMatrix* data,
                              HostDeviceVector<bst_float>* out_preds) override {
-    if (!builder_ || param.subsample < 1.0f) {
+    if (param.subsample < 1.0f || param.sampling_method == TrainParam::kGOSS) {
       return false;
+    } else if (float_builder_) {
+      return float_builder_->UpdatePredictionCache(data, out_preds);
+    } else if (double_builder_) {
+      return double_builder_->UpdatePredictionCache(data, out_preds);
     } else {
-      return builder_->UpdatePredictionCache(data, out_preds);
+      return false;
     }
   }
 
  protected:
+  // header of the quantized matrix cache, identifies the data it was built for
+  struct QuantizedCacheHeader {
+    uint64_t magic;
+    uint64_t max_bin;
+    uint64_t num_row;
+    uint64_t num_col;
+    uint64_t num_nonzero;
+    // hash of the entries and the weights the cuts are sketched from
+    uint64_t checksum;
+    QuantizedCacheHeader() {}
+    QuantizedCacheHeader(DMatrix* dmat, int max_bin)
+        : magic(kQuantizedCacheMagic), max_bin(max_bin), num_row(dmat->info().num_row),
+          num_col(dmat->info().num_col), num_nonzero(dmat->info().num_nonzero),
+          checksum(Checksum(dmat)) {}
+    inline bool operator==(const QuantizedCacheHeader& other) const {
+      return magic == other.magic && max_bin == other.max_bin &&
+          num_row == other.num_row && num_col == other.num_col &&
+          num_nonzero == other.num_nonzero && checksum == other.checksum;
+    }
+    // 64-bit FNV-1a hash of the rows and the weights of the data
+    static uint64_t Checksum(DMatrix* dmat) {
+      uint64_t h = 14695981039346656037ULL;
+      auto add = [&h](const void* data, size_t n) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < n; ++i) {
+          h ^= bytes[i];
+          h *= 1099511628211ULL;
+        }
+      };
+      dmlc::DataIter<RowBatch>* iter = dmat->RowIterator();
+      iter->BeforeFirst();
+      while (iter->Next()) {
+        const RowBatch& batch = iter->Value();
+        for (size_t i = 0; i < batch.size; ++i) {
+          const uint64_t length = batch.ind_ptr[i + 1] - batch.ind_ptr[i];
+          add(&length, sizeof(length));
+          add(batch.data_ptr + batch.ind_ptr[i], length * sizeof(RowBatch::Entry));
+        }
+      }
+      const std::vector<bst_float>& weights = dmat->info().weights;
+      add(dmlc::BeginPtr(weights), weights.size() * sizeof(bst_float));
+      return h;
+    }
+  };
+  static const uint64_t kQuantizedCacheMagic = 0x58474251434d0002ULL;
+
+  // take the quantized matrix kept with the training matrix, built by the
+  // first updater asking for the same bins
+  inline void AttachSharedData(DMatrix* dmat) {
+    if (!fhparam.share_quantized_data || shared_) return;
+    shared_ = true;
+    // the pages of external memory data are read by one iterator, so the
+    // boosters training at the same time cannot share them
+    dmlc::DataIter<RowBatch>* iter = dmat->RowIterator();
+    iter->BeforeFirst();
+    if (iter->Next() && iter->Value().size < dmat->info().num_row) {
+      LOG(WARNING) << "share_quantized_data is ignored for external memory data";
+      return;
+    }
+    qdata_ = std::static_pointer_cast<QuantizedData>(dmat->DerivedData(
+        this->QuantizedDataKey(), [] { return std::make_shared<QuantizedData>(); }));
+  }
+
+  // the parameters the quantized matrix is built with
+  inline std::string QuantizedDataKey() const {
+    // the ones only read when the trees are built
+    static const std::set<std::string> kTreeOnly = {
+      "single_precision_histogram", "max_cached_hist_node", "contiguous_gradients",
+      "share_quantized_data", "incremental_root_histogram", "root_delta_eps",
+      "root_delta_max_fraction", "node_feature_threshold"};
+    std::ostringstream os;
+    os << "grow_fast_histmaker max_bin=" << param.max_bin;
+    for (const auto& kv : fhparam.__DICT__()) {
+      if (kTreeOnly.count(kv.first) == 0) os << ' ' << kv.first << '=' << kv.second;
+    }
+    return os.str();
+  }
+
+  // build the quantized matrix on the first update, extend it when rows were appended
+  inline void InitQuantizedData(DMatrix* dmat) {
+    std::lock_guard<std::mutex> lock(qdata_->mutex);
+    if (qdata_->initialized == false) {
+      monitor_.Start("InitQuantizedMatrix");
+      qdata_->gmat.cut = &qdata_->hmat;
+      // external memory data come in several row batches
+      dmlc::DataIter<RowBatch>* iter = dmat->RowIterator();
+      iter->BeforeFirst();
+      qdata_->paged = iter->Next() && iter->Value().size < dmat->info().num_row;
+      if (qdata_->paged) {
+        CHECK_NE(fhparam.hist_page_file.length(), 0U)
+            << "tree_method=hist on external memory data needs hist_page_file, "
+            << "the file storing the pages of the quantized matrix";
+        CHECK_EQ(fhparam.enable_feature_grouping, 0)
+            << "feature grouping is not supported for external memory data";
+        qdata_->hmat.Init(dmat, static_cast<uint32_t>(param.max_bin), fhparam.sketch_subsample);
+        qdata_->gpages.cut = &qdata_->hmat;
+        qdata_->gpages.Init(dmat, fhparam.hist_page_file);
+      } else {
+        if (!this->CopyQuantizedSource(dmat)) {
+          const bool cached = fhparam.hist_cache_file.length() != 0;
+          const QuantizedCacheHeader header =
+              cached ? QuantizedCacheHeader(dmat, param.max_bin) : QuantizedCacheHeader();
+          if (!cached || !this->LoadQuantizedMatrix(header, dmat->info())) {
+            qdata_->hmat.Init(dmat, static_cast<uint32_t>(param.max_bin),
+                              fhparam.sketch_subsample);
+            qdata_->gmat.Init(dmat);
+            if (cached) this->SaveQuantizedMatrix(header);
+          }
+        }
+        qdata_->column_matrix.Init(qdata_->gmat, fhparam);
+        if (fhparam.enable_feature_grouping > 0) {
+          qdata_->gmatb.Init(qdata_->gmat, qdata_->column_matrix, fhparam);
+        }
+        // packed once the other matrices are built from it
+        if (fhparam.compressed_bin_index) qdata_->gmat.Compress();
+      }
+      qdata_->initialized = true;
+      qdata_->NewVersion();
+      monitor_.Stop("InitQuantizedMatrix");
+    } else if (!qdata_->paged && qdata_->gmat.row_ptr.size() - 1 < dmat->info().num_row) {
+      // rows were appended to the matrix, they are quantized with the cuts
+      // built before so the bins of the previous rows stay valid.
+      monitor_.Start("AppendQuantizedMatrix");
+      qdata_->gmat.index.Unpack();
+      this->AppendQuantizedRows(dmat);
+      qdata_->column_matrix.Init(qdata_->gmat, fhparam);
+      if (fhparam.enable_feature_grouping > 0) {
+        qdata_->gmatb.Init(qdata_->gmat, qdata_->column_matrix, fhparam);
+      }
+      if (fhparam.compressed_bin_index) qdata_->gmat.Compress();
+      qdata_->NewVersion();
+      monitor_.Stop("AppendQuantizedMatrix");
+    }
+  }
+
+  // take the cuts and the bins of data quantized on ingest, return false
+  // when the data is not quantized or with other bins
+  inline bool CopyQuantizedSource(DMatrix* dmat) {
+    auto* sdmat = dynamic_cast<data::SimpleDMatrix*>(dmat);
+    if (sdmat == nullptr) return false;
+    auto* source = dynamic_cast<const data::QuantizedSource*>(sdmat->source());
+    if (source == nullptr) return false;
+    if (source->max_bin != static_cast<uint32_t>(param.max_bin)) {
+      LOG(WARNING) << "The data was quantized with max_bin=" << source->max_bin
+                   << ", the bins are built again from the quantized values";
+      return false;
+    }
+    qdata_->hmat = source->cut;
+    qdata_->gmat = source->gmat;
+    qdata_->gmat.cut = &qdata_->hmat;
+    return true;
+  }
+
+  // quantize the rows appended after the ones of the quantized matrix
+  inline void AppendQuantizedRows(DMatrix* dmat) {
+    CHECK_LE(dmat->info().num_col, qdata_->hmat.row_ptr.size() - 1)
+        << "tree_method=hist cannot add features once the cuts are built";
+    const size_t nrow = qdata_->gmat.row_ptr.size() - 1;
+    dmlc::DataIter<RowBatch>* iter = dmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const RowBatch& batch = iter->Value();
+      if (batch.base_rowid + batch.size <= nrow) continue;
+      const size_t skip = nrow > batch.base_rowid ? nrow - batch.base_rowid : 0;
+      RowBatch rows = batch;
+      rows.base_rowid += skip;
+      rows.size -= skip;
+      rows.ind_ptr += skip;
+      qdata_->gmat.PushBatch(rows);
+    }
+    CHECK_EQ(qdata_->gmat.row_ptr.size(), dmat->info().num_row + 1);
+  }
+
+  // the cache file of this worker, the workers of distributed training
+  // have their own part of the data
+  inline std::string QuantizedCacheFile() const {
+    const std::string& file = fhparam.hist_cache_file;
+    if (!rabit::IsDistributed()) return file;
+    std::ostringstream os;
+    const size_t pos = file.rfind('.');
+    os << file.substr(0, pos) << ".r" << rabit::GetRank() << "-" << rabit::GetWorldSize();
+    if (pos != std::string::npos) os << file.substr(pos);
+    return os.str();
+  }
+
+  // load the cuts and the quantized matrix from the cache file,
+  // return false when it does not exist or its header is not the one given
+  inline bool LoadQuantizedMatrix(const QuantizedCacheHeader& expected, const MetaInfo& info) {
+    const std::string file = this->QuantizedCacheFile();
+    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(file.c_str(), "r", true));
+    if (fi == nullptr) return false;
+    QuantizedCacheHeader header;
+    if (fi->Read(&header, sizeof(header)) != sizeof(header) || !(header == expected)) {
+      LOG(INFO) << "Ignore " << file << ", it was built for other data";
+      return false;
+    }
+    qdata_->hmat.Load(fi.get());
+    CHECK(qdata_->gmat.Load(fi.get())) << "invalid quantized matrix";
+    CHECK_EQ(qdata_->gmat.row_ptr.size(), info.num_row + 1) << "invalid quantized matrix";
+    return true;
+  }
+
+  inline void SaveQuantizedMatrix(const QuantizedCacheHeader& header) const {
+    std::unique_ptr<dmlc::Stream> fo(
+        dmlc::Stream::Create(this->QuantizedCacheFile().c_str(), "w"));
+    fo->Write(&header, sizeof(header));
+    qdata_->hmat.Save(fo.get());
+    qdata_->gmat.Save(fo.get());
+  }
+
   // training parameter
   TrainParam param;
   FastHistParam fhparam;
-  // data sketch
-  HistCutMatrix hmat_;
-  // quantized data matrix
-  GHistIndexMatrix gmat_;
-  // (optional) data matrix with feature grouping
-  GHistIndexBlockMatrix gmatb_;
-  // column accessor
-  ColumnMatrix column_matrix_;
-  bool is_gmat_initialized_;
+  std::shared_ptr<QuantizedData> qdata_;
+  // whether qdata_ was looked up among the data kept with the training matrix
+  bool shared_;
+  common::Monitor monitor_;
 
   // data structure
   struct NodeEntry {
@@ -126,58 +375,74 @@ class FastHistMaker: public TreeUpdater {
         : stats(param), root_gain(0.0f), weight(0.0f) {
     }
   };
-  // actual builder that runs the algorithm
-
+  // actual builder that runs the algorithm,
+  // the histograms sum the gradients in GradientSumT
+  template <typename GradientSumT>
   struct Builder {
    public:
+    typedef GHistEntryT<GradientSumT> GHistEntry;
+    typedef GHistRowT<GradientSumT> GHistRow;
+    typedef HistCollectionT<GradientSumT> HistCollection;
+    typedef GHistBuilderT<GradientSumT> GHistBuilder;
+
     // constructor
     explicit Builder(const TrainParam& param,
                      const FastHistParam& fhparam,
                      std::unique_ptr<TreeUpdater> pruner)
-      : param(param), fhparam(fhparam), pruner_(std::move(pruner)),
-        p_last_tree_(nullptr), p_last_fmat_(nullptr) {}
+      : param(param), fhparam(fhparam), root_version_(0), root_reuse_(0),
+        pages_(nullptr), data_version_(0), use_node_features_(false), col_split_(false),
+        pruner_(std::move(pruner)), p_last_tree_(nullptr), p_last_fmat_(nullptr) {
+      monitor_.Init("FastHistMaker", param.debug_verbose > 0);
+    }
     // update one tree, growing
+    // pages is the quantized matrix of external memory data, or nullptr
+    // when all of it is in gmat, data_version the version of the bins
     virtual void Update(const GHistIndexMatrix& gmat,
                         const GHistIndexBlockMatrix& gmatb,
                         const ColumnMatrix& column_matrix,
+                        GHistIndexPagedMatrix* pages,
+                        uint64_t data_version,
                         HostDeviceVector<bst_gpair>* gpair,
                         DMatrix* p_fmat,
                         RegTree* p_tree) {
-      double gstart = dmlc::GetTime();
+      monitor_.Start("Update");
+      pages_ = pages;
+      data_version_ = data_version;
 
       int num_leaves = 0;
       unsigned timestamp = 0;
 
-      double tstart;
-      double time_init_data = 0;
-      double time_init_new_node = 0;
-      double time_build_hist = 0;
-      double time_evaluate_split = 0;
-      double time_apply_split = 0;
-
-      std::vector<bst_gpair>& gpair_h = gpair->data_h();
-
-      tstart = dmlc::GetTime();
-      this->InitData(gmat, gpair_h, *p_fmat, *p_tree);
+      monitor_.Start("InitData");
+      this->InitData(gmat, gpair->const_data_h(), *p_fmat, *p_tree);
+      // goss scales the gradients of the rows sampled among the small ones
+      const std::vector<bst_gpair>& gpair_h = param.sampling_method == TrainParam::kGOSS ?
+          goss_gpair_ : gpair->const_data_h();
+      if (fhparam.contiguous_gradients) {
+        row_set_collection_.InitGradients(gpair_h, this->nthread);
+      }
       std::vector<bst_uint> feat_set = feat_index;
-      time_init_data = dmlc::GetTime() - tstart;
+      monitor_.Stop("InitData");
 
       // FIXME(hcho3): this code is broken when param.num_roots > 1. Please fix it
       CHECK_EQ(p_tree->param.num_roots, 1)
         << "tree_method=hist does not support multiple roots at this moment";
       for (int nid = 0; nid < p_tree->param.num_roots; ++nid) {
-        tstart = dmlc::GetTime();
+        monitor_.Start("BuildHist");
         hist_.AddHistRow(nid);
-        BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, feat_set, hist_[nid]);
-        time_build_hist += dmlc::GetTime() - tstart;
+        this->BuildRootHist(gpair_h, row_set_collection_[nid], gmat, gmatb, feat_set,
+                            hist_[nid]);
+        this->SyncHistograms({nid});
+        monitor_.Stop("BuildHist");
 
-        tstart = dmlc::GetTime();
+        monitor_.Start("InitNewNode");
         this->InitNewNode(nid, gmat, gpair_h, *p_fmat, *p_tree);
-        time_init_new_node += dmlc::GetTime() - tstart;
+        monitor_.Stop("InitNewNode");
 
-        tstart = dmlc::GetTime();
-        this->EvaluateSplit(nid, gmat, hist_, *p_fmat, *p_tree, feat_set);
-        time_evaluate_split += dmlc::GetTime() - tstart;
+        monitor_.Start("EvaluateSplit");
+        this->EvaluateSplits({nid}, gmat, hist_, *p_fmat, *p_tree, feat_set);
+        monitor_.Stop("EvaluateSplit");
+        // from now on the histogram is only needed by the subtraction trick
+        hist_.MarkEvictable(nid);
         qexpand_->push(ExpandEntry(nid, p_tree->GetDepth(nid),
                                    snode[nid].best.loss_chg,
                                    timestamp++));
@@ -185,50 +450,71 @@ class FastHistMaker: public TreeUpdater {
       }
 
       while (!qexpand_->empty()) {
-        const ExpandEntry candidate = qexpand_->top();
-        const int nid = candidate.nid;
+        // depthwise growth expands a whole level at a time, so that the
+        // histograms of its children are built together
+        common::Arena::Scope level(&arena_);
+        common::ArenaVector<ExpandEntry> candidates =
+            common::MakeArenaVector<ExpandEntry>(&arena_, 1, qexpand_->top());
         qexpand_->pop();
-        if (candidate.loss_chg <= rt_eps
-            || (param.max_depth > 0 && candidate.depth == param.max_depth)
-            || (param.max_leaves > 0 && num_leaves == param.max_leaves) ) {
-          (*p_tree)[nid].set_leaf(snode[nid].weight * param.learning_rate);
-        } else {
-          tstart = dmlc::GetTime();
-          this->ApplySplit(nid, gmat, column_matrix, hist_, *p_fmat, p_tree);
-          time_apply_split += dmlc::GetTime() - tstart;
-
-          tstart = dmlc::GetTime();
-          const int cleft = (*p_tree)[nid].cleft();
-          const int cright = (*p_tree)[nid].cright();
-          hist_.AddHistRow(cleft);
-          hist_.AddHistRow(cright);
-          if (row_set_collection_[cleft].size() < row_set_collection_[cright].size()) {
-            BuildHist(gpair_h, row_set_collection_[cleft], gmat, gmatb, feat_set, hist_[cleft]);
-            SubtractionTrick(hist_[cright], hist_[cleft], hist_[nid]);
+        if (param.grow_policy != TrainParam::kLossGuide) {
+          while (!qexpand_->empty() && qexpand_->top().depth == candidates[0].depth) {
+            candidates.push_back(qexpand_->top());
+            qexpand_->pop();
+          }
+        }
+        std::vector<int>& split_nodes = split_nodes_;
+        split_nodes.clear();
+        for (const ExpandEntry& candidate : candidates) {
+          const int nid = candidate.nid;
+          if (candidate.loss_chg <= rt_eps
+              || (param.max_depth > 0 && candidate.depth == param.max_depth)
+              || (param.max_leaves > 0 && num_leaves == param.max_leaves) ) {
+            (*p_tree)[nid].set_leaf(snode[nid].weight * param.learning_rate);
+            hist_.ReleaseHistRow(nid);
           } else {
-            BuildHist(gpair_h, row_set_collection_[cright], gmat, gmatb, feat_set, hist_[cright]);
-            SubtractionTrick(hist_[cleft], hist_[cright], hist_[nid]);
+            monitor_.Start("ApplySplit");
+            if (pages_ == nullptr) {
+              this->ApplySplit(nid, gmat, column_matrix, hist_, *p_fmat, p_tree);
+            } else {
+              this->AddChildNodes(nid, p_tree);
+            }
+            monitor_.Stop("ApplySplit");
+            split_nodes.push_back(nid);
+            ++num_leaves;  // give two and take one, as parent is no longer a leaf
           }
-          time_build_hist += dmlc::GetTime() - tstart;
+        }
 
-          tstart = dmlc::GetTime();
-          this->InitNewNode(cleft, gmat, gpair_h, *p_fmat, *p_tree);
-          this->InitNewNode(cright, gmat, gpair_h, *p_fmat, *p_tree);
-          time_init_new_node += dmlc::GetTime() - tstart;
+        if (pages_ != nullptr) {
+          monitor_.Start("ApplySplit");
+          this->ApplySplitsPaged(split_nodes, gmat, *p_tree);
+          monitor_.Stop("ApplySplit");
+        }
 
-          tstart = dmlc::GetTime();
-          this->EvaluateSplit(cleft, gmat, hist_, *p_fmat, *p_tree, feat_set);
-          this->EvaluateSplit(cright, gmat, hist_, *p_fmat, *p_tree, feat_set);
-          time_evaluate_split += dmlc::GetTime() - tstart;
+        monitor_.Start("BuildHist");
+        this->BuildChildHist(gpair_h, split_nodes, gmat, gmatb, feat_set, *p_tree);
+        monitor_.Stop("BuildHist");
 
-          qexpand_->push(ExpandEntry(cleft, p_tree->GetDepth(cleft),
-                                     snode[cleft].best.loss_chg,
-                                     timestamp++));
-          qexpand_->push(ExpandEntry(cright, p_tree->GetDepth(cright),
-                                     snode[cright].best.loss_chg,
+        std::vector<int>& children = children_;
+        children.clear();
+        monitor_.Start("InitNewNode");
+        for (int nid : split_nodes) {
+          const int cleft = (*p_tree)[nid].cleft();
+          const int cright = (*p_tree)[nid].cright();
+          this->InitNewNode(cleft, gmat, gpair_h, *p_fmat, *p_tree);
+          this->InitNewNode(cright, gmat, gpair_h, *p_fmat, *p_tree);
+          children.push_back(cleft);
+          children.push_back(cright);
+        }
+        monitor_.Stop("InitNewNode");
+
+        monitor_.Start("EvaluateSplit");
+        this->EvaluateSplits(children, gmat, hist_, *p_fmat, *p_tree, feat_set);
+        monitor_.Stop("EvaluateSplit");
+        for (int cid : children) {
+          hist_.MarkEvictable(cid);
+          qexpand_->push(ExpandEntry(cid, p_tree->GetDepth(cid),
+                                     snode[cid].best.loss_chg,
                                      timestamp++));
-
-          ++num_leaves;  // give two and take one, as parent is no longer a leaf
         }
       }
 
@@ -250,32 +536,8 @@ class FastHistMaker: public TreeUpdater {
 
       pruner_->Update(gpair, p_fmat, std::vector<RegTree*>{p_tree});
 
-      if (param.debug_verbose > 0) {
-        double total_time = dmlc::GetTime() - gstart;
-        LOG(INFO) << "\nInitData:          "
-                  << std::fixed << std::setw(6) << std::setprecision(4) << time_init_data
-                  << " (" << std::fixed << std::setw(5) << std::setprecision(2)
-                  << time_init_data / total_time * 100 << "%)\n"
-                  << "InitNewNode:       "
-                  << std::fixed << std::setw(6) << std::setprecision(4) << time_init_new_node
-                  << " (" << std::fixed << std::setw(5) << std::setprecision(2)
-                  << time_init_new_node / total_time * 100 << "%)\n"
-                  << "BuildHist:         "
-                  << std::fixed << std::setw(6) << std::setprecision(4) << time_build_hist
-                  << " (" << std::fixed << std::setw(5) << std::setprecision(2)
-                  << time_build_hist / total_time * 100 << "%)\n"
-                  << "EvaluateSplit:     "
-                  << std::fixed << std::setw(6) << std::setprecision(4) << time_evaluate_split
-                  << " (" << std::fixed << std::setw(5) << std::setprecision(2)
-                  << time_evaluate_split / total_time * 100 << "%)\n"
-                  << "ApplySplit:        "
-                  << std::fixed << std::setw(6) << std::setprecision(4) << time_apply_split
-                  << " (" << std::fixed << std::setw(5) << std::setprecision(2)
-                  << time_apply_split / total_time * 100 << "%)\n"
-                  << "========================================\n"
-                  << "Total:             "
-                  << std::fixed << std::setw(6) << std::setprecision(4) << total_time;
-      }
+      monitor_.Stop("Update");
+      monitor_.AddCount("histogram_bytes", hist_.MemoryBytes());
     }
 
     inline void BuildHist(const std::vector<bst_gpair>& gpair,
@@ -284,15 +546,300 @@ class FastHistMaker: public TreeUpdater {
                           const GHistIndexBlockMatrix& gmatb,
                           const std::vector<bst_uint>& feat_set,
                           GHistRow hist) {
-      if (fhparam.enable_feature_grouping > 0) {
+      monitor_.AddCount("BuildHist.rows", row_indices.size());
+      this->ResetNodeFeatures({row_indices.node_id}, gmat);
+      if (pages_ != nullptr) {
+        pages_->BeforeFirst();
+        while (pages_->Next()) {
+          const RowSetCollection::Elem page_rows = PageRows(row_indices, pages_->Value());
+          hist_builder_.BuildHist(gpair, page_rows, pages_->Value(), feat_set, hist);
+          this->MarkNodeFeatures({page_rows}, pages_->Value());
+        }
+      } else if (fhparam.enable_feature_grouping > 0) {
         hist_builder_.BuildBlockHist(gpair, row_indices, gmatb, feat_set, hist);
       } else {
         hist_builder_.BuildHist(gpair, row_indices, gmat, feat_set, hist);
       }
+      if (pages_ == nullptr) {
+        this->MarkNodeFeatures({row_indices}, gmat);
+      }
+      this->SyncNodeFeatures({row_indices.node_id});
+    }
+
+    // build the histogram of the root from the one of the previous tree and the
+    // changes of the gradients, when the rows are the same and few changed
+    inline void BuildRootHist(const std::vector<bst_gpair>& gpair,
+                              const RowSetCollection::Elem row_indices,
+                              const GHistIndexMatrix& gmat,
+                              const GHistIndexBlockMatrix& gmatb,
+                              const std::vector<bst_uint>& feat_set,
+                              GHistRow hist) {
+      const bool incremental = fhparam.incremental_root_histogram && pages_ == nullptr &&
+          param.subsample >= 1.0f && param.sampling_method != TrainParam::kGOSS &&
+          !rabit::IsDistributed();
+      if (incremental && root_version_ == data_version_ && root_gpair_.size() == gpair.size() &&
+          root_hist_.size() == hist.size && root_reuse_ < kRootHistRefresh &&
+          this->FindRootDelta(gpair)) {
+        monitor_.AddCount("BuildHist.root_reuses", 1);
+        monitor_.AddCount("BuildHist.root_delta_rows", root_changed_.size());
+        std::copy(root_hist_.begin(), root_hist_.end(), hist.begin);
+        const RowSetCollection::Elem changed(
+            dmlc::BeginPtr(root_changed_), dmlc::BeginPtr(root_changed_) + root_changed_.size(),
+            row_indices.node_id);
+        if (changed.size() != 0 && fhparam.enable_feature_grouping > 0) {
+          hist_builder_.BuildBlockHist(root_delta_, changed, gmatb, feat_set, hist);
+        } else if (changed.size() != 0) {
+          hist_builder_.BuildHist(root_delta_, changed, gmat, feat_set, hist);
+        }
+        // the rows are the same, so are their features
+        this->ResetNodeFeatures({row_indices.node_id}, gmat);
+        if (use_node_features_) node_features_[row_indices.node_id] = root_features_;
+        ++root_reuse_;
+      } else {
+        this->BuildHist(gpair, row_indices, gmat, gmatb, feat_set, hist);
+        if (!incremental) {
+          root_gpair_.clear();
+          root_hist_.clear();
+          return;
+        }
+        root_gpair_ = gpair;
+        root_delta_.resize(gpair.size());
+        if (use_node_features_) root_features_ = node_features_[row_indices.node_id];
+        root_version_ = data_version_;
+        root_reuse_ = 0;
+      }
+      root_hist_.assign(hist.begin, hist.begin + hist.size);
+    }
+
+    // find the rows whose gradients changed since they were added to the root
+    // histogram, with the changes in root_delta_, false when the rows of the
+    // root are not the same or too many changed
+    inline bool FindRootDelta(const std::vector<bst_gpair>& gpair) {
+      const float eps = fhparam.root_delta_eps;
+      const size_t nrow = gpair.size();
+      const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread);
+      root_changed_tloc_.resize(nthread);
+      std::vector<uint8_t> same_rows(nthread, 1);
+      #pragma omp parallel for num_threads(nthread) schedule(static, 1)
+      for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
+        std::vector<size_t>& changed = root_changed_tloc_[tid];
+        changed.clear();
+        for (size_t i = nrow * tid / nthread; i < nrow * (tid + 1) / nthread; ++i) {
+          const bst_gpair now = gpair[i];
+          const bst_gpair before = root_gpair_[i];
+          // the rows of negative hessian are not in the tree
+          if ((now.GetHess() < 0.0f) != (before.GetHess() < 0.0f)) {
+            same_rows[tid] = 0;
+            break;
+          }
+          if (now.GetHess() < 0.0f) continue;
+          if (std::abs(now.GetGrad() - before.GetGrad()) > eps ||
+              std::abs(now.GetHess() - before.GetHess()) > eps) {
+            root_delta_[i] = bst_gpair(now.GetGrad() - before.GetGrad(),
+                                       now.GetHess() - before.GetHess());
+            root_gpair_[i] = now;
+            changed.push_back(i);
+          }
+        }
+      }
+      size_t nchanged = 0;
+      for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
+        if (same_rows[tid] == 0) return false;
+        nchanged += root_changed_tloc_[tid].size();
+      }
+      if (nchanged > fhparam.root_delta_max_fraction * nrow) return false;
+      root_changed_.clear();
+      for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
+        root_changed_.insert(root_changed_.end(), root_changed_tloc_[tid].begin(),
+                             root_changed_tloc_[tid].end());
+      }
+      return true;
+    }
+
+    // build the histograms of the children of the split nodes, the smaller
+    // child from its rows and the other one by subtraction from the parent.
+    // Both children are built from their rows when the parent was evicted.
+    inline void BuildChildHist(const std::vector<bst_gpair>& gpair,
+                               const std::vector<int>& split_nodes,
+                               const GHistIndexMatrix& gmat,
+                               const GHistIndexBlockMatrix& gmatb,
+                               const std::vector<bst_uint>& feat_set,
+                               const RegTree& tree) {
+      // the parents must survive the allocation of their children
+      for (int nid : split_nodes) {
+        hist_.UnmarkEvictable(nid);
+      }
+      // the child to build is chosen from the row counts of all workers
+      common::Arena::Scope scope(&arena_);
+      common::ArenaVector<size_t> child_rows = common::MakeArenaVector<size_t>(&arena_);
+      child_rows.reserve(2 * split_nodes.size());
+      for (int nid : split_nodes) {
+        child_rows.push_back(row_set_collection_[tree[nid].cleft()].size());
+        child_rows.push_back(row_set_collection_[tree[nid].cright()].size());
+      }
+      if (rabit::IsDistributed() && !col_split_) {
+        rabit::Allreduce<rabit::op::Sum>(child_rows.data(), child_rows.size());
+      }
+      std::vector<int>& build_nodes = build_nodes_;
+      std::vector<int>& subtract_nodes = subtract_nodes_;
+      std::vector<int>& subtract_parents = subtract_parents_;
+      build_nodes.clear();
+      subtract_nodes.clear();
+      subtract_parents.clear();
+      for (size_t i = 0; i < split_nodes.size(); ++i) {
+        const int nid = split_nodes[i];
+        const int cleft = tree[nid].cleft();
+        const int cright = tree[nid].cright();
+        hist_.AddHistRow(cleft);
+        hist_.AddHistRow(cright);
+        int small = cright, large = cleft;
+        if (child_rows[2 * i] < child_rows[2 * i + 1]) {
+          std::swap(small, large);
+        }
+        build_nodes.push_back(small);
+        if (hist_.RowExists(nid)) {
+          subtract_nodes.push_back(large);
+          subtract_parents.push_back(nid);
+        } else {
+          build_nodes.push_back(large);
+        }
+      }
+      // the rows are taken once all are added, adding rows moves the histograms
+      std::vector<RowSetCollection::Elem>& row_sets = build_rows_;
+      std::vector<GHistRow>& build_hist = build_hist_;
+      std::vector<GHistRow>& self = self_hist_;
+      std::vector<GHistRow>& sibling = sibling_hist_;
+      std::vector<GHistRow>& parent = parent_hist_;
+      row_sets.clear();
+      build_hist.clear();
+      self.clear();
+      sibling.clear();
+      parent.clear();
+      size_t nrow_built = 0;
+      for (int nid : build_nodes) {
+        row_sets.push_back(row_set_collection_[nid]);
+        build_hist.push_back(hist_[nid]);
+        nrow_built += row_sets.back().size();
+      }
+      monitor_.AddCount("BuildHist.rows", nrow_built);
+
+      for (size_t i = 0; i < subtract_nodes.size(); ++i) {
+        self.push_back(hist_[subtract_nodes[i]]);
+        sibling.push_back(hist_[tree[subtract_nodes[i]].is_left_child() ?
+                                tree[subtract_parents[i]].cright() :
+                                tree[subtract_parents[i]].cleft()]);
+        parent.push_back(hist_[subtract_parents[i]]);
+      }
+      // the subtracted children have at most the features of their parent
+      this->ResetNodeFeatures(build_nodes, gmat);
+      if (use_node_features_) {
+        node_features_.resize(tree.param.num_nodes);
+        for (size_t i = 0; i < subtract_nodes.size(); ++i) {
+          node_features_[subtract_nodes[i]] = node_features_[subtract_parents[i]];
+        }
+      }
+      if (pages_ != nullptr) {
+        // the histograms are accumulated over the pages
+        std::vector<RowSetCollection::Elem> page_row_sets(row_sets.size());
+        pages_->BeforeFirst();
+        while (pages_->Next()) {
+          for (size_t i = 0; i < row_sets.size(); ++i) {
+            page_row_sets[i] = PageRows(row_sets[i], pages_->Value());
+          }
+          hist_builder_.BuildHistBatch(gpair, page_row_sets, pages_->Value(), feat_set,
+                                       build_hist);
+          this->MarkNodeFeatures(page_row_sets, pages_->Value());
+        }
+      } else if (fhparam.enable_feature_grouping > 0) {
+        for (size_t i = 0; i < build_nodes.size(); ++i) {
+          hist_builder_.BuildBlockHist(gpair, row_sets[i], gmatb, feat_set, build_hist[i]);
+        }
+      } else {
+        hist_builder_.BuildHistBatch(gpair, row_sets, gmat, feat_set, build_hist);
+      }
+      // the parents are already reduced, so only the built children are
+      // sent and the other ones are obtained by subtraction
+      if (pages_ == nullptr) {
+        this->MarkNodeFeatures(row_sets, gmat);
+      }
+      this->SyncHistograms(build_nodes);
+      this->SyncNodeFeatures(build_nodes);
+      if (use_node_features_) {
+        std::vector<const common::BitMap*> features;
+        for (int pid : subtract_parents) {
+          features.push_back(&node_features_[pid]);
+        }
+        hist_builder_.SubtractionTrickBatch(self, sibling, parent, features,
+                                            gmat.cut->row_ptr);
+      } else {
+        hist_builder_.SubtractionTrickBatch(self, sibling, parent);
+      }
+      for (int nid : split_nodes) {
+        hist_.ReleaseHistRow(nid);
+        if (use_node_features_) {
+          std::vector<uint32_t>().swap(node_features_[nid].data);
+        }
+      }
+    }
+
+    // clear the feature bitmaps of the nodes before they are marked
+    inline void ResetNodeFeatures(const std::vector<int>& nids,
+                                  const GHistIndexMatrix& gmat) {
+      if (!use_node_features_) return;
+      for (int nid : nids) {
+        if (static_cast<size_t>(nid) >= node_features_.size()) {
+          node_features_.resize(nid + 1);
+        }
+        node_features_[nid].Resize(gmat.cut->row_ptr.size() - 1);
+        node_features_[nid].Clear();
+      }
+    }
+
+    // mark the features that have entries among the rows of each node
+    inline void MarkNodeFeatures(const std::vector<RowSetCollection::Elem>& row_sets,
+                                 const GHistIndexMatrix& gmat) {
+      if (!use_node_features_) return;
+      const bst_omp_uint nnode = static_cast<bst_omp_uint>(row_sets.size());
+      #pragma omp parallel for schedule(dynamic) num_threads(this->nthread)
+      for (bst_omp_uint i = 0; i < nnode; ++i) {
+        XGBOOST_BIN_INDEX_SWITCH(gmat.index, {
+          MarkRowFeatures<DType>(row_sets[i], gmat, &node_features_[row_sets[i].node_id]);
+        });
+      }
     }
 
-    inline void SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent) {
-      hist_builder_.SubtractionTrick(self, sibling, parent);
+    template <typename T>
+    inline void MarkRowFeatures(const RowSetCollection::Elem rows,
+                                const GHistIndexMatrix& gmat,
+                                common::BitMap* features) const {
+      const common::BinReader<T> index = gmat.index.Reader<T>();
+      const size_t base = gmat.base_rowid;
+      for (const size_t* it = rows.begin; it < rows.end; ++it) {
+        for (size_t j = gmat.row_ptr[*it - base]; j < gmat.row_ptr[*it - base + 1]; ++j) {
+          features->SetTrue(feature_of_bin_[index[j]]);
+        }
+      }
+    }
+
+    // the features of a node are those with entries on any worker,
+    // on column split a worker only evaluates its own ones
+    inline void SyncNodeFeatures(const std::vector<int>& nids) {
+      if (!use_node_features_ || !rabit::IsDistributed() || col_split_) return;
+      for (int nid : nids) {
+        std::vector<uint32_t>& bits = node_features_[nid].data;
+        rabit::Allreduce<rabit::op::BitOR>(dmlc::BeginPtr(bits), bits.size());
+      }
+    }
+
+    // sum the histograms of the nodes over all workers, on column split
+    // every worker keeps the histograms of its own features
+    inline void SyncHistograms(const std::vector<int>& nids) {
+      if (!rabit::IsDistributed() || col_split_) return;
+      for (int nid : nids) {
+        GHistRow hist = hist_[nid];
+        rabit::Allreduce<rabit::op::Sum>(&hist.begin[0].sum_grad,
+                                         static_cast<size_t>(hist.size) * 2);
+      }
     }
 
     inline bool UpdatePredictionCache(const DMatrix* data,
@@ -359,19 +906,24 @@ class FastHistMaker: public TreeUpdater {
         leaf_value_cache_.clear();
         // initialize histogram collection
         uint32_t nbins = gmat.cut->row_ptr.back();
-        hist_.Init(nbins);
+        hist_.Init(nbins, fhparam.max_cached_hist_node);
 
         // initialize histogram builder
         #pragma omp parallel
         {
           this->nthread = omp_get_num_threads();
         }
-        hist_builder_.Init(this->nthread, nbins);
+        hist_builder_.Init(this->nthread, nbins, fhparam.numa_aware,
+                           param.deterministic_reduction);
+        // on column split the workers have the same rows and their own features
+        col_split_ = fhparam.dsplit == 1;
 
         CHECK_EQ(info.root_index.size(), 0U);
-        std::vector<size_t>& row_indices = row_set_collection_.row_indices_;
+        auto& row_indices = row_set_collection_.row_indices_;
         // mark subsample and build list of member rows
-        if (param.subsample < 1.0f) {
+        if (param.sampling_method == TrainParam::kGOSS) {
+          this->SampleGOSS(gpair, &row_indices);
+        } else if (param.subsample < 1.0f) {
           std::bernoulli_distribution coin_flip(param.subsample);
           auto& rnd = common::GlobalRandom();
           for (size_t i = 0; i < info.num_row; ++i) {
@@ -380,11 +932,16 @@ class FastHistMaker: public TreeUpdater {
             }
           }
         } else {
-          for (size_t i = 0; i < info.num_row; ++i) {
-            if (gpair[i].GetHess() >= 0.0f) {
-              row_indices.push_back(i);
-            }
+          // the rows are first written by the threads building their histograms
+          const bst_omp_uint nrow = static_cast<bst_omp_uint>(info.num_row);
+          row_indices.resize(nrow);
+          #pragma omp parallel for num_threads(this->nthread) schedule(static)
+          for (bst_omp_uint i = 0; i < nrow; ++i) {
+            row_indices[i] = i;
           }
+          row_indices.erase(std::remove_if(row_indices.begin(), row_indices.end(),
+                                           [&](size_t i) { return gpair[i].GetHess() < 0.0f; }),
+                            row_indices.end());
         }
         row_set_collection_.Init();
       }
@@ -406,6 +963,30 @@ class FastHistMaker: public TreeUpdater {
           // sparse data
           data_layout_ = kSparseData;
         }
+        // all workers must use the same layout, sparse if any of them is
+        if (rabit::IsDistributed()) {
+          int layout = static_cast<int>(data_layout_);
+          rabit::Allreduce<rabit::op::Max>(&layout, 1);
+          data_layout_ = static_cast<DataLayout>(layout);
+        }
+        // the node statistics cannot be read from the histogram of a feature
+        // that the worker may not have
+        if (col_split_) {
+          data_layout_ = kSparseData;
+        }
+        // on very sparse data most nodes only have a few of the features,
+        // the others are skipped by the subtraction and the split evaluation
+        use_node_features_ = data_layout_ == kSparseData &&
+            nnz < fhparam.node_feature_threshold * nrow * ncol;
+        if (use_node_features_) {
+          const std::vector<uint32_t>& cut_ptr = gmat.cut->row_ptr;
+          feature_of_bin_.resize(cut_ptr.back());
+          for (bst_uint fid = 0; fid + 1 < cut_ptr.size(); ++fid) {
+            std::fill(feature_of_bin_.begin() + cut_ptr[fid],
+                      feature_of_bin_.begin() + cut_ptr[fid + 1], fid);
+          }
+          node_features_.clear();
+        }
       }
       {
         // store a pointer to the tree
@@ -430,6 +1011,8 @@ class FastHistMaker: public TreeUpdater {
         CHECK_GT(param.colsample_bytree, 0U)
             << "colsample_bytree cannot be zero.";
         feat_index.resize(n);
+        // the random state depends on the local rows after row subsampling
+        rabit::Broadcast(&feat_index, 0);
       }
       if (data_layout_ == kDenseDataZeroBased || data_layout_ == kDenseDataOneBased) {
         /* specialized code for dense data:
@@ -463,33 +1046,63 @@ class FastHistMaker: public TreeUpdater {
       }
     }
 
-    inline void EvaluateSplit(int nid,
-                              const GHistIndexMatrix& gmat,
-                              const HistCollection& hist,
-                              const DMatrix& fmat,
-                              const RegTree& tree,
-                              const std::vector<bst_uint>& feat_set) {
+    // find the best split of every node in nids. The nodes and their
+    // features are evaluated together, so that the children of a level keep
+    // all threads busy even when they have few features.
+    inline void EvaluateSplits(const std::vector<int>& nids,
+                               const GHistIndexMatrix& gmat,
+                               const HistCollection& hist,
+                               const DMatrix& fmat,
+                               const RegTree& tree,
+                               const std::vector<bst_uint>& feat_set) {
       // start enumeration
       const MetaInfo& info = fmat.info();
-      const bst_uint nfeature = static_cast<bst_uint>(feat_set.size());
+      const size_t nnode = nids.size();
+      const size_t nfeature = feat_set.size();
       const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread);
-      best_split_tloc_.resize(nthread);
-      #pragma omp parallel for schedule(static) num_threads(nthread)
+      // best split of each node found by each thread, thread major
+      best_split_tloc_.resize(nthread * nnode);
       for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
-        best_split_tloc_[tid] = snode[nid].best;
+        for (size_t k = 0; k < nnode; ++k) {
+          best_split_tloc_[tid * nnode + k] = snode[nids[k]].best;
+        }
       }
-      #pragma omp parallel for schedule(dynamic) num_threads(nthread)
-      for (bst_omp_uint i = 0; i < nfeature; ++i) {
-        const bst_uint fid = feat_set[i];
+      const bst_omp_uint ntask = static_cast<bst_omp_uint>(nnode * nfeature);
+      const std::vector<uint32_t>& cut_ptr = gmat.cut->row_ptr;
+      uint64_t nbin_scanned = 0;
+      #pragma omp parallel for schedule(dynamic) num_threads(nthread) \
+          reduction(+:nbin_scanned)
+      for (bst_omp_uint i = 0; i < ntask; ++i) {
+        const size_t k = i / nfeature;
+        const int nid = nids[k];
+        const bst_uint fid = feat_set[i % nfeature];
+        if (use_node_features_ && !node_features_[nid].Get(fid)) continue;
+        nbin_scanned += 2 * (cut_ptr[fid + 1] - cut_ptr[fid]);
         const unsigned tid = omp_get_thread_num();
+        SplitEntry* best = &best_split_tloc_[tid * nnode + k];
         this->EnumerateSplit(-1, gmat, hist[nid], snode[nid], constraints_[nid], info,
-          &best_split_tloc_[tid], fid);
+          best, fid);
         this->EnumerateSplit(+1, gmat, hist[nid], snode[nid], constraints_[nid], info,
-          &best_split_tloc_[tid], fid);
+          best, fid);
       }
-      for (unsigned tid = 0; tid < nthread; ++tid) {
-        snode[nid].best.Update(best_split_tloc_[tid]);
+      for (size_t k = 0; k < nnode; ++k) {
+        for (unsigned tid = 0; tid < nthread; ++tid) {
+          snode[nids[k]].best.Update(best_split_tloc_[tid * nnode + k]);
+        }
       }
+      // the best splits of the features of each worker are reduced
+      if (col_split_) {
+        common::Arena::Scope scope(&arena_);
+        common::ArenaVector<SplitEntry> best = common::MakeArenaVector<SplitEntry>(&arena_, nnode);
+        for (size_t k = 0; k < nnode; ++k) {
+          best[k] = snode[nids[k]].best;
+        }
+        split_reducer_.Allreduce(best.data(), best.size());
+        for (size_t k = 0; k < nnode; ++k) {
+          snode[nids[k]].best = best[k];
+        }
+      }
+      monitor_.AddCount("EvaluateSplit.bins", nbin_scanned);
     }
 
     inline void ApplySplit(int nid,
@@ -503,16 +1116,7 @@ class FastHistMaker: public TreeUpdater {
       });
     }
 
-    template <typename T>
-    inline void ApplySplit_(int nid,
-                            const GHistIndexMatrix& gmat,
-                            const ColumnMatrix& column_matrix,
-                            const HistCollection& hist,
-                            const DMatrix& fmat,
-                            RegTree* p_tree) {
-      // TODO(hcho3): support feature sampling by levels
-
-      /* 1. Create child nodes */
+    inline void AddChildNodes(int nid, RegTree* p_tree) {
       NodeEntry& e = snode[nid];
 
       p_tree->AddChilds(nid);
@@ -522,22 +1126,16 @@ class FastHistMaker: public TreeUpdater {
       int cright = (*p_tree)[nid].cright();
       (*p_tree)[cleft].set_leaf(0.0f, 0);
       (*p_tree)[cright].set_leaf(0.0f, 0);
+    }
 
-      /* 2. Categorize member rows */
-      const bst_omp_uint nthread = static_cast<bst_omp_uint>(this->nthread);
-      row_split_tloc_.resize(nthread);
-      for (bst_omp_uint i = 0; i < nthread; ++i) {
-        row_split_tloc_[i].left.clear();
-        row_split_tloc_[i].right.clear();
-      }
-      const bool default_left = (*p_tree)[nid].default_left();
-      const bst_uint fid = (*p_tree)[nid].split_index();
-      const bst_float split_pt = (*p_tree)[nid].split_cond();
+    // convert the floating-point split condition of nid into the
+    // corresponding bin_id, -1 indicates that it is less than all known cut points
+    inline int32_t SplitCondBin(const GHistIndexMatrix& gmat, const RegTree& tree, int nid) {
+      const bst_uint fid = tree[nid].split_index();
+      const bst_float split_pt = tree[nid].split_cond();
       const uint32_t lower_bound = gmat.cut->row_ptr[fid];
       const uint32_t upper_bound = gmat.cut->row_ptr[fid + 1];
       int32_t split_cond = -1;
-      // convert floating-point split_pt into corresponding bin_id
-      // split_cond = -1 indicates that split_pt is less than all known cut points
       CHECK_LT(upper_bound,
         static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
       for (uint32_t i = lower_bound; i < upper_bound; ++i) {
@@ -545,39 +1143,162 @@ class FastHistMaker: public TreeUpdater {
           split_cond = static_cast<int32_t>(i);
         }
       }
+      return split_cond;
+    }
+
+    // categorize the rows of all split nodes with one pass over the pages
+    inline void ApplySplitsPaged(const std::vector<int>& split_nodes,
+                                 const GHistIndexMatrix& gmat,
+                                 const RegTree& tree) {
+      std::vector<std::vector<uint8_t> > goes_left(split_nodes.size());
+      common::Arena::Scope scope(&arena_);
+      common::ArenaVector<int32_t> split_cond =
+          common::MakeArenaVector<int32_t>(&arena_, split_nodes.size());
+      for (size_t k = 0; k < split_nodes.size(); ++k) {
+        goes_left[k].resize(row_set_collection_[split_nodes[k]].size());
+        split_cond[k] = this->SplitCondBin(gmat, tree, split_nodes[k]);
+      }
+      pages_->BeforeFirst();
+      while (pages_->Next()) {
+        const GHistIndexMatrix& page = pages_->Value();
+        for (size_t k = 0; k < split_nodes.size(); ++k) {
+          const int nid = split_nodes[k];
+          const RowSetCollection::Elem rowset = row_set_collection_[nid];
+          const RowSetCollection::Elem rows = PageRows(rowset, page);
+          const bst_uint fid = tree[nid].split_index();
+          uint8_t* out = dmlc::BeginPtr(goes_left[k]) + (rows.begin - rowset.begin);
+          XGBOOST_TYPE_SWITCH(page.index.dtype(), {
+            ApplySplitPageData<DType>(rows, page, gmat.cut->row_ptr[fid],
+                                      gmat.cut->row_ptr[fid + 1], split_cond[k],
+                                      tree[nid].default_left(), out);
+          });
+        }
+      }
+      for (size_t k = 0; k < split_nodes.size(); ++k) {
+        const int nid = split_nodes[k];
+        this->SyncGoesLeft(tree[nid].default_left(), &goes_left[k]);
+        row_set_collection_.Partition(nid, goes_left[k], tree[nid].cleft(),
+                                      tree[nid].cright(), nthread);
+      }
+    }
+
+    // the bins of each row are sorted, the one of the split feature is
+    // found by binary search
+    template <typename T>
+    inline void ApplySplitPageData(const RowSetCollection::Elem rows,
+                                   const GHistIndexMatrix& page,
+                                   bst_uint lower_bound,
+                                   bst_uint upper_bound,
+                                   bst_int split_cond,
+                                   bool default_left,
+                                   uint8_t* goes_left) {
+      const T* index = page.index.data<T>();
+      const bst_omp_uint nrows = static_cast<bst_omp_uint>(rows.size());
+      #pragma omp parallel for num_threads(nthread) schedule(static)
+      for (bst_omp_uint i = 0; i < nrows; ++i) {
+        const size_t r = rows.begin[i] - page.base_rowid;
+        const T* begin = index + page.row_ptr[r];
+        const T* end = index + page.row_ptr[r + 1];
+        const T* p = std::lower_bound(begin, end, lower_bound);
+        if (p != end && *p < upper_bound) {
+          goes_left[i] = static_cast<int32_t>(*p) <= split_cond;
+        } else {
+          goes_left[i] = default_left;
+        }
+      }
+    }
+
+    // on column split only the workers having the split feature know where
+    // the rows go, the others send them all the default way. The rows that
+    // do not go the default way are reduced as a bitmap.
+    inline void SyncGoesLeft(bool default_left, std::vector<uint8_t>* p_goes_left) {
+      if (!col_split_) return;
+      std::vector<uint8_t>& goes_left = *p_goes_left;
+      const size_t nrows = goes_left.size();
+      split_rows_.data.resize((nrows + 31U) >> 5);
+      const bst_omp_uint nword = static_cast<bst_omp_uint>(split_rows_.data.size());
+      #pragma omp parallel for num_threads(nthread) schedule(static)
+      for (bst_omp_uint w = 0; w < nword; ++w) {
+        const size_t end = std::min(nrows, (static_cast<size_t>(w) + 1) << 5);
+        uint32_t word = 0;
+        for (size_t i = static_cast<size_t>(w) << 5; i < end; ++i) {
+          word |= static_cast<uint32_t>(goes_left[i] != default_left) << (i & 31U);
+        }
+        split_rows_.data[w] = word;
+      }
+      rabit::Allreduce<rabit::op::BitOR>(dmlc::BeginPtr(split_rows_.data),
+                                         split_rows_.data.size());
+      const bst_omp_uint n = static_cast<bst_omp_uint>(nrows);
+      #pragma omp parallel for num_threads(nthread) schedule(static)
+      for (bst_omp_uint i = 0; i < n; ++i) {
+        goes_left[i] = split_rows_.Get(i) != default_left;
+      }
+    }
+
+    // the rows of the set that are in the page, the row sets are sorted
+    static RowSetCollection::Elem PageRows(const RowSetCollection::Elem rows,
+                                           const GHistIndexMatrix& page) {
+      const size_t begin = page.base_rowid;
+      const size_t end = begin + page.row_ptr.size() - 1;
+      const size_t* lo = std::lower_bound(rows.begin, rows.end, begin);
+      const size_t* hi = std::lower_bound(lo, rows.end, end);
+      return RowSetCollection::Elem(lo, hi, rows.node_id,
+                                    rows.gpair == nullptr ? nullptr :
+                                    rows.gpair + (lo - rows.begin));
+    }
+
+    template <typename T>
+    inline void ApplySplit_(int nid,
+                            const GHistIndexMatrix& gmat,
+                            const ColumnMatrix& column_matrix,
+                            const HistCollection& hist,
+                            const DMatrix& fmat,
+                            RegTree* p_tree) {
+      // TODO(hcho3): support feature sampling by levels
+
+      /* 1. Create child nodes */
+      this->AddChildNodes(nid, p_tree);
+
+      /* 2. Categorize member rows */
+      const bool default_left = (*p_tree)[nid].default_left();
+      const bst_uint fid = (*p_tree)[nid].split_index();
+      const uint32_t lower_bound = gmat.cut->row_ptr[fid];
+      const uint32_t upper_bound = gmat.cut->row_ptr[fid + 1];
+      const int32_t split_cond = this->SplitCondBin(gmat, *p_tree, nid);
 
       const auto& rowset = row_set_collection_[nid];
+      goes_left_.resize(rowset.size());
 
       Column<T> column = column_matrix.GetColumn<T>(fid);
       if (column.type == xgboost::common::kDenseColumn) {
-        ApplySplitDenseData(rowset, gmat, &row_split_tloc_, column, split_cond,
+        ApplySplitDenseData(rowset, gmat, &goes_left_, column, split_cond,
           default_left);
       } else {
-        ApplySplitSparseData(rowset, gmat, &row_split_tloc_, column, lower_bound,
+        ApplySplitSparseData(rowset, gmat, &goes_left_, column, lower_bound,
           upper_bound, split_cond, default_left);
       }
 
-      row_set_collection_.AddSplit(
-        nid, row_split_tloc_, (*p_tree)[nid].cleft(), (*p_tree)[nid].cright());
+      this->SyncGoesLeft(default_left, &goes_left_);
+
+      /* 3. Partition the rows in place */
+      row_set_collection_.Partition(nid, goes_left_, (*p_tree)[nid].cleft(),
+                                    (*p_tree)[nid].cright(), nthread);
     }
 
     template<typename T>
     inline void ApplySplitDenseData(const RowSetCollection::Elem rowset,
                                     const GHistIndexMatrix& gmat,
-                                    std::vector<RowSetCollection::Split>* p_row_split_tloc,
+                                    std::vector<uint8_t>* p_goes_left,
                                     const Column<T>& column,
                                     bst_int split_cond,
                                     bool default_left) {
-      std::vector<RowSetCollection::Split>& row_split_tloc = *p_row_split_tloc;
+      uint8_t* goes_left = dmlc::BeginPtr(*p_goes_left);
       const int K = 8;  // loop unrolling factor
       const size_t nrows = rowset.end - rowset.begin;
       const size_t rest = nrows % K;
 
       #pragma omp parallel for num_threads(nthread) schedule(static)
       for (bst_omp_uint i = 0; i < nrows - rest; i += K) {
-        const bst_uint tid = omp_get_thread_num();
-        auto& left = row_split_tloc[tid].left;
-        auto& right = row_split_tloc[tid].right;
         size_t rid[K];
         T rbin[K];
         for (int k = 0; k < K; ++k) {
@@ -588,110 +1309,23 @@ class FastHistMaker: public TreeUpdater {
         }
         for (int k = 0; k < K; ++k) {
           if (rbin[k] == std::numeric_limits<T>::max()) {  // missing value
-            if (default_left) {
-              left.push_back(rid[k]);
-            } else {
-              right.push_back(rid[k]);
-            }
+            goes_left[i + k] = default_left;
           } else {
             CHECK_LT(rbin[k] + column.index_base,
               static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
-            if (static_cast<int32_t>(rbin[k] + column.index_base) <= split_cond) {
-              left.push_back(rid[k]);
-            } else {
-              right.push_back(rid[k]);
-            }
+            goes_left[i + k] = static_cast<int32_t>(rbin[k] + column.index_base) <= split_cond;
           }
         }
       }
       for (size_t i = nrows - rest; i < nrows; ++i) {
-        auto& left = row_split_tloc[nthread-1].left;
-        auto& right = row_split_tloc[nthread-1].right;
         const size_t rid = rowset.begin[i];
         const T rbin = column.index[rid];
         if (rbin == std::numeric_limits<T>::max()) {  // missing value
-          if (default_left) {
-            left.push_back(rid);
-          } else {
-            right.push_back(rid);
-          }
+          goes_left[i] = default_left;
         } else {
           CHECK_LT(rbin + column.index_base,
             static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
-          if (static_cast<int32_t>(rbin + column.index_base) <= split_cond) {
-            left.push_back(rid);
-          } else {
-            right.push_back(rid);
-          }
-        }
-      }
-    }
-
-    inline void ApplySplitSparseDataOld(const RowSetCollection::Elem rowset,
-                                        const GHistIndexMatrix& gmat,
-                                        std::vector<RowSetCollection::Split>* p_row_split_tloc,
-                                        bst_uint lower_bound,
-                                        bst_uint upper_bound,
-                                        bst_int split_cond,
-                                        bool default_left) {
-      std::vector<RowSetCollection::Split>& row_split_tloc = *p_row_split_tloc;
-      const int K = 8;  // loop unrolling factor
-      const size_t nrows = rowset.end - rowset.begin;
-      const size_t rest = nrows % K;
-      #pragma omp parallel for num_threads(nthread) schedule(static)
-      for (bst_omp_uint i = 0; i < nrows - rest; i += K) {
-        size_t rid[K];
-        GHistIndexRow row[K];
-        const uint32_t* p[K];
-        bst_uint tid = omp_get_thread_num();
-        auto& left = row_split_tloc[tid].left;
-        auto& right = row_split_tloc[tid].right;
-        for (int k = 0; k < K; ++k) {
-          rid[k] = rowset.begin[i + k];
-        }
-        for (int k = 0; k < K; ++k) {
-          row[k] = gmat[rid[k]];
-        }
-        for (int k = 0; k < K; ++k) {
-          p[k] = std::lower_bound(row[k].index, row[k].index + row[k].size, lower_bound);
-        }
-        for (int k = 0; k < K; ++k) {
-          if (p[k] != row[k].index + row[k].size && *p[k] < upper_bound) {
-            CHECK_LT(*p[k],
-              static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
-            if (static_cast<int32_t>(*p[k]) <= split_cond) {
-              left.push_back(rid[k]);
-            } else {
-              right.push_back(rid[k]);
-            }
-          } else {
-            if (default_left) {
-              left.push_back(rid[k]);
-            } else {
-              right.push_back(rid[k]);
-            }
-          }
-        }
-      }
-      for (size_t i = nrows - rest; i < nrows; ++i) {
-        const size_t rid = rowset.begin[i];
-        const auto row = gmat[rid];
-        const auto p = std::lower_bound(row.index, row.index + row.size, lower_bound);
-        auto& left = row_split_tloc[0].left;
-        auto& right = row_split_tloc[0].right;
-        if (p != row.index + row.size && *p < upper_bound) {
-          CHECK_LT(*p, static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
-          if (static_cast<int32_t>(*p) <= split_cond) {
-            left.push_back(rid);
-          } else {
-            right.push_back(rid);
-          }
-        } else {
-          if (default_left) {
-            left.push_back(rid);
-          } else {
-            right.push_back(rid);
-          }
+          goes_left[i] = static_cast<int32_t>(rbin + column.index_base) <= split_cond;
         }
       }
     }
@@ -699,13 +1333,13 @@ class FastHistMaker: public TreeUpdater {
     template<typename T>
     inline void ApplySplitSparseData(const RowSetCollection::Elem rowset,
                                     const GHistIndexMatrix& gmat,
-                                    std::vector<RowSetCollection::Split>* p_row_split_tloc,
+                                    std::vector<uint8_t>* p_goes_left,
                                     const Column<T>& column,
                                     bst_uint lower_bound,
                                     bst_uint upper_bound,
                                     bst_int split_cond,
                                     bool default_left) {
-      std::vector<RowSetCollection::Split>& row_split_tloc = *p_row_split_tloc;
+      uint8_t* goes_left = dmlc::BeginPtr(*p_goes_left);
       const size_t nrows = rowset.end - rowset.begin;
 
       #pragma omp parallel num_threads(nthread)
@@ -719,8 +1353,6 @@ class FastHistMaker: public TreeUpdater {
                                              column.row_ind + column.len,
                                              rowset.begin[ibegin]);
 
-          auto& left = row_split_tloc[tid].left;
-          auto& right = row_split_tloc[tid].right;
           if (p != column.row_ind + column.len && *p <= rowset.begin[iend - 1]) {
             size_t cursor = p - column.row_ind;
 
@@ -735,33 +1367,15 @@ class FastHistMaker: public TreeUpdater {
                 const T rbin = column.index[cursor];
                 CHECK_LT(rbin + column.index_base,
                   static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
-                if (static_cast<int32_t>(rbin + column.index_base) <= split_cond) {
-                  left.push_back(rid);
-                } else {
-                  right.push_back(rid);
-                }
+                goes_left[i] = static_cast<int32_t>(rbin + column.index_base) <= split_cond;
                 ++cursor;
               } else {
                 // missing value
-                if (default_left) {
-                  left.push_back(rid);
-                } else {
-                  right.push_back(rid);
-                }
+                goes_left[i] = default_left;
               }
             }
           } else {  // all rows in [ibegin, iend) have missing values
-            if (default_left) {
-              for (size_t i = ibegin; i < iend; ++i) {
-                const size_t rid = rowset.begin[i];
-                left.push_back(rid);
-              }
-            } else {
-              for (size_t i = ibegin; i < iend; ++i) {
-                const size_t rid = rowset.begin[i];
-                right.push_back(rid);
-              }
-            }
+            std::fill(goes_left + ibegin, goes_left + iend, default_left);
           }
         }
       }
@@ -795,8 +1409,17 @@ class FastHistMaker: public TreeUpdater {
           }
         } else {
           const RowSetCollection::Elem e = row_set_collection_[nid];
-          for (const size_t* it = e.begin; it < e.end; ++it) {
-            stats.Add(gpair[*it]);
+          if (e.gpair != nullptr) {
+            for (size_t i = 0; i < e.size(); ++i) {
+              stats.Add(e.gpair[i]);
+            }
+          } else {
+            for (const size_t* it = e.begin; it < e.end; ++it) {
+              stats.Add(gpair[*it]);
+            }
+          }
+          if (!col_split_) {
+            histred_.Allreduce(&stats, 1);
           }
         }
         if (!tree[nid].is_root()) {
@@ -818,6 +1441,94 @@ class FastHistMaker: public TreeUpdater {
       }
     }
 
+    // gradient-based one-side sampling: keep the goss_top_rate rows with the
+    // largest |grad|, and sample goss_other_rate of all the rows from the
+    // others, with their gradients scaled in goss_gpair_ so that the sums stay
+    // unbiased. The rows with the threshold gradient are kept with the
+    // probability that fills the top rows, and sampled as the others otherwise.
+    // The rows are taken in blocks of a fixed size, with a random engine per
+    // block, so the sample does not depend on the number of threads.
+    inline void SampleGOSS(const std::vector<bst_gpair>& gpair,
+                           common::FirstTouchVector<size_t>* p_rows) {
+      CHECK_LE(param.goss_top_rate + param.goss_other_rate, 1.0f + 1e-6f)
+          << "goss_top_rate + goss_other_rate must not be larger than 1";
+      const size_t nrow = gpair.size();
+      const bst_omp_uint nrow_omp = static_cast<bst_omp_uint>(nrow);
+      // |grad| of the rows, -1 for the deleted ones
+      std::vector<float> abs_grad(nrow);
+      size_t nvalid = 0;
+      #pragma omp parallel for num_threads(nthread) schedule(static) reduction(+:nvalid)
+      for (bst_omp_uint i = 0; i < nrow_omp; ++i) {
+        const bool valid = gpair[i].GetHess() >= 0.0f;
+        abs_grad[i] = valid ? std::fabs(gpair[i].GetGrad()) : -1.0f;
+        nvalid += valid;
+      }
+      const size_t ntop = std::min(
+          static_cast<size_t>(std::ceil(param.goss_top_rate * nvalid)), nvalid);
+      float threshold = std::numeric_limits<float>::infinity();
+      double keep_tie = 0.0;
+      if (ntop > 0) {
+        std::vector<float> sorted(abs_grad);
+        std::nth_element(sorted.begin(), sorted.begin() + (ntop - 1), sorted.end(),
+                         std::greater<float>());
+        threshold = sorted[ntop - 1];
+        size_t nabove = 0, ntie = 0;
+        #pragma omp parallel for num_threads(nthread) schedule(static) \
+            reduction(+:nabove, ntie)
+        for (bst_omp_uint i = 0; i < nrow_omp; ++i) {
+          nabove += abs_grad[i] > threshold;
+          ntie += abs_grad[i] == threshold;
+        }
+        keep_tie = static_cast<double>(ntop - nabove) / ntie;
+      }
+      const double rest = 1.0 - param.goss_top_rate;
+      const double sample_rate = rest > 1e-6 ?
+          std::min(1.0, param.goss_other_rate / rest) : 0.0;
+      const float scale = sample_rate > 0.0 ? static_cast<float>(1.0 / sample_rate) : 0.0f;
+
+      const size_t kBlockRows = 1 << 14;
+      const size_t nblock = (nrow + kBlockRows - 1) / kBlockRows;
+      const bst_omp_uint nblock_omp = static_cast<bst_omp_uint>(nblock);
+      const uint32_t seed = static_cast<uint32_t>(common::GlobalRandom()());
+      goss_gpair_.resize(nrow);
+      std::vector<size_t> block_begin(nblock + 1, 0);
+      // the gradients of the rows of each block, hess -1 for the dropped rows
+      #pragma omp parallel for num_threads(nthread) schedule(static)
+      for (bst_omp_uint b = 0; b < nblock_omp; ++b) {
+        common::RandomEngine rnd(seed + b);
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        size_t nkept = 0;
+        const size_t end = std::min(nrow, (b + 1) * kBlockRows);
+        for (size_t i = b * kBlockRows; i < end; ++i) {
+          bst_gpair g(0.0f, -1.0f);
+          if (abs_grad[i] > threshold ||
+              (abs_grad[i] == threshold && coin(rnd) < keep_tie)) {
+            g = gpair[i];
+          } else if (abs_grad[i] >= 0.0f && coin(rnd) < sample_rate) {
+            g = bst_gpair(gpair[i].GetGrad() * scale, gpair[i].GetHess() * scale);
+          }
+          goss_gpair_[i] = g;
+          nkept += g.GetHess() >= 0.0f;
+        }
+        block_begin[b + 1] = nkept;
+      }
+      for (size_t b = 0; b < nblock; ++b) block_begin[b + 1] += block_begin[b];
+      auto& rows = *p_rows;
+      rows.resize(block_begin[nblock]);
+      #pragma omp parallel for num_threads(nthread) schedule(static)
+      for (bst_omp_uint b = 0; b < nblock_omp; ++b) {
+        size_t k = block_begin[b];
+        const size_t end = std::min(nrow, (b + 1) * kBlockRows);
+        for (size_t i = b * kBlockRows; i < end; ++i) {
+          if (goss_gpair_[i].GetHess() >= 0.0f) {
+            rows[k++] = i;
+          } else {
+            goss_gpair_[i] = bst_gpair();
+          }
+        }
+      }
+    }
+
     // enumerate the split values of specific feature
     inline void EnumerateSplit(int d_step,
                                const GHistIndexMatrix& gmat,
@@ -925,9 +1636,54 @@ class FastHistMaker: public TreeUpdater {
     std::vector<bst_uint> feat_index;
     // the internal row sets
     RowSetCollection row_set_collection_;
-    // the temp space for split
-    std::vector<RowSetCollection::Split> row_split_tloc_;
+    // the gradients of the rows sampled by goss, zero for the others
+    std::vector<bst_gpair> goss_gpair_;
+    // the gradients summed in the root histogram of the previous tree, and the
+    // histogram, for incremental_root_histogram
+    std::vector<bst_gpair> root_gpair_;
+    std::vector<GHistEntry> root_hist_;
+    // the changes of the gradients of the changed rows, and these rows
+    std::vector<bst_gpair> root_delta_;
+    std::vector<size_t> root_changed_;
+    std::vector<std::vector<size_t> > root_changed_tloc_;
+    // the features of the root, the version of the bins of the root histogram,
+    // and the number of trees whose root was updated since it was built
+    common::BitMap root_features_;
+    uint64_t root_version_;
+    int root_reuse_;
+    // trees after which the root is built again, so that the rounding errors
+    // of the updates do not add up
+    static const int kRootHistRefresh = 64;
+    // the temp space for split: whether each row of the node goes left
+    std::vector<uint8_t> goes_left_;
     std::vector<SplitEntry> best_split_tloc_;
+    // the nodes split at a level and their children, kept across the levels
+    std::vector<int> split_nodes_, children_;
+    // the nodes whose histogram is built or subtracted, with their rows and histograms
+    std::vector<int> build_nodes_, subtract_nodes_, subtract_parents_;
+    std::vector<RowSetCollection::Elem> build_rows_;
+    std::vector<GHistRow> build_hist_, self_hist_, sibling_hist_, parent_hist_;
+    // scratch of a level
+    common::Arena arena_;
+    // quantized matrix of external memory data, nullptr when it is in memory
+    GHistIndexPagedMatrix* pages_;
+    // version of the bins of the tree being built
+    uint64_t data_version_;
+    // whether the nodes keep the bitmap of their features, on very sparse data
+    bool use_node_features_;
+    // feature of each bin
+    std::vector<bst_uint> feature_of_bin_;
+    // features with entries among the rows of each node, a superset of them
+    // for the children obtained by subtraction
+    std::vector<common::BitMap> node_features_;
+    // whether each worker has all the rows and some of the features
+    bool col_split_;
+    // rows of a split node not going the default way, on column split
+    common::BitMap split_rows_;
+    // reducer of the best splits over the workers, on column split
+    rabit::Reducer<SplitEntry, SplitEntry::Reduce> split_reducer_;
+    // reducer of the node statistics over the workers
+    rabit::Reducer<TStats, TStats::Reduce> histred_;
     /*! \brief TreeNode Data: statistics for each constructed node */
     std::vector<NodeEntry> snode;
     /*! \brief culmulative histogram of gradients. */
@@ -940,6 +1696,7 @@ class FastHistMaker: public TreeUpdater {
 
     GHistBuilder hist_builder_;
     std::unique_ptr<TreeUpdater> pruner_;
+    common::Monitor monitor_;
 
     // back pointers to tree and data matrix
     const RegTree* p_last_tree_;
@@ -957,7 +1714,24 @@ class FastHistMaker: public TreeUpdater {
     DataLayout data_layout_;
   };
 
-  std::unique_ptr<Builder> builder_;
+  template <typename GradientSumT>
+  inline void UpdateTrees(std::unique_ptr<Builder<GradientSumT> >* p_builder,
+                          HostDeviceVector<bst_gpair>* gpair,
+                          DMatrix* dmat,
+                          const std::vector<RegTree*>& trees) {
+    if (!*p_builder) {
+      p_builder->reset(new Builder<GradientSumT>(param, fhparam, std::move(pruner_)));
+    }
+    for (size_t i = 0; i < trees.size(); ++i) {
+      (*p_builder)->Update(qdata_->gmat, qdata_->gmatb, qdata_->column_matrix,
+                           qdata_->paged ? &qdata_->gpages : nullptr, qdata_->version,
+                           gpair, dmat, trees[i]);
+    }
+  }
+
+  // one of them is used, according to fhparam.single_precision_histogram
+  std::unique_ptr<Builder<float> > float_builder_;
+  std::unique_ptr<Builder<double> > double_builder_;
   std::unique_ptr<TreeUpdater> pruner_;
 };
 
@@ -989,6 +1763,17 @@ class FastHistTreeUpdaterSwitch : public TreeUpdater {
     inner_->Update(gpair, data, trees);
   }
 
+  bool UpdatePredictionCache(const DMatrix* data,
+                             HostDeviceVector<bst_float>* out_preds) override {
+    return inner_ != nullptr && inner_->UpdatePredictionCache(data, out_preds);
+  }
+
+  bool ShareWith(TreeUpdater* other) override {
+    auto* updater = dynamic_cast<FastHistTreeUpdaterSwitch*>(other);
+    if (updater == nullptr || inner_ == nullptr || updater->inner_ == nullptr) return false;
+    return inner_->ShareWith(updater->inner_.get());
+  }
+
  private:
   //  monotone constraints
   bool monotone_;
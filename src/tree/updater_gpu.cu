@@ -2,6 +2,7 @@
  * Copyright 2017 XGBoost contributors
  */
 #include <xgboost/tree_updater.h>
+#include <algorithm>
 #include <utility>
 #include <vector>
 #include "param.h"
@@ -427,7 +428,7 @@ __global__ void fillDefaultNodeIds(node_id_t* nodeIdsPerInst,
   nodeIdsPerInst[id] = result;
 }
 
-__global__ void assignNodeIds(node_id_t* nodeIdsPerInst, int* nodeLocations,
+__global__ void assignNodeIds(node_id_t* nodeIdsPerInst,
                               const node_id_t* nodeIds, const int* instId,
                               const DeviceNodeStats* nodes,
                               const int* colOffsets, const float* vals,
@@ -435,8 +436,6 @@ __global__ void assignNodeIds(node_id_t* nodeIdsPerInst, int* nodeLocations,
   int id = threadIdx.x + (blockIdx.x * blockDim.x);
   const int stride = blockDim.x * gridDim.x;
   for (; id < nVals; id += stride) {
-    // fusing generation of indices for node locations
-    nodeLocations[id] = id;
     // using nodeIds here since the previous kernel would have updated
     // the nodeIdsPerInst with all default assignments
     int nId = nodeIds[id];
@@ -456,6 +455,84 @@ __global__ void assignNodeIds(node_id_t* nodeIdsPerInst, int* nodeLocations,
   }
 }
 
+/**
+ * @brief Start of the run of an element, the run being its elements of the
+ *  same column whose nodes have the same parent. The elements of a run are
+ *  contiguous since they were at the same node on the level before.
+ */
+struct RunHead {
+  const node_id_t* nodeAssigns;
+  const int* colIds;
+  HOST_DEV_INLINE int operator()(int id) const {
+    if (id == 0 || colIds[id] != colIds[id - 1]) return id;
+    return parent(nodeAssigns[id]) != parent(nodeAssigns[id - 1]) ? id : 0;
+  }
+  HOST_DEV_INLINE static node_id_t parent(node_id_t nId) {
+    return nId == UNUSED_NODE ? UNUSED_NODE : parent_nidx(nId);
+  }
+};
+
+/** @brief whether an element goes to a left child, they have odd ids */
+struct IsLeftChild {
+  const node_id_t* nodeAssigns;
+  HOST_DEV_INLINE int operator()(int id) const {
+    const node_id_t nId = nodeAssigns[id];
+    return nId != UNUSED_NODE && (nId & 1);
+  }
+};
+
+/**
+ * @brief Writes the number of elements going left of every run at the start
+ *  of the run
+ * @param runLefts the output left counts, indexed by run start
+ * @param runStarts the start of the run of each element
+ * @param leftScan inclusive sum of the elements going left
+ * @param nVals number of elements
+ */
+__global__ void countRunLefts(int* runLefts, const int* runStarts,
+                              const int* leftScan, int nVals) {
+  int id = threadIdx.x + (blockIdx.x * blockDim.x);
+  const int stride = blockDim.x * gridDim.x;
+  for (; id < nVals; id += stride) {
+    if (id == nVals - 1 || runStarts[id + 1] != runStarts[id]) {
+      int start = runStarts[id];
+      runLefts[start] = leftScan[id] - (start > 0 ? leftScan[start - 1] : 0);
+    }
+  }
+}
+
+/**
+ * @brief Stable partition of every run, the elements going left first then
+ *  the ones going right. The runs of unused elements stay where they are.
+ * @param nodeAssignsOut the node ids in the partitioned order
+ * @param nodeLocations the position before the partition of each element
+ * @param nodeAssigns the node ids
+ * @param runStarts the start of the run of each element
+ * @param leftScan inclusive sum of the elements going left
+ * @param runLefts the number of elements going left of each run
+ * @param nVals number of elements
+ */
+__global__ void partitionRuns(node_id_t* nodeAssignsOut, int* nodeLocations,
+                              const node_id_t* nodeAssigns,
+                              const int* runStarts, const int* leftScan,
+                              const int* runLefts, int nVals) {
+  int id = threadIdx.x + (blockIdx.x * blockDim.x);
+  const int stride = blockDim.x * gridDim.x;
+  for (; id < nVals; id += stride) {
+    node_id_t nId = nodeAssigns[id];
+    int dest = id;
+    if (nId != UNUSED_NODE) {
+      int start = runStarts[id];
+      // elements going left in the run up to this one
+      int lefts = leftScan[id] - (start > 0 ? leftScan[start - 1] : 0);
+      dest = (nId & 1) ? start + lefts - 1
+                       : start + runLefts[start] + (id - start) - lefts;
+    }
+    nodeAssignsOut[dest] = nId;
+    nodeLocations[dest] = id;
+  }
+}
+
 __global__ void markLeavesKernel(DeviceNodeStats* nodes, int len) {
   int id = (blockIdx.x * blockDim.x) + threadIdx.x;
   if ((id < len) && !nodes[id].IsUnused()) {
@@ -484,7 +561,12 @@ class GPUMaker : public TreeUpdater {
   dh::dvec<int> colOffsets;
   dh::dvec<bst_gpair> gradsInst;
   dh::dvec2<node_id_t> nodeAssigns;
+  /** position before the partition of each element, and a scratch buffer */
   dh::dvec2<int> nodeLocations;
+  /** start of the run of each element during the partition */
+  dh::dvec<int> runStarts;
+  /** inclusive sum of the elements going left during the partition */
+  dh::dvec<int> leftScan;
   dh::dvec<DeviceNodeStats> nodes;
   dh::dvec<node_id_t> nodeAssignsPerInst;
   dh::dvec<bst_gpair> gradSums;
@@ -618,7 +700,8 @@ class GPUMaker : public TreeUpdater {
     ba.allocate(dh::get_device_idx(param.gpu_id), param.silent, &vals, nVals,
                 &vals_cached, nVals, &instIds, nVals, &instIds_cached, nVals,
                 &colOffsets, offsetSize, &gradsInst, nRows, &nodeAssigns, nVals,
-                &nodeLocations, nVals, &nodes, maxNodes, &nodeAssignsPerInst,
+                &nodeLocations, nVals, &runStarts, nVals, &leftScan, nVals,
+                &nodes, maxNodes, &nodeAssignsPerInst,
                 nRows, &gradSums, maxLeaves * nCols, &gradScans, nVals,
                 &nodeSplits, maxLeaves, &tmpScanGradBuff, tmpBuffSize,
                 &tmpScanKeyBuff, tmpBuffSize, &colIds, nVals);
@@ -689,7 +772,7 @@ class GPUMaker : public TreeUpdater {
 
   void transferGrads(HostDeviceVector<bst_gpair>* gpair) {
     // HACK
-    dh::safe_cuda(cudaMemcpy(gradsInst.data(), gpair->ptr_d(param.gpu_id),
+    dh::safe_cuda(cudaMemcpy(gradsInst.data(), gpair->const_ptr_d(param.gpu_id),
                              sizeof(bst_gpair) * nRows,
                              cudaMemcpyDefault));
     // evaluate the full-grad reduction for the root node
@@ -721,21 +804,45 @@ class GPUMaker : public TreeUpdater {
       // evaluate the correct child indices of non-missing values next
       nBlks = dh::div_round_up(nVals, BlkDim * ItemsPerThread);
       assignNodeIds<<<nBlks, BlkDim>>>(
-          nodeAssignsPerInst.data(), nodeLocations.current(),
-          nodeAssigns.current(), instIds.current(), nodes.data(),
-          colOffsets.data(), vals.current(), nVals, nCols);
+          nodeAssignsPerInst.data(), nodeAssigns.current(), instIds.current(),
+          nodes.data(), colOffsets.data(), vals.current(), nVals, nCols);
       // gather the node assignments across all other columns too
       dh::gather(dh::get_device_idx(param.gpu_id), nodeAssigns.current(),
                  nodeAssignsPerInst.data(), instIds.current(), nVals);
-      sortKeys(level);
+      partitionKeys();
     }
   }
 
-  void sortKeys(int level) {
-    // segmented-sort the arrays based on node-id's
-    // but we don't need more than level+1 bits for sorting!
-    segmentedSort(&tmp_mem, &nodeAssigns, &nodeLocations, nVals, nCols,
-                  colOffsets, 0, level + 1);
+  void partitionKeys() {
+    // the values of a column stay sorted within each node from the presorted
+    // order, the elements of a node at the level before only have to be
+    // partitioned between its two children
+    const int BlkDim = 256;
+    const int ItemsPerThread = 4;
+    cub::CountingInputIterator<int> ids(0);
+    cub::TransformInputIterator<int, RunHead, cub::CountingInputIterator<int>>
+        heads(ids, RunHead{nodeAssigns.current(), colIds.data()});
+    cub::TransformInputIterator<int, IsLeftChild,
+                                cub::CountingInputIterator<int>>
+        lefts(ids, IsLeftChild{nodeAssigns.current()});
+    size_t maxSize, sumSize;
+    dh::safe_cuda(cub::DeviceScan::InclusiveScan(
+        NULL, maxSize, heads, runStarts.data(), cub::Max(), nVals));
+    dh::safe_cuda(cub::DeviceScan::InclusiveSum(NULL, sumSize, lefts,
+                                                leftScan.data(), nVals));
+    tmp_mem.LazyAllocate(std::max(maxSize, sumSize));
+    dh::safe_cuda(cub::DeviceScan::InclusiveScan(
+        tmp_mem.d_temp_storage, maxSize, heads, runStarts.data(), cub::Max(),
+        nVals));
+    dh::safe_cuda(cub::DeviceScan::InclusiveSum(
+        tmp_mem.d_temp_storage, sumSize, lefts, leftScan.data(), nVals));
+    int nBlks = dh::div_round_up(nVals, BlkDim * ItemsPerThread);
+    countRunLefts<<<nBlks, BlkDim>>>(nodeLocations.other(), runStarts.data(),
+                                     leftScan.data(), nVals);
+    partitionRuns<<<nBlks, BlkDim>>>(
+        nodeAssigns.other(), nodeLocations.current(), nodeAssigns.current(),
+        runStarts.data(), leftScan.data(), nodeLocations.other(), nVals);
+    nodeAssigns.buff().selector ^= 1;
     dh::gather<float, int>(dh::get_device_idx(param.gpu_id), vals.other(),
                            vals.current(), instIds.other(), instIds.current(),
                            nodeLocations.current(), nVals);
@@ -2,9 +2,16 @@
  * Copyright 2017 XGBoost contributors
  */
 #pragma once
+#include <thrust/count.h>
+#include <thrust/device_vector.h>
+#include <thrust/functional.h>
 #include <thrust/random.h>
+#include <thrust/sort.h>
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <cub/cub.cuh>
+#include <limits>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -377,6 +384,62 @@ inline void subsample_gpair(dh::dvec<bst_gpair>* p_gpair, float subsample,
   });
 }
 
+// Gradient-based one-side sampling: keep the top_rate rows with the largest
+// |grad|, sample other_rate of all the rows from the others and scale their
+// gradients by (1 - top_rate) / other_rate, set the gradients of the rest to 0.
+// The rows with the threshold gradient are kept with the probability that
+// fills the top rows, and sampled as the others otherwise.
+inline void goss_gpair(dh::dvec<bst_gpair>* p_gpair, float top_rate,
+                       float other_rate, int offset = 0) {
+  CHECK_LE(top_rate + other_rate, 1.0f + 1e-6f)
+      << "goss_top_rate + goss_other_rate must not be larger than 1";
+  dh::dvec<bst_gpair>& gpair = *p_gpair;
+  const size_t n = gpair.size();
+  if (n == 0) return;
+  auto d_gpair = gpair.data();
+
+  thrust::device_vector<float> abs_grad(n);
+  float* d_abs_grad = abs_grad.data().get();
+  dh::launch_n(gpair.device_idx(), n, [=] __device__(size_t i) {
+    d_abs_grad[i] = fabsf(d_gpair[i].GetGrad());
+  });
+  const size_t ntop =
+      std::min(static_cast<size_t>(std::ceil(top_rate * n)), n);
+  float threshold = std::numeric_limits<float>::infinity();
+  float keep_tie = 0.0f;
+  if (ntop > 0) {
+    thrust::device_vector<float> sorted(abs_grad);
+    thrust::sort(sorted.begin(), sorted.end(), thrust::greater<float>());
+    threshold = sorted[ntop - 1];
+    const size_t nabove = thrust::count_if(
+        abs_grad.begin(), abs_grad.end(),
+        [=] __device__(float g) { return g > threshold; });
+    const size_t ntie = thrust::count(abs_grad.begin(), abs_grad.end(), threshold);
+    keep_tie = static_cast<float>(ntop - nabove) / ntie;
+  }
+  const float rest = 1.0f - top_rate;
+  const float sample_rate = rest > 1e-6f ? std::min(1.0f, other_rate / rest) : 0.0f;
+  const float scale = sample_rate > 0.0f ? 1.0f / sample_rate : 0.0f;
+  const uint32_t seed = static_cast<uint32_t>(common::GlobalRandom()());
+
+  dh::launch_n(gpair.device_idx(), n, [=] __device__(size_t i) {
+    // two draws per row, at the place of the global row in the stream
+    thrust::default_random_engine rng(seed);
+    thrust::uniform_real_distribution<float> dist;
+    rng.discard(2 * (i + offset));
+    const float g = d_abs_grad[i];
+    const bool tie_kept = g == threshold && dist(rng) < keep_tie;
+    if (g > threshold || tie_kept) return;
+    if (g == threshold) dist(rng);
+    if (dist(rng) < sample_rate) {
+      d_gpair[i] = bst_gpair(d_gpair[i].GetGrad() * scale,
+                             d_gpair[i].GetHess() * scale);
+    } else {
+      d_gpair[i] = bst_gpair();
+    }
+  });
+}
+
 inline std::vector<int> col_sample(std::vector<int> features, float colsample) {
   CHECK_GT(features.size(), 0);
   int n = std::max(1, static_cast<int>(colsample * features.size()));
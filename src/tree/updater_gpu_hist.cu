@@ -1,11 +1,16 @@
 /*!
  * Copyright 2017 XGBoost contributors
  */
+#include <thrust/binary_search.h>
 #include <thrust/execution_policy.h>
+#include <thrust/functional.h>
 #include <thrust/reduce.h>
 #include <thrust/sequence.h>
+#include <thrust/transform_reduce.h>
 #include <xgboost/tree_updater.h>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <memory>
 #include <queue>
 #include <utility>
@@ -191,10 +196,19 @@ __device__ int BinarySearchRow(bst_uint begin, bst_uint end, gidx_iter_t data,
 struct DeviceHistogram {
   dh::bulk_allocator<dh::memory_type::DEVICE> ba;
   dh::dvec<gpair_sum_t> data;
+  // fixed point sums of the gradients and hessians of the nodes being
+  // built, in the layout of data, with quantized gradients only
+  dh::dvec<int64_t> quantized;
   int n_bins;
-  void Init(int device_idx, int max_nodes, int n_bins, bool silent) {
+  void Init(int device_idx, int max_nodes, int n_bins, bool silent,
+            bool with_quantized = false) {
     this->n_bins = n_bins;
-    ba.allocate(device_idx, silent, &data, size_t(max_nodes) * size_t(n_bins));
+    const size_t n = size_t(max_nodes) * size_t(n_bins);
+    if (with_quantized) {
+      ba.allocate(device_idx, silent, &data, n, &quantized, n * 2);
+    } else {
+      ba.allocate(device_idx, silent, &data, n);
+    }
   }
 
   void Reset() { data.fill(gpair_sum_t()); }
@@ -222,6 +236,147 @@ struct CalcWeightTrainParam {
       learning_rate(p.learning_rate) {}
 };
 
+// The partition of the rows of a node by its split, in bins
+struct PositionSplit {
+  int nidx;
+  int left_nidx;
+  int right_nidx;
+  int fidx;
+  int split_gidx;
+  bool default_dir_left;
+  int fidx_begin;
+  int fidx_end;
+};
+
+// The rows of one node in a kernel fused over several nodes: the items of
+// the node start at offset in the index space of the kernel, its rows at
+// ridx_begin in the row indices
+struct FusedNode {
+  size_t offset;
+  bst_uint ridx_begin;
+  int node;
+};
+
+// Index of the fused node of item idx, the last one starting at or before it
+__device__ int FindFusedNode(const FusedNode* d_nodes, int n_nodes,
+                             size_t idx) {
+  int begin = 0;
+  int end = n_nodes;
+  while (end - begin > 1) {
+    int middle = begin + (end - begin) / 2;
+    if (d_nodes[middle].offset <= idx) {
+      begin = middle;
+    } else {
+      end = middle;
+    }
+  }
+  return begin;
+}
+
+// Gradients in fixed point, with scales chosen for each iteration from the
+// largest gradient and hessian of a shard so that the sums over all its rows
+// fit in 63 bits. Integer sums do not depend on the order of the atomics, so
+// the histograms are the same from run to run.
+struct GradientQuantizer {
+  double grad_scale;
+  double hess_scale;
+  GradientQuantizer() : grad_scale(1.0), hess_scale(1.0) {}
+  GradientQuantizer(float max_grad, float max_hess, size_t n_rows) {
+    const double range =
+        std::ldexp(1.0, 62) / static_cast<double>(std::max<size_t>(n_rows, 1));
+    grad_scale = max_grad > 0.0f ? range / max_grad : 1.0;
+    hess_scale = max_hess > 0.0f ? range / max_hess : 1.0;
+  }
+  __device__ int64_t Grad(const bst_gpair& g) const {
+    return __double2ll_rn(g.GetGrad() * grad_scale);
+  }
+  __device__ int64_t Hess(const bst_gpair& g) const {
+    return __double2ll_rn(g.GetHess() * hess_scale);
+  }
+};
+
+// Adds gradient pairs into histogram bins of two values, sum_grad and
+// sum_hess, in double precision
+struct FloatAccumulator {
+  typedef gpair_sum_t::value_t value_t;
+  __device__ void operator()(value_t* bin, const bst_gpair& g) const {
+    atomicAdd(bin, static_cast<value_t>(g.GetGrad()));
+    atomicAdd(bin + 1, static_cast<value_t>(g.GetHess()));
+  }
+  __device__ static void AtomicAdd(value_t* dest, value_t v) {
+    atomicAdd(dest, v);
+  }
+};
+
+// Same, in the fixed point of a quantizer
+struct QuantizedAccumulator {
+  typedef int64_t value_t;
+  GradientQuantizer quantizer;
+  explicit QuantizedAccumulator(GradientQuantizer quantizer)
+      : quantizer(quantizer) {}
+  __device__ void operator()(value_t* bin, const bst_gpair& g) const {
+    AtomicAdd(bin, quantizer.Grad(g));
+    AtomicAdd(bin + 1, quantizer.Hess(g));
+  }
+  __device__ static void AtomicAdd(value_t* dest, value_t v) {
+    atomicAdd(reinterpret_cast<unsigned long long*>(dest),  // NOLINT
+              static_cast<unsigned long long>(v));          // NOLINT
+  }
+};
+
+// Histogram kernel privatized in shared memory: every block adds the items
+// [begin, begin + items_per_block) of one node into a histogram of its own
+// in shared memory, then adds its non zero bins to the histogram of the node
+// in global memory. The blocks of fused node n start at d_block_begin[n].
+template <typename AccumulatorT>
+__global__ void SharedMemHistKernel(
+    const FusedNode* d_nodes, const int* d_block_begin, int n_nodes,
+    size_t n_items, size_t items_per_block, const bst_uint* d_ridx,
+    common::CompressedIterator<uint32_t> d_gidx, bst_uint page_begin,
+    int row_stride, int null_gidx_value, const bst_gpair* d_gpair,
+    typename AccumulatorT::value_t* d_hist, int n_bins,
+    AccumulatorT accumulator) {
+  typedef typename AccumulatorT::value_t value_t;
+  extern __shared__ char shared_memory[];
+  value_t* s_hist = reinterpret_cast<value_t*>(shared_memory);
+  for (int i = threadIdx.x; i < 2 * n_bins; i += blockDim.x) {
+    s_hist[i] = 0;
+  }
+  __syncthreads();
+
+  int n = 0;
+  int end_node = n_nodes;
+  while (end_node - n > 1) {
+    int middle = n + (end_node - n) / 2;
+    if (d_block_begin[middle] <= static_cast<int>(blockIdx.x)) {
+      n = middle;
+    } else {
+      end_node = middle;
+    }
+  }
+  const FusedNode node = d_nodes[n];
+  const size_t node_end = n + 1 < n_nodes ? d_nodes[n + 1].offset : n_items;
+  const size_t begin =
+      node.offset + (blockIdx.x - d_block_begin[n]) * items_per_block;
+  const size_t end =
+      begin + items_per_block < node_end ? begin + items_per_block : node_end;
+  for (size_t idx = begin + threadIdx.x; idx < end; idx += blockDim.x) {
+    size_t local_idx = idx - node.offset;
+    int ridx = d_ridx[node.ridx_begin + local_idx / row_stride];
+    int gidx =
+        d_gidx[(ridx - page_begin) * row_stride + local_idx % row_stride];
+    if (gidx != null_gidx_value) {
+      accumulator(s_hist + 2 * gidx, d_gpair[ridx]);
+    }
+  }
+  __syncthreads();
+
+  value_t* d_node_hist = d_hist + 2 * static_cast<size_t>(node.node) * n_bins;
+  for (int i = threadIdx.x; i < 2 * n_bins; i += blockDim.x) {
+    if (s_hist[i] != 0) AccumulatorT::AtomicAdd(d_node_hist + i, s_hist[i]);
+  }
+}
+
 // Manage memory for a single GPU
 struct DeviceShard {
   struct Segment {
@@ -262,7 +417,30 @@ struct DeviceShard {
   TrainParam param;
   bool prediction_cache_initialised;
 
-  int64_t* tmp_pinned;  // Small amount of staging memory
+  // Paged mode: the compressed matrix stays in pinned host memory and is
+  // streamed to the device one page of rows at a time, double buffered in
+  // gidx_buffer
+  bool paged;
+  bst_uint page_rows;  // Rows per page, n_rows when not paged
+  size_t page_bytes;   // Size of one compressed page
+  int num_symbols;
+  common::compressed_byte_t* host_pages;
+  dh::dvec<bst_uint> page_row_begin;  // First row of each page
+  dh::dvec<bst_uint> page_bounds;
+  cudaStream_t copy_stream;
+  cudaEvent_t page_copied[2];
+  cudaEvent_t page_used[2];
+
+  // Nodes of the current fused kernel and the splits of UpdatePosition
+  std::vector<FusedNode> h_fused_nodes;
+  dh::device_vector<FusedNode> fused_nodes;
+  // First block of each fused node in the shared memory histogram kernel
+  dh::device_vector<int> fused_blocks;
+  // Shared memory of a block of this device, and the quantizer of the
+  // gradients of the current iteration
+  size_t max_shared_memory;
+  GradientQuantizer quantizer;
+  dh::device_vector<PositionSplit> position_splits;
 
   std::vector<cudaStream_t> streams;
 
@@ -279,7 +457,8 @@ struct DeviceShard {
         n_bins(n_bins),
         null_gidx_value(n_bins),
         param(param),
-        prediction_cache_initialised(false) {
+        prediction_cache_initialised(false),
+        host_pages(nullptr) {
     // Convert to ELLPACK matrix representation
     int max_elements_row = 0;
     for (auto i = row_begin; i < row_end; i++) {
@@ -300,22 +479,30 @@ struct DeviceShard {
     }
 
     // Allocate
-    int num_symbols = n_bins + 1;
-    size_t compressed_size_bytes =
-        common::CompressedBufferWriter::CalculateBufferSize(
-            ellpack_matrix.size(), num_symbols);
+    num_symbols = n_bins + 1;
+    paged = param.gpu_page_rows > 0 &&
+            static_cast<bst_uint>(param.gpu_page_rows) < n_rows;
+    page_rows = paged ? param.gpu_page_rows : n_rows;
+    page_bytes = common::CompressedBufferWriter::CalculateBufferSize(
+        static_cast<size_t>(page_rows) * row_stride, num_symbols);
+    size_t compressed_size_bytes = paged ? page_bytes * 2 : page_bytes;
 
     CHECK(!(param.max_leaves == 0 && param.max_depth == 0))
         << "Max leaves and max depth cannot both be unconstrained for "
            "gpu_hist.";
     int max_nodes =
         param.max_leaves > 0 ? param.max_leaves * 2 : n_nodes(param.max_depth);
+    if (param.gpu_managed_memory) {
+      ba.set_memory_type(dh::memory_type::DEVICE_MANAGED);
+    }
     ba.allocate(device_idx, param.silent, &gidx_buffer, compressed_size_bytes,
                 &gpair, n_rows, &ridx, n_rows, &position, n_rows,
                 &prediction_cache, n_rows, &node_sum_gradients_d, max_nodes,
                 &feature_segments, gmat.cut->row_ptr.size(), &gidx_fvalue_map,
                 gmat.cut->cut.size(), &min_fvalue, gmat.cut->min_val.size(),
-                &monotone_constraints, param.monotone_constraints.size());
+                &monotone_constraints, param.monotone_constraints.size(),
+                &page_row_begin, this->NumPages(), &page_bounds,
+                this->NumPages());
     gidx_fvalue_map = gmat.cut->cut;
     min_fvalue = gmat.cut->min_val;
     feature_segments = gmat.cut->row_ptr;
@@ -326,26 +513,128 @@ struct DeviceShard {
 
     // Compress gidx
     common::CompressedBufferWriter cbw(num_symbols);
-    std::vector<common::compressed_byte_t> host_buffer(gidx_buffer.size());
-    cbw.Write(host_buffer.data(), ellpack_matrix.begin(), ellpack_matrix.end());
-    gidx_buffer = host_buffer;
-    gidx =
-        common::CompressedIterator<uint32_t>(gidx_buffer.data(), num_symbols);
-
-    common::CompressedIterator<uint32_t> ci_host(host_buffer.data(),
-                                                 num_symbols);
+    if (paged) {
+      std::vector<bst_uint> h_page_row_begin(this->NumPages());
+      dh::safe_cuda(
+          cudaMallocHost(&host_pages, page_bytes * this->NumPages()));
+      std::memset(host_pages, 0, page_bytes * this->NumPages());
+      for (size_t p = 0; p < this->NumPages(); ++p) {
+        h_page_row_begin[p] = static_cast<bst_uint>(p * page_rows);
+        size_t row_end = std::min(static_cast<size_t>(n_rows),
+                                  (p + 1) * static_cast<size_t>(page_rows));
+        cbw.Write(host_pages + p * page_bytes,
+                  ellpack_matrix.begin() + h_page_row_begin[p] * row_stride,
+                  ellpack_matrix.begin() + row_end * row_stride);
+      }
+      page_row_begin = h_page_row_begin;
+      dh::safe_cuda(
+          cudaStreamCreateWithFlags(&copy_stream, cudaStreamNonBlocking));
+      for (int i = 0; i < 2; ++i) {
+        dh::safe_cuda(cudaEventCreateWithFlags(&page_copied[i],
+                                               cudaEventDisableTiming));
+        dh::safe_cuda(
+            cudaEventCreateWithFlags(&page_used[i], cudaEventDisableTiming));
+      }
+    } else {
+      std::vector<common::compressed_byte_t> host_buffer(gidx_buffer.size());
+      cbw.Write(host_buffer.data(), ellpack_matrix.begin(),
+                ellpack_matrix.end());
+      gidx_buffer = host_buffer;
+      gidx = common::CompressedIterator<uint32_t>(gidx_buffer.data(),
+                                                  num_symbols);
+      page_row_begin.fill(0);
+    }
+    if (param.gpu_managed_memory) {
+      // the matrix is only read once compressed, the row buffers are
+      // rewritten on the device every iteration
+      gidx_buffer.advise_managed(true);
+      gpair.advise_managed(false);
+      ridx.d1().advise_managed(false);
+      ridx.d2().advise_managed(false);
+      position.d1().advise_managed(false);
+      position.d2().advise_managed(false);
+      prediction_cache.advise_managed(false);
+    }
 
     // Init histogram
-    hist.Init(device_idx, max_nodes, gmat.cut->row_ptr.back(), param.silent);
-
-    dh::safe_cuda(cudaMallocHost(&tmp_pinned, sizeof(int64_t)));
+    hist.Init(device_idx, max_nodes, gmat.cut->row_ptr.back(), param.silent,
+              param.gpu_quantized_histogram);
+    int shared_memory = 0;
+    dh::safe_cuda(cudaDeviceGetAttribute(
+        &shared_memory, cudaDevAttrMaxSharedMemoryPerBlock, device_idx));
+    max_shared_memory = static_cast<size_t>(shared_memory);
   }
 
   ~DeviceShard() {
     for (auto& stream : streams) {
       dh::safe_cuda(cudaStreamDestroy(stream));
     }
-    dh::safe_cuda(cudaFreeHost(tmp_pinned));
+    if (paged) {
+      dh::safe_cuda(cudaStreamDestroy(copy_stream));
+      for (int i = 0; i < 2; ++i) {
+        dh::safe_cuda(cudaEventDestroy(page_copied[i]));
+        dh::safe_cuda(cudaEventDestroy(page_used[i]));
+      }
+      dh::safe_cuda(cudaFreeHost(host_pages));
+    }
+  }
+
+  size_t NumPages() const {
+    return paged ? dh::div_round_up(n_rows, page_rows) : 1;
+  }
+
+  common::compressed_byte_t* PageBuffer(size_t p) {
+    return gidx_buffer.data() + (p % 2) * page_bytes;
+  }
+
+  // Queue the copy of page p on the copy stream, once the kernels reading the
+  // previous page of the same buffer are done
+  void CopyPage(size_t p) {
+    dh::safe_cuda(cudaStreamWaitEvent(copy_stream, page_used[p % 2], 0));
+    dh::safe_cuda(cudaMemcpyAsync(PageBuffer(p), host_pages + p * page_bytes,
+                                  page_bytes, cudaMemcpyHostToDevice,
+                                  copy_stream));
+    dh::safe_cuda(cudaEventRecord(page_copied[p % 2], copy_stream));
+  }
+
+  // Make page p available to the kernels queued next on the default stream
+  // and prefetch page p + 1. Pages must be visited in order, each visit is
+  // closed by EndPage.
+  common::CompressedIterator<uint32_t> BeginPage(size_t p) {
+    if (!paged) return gidx;
+    if (p == 0) this->CopyPage(0);
+    if (p + 1 < this->NumPages()) this->CopyPage(p + 1);
+    dh::safe_cuda(cudaStreamWaitEvent(nullptr, page_copied[p % 2], 0));
+    return common::CompressedIterator<uint32_t>(PageBuffer(p), num_symbols);
+  }
+
+  void EndPage(size_t p) {
+    if (!paged) return;
+    dh::safe_cuda(cudaEventRecord(page_used[p % 2], nullptr));
+  }
+
+  // Split the segments by page. The row indices of a segment are sorted, as
+  // the position sort is stable, so the rows of a page are a sub segment.
+  // Returns the sub segment of segment i in page p at p * segments.size() + i.
+  std::vector<Segment> PageSegments(const std::vector<Segment>& segments) {
+    if (!paged) return segments;
+    std::vector<Segment> result(this->NumPages() * segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+      auto segment = segments[i];
+      thrust::lower_bound(thrust::device,
+                          ridx.current_dvec().tbegin() + segment.begin,
+                          ridx.current_dvec().tbegin() + segment.end,
+                          page_row_begin.tbegin(), page_row_begin.tend(),
+                          page_bounds.tbegin());
+      auto h_bounds = page_bounds.as_vector();
+      for (size_t p = 0; p < h_bounds.size(); ++p) {
+        size_t end = p + 1 < h_bounds.size() ? segment.begin + h_bounds[p + 1]
+                                             : segment.end;
+        result[p * segments.size() + i] =
+            Segment(segment.begin + h_bounds[p], end);
+      }
+    }
+    return result;
   }
 
   // Get vector of at least n initialised streams
@@ -378,30 +667,166 @@ struct DeviceShard {
 
     std::fill(ridx_segments.begin(), ridx_segments.end(), Segment(0, 0));
     ridx_segments.front() = Segment(0, ridx.size());
+    if (param.gpu_managed_memory) {
+      // every row is read when the tree is built, migrate the buffers back
+      // in bulk rather than on page faults
+      gidx_buffer.prefetch_managed();
+      gpair.prefetch_managed();
+      ridx.d1().prefetch_managed();
+      ridx.d2().prefetch_managed();
+      position.d1().prefetch_managed();
+      position.d2().prefetch_managed();
+    }
     this->gpair.copy(begin + row_begin_idx, begin + row_end_idx);
-    subsample_gpair(&gpair, param.subsample, row_begin_idx);
+    if (param.sampling_method == TrainParam::kGOSS) {
+      goss_gpair(&gpair, param.goss_top_rate, param.goss_other_rate, row_begin_idx);
+    } else {
+      subsample_gpair(&gpair, param.subsample, row_begin_idx);
+    }
+    if (param.gpu_quantized_histogram) {
+      float max_grad = thrust::transform_reduce(
+          thrust::device, gpair.tbegin(), gpair.tend(),
+          [=] __device__(const bst_gpair& g) { return fabsf(g.GetGrad()); },
+          0.0f, thrust::maximum<float>());
+      float max_hess = thrust::transform_reduce(
+          thrust::device, gpair.tbegin(), gpair.tend(),
+          [=] __device__(const bst_gpair& g) { return fabsf(g.GetHess()); },
+          0.0f, thrust::maximum<float>());
+      quantizer = GradientQuantizer(max_grad, max_hess, n_rows);
+    }
     hist.Reset();
   }
 
-  void BuildHist(int nidx) {
-    auto segment = ridx_segments[nidx];
-    auto d_node_hist = hist.GetHistPtr(nidx);
-    auto d_gidx = gidx;
+  // Lay out the non empty segments of page p one after the other in the
+  // index space of a fused kernel, every row counts for items_per_row items.
+  // Node i of the fused kernel gets the id ids[i]. Returns the number of items.
+  size_t FuseSegments(const std::vector<Segment>& page_segments, size_t p,
+                      const std::vector<int>& ids, size_t items_per_row) {
+    std::vector<FusedNode> h_nodes;
+    size_t n_items = 0;
+    for (size_t i = 0; i < ids.size(); ++i) {
+      auto segment = page_segments[p * ids.size() + i];
+      if (segment.Size() == 0) continue;
+      FusedNode node = {n_items, static_cast<bst_uint>(segment.begin), ids[i]};
+      h_nodes.push_back(node);
+      n_items += segment.Size() * items_per_row;
+    }
+    h_fused_nodes = h_nodes;
+    fused_nodes = h_nodes;
+    return n_items;
+  }
+
+  // Add the items of the current fused kernel into d_hist, two values of the
+  // accumulator per bin. With shared memory every block privatizes the
+  // histogram of its node, otherwise each item is added to global memory.
+  template <typename AccumulatorT>
+  void BuildPageHist(AccumulatorT accumulator,
+                     typename AccumulatorT::value_t* d_hist,
+                     common::CompressedIterator<uint32_t> d_gidx,
+                     bst_uint page_begin, size_t n_items, bool shared) {
     auto d_ridx = ridx.current();
     auto d_gpair = gpair.data();
+    auto hist_stride = hist.n_bins;
     auto row_stride = this->row_stride;
     auto null_gidx_value = this->null_gidx_value;
-    auto n_elements = segment.Size() * row_stride;
-
-    dh::launch_n(device_idx, n_elements, [=] __device__(size_t idx) {
-      int ridx = d_ridx[(idx / row_stride) + segment.begin];
-      int gidx = d_gidx[ridx * row_stride + idx % row_stride];
+    auto d_nodes = dh::raw(fused_nodes);
+    int n_nodes = static_cast<int>(fused_nodes.size());
+    if (n_items == 0) return;
+
+    if (shared) {
+      const int kBlockThreads = 256;
+      const size_t kItemsPerBlock = kBlockThreads * 32;
+      std::vector<int> h_blocks(h_fused_nodes.size());
+      int n_blocks = 0;
+      for (size_t i = 0; i < h_fused_nodes.size(); ++i) {
+        size_t node_end = i + 1 < h_fused_nodes.size()
+                              ? h_fused_nodes[i + 1].offset
+                              : n_items;
+        h_blocks[i] = n_blocks;
+        n_blocks += static_cast<int>(
+            dh::div_round_up(node_end - h_fused_nodes[i].offset, kItemsPerBlock));
+      }
+      fused_blocks = h_blocks;
+      const size_t shared_bytes =
+          2 * sizeof(typename AccumulatorT::value_t) * hist_stride;
+      SharedMemHistKernel<<<n_blocks, kBlockThreads, shared_bytes>>>(
+          d_nodes, dh::raw(fused_blocks), n_nodes, n_items, kItemsPerBlock,
+          d_ridx, d_gidx, page_begin, row_stride, null_gidx_value, d_gpair,
+          d_hist, hist_stride, accumulator);
+      dh::safe_cuda(cudaGetLastError());
+      return;
+    }
+    dh::launch_n(device_idx, n_items, [=] __device__(size_t idx) {
+      const FusedNode& node = d_nodes[FindFusedNode(d_nodes, n_nodes, idx)];
+      size_t local_idx = idx - node.offset;
+      int ridx = d_ridx[node.ridx_begin + local_idx / row_stride];
+      int gidx =
+          d_gidx[(ridx - page_begin) * row_stride + local_idx % row_stride];
 
       if (gidx != null_gidx_value) {
-        AtomicAddGpair(d_node_hist + gidx, d_gpair[ridx]);
+        accumulator(d_hist + 2 * (static_cast<size_t>(node.node) * hist_stride + gidx),
+                    d_gpair[ridx]);
       }
     });
   }
+
+  // Build the histograms of the nodes, with one kernel per page. With
+  // quantized gradients the nodes are summed in fixed point and converted
+  // to the histograms once all the pages are done.
+  void BuildHist(const std::vector<int>& nidx_set) {
+    dh::safe_cuda(cudaSetDevice(device_idx));
+    std::vector<Segment> segments;
+    for (auto nidx : nidx_set) {
+      segments.push_back(ridx_segments[nidx]);
+    }
+    auto page_segments = this->PageSegments(segments);
+    const bool quantized = param.gpu_quantized_histogram;
+    const size_t value_bytes =
+        quantized ? sizeof(int64_t) : sizeof(gpair_sum_t::value_t);
+    const bool shared = param.gpu_shared_memory_histogram &&
+                        2 * value_bytes * hist.n_bins <= max_shared_memory;
+    auto hist_stride = hist.n_bins;
+    if (quantized) {
+      for (auto nidx : nidx_set) {
+        int64_t* d_node = hist.quantized.data() + 2 * size_t(nidx) * hist_stride;
+        dh::launch_n(device_idx, 2 * hist_stride,
+                     [=] __device__(size_t idx) { d_node[idx] = 0; });
+      }
+    }
+
+    for (size_t p = 0; p < this->NumPages(); ++p) {
+      auto d_gidx = this->BeginPage(p);
+      bst_uint page_begin = static_cast<bst_uint>(p * page_rows);
+      size_t n_elements =
+          this->FuseSegments(page_segments, p, nidx_set, row_stride);
+      if (quantized) {
+        this->BuildPageHist(QuantizedAccumulator(quantizer),
+                            hist.quantized.data(), d_gidx, page_begin,
+                            n_elements, shared);
+      } else {
+        this->BuildPageHist(
+            FloatAccumulator(),
+            reinterpret_cast<gpair_sum_t::value_t*>(hist.GetHistPtr(0)),
+            d_gidx, page_begin, n_elements, shared);
+      }
+      this->EndPage(p);
+    }
+
+    if (quantized) {
+      const GradientQuantizer quantizer = this->quantizer;
+      for (auto nidx : nidx_set) {
+        const int64_t* d_node =
+            hist.quantized.data() + 2 * size_t(nidx) * hist_stride;
+        auto d_values =
+            reinterpret_cast<gpair_sum_t::value_t*>(hist.GetHistPtr(nidx));
+        dh::launch_n(device_idx, 2 * hist_stride, [=] __device__(size_t idx) {
+          const double scale =
+              idx % 2 == 0 ? quantizer.grad_scale : quantizer.hess_scale;
+          d_values[idx] = static_cast<double>(d_node[idx]) / scale;
+        });
+      }
+    }
+  }
   void SubtractionTrick(int nidx_parent, int nidx_histogram,
                         int nidx_subtraction) {
     auto d_node_hist_parent = hist.GetHistPtr(nidx_parent);
@@ -414,6 +839,25 @@ struct DeviceShard {
     });
   }
 
+  // Copy the histogram of nidx into a flat buffer of T, used to stage the
+  // allreduce of several nodes in a single call
+  template <typename T>
+  void PackHist(int nidx, T* d_buffer) {
+    auto d_node_hist =
+        reinterpret_cast<gpair_sum_t::value_t*>(hist.GetHistPtr(nidx));
+    dh::launch_n(device_idx, hist.n_bins * 2, [=] __device__(size_t idx) {
+      d_buffer[idx] = static_cast<T>(d_node_hist[idx]);
+    });
+  }
+  template <typename T>
+  void UnpackHist(int nidx, const T* d_buffer) {
+    auto d_node_hist =
+        reinterpret_cast<gpair_sum_t::value_t*>(hist.GetHistPtr(nidx));
+    dh::launch_n(device_idx, hist.n_bins * 2, [=] __device__(size_t idx) {
+      d_node_hist[idx] = d_buffer[idx];
+    });
+  }
+
   __device__ void CountLeft(int64_t* d_count, int val, int left_nidx) {
     unsigned ballot = __ballot(val == left_nidx);
     if (threadIdx.x % 32 == 0) {
@@ -422,55 +866,89 @@ struct DeviceShard {
     }
   }
 
-  void UpdatePosition(int nidx, int left_nidx, int right_nidx, int fidx,
-                      int split_gidx, bool default_dir_left, bool is_dense,
-                      int fidx_begin, int fidx_end) {
+  // Partition the rows of the split nodes, with one kernel per page
+  void UpdatePosition(const std::vector<PositionSplit>& splits,
+                      bool is_dense) {
     dh::safe_cuda(cudaSetDevice(device_idx));
-    temp_memory.LazyAllocate(sizeof(int64_t));
+    temp_memory.LazyAllocate(sizeof(int64_t) * splits.size());
     auto d_left_count = temp_memory.Pointer<int64_t>();
-    dh::safe_cuda(cudaMemset(d_left_count, 0, sizeof(int64_t)));
-    auto segment = ridx_segments[nidx];
+    dh::safe_cuda(
+        cudaMemset(d_left_count, 0, sizeof(int64_t) * splits.size()));
+    std::vector<Segment> segments;
+    std::vector<int> split_ids;
+    for (auto& split : splits) {
+      segments.push_back(ridx_segments[split.nidx]);
+      split_ids.push_back(static_cast<int>(split_ids.size()));
+    }
+    auto page_segments = this->PageSegments(segments);
+    position_splits = splits;
+    auto d_splits = dh::raw(position_splits);
     auto d_ridx = ridx.current();
     auto d_position = position.current();
-    auto d_gidx = gidx;
     auto row_stride = this->row_stride;
-    dh::launch_n<1, 512>(
-        device_idx, segment.Size(), [=] __device__(bst_uint idx) {
-          idx += segment.begin;
-          auto ridx = d_ridx[idx];
-          auto row_begin = row_stride * ridx;
-          auto row_end = row_begin + row_stride;
-          auto gidx = -1;
-          if (is_dense) {
-            gidx = d_gidx[row_begin + fidx];
-          } else {
-            gidx = BinarySearchRow(row_begin, row_end, d_gidx, fidx_begin,
-                                   fidx_end);
-          }
-
-          int position;
-          if (gidx >= 0) {
-            // Feature is found
-            position = gidx <= split_gidx ? left_nidx : right_nidx;
-          } else {
-            // Feature is missing
-            position = default_dir_left ? left_nidx : right_nidx;
-          }
-
-          CountLeft(d_left_count, position, left_nidx);
-          d_position[idx] = position;
-        });
 
-    dh::safe_cuda(cudaMemcpy(tmp_pinned, d_left_count, sizeof(int64_t),
+    for (size_t p = 0; p < this->NumPages(); ++p) {
+      auto d_gidx = this->BeginPage(p);
+      bst_uint page_begin = static_cast<bst_uint>(p * page_rows);
+      size_t n_rows = this->FuseSegments(page_segments, p, split_ids, 1);
+      auto d_nodes = dh::raw(fused_nodes);
+      int n_nodes = static_cast<int>(fused_nodes.size());
+      dh::launch_n<1, 512>(device_idx, n_rows, [=] __device__(size_t fused_idx) {
+        const FusedNode& node =
+            d_nodes[FindFusedNode(d_nodes, n_nodes, fused_idx)];
+        const PositionSplit& split = d_splits[node.node];
+        size_t idx = node.ridx_begin + (fused_idx - node.offset);
+        auto ridx = d_ridx[idx];
+        auto row_begin = row_stride * (ridx - page_begin);
+        auto row_end = row_begin + row_stride;
+        auto gidx = -1;
+        if (is_dense) {
+          gidx = d_gidx[row_begin + split.fidx];
+        } else {
+          gidx = BinarySearchRow(row_begin, row_end, d_gidx, split.fidx_begin,
+                                 split.fidx_end);
+        }
+
+        int position;
+        if (gidx >= 0) {
+          // Feature is found
+          position =
+              gidx <= split.split_gidx ? split.left_nidx : split.right_nidx;
+        } else {
+          // Feature is missing
+          position =
+              split.default_dir_left ? split.left_nidx : split.right_nidx;
+        }
+
+        // One atomic per warp when the warp partitions a single node, the
+        // warps on the boundary of two nodes count row by row
+        if (__all(node.node == __shfl(node.node, 0))) {
+          CountLeft(d_left_count + node.node, position, split.left_nidx);
+        } else if (position == split.left_nidx) {
+          atomicAdd(reinterpret_cast<unsigned long long*>(  // NOLINT
+                        d_left_count + node.node),
+                    1ULL);
+        }
+        d_position[idx] = position;
+      });
+      this->EndPage(p);
+    }
+
+    std::vector<int64_t> left_count(splits.size());
+    dh::safe_cuda(cudaMemcpy(left_count.data(), d_left_count,
+                             sizeof(int64_t) * splits.size(),
                              cudaMemcpyDeviceToHost));
-    auto left_count = *tmp_pinned;
 
-    SortPosition(segment, left_nidx, right_nidx);
-    // dh::safe_cuda(cudaStreamSynchronize(stream));
-    ridx_segments[left_nidx] =
-        Segment(segment.begin, segment.begin + left_count);
-    ridx_segments[right_nidx] =
-        Segment(segment.begin + left_count, segment.end);
+    for (size_t i = 0; i < splits.size(); ++i) {
+      auto& split = splits[i];
+      auto segment = segments[i];
+      SortPosition(segment, split.left_nidx, split.right_nidx);
+      // dh::safe_cuda(cudaStreamSynchronize(stream));
+      ridx_segments[split.left_nidx] =
+          Segment(segment.begin, segment.begin + left_count[i]);
+      ridx_segments[split.right_nidx] =
+          Segment(segment.begin + left_count[i], segment.end);
+    }
   }
 
   void SortPosition(const Segment& segment, int left_nidx, int right_nidx) {
@@ -508,6 +986,9 @@ struct DeviceShard {
                      cudaMemcpyDefault));
     }
     prediction_cache_initialised = true;
+    if (param.gpu_managed_memory) {
+      prediction_cache.prefetch_managed();
+    }
 
     CalcWeightTrainParam param_d(param);
 
@@ -574,17 +1055,19 @@ class GPUHistMaker : public TreeUpdater {
     }
     param.learning_rate = lr;
     monitor.Stop("Update", dList);
+    if (param.debug_verbose) {
+      for (auto device_idx : dList) {
+        LOG(CONSOLE) << "Device memory of [" << device_idx << "]: "
+                     << dh::GlobalMemoryPool().CurrentBytes(device_idx)
+                     << " bytes in use, peak "
+                     << dh::GlobalMemoryPool().PeakBytes(device_idx)
+                     << " bytes.";
+      }
+    }
   }
 
   void InitDataOnce(DMatrix* dmat) {
     info = &dmat->info();
-    monitor.Start("Quantiles", dList);
-    hmat_.Init(dmat, param.max_bin);
-    gmat_.cut = &hmat_;
-    gmat_.Init(dmat);
-    monitor.Stop("Quantiles", dList);
-    n_bins = hmat_.row_ptr.back();
-
     int n_devices = dh::n_devices(param.n_gpus, info->num_row);
 
     bst_uint row_begin = 0;
@@ -597,6 +1080,17 @@ class GPUHistMaker : public TreeUpdater {
       dList[d_idx] = device_idx;
     }
 
+    monitor.Start("Quantiles", dList);
+    if (param.gpu_sketch) {
+      common::DeviceSketch(dList, dmat, param.max_bin, &hmat_);
+    } else {
+      hmat_.Init(dmat, param.max_bin);
+    }
+    gmat_.cut = &hmat_;
+    gmat_.Init(dmat);
+    monitor.Stop("Quantiles", dList);
+    n_bins = hmat_.row_ptr.back();
+
     reducer.Init(dList);
 
     // Partition input matrix into row segments
@@ -646,20 +1140,19 @@ class GPUHistMaker : public TreeUpdater {
     monitor.Stop("InitDataReset", dList);
   }
 
-  void AllReduceHist(int nidx) {
-    for (auto& shard : shards) {
-      auto d_node_hist = shard->hist.GetHistPtr(nidx);
-      reducer.AllReduceSum(
-          shard->normalised_device_idx,
-          reinterpret_cast<gpair_sum_t::value_t*>(d_node_hist),
-          reinterpret_cast<gpair_sum_t::value_t*>(d_node_hist),
-          n_bins * (sizeof(gpair_sum_t) / sizeof(gpair_sum_t::value_t)));
-    }
-
-    reducer.Synchronize();
-  }
+  // A histogram to build: the histogram of nidx_build is built and
+  // allreduced, the one of nidx_subtract, if any, is derived from the parent
+  struct HistTask {
+    int nidx_build;
+    int nidx_parent;
+    int nidx_subtract;
+    HistTask(int nidx_build, int nidx_parent, int nidx_subtract)
+        : nidx_build(nidx_build),
+          nidx_parent(nidx_parent),
+          nidx_subtract(nidx_subtract) {}
+  };
 
-  void BuildHistLeftRight(int nidx_parent, int nidx_left, int nidx_right) {
+  HistTask LeftRightTask(int nidx_parent, int nidx_left, int nidx_right) {
     size_t left_node_max_elements = 0;
     size_t right_node_max_elements = 0;
     for (auto& shard : shards) {
@@ -668,24 +1161,74 @@ class GPUHistMaker : public TreeUpdater {
       right_node_max_elements = (std::max)(
           right_node_max_elements, shard->ridx_segments[nidx_right].Size());
     }
-
-    auto build_hist_nidx = nidx_left;
-    auto subtraction_trick_nidx = nidx_right;
-
     if (right_node_max_elements < left_node_max_elements) {
-      build_hist_nidx = nidx_right;
-      subtraction_trick_nidx = nidx_left;
+      return HistTask(nidx_right, nidx_parent, nidx_left);
     }
+    return HistTask(nidx_left, nidx_parent, nidx_right);
+  }
 
+  void BuildHist(const std::vector<HistTask>& tasks) {
+    if (param.hist_allreduce_float) {
+      this->BuildAllReduceHist<float>(tasks);
+    } else {
+      this->BuildAllReduceHist<gpair_sum_t::value_t>(tasks);
+    }
+    for (auto& task : tasks) {
+      if (task.nidx_subtract < 0) continue;
+      for (auto& shard : shards) {
+        shard->SubtractionTrick(task.nidx_parent, task.nidx_build,
+                                task.nidx_subtract);
+      }
+    }
+  }
+
+  // Build the histograms of the tasks and allreduce them across the devices
+  // as values of type T. The histograms are staged contiguously in the
+  // temporary memory of each shard and reduced in chunks of at least
+  // kAllReduceChunk values: the nodes of a level are reduced by a few large
+  // calls, and the reduction of a chunk runs on the communication streams
+  // while the histograms of the next chunk are built. In paged mode the
+  // histograms of a chunk are built by one pass over the pages.
+  template <typename T>
+  void BuildAllReduceHist(const std::vector<HistTask>& tasks) {
+    std::vector<int> nidx_set;
+    for (auto& task : tasks) {
+      nidx_set.push_back(task.nidx_build);
+    }
+    if (shards.size() == 1) {
+      shards.front()->BuildHist(nidx_set);
+      return;
+    }
+    const size_t n_values = static_cast<size_t>(n_bins) * 2;
+    const size_t chunk_nodes = dh::div_round_up(kAllReduceChunk, n_values);
     for (auto& shard : shards) {
-      shard->BuildHist(build_hist_nidx);
+      dh::safe_cuda(cudaSetDevice(shard->device_idx));
+      shard->temp_memory.LazyAllocate(sizeof(T) * n_values * tasks.size());
+    }
+    for (size_t begin = 0; begin < tasks.size(); begin += chunk_nodes) {
+      size_t end = std::min(tasks.size(), begin + chunk_nodes);
+      std::vector<int> chunk(nidx_set.begin() + begin, nidx_set.begin() + end);
+      for (auto& shard : shards) {
+        shard->BuildHist(chunk);
+        for (size_t i = begin; i < end; ++i) {
+          shard->PackHist(nidx_set[i],
+                          shard->temp_memory.Pointer<T>() + i * n_values);
+        }
+      }
+      for (auto& shard : shards) {
+        T* d_chunk = shard->temp_memory.Pointer<T>() + begin * n_values;
+        reducer.AllReduceSum(shard->normalised_device_idx, d_chunk, d_chunk,
+                             static_cast<int>((end - begin) * n_values));
+      }
     }
 
-    this->AllReduceHist(build_hist_nidx);
+    reducer.Synchronize();
 
-    for (auto& shard : shards) {
-      shard->SubtractionTrick(nidx_parent, build_hist_nidx,
-                              subtraction_trick_nidx);
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      for (auto& shard : shards) {
+        shard->UnpackHist(tasks[i].nidx_build,
+                          shard->temp_memory.Pointer<T>() + i * n_values);
+      }
     }
   }
 
@@ -758,11 +1301,7 @@ class GPUHistMaker : public TreeUpdater {
         std::accumulate(tmp_sums.begin(), tmp_sums.end(), bst_gpair_precise());
 
     // Generate root histogram
-    for (auto& shard : shards) {
-      shard->BuildHist(root_nidx);
-    }
-
-    this->AllReduceHist(root_nidx);
+    this->BuildHist({HistTask(root_nidx, -1, -1)});
 
     // Remember root stats
     p_tree->stat(root_nidx).sum_hess = sum_gradient.GetHess();
@@ -784,22 +1323,30 @@ class GPUHistMaker : public TreeUpdater {
         ExpandEntry(root_nidx, p_tree->GetDepth(root_nidx), splits.front(), 0));
   }
 
-  void UpdatePosition(const ExpandEntry& candidate, RegTree* p_tree) {
-    auto nidx = candidate.nid;
-    auto left_nidx = (*p_tree)[nidx].cleft();
-    auto right_nidx = (*p_tree)[nidx].cright();
-
-    // convert floating-point split_pt into corresponding bin_id
-    // split_cond = -1 indicates that split_pt is less than all known cut points
-    auto split_gidx = -1;
-    auto fidx = candidate.split.findex;
-    auto default_dir_left = candidate.split.dir == LeftDir;
-    auto fidx_begin = hmat_.row_ptr[fidx];
-    auto fidx_end = hmat_.row_ptr[fidx + 1];
-    for (auto i = fidx_begin; i < fidx_end; ++i) {
-      if (candidate.split.fvalue == hmat_.cut[i]) {
-        split_gidx = static_cast<int32_t>(i);
+  // Partition the rows of the split nodes, in one pass over the pages
+  void UpdatePosition(const std::vector<ExpandEntry>& candidates,
+                      RegTree* p_tree) {
+    std::vector<PositionSplit> splits;
+    for (auto& candidate : candidates) {
+      PositionSplit split;
+      split.nidx = candidate.nid;
+      split.left_nidx = (*p_tree)[candidate.nid].cleft();
+      split.right_nidx = (*p_tree)[candidate.nid].cright();
+
+      // convert floating-point split_pt into corresponding bin_id
+      // split_cond = -1 indicates that split_pt is less than all known cut
+      // points
+      split.split_gidx = -1;
+      split.fidx = candidate.split.findex;
+      split.default_dir_left = candidate.split.dir == LeftDir;
+      split.fidx_begin = hmat_.row_ptr[split.fidx];
+      split.fidx_end = hmat_.row_ptr[split.fidx + 1];
+      for (auto i = split.fidx_begin; i < split.fidx_end; ++i) {
+        if (candidate.split.fvalue == hmat_.cut[i]) {
+          split.split_gidx = static_cast<int32_t>(i);
+        }
       }
+      splits.push_back(split);
     }
 
     auto is_dense = info->num_nonzero == info->num_row * info->num_col;
@@ -808,9 +1355,7 @@ class GPUHistMaker : public TreeUpdater {
 #pragma omp parallel
     {
       auto cpu_thread_id = omp_get_thread_num();
-      shards[cpu_thread_id]->UpdatePosition(nidx, left_nidx, right_nidx, fidx,
-                                            split_gidx, default_dir_left,
-                                            is_dense, fidx_begin, fidx_end);
+      shards[cpu_thread_id]->UpdatePosition(splits, is_dense);
     }
   }
 
@@ -852,7 +1397,6 @@ class GPUHistMaker : public TreeUpdater {
       shard->node_sum_gradients[parent.cleft()] = candidate.split.left_sum;
       shard->node_sum_gradients[parent.cright()] = candidate.split.right_sum;
     }
-    this->UpdatePosition(candidate, p_tree);
   }
 
   void UpdateTree(HostDeviceVector<bst_gpair>* gpair, DMatrix* p_fmat,
@@ -873,37 +1417,60 @@ class GPUHistMaker : public TreeUpdater {
     auto num_leaves = 1;
 
     while (!qexpand_->empty()) {
-      auto candidate = qexpand_->top();
+      // The nodes of a level in depthwise mode, or the gpu_lossguide_batch
+      // best candidates in lossguide mode, are expanded together, so that
+      // their rows are partitioned and their histograms built, allreduced
+      // and evaluated by one pass of fused kernels
+      std::vector<ExpandEntry> level(1, qexpand_->top());
       qexpand_->pop();
-      if (!candidate.IsValid(param, num_leaves)) continue;
-      // std::cout << candidate;
+      while (!qexpand_->empty() &&
+             (param.grow_policy == TrainParam::kLossGuide
+                  ? static_cast<int>(level.size()) < param.gpu_lossguide_batch
+                  : qexpand_->top().depth == level.front().depth)) {
+        level.push_back(qexpand_->top());
+        qexpand_->pop();
+      }
+
+      std::vector<ExpandEntry> applied;
+      std::vector<bool> expand_children;
       monitor.Start("ApplySplit", dList);
-      this->ApplySplit(candidate, p_tree);
+      for (auto& candidate : level) {
+        if (!candidate.IsValid(param, num_leaves)) continue;
+        // std::cout << candidate;
+        this->ApplySplit(candidate, p_tree);
+        num_leaves++;
+        applied.push_back(candidate);
+        // Only create child entries if needed
+        expand_children.push_back(ExpandEntry::ChildIsValid(
+            param, tree.GetDepth(tree[candidate.nid].cleft()), num_leaves));
+      }
+      if (!applied.empty()) this->UpdatePosition(applied, p_tree);
       monitor.Stop("ApplySplit", dList);
-      num_leaves++;
-
-      auto left_child_nidx = tree[candidate.nid].cleft();
-      auto right_child_nidx = tree[candidate.nid].cright();
-
-      // Only create child entries if needed
-      if (ExpandEntry::ChildIsValid(param, tree.GetDepth(left_child_nidx),
-                                    num_leaves)) {
-        monitor.Start("BuildHist", dList);
-        this->BuildHistLeftRight(candidate.nid, left_child_nidx,
-                                 right_child_nidx);
-        monitor.Stop("BuildHist", dList);
-
-        monitor.Start("EvaluateSplits", dList);
-        auto splits =
-            this->EvaluateSplits({left_child_nidx, right_child_nidx}, p_tree);
-        qexpand_->push(ExpandEntry(left_child_nidx,
-                                   tree.GetDepth(left_child_nidx), splits[0],
-                                   timestamp++));
-        qexpand_->push(ExpandEntry(right_child_nidx,
-                                   tree.GetDepth(right_child_nidx), splits[1],
-                                   timestamp++));
-        monitor.Stop("EvaluateSplits", dList);
+
+      std::vector<HistTask> tasks;
+      std::vector<int> children;
+      for (size_t i = 0; i < applied.size(); ++i) {
+        if (!expand_children[i]) continue;
+        auto left_child_nidx = tree[applied[i].nid].cleft();
+        auto right_child_nidx = tree[applied[i].nid].cright();
+        tasks.push_back(this->LeftRightTask(applied[i].nid, left_child_nidx,
+                                            right_child_nidx));
+        children.push_back(left_child_nidx);
+        children.push_back(right_child_nidx);
+      }
+      if (tasks.empty()) continue;
+
+      monitor.Start("BuildHist", dList);
+      this->BuildHist(tasks);
+      monitor.Stop("BuildHist", dList);
+
+      monitor.Start("EvaluateSplits", dList);
+      auto splits = this->EvaluateSplits(children, p_tree);
+      for (size_t i = 0; i < children.size(); ++i) {
+        qexpand_->push(ExpandEntry(children[i], tree.GetDepth(children[i]),
+                                   splits[i], timestamp++));
       }
+      monitor.Stop("EvaluateSplits", dList);
     }
     // Reset omp num threads
     omp_set_num_threads(nthread);
@@ -988,6 +1555,8 @@ class GPUHistMaker : public TreeUpdater {
                               std::function<bool(ExpandEntry, ExpandEntry)>>
       ExpandQueue;
   std::unique_ptr<ExpandQueue> qexpand_;
+  // Minimum number of histogram values reduced by one allreduce call
+  static const size_t kAllReduceChunk = 1 << 20;
   common::Monitor monitor;
   dh::AllReducer reducer;
   std::vector<ValueConstraint> node_value_constraints_;
@@ -6,8 +6,11 @@
  */
 #include <xgboost/base.h>
 #include <xgboost/tree_updater.h>
+#include <cmath>
+#include <functional>
 #include <vector>
 #include <algorithm>
+#include "../common/bitmap.h"
 #include "../common/sync.h"
 #include "../common/quantile.h"
 #include "../common/group_data.h"
@@ -29,8 +32,13 @@ class HistMaker: public BaseMaker {
     float lr = param.learning_rate;
     param.learning_rate = lr / trees.size();
     // build tree
+    this->leaf_position_.Clear();
     for (size_t i = 0; i < trees.size(); ++i) {
-      this->Update(gpair->data_h(), p_fmat, trees[i]);
+      this->Update(gpair->const_data_h(), p_fmat, trees[i]);
+    }
+    if (LeafPosition::AllRowsPlaced(*p_fmat, gpair->const_data_h(), param) &&
+        this->ResetPositionAfterGrow(p_fmat, *trees.back())) {
+      this->leaf_position_.Set(p_fmat, gpair->const_data_h(), param, trees.back(), &this->position);
     }
     param.learning_rate = lr;
   }
@@ -121,6 +129,58 @@ class HistMaker: public BaseMaker {
   rabit::Reducer<TStats, TStats::Reduce> histred;
   // set of working features
   std::vector<bst_uint> fwork_set;
+  // allreduce the histograms of wspace.hset[0], computed by prepare
+  inline void AllreduceHist(std::function<void()> prepare) {
+    std::vector<TStats> &data = wspace.hset[0].data;
+    if (!param.hist_allreduce_float && !param.hist_allreduce_sparse) {
+      if (prepare) {
+        histred.Allreduce(dmlc::BeginPtr(data), data.size(), prepare);
+      } else {
+        histred.Allreduce(dmlc::BeginPtr(data), data.size());
+      }
+      return;
+    }
+    if (prepare) prepare();
+    // the bins sent, empty for all of them
+    std::vector<size_t> bins;
+    if (param.hist_allreduce_sparse) {
+      common::BitMap nonempty;
+      nonempty.Resize(data.size());
+      for (size_t i = 0; i < data.size(); ++i) {
+        if (data[i].sum_grad != 0.0 || data[i].sum_hess != 0.0) nonempty.SetTrue(i);
+      }
+      rabit::Allreduce<rabit::op::BitOR>(dmlc::BeginPtr(nonempty.data),
+                                         nonempty.data.size());
+      for (size_t i = 0; i < data.size(); ++i) {
+        if (nonempty.Get(i)) bins.push_back(i);
+      }
+      // an empty bin is empty on every worker, it is left as it is
+      if (bins.size() == 0) return;
+    }
+    if (param.hist_allreduce_float) {
+      this->AllreduceBins<float>(bins);
+    } else {
+      this->AllreduceBins<double>(bins);
+    }
+  }
+  // allreduce the sums of the given bins, or of all bins, sent as T
+  template<typename T>
+  inline void AllreduceBins(const std::vector<size_t> &bins) {
+    std::vector<TStats> &data = wspace.hset[0].data;
+    const size_t nbin = bins.size() == 0 ? data.size() : bins.size();
+    std::vector<T> buffer(nbin * 2);
+    for (size_t k = 0; k < nbin; ++k) {
+      const TStats &e = data[bins.size() == 0 ? k : bins[k]];
+      buffer[k * 2] = static_cast<T>(e.sum_grad);
+      buffer[k * 2 + 1] = static_cast<T>(e.sum_hess);
+    }
+    rabit::Allreduce<rabit::op::Sum>(dmlc::BeginPtr(buffer), buffer.size());
+    for (size_t k = 0; k < nbin; ++k) {
+      TStats &e = data[bins.size() == 0 ? k : bins[k]];
+      e.sum_grad = buffer[k * 2];
+      e.sum_hess = buffer[k * 2 + 1];
+    }
+  }
   // update function implementation
   virtual void Update(const std::vector<bst_gpair> &gpair,
                       DMatrix *p_fmat,
@@ -170,6 +230,12 @@ class HistMaker: public BaseMaker {
   virtual void ResetPositionAfterSplit(DMatrix *p_fmat,
                                        const RegTree &tree) {
   }
+  // move the rows through the last split of the grown tree, return whether
+  // the positions then give the leaf of every row
+  virtual bool ResetPositionAfterGrow(DMatrix *p_fmat,
+                                      const RegTree &tree) {
+    return false;
+  }
   virtual void CreateHist(const std::vector<bst_gpair> &gpair,
                           DMatrix *p_fmat,
                           const std::vector <bst_uint> &fset,
@@ -374,8 +440,7 @@ class CQHistMaker: public HistMaker<TStats> {
     // sync the histogram
     // if it is C++11, use lazy evaluation for Allreduce
 #if __cplusplus >= 201103L
-    this->histred.Allreduce(dmlc::BeginPtr(this->wspace.hset[0].data),
-                            this->wspace.hset[0].data.size(), lazy_get_hist);
+    this->AllreduceHist(lazy_get_hist);
 #else
     this->histred.Allreduce(dmlc::BeginPtr(this->wspace.hset[0].data),
                             this->wspace.hset[0].data.size());
@@ -385,6 +450,20 @@ class CQHistMaker: public HistMaker<TStats> {
                                const RegTree &tree) override {
     this->GetSplitSet(this->qexpand, tree, &fsplit_set);
   }
+  bool ResetPositionAfterGrow(DMatrix *p_fmat,
+                              const RegTree &tree) override {
+    // the nodes split at the maximum depth were not expanded, their rows
+    // are still at the split nodes
+    if (this->qexpand.size() != 0) {
+      this->SetDefaultPostion(p_fmat, tree);
+      dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator(fsplit_set);
+      iter->BeforeFirst();
+      while (iter->Next()) {
+        this->CorrectNonDefaultPositionByBatch(iter->Value(), fsplit_set, tree);
+      }
+    }
+    return true;
+  }
   void ResetPosAndPropose(const std::vector<bst_gpair> &gpair,
                           DMatrix *p_fmat,
                           const std::vector<bst_uint> &fset,
@@ -408,13 +487,8 @@ class CQHistMaker: public HistMaker<TStats> {
     for (size_t i = 0; i < sketchs.size(); ++i) {
       sketchs[i].Init(info.num_row, this->param.sketch_eps);
     }
-    // intitialize the summary array
-    summary_array.resize(sketchs.size());
     // setup maximum size
     unsigned max_size = this->param.max_sketch_size();
-    for (size_t i = 0; i < sketchs.size(); ++i) {
-      summary_array[i].Reserve(max_size);
-    }
     {
       // get smmary
       thread_sketch.resize(omp_get_max_threads());
@@ -445,11 +519,7 @@ class CQHistMaker: public HistMaker<TStats> {
           }
         }
       }
-      for (size_t i = 0; i < sketchs.size(); ++i) {
-        common::WXQuantileSketch<bst_float, bst_float>::SummaryContainer out;
-        sketchs[i].GetSummary(&out);
-        summary_array[i].SetPrune(out, max_size);
-      }
+      common::PruneSketchSummaries(&sketchs, max_size, &summary_array);
       CHECK_EQ(summary_array.size(), sketchs.size());
     }
     if (summary_array.size() != 0) {
@@ -654,12 +724,28 @@ class CQHistMaker: public HistMaker<TStats> {
 // global proposal
 template<typename TStats>
 class GlobalProposalHistMaker: public CQHistMaker<TStats> {
+ public:
+  GlobalProposalHistMaker() : num_reuse_(0), drifted_(false) {}
+
  protected:
   void ResetPosAndPropose(const std::vector<bst_gpair> &gpair,
                           DMatrix *p_fmat,
                           const std::vector<bst_uint> &fset,
                           const RegTree &tree) override {
-    if (this->qexpand.size() == 1) {
+    const bool is_root = this->qexpand.size() == 1 && this->qexpand[0] == 0;
+    if (is_root && this->ReuseRootProposal(fset)) {
+      // lay the proposal out in the order of the feature set of this tree
+      cached_rptr_.assign(1, 0);
+      cached_cut_.clear();
+      for (bst_uint fid : fset) {
+        cached_cut_.insert(cached_cut_.end(), root_cuts_[fid].begin(), root_cuts_[fid].end());
+        cached_rptr_.push_back(static_cast<unsigned>(cached_cut_.size()));
+      }
+      // reserve last value for global statistics
+      cached_cut_.push_back(0.0f);
+      cached_rptr_.push_back(static_cast<unsigned>(cached_cut_.size()));
+      ++num_reuse_;
+    } else if (this->qexpand.size() == 1) {
       cached_rptr_.clear();
       cached_cut_.clear();
     }
@@ -668,6 +754,16 @@ class GlobalProposalHistMaker: public CQHistMaker<TStats> {
       CQHistMaker<TStats>::ResetPosAndPropose(gpair, p_fmat, fset, tree);
       cached_rptr_ = this->wspace.rptr;
       cached_cut_ = this->wspace.cut;
+      if (is_root && this->param.max_proposal_reuse != 0) {
+        root_cuts_.assign(tree.param.num_feature, std::vector<bst_float>());
+        for (size_t i = 0; i < fset.size(); ++i) {
+          root_cuts_[fset[i]].assign(cached_cut_.begin() + cached_rptr_[i],
+                                     cached_cut_.begin() + cached_rptr_[i + 1]);
+        }
+        root_share_.clear();
+        num_reuse_ = 0;
+        drifted_ = false;
+      }
     } else {
       this->wspace.cut.clear();
       this->wspace.rptr.clear();
@@ -742,14 +838,62 @@ class GlobalProposalHistMaker: public CQHistMaker<TStats> {
             .data[0] = this->node_stats[nid];
       }
     }
-    this->histred.Allreduce(dmlc::BeginPtr(this->wspace.hset[0].data),
-                            this->wspace.hset[0].data.size());
+    this->AllreduceHist(nullptr);
+    if (this->qexpand.size() == 1 && this->qexpand[0] == 0 && root_cuts_.size() != 0) {
+      this->CheckRootProposal(fset);
+    }
+  }
+  // whether the proposal of the root of a previous tree covers the features
+  inline bool ReuseRootProposal(const std::vector<bst_uint> &fset) const {
+    if (root_cuts_.size() == 0 || drifted_ ||
+        num_reuse_ >= this->param.max_proposal_reuse) {
+      return false;
+    }
+    for (bst_uint fid : fset) {
+      if (fid >= root_cuts_.size() || root_cuts_[fid].size() == 0) return false;
+    }
+    return true;
+  }
+  // compare the share of the root hessian in each bin with the one of the
+  // tree the proposal was sketched for, the histogram is already global
+  inline void CheckRootProposal(const std::vector<bst_uint> &fset) {
+    const double sum_hess = this->wspace.hset[0][fset.size()].data[0].sum_hess;
+    if (sum_hess <= 0.0) return;
+    const bool record = root_share_.size() == 0;
+    if (record) root_share_.resize(root_cuts_.size());
+    for (size_t i = 0; i < fset.size(); ++i) {
+      const typename HistMaker<TStats>::HistUnit unit = this->wspace.hset[0][i];
+      std::vector<bst_float> &share = root_share_[fset[i]];
+      if (record) {
+        share.resize(unit.size);
+        for (unsigned j = 0; j < unit.size; ++j) {
+          share[j] = static_cast<bst_float>(unit.data[j].sum_hess / sum_hess);
+        }
+        continue;
+      }
+      CHECK_EQ(share.size(), unit.size);
+      for (unsigned j = 0; j < unit.size; ++j) {
+        if (std::abs(unit.data[j].sum_hess / sum_hess - share[j]) > this->param.sketch_eps) {
+          drifted_ = true;
+          return;
+        }
+      }
+    }
   }
 
   // cached unit pointer
   std::vector<unsigned> cached_rptr_;
   // cached cut value.
   std::vector<bst_float> cached_cut_;
+  // cuts of each feature in the proposal of the root of the tree it was
+  // last sketched for, empty for the features that tree did not use
+  std::vector<std::vector<bst_float> > root_cuts_;
+  // share of the root hessian in each bin of each feature in that tree
+  std::vector<std::vector<bst_float> > root_share_;
+  // number of trees the root proposal has been reused for
+  int num_reuse_;
+  // whether the root hessian moved away from the proposal
+  bool drifted_;
 };
 
 
@@ -825,13 +969,7 @@ class QuantileHistMaker: public HistMaker<TStats> {
     // setup maximum size
     unsigned max_size = this->param.max_sketch_size();
     // synchronize sketch
-    summary_array.resize(sketchs.size());
-    for (size_t i = 0; i < sketchs.size(); ++i) {
-      common::WQuantileSketch<bst_float, bst_float>::SummaryContainer out;
-      sketchs[i].GetSummary(&out);
-      summary_array[i].Reserve(max_size);
-      summary_array[i].SetPrune(out, max_size);
-    }
+    common::PruneSketchSummaries(&sketchs, max_size, &summary_array);
 
     size_t nbytes = WXQSketch::SummaryContainer::CalcMemCost(max_size);
     sreducer.Allreduce(dmlc::BeginPtr(summary_array), nbytes, summary_array.size());
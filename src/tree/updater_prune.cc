@@ -8,6 +8,7 @@
 #include <xgboost/tree_updater.h>
 #include <string>
 #include <memory>
+#include <vector>
 #include "./param.h"
 #include "../common/sync.h"
 #include "../common/io.h"
@@ -35,31 +36,48 @@ class TreePruner: public TreeUpdater {
     // rescale learning rate according to size of trees
     float lr = param.learning_rate;
     param.learning_rate = lr / trees.size();
-    for (size_t i = 0; i < trees.size(); ++i) {
-      this->DoPrune(*trees[i]);
+    // the trees are pruned independently, the log keeps their order
+    std::vector<int> npruned(trees.size());
+    const bst_omp_uint ntree = static_cast<bst_omp_uint>(trees.size());
+    #pragma omp parallel for schedule(dynamic) if (ntree > 1)
+    for (bst_omp_uint i = 0; i < ntree; ++i) {
+      npruned[i] = this->DoPrune(trees[i]);
+    }
+    if (!param.silent) {
+      for (size_t i = 0; i < trees.size(); ++i) {
+        RegTree& tree = *trees[i];
+        LOG(INFO) << "tree pruning end, " << tree.param.num_roots << " roots, "
+                  << tree.num_extra_nodes() << " extra nodes, " << npruned[i]
+                  << " pruned nodes, max_depth=" << tree.MaxDepth();
+      }
     }
     param.learning_rate = lr;
     syncher->Update(gpair, p_fmat, trees);
   }
+  // the pruner keeps no data, it only broadcasts the trees of distributed training
+  bool ShareWith(TreeUpdater* other) override {
+    return dynamic_cast<TreePruner*>(other) != nullptr;
+  }
 
  private:
-  // try to prune off current leaf
-  inline int TryPruneLeaf(RegTree &tree, int nid, int depth, int npruned) { // NOLINT(*)
-    if (tree[nid].is_root()) return npruned;
-    int pid = tree[nid].parent();
-    RegTree::NodeStat &s = tree.stat(pid);
-    ++s.leaf_child_cnt;
-    if (s.leaf_child_cnt >= 2 && param.need_prune(s.loss_chg, depth - 1)) {
+  // try to prune off current leaf, and then its parents in turn
+  inline int TryPruneLeaf(RegTree &tree, int nid, int depth, int npruned) const { // NOLINT(*)
+    while (!tree[nid].is_root()) {
+      const int pid = tree[nid].parent();
+      RegTree::NodeStat &s = tree.stat(pid);
+      ++s.leaf_child_cnt;
+      if (s.leaf_child_cnt < 2 || !param.need_prune(s.loss_chg, depth - 1)) break;
       // need to be pruned
       tree.ChangeToLeaf(pid, param.learning_rate * s.base_weight);
-      // tail recursion
-      return this->TryPruneLeaf(tree, pid, depth - 1, npruned + 2);
-    } else {
-      return npruned;
+      nid = pid;
+      depth -= 1;
+      npruned += 2;
     }
+    return npruned;
   }
-  /*! \brief do pruning of a tree */
-  inline void DoPrune(RegTree &tree) { // NOLINT(*)
+  /*! \brief do pruning of a tree, return the number of pruned nodes */
+  inline int DoPrune(RegTree *p_tree) const {
+    RegTree &tree = *p_tree;
     int npruned = 0;
     // initialize auxiliary statistics
     for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
@@ -70,11 +88,7 @@ class TreePruner: public TreeUpdater {
         npruned = this->TryPruneLeaf(tree, nid, tree.GetDepth(nid), npruned);
       }
     }
-    if (!param.silent) {
-      LOG(INFO) << "tree pruning end, " << tree.param.num_roots << " roots, "
-                << tree.num_extra_nodes() << " extra nodes, " << npruned
-                << " pruned nodes, max_depth=" << tree.MaxDepth();
-    }
+    return npruned;
   }
 
  private:
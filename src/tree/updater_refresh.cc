@@ -29,7 +29,7 @@ class TreeRefresher: public TreeUpdater {
               DMatrix *p_fmat,
               const std::vector<RegTree*> &trees) override {
     if (trees.size() == 0) return;
-    std::vector<bst_gpair> &gpair_h = gpair->data_h();
+    const std::vector<bst_gpair> &gpair_h = gpair->const_data_h();
     // number of threads
     // thread temporal space
     std::vector<std::vector<TStats> > stemp;
@@ -96,12 +96,17 @@ class TreeRefresher: public TreeUpdater {
     // rescale learning rate according to size of trees
     float lr = param.learning_rate;
     param.learning_rate = lr / trees.size();
-    int offset = 0;
+    // the trees are refreshed independently from their own range of statistics
+    std::vector<size_t> offset(trees.size() + 1, 0);
     for (size_t i = 0; i < trees.size(); ++i) {
+      offset[i + 1] = offset[i] + trees[i]->param.num_nodes;
+    }
+    const bst_omp_uint ntree = static_cast<bst_omp_uint>(trees.size());
+    #pragma omp parallel for schedule(dynamic) if (ntree > 1)
+    for (bst_omp_uint i = 0; i < ntree; ++i) {
       for (int rid = 0; rid < trees[i]->param.num_roots; ++rid) {
-        this->Refresh(dmlc::BeginPtr(stemp[0]) + offset, rid, trees[i]);
+        this->Refresh(dmlc::BeginPtr(stemp[0]) + offset[i], rid, trees[i]);
       }
-      offset += trees[i]->param.num_nodes;
     }
     // set learning rate back
     param.learning_rate = lr;
@@ -125,7 +130,7 @@ class TreeRefresher: public TreeUpdater {
     }
   }
   inline void Refresh(const TStats *gstats,
-                      int nid, RegTree *p_tree) {
+                      int nid, RegTree *p_tree) const {
     RegTree &tree = *p_tree;
     tree.stat(nid).base_weight = static_cast<bst_float>(gstats[nid].CalcWeight(param));
     tree.stat(nid).sum_hess = static_cast<bst_float>(gstats[nid].sum_hess);
@@ -20,8 +20,28 @@ namespace tree {
 
 DMLC_REGISTRY_FILE_TAG(updater_skmaker);
 
+/*! \brief parameters of the sketch maker */
+struct SketchMakerParam : public dmlc::Parameter<SketchMakerParam> {
+  /*! \brief whether to keep a single hessian sketch per node and feature */
+  bool combined_sketch;
+  DMLC_DECLARE_PARAMETER(SketchMakerParam) {
+    DMLC_DECLARE_FIELD(combined_sketch).set_default(false)
+        .describe("Keep one sketch weighted by the hessian per node and feature "
+                  "instead of the positive gradient, negative gradient and hessian "
+                  "sketches. The gradient statistics between its cuts are then "
+                  "summed in a second pass over the data.");
+  }
+};
+
+DMLC_REGISTER_PARAMETER(SketchMakerParam);
+
 class SketchMaker: public BaseMaker {
  public:
+  void Init(const std::vector<std::pair<std::string, std::string> >& args) override {
+    BaseMaker::Init(args);
+    skparam.InitAllowUnknown(args);
+  }
+
   void Update(HostDeviceVector<bst_gpair> *gpair,
               DMatrix *p_fmat,
               const std::vector<RegTree*> &trees) override {
@@ -30,8 +50,10 @@ class SketchMaker: public BaseMaker {
     param.learning_rate = lr / trees.size();
     // build tree
     for (size_t i = 0; i < trees.size(); ++i) {
-      this->Update(gpair->data_h(), p_fmat, trees[i]);
+      this->Update(gpair->const_data_h(), p_fmat, trees[i]);
     }
+    // the positions are reset after each split
+    leaf_position_.Set(p_fmat, gpair->const_data_h(), param, trees.back(), &position);
     param.learning_rate = lr;
   }
 
@@ -45,6 +67,9 @@ class SketchMaker: public BaseMaker {
                          &thread_stats, &node_stats);
       this->BuildSketch(gpair, p_fmat, *p_tree);
       this->SyncNodeStats();
+      if (skparam.combined_sketch) {
+        this->BuildBucketStats(gpair, p_fmat, *p_tree);
+      }
       this->FindSplit(depth, gpair, p_fmat, p_tree);
       this->ResetPositionCol(qexpand, p_fmat, *p_tree);
       this->UpdateQueueExpand(*p_tree);
@@ -74,6 +99,8 @@ class SketchMaker: public BaseMaker {
   }
   // define the sketch we want to use
   typedef common::WXQuantileSketch<bst_float, bst_float> WXQSketch;
+  // the statistics a sketch is weighted by
+  enum SketchKind { kPosGrad = 0, kNegGrad = 1, kSumHess = 2 };
 
  private:
   // statistics needed in the gradient calculation
@@ -137,8 +164,10 @@ class SketchMaker: public BaseMaker {
                           DMatrix *p_fmat,
                           const RegTree &tree) {
     const MetaInfo& info = p_fmat->info();
-    sketchs.resize(this->qexpand.size() * tree.param.num_feature * 3);
-    for (size_t i = 0; i < sketchs.size(); ++i) {
+    sketchs.resize(this->qexpand.size() * tree.param.num_feature * this->NumSketch());
+    const bst_omp_uint nsketch = static_cast<bst_omp_uint>(sketchs.size());
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nsketch; ++i) {
       sketchs[i].Init(info.num_row, this->param.sketch_eps);
     }
     thread_sketch.resize(omp_get_max_threads());
@@ -162,9 +191,11 @@ class SketchMaker: public BaseMaker {
     }
     // setup maximum size
     unsigned max_size = param.max_sketch_size();
-    // synchronize sketch
+    // the summaries of all the nodes and features are pruned in parallel,
+    // and synchronized by a single allreduce
     summary_array.resize(sketchs.size());
-    for (size_t i = 0; i < sketchs.size(); ++i) {
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (bst_omp_uint i = 0; i < nsketch; ++i) {
       common::WXQuantileSketch<bst_float, bst_float>::SummaryContainer out;
       sketchs[i].GetSummary(&out);
       summary_array[i].Reserve(max_size);
@@ -183,14 +214,16 @@ class SketchMaker: public BaseMaker {
                               std::vector<SketchEntry> *p_temp) {
     if (c.length == 0) return;
     // initialize sbuilder for use
+    const int nsketch = this->NumSketch();
     std::vector<SketchEntry> &sbuilder = *p_temp;
-    sbuilder.resize(tree.param.num_nodes * 3);
+    sbuilder.resize(tree.param.num_nodes * nsketch);
     for (size_t i = 0; i < this->qexpand.size(); ++i) {
       const unsigned nid = this->qexpand[i];
       const unsigned wid = this->node2workindex[nid];
-      for (int k = 0; k < 3; ++k) {
-        sbuilder[3 * nid + k].sum_total = 0.0f;
-        sbuilder[3 * nid + k].sketch = &sketchs[(wid * tree.param.num_feature + fid) * 3 + k];
+      for (int k = 0; k < nsketch; ++k) {
+        sbuilder[nsketch * nid + k].sum_total = 0.0f;
+        sbuilder[nsketch * nid + k].sketch =
+            &sketchs[(wid * tree.param.num_feature + fid) * nsketch + k];
       }
     }
     if (!col_full) {
@@ -199,30 +232,31 @@ class SketchMaker: public BaseMaker {
         const int nid = this->position[ridx];
         if (nid >= 0) {
           const bst_gpair &e = gpair[ridx];
-          if (e.GetGrad() >= 0.0f) {
-            sbuilder[3 * nid + 0].sum_total += e.GetGrad();
-          } else {
-            sbuilder[3 * nid + 1].sum_total -= e.GetGrad();
+          for (int k = 0; k < nsketch; ++k) {
+            const SketchKind kind = this->Kind(k);
+            if (InSketch(e, kind)) {
+              sbuilder[nsketch * nid + k].sum_total += SketchWeight(e, kind);
+            }
           }
-          sbuilder[3 * nid + 2].sum_total += e.GetHess();
         }
       }
     } else {
       for (size_t i = 0; i < this->qexpand.size(); ++i) {
         const unsigned nid = this->qexpand[i];
-        sbuilder[3 * nid + 0].sum_total = static_cast<bst_float>(nstats[nid].pos_grad);
-        sbuilder[3 * nid + 1].sum_total = static_cast<bst_float>(nstats[nid].neg_grad);
-        sbuilder[3 * nid + 2].sum_total = static_cast<bst_float>(nstats[nid].sum_hess);
+        for (int k = 0; k < nsketch; ++k) {
+          sbuilder[nsketch * nid + k].sum_total = static_cast<bst_float>(
+              SketchTotal(nstats[nid], this->Kind(k)));
+        }
       }
     }
     // if only one value, no need to do second pass
     if (c[0].fvalue  == c[c.length-1].fvalue) {
       for (size_t i = 0; i < this->qexpand.size(); ++i) {
         const int nid = this->qexpand[i];
-        for (int k = 0; k < 3; ++k) {
-          sbuilder[3 * nid + k].sketch->Push(c[0].fvalue,
-                                             static_cast<bst_float>(
-                                                 sbuilder[3 * nid + k].sum_total));
+        for (int k = 0; k < nsketch; ++k) {
+          sbuilder[nsketch * nid + k].sketch->Push(c[0].fvalue,
+                                                   static_cast<bst_float>(
+                                                       sbuilder[nsketch * nid + k].sum_total));
         }
       }
       return;
@@ -231,8 +265,8 @@ class SketchMaker: public BaseMaker {
     unsigned max_size = param.max_sketch_size();
     for (size_t i = 0; i < this->qexpand.size(); ++i) {
       const int nid = this->qexpand[i];
-      for (int k = 0; k < 3; ++k) {
-        sbuilder[3 * nid + k].Init(max_size);
+      for (int k = 0; k < nsketch; ++k) {
+        sbuilder[nsketch * nid + k].Init(max_size);
       }
     }
     // second pass, build the sketch
@@ -241,20 +275,89 @@ class SketchMaker: public BaseMaker {
       const int nid = this->position[ridx];
       if (nid >= 0) {
         const bst_gpair &e = gpair[ridx];
-        if (e.GetGrad() >= 0.0f) {
-          sbuilder[3 * nid + 0].Push(c[j].fvalue, e.GetGrad(), max_size);
-        } else {
-          sbuilder[3 * nid + 1].Push(c[j].fvalue, -e.GetGrad(), max_size);
+        for (int k = 0; k < nsketch; ++k) {
+          const SketchKind kind = this->Kind(k);
+          if (InSketch(e, kind)) {
+            sbuilder[nsketch * nid + k].Push(c[j].fvalue, SketchWeight(e, kind), max_size);
+          }
         }
-        sbuilder[3 * nid + 2].Push(c[j].fvalue, e.GetHess(), max_size);
       }
     }
     for (size_t i = 0; i < this->qexpand.size(); ++i) {
       const int nid = this->qexpand[i];
-      for (int k = 0; k < 3; ++k) {
-        sbuilder[3 * nid + k].Finalize(max_size);
+      for (int k = 0; k < nsketch; ++k) {
+        sbuilder[nsketch * nid + k].Finalize(max_size);
+      }
+    }
+  }
+  // number of sketches per node and feature
+  inline int NumSketch() const {
+    return skparam.combined_sketch ? 1 : 3;
+  }
+  // the statistics of the k-th sketch of a node and feature
+  inline SketchKind Kind(int k) const {
+    return skparam.combined_sketch ? kSumHess : static_cast<SketchKind>(k);
+  }
+  // whether the gradient pair goes to the sketch of the given kind
+  inline static bool InSketch(const bst_gpair &e, SketchKind kind) {
+    switch (kind) {
+      case kPosGrad: return e.GetGrad() >= 0.0f;
+      case kNegGrad: return e.GetGrad() < 0.0f;
+      default: return true;
+    }
+  }
+  inline static bst_float SketchWeight(const bst_gpair &e, SketchKind kind) {
+    switch (kind) {
+      case kPosGrad: return e.GetGrad();
+      case kNegGrad: return -e.GetGrad();
+      default: return e.GetHess();
+    }
+  }
+  inline static double SketchTotal(const SKStats &stats, SketchKind kind) {
+    switch (kind) {
+      case kPosGrad: return stats.pos_grad;
+      case kNegGrad: return stats.neg_grad;
+      default: return stats.sum_hess;
+    }
+  }
+  // sum the statistics of the rows between the cuts of the combined sketches,
+  // the buckets of all the nodes and features are synchronized at once
+  inline void BuildBucketStats(const std::vector<bst_gpair> &gpair,
+                               DMatrix *p_fmat,
+                               const RegTree &tree) {
+    const MetaInfo& info = p_fmat->info();
+    const bst_uint num_feature = tree.param.num_feature;
+    bucket_ptr.resize(summary_array.size() + 1);
+    bucket_ptr[0] = 0;
+    for (size_t i = 0; i < summary_array.size(); ++i) {
+      bucket_ptr[i + 1] = bucket_ptr[i] + summary_array[i].size;
+    }
+    bucket_stats.assign(bucket_ptr.back(), SKStats(param));
+    dmlc::DataIter<ColBatch> *iter = p_fmat->ColIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const ColBatch &batch = iter->Value();
+      const bst_omp_uint nsize = static_cast<bst_omp_uint>(batch.size);
+      #pragma omp parallel for schedule(dynamic, 1)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const ColBatch::Inst c = batch[i];
+        const bst_uint fid = batch.col_index[i];
+        for (bst_uint j = 0; j < c.length; ++j) {
+          const bst_uint ridx = c[j].index;
+          const int nid = this->position[ridx];
+          if (nid < 0) continue;
+          const size_t k = this->node2workindex[nid] * num_feature + fid;
+          const WXQSketch::Summary &cuts = summary_array[k];
+          // the bucket of the last cut not above the value
+          const WXQSketch::Entry *it = std::upper_bound(
+              cuts.data, cuts.data + cuts.size, c[j].fvalue,
+              [](bst_float v, const WXQSketch::Entry &e) { return v < e.value; });
+          const size_t bucket = it == cuts.data ? 0 : it - cuts.data - 1;
+          bucket_stats[bucket_ptr[k] + bucket].Add(gpair, info, ridx);
+        }
       }
     }
+    stats_reducer.Allreduce(dmlc::BeginPtr(bucket_stats), bucket_stats.size());
   }
   inline void SyncNodeStats(void) {
     CHECK_NE(qexpand.size(), 0U);
@@ -281,6 +384,12 @@ class SketchMaker: public BaseMaker {
       CHECK_EQ(node2workindex[nid], static_cast<int>(wid));
       SplitEntry &best = sol[wid];
       for (bst_uint fid = 0; fid < num_feature; ++fid) {
+        if (skparam.combined_sketch) {
+          const size_t k = wid * num_feature + fid;
+          EnumerateBuckets(summary_array[k], dmlc::BeginPtr(bucket_stats) + bucket_ptr[k],
+                           node_stats[nid], fid, &best);
+          continue;
+        }
         unsigned base = (wid * p_tree->param.num_feature + fid) * 3;
         EnumerateSplit(summary_array[base + 0],
                        summary_array[base + 1],
@@ -344,40 +453,73 @@ class SketchMaker: public BaseMaker {
       WXQSketch::Entry pos = pos_grad.Query(fsplits[i], ipos);
       WXQSketch::Entry neg = neg_grad.Query(fsplits[i], ineg);
       WXQSketch::Entry hess = sum_hess.Query(fsplits[i], ihess);
-      SKStats s, c;
+      SKStats s;
       s.pos_grad = 0.5f * (pos.rmin + pos.rmax - pos.wmin);
       s.neg_grad = 0.5f * (neg.rmin + neg.rmax - neg.wmin);
       s.sum_hess = 0.5f * (hess.rmin + hess.rmax - hess.wmin);
-      c.SetSubstract(node_sum, s);
-      // forward
-      if (s.sum_hess >= param.min_child_weight &&
-          c.sum_hess >= param.min_child_weight) {
-        double loss_chg = s.CalcGain(param) + c.CalcGain(param) - root_gain;
-        best->Update(static_cast<bst_float>(loss_chg), fid, fsplits[i], false);
-      }
-      // backward
-      c.SetSubstract(feat_sum, s);
-      s.SetSubstract(node_sum, c);
-      if (s.sum_hess >= param.min_child_weight &&
-          c.sum_hess >= param.min_child_weight) {
-        double loss_chg = s.CalcGain(param) + c.CalcGain(param) - root_gain;
-        best->Update(static_cast<bst_float>(loss_chg), fid, fsplits[i], true);
-      }
+      this->TrySplit(s, feat_sum, node_sum, root_gain, fid, fsplits[i], best);
     }
-    {
-      // all including
-      SKStats s = feat_sum, c;
-      c.SetSubstract(node_sum, s);
-      if (s.sum_hess >= param.min_child_weight &&
-          c.sum_hess >= param.min_child_weight) {
-        bst_float cpt = fsplits.back();
-        double loss_chg = s.CalcGain(param) + c.CalcGain(param) - root_gain;
-        best->Update(static_cast<bst_float>(loss_chg),
-                     fid, cpt + std::abs(cpt) + 1.0f, false);
-      }
+    this->TryAllIncluding(feat_sum, node_sum, root_gain, fid, fsplits.back(), best);
+  }
+  // enumerate the cuts of a combined sketch, bucket i holds the statistics
+  // of the rows between cut i and cut i + 1
+  inline void EnumerateBuckets(const WXQSketch::Summary &cuts,
+                               const SKStats *buckets,
+                               const SKStats &node_sum,
+                               bst_uint fid,
+                               SplitEntry *best) {
+    if (cuts.size == 0) return;
+    double root_gain = node_sum.CalcGain(param);
+    SKStats feat_sum(param);
+    for (size_t i = 0; i < cuts.size; ++i) {
+      feat_sum.Add(buckets[i]);
+    }
+    SKStats s(param);
+    for (size_t i = 1; i < cuts.size; ++i) {
+      s.Add(buckets[i - 1]);
+      this->TrySplit(s, feat_sum, node_sum, root_gain, fid, cuts.data[i].value, best);
+    }
+    this->TryAllIncluding(feat_sum, node_sum, root_gain, fid,
+                          cuts.data[cuts.size - 1].value, best);
+  }
+  // try the split at split_value with the statistics s of the rows below it,
+  // the missing values going right then left
+  inline void TrySplit(SKStats s, const SKStats &feat_sum, const SKStats &node_sum,
+                       double root_gain, bst_uint fid, bst_float split_value,
+                       SplitEntry *best) {
+    SKStats c;
+    c.SetSubstract(node_sum, s);
+    // forward
+    if (s.sum_hess >= param.min_child_weight &&
+        c.sum_hess >= param.min_child_weight) {
+      double loss_chg = s.CalcGain(param) + c.CalcGain(param) - root_gain;
+      best->Update(static_cast<bst_float>(loss_chg), fid, split_value, false);
+    }
+    // backward
+    c.SetSubstract(feat_sum, s);
+    s.SetSubstract(node_sum, c);
+    if (s.sum_hess >= param.min_child_weight &&
+        c.sum_hess >= param.min_child_weight) {
+      double loss_chg = s.CalcGain(param) + c.CalcGain(param) - root_gain;
+      best->Update(static_cast<bst_float>(loss_chg), fid, split_value, true);
+    }
+  }
+  // try the split above the largest value cpt, all the values going left
+  inline void TryAllIncluding(const SKStats &feat_sum, const SKStats &node_sum,
+                              double root_gain, bst_uint fid, bst_float cpt,
+                              SplitEntry *best) {
+    SKStats s = feat_sum, c;
+    c.SetSubstract(node_sum, s);
+    if (s.sum_hess >= param.min_child_weight &&
+        c.sum_hess >= param.min_child_weight) {
+      double loss_chg = s.CalcGain(param) + c.CalcGain(param) - root_gain;
+      best->Update(static_cast<bst_float>(loss_chg),
+                   fid, cpt + std::abs(cpt) + 1.0f, false);
     }
   }
 
+  // parameters of the sketch maker
+  SketchMakerParam skparam;
   // thread temp data
   // used to hold temporal sketch
   std::vector<std::vector<SketchEntry> > thread_sketch;
@@ -393,6 +535,10 @@ class SketchMaker: public BaseMaker {
   rabit::SerializeReducer<WXQSketch::SummaryContainer> sketch_reducer;
   // per node, per feature sketch
   std::vector<common::WXQuantileSketch<bst_float, bst_float> > sketchs;
+  // start of the buckets of each combined sketch in bucket_stats
+  std::vector<size_t> bucket_ptr;
+  // statistics of the rows between the cuts of the combined sketches
+  std::vector<SKStats> bucket_stats;
 };
 
 XGBOOST_REGISTER_TREE_UPDATER(SketchMaker, "grow_skmaker")
@@ -4,6 +4,8 @@
  * \brief synchronize the tree in all distributed nodes
  */
 #include <xgboost/tree_updater.h>
+#include <dmlc/parameter.h>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <limits>
@@ -15,32 +17,97 @@ namespace tree {
 
 DMLC_REGISTRY_FILE_TAG(updater_sync);
 
+/*! \brief how the trees are synchronized */
+enum SyncMode { kSyncFull = 0, kSyncVerify = 1 };
+
+/*! \brief parameters of the tree syncher */
+struct SyncParam : public dmlc::Parameter<SyncParam> {
+  int sync_mode;
+  DMLC_DECLARE_PARAMETER(SyncParam) {
+    DMLC_DECLARE_FIELD(sync_mode)
+        .set_default(kSyncFull)
+        .add_enum("full", kSyncFull)
+        .add_enum("verify", kSyncVerify)
+        .describe("full: broadcast all the trees of node 0; "
+                  "verify: compare the hashes of the trees and only broadcast "
+                  "the trees that differ between the nodes.");
+  }
+};
+
+DMLC_REGISTER_PARAMETER(SyncParam);
+
 /*!
  * \brief syncher that synchronize the tree in all distributed nodes
  * can implement various strategies, so far it is always set to node 0's tree
  */
 class TreeSyncher: public TreeUpdater {
  public:
-  void Init(const std::vector<std::pair<std::string, std::string> >& args) override {}
+  void Init(const std::vector<std::pair<std::string, std::string> >& args) override {
+    param.InitAllowUnknown(args);
+  }
 
   void Update(HostDeviceVector<bst_gpair> *gpair,
               DMatrix* dmat,
               const std::vector<RegTree*> &trees) override {
     if (rabit::GetWorldSize() == 1) return;
+    std::vector<size_t> sync;
+    if (param.sync_mode == kSyncVerify) {
+      sync = DifferentTrees(trees);
+      if (sync.empty()) return;
+    } else {
+      for (size_t i = 0; i < trees.size(); ++i) {
+        sync.push_back(i);
+      }
+    }
     std::string s_model;
     common::MemoryBufferStream fs(&s_model);
     int rank = rabit::GetRank();
     if (rank == 0) {
-      for (size_t i = 0; i < trees.size(); ++i) {
+      for (size_t i : sync) {
         trees[i]->Save(&fs);
       }
     }
     fs.Seek(0);
     rabit::Broadcast(&s_model, 0);
-    for (size_t i = 0; i < trees.size(); ++i) {
+    for (size_t i : sync) {
       trees[i]->Load(&fs);
     }
   }
+
+ private:
+  /*!
+   * \brief find the trees that are not the same on all the nodes,
+   *  by reducing the maximum and the minimum of the hash of every tree
+   */
+  static std::vector<size_t> DifferentTrees(const std::vector<RegTree*> &trees) {
+    const size_t ntree = trees.size();
+    // the minimum is the complement of the maximum of the complements
+    std::vector<uint64_t> hash(ntree * 2);
+    for (size_t i = 0; i < ntree; ++i) {
+      std::string s_tree;
+      common::MemoryBufferStream fs(&s_tree);
+      trees[i]->Save(&fs);
+      hash[i] = Hash(s_tree);
+      hash[ntree + i] = ~hash[i];
+    }
+    rabit::Allreduce<rabit::op::Max>(dmlc::BeginPtr(hash), hash.size());
+    std::vector<size_t> diff;
+    for (size_t i = 0; i < ntree; ++i) {
+      if (hash[i] != ~hash[ntree + i]) diff.push_back(i);
+    }
+    return diff;
+  }
+  /*! \brief 64-bit FNV-1a hash of the serialized tree */
+  static uint64_t Hash(const std::string& s) {
+    uint64_t h = 14695981039346656037ULL;
+    for (char c : s) {
+      h ^= static_cast<unsigned char>(c);
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  SyncParam param;
 };
 
 XGBOOST_REGISTER_TREE_UPDATER(TreeSyncher, "sync")
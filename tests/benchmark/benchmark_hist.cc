@@ -0,0 +1,300 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file benchmark_hist.cc
+ * \brief Micro benchmark of the kernels of the hist tree method: the
+ *  quantile sketch, the histogram cuts, the quantized and the column
+ *  matrices, the histogram construction and the row partition, over
+ *  sizes of the data and numbers of threads. Usage:
+ *    benchmark_hist [key=value ...]
+ *  e.g. benchmark_hist rows=100000,1000000 features=32 threads=1,4
+ */
+#include <dmlc/parameter.h>
+#include <dmlc/timer.h>
+#include <dmlc/omp.h>
+#include <xgboost/c_api.h>
+#include <xgboost/data.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../src/common/column_matrix.h"
+#include "../../src/common/common.h"
+#include "../../src/common/hist_util.h"
+#include "../../src/common/quantile.h"
+#include "../../src/common/row_set.h"
+#include "../../src/tree/fast_hist_param.h"
+
+namespace xgboost {
+namespace benchmark {
+
+struct BenchmarkParam : public dmlc::Parameter<BenchmarkParam> {
+  /*! \brief comma separated list of the number of rows */
+  std::string rows;
+  /*! \brief comma separated list of the number of features */
+  std::string features;
+  /*! \brief comma separated list of the number of threads */
+  std::string threads;
+  /*! \brief fraction of missing values */
+  float sparsity;
+  /*! \brief maximum number of bins of each feature */
+  int max_bin;
+  /*! \brief number of nodes of the batched histogram construction */
+  int nodes;
+  /*! \brief number of repeats, the best time is reported */
+  int repeat;
+  DMLC_DECLARE_PARAMETER(BenchmarkParam) {
+    DMLC_DECLARE_FIELD(rows).set_default("10000,100000")
+        .describe("Number of rows of the data.");
+    DMLC_DECLARE_FIELD(features).set_default("32")
+        .describe("Number of features of the data.");
+    DMLC_DECLARE_FIELD(threads).set_default("0")
+        .describe("Number of OpenMP threads, 0 means the default.");
+    DMLC_DECLARE_FIELD(sparsity).set_default(0.0f).set_range(0.0f, 1.0f)
+        .describe("Fraction of missing values.");
+    DMLC_DECLARE_FIELD(max_bin).set_default(256).set_lower_bound(2)
+        .describe("Maximum number of bins of each feature.");
+    DMLC_DECLARE_FIELD(nodes).set_default(8).set_lower_bound(1)
+        .describe("Number of nodes the rows are spread over by BuildHistBatch.");
+    DMLC_DECLARE_FIELD(repeat).set_default(3).set_lower_bound(1)
+        .describe("Number of repeats, the best time is reported.");
+  }
+};
+
+DMLC_REGISTER_PARAMETER(BenchmarkParam);
+
+typedef common::WXQuantileSketch<bst_float, bst_float> Sketch;
+
+template <typename T>
+std::vector<T> ParseList(const std::string& str) {
+  std::vector<T> ret;
+  for (const std::string& s : common::Split(str, ',')) {
+    if (s.length() != 0) ret.push_back(static_cast<T>(std::atof(s.c_str())));
+  }
+  return ret;
+}
+
+std::shared_ptr<DMatrix> CreateData(int rows, int columns, float sparsity) {
+  const float missing_value = -1.0f;
+  std::vector<float> data(static_cast<size_t>(rows) * columns);
+  std::mt19937 gen(rows + columns);
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  for (auto& e : data) {
+    e = dis(gen) < sparsity ? missing_value : dis(gen);
+  }
+  DMatrixHandle handle;
+  CHECK_EQ(XGDMatrixCreateFromMat(data.data(), rows, columns, missing_value, &handle), 0);
+  std::shared_ptr<DMatrix> ret = *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  XGDMatrixFree(handle);
+  return ret;
+}
+
+// run setup then the function param.repeat times, return the best wall
+// time of the function
+template <typename Func>
+double BestTime(const BenchmarkParam& param, Func func,
+                std::function<void()> setup = std::function<void()>()) {
+  double best = 0.0;
+  for (int i = 0; i < param.repeat; ++i) {
+    if (setup) setup();
+    double tstart = dmlc::GetTime();
+    func();
+    double elapsed = dmlc::GetTime() - tstart;
+    if (i == 0 || elapsed < best) best = elapsed;
+  }
+  return best;
+}
+
+void Report(const char* kernel, int nrow, int nfeature, int nthread, double sec) {
+  std::printf("%-20s %10d %8d %7d %12.4f %10.2f\n", kernel, nrow, nfeature,
+              nthread, sec * 1e3, sec * 1e9 / nrow);
+  std::fflush(stdout);
+}
+
+// pushes the values of each feature into its sketch, then reduces the
+// summaries pairwise as the allreduce of the cuts does
+void RunSketch(const BenchmarkParam& param, int nrow, int nfeature, int nthread) {
+  std::vector<bst_float> values(static_cast<size_t>(nrow) * nfeature);
+  std::mt19937 gen(nrow);
+  std::uniform_real_distribution<bst_float> dis(0.0f, 1.0f);
+  for (auto& v : values) v = dis(gen);
+  const double eps = 1.0 / (param.max_bin * common::HistCutMatrix::kSketchFactor);
+  std::vector<Sketch> sketchs(nfeature);
+  double sec = BestTime(param, [&]() {
+      #pragma omp parallel for schedule(static)
+      for (int fid = 0; fid < nfeature; ++fid) {
+        const bst_float* col = values.data() + static_cast<size_t>(fid) * nrow;
+        for (int i = 0; i < nrow; ++i) sketchs[fid].Push(col[i]);
+      }
+    }, [&]() {
+      for (auto& s : sketchs) s.Init(nrow, eps);
+    });
+  Report("SketchPush", nrow, nfeature, nthread, sec);
+
+  std::vector<Sketch::SummaryContainer> summary(nfeature);
+  const size_t nbytes = Sketch::SummaryContainer::CalcMemCost(
+      param.max_bin * common::HistCutMatrix::kSketchFactor);
+  sec = BestTime(param, [&]() {
+      for (int step = 1; step < nfeature; step *= 2) {
+        #pragma omp parallel for schedule(static)
+        for (int fid = 0; fid < nfeature - step; fid += 2 * step) {
+          summary[fid].Reduce(summary[fid + step], nbytes);
+        }
+      }
+    }, [&]() {
+      for (int fid = 0; fid < nfeature; ++fid) sketchs[fid].GetSummary(&summary[fid]);
+    });
+  Report("SketchMerge", nrow, nfeature, nthread, sec);
+}
+
+// rows going left or right at random, the nodes are split in breadth first
+// order until there are param.nodes of them
+void RunPartition(const BenchmarkParam& param, int nrow, int nfeature, int nthread) {
+  common::RowSetCollection row_set;
+  std::mt19937 gen(nrow);
+  std::bernoulli_distribution coin_flip(0.5);
+  std::vector<std::vector<uint8_t> > goes_left;
+  double sec = BestTime(param, [&]() {
+      for (int nid = 0; nid < param.nodes - 1; ++nid) {
+        row_set.Partition(nid, goes_left[nid], 2 * nid + 1, 2 * nid + 2, nthread);
+      }
+    }, [&]() {
+      row_set.Clear();
+      row_set.row_indices_.resize(nrow);
+      std::iota(row_set.row_indices_.begin(), row_set.row_indices_.end(), 0);
+      row_set.Init();
+      // the directions of the rows of each split are drawn before the timer
+      goes_left.resize(param.nodes - 1);
+      std::vector<size_t> sizes(2 * param.nodes, 0);
+      sizes[0] = nrow;
+      for (int nid = 0; nid < param.nodes - 1; ++nid) {
+        goes_left[nid].resize(sizes[nid]);
+        for (size_t i = 0; i < sizes[nid]; ++i) {
+          goes_left[nid][i] = coin_flip(gen);
+          sizes[2 * nid + 1] += goes_left[nid][i];
+        }
+        sizes[2 * nid + 2] = sizes[nid] - sizes[2 * nid + 1];
+      }
+    });
+  Report("Partition", nrow, nfeature, nthread, sec);
+}
+
+void RunHist(const BenchmarkParam& param, int nrow, int nfeature, int nthread) {
+  std::shared_ptr<DMatrix> dmat = CreateData(nrow, nfeature, param.sparsity);
+  common::HistCutMatrix cut;
+  double sec = BestTime(param, [&]() {
+      cut = common::HistCutMatrix();
+      cut.Init(dmat.get(), param.max_bin);
+    });
+  Report("HistCutMatrix::Init", nrow, nfeature, nthread, sec);
+
+  common::GHistIndexMatrix gmat;
+  sec = BestTime(param, [&]() {
+      gmat = common::GHistIndexMatrix();
+      gmat.cut = &cut;
+      gmat.Init(dmat.get());
+    });
+  Report("GHistIndexMatrix", nrow, nfeature, nthread, sec);
+
+  tree::FastHistParam fhparam;
+  fhparam.InitAllowUnknown(std::vector<std::pair<std::string, std::string> >{
+      {"enable_feature_grouping", "1"}});
+  common::ColumnMatrix colmat;
+  sec = BestTime(param, [&]() {
+      colmat.Init(gmat, fhparam);
+    });
+  Report("ColumnMatrix::Init", nrow, nfeature, nthread, sec);
+
+  common::GHistIndexBlockMatrix gmatb;
+  sec = BestTime(param, [&]() {
+      gmatb = common::GHistIndexBlockMatrix();
+      gmatb.Init(gmat, colmat, fhparam);
+    });
+  Report("GHistIndexBlock", nrow, nfeature, nthread, sec);
+
+  const uint32_t nbins = cut.row_ptr.back();
+  std::vector<bst_gpair> gpair(nrow);
+  std::mt19937 gen(nrow);
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  for (auto& g : gpair) g = bst_gpair(dis(gen) - 0.5f, dis(gen));
+  std::vector<size_t> rows(nrow);
+  std::iota(rows.begin(), rows.end(), 0);
+  const common::RowSetCollection::Elem root(rows.data(), rows.data() + nrow, 0);
+  const std::vector<bst_uint> feat_set;
+
+  common::GHistBuilder builder;
+  builder.Init(nthread, nbins);
+  common::HistCollection hist;
+  hist.Init(nbins);
+  for (int nid = 0; nid < 3; ++nid) hist.AddHistRow(nid);
+  sec = BestTime(param, [&]() {
+      builder.BuildHist(gpair, root, gmat, feat_set, hist[0]);
+    });
+  Report("BuildHist", nrow, nfeature, nthread, sec);
+  sec = BestTime(param, [&]() {
+      builder.BuildBlockHist(gpair, root, gmatb, feat_set, hist[0]);
+    });
+  Report("BuildBlockHist", nrow, nfeature, nthread, sec);
+  // the node 1 holds the first half of the rows, node 2 the other half
+  builder.BuildHist(gpair, common::RowSetCollection::Elem(rows.data(),
+                    rows.data() + nrow / 2, 1), gmat, feat_set, hist[1]);
+  sec = BestTime(param, [&]() {
+      builder.SubtractionTrick(hist[2], hist[1], hist[0]);
+    });
+  Report("SubtractionTrick", nrow, nfeature, nthread, sec);
+
+  // the rows spread over nodes of decreasing sizes, as at a level of a tree
+  std::vector<common::RowSetCollection::Elem> row_sets;
+  std::vector<common::GHistEntry> batch(static_cast<size_t>(param.nodes) * nbins);
+  std::vector<common::GHistRow> hists;
+  size_t begin = 0;
+  for (int nid = 0; nid < param.nodes; ++nid) {
+    const size_t end = nid + 1 == param.nodes ? nrow : begin + (nrow - begin) / 2;
+    row_sets.emplace_back(rows.data() + begin, rows.data() + end, nid);
+    hists.emplace_back(batch.data() + static_cast<size_t>(nid) * nbins, nbins);
+    begin = end;
+  }
+  sec = BestTime(param, [&]() {
+      builder.BuildHistBatch(gpair, row_sets, gmat, feat_set, hists);
+    });
+  Report("BuildHistBatch", nrow, nfeature, nthread, sec);
+}
+
+void Run(const BenchmarkParam& param) {
+  const int default_nthread = omp_get_max_threads();
+  std::printf("%-20s %10s %8s %7s %12s %10s\n", "kernel", "rows", "features",
+              "threads", "msec", "nsec/row");
+  for (int nrow : ParseList<int>(param.rows)) {
+    for (int nfeature : ParseList<int>(param.features)) {
+      for (int nthread : ParseList<int>(param.threads)) {
+        if (nthread <= 0) nthread = default_nthread;
+        omp_set_num_threads(nthread);
+        RunSketch(param, nrow, nfeature, nthread);
+        RunHist(param, nrow, nfeature, nthread);
+        RunPartition(param, nrow, nfeature, nthread);
+      }
+    }
+  }
+  omp_set_num_threads(default_nthread);
+}
+}  // namespace benchmark
+}  // namespace xgboost
+
+int main(int argc, char* argv[]) {
+  std::vector<std::pair<std::string, std::string> > cfg;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    size_t pos = arg.find('=');
+    CHECK_NE(pos, std::string::npos) << "arguments must be key=value, got " << arg;
+    cfg.push_back(std::make_pair(arg.substr(0, pos), arg.substr(pos + 1)));
+  }
+  xgboost::benchmark::BenchmarkParam param;
+  param.Init(cfg);
+  xgboost::benchmark::Run(param);
+  return 0;
+}
@@ -0,0 +1,207 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file benchmark_predictor.cc
+ * \brief Throughput benchmark of the registered predictors over a grid of
+ *  model and data shapes. Usage:
+ *    benchmark_predictor [key=value ...]
+ *  e.g. benchmark_predictor predictors=cpu_predictor trees=100 threads=1,4
+ */
+#include <dmlc/parameter.h>
+#include <dmlc/registry.h>
+#include <dmlc/timer.h>
+#include <dmlc/omp.h>
+#include <xgboost/c_api.h>
+#include <xgboost/predictor.h>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../src/common/common.h"
+#include "../../src/gbm/gbtree_model.h"
+#include "../cpp/helpers.h"
+
+namespace xgboost {
+namespace benchmark {
+
+struct BenchmarkParam : public dmlc::Parameter<BenchmarkParam> {
+  /*! \brief comma separated names of the predictors */
+  std::string predictors;
+  /*! \brief comma separated list of the number of trees */
+  std::string trees;
+  /*! \brief comma separated list of the tree depths */
+  std::string depths;
+  /*! \brief comma separated list of the number of features */
+  std::string features;
+  /*! \brief comma separated list of the fraction of missing values */
+  std::string sparsity;
+  /*! \brief comma separated list of the number of threads */
+  std::string threads;
+  /*! \brief number of rows in the batch */
+  int rows;
+  /*! \brief number of rows used by PredictContribution */
+  int contrib_rows;
+  /*! \brief number of repeats, the best time is reported */
+  int repeat;
+  DMLC_DECLARE_PARAMETER(BenchmarkParam) {
+    DMLC_DECLARE_FIELD(predictors)
+        .set_default("cpu_predictor,cpu_quickscorer,cpu_binned,gpu_predictor")
+        .describe("Predictors to benchmark, unregistered ones are skipped.");
+    DMLC_DECLARE_FIELD(trees).set_default("10,100,1000")
+        .describe("Number of trees in the model.");
+    DMLC_DECLARE_FIELD(depths).set_default("4,8")
+        .describe("Depth of the full trees.");
+    DMLC_DECLARE_FIELD(features).set_default("16,128")
+        .describe("Number of features.");
+    DMLC_DECLARE_FIELD(sparsity).set_default("0,0.5")
+        .describe("Fraction of missing values in the data.");
+    DMLC_DECLARE_FIELD(threads).set_default("1,0")
+        .describe("Number of OpenMP threads, 0 means the default.");
+    DMLC_DECLARE_FIELD(rows).set_default(10000).set_lower_bound(1)
+        .describe("Number of rows in the batch.");
+    DMLC_DECLARE_FIELD(contrib_rows).set_default(1000).set_lower_bound(1)
+        .describe("Number of rows used by PredictContribution.");
+    DMLC_DECLARE_FIELD(repeat).set_default(3).set_lower_bound(1)
+        .describe("Number of repeats, the best time is reported.");
+  }
+};
+
+DMLC_REGISTER_PARAMETER(BenchmarkParam);
+
+template <typename T>
+std::vector<T> ParseList(const std::string& str) {
+  std::vector<T> ret;
+  for (const std::string& s : common::Split(str, ',')) {
+    if (s.length() != 0) ret.push_back(static_cast<T>(std::atof(s.c_str())));
+  }
+  return ret;
+}
+
+std::unique_ptr<gbm::GBTreeModel> CreateModel(int num_tree, int depth,
+                                              int num_feature) {
+  std::unique_ptr<gbm::GBTreeModel> model(new gbm::GBTreeModel(0.5f));
+  model->param.num_feature = num_feature;
+  model->param.num_output_group = 1;
+  std::mt19937 gen(num_tree * 131 + depth);
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < num_tree; ++i) {
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree()));
+    trees.back()->InitModel();
+    GrowRandomTree(trees.back().get(), 0, depth, num_feature, &gen);
+  }
+  model->CommitModel(std::move(trees), 0);
+  return model;
+}
+
+std::shared_ptr<DMatrix> CreateData(int rows, int columns, float sparsity) {
+  const float missing_value = -1.0f;
+  std::vector<float> data(static_cast<size_t>(rows) * columns);
+  std::mt19937 gen(rows + columns);
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  for (auto& e : data) {
+    e = dis(gen) < sparsity ? missing_value : dis(gen);
+  }
+  DMatrixHandle handle;
+  CHECK_EQ(XGDMatrixCreateFromMat(data.data(), rows, columns, missing_value, &handle), 0);
+  std::shared_ptr<DMatrix> ret = *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  XGDMatrixFree(handle);
+  return ret;
+}
+
+// run the function param.repeat times, return the best wall time
+template <typename Func>
+double BestTime(const BenchmarkParam& param, Func func) {
+  double best = 0.0;
+  for (int i = 0; i < param.repeat; ++i) {
+    double tstart = dmlc::GetTime();
+    func();
+    double elapsed = dmlc::GetTime() - tstart;
+    if (i == 0 || elapsed < best) best = elapsed;
+  }
+  return best;
+}
+
+void Report(const char* predictor, const char* method, int ntree, int depth,
+            int nfeature, float sparsity, int nthread, int nrow, double sec) {
+  std::printf("%-16s %-20s %6d %5d %8d %8.2f %7d %12.0f\n", predictor, method,
+              ntree, depth, nfeature, sparsity, nthread, nrow / sec);
+  std::fflush(stdout);
+}
+
+void Run(const BenchmarkParam& param) {
+  const int default_nthread = omp_get_max_threads();
+  std::printf("%-16s %-20s %6s %5s %8s %8s %7s %12s\n", "predictor", "method",
+              "trees", "depth", "features", "sparsity", "threads", "rows/sec");
+  for (const std::string& name : common::Split(param.predictors, ',')) {
+    if (::dmlc::Registry<PredictorReg>::Find(name) == nullptr) {
+      std::fprintf(stderr, "skip unregistered predictor %s\n", name.c_str());
+      continue;
+    }
+    std::unique_ptr<Predictor> predictor(Predictor::Create(name));
+    predictor->Init({}, {});
+    for (int nfeature : ParseList<int>(param.features)) {
+      for (float sparsity : ParseList<float>(param.sparsity)) {
+        std::shared_ptr<DMatrix> dmat = CreateData(param.rows, nfeature, sparsity);
+        std::shared_ptr<DMatrix> dcontrib =
+            CreateData(param.contrib_rows, nfeature, sparsity);
+        for (int ntree : ParseList<int>(param.trees)) {
+          for (int depth : ParseList<int>(param.depths)) {
+            std::unique_ptr<gbm::GBTreeModel> model = CreateModel(ntree, depth, nfeature);
+            for (int nthread : ParseList<int>(param.threads)) {
+              if (nthread <= 0) nthread = default_nthread;
+              omp_set_num_threads(nthread);
+              HostDeviceVector<bst_float> preds;
+              std::vector<bst_float> out;
+              double sec = BestTime(param, [&]() {
+                  predictor->PredictBatch(dmat.get(), &preds, *model, 0);
+                });
+              Report(name.c_str(), "PredictBatch", ntree, depth, nfeature,
+                     sparsity, nthread, param.rows, sec);
+              sec = BestTime(param, [&]() {
+                  dmlc::DataIter<RowBatch>* iter = dmat->RowIterator();
+                  iter->BeforeFirst();
+                  while (iter->Next()) {
+                    const RowBatch& batch = iter->Value();
+                    for (size_t i = 0; i < batch.size; ++i) {
+                      predictor->PredictInstance(batch[i], &out, *model);
+                    }
+                  }
+                });
+              Report(name.c_str(), "PredictInstance", ntree, depth, nfeature,
+                     sparsity, 1, param.rows, sec);
+              sec = BestTime(param, [&]() {
+                  predictor->PredictLeaf(dmat.get(), &out, *model);
+                });
+              Report(name.c_str(), "PredictLeaf", ntree, depth, nfeature,
+                     sparsity, nthread, param.rows, sec);
+              sec = BestTime(param, [&]() {
+                  predictor->PredictContribution(dcontrib.get(), &out, *model);
+                });
+              Report(name.c_str(), "PredictContribution", ntree, depth, nfeature,
+                     sparsity, nthread, param.contrib_rows, sec);
+            }
+            omp_set_num_threads(default_nthread);
+          }
+        }
+      }
+    }
+  }
+}
+}  // namespace benchmark
+}  // namespace xgboost
+
+int main(int argc, char* argv[]) {
+  std::vector<std::pair<std::string, std::string> > cfg;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    size_t pos = arg.find('=');
+    CHECK_NE(pos, std::string::npos) << "arguments must be key=value, got " << arg;
+    cfg.push_back(std::make_pair(arg.substr(0, pos), arg.substr(pos + 1)));
+  }
+  xgboost::benchmark::BenchmarkParam param;
+  param.Init(cfg);
+  xgboost::benchmark::Run(param);
+  return 0;
+}
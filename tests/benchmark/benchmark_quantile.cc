@@ -0,0 +1,214 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file benchmark_quantile.cc
+ * \brief Benchmark of the merge and prune kernels of the weighted quantile
+ *  summaries. The merge of the library, on entries stored as an array of
+ *  structures, is compared to a branch free merge on a structure of
+ *  arrays. Usage:
+ *    benchmark_quantile [key=value ...]
+ *  e.g. benchmark_quantile sizes=256,4096 duplicates=0,0.5
+ */
+#include <dmlc/parameter.h>
+#include <dmlc/timer.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../src/common/common.h"
+#include "../../src/common/quantile.h"
+
+namespace xgboost {
+namespace benchmark {
+
+struct BenchmarkParam : public dmlc::Parameter<BenchmarkParam> {
+  /*! \brief comma separated list of the sizes of the merged summaries */
+  std::string sizes;
+  /*! \brief comma separated list of the fraction of values shared by both summaries */
+  std::string duplicates;
+  /*! \brief number of entries processed by each measure */
+  int entries;
+  /*! \brief number of repeats, the best time is reported */
+  int repeat;
+  DMLC_DECLARE_PARAMETER(BenchmarkParam) {
+    DMLC_DECLARE_FIELD(sizes).set_default("64,1024,16384")
+        .describe("Number of entries of each merged summary.");
+    DMLC_DECLARE_FIELD(duplicates).set_default("0,0.5")
+        .describe("Fraction of the values present in both summaries.");
+    DMLC_DECLARE_FIELD(entries).set_default(1 << 24).set_lower_bound(1)
+        .describe("Number of input entries processed by each measure.");
+    DMLC_DECLARE_FIELD(repeat).set_default(3).set_lower_bound(1)
+        .describe("Number of repeats, the best time is reported.");
+  }
+};
+
+DMLC_REGISTER_PARAMETER(BenchmarkParam);
+
+typedef common::WXQSummary<bst_float, bst_float> Summary;
+typedef Summary::Entry Entry;
+
+template <typename T>
+std::vector<T> ParseList(const std::string& str) {
+  std::vector<T> ret;
+  for (const std::string& s : common::Split(str, ',')) {
+    if (s.length() != 0) ret.push_back(static_cast<T>(std::atof(s.c_str())));
+  }
+  return ret;
+}
+
+// two exact summaries of about n values in total, sharing the given fraction
+void CreateSummaries(size_t n, float duplicates, std::vector<Entry>* a,
+                     std::vector<Entry>* b) {
+  std::mt19937 gen(static_cast<unsigned>(n));
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  std::vector<bst_float> va, vb;
+  for (size_t i = 0; i < n; ++i) {
+    const bst_float v = static_cast<bst_float>(i);
+    // shared, or in one summary at random, so the merge order is not predictable
+    if (dis(gen) < duplicates) {
+      va.push_back(v);
+      vb.push_back(v);
+    } else if (dis(gen) < 0.5f) {
+      va.push_back(v);
+    } else {
+      vb.push_back(v);
+    }
+  }
+  for (auto p : {std::make_pair(&va, a), std::make_pair(&vb, b)}) {
+    bst_float rank = 0.0f;
+    p.second->clear();
+    for (bst_float v : *p.first) {
+      const bst_float w = 0.5f + dis(gen);
+      p.second->push_back(Entry(rank, rank + w, w, v));
+      rank += w;
+    }
+  }
+}
+
+/*! \brief summary stored as a structure of arrays */
+struct SoASummary {
+  std::vector<bst_float> rmin, rmax, wmin, value;
+  size_t size;
+  explicit SoASummary(const std::vector<Entry>& entries) : size(entries.size()) {
+    for (const Entry& e : entries) {
+      rmin.push_back(e.rmin);
+      rmax.push_back(e.rmax);
+      wmin.push_back(e.wmin);
+      value.push_back(e.value);
+    }
+  }
+  explicit SoASummary(size_t capacity)
+      : rmin(capacity), rmax(capacity), wmin(capacity), value(capacity), size(0) {}
+};
+
+// the merge of WQSummary::SetCombine with selects in place of its
+// branches, followed by the same fix of the rounding errors
+void SoACombine(const SoASummary& sa, const SoASummary& sb, SoASummary* out) {
+  size_t i = 0, j = 0, k = 0;
+  bst_float aprev_rmin = 0, bprev_rmin = 0;
+  while (i < sa.size && j < sb.size) {
+    const bst_float va = sa.value[i], vb = sb.value[j];
+    const bool take_a = va <= vb;
+    const bool take_b = !(va < vb);
+    const bst_float armin = sa.rmin[i], armax = sa.rmax[i], awmin = sa.wmin[i];
+    const bst_float brmin = sb.rmin[j], brmax = sb.rmax[j], bwmin = sb.wmin[j];
+    out->rmin[k] = (take_a ? armin : aprev_rmin) + (take_b ? brmin : bprev_rmin);
+    out->rmax[k] = (take_a ? armax : armax - awmin) + (take_b ? brmax : brmax - bwmin);
+    out->wmin[k] = (take_a ? awmin : 0.0f) + (take_b ? bwmin : 0.0f);
+    out->value[k] = take_a ? va : vb;
+    aprev_rmin = take_a ? armin + awmin : aprev_rmin;
+    bprev_rmin = take_b ? brmin + bwmin : bprev_rmin;
+    i += take_a; j += take_b; ++k;
+  }
+  for (; i < sa.size; ++i, ++k) {
+    out->rmin[k] = sa.rmin[i] + bprev_rmin;
+    out->rmax[k] = sa.rmax[i] + sb.rmax[sb.size - 1];
+    out->wmin[k] = sa.wmin[i];
+    out->value[k] = sa.value[i];
+  }
+  for (; j < sb.size; ++j, ++k) {
+    out->rmin[k] = sb.rmin[j] + aprev_rmin;
+    out->rmax[k] = sb.rmax[j] + sa.rmax[sa.size - 1];
+    out->wmin[k] = sb.wmin[j];
+    out->value[k] = sb.value[j];
+  }
+  out->size = k;
+  bst_float prev_rmin = 0, prev_rmax = 0;
+  for (k = 0; k < out->size; ++k) {
+    const bst_float rmin = std::max(out->rmin[k], prev_rmin);
+    const bst_float rmax = std::max(std::max(out->rmax[k], prev_rmax), rmin + out->wmin[k]);
+    out->rmin[k] = prev_rmin = rmin;
+    out->rmax[k] = prev_rmax = rmax;
+  }
+}
+
+// run the function param.repeat times, return the best wall time
+template <typename Func>
+double BestTime(const BenchmarkParam& param, Func func) {
+  double best = 0.0;
+  for (int i = 0; i < param.repeat; ++i) {
+    double tstart = dmlc::GetTime();
+    func();
+    double elapsed = dmlc::GetTime() - tstart;
+    if (i == 0 || elapsed < best) best = elapsed;
+  }
+  return best;
+}
+
+void Report(const char* kernel, size_t size, float duplicates, size_t nentry, double sec) {
+  std::printf("%-18s %8zu %10.2f %12.2f\n", kernel, size, duplicates, sec * 1e9 / nentry);
+  std::fflush(stdout);
+}
+
+void Run(const BenchmarkParam& param) {
+  std::printf("%-18s %8s %10s %12s\n", "kernel", "size", "duplicates", "ns/entry");
+  for (size_t size : ParseList<size_t>(param.sizes)) {
+    for (float duplicates : ParseList<float>(param.duplicates)) {
+      std::vector<Entry> ea, eb;
+      CreateSummaries(size, duplicates, &ea, &eb);
+      Summary sa(ea.data(), ea.size()), sb(eb.data(), eb.size());
+      std::vector<Entry> eout(2 * size), epruned(size / 2 + 2);
+      Summary out(eout.data(), 0), pruned(epruned.data(), 0);
+      const size_t nrepeat = std::max(static_cast<size_t>(param.entries) / (2 * size),
+                                      static_cast<size_t>(1));
+      const size_t nentry = nrepeat * 2 * size;
+      double sec = BestTime(param, [&]() {
+          for (size_t i = 0; i < nrepeat; ++i) out.SetCombine(sa, sb);
+        });
+      Report("combine", size, duplicates, nentry, sec);
+      SoASummary soa_a(ea), soa_b(eb), soa_out(2 * size);
+      sec = BestTime(param, [&]() {
+          for (size_t i = 0; i < nrepeat; ++i) SoACombine(soa_a, soa_b, &soa_out);
+        });
+      CHECK_EQ(soa_out.size, out.size);
+      for (size_t i = 0; i < out.size; ++i) {
+        CHECK_EQ(soa_out.rmin[i], out.data[i].rmin);
+        CHECK_EQ(soa_out.rmax[i], out.data[i].rmax);
+        CHECK_EQ(soa_out.value[i], out.data[i].value);
+      }
+      Report("combine_soa", size, duplicates, nentry, sec);
+      sec = BestTime(param, [&]() {
+          for (size_t i = 0; i < nrepeat; ++i) pruned.SetPrune(out, epruned.size());
+        });
+      Report("prune", out.size, duplicates, nrepeat * out.size, sec);
+    }
+  }
+}
+}  // namespace benchmark
+}  // namespace xgboost
+
+int main(int argc, char* argv[]) {
+  std::vector<std::pair<std::string, std::string> > cfg;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    size_t pos = arg.find('=');
+    CHECK_NE(pos, std::string::npos) << "arguments must be key=value, got " << arg;
+    cfg.push_back(std::make_pair(arg.substr(0, pos), arg.substr(pos + 1)));
+  }
+  xgboost::benchmark::BenchmarkParam param;
+  param.Init(cfg);
+  xgboost::benchmark::Run(param);
+  return 0;
+}
@@ -0,0 +1,275 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file benchmark_train.cc
+ * \brief End to end training benchmark of the tree methods on synthetic
+ *  data sets, with the time of each phase recorded by the monitors. The
+ *  results are written as JSON. Usage:
+ *    benchmark_train [key=value ...]
+ *  e.g. benchmark_train tree_methods=hist,exact datasets=dense rows=100000
+ */
+#include <dmlc/parameter.h>
+#include <dmlc/registry.h>
+#include <dmlc/timer.h>
+#include <dmlc/omp.h>
+#include <xgboost/c_api.h>
+#include <xgboost/tree_updater.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../src/common/common.h"
+#include "../../src/common/timer.h"
+
+namespace xgboost {
+namespace benchmark {
+
+struct BenchmarkParam : public dmlc::Parameter<BenchmarkParam> {
+  /*! \brief comma separated names of the tree methods */
+  std::string tree_methods;
+  /*! \brief comma separated kinds of the data sets */
+  std::string datasets;
+  /*! \brief comma separated list of the number of threads */
+  std::string threads;
+  /*! \brief number of rows */
+  int rows;
+  /*! \brief number of features */
+  int features;
+  /*! \brief fraction of missing values of the sparse data set */
+  float sparsity;
+  /*! \brief number of distinct values of the features of the categorical data set */
+  int categories;
+  /*! \brief number of rows of each group of the ranking data set */
+  int group_size;
+  /*! \brief number of boosting iterations */
+  int iterations;
+  /*! \brief depth of the trees */
+  int max_depth;
+  /*! \brief seed of the data generator */
+  int seed;
+  /*! \brief file the JSON results are written to, - for the standard output */
+  std::string output;
+  DMLC_DECLARE_PARAMETER(BenchmarkParam) {
+    DMLC_DECLARE_FIELD(tree_methods).set_default("exact,approx,hist,gpu_hist")
+        .describe("Tree methods to benchmark, the ones not built are skipped.");
+    DMLC_DECLARE_FIELD(datasets).set_default("dense,sparse,categorical,ranking")
+        .describe("Synthetic data sets: dense, sparse, categorical or ranking.");
+    DMLC_DECLARE_FIELD(threads).set_default("0")
+        .describe("Number of OpenMP threads, 0 means the default.");
+    DMLC_DECLARE_FIELD(rows).set_default(100000).set_lower_bound(1)
+        .describe("Number of rows.");
+    DMLC_DECLARE_FIELD(features).set_default(50).set_lower_bound(1)
+        .describe("Number of features.");
+    DMLC_DECLARE_FIELD(sparsity).set_default(0.9f).set_range(0.0f, 1.0f)
+        .describe("Fraction of missing values of the sparse data set.");
+    DMLC_DECLARE_FIELD(categories).set_default(16).set_lower_bound(2)
+        .describe("Number of distinct values of the categorical features.");
+    DMLC_DECLARE_FIELD(group_size).set_default(20).set_lower_bound(1)
+        .describe("Number of rows of each query group of the ranking data set.");
+    DMLC_DECLARE_FIELD(iterations).set_default(10).set_lower_bound(1)
+        .describe("Number of boosting iterations.");
+    DMLC_DECLARE_FIELD(max_depth).set_default(6).set_lower_bound(1)
+        .describe("Depth of the trees.");
+    DMLC_DECLARE_FIELD(seed).set_default(0)
+        .describe("Seed of the data generator.");
+    DMLC_DECLARE_FIELD(output).set_default("benchmark_train.json")
+        .describe("File the JSON results are written to, - for the standard output.");
+  }
+};
+
+DMLC_REGISTER_PARAMETER(BenchmarkParam);
+
+template <typename T>
+std::vector<T> ParseList(const std::string& str) {
+  std::vector<T> ret;
+  for (const std::string& s : common::Split(str, ',')) {
+    if (s.length() != 0) ret.push_back(static_cast<T>(std::atof(s.c_str())));
+  }
+  return ret;
+}
+
+// the label is a noisy function of the first features, so the trees have
+// splits to find
+float MakeLabel(const std::vector<float>& row, std::mt19937* gen) {
+  std::normal_distribution<float> noise(0.0f, 0.1f);
+  float y = 0.0f;
+  for (size_t j = 0; j < row.size() && j < 8; ++j) {
+    if (!std::isnan(row[j])) y += (j % 2 == 0 ? 1.0f : -0.5f) * row[j];
+  }
+  return y + noise(*gen);
+}
+
+// data set of the given kind, with its objective
+DMatrixHandle CreateData(const BenchmarkParam& param, const std::string& kind,
+                         std::string* objective) {
+  const bst_float missing = std::numeric_limits<bst_float>::quiet_NaN();
+  const size_t nrow = static_cast<size_t>(param.rows);
+  const size_t ncol = static_cast<size_t>(param.features);
+  std::vector<float> data(nrow * ncol);
+  std::vector<float> labels(nrow);
+  std::vector<float> row(ncol);
+  std::mt19937 gen(param.seed);
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  for (size_t i = 0; i < nrow; ++i) {
+    for (size_t j = 0; j < ncol; ++j) {
+      if (kind == "sparse") {
+        row[j] = dis(gen) < param.sparsity ? missing : dis(gen);
+      } else if (kind == "categorical") {
+        row[j] = static_cast<float>(gen() % param.categories);
+      } else {
+        row[j] = dis(gen);
+      }
+    }
+    labels[i] = MakeLabel(row, &gen);
+    std::copy(row.begin(), row.end(), data.begin() + i * ncol);
+  }
+  *objective = "reg:linear";
+  if (kind == "ranking") {
+    // the relevance of the ranking data set goes from 0 to 4
+    for (float& y : labels) {
+      y = static_cast<float>(std::min(std::max(static_cast<int>(y + 2.0f), 0), 4));
+    }
+    *objective = "rank:ndcg";
+  } else {
+    CHECK(kind == "dense" || kind == "sparse" || kind == "categorical")
+        << "unknown data set " << kind;
+  }
+  DMatrixHandle handle;
+  CHECK_EQ(XGDMatrixCreateFromMat(data.data(), nrow, ncol, missing, &handle), 0);
+  CHECK_EQ(XGDMatrixSetFloatInfo(handle, "label", labels.data(), nrow), 0);
+  if (kind == "ranking") {
+    std::vector<unsigned> groups;
+    for (size_t begin = 0; begin < nrow; begin += param.group_size) {
+      groups.push_back(static_cast<unsigned>(
+          std::min(nrow - begin, static_cast<size_t>(param.group_size))));
+    }
+    CHECK_EQ(XGDMatrixSetGroup(handle, groups.data(), groups.size()), 0);
+  }
+  return handle;
+}
+
+// the updater growing the trees of each tree method
+const char* TreeUpdater(const std::string& tree_method) {
+  if (tree_method == "exact") return "grow_colmaker";
+  if (tree_method == "approx") return "grow_histmaker";
+  if (tree_method == "hist") return "grow_fast_histmaker";
+  if (tree_method == "gpu_exact") return "grow_gpu";
+  if (tree_method == "gpu_hist") return "grow_gpu_hist";
+  return nullptr;
+}
+
+// adds the timings or the counters of the profiler to the sums
+template <typename T>
+void Accumulate(const std::map<std::string, T>& profile, std::map<std::string, T>* sums) {
+  for (const auto& kv : profile) (*sums)[kv.first] += kv.second;
+}
+
+template <typename T>
+void WriteMap(const std::map<std::string, T>& values, std::ostream* os) {
+  *os << '{';
+  for (auto it = values.begin(); it != values.end(); ++it) {
+    *os << (it == values.begin() ? "" : ", ") << '"' << it->first << "\": " << it->second;
+  }
+  *os << '}';
+}
+
+// trains on the data set, and writes its JSON record
+void RunOne(const BenchmarkParam& param, DMatrixHandle dmat, const std::string& kind,
+            const std::string& objective, const std::string& tree_method, int nthread,
+            std::ostream* os) {
+  BoosterHandle booster;
+  CHECK_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  const std::string depth = std::to_string(param.max_depth);
+  const std::string threads = std::to_string(nthread);
+  CHECK_EQ(XGBoosterSetParam(booster, "silent", "1"), 0);
+  CHECK_EQ(XGBoosterSetParam(booster, "objective", objective.c_str()), 0);
+  CHECK_EQ(XGBoosterSetParam(booster, "tree_method", tree_method.c_str()), 0);
+  CHECK_EQ(XGBoosterSetParam(booster, "max_depth", depth.c_str()), 0);
+  CHECK_EQ(XGBoosterSetParam(booster, "nthread", threads.c_str()), 0);
+  std::map<std::string, double> timings;
+  std::map<std::string, uint64_t> counters;
+  double first = 0.0, total = 0.0;
+  for (int iter = 0; iter < param.iterations; ++iter) {
+    const double tstart = dmlc::GetTime();
+    CHECK_EQ(XGBoosterUpdateOneIter(booster, iter, dmat), 0);
+    const double elapsed = dmlc::GetTime() - tstart;
+    // the first iteration also builds the column or the quantized matrix
+    if (iter == 0) first = elapsed;
+    total += elapsed;
+    // the profiler only holds the current iteration
+    Accumulate(common::Profiler::Get()->Timings(), &timings);
+    Accumulate(common::Profiler::Get()->Counters(), &counters);
+  }
+  CHECK_EQ(XGBoosterFree(booster), 0);
+  const double steady = param.iterations > 1 ?
+      (total - first) / (param.iterations - 1) : first;
+  *os << "{\"dataset\": \"" << kind << "\", \"tree_method\": \"" << tree_method
+      << "\", \"objective\": \"" << objective << "\", \"rows\": " << param.rows
+      << ", \"features\": " << param.features << ", \"threads\": " << nthread
+      << ", \"iterations\": " << param.iterations << ", \"max_depth\": " << param.max_depth
+      << ", \"total_seconds\": " << total << ", \"first_iteration_seconds\": " << first
+      << ", \"seconds_per_iteration\": " << steady << ", \"timings\": ";
+  WriteMap(timings, os);
+  *os << ", \"counters\": ";
+  WriteMap(counters, os);
+  *os << '}';
+  std::fprintf(stderr, "%-12s %-10s %7d threads %10.4f s/iter\n", kind.c_str(),
+               tree_method.c_str(), nthread, steady);
+}
+
+void Run(const BenchmarkParam& param) {
+  const int default_nthread = omp_get_max_threads();
+  std::ostringstream os;
+  os << "{\"benchmark\": \"train\", \"results\": [";
+  bool first = true;
+  for (const std::string& kind : common::Split(param.datasets, ',')) {
+    std::string objective;
+    DMatrixHandle dmat = CreateData(param, kind, &objective);
+    for (const std::string& tree_method : common::Split(param.tree_methods, ',')) {
+      const char* updater = TreeUpdater(tree_method);
+      CHECK(updater != nullptr) << "unknown tree method " << tree_method;
+      if (::dmlc::Registry<TreeUpdaterReg>::Find(updater) == nullptr) {
+        std::fprintf(stderr, "skip tree method %s, it is not built\n", tree_method.c_str());
+        continue;
+      }
+      for (int nthread : ParseList<int>(param.threads)) {
+        if (nthread <= 0) nthread = default_nthread;
+        os << (first ? "\n  " : ",\n  ");
+        first = false;
+        RunOne(param, dmat, kind, objective, tree_method, nthread, &os);
+      }
+    }
+    CHECK_EQ(XGDMatrixFree(dmat), 0);
+  }
+  os << "\n]}\n";
+  if (param.output == "-") {
+    std::fputs(os.str().c_str(), stdout);
+  } else {
+    std::ofstream fo(param.output);
+    CHECK(fo.good()) << "cannot open " << param.output;
+    fo << os.str();
+  }
+}
+}  // namespace benchmark
+}  // namespace xgboost
+
+int main(int argc, char* argv[]) {
+  std::vector<std::pair<std::string, std::string> > cfg;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    size_t pos = arg.find('=');
+    CHECK_NE(pos, std::string::npos) << "arguments must be key=value, got " << arg;
+    cfg.push_back(std::make_pair(arg.substr(0, pos), arg.substr(pos + 1)));
+  }
+  xgboost::benchmark::BenchmarkParam param;
+  param.Init(cfg);
+  xgboost::benchmark::Run(param);
+  return 0;
+}
@@ -2,6 +2,13 @@
 #include <gtest/gtest.h>
 #include <xgboost/c_api.h>
 #include <xgboost/data.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include "../helpers.h"
 
 TEST(c_api, XGDMatrixCreateFromMat_omp) {
   std::vector<int> num_rows = {100, 11374, 15000};
@@ -37,4 +44,917 @@ TEST(c_api, XGDMatrixCreateFromMat_omp) {
       }
     }
   }
-}
\ No newline at end of file
+}
+
+// the entries of the rows of a matrix, as (row, column, value)
+std::vector<std::tuple<size_t, unsigned, float>> MatrixEntries(DMatrixHandle handle) {
+  std::vector<std::tuple<size_t, unsigned, float>> entries;
+  auto iter = (*static_cast<std::shared_ptr<xgboost::DMatrix> *>(handle))->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const auto& batch = iter->Value();
+    for (size_t i = 0; i < batch.size; ++i) {
+      auto inst = batch[i];
+      for (size_t j = 0; j < inst.length; ++j) {
+        entries.emplace_back(batch.base_rowid + i, inst[j].index, inst[j].fvalue);
+      }
+    }
+  }
+  return entries;
+}
+
+TEST(c_api, XGDMatrixCreateFromStridedMat) {
+  const size_t num_rows = 50, num_cols = 6;
+  const float missing = 7.0f;
+  std::vector<float> row_major(num_rows * num_cols);
+  for (size_t i = 0; i < row_major.size(); ++i) {
+    row_major[i] = static_cast<float>(i % 13);
+  }
+  DMatrixHandle expected;
+  ASSERT_EQ(XGDMatrixCreateFromMat(row_major.data(), num_rows, num_cols, missing,
+                                   &expected), 0);
+  auto expected_entries = MatrixEntries(expected);
+
+  // column major doubles
+  std::vector<double> col_major(num_rows * num_cols);
+  for (size_t i = 0; i < num_rows; ++i) {
+    for (size_t j = 0; j < num_cols; ++j) {
+      col_major[i + j * num_rows] = row_major[i * num_cols + j];
+    }
+  }
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromStridedMat(col_major.data(), xgboost::kDouble, num_rows,
+                                          num_cols, sizeof(double),
+                                          num_rows * sizeof(double), missing, 0, &dmat), 0);
+  ASSERT_EQ(MatrixEntries(dmat), expected_entries);
+  ASSERT_EQ(XGDMatrixFree(dmat), 0);
+
+  // every other column of a wider int64 matrix
+  std::vector<int64_t> wide(num_rows * num_cols * 2, -1);
+  for (size_t i = 0; i < num_rows; ++i) {
+    for (size_t j = 0; j < num_cols; ++j) {
+      wide[i * num_cols * 2 + j * 2] = static_cast<int64_t>(row_major[i * num_cols + j]);
+    }
+  }
+  ASSERT_EQ(XGDMatrixCreateFromStridedMat(wide.data(), xgboost::kInt64, num_rows, num_cols,
+                                          num_cols * 2 * sizeof(int64_t),
+                                          2 * sizeof(int64_t), missing, 2, &dmat), 0);
+  ASSERT_EQ(MatrixEntries(dmat), expected_entries);
+  ASSERT_EQ(XGDMatrixFree(dmat), 0);
+
+  // NaN without missing=NaN and unknown types fail
+  row_major[4] = std::numeric_limits<float>::quiet_NaN();
+  ASSERT_EQ(XGDMatrixCreateFromStridedMat(row_major.data(), xgboost::kFloat32, num_rows,
+                                          num_cols, num_cols * sizeof(float), sizeof(float),
+                                          missing, 0, &dmat), -1);
+  ASSERT_EQ(XGDMatrixCreateFromStridedMat(row_major.data(), 42, num_rows, num_cols,
+                                          num_cols * sizeof(float), sizeof(float),
+                                          std::numeric_limits<float>::quiet_NaN(), 0, &dmat),
+            -1);
+  ASSERT_EQ(XGDMatrixFree(expected), 0);
+}
+
+TEST(c_api, XGDMatrixCreateFromCSREx_omp) {
+  // the same sparse matrix in CSR and CSC form, with a NaN to skip
+  const size_t num_rows = 1000, num_cols = 7;
+  std::vector<size_t> indptr(1, 0), col_ptr(1, 0);
+  std::vector<unsigned> indices, row_indices;
+  std::vector<float> values, col_values;
+  for (size_t i = 0; i < num_rows; ++i) {
+    for (size_t j = 0; j < num_cols; ++j) {
+      if ((i + j) % 3 == 0) {
+        indices.push_back(j);
+        values.push_back(i == 3 && j == 0 ? std::numeric_limits<float>::quiet_NaN()
+                                          : static_cast<float>(i * num_cols + j));
+      }
+    }
+    indptr.push_back(indices.size());
+  }
+  for (size_t j = 0; j < num_cols; ++j) {
+    for (size_t i = 0; i < num_rows; ++i) {
+      if ((i + j) % 3 == 0) {
+        row_indices.push_back(i);
+        col_values.push_back(i == 3 && j == 0 ? std::numeric_limits<float>::quiet_NaN()
+                                              : static_cast<float>(i * num_cols + j));
+      }
+    }
+    col_ptr.push_back(row_indices.size());
+  }
+
+  for (int nthread : {0, 1, 3}) {
+    DMatrixHandle csr, csc;
+    ASSERT_EQ(XGDMatrixCreateFromCSREx_omp(indptr.data(), indices.data(), values.data(),
+                                           indptr.size(), values.size(), 0, &csr,
+                                           nthread), 0);
+    ASSERT_EQ(XGDMatrixCreateFromCSCEx_omp(col_ptr.data(), row_indices.data(),
+                                           col_values.data(), col_ptr.size(),
+                                           col_values.size(), 0, &csc, nthread), 0);
+    for (DMatrixHandle handle : {csr, csc}) {
+      std::shared_ptr<xgboost::DMatrix> dmat =
+          *static_cast<std::shared_ptr<xgboost::DMatrix> *>(handle);
+      xgboost::MetaInfo &info = dmat->info();
+      ASSERT_EQ(info.num_row, num_rows);
+      ASSERT_EQ(info.num_col, num_cols);
+      ASSERT_EQ(info.num_nonzero, values.size() - 1);
+      auto iter = dmat->RowIterator();
+      iter->BeforeFirst();
+      while (iter->Next()) {
+        auto batch = iter->Value();
+        for (size_t i = 0; i < batch.size; ++i) {
+          const size_t ridx = batch.base_rowid + i;
+          auto inst = batch[i];
+          ASSERT_EQ(inst.length, indptr[ridx + 1] - indptr[ridx] - (ridx == 3 ? 1 : 0));
+          for (size_t k = 0; k < inst.length; ++k) {
+            ASSERT_EQ(inst[k].fvalue, ridx * num_cols + inst[k].index);
+          }
+        }
+      }
+      XGDMatrixFree(handle);
+    }
+  }
+}
+
+TEST(c_api, XGBoosterPredictInto) {
+  const int num_rows = 20;
+  const int num_cols = 4;
+  std::vector<float> data(num_rows * num_cols);
+  std::vector<float> labels(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    for (int j = 0; j < num_cols; ++j) {
+      data[i * num_cols + j] = (i * 7 + j * 3) % 11 / 11.0f;
+    }
+    labels[i] = data[i * num_cols] > 0.5f ? 1.0f : 0.0f;
+  }
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols,
+                                   std::numeric_limits<float>::quiet_NaN(), &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), num_rows), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "objective", "binary:logistic");
+  XGBoosterSetParam(booster, "max_depth", "2");
+  XGBoosterSetParam(booster, "silent", "1");
+  for (int iter = 0; iter < 3; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, dmat), 0);
+  }
+
+  for (int option_mask : {0, 1, 2, 4}) {
+    bst_ulong len;
+    const float* preds;
+    ASSERT_EQ(XGBoosterPredict(booster, dmat, option_mask, 0, &len, &preds), 0);
+    std::vector<float> expected(preds, preds + len);
+    std::vector<float> out(len + 1, -1.0f);
+    bst_ulong out_len;
+    ASSERT_EQ(XGBoosterPredictInto(booster, dmat, option_mask, 0, out.size(),
+                                   &out_len, out.data()), 0);
+    ASSERT_EQ(out_len, len);
+    for (bst_ulong i = 0; i < len; ++i) {
+      ASSERT_FLOAT_EQ(out[i], expected[i]);
+    }
+    ASSERT_EQ(out[len], -1.0f);
+    // too small an array fails, and gives the size needed
+    out_len = 0;
+    ASSERT_EQ(XGBoosterPredictInto(booster, dmat, option_mask, 0, len - 1,
+                                   &out_len, out.data()), -1);
+    ASSERT_EQ(out_len, len);
+  }
+  ASSERT_EQ(XGBoosterFree(booster), 0);
+  ASSERT_EQ(XGDMatrixFree(dmat), 0);
+}
+
+TEST(c_api, XGBoosterPredictMulti) {
+  const int num_rows = 40;
+  const int num_cols = 5;
+  std::vector<float> data(num_rows * num_cols);
+  std::vector<float> labels(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    for (int j = 0; j < num_cols; ++j) {
+      // some missing values, and a column the narrow model does not see
+      data[i * num_cols + j] = (i + j) % 7 == 0 ? std::numeric_limits<float>::quiet_NaN() :
+          (i * 7 + j * 3) % 11 / 11.0f;
+    }
+    labels[i] = static_cast<float>(i % 3);
+  }
+  DMatrixHandle dmat, dnarrow;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols,
+                                   std::numeric_limits<float>::quiet_NaN(), &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), num_rows), 0);
+  std::vector<float> narrow(num_rows * 3);
+  for (int i = 0; i < num_rows; ++i) {
+    std::copy(data.begin() + i * num_cols, data.begin() + i * num_cols + 3,
+              narrow.begin() + i * 3);
+  }
+  ASSERT_EQ(XGDMatrixCreateFromMat(narrow.data(), num_rows, 3,
+                                   std::numeric_limits<float>::quiet_NaN(), &dnarrow), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dnarrow, "label", labels.data(), num_rows), 0);
+  // boosters of different objectives, the linear one predicts on its own
+  std::vector<std::vector<std::pair<const char*, const char*> > > params = {
+    {{"objective", "multi:softprob"}, {"num_class", "3"}},
+    {{"objective", "reg:linear"}, {"max_depth", "4"}},
+    {{"objective", "reg:linear"}, {"booster", "gblinear"}},
+    {{"objective", "binary:logistic"}, {"num_parallel_tree", "2"}}};
+  std::vector<BoosterHandle> boosters;
+  for (size_t k = 0; k < params.size(); ++k) {
+    DMatrixHandle train = k == 3 ? dnarrow : dmat;
+    BoosterHandle booster;
+    ASSERT_EQ(XGBoosterCreate(&train, 1, &booster), 0);
+    XGBoosterSetParam(booster, "silent", "1");
+    for (const auto& kv : params[k]) {
+      XGBoosterSetParam(booster, kv.first, kv.second);
+    }
+    if (k == 3) {
+      std::vector<float> binary(num_rows);
+      for (int i = 0; i < num_rows; ++i) binary[i] = labels[i] > 0.5f ? 1.0f : 0.0f;
+      ASSERT_EQ(XGDMatrixSetFloatInfo(train, "label", binary.data(), num_rows), 0);
+    }
+    for (int iter = 0; iter < 3; ++iter) {
+      ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, train), 0);
+    }
+    boosters.push_back(booster);
+  }
+
+  for (int option_mask : {0, 1}) {
+    for (unsigned ntree_limit : {0, 2}) {
+      // gblinear has no limit of the trees
+      std::vector<BoosterHandle> handles = boosters;
+      if (ntree_limit != 0) handles.erase(handles.begin() + 2);
+      std::vector<bst_ulong> offsets(handles.size() + 1);
+      bst_ulong len;
+      const float* preds;
+      ASSERT_EQ(XGBoosterPredictMulti(handles.data(), handles.size(), dmat, option_mask,
+                                      ntree_limit, offsets.data(), &len, &preds), 0);
+      std::vector<float> multi(preds, preds + len);
+      ASSERT_EQ(offsets[0], 0);
+      ASSERT_EQ(offsets.back(), len);
+      for (size_t k = 0; k < handles.size(); ++k) {
+        bst_ulong expected_len;
+        const float* expected;
+        ASSERT_EQ(XGBoosterPredict(handles[k], dmat, option_mask, ntree_limit,
+                                   &expected_len, &expected), 0);
+        ASSERT_EQ(offsets[k + 1] - offsets[k], expected_len);
+        for (bst_ulong i = 0; i < expected_len; ++i) {
+          ASSERT_NEAR(multi[offsets[k] + i], expected[i], 1e-5f) << "booster " << k;
+        }
+      }
+    }
+  }
+  std::vector<bst_ulong> offsets(boosters.size() + 1);
+  bst_ulong len;
+  const float* preds;
+  ASSERT_EQ(XGBoosterPredictMulti(boosters.data(), boosters.size(), dmat, 2, 0,
+                                  offsets.data(), &len, &preds), -1);
+  for (BoosterHandle booster : boosters) {
+    ASSERT_EQ(XGBoosterFree(booster), 0);
+  }
+  ASSERT_EQ(XGDMatrixFree(dmat), 0);
+  ASSERT_EQ(XGDMatrixFree(dnarrow), 0);
+}
+
+namespace {
+// collects the blocks of leaf indices as floats
+int CollectLeafIndex(const void* leaves, int index_size, bst_ulong base_row,
+                     bst_ulong nrow, bst_ulong ntree, void* user_data) {
+  std::vector<float>* out = static_cast<std::vector<float>*>(user_data);
+  if (index_size != 2 || out->size() != base_row * ntree) return -1;
+  const uint16_t* index = static_cast<const uint16_t*>(leaves);
+  out->insert(out->end(), index, index + nrow * ntree);
+  return 0;
+}
+int FailLeafIndex(const void* leaves, int index_size, bst_ulong base_row,
+                  bst_ulong nrow, bst_ulong ntree, void* user_data) {
+  return 1;
+}
+}  // namespace
+
+TEST(c_api, XGBoosterPredictLeafIndex) {
+  const int num_rows = 50;
+  const int num_cols = 4;
+  std::vector<float> data(num_rows * num_cols);
+  std::vector<float> labels(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    for (int j = 0; j < num_cols; ++j) {
+      data[i * num_cols + j] = (i * 7 + j * 3) % 11 / 11.0f;
+    }
+    labels[i] = static_cast<float>(i % 3);
+  }
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols,
+                                   std::numeric_limits<float>::quiet_NaN(), &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), num_rows), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "objective", "multi:softmax");
+  XGBoosterSetParam(booster, "num_class", "3");
+  XGBoosterSetParam(booster, "max_depth", "3");
+  XGBoosterSetParam(booster, "silent", "1");
+  for (int iter = 0; iter < 3; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, dmat), 0);
+  }
+
+  for (unsigned ntree_limit : {0, 2}) {
+    bst_ulong len;
+    const float* preds;
+    ASSERT_EQ(XGBoosterPredict(booster, dmat, 2, ntree_limit, &len, &preds), 0);
+    std::vector<float> expected(preds, preds + len);
+    int index_size;
+    bst_ulong ntree, index_len;
+    const void* leaves;
+    ASSERT_EQ(XGBoosterPredictLeafIndex(booster, dmat, ntree_limit, &index_size,
+                                        &ntree, &index_len, &leaves), 0);
+    ASSERT_EQ(index_size, 2);
+    ASSERT_EQ(ntree, ntree_limit == 0 ? 9 : 6);
+    ASSERT_EQ(index_len, len);
+    const uint16_t* index = static_cast<const uint16_t*>(leaves);
+    for (bst_ulong i = 0; i < len; ++i) {
+      ASSERT_EQ(index[i], expected[i]);
+    }
+    std::vector<float> streamed;
+    ASSERT_EQ(XGBoosterPredictLeafIndexStream(booster, dmat, ntree_limit,
+                                              CollectLeafIndex, &streamed), 0);
+    ASSERT_EQ(streamed, expected);
+  }
+  // a failed callback fails the prediction
+  ASSERT_EQ(XGBoosterPredictLeafIndexStream(booster, dmat, 0, FailLeafIndex, nullptr), -1);
+  ASSERT_EQ(XGBoosterFree(booster), 0);
+  ASSERT_EQ(XGDMatrixFree(dmat), 0);
+}
+
+TEST(c_api, XGBoosterSlice) {
+  const int num_rows = 30;
+  const int num_cols = 4;
+  const int num_class = 3;
+  std::vector<float> data(num_rows * num_cols);
+  std::vector<float> labels(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    for (int j = 0; j < num_cols; ++j) {
+      data[i * num_cols + j] = (i * 7 + j * 3) % 11 / 11.0f;
+    }
+    labels[i] = static_cast<float>(i % num_class);
+  }
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols,
+                                   std::numeric_limits<float>::quiet_NaN(), &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), num_rows), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "objective", "multi:softprob");
+  XGBoosterSetParam(booster, "num_class", "3");
+  XGBoosterSetParam(booster, "max_depth", "2");
+  XGBoosterSetParam(booster, "silent", "1");
+  for (int iter = 0; iter < 4; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, dmat), 0);
+  }
+
+  // the first layers give the predictions of the limited number of trees
+  bst_ulong len, slice_len;
+  const float* preds;
+  ASSERT_EQ(XGBoosterPredict(booster, dmat, 1, 2, &len, &preds), 0);
+  std::vector<float> expected(preds, preds + len);
+  BoosterHandle slice;
+  ASSERT_EQ(XGBoosterSlice(booster, 0, 2, -1, &slice), 0);
+  ASSERT_EQ(XGBoosterPredict(slice, dmat, 1, 0, &slice_len, &preds), 0);
+  ASSERT_EQ(slice_len, len);
+  for (bst_ulong i = 0; i < len; ++i) {
+    ASSERT_NEAR(preds[i], expected[i], 1e-5f);
+  }
+  ASSERT_EQ(XGBoosterFree(slice), 0);
+
+  // a group gives the margin of its class, for the layers of the range
+  ASSERT_EQ(XGBoosterPredict(booster, dmat, 1, 1, &len, &preds), 0);
+  std::vector<float> margin1(preds, preds + len);
+  ASSERT_EQ(XGBoosterPredict(booster, dmat, 1, 3, &len, &preds), 0);
+  std::vector<float> margin3(preds, preds + len);
+  ASSERT_EQ(XGBoosterSlice(booster, 1, 3, 2, &slice), 0);
+  ASSERT_EQ(XGBoosterPredict(slice, dmat, 1, 0, &slice_len, &preds), 0);
+  ASSERT_EQ(slice_len, static_cast<bst_ulong>(num_rows));
+  for (int i = 0; i < num_rows; ++i) {
+    // base_score is counted twice by the difference of the margins
+    ASSERT_NEAR(preds[i], margin3[i * num_class + 2] - margin1[i * num_class + 2] + 0.5f, 1e-5f);
+  }
+  ASSERT_EQ(XGBoosterFree(slice), 0);
+
+  // the range must be within the layers of the model
+  ASSERT_EQ(XGBoosterSlice(booster, 2, 5, -1, &slice), -1);
+  ASSERT_EQ(XGBoosterSlice(booster, 0, 1, num_class, &slice), -1);
+  ASSERT_EQ(XGBoosterFree(booster), 0);
+  ASSERT_EQ(XGDMatrixFree(dmat), 0);
+}
+
+namespace {
+// records the order of the finished operations, called on the worker thread
+void RecordAsync(AsyncHandle handle, int status, void* user_data) {
+  static_cast<std::vector<int>*>(user_data)->push_back(status);
+}
+}  // namespace
+
+TEST(c_api, XGBoosterAsync) {
+  const int num_rows = 20;
+  const int num_cols = 4;
+  std::vector<float> data(num_rows * num_cols);
+  std::vector<float> labels(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    for (int j = 0; j < num_cols; ++j) {
+      data[i * num_cols + j] = (i * 7 + j * 3) % 11 / 11.0f;
+    }
+    labels[i] = data[i * num_cols] > 0.5f ? 1.0f : 0.0f;
+  }
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols,
+                                   std::numeric_limits<float>::quiet_NaN(), &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), num_rows), 0);
+  BoosterHandle boosters[2];
+  for (BoosterHandle& booster : boosters) {
+    ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+    XGBoosterSetParam(booster, "objective", "binary:logistic");
+    XGBoosterSetParam(booster, "max_depth", "2");
+    XGBoosterSetParam(booster, "silent", "1");
+  }
+  for (int iter = 0; iter < 3; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(boosters[0], iter, dmat), 0);
+  }
+  bst_ulong len;
+  const float* preds;
+  ASSERT_EQ(XGBoosterPredict(boosters[0], dmat, 0, 0, &len, &preds), 0);
+  std::vector<float> expected(preds, preds + len);
+  const char* name = "train";
+  const char* eval;
+  ASSERT_EQ(XGBoosterEvalOneIter(boosters[0], 2, &dmat, &name, 1, &eval), 0);
+  std::string expected_eval(eval);
+
+  // the operations run in order, the handles are freed before they are done
+  std::vector<int> statuses;
+  for (int iter = 0; iter < 3; ++iter) {
+    AsyncHandle update;
+    ASSERT_EQ(XGBoosterUpdateOneIterAsync(boosters[1], iter, dmat, RecordAsync,
+                                          &statuses, &update), 0);
+    ASSERT_EQ(XGBAsyncFree(update), 0);
+  }
+  AsyncHandle evaluation, prediction;
+  ASSERT_EQ(XGBoosterEvalOneIterAsync(boosters[1], 2, &dmat, &name, 1, RecordAsync,
+                                      &statuses, &evaluation), 0);
+  ASSERT_EQ(XGBoosterPredictAsync(boosters[1], dmat, 0, 0, nullptr, nullptr,
+                                  &prediction), 0);
+  // the matrix is held by the pending operations
+  ASSERT_EQ(XGDMatrixFree(dmat), 0);
+  ASSERT_EQ(XGBAsyncGetPrediction(prediction, &len, &preds), 0);
+  int done;
+  ASSERT_EQ(XGBAsyncIsDone(prediction, &done), 0);
+  ASSERT_EQ(done, 1);
+  ASSERT_EQ(len, expected.size());
+  for (bst_ulong i = 0; i < len; ++i) {
+    ASSERT_FLOAT_EQ(preds[i], expected[i]);
+  }
+  ASSERT_EQ(XGBAsyncGetEvalResult(evaluation, &eval), 0);
+  ASSERT_EQ(std::string(eval), expected_eval);
+  ASSERT_EQ(XGBAsyncFree(prediction), 0);
+  ASSERT_EQ(XGBAsyncFree(evaluation), 0);
+
+  // a failed operation gives its error to the waiting caller
+  DMatrixHandle unlabelled;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols,
+                                   std::numeric_limits<float>::quiet_NaN(), &unlabelled), 0);
+  AsyncHandle failed;
+  ASSERT_EQ(XGBoosterUpdateOneIterAsync(boosters[1], 3, unlabelled, RecordAsync,
+                                        &statuses, &failed), 0);
+  ASSERT_EQ(XGBAsyncWait(failed), -1);
+  ASSERT_NE(std::string(XGBGetLastError()).find("label"), std::string::npos);
+  ASSERT_EQ(XGBAsyncFree(failed), 0);
+  ASSERT_EQ(XGDMatrixFree(unlabelled), 0);
+
+  // freeing the booster waits for the callbacks
+  for (BoosterHandle booster : boosters) {
+    ASSERT_EQ(XGBoosterFree(booster), 0);
+  }
+  ASSERT_EQ(statuses, std::vector<int>({0, 0, 0, 0, -1}));
+}
+
+TEST(c_api, XGBoosterPredictFromRow) {
+  const int num_rows = 20;
+  const int num_cols = 4;
+  std::vector<float> data(num_rows * num_cols);
+  std::vector<float> labels(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    for (int j = 0; j < num_cols; ++j) {
+      data[i * num_cols + j] = (i * 7 + j * 3) % 11 / 11.0f;
+    }
+    labels[i] = data[i * num_cols] > 0.5f ? 1.0f : 0.0f;
+  }
+  // one missing value to go through the default direction
+  data[1] = std::numeric_limits<float>::quiet_NaN();
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols,
+                                   std::numeric_limits<float>::quiet_NaN(), &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), num_rows), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "objective", "binary:logistic");
+  XGBoosterSetParam(booster, "max_depth", "2");
+  XGBoosterSetParam(booster, "silent", "1");
+  for (int iter = 0; iter < 3; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, dmat), 0);
+  }
+
+  for (int option_mask : {0, 1}) {
+    bst_ulong len;
+    const float* batch_preds;
+    ASSERT_EQ(XGBoosterPredict(booster, dmat, option_mask, 0, &len, &batch_preds), 0);
+    ASSERT_EQ(len, num_rows);
+    std::vector<float> expected(batch_preds, batch_preds + len);
+    for (int i = 0; i < num_rows; ++i) {
+      float row_pred;
+      bst_ulong row_len;
+      ASSERT_EQ(XGBoosterPredictFromDenseRow(
+          booster, &data[i * num_cols], num_cols,
+          std::numeric_limits<float>::quiet_NaN(), option_mask, 0, 1,
+          &row_len, &row_pred), 0);
+      ASSERT_EQ(row_len, 1);
+      ASSERT_FLOAT_EQ(row_pred, expected[i]);
+
+      std::vector<unsigned> indices;
+      std::vector<float> values;
+      for (int j = 0; j < num_cols; ++j) {
+        if (!std::isnan(data[i * num_cols + j])) {
+          indices.push_back(j);
+          values.push_back(data[i * num_cols + j]);
+        }
+      }
+      ASSERT_EQ(XGBoosterPredictFromCSRRow(
+          booster, indices.data(), values.data(), indices.size(), option_mask, 0, 1,
+          &row_len, &row_pred), 0);
+      ASSERT_EQ(row_len, 1);
+      ASSERT_FLOAT_EQ(row_pred, expected[i]);
+    }
+  }
+  // the output buffer is too small
+  float row_pred;
+  bst_ulong row_len;
+  ASSERT_NE(XGBoosterPredictFromDenseRow(booster, data.data(), num_cols,
+                                         std::numeric_limits<float>::quiet_NaN(), 0, 0, 0,
+                                         &row_len, &row_pred), 0);
+  XGBoosterFree(booster);
+  XGDMatrixFree(dmat);
+}
+
+TEST(c_api, XGBoosterPredictWithContext) {
+  const int num_rows = 30;
+  const int num_cols = 3;
+  std::vector<float> data(num_rows * num_cols);
+  std::vector<float> labels(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    for (int j = 0; j < num_cols; ++j) {
+      data[i * num_cols + j] = (i * 5 + j * 7) % 13 / 13.0f;
+    }
+    labels[i] = data[i * num_cols + 1];
+  }
+  DMatrixHandle dtrain;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols, -1.0f, &dtrain), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dtrain, "label", labels.data(), num_rows), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dtrain, 1, &booster), 0);
+  XGBoosterSetParam(booster, "silent", "1");
+  for (int iter = 0; iter < 4; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, dtrain), 0);
+  }
+  // a matrix outside of the prediction cache
+  DMatrixHandle dtest;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols, -1.0f, &dtest), 0);
+  bst_ulong len;
+  const float* preds;
+  ASSERT_EQ(XGBoosterPredict(booster, dtest, 0, 0, &len, &preds), 0);
+  std::vector<float> expected(preds, preds + len);
+  XGDMatrixFree(dtest);
+
+  // every thread owns a context and a matrix, the booster is shared
+  const int num_threads = 4;
+  std::vector<int> num_errors(num_threads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      DMatrixHandle dmat;
+      PredictionContextHandle ctx;
+      XGDMatrixCreateFromMat(data.data(), num_rows, num_cols, -1.0f, &dmat);
+      XGBoosterPredictionContextCreate(&ctx);
+      for (int repeat = 0; repeat < 20; ++repeat) {
+        bst_ulong ctx_len;
+        const float* ctx_preds;
+        if (XGBoosterPredictWithContext(booster, ctx, dmat, 0, 0, &ctx_len, &ctx_preds) != 0 ||
+            ctx_len != expected.size()) {
+          ++num_errors[t];
+          continue;
+        }
+        for (bst_ulong i = 0; i < ctx_len; ++i) {
+          if (ctx_preds[i] != expected[i]) ++num_errors[t];
+        }
+      }
+      XGBoosterPredictionContextFree(ctx);
+      XGDMatrixFree(dmat);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < num_threads; ++t) {
+    ASSERT_EQ(num_errors[t], 0);
+  }
+  XGBoosterFree(booster);
+  XGDMatrixFree(dtrain);
+}
+
+TEST(c_api, XGBGetProfile) {
+  const int num_rows = 50;
+  const int num_cols = 3;
+  std::vector<float> data(num_rows * num_cols);
+  std::vector<float> labels(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    for (int j = 0; j < num_cols; ++j) {
+      data[i * num_cols + j] = (i * 7 + j * 3) % 11 / 11.0f;
+    }
+    labels[i] = data[i * num_cols];
+  }
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols,
+                                   std::numeric_limits<float>::quiet_NaN(), &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), num_rows), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "tree_method", "hist");
+  XGBoosterSetParam(booster, "silent", "1");
+  for (int iter = 0; iter < 2; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, dmat), 0);
+  }
+
+  const char* profile;
+  ASSERT_EQ(XGBGetProfile(&profile), 0);
+  std::string str(profile);
+  ASSERT_NE(str.find("\"Learner.UpdateOneIter\": "), std::string::npos);
+  ASSERT_NE(str.find("\"FastHistMaker.BuildHist\": "), std::string::npos);
+  // the counters are those of the last iteration only
+  ASSERT_NE(str.find("\"Learner.rows\": 50"), std::string::npos);
+  ASSERT_EQ(XGBoosterFree(booster), 0);
+  ASSERT_EQ(XGDMatrixFree(dmat), 0);
+}
+
+TEST(c_api, XGBGetTrace) {
+  const int num_rows = 50;
+  const int num_cols = 3;
+  std::vector<float> data(num_rows * num_cols);
+  for (int i = 0; i < num_rows * num_cols; ++i) data[i] = i % 7 / 7.0f;
+  std::vector<float> labels(data.begin(), data.begin() + num_rows);
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols,
+                                   std::numeric_limits<float>::quiet_NaN(), &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), num_rows), 0);
+  const std::string trace_file = TempFileName();
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "tree_method", "hist");
+  XGBoosterSetParam(booster, "silent", "1");
+  XGBoosterSetParam(booster, "trace_file", trace_file.c_str());
+  ASSERT_EQ(XGBoosterUpdateOneIter(booster, 0, dmat), 0);
+  const char* trace;
+  ASSERT_EQ(XGBGetTrace(&trace), 0);
+  ASSERT_NE(std::string(trace).find("\"name\": \"FastHistMaker.BuildHist\""),
+            std::string::npos);
+  // the trace is written when the booster is freed
+  ASSERT_EQ(XGBoosterFree(booster), 0);
+  std::ifstream fi(trace_file);
+  std::stringstream ss;
+  ss << fi.rdbuf();
+  ASSERT_NE(ss.str().find("\"name\": \"Learner.UpdateOneIter\", \"cat\": \"Learner\""),
+            std::string::npos);
+  std::remove(trace_file.c_str());
+  ASSERT_EQ(XGBSetTracing(0), 0);
+  ASSERT_EQ(XGDMatrixFree(dmat), 0);
+}
+
+TEST(c_api, XGBGetMemoryUsage) {
+  const int num_rows = 50;
+  const int num_cols = 3;
+  std::vector<float> data(num_rows * num_cols);
+  std::vector<float> labels(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    for (int j = 0; j < num_cols; ++j) {
+      data[i * num_cols + j] = (i * 7 + j * 3) % 11 / 11.0f;
+    }
+    labels[i] = data[i * num_cols];
+  }
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols,
+                                   std::numeric_limits<float>::quiet_NaN(), &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), num_rows), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "tree_method", "hist");
+  XGBoosterSetParam(booster, "silent", "1");
+  for (int iter = 0; iter < 2; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, dmat), 0);
+  }
+
+  const char* usage;
+  ASSERT_EQ(XGBGetMemoryUsage(0, &usage), 0);
+  std::string str(usage);
+  for (const char* tag : {"total", "DMatrix.rows", "GHistIndexMatrix", "ColumnMatrix",
+                          "HistCollection", "PredictionCache"}) {
+    ASSERT_NE(str.find(std::string("\"") + tag + "\": {\"current\": "), std::string::npos)
+        << tag;
+  }
+  ASSERT_EQ(XGBoosterFree(booster), 0);
+  ASSERT_EQ(XGDMatrixFree(dmat), 0);
+}
+
+namespace {
+// dense rows served in batches of 16 through the data iterator callbacks
+struct DenseIter {
+  const std::vector<float>* data;
+  const std::vector<float>* labels;
+  int num_cols;
+  size_t row;
+  std::vector<int64_t> offset;
+  std::vector<int> index;
+};
+
+int DenseIterNext(DataIterHandle handle, XGBCallbackSetData* set_function,
+                  DataHolderHandle set_function_handle) {
+  DenseIter* iter = static_cast<DenseIter*>(handle);
+  const size_t num_rows = iter->labels->size();
+  if (iter->row == num_rows) return 0;
+  const size_t size = std::min(num_rows - iter->row, static_cast<size_t>(16));
+  iter->offset.clear();
+  iter->index.clear();
+  for (size_t i = 0; i <= size; ++i) {
+    iter->offset.push_back(i * iter->num_cols);
+  }
+  for (size_t i = 0; i < size * iter->num_cols; ++i) {
+    iter->index.push_back(static_cast<int>(i % iter->num_cols));
+  }
+  XGBoostBatchCSR batch;
+  batch.size = size;
+  batch.offset = reinterpret_cast<decltype(batch.offset)>(iter->offset.data());
+  batch.label = const_cast<float*>(iter->labels->data()) + iter->row;
+  batch.weight = nullptr;
+  batch.index = iter->index.data();
+  batch.value = const_cast<float*>(iter->data->data()) + iter->row * iter->num_cols;
+  set_function(set_function_handle, batch);
+  iter->row += size;
+  return 1;
+}
+
+void DenseIterReset(DataIterHandle handle) {
+  static_cast<DenseIter*>(handle)->row = 0;
+}
+}  // namespace
+
+TEST(c_api, XGDMatrixCreateQuantizedFromDataIter) {
+  const int num_rows = 40;
+  const int num_cols = 3;
+  std::vector<float> data(num_rows * num_cols);
+  std::vector<float> labels(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    for (int j = 0; j < num_cols; ++j) {
+      data[i * num_cols + j] = (i * 5 + j * 7) % 23 / 23.0f;
+    }
+    labels[i] = data[i * num_cols + 1] + data[i * num_cols + 2];
+  }
+  DenseIter iter{&data, &labels, num_cols, 0, {}, {}};
+  DMatrixHandle dquantized, draw;
+  ASSERT_EQ(XGDMatrixCreateQuantizedFromDataIter(&iter, DenseIterNext, DenseIterReset,
+                                                 16, &dquantized), 0);
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols, -1.0f, &draw), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(draw, "label", labels.data(), num_rows), 0);
+  bst_ulong nrow, ncol;
+  ASSERT_EQ(XGDMatrixNumRow(dquantized, &nrow), 0);
+  ASSERT_EQ(XGDMatrixNumCol(dquantized, &ncol), 0);
+  EXPECT_EQ(nrow, num_rows);
+  EXPECT_EQ(ncol, num_cols);
+
+  // hist grows the same trees from the bins and from the raw values
+  std::vector<float> preds[2];
+  DMatrixHandle dtrain[2] = {dquantized, draw};
+  for (int k = 0; k < 2; ++k) {
+    BoosterHandle booster;
+    ASSERT_EQ(XGBoosterCreate(&dtrain[k], 1, &booster), 0);
+    XGBoosterSetParam(booster, "silent", "1");
+    XGBoosterSetParam(booster, "tree_method", "hist");
+    XGBoosterSetParam(booster, "max_bin", "16");
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_EQ(XGBoosterUpdateOneIter(booster, i, dtrain[k]), 0);
+    }
+    bst_ulong len;
+    const float* out;
+    ASSERT_EQ(XGBoosterPredict(booster, draw, 0, 0, &len, &out), 0);
+    preds[k].assign(out, out + len);
+    ASSERT_EQ(XGBoosterPredict(booster, dquantized, 0, 0, &len, &out), 0);
+    for (bst_ulong i = 0; i < len; ++i) {
+      EXPECT_FLOAT_EQ(out[i], preds[k][i]);
+    }
+    XGBoosterFree(booster);
+  }
+  for (int i = 0; i < num_rows; ++i) {
+    EXPECT_FLOAT_EQ(preds[0][i], preds[1][i]);
+  }
+  XGDMatrixFree(dquantized);
+  XGDMatrixFree(draw);
+}
+
+TEST(c_api, XGDMatrixCreateStreamingFromDataIter) {
+  const int num_rows = 40;
+  const int num_cols = 3;
+  std::vector<float> data(num_rows * num_cols);
+  std::vector<float> labels(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    for (int j = 0; j < num_cols; ++j) {
+      data[i * num_cols + j] = (i * 3 + j * 11) % 17 / 17.0f;
+    }
+    labels[i] = data[i * num_cols] > 0.5f ? 1.0f : 0.0f;
+  }
+  DenseIter iter{&data, &labels, num_cols, 0, {}, {}};
+  DMatrixHandle dstream, draw;
+  ASSERT_EQ(XGDMatrixCreateStreamingFromDataIter(&iter, DenseIterNext, DenseIterReset,
+                                                 &dstream), 0);
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols, -1.0f, &draw), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(draw, "label", labels.data(), num_rows), 0);
+  bst_ulong nrow, ncol;
+  ASSERT_EQ(XGDMatrixNumRow(dstream, &nrow), 0);
+  ASSERT_EQ(XGDMatrixNumCol(dstream, &ncol), 0);
+  EXPECT_EQ(nrow, num_rows);
+  EXPECT_EQ(ncol, num_cols);
+
+  // the batches of the iterator train the same model as the whole matrix
+  std::vector<float> preds[2];
+  DMatrixHandle dtrain[2] = {dstream, draw};
+  for (int k = 0; k < 2; ++k) {
+    BoosterHandle booster;
+    ASSERT_EQ(XGBoosterCreate(&dtrain[k], 1, &booster), 0);
+    XGBoosterSetParam(booster, "silent", "1");
+    XGBoosterSetParam(booster, "objective", "binary:logistic");
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_EQ(XGBoosterUpdateOneIter(booster, i, dtrain[k]), 0);
+    }
+    bst_ulong len;
+    const float* out;
+    ASSERT_EQ(XGBoosterPredict(booster, dtrain[k], 0, 0, &len, &out), 0);
+    preds[k].assign(out, out + len);
+    XGBoosterFree(booster);
+  }
+  ASSERT_EQ(preds[0].size(), num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    EXPECT_FLOAT_EQ(preds[0][i], preds[1][i]);
+  }
+  XGDMatrixFree(dstream);
+  XGDMatrixFree(draw);
+}
+
+TEST(c_api, XGDMatrixAppend) {
+  const int num_rows = 60;
+  const int num_new = 20;
+  const int num_cols = 3;
+  std::vector<float> data((num_rows + num_new) * num_cols);
+  std::vector<float> labels(num_rows + num_new);
+  for (int i = 0; i < num_rows + num_new; ++i) {
+    for (int j = 0; j < num_cols; ++j) {
+      data[i * num_cols + j] = (i * 7 + j * 5) % 19 / 19.0f;
+    }
+    labels[i] = data[i * num_cols] + data[i * num_cols + 2];
+  }
+  DMatrixHandle dnew, dall;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data() + num_rows * num_cols, num_new, num_cols,
+                                   -1.0f, &dnew), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dnew, "label", labels.data() + num_rows, num_new), 0);
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows + num_new, num_cols, -1.0f, &dall), 0);
+
+  const char* methods[] = {"hist", "exact"};
+  for (const char* method : methods) {
+    DMatrixHandle dmat;
+    ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), num_rows, num_cols, -1.0f, &dmat), 0);
+    ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), num_rows), 0);
+    BoosterHandle booster;
+    ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+    XGBoosterSetParam(booster, "silent", "1");
+    XGBoosterSetParam(booster, "tree_method", method);
+    for (int i = 0; i < 2; ++i) {
+      ASSERT_EQ(XGBoosterUpdateOneIter(booster, i, dmat), 0);
+    }
+    // the new rows are trained on without building the matrix again
+    ASSERT_EQ(XGDMatrixAppend(dmat, dnew), 0);
+    bst_ulong nrow;
+    ASSERT_EQ(XGDMatrixNumRow(dmat, &nrow), 0);
+    EXPECT_EQ(nrow, num_rows + num_new);
+    for (int i = 2; i < 4; ++i) {
+      ASSERT_EQ(XGBoosterUpdateOneIter(booster, i, dmat), 0);
+    }
+    // the cached predictions cover the appended rows
+    bst_ulong len;
+    const float* out;
+    ASSERT_EQ(XGBoosterPredict(booster, dall, 0, 0, &len, &out), 0);
+    std::vector<float> expected(out, out + len);
+    ASSERT_EQ(XGBoosterPredict(booster, dmat, 0, 0, &len, &out), 0);
+    ASSERT_EQ(len, num_rows + num_new);
+    for (bst_ulong i = 0; i < len; ++i) {
+      EXPECT_NEAR(out[i], expected[i], 1e-5f);
+    }
+    XGBoosterFree(booster);
+    XGDMatrixFree(dmat);
+  }
+  XGDMatrixFree(dnew);
+  XGDMatrixFree(dall);
+}
@@ -0,0 +1,40 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <numeric>
+#include "../../../src/common/arena.h"
+
+namespace xgboost {
+namespace common {
+TEST(Arena, Scopes) {
+  Arena arena(1024);
+  const void* first = nullptr;
+  for (int it = 0; it < 3; ++it) {
+    Arena::Scope scope(&arena);
+    ArenaVector<int> v = MakeArenaVector<int>(&arena, 10, 1);
+    EXPECT_EQ(std::accumulate(v.begin(), v.end(), 0), 10);
+    {
+      // outgrows the first block, the memory of the nested scope is given back
+      Arena::Scope inner(&arena);
+      ArenaVector<double> w = MakeArenaVector<double>(&arena);
+      for (int i = 0; i < 1000; ++i) w.push_back(i);
+      EXPECT_EQ(w[999], 999.0);
+    }
+    ArenaVector<int> u = MakeArenaVector<int>(&arena, 4);
+    EXPECT_EQ(reinterpret_cast<const char*>(u.data()),
+              reinterpret_cast<const char*>(v.data()) + 48);
+    if (it == 0) {
+      EXPECT_GT(arena.NumBlocks(), 1U);
+    } else {
+      // the blocks were merged at the end of the first iteration
+      EXPECT_EQ(arena.NumBlocks(), 1U);
+    }
+    if (it == 2) {
+      EXPECT_EQ(v.data(), first);
+    }
+    first = v.data();
+  }
+  EXPECT_EQ(arena.NumBlocks(), 1U);
+  EXPECT_GE(arena.Capacity(), 8000U);
+}
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,83 @@
+// Copyright by Contributors
+#include <dmlc/omp.h>
+#include <gtest/gtest.h>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+#include "../../../src/common/column_matrix.h"
+#include "../../../src/common/hist_util.h"
+#include "../helpers.h"
+
+namespace xgboost {
+namespace common {
+namespace {
+// the bin of every row of column fid, -1 for the missing ones
+template <typename T>
+std::vector<int64_t> ColumnBins(const ColumnMatrix& colmat, unsigned fid, size_t nrow) {
+  std::vector<int64_t> bins(nrow, -1);
+  const Column<T> column = colmat.GetColumn<T>(fid);
+  for (size_t i = 0; i < column.len; ++i) {
+    if (column.type == kDenseColumn) {
+      if (column.index[i] != std::numeric_limits<T>::max()) {
+        bins[i] = column.index[i] + column.index_base;
+      }
+    } else {
+      if (i > 0) {
+        EXPECT_LT(column.row_ind[i - 1], column.row_ind[i]);
+      }
+      bins[column.row_ind[i]] = column.index[i] + column.index_base;
+    }
+  }
+  return bins;
+}
+}  // namespace
+
+TEST(ColumnMatrix, ParallelInit) {
+  const size_t nrow = 3001;
+  const unsigned ncol = 9;
+  // about 30% of the entries of every feature
+  auto dmat = CreateDMatrix(nrow, ncol, 0.7f);
+  HistCutMatrix cut;
+  cut.Init(dmat.get(), 16);
+  GHistIndexMatrix gmat;
+  gmat.cut = &cut;
+  gmat.Init(dmat.get());
+  std::vector<std::vector<int64_t> > expected(ncol, std::vector<int64_t>(nrow, -1));
+  for (size_t rid = 0; rid < nrow; ++rid) {
+    for (size_t i = gmat.row_ptr[rid]; i < gmat.row_ptr[rid + 1]; ++i) {
+      const uint32_t bin = gmat.index[i];
+      unsigned fid = 0;
+      while (bin >= cut.row_ptr[fid + 1]) ++fid;
+      expected[fid][rid] = bin;
+    }
+  }
+
+  const int nthread = omp_get_max_threads();
+  for (const char* adaptive : {"0", "1"}) {
+    for (const char* dtype : {"uint8", "uint32"}) {
+      FastHistParam param;
+      param.InitAllowUnknown(std::map<std::string, std::string>{
+          {"adaptive_sparse_threshold", adaptive}, {"colmat_dtype", dtype}});
+      for (int t : {1, 4}) {
+        omp_set_num_threads(t);
+        ColumnMatrix colmat;
+        colmat.Init(gmat, param);
+        for (unsigned fid = 0; fid < ncol; ++fid) {
+          // the features are sparse with the adaptive threshold of uint32 ids only
+          const bool sparse = std::string(adaptive) == "1" && std::string(dtype) == "uint32";
+          if (std::string(dtype) == "uint8") {
+            EXPECT_EQ(colmat.GetColumn<uint8_t>(fid).type == kSparseColumn, sparse);
+            EXPECT_EQ(ColumnBins<uint8_t>(colmat, fid, nrow), expected[fid]);
+          } else {
+            EXPECT_EQ(colmat.GetColumn<uint32_t>(fid).type == kSparseColumn, sparse);
+            EXPECT_EQ(ColumnBins<uint32_t>(colmat, fid, nrow), expected[fid]);
+          }
+        }
+      }
+    }
+  }
+  omp_set_num_threads(nthread);
+}
+}  // namespace common
+}  // namespace xgboost
@@ -77,3 +77,23 @@ void TestLbs() {
   }
 }
 TEST(cub_lbs, Test) { TestLbs(); }
+
+TEST(MemoryPool, ReuseAndUsage) {
+  dh::MemoryPool pool;
+  void *a = pool.Allocate(0, 1000);
+  void *b = pool.Allocate(0, 3000);
+  ASSERT_EQ(pool.CurrentBytes(0), 4000);
+  pool.Free(a);
+  ASSERT_EQ(pool.CurrentBytes(0), 3000);
+  // the freed block is cached and handed out again for the same size class
+  void *c = pool.Allocate(0, 900);
+  ASSERT_EQ(c, a);
+  pool.Free(b);
+  pool.Free(c);
+  ASSERT_EQ(pool.CurrentBytes(0), 0);
+  ASSERT_EQ(pool.PeakBytes(0), 4000);
+  pool.FreeCached();
+
+  dh::device_vector<int> v(100, 1);
+  ASSERT_GE(dh::GlobalMemoryPool().CurrentBytes(0), 100 * sizeof(int));
+}
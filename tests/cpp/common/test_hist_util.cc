@@ -0,0 +1,418 @@
+// Copyright by Contributors
+#include <dmlc/omp.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
+#include "../../../src/common/column_matrix.h"
+#include "../../../src/common/hist_util.h"
+#include "../../../src/common/io.h"
+#include "../helpers.h"
+
+namespace xgboost {
+namespace common {
+TEST(GHistBuilder, BuildHistBatch) {
+  const int nrow = 301;
+  auto dmat = CreateDMatrix(nrow, 7, 0.3f);
+  HistCutMatrix cut;
+  cut.Init(dmat.get(), 16);
+  GHistIndexMatrix gmat;
+  gmat.cut = &cut;
+  gmat.Init(dmat.get());
+  const uint32_t nbins = cut.row_ptr.back();
+
+  std::vector<bst_gpair> gpair(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    gpair[i] = bst_gpair(0.1f * (i % 13) - 0.5f, 0.01f * (i % 7) + 0.1f);
+  }
+  std::vector<size_t> rows(nrow);
+  std::iota(rows.begin(), rows.end(), 0);
+  // one large node and several small ones
+  const size_t bounds[] = {0, 250, 251, 270, 295, nrow};
+  const size_t nnode = 5;
+  std::vector<RowSetCollection::Elem> row_sets;
+  for (size_t i = 0; i < nnode; ++i) {
+    row_sets.emplace_back(rows.data() + bounds[i], rows.data() + bounds[i + 1], i);
+  }
+  std::vector<bst_uint> feat_set;
+
+  for (size_t nthread : {1, 4}) {
+    GHistBuilder builder;
+    builder.Init(nthread, nbins);
+    std::vector<GHistEntry> expected(nnode * nbins), batch(nnode * nbins);
+    std::vector<GHistRow> hists;
+    for (size_t i = 0; i < nnode; ++i) {
+      builder.BuildHist(gpair, row_sets[i], gmat, feat_set,
+                        GHistRow(expected.data() + i * nbins, nbins));
+      hists.emplace_back(batch.data() + i * nbins, nbins);
+    }
+    builder.BuildHistBatch(gpair, row_sets, gmat, feat_set, hists);
+    for (size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_NEAR(batch[i].sum_grad, expected[i].sum_grad, 1e-6);
+      ASSERT_NEAR(batch[i].sum_hess, expected[i].sum_hess, 1e-6);
+    }
+
+    // histogram of node 0 without the rows of node 1
+    std::vector<GHistEntry> diff(nbins);
+    builder.SubtractionTrickBatch({GHistRow(diff.data(), nbins)}, {hists[1]},
+                                  {hists[0]});
+    for (uint32_t i = 0; i < nbins; ++i) {
+      ASSERT_NEAR(diff[i].sum_grad, batch[i].sum_grad - batch[nbins + i].sum_grad, 1e-6);
+      ASSERT_NEAR(diff[i].sum_hess, batch[i].sum_hess - batch[nbins + i].sum_hess, 1e-6);
+    }
+  }
+}
+
+TEST(GHistBuilder, BuildHistNodeSizes) {
+  const int nrow = 500;
+  auto dmat = CreateDMatrix(nrow, 300, 0.0f);
+  HistCutMatrix cut;
+  cut.Init(dmat.get(), 32);
+  GHistIndexMatrix gmat;
+  gmat.cut = &cut;
+  gmat.Init(dmat.get());
+  const uint32_t nbins = cut.row_ptr.back();
+
+  std::vector<bst_gpair> gpair(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    gpair[i] = bst_gpair(0.1f * (i % 13) - 0.5f, 0.01f * (i % 7) + 0.1f);
+  }
+  std::vector<size_t> rows(nrow);
+  std::iota(rows.begin(), rows.end(), 0);
+  std::vector<bst_uint> feat_set;
+  // built by one thread, over disjoint bin ranges and with per thread copies
+  // of the rows taken by chunks or statically
+  for (bool static_rows : {false, true}) {
+    GHistBuilder builder;
+    builder.Init(4, nbins, static_rows);
+    for (size_t size : {5, 14, nrow}) {
+      RowSetCollection::Elem row_set(rows.data(), rows.data() + size, 0);
+      std::vector<GHistEntry> expected(nbins), out(nbins);
+      for (size_t i = 0; i < size; ++i) {
+        for (size_t j = gmat.row_ptr[i]; j < gmat.row_ptr[i + 1]; ++j) {
+          expected[gmat.index[j]].Add(gpair[i]);
+        }
+      }
+      builder.BuildHist(gpair, row_set, gmat, feat_set, GHistRow(out.data(), nbins));
+      for (uint32_t i = 0; i < nbins; ++i) {
+        ASSERT_NEAR(out[i].sum_grad, expected[i].sum_grad, 1e-6);
+        ASSERT_NEAR(out[i].sum_hess, expected[i].sum_hess, 1e-6);
+      }
+    }
+  }
+}
+
+TEST(GHistBuilder, DeterministicThreads) {
+  // several blocks of rows
+  const int nrow = 20000;
+  auto dmat = CreateDMatrix(nrow, 8, 0.0f);
+  HistCutMatrix cut;
+  cut.Init(dmat.get(), 32);
+  GHistIndexMatrix gmat;
+  gmat.cut = &cut;
+  gmat.Init(dmat.get());
+  const uint32_t nbins = cut.row_ptr.back();
+
+  std::vector<bst_gpair> gpair(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    gpair[i] = bst_gpair(0.1f * (i % 13) - 0.5f + (i % 997) * 1e-4f, 0.01f * (i % 7) + 0.1f);
+  }
+  std::vector<size_t> rows(nrow);
+  std::iota(rows.begin(), rows.end(), 0);
+  std::vector<bst_uint> feat_set;
+  // float sums, which depend on their order
+  std::vector<std::vector<GHistEntryT<float> > > out;
+  for (size_t nthread : {1, 3, 4}) {
+    GHistBuilderT<float> builder;
+    builder.Init(nthread, nbins, false, true);
+    out.emplace_back(2 * nbins);
+    // the whole node, and a node of a single block
+    std::vector<RowSetCollection::Elem> row_sets{
+      RowSetCollection::Elem(rows.data(), rows.data() + nrow, 0),
+      RowSetCollection::Elem(rows.data(), rows.data() + 1000, 1)};
+    std::vector<GHistRowT<float> > hists{
+      GHistRowT<float>(out.back().data(), nbins),
+      GHistRowT<float>(out.back().data() + nbins, nbins)};
+    builder.BuildHistBatch(gpair, row_sets, gmat, feat_set, hists);
+  }
+  // the sums are the same bit for bit
+  for (size_t k = 1; k < out.size(); ++k) {
+    for (uint32_t i = 0; i < 2 * nbins; ++i) {
+      ASSERT_EQ(out[k][i].sum_grad, out[0][i].sum_grad);
+      ASSERT_EQ(out[k][i].sum_hess, out[0][i].sum_hess);
+    }
+  }
+}
+
+TEST(GHistBuilder, SinglePrecision) {
+  const int nrow = 400;
+  auto dmat = CreateDMatrix(nrow, 20, 0.2f);
+  HistCutMatrix cut;
+  cut.Init(dmat.get(), 16);
+  GHistIndexMatrix gmat;
+  gmat.cut = &cut;
+  gmat.Init(dmat.get());
+  const uint32_t nbins = cut.row_ptr.back();
+
+  std::vector<bst_gpair> gpair(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    gpair[i] = bst_gpair(0.1f * (i % 13) - 0.5f, 0.01f * (i % 7) + 0.1f);
+  }
+  std::vector<size_t> rows(nrow);
+  std::iota(rows.begin(), rows.end(), 0);
+  RowSetCollection::Elem row_set(rows.data(), rows.data() + nrow, 0);
+  std::vector<bst_uint> feat_set;
+
+  for (size_t nthread : {1, 4}) {
+    GHistBuilder builder;
+    GHistBuilderT<float> float_builder;
+    builder.Init(nthread, nbins);
+    float_builder.Init(nthread, nbins);
+    std::vector<GHistEntry> expected(nbins);
+    std::vector<GHistEntryT<float> > out(nbins);
+    builder.BuildHist(gpair, row_set, gmat, feat_set, GHistRow(expected.data(), nbins));
+    float_builder.BuildHist(gpair, row_set, gmat, feat_set,
+                            GHistRowT<float>(out.data(), nbins));
+    for (uint32_t i = 0; i < nbins; ++i) {
+      ASSERT_NEAR(out[i].sum_grad, expected[i].sum_grad, 1e-4);
+      ASSERT_NEAR(out[i].sum_hess, expected[i].sum_hess, 1e-4);
+    }
+  }
+}
+
+TEST(GHistBuilder, SubtractionTrickFeatures) {
+  // three features of 2, 3 and 1 bins
+  const std::vector<uint32_t> cut_ptr = {0, 2, 5, 6};
+  const uint32_t nbins = 6;
+  std::vector<GHistEntry> parent(nbins), sibling(nbins), self(nbins);
+  for (uint32_t i = 0; i < nbins; ++i) {
+    parent[i].sum_grad = 2.0 * i + 1.0;
+    sibling[i].sum_grad = i;
+  }
+  BitMap features;
+  features.Resize(3);
+  features.Clear();
+  features.SetTrue(1);
+  GHistBuilder builder;
+  builder.Init(2, nbins);
+  builder.SubtractionTrickBatch({GHistRow(self.data(), nbins)},
+                                {GHistRow(sibling.data(), nbins)},
+                                {GHistRow(parent.data(), nbins)}, {&features}, cut_ptr);
+  // only the bins of feature 1 are subtracted
+  for (uint32_t i = 0; i < nbins; ++i) {
+    ASSERT_EQ(self[i].sum_grad, i >= 2 && i < 5 ? i + 1.0 : 0.0);
+  }
+}
+
+TEST(HistCutMatrix, InitThreadsAndSampling) {
+  auto dmat = CreateDMatrix(2000, 30, 0.5f);
+  const int nthread = omp_get_max_threads();
+  HistCutMatrix serial, parallel;
+  omp_set_num_threads(1);
+  serial.Init(dmat.get(), 32);
+  omp_set_num_threads(4);
+  parallel.Init(dmat.get(), 32);
+  // the features are sketched independently, the cuts do not depend on the threads
+  ASSERT_EQ(parallel.row_ptr, serial.row_ptr);
+  ASSERT_EQ(parallel.min_val, serial.min_val);
+  ASSERT_EQ(parallel.cut, serial.cut);
+
+  HistCutMatrix sampled;
+  sampled.Init(dmat.get(), 32, 0.1f);
+  omp_set_num_threads(nthread);
+  ASSERT_EQ(sampled.row_ptr.size(), serial.row_ptr.size());
+  for (size_t fid = 0; fid + 1 < sampled.row_ptr.size(); ++fid) {
+    ASSERT_GT(sampled.row_ptr[fid + 1], sampled.row_ptr[fid]);
+    const bst_float* begin = sampled.cut.data() + sampled.row_ptr[fid];
+    const bst_float* end = sampled.cut.data() + sampled.row_ptr[fid + 1];
+    ASSERT_TRUE(std::is_sorted(begin, end));
+  }
+}
+
+TEST(GHistIndexMatrix, SaveLoad) {
+  auto dmat = CreateDMatrix(50, 9, 0.4f);
+  HistCutMatrix cut;
+  cut.Init(dmat.get(), 8);
+  GHistIndexMatrix gmat;
+  gmat.cut = &cut;
+  gmat.Init(dmat.get());
+
+  std::string buffer;
+  common::MemoryBufferStream fo(&buffer);
+  cut.Save(&fo);
+  gmat.Save(&fo);
+  common::MemoryBufferStream fi(&buffer);
+  HistCutMatrix cut_loaded;
+  cut_loaded.Load(&fi);
+  GHistIndexMatrix gmat_loaded;
+  gmat_loaded.Load(&fi);
+  gmat_loaded.cut = &cut_loaded;
+
+  ASSERT_EQ(cut_loaded.row_ptr, cut.row_ptr);
+  ASSERT_EQ(cut_loaded.min_val, cut.min_val);
+  ASSERT_EQ(cut_loaded.cut, cut.cut);
+  ASSERT_EQ(gmat_loaded.row_ptr, gmat.row_ptr);
+  ASSERT_EQ(gmat_loaded.hit_count, gmat.hit_count);
+  ASSERT_EQ(gmat_loaded.index.dtype(), gmat.index.dtype());
+  ASSERT_EQ(gmat_loaded.index.size(), gmat.index.size());
+  for (size_t i = 0; i < gmat.index.size(); ++i) {
+    ASSERT_EQ(gmat_loaded.index[i], gmat.index[i]);
+  }
+}
+
+TEST(BinIndex, NarrowestType) {
+  BinIndex index;
+  const uint32_t nbins[] = {256, 257, 1U << 16, (1U << 16) + 1};
+  const DataType expected[] = {uint8, uint16, uint16, uint32};
+  for (size_t i = 0; i < 4; ++i) {
+    index.SetBinCount(nbins[i]);
+    index.resize(3);
+    ASSERT_EQ(index.dtype(), expected[i]);
+    ASSERT_EQ(index.size(), 3);
+    XGBOOST_TYPE_SWITCH(index.dtype(), {
+      index.data<DType>()[2] = static_cast<DType>(nbins[i] - 1);
+    });
+    ASSERT_EQ(index[2], nbins[i] - 1);
+  }
+}
+
+TEST(BinIndex, Packed) {
+  const int nrow = 500;
+  auto dmat = CreateDMatrix(nrow, 30, 0.2f);
+  HistCutMatrix cut;
+  cut.Init(dmat.get(), 64);
+  GHistIndexMatrix gmat;
+  gmat.cut = &cut;
+  gmat.Init(dmat.get());
+  const uint32_t nbins = cut.row_ptr.back();
+  GHistIndexMatrix packed = gmat;
+  packed.Compress();
+  ASSERT_TRUE(packed.index.packed());
+  ASSERT_LT(packed.index.MemoryBytes(), gmat.index.MemoryBytes());
+  ASSERT_EQ(packed.index.size(), gmat.index.size());
+  for (size_t i = 0; i < gmat.index.size(); ++i) {
+    ASSERT_EQ(packed.index[i], gmat.index[i]);
+  }
+
+  std::vector<bst_gpair> gpair(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    gpair[i] = bst_gpair(0.1f * (i % 13) - 0.5f, 0.01f * (i % 7) + 0.1f);
+  }
+  std::vector<size_t> rows(nrow);
+  std::iota(rows.begin(), rows.end(), 0);
+  RowSetCollection::Elem row_set(rows.data(), rows.data() + nrow, 0);
+  std::vector<bst_uint> feat_set;
+  GHistBuilder builder;
+  builder.Init(4, nbins, false);
+  std::vector<GHistEntry> expected(nbins), out(nbins);
+  builder.BuildHist(gpair, row_set, gmat, feat_set, GHistRow(expected.data(), nbins));
+  builder.BuildHist(gpair, row_set, packed, feat_set, GHistRow(out.data(), nbins));
+  for (uint32_t i = 0; i < nbins; ++i) {
+    ASSERT_EQ(out[i].sum_grad, expected[i].sum_grad);
+    ASSERT_EQ(out[i].sum_hess, expected[i].sum_hess);
+  }
+
+  // the rows appended to a packed matrix are packed with the others
+  dmlc::DataIter<RowBatch>* iter = dmat->RowIterator();
+  iter->BeforeFirst();
+  ASSERT_TRUE(iter->Next());
+  packed.PushBatch(iter->Value());
+  gmat.PushBatch(iter->Value());
+  ASSERT_TRUE(packed.index.packed());
+  ASSERT_EQ(packed.index.size(), gmat.index.size());
+  for (size_t i = 0; i < gmat.index.size(); ++i) {
+    ASSERT_EQ(packed.index[i], gmat.index[i]);
+  }
+  packed.index.Unpack();
+  ASSERT_FALSE(packed.index.packed());
+  ASSERT_EQ(packed.index.dtype(), gmat.index.dtype());
+  ASSERT_EQ(packed.index[gmat.index.size() - 1], gmat.index[gmat.index.size() - 1]);
+}
+
+TEST(GHistIndexBlockMatrix, ExclusiveBundles) {
+  // three one-hot encoded variables of 4 levels and a dense feature
+  const int nrow = 200;
+  std::string fname = TempFileName();
+  {
+    std::ofstream fo(fname);
+    for (int i = 0; i < nrow; ++i) {
+      fo << i % 2;
+      for (int v = 0; v < 3; ++v) {
+        fo << " " << v * 4 + (i * (v + 1) / 3) % 4 << ":1";
+      }
+      fo << " 12:" << 0.01f * i << "\n";
+    }
+  }
+  std::unique_ptr<DMatrix> dmat(DMatrix::Load(fname, true, false));
+  std::remove(fname.c_str());
+  HistCutMatrix cut;
+  cut.Init(dmat.get(), 16);
+  GHistIndexMatrix gmat;
+  gmat.cut = &cut;
+  gmat.Init(dmat.get());
+  const uint32_t nbins = cut.row_ptr.back();
+  tree::FastHistParam fhparam;
+  fhparam.InitAllowUnknown(std::vector<std::pair<std::string, std::string> >{
+      {"enable_feature_grouping", "1"}, {"exclusive_feature_bundling", "1"}});
+  ColumnMatrix colmat;
+  colmat.Init(gmat, fhparam);
+  GHistIndexBlockMatrix gmatb;
+  gmatb.Init(gmat, colmat, fhparam);
+  // the levels of a variable are bundled
+  ASSERT_EQ(gmatb.GetNumBlock(), 4);
+  for (size_t bid = 0; bid < gmatb.GetNumBlock(); ++bid) {
+    ASSERT_NE(gmatb[bid].bundle, nullptr);
+  }
+
+  std::vector<bst_gpair> gpair(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    gpair[i] = bst_gpair(0.1f * (i % 13) - 0.5f, 0.01f * (i % 7) + 0.1f);
+  }
+  std::vector<size_t> rows;
+  for (int i = 0; i < nrow; i += 3) rows.push_back(i);
+  RowSetCollection::Elem row_set(rows.data(), rows.data() + rows.size(), 0);
+  std::vector<bst_uint> feat_set;
+  GHistBuilder builder;
+  builder.Init(1, nbins);
+  std::vector<GHistEntry> expected(nbins), out(nbins);
+  builder.BuildHist(gpair, row_set, gmat, feat_set, GHistRow(expected.data(), nbins));
+  builder.BuildBlockHist(gpair, row_set, gmatb, feat_set, GHistRow(out.data(), nbins));
+  for (uint32_t i = 0; i < nbins; ++i) {
+    ASSERT_NEAR(out[i].sum_grad, expected[i].sum_grad, 1e-6);
+    ASSERT_NEAR(out[i].sum_hess, expected[i].sum_hess, 1e-6);
+  }
+}
+
+TEST(HistCollection, ReuseAndEvict) {
+  HistCollection hist;
+  hist.Init(4, 2);
+  hist.AddHistRow(0);
+  hist[0].begin[1].sum_grad = 1.0;
+  GHistEntry* root = hist[0].begin;
+  // a released row is reused, cleared, for the next node
+  hist.ReleaseHistRow(0);
+  ASSERT_FALSE(hist.RowExists(0));
+  hist.AddHistRow(1);
+  ASSERT_EQ(hist[1].begin, root);
+  ASSERT_EQ(hist[1].begin[1].sum_grad, 0.0);
+
+  hist.AddHistRow(2);
+  hist.MarkEvictable(1);
+  hist.MarkEvictable(2);
+  // node 2 is kept, node 1 is the oldest evictable one
+  hist.UnmarkEvictable(2);
+  hist.AddHistRow(3);
+  ASSERT_TRUE(hist.RowExists(1));
+  hist.MarkEvictable(3);
+  // the limit of two evictable rows is reached
+  hist.AddHistRow(4);
+  ASSERT_FALSE(hist.RowExists(1));
+  ASSERT_TRUE(hist.RowExists(2));
+  ASSERT_TRUE(hist.RowExists(3));
+  // node 4 takes the first row, released by node 1
+  ASSERT_EQ(hist[2].begin - hist[4].begin, 4);
+}
+}  // namespace common
+}  // namespace xgboost
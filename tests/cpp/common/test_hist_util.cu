@@ -0,0 +1,32 @@
+/*!
+ * Copyright 2018 XGBoost contributors
+ */
+#include <xgboost/base.h>
+#include <vector>
+#include "../../../src/common/hist_util.h"
+#include "../helpers.h"
+#include "gtest/gtest.h"
+
+namespace xgboost {
+namespace common {
+TEST(DeviceSketch, MatchesHostSketch) {
+  const int max_bins = 16;
+  for (float sparsity : {0.0f, 0.7f}) {
+    // few enough rows for the summaries of both sketches to be exact
+    auto dmat = CreateDMatrix(100, 10, sparsity);
+    HistCutMatrix host_cuts;
+    host_cuts.Init(dmat.get(), max_bins);
+    HistCutMatrix device_cuts;
+    DeviceSketch({0}, dmat.get(), max_bins, &device_cuts);
+
+    ASSERT_EQ(device_cuts.row_ptr, host_cuts.row_ptr);
+    for (size_t i = 0; i < host_cuts.cut.size(); ++i) {
+      ASSERT_NEAR(device_cuts.cut[i], host_cuts.cut[i], 1e-6f);
+    }
+    for (size_t i = 0; i < host_cuts.min_val.size(); ++i) {
+      ASSERT_NEAR(device_cuts.min_val[i], host_cuts.min_val[i], 1e-6f);
+    }
+  }
+}
+}  // namespace common
+}  // namespace xgboost
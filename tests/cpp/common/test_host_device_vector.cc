@@ -0,0 +1,24 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/base.h>
+#include <vector>
+#include "../../../src/common/host_device_vector.h"
+
+namespace xgboost {
+TEST(HostDeviceVector, HostAccess) {
+  HostDeviceVector<bst_float> v(10, 1.0f);
+  bst_float* shard = v.shard_ptr_h(4, 8);
+  for (int i = 0; i < 4; ++i) shard[i] = 2.0f;
+  const std::vector<bst_float>& h = v.const_data_h();
+  ASSERT_EQ(h.size(), 10U);
+  for (size_t i = 0; i < h.size(); ++i) {
+    EXPECT_EQ(h[i], i >= 4 && i < 8 ? 2.0f : 1.0f);
+  }
+  EXPECT_EQ(v.const_ptr_h(), v.ptr_h());
+  v.resize(12, 3.0f);
+  EXPECT_EQ(v.const_data_h().back(), 3.0f);
+  std::vector<bst_float> out(12);
+  v.copy_to(out.data());
+  EXPECT_EQ(out, v.const_data_h());
+}
+}  // namespace xgboost
@@ -0,0 +1,61 @@
+/*!
+ * Copyright 2018 XGBoost contributors
+ */
+#include <thrust/copy.h>
+#include <thrust/fill.h>
+#include <xgboost/base.h>
+#include <vector>
+#include "../../../src/common/device_helpers.cuh"
+#include "../../../src/common/host_device_vector.h"
+#include "gtest/gtest.h"
+
+namespace xgboost {
+
+TEST(HostDeviceVector, ReadOnlyAccess) {
+  HostDeviceVector<bst_float> v(100, 1.0f, 0);
+  // reading on the host keeps the device copy
+  const std::vector<bst_float>& h = v.const_data_h();
+  EXPECT_EQ(h[50], 1.0f);
+  thrust::fill(v.tbegin(0), v.tend(0), 2.0f);
+  EXPECT_EQ(v.const_data_h()[50], 2.0f);
+  v.data_h()[50] = 3.0f;
+  std::vector<bst_float> d(v.size());
+  thrust::copy(thrust::device_ptr<const bst_float>(v.const_ptr_d(0)),
+               thrust::device_ptr<const bst_float>(v.const_ptr_d(0)) + v.size(),
+               d.begin());
+  EXPECT_EQ(d[49], 2.0f);
+  EXPECT_EQ(d[50], 3.0f);
+}
+
+TEST(HostDeviceVector, Shards) {
+  const size_t n = 1000;
+  HostDeviceVector<bst_float> v(n, 0.0f);
+  // one half is written on the device, the other one on the host
+  thrust::device_ptr<bst_float> d(v.shard_ptr_d(0, 0, n / 2));
+  thrust::fill(d, d + n / 2, 1.0f);
+  bst_float* h = v.shard_ptr_h(n / 2, n);
+  for (size_t i = 0; i < n / 2; ++i) h[i] = 2.0f;
+  const std::vector<bst_float>& all = v.const_data_h();
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(all[i], i < n / 2 ? 1.0f : 2.0f);
+  }
+  std::vector<bst_float> on_d(n);
+  thrust::copy(v.tbegin(0), v.tend(0), on_d.begin());
+  EXPECT_EQ(on_d, all);
+}
+
+TEST(HostDeviceVector, AsyncCopy) {
+  HostDeviceVector<bst_gpair> v(64, bst_gpair(1.0f, 2.0f));
+  cudaStream_t stream;
+  dh::safe_cuda(cudaStreamCreate(&stream));
+  v.copy_to_d_async(0, stream);
+  dh::safe_cuda(cudaStreamSynchronize(stream));
+  thrust::device_ptr<bst_gpair> d(v.ptr_d(0));
+  d[3] = bst_gpair(3.0f, 4.0f);
+  v.copy_to_h_async(stream);
+  dh::safe_cuda(cudaStreamSynchronize(stream));
+  EXPECT_EQ(v.const_data_h()[3].GetGrad(), 3.0f);
+  EXPECT_EQ(v.const_data_h()[2].GetHess(), 2.0f);
+  dh::safe_cuda(cudaStreamDestroy(stream));
+}
+}  // namespace xgboost
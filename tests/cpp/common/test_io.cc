@@ -0,0 +1,39 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <dmlc/io.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "../../../src/common/io.h"
+
+namespace xgboost {
+namespace common {
+namespace {
+struct Snapshot {
+  std::string bytes;
+  void Save(dmlc::Stream* fo) const { fo->Write(bytes); }
+};
+}  // namespace
+
+TEST(AsyncFileWriter, Write) {
+  const std::string tmp_file = "async_file_writer.bin";
+  Snapshot obj;
+  obj.bytes = "first";
+  AsyncFileWriter writer;
+  writer.Write(obj, tmp_file);
+  // the object is free to change while its snapshot is written
+  obj.bytes = "second";
+  writer.Wait();
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(tmp_file.c_str(), "r"));
+  std::string read;
+  ASSERT_TRUE(fi->Read(&read));
+  EXPECT_EQ(read, "first");
+  std::remove(tmp_file.c_str());
+
+  // the error of a write is raised by the next wait
+  writer.Write(obj, "no_such_dir_for_async_writer/file.bin");
+  EXPECT_ANY_THROW(writer.Wait());
+  writer.Wait();
+}
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,64 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../../src/common/hist_util.h"
+#include "../../../src/common/memory_tracker.h"
+
+namespace xgboost {
+namespace common {
+namespace {
+MemoryTracker::Usage UsageOf(const std::string& tag) {
+  return MemoryTracker::Get()->Usages()[tag];
+}
+}  // namespace
+
+TEST(MemoryTracker, TrackedBytes) {
+  MemoryTracker::Get()->ResetPeak();
+  const MemoryTracker::Usage before = MemoryTracker::Get()->Total();
+  {
+    TrackedBytes a("test.tracked");
+    a.Set(100);
+    ASSERT_EQ(UsageOf("test.tracked").current, 100U);
+    a.Set(40);
+    ASSERT_EQ(UsageOf("test.tracked").current, 40U);
+    ASSERT_EQ(UsageOf("test.tracked").peak, 100U);
+
+    // a copy holds the bytes again, a move takes them over
+    TrackedBytes b(a);
+    ASSERT_EQ(UsageOf("test.tracked").current, 80U);
+    TrackedBytes c(std::move(b));
+    ASSERT_EQ(b.Bytes(), 0U);
+    ASSERT_EQ(c.Bytes(), 40U);
+    ASSERT_EQ(UsageOf("test.tracked").current, 80U);
+    TrackedBytes d("test.tracked");
+    d = std::move(c);
+    ASSERT_EQ(UsageOf("test.tracked").current, 80U);
+    d = a;
+    ASSERT_EQ(UsageOf("test.tracked").current, 80U);
+    ASSERT_EQ(MemoryTracker::Get()->Total().current, before.current + 80U);
+    ASSERT_EQ(MemoryTracker::Get()->Total().peak, before.current + 100U);
+  }
+  // the bytes are given back on destruction, the peak stays
+  ASSERT_EQ(UsageOf("test.tracked").current, 0U);
+  ASSERT_EQ(UsageOf("test.tracked").peak, 100U);
+  MemoryTracker::Get()->ResetPeak();
+  ASSERT_EQ(UsageOf("test.tracked").peak, 0U);
+  ASSERT_NE(MemoryTracker::Get()->ToJSON().find("\"test.tracked\": {\"current\": 0"),
+            std::string::npos);
+}
+
+TEST(MemoryTracker, HistCollection) {
+  const size_t before = UsageOf("HistCollection").current;
+  {
+    HistCollection hist;
+    hist.Init(64);
+    for (bst_uint nid = 0; nid < 4; ++nid) hist.AddHistRow(nid);
+    ASSERT_GE(hist.MemoryBytes(), 4 * 64 * sizeof(GHistEntry));
+    ASSERT_EQ(UsageOf("HistCollection").current, before + hist.MemoryBytes());
+  }
+  ASSERT_EQ(UsageOf("HistCollection").current, before);
+}
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,64 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <random>
+#include <utility>
+#include <vector>
+#include "../../../src/common/quantile.h"
+
+namespace xgboost {
+namespace common {
+namespace {
+typedef WQSummary<bst_float, bst_float> Summary;
+typedef Summary::Entry Entry;
+
+// exact summary of the weighted values, sorted and distinct
+std::vector<Entry> ExactSummary(const std::vector<std::pair<bst_float, bst_float> >& values) {
+  std::vector<Entry> entries;
+  bst_float rank = 0.0f;
+  for (const auto& v : values) {
+    entries.push_back(Entry(rank, rank + v.second, v.second, v.first));
+    rank += v.second;
+  }
+  return entries;
+}
+}  // namespace
+
+TEST(WQSummary, SetCombine) {
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  for (size_t n : {1, 5, 64, 1000}) {
+    // values of a grid, in a, in b or in both
+    std::vector<std::pair<bst_float, bst_float> > va, vb, vall;
+    for (size_t i = 0; i < n; ++i) {
+      const bst_float v = i * 0.25f, wa = 0.1f + dis(gen), wb = 0.1f + dis(gen);
+      const float r = dis(gen);
+      if (r < 0.3f) {
+        va.push_back(std::make_pair(v, wa));
+        vb.push_back(std::make_pair(v, wb));
+        vall.push_back(std::make_pair(v, wa + wb));
+      } else if (r < 0.65f) {
+        va.push_back(std::make_pair(v, wa));
+        vall.push_back(std::make_pair(v, wa));
+      } else {
+        vb.push_back(std::make_pair(v, wb));
+        vall.push_back(std::make_pair(v, wb));
+      }
+    }
+    std::vector<Entry> ea = ExactSummary(va), eb = ExactSummary(vb);
+    std::vector<Entry> expected = ExactSummary(vall);
+    Summary sa(ea.data(), ea.size()), sb(eb.data(), eb.size());
+    std::vector<Entry> eout(ea.size() + eb.size());
+    Summary out(eout.data(), 0);
+    // the merge of exact summaries is the exact summary of the union
+    out.SetCombine(sa, sb);
+    ASSERT_EQ(out.size, expected.size());
+    for (size_t i = 0; i < out.size; ++i) {
+      ASSERT_EQ(out.data[i].value, expected[i].value);
+      ASSERT_NEAR(out.data[i].rmin, expected[i].rmin, 1e-3);
+      ASSERT_NEAR(out.data[i].rmax, expected[i].rmax, 1e-3);
+      ASSERT_NEAR(out.data[i].wmin, expected[i].wmin, 1e-5);
+    }
+  }
+}
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,51 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/data.h>
+#include <algorithm>
+#include <vector>
+#include "../../../src/common/radix_sort.h"
+
+namespace xgboost {
+namespace common {
+TEST(RadixSort, SortByValue) {
+  typedef SparseBatch::Entry Entry;
+  // enough entries for several threads, negative values and many ties
+  const size_t n = 100000;
+  std::vector<Entry> data(n), tmp(n);
+  for (size_t i = 0; i < n; ++i) {
+    data[i] = Entry(static_cast<bst_uint>(i),
+                    static_cast<bst_float>((i * 7919) % 1001) * 0.25f - 100.0f);
+  }
+  std::vector<Entry> expected = data;
+  std::stable_sort(expected.begin(), expected.end(), Entry::CmpValue);
+  for (int nthread : {1, 4}) {
+    std::vector<Entry> sorted = data;
+    RadixSortByValue(dmlc::BeginPtr(sorted), n, dmlc::BeginPtr(tmp), nthread);
+    for (size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(sorted[i].index, expected[i].index);
+      ASSERT_EQ(sorted[i].fvalue, expected[i].fvalue);
+    }
+  }
+}
+
+TEST(RadixSort, SortGroupsByValue) {
+  typedef SparseBatch::Entry Entry;
+  // a large group sorted by all the threads, a group sorted by radix,
+  // small groups sorted by comparison and empty groups
+  const std::vector<size_t> ptr = {0, 50000, 50000, 51000, 51003, 51004};
+  std::vector<Entry> data(ptr.back());
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = Entry(static_cast<bst_uint>(i),
+                    static_cast<bst_float>((i * 104729) % 3001) - 1500.0f);
+  }
+  SortGroupsByValue(ptr, &data, 4);
+  for (size_t g = 0; g + 1 < ptr.size(); ++g) {
+    for (size_t i = ptr[g] + 1; i < ptr[g + 1]; ++i) {
+      ASSERT_LE(data[i - 1].fvalue, data[i].fvalue);
+      ASSERT_GE(data[i].index, ptr[g]);
+      ASSERT_LT(data[i].index, ptr[g + 1]);
+    }
+  }
+}
+}  // namespace common
+}  // namespace xgboost
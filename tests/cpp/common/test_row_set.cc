@@ -0,0 +1,70 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <numeric>
+#include <vector>
+#include "../../../src/common/row_set.h"
+
+namespace xgboost {
+namespace common {
+TEST(RowSetCollection, Partition) {
+  // several partition blocks, the last one incomplete
+  const size_t nrow = 5000;
+  RowSetCollection row_set;
+  row_set.row_indices_.resize(nrow);
+  std::iota(row_set.row_indices_.begin(), row_set.row_indices_.end(), 0);
+  row_set.Init();
+
+  std::vector<uint8_t> goes_left(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    goes_left[i] = (i % 3 == 0) || (i > 4500);
+  }
+  row_set.Partition(0, goes_left, 1, 2, 4);
+  std::vector<size_t> left, right;
+  for (size_t i = 0; i < nrow; ++i) {
+    (goes_left[i] ? left : right).push_back(i);
+  }
+  // both children keep the original order of their rows
+  ASSERT_EQ(row_set[1].size(), left.size());
+  ASSERT_EQ(row_set[2].size(), right.size());
+  ASSERT_EQ(std::vector<size_t>(row_set[1].begin, row_set[1].end), left);
+  ASSERT_EQ(std::vector<size_t>(row_set[2].begin, row_set[2].end), right);
+
+  // all the rows of node 2 go right
+  row_set.Partition(2, std::vector<uint8_t>(right.size(), 0), 3, 4, 4);
+  ASSERT_EQ(row_set[3].size(), 0);
+  ASSERT_EQ(std::vector<size_t>(row_set[4].begin, row_set[4].end), right);
+}
+
+TEST(RowSetCollection, PartitionGradients) {
+  const size_t nrow = 5000;
+  RowSetCollection row_set;
+  row_set.row_indices_.resize(nrow);
+  std::iota(row_set.row_indices_.begin(), row_set.row_indices_.end(), 0);
+  row_set.Init();
+  std::vector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair[i] = bst_gpair(static_cast<float>(i), 1.0f);
+  }
+  row_set.InitGradients(gpair, 4);
+
+  std::vector<uint8_t> goes_left(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    goes_left[i] = (i % 7 < 3) || (i > 4000);
+  }
+  row_set.Partition(0, goes_left, 1, 2, 4);
+  std::vector<uint8_t> right_left(row_set[2].size());
+  for (size_t i = 0; i < right_left.size(); ++i) {
+    right_left[i] = i % 2;
+  }
+  row_set.Partition(2, right_left, 3, 4, 4);
+  // every node reads the gradients of its rows in their order
+  for (unsigned nid : {1, 3, 4}) {
+    const RowSetCollection::Elem e = row_set[nid];
+    ASSERT_NE(e.gpair, nullptr);
+    for (size_t i = 0; i < e.size(); ++i) {
+      ASSERT_EQ(e.gpair[i].GetGrad(), static_cast<float>(e.begin[i]));
+    }
+  }
+}
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,41 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../../../src/common/task_queue.h"
+
+namespace xgboost {
+namespace common {
+
+TEST(TaskQueue, Order) {
+  std::vector<int> order;
+  std::thread::id caller = std::this_thread::get_id();
+  std::atomic<bool> on_worker(true);
+  {
+    TaskQueue tasks;
+    for (int i = 0; i < 100; ++i) {
+      tasks.Push([&order, &on_worker, caller, i]() {
+        if (std::this_thread::get_id() == caller) on_worker = false;
+        order.push_back(i);
+      });
+    }
+    tasks.Wait();
+    ASSERT_EQ(order.size(), 100);
+    tasks.Push([&order]() { order.push_back(100); });
+    // the destructor runs the pending tasks
+  }
+  ASSERT_TRUE(on_worker);
+  ASSERT_EQ(order.size(), 101);
+  for (int i = 0; i < 101; ++i) {
+    ASSERT_EQ(order[i], i);
+  }
+}
+
+TEST(TaskQueue, Empty) {
+  // no thread is started without tasks
+  TaskQueue tasks;
+  tasks.Wait();
+}
+}  // namespace common
+}  // namespace xgboost
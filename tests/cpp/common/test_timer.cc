@@ -0,0 +1,48 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include "../../../src/common/timer.h"
+
+namespace xgboost {
+namespace common {
+TEST(Profiler, Trace) {
+  Profiler::Get()->SetTracing(true);
+  Monitor monitor;
+  monitor.Init("TestTrace", false);
+  monitor.Start("outer");
+  monitor.Start("inner");
+  monitor.Stop("inner");
+  monitor.Stop("outer");
+  monitor.Start("device", {0, 1});
+  monitor.Stop("device", {0, 1});
+  std::thread worker([]() { Profiler::Get()->AddTime("TestTrace.worker", 0.5); });
+  worker.join();
+  const std::string trace = Profiler::Get()->TraceJSON();
+  Profiler::Get()->SetTracing(false);
+
+  ASSERT_EQ(trace.find("{\"displayTimeUnit\": \"ms\", \"traceEvents\": ["), 0U);
+  ASSERT_NE(trace.find("\"name\": \"TestTrace.outer\", \"cat\": \"TestTrace\", \"ph\": \"X\""),
+            std::string::npos);
+  ASSERT_NE(trace.find("\"name\": \"TestTrace.inner\""), std::string::npos);
+  // the timing of the devices is an event of each of them
+  const size_t device = trace.find("\"name\": \"TestTrace.device\"");
+  ASSERT_NE(device, std::string::npos);
+  ASSERT_NE(trace.find("\"pid\": 1, \"tid\": 0}", device), std::string::npos);
+  ASSERT_NE(trace.find("\"pid\": 1, \"tid\": 1}", device), std::string::npos);
+  // the worker thread gets its own row, its event lasts 0.5s
+  const size_t worker_event = trace.find("\"name\": \"TestTrace.worker\"");
+  ASSERT_NE(worker_event, std::string::npos);
+  ASSERT_NE(trace.find("\"dur\": 500000, \"pid\": 0", worker_event), std::string::npos);
+  auto tid_of = [&](size_t event) {
+    return std::atoi(trace.c_str() + trace.find("\"tid\": ", event) + 7);
+  };
+  ASSERT_NE(tid_of(worker_event), tid_of(trace.find("\"name\": \"TestTrace.outer\"")));
+
+  // the events are not recorded once the tracing stops
+  Profiler::Get()->AddTime("TestTrace.untraced", 0.1);
+  ASSERT_EQ(Profiler::Get()->TraceJSON().find("TestTrace.untraced"), std::string::npos);
+}
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,83 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include <cmath>
+#include "../../../src/data/buffer_source.h"
+
+#include "../helpers.h"
+
+namespace {
+// the rows of the source, gathered over all its batches
+std::vector<std::vector<xgboost::SparseBatch::Entry> > ReadRows(
+    xgboost::data::BufferSource* source) {
+  std::vector<std::vector<xgboost::SparseBatch::Entry> > rows;
+  source->BeforeFirst();
+  while (source->Next()) {
+    const xgboost::RowBatch& batch = source->Value();
+    EXPECT_EQ(batch.base_rowid, rows.size());
+    for (size_t i = 0; i < batch.size; ++i) {
+      xgboost::SparseBatch::Inst inst = batch[i];
+      rows.emplace_back(inst.data, inst.data + inst.length);
+    }
+  }
+  return rows;
+}
+}  // namespace
+
+TEST(BufferSource, Dense) {
+  const float nan = std::nanf("");
+  std::vector<float> data = {1, 0, 2,
+                             nan, 3, 0,
+                             0, 0, 0,
+                             4, 5, nan,
+                             6, nan, 7};
+  EXPECT_ANY_THROW(xgboost::data::DenseBufferSource(data.data(), 5, 3, 0.0f));
+
+  xgboost::data::DenseBufferSource source(data.data(), 5, 3, nan, 2);
+  EXPECT_EQ(source.info.num_row, 5);
+  EXPECT_EQ(source.info.num_col, 3);
+  EXPECT_EQ(source.info.num_nonzero, 12);
+  auto rows = ReadRows(&source);
+  ASSERT_EQ(rows.size(), 5);
+  EXPECT_EQ(rows[1].size(), 2);
+  EXPECT_EQ(rows[1][1].index, 2);
+  EXPECT_EQ(rows[1][1].fvalue, 0.0f);
+  EXPECT_EQ(rows[4][1].index, 2);
+  EXPECT_EQ(rows[4][1].fvalue, 7.0f);
+  // a second pass over the rows gives the same batches
+  EXPECT_EQ(ReadRows(&source).size(), 5);
+
+  xgboost::data::DenseBufferSource nonzero(data.data(), 1, 3, 0.0f);
+  rows = ReadRows(&nonzero);
+  ASSERT_EQ(rows.size(), 1);
+  ASSERT_EQ(rows[0].size(), 2);
+  EXPECT_EQ(rows[0][1].index, 2);
+}
+
+TEST(BufferSource, CSR) {
+  const float nan = std::nanf("");
+  std::vector<size_t> indptr = {0, 2, 2, 5};
+  std::vector<unsigned> indices = {0, 3, 1, 2, 4};
+  std::vector<float> data = {1, nan, 2, 3, 4};
+  std::unique_ptr<xgboost::data::CSRBufferSource> source(
+      new xgboost::data::CSRBufferSource(indptr.data(), indices.data(),
+                                         data.data(), indptr.size(), 0, 2));
+  EXPECT_EQ(source->info.num_row, 3);
+  EXPECT_EQ(source->info.num_col, 5);
+  EXPECT_EQ(source->info.num_nonzero, 4);
+  auto rows = ReadRows(source.get());
+  ASSERT_EQ(rows.size(), 3);
+  EXPECT_EQ(rows[0].size(), 1);
+  EXPECT_EQ(rows[1].size(), 0);
+  ASSERT_EQ(rows[2].size(), 3);
+  EXPECT_EQ(rows[2][2].index, 4);
+  EXPECT_EQ(rows[2][2].fvalue, 4.0f);
+
+  // column access is built over the batches of the source
+  std::unique_ptr<xgboost::DMatrix> dmat(
+      xgboost::DMatrix::Create(std::move(source)));
+  const std::vector<bool> enable(dmat->info().num_col, true);
+  dmat->InitColAccess(enable, 1, dmat->info().num_row, true);
+  EXPECT_EQ(dmat->GetColSize(0), 1);
+  EXPECT_EQ(dmat->GetColSize(3), 0);
+  EXPECT_EQ(dmat->GetColSize(4), 1);
+}
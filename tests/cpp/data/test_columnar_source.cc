@@ -0,0 +1,93 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include <cmath>
+#include "../../../src/data/columnar_source.h"
+
+#include "../helpers.h"
+
+namespace {
+// 5 rows: a float column with a NaN, a double column with a validity bitmap
+// that starts one row into its buffers, and a uint32 column
+struct TestColumns {
+  std::vector<float> col0 = {1, std::nanf(""), 3, 4, 5};
+  std::vector<double> col1 = {-1, 10, 20, 30, 40, 50};
+  // rows 1 and 3 of the column are missing, bit 0 is the unused first value
+  std::vector<uint8_t> bitmap1 = {0x2A};
+  std::vector<uint32_t> col2 = {7, 0, 9, 9, 2};
+  const void* columns[3];
+  const int types[3] = {xgboost::kFloat32, xgboost::kDouble, xgboost::kUInt32};
+  const uint8_t* validity[3];
+  const uint64_t offsets[3] = {0, 1, 0};
+  TestColumns() {
+    columns[0] = col0.data();
+    columns[1] = col1.data();
+    columns[2] = col2.data();
+    validity[0] = nullptr;
+    validity[1] = bitmap1.data();
+    validity[2] = nullptr;
+  }
+};
+}  // namespace
+
+TEST(ColumnarSource, Rows) {
+  TestColumns t;
+  xgboost::data::ColumnarSource source(t.columns, t.types, t.validity, t.offsets,
+                                       3, 5, 2);
+  EXPECT_EQ(source.info.num_row, 5);
+  EXPECT_EQ(source.info.num_col, 3);
+  EXPECT_EQ(source.info.num_nonzero, 12);
+  std::vector<std::vector<xgboost::SparseBatch::Entry> > rows;
+  for (int pass = 0; pass < 2; ++pass) {
+    rows.clear();
+    source.BeforeFirst();
+    while (source.Next()) {
+      const xgboost::RowBatch& batch = source.Value();
+      EXPECT_EQ(batch.base_rowid, rows.size());
+      for (size_t i = 0; i < batch.size; ++i) {
+        rows.emplace_back(batch[i].data, batch[i].data + batch[i].length);
+      }
+    }
+    ASSERT_EQ(rows.size(), 5);
+    std::vector<size_t> lengths = {3, 1, 3, 2, 3};
+    for (size_t i = 0; i < rows.size(); ++i) {
+      ASSERT_EQ(rows[i].size(), lengths[i]);
+    }
+    EXPECT_EQ(rows[0][1].index, 1);
+    EXPECT_EQ(rows[0][1].fvalue, 10);
+    EXPECT_EQ(rows[1][0].index, 2);
+    EXPECT_EQ(rows[2][1].fvalue, 30);
+    EXPECT_EQ(rows[4][1].fvalue, 50);
+    EXPECT_EQ(rows[4][2].fvalue, 2);
+  }
+}
+
+TEST(ColumnarSource, ColAccess) {
+  TestColumns t;
+  std::unique_ptr<xgboost::data::ColumnarSource> source(
+      new xgboost::data::ColumnarSource(t.columns, t.types, t.validity, t.offsets,
+                                        3, 5));
+  std::unique_ptr<xgboost::DMatrix> dmat(
+      xgboost::DMatrix::Create(std::move(source)));
+  std::vector<bool> enabled = {true, false, true};
+  dmat->InitColAccess(enabled, 1.0f, 1024, true);
+  EXPECT_TRUE(dmat->HaveColAccess(true));
+  EXPECT_EQ(dmat->buffered_rowset().size(), 5);
+  EXPECT_EQ(dmat->GetColSize(0), 4);
+  EXPECT_EQ(dmat->GetColSize(1), 0);
+  EXPECT_EQ(dmat->GetColSize(2), 5);
+  dmlc::DataIter<xgboost::ColBatch>* iter = dmat->ColIterator();
+  iter->BeforeFirst();
+  ASSERT_TRUE(iter->Next());
+  const xgboost::ColBatch& batch = iter->Value();
+  // sorted by value
+  xgboost::ColBatch::Inst col = batch[2];
+  ASSERT_EQ(col.length, 5);
+  EXPECT_EQ(col[0].index, 1);
+  EXPECT_EQ(col[1].index, 4);
+  EXPECT_EQ(col[4].fvalue, 9);
+  EXPECT_FALSE(iter->Next());
+
+  const int bad_types[3] = {xgboost::kFloat32, 7, xgboost::kUInt32};
+  EXPECT_ANY_THROW(xgboost::data::ColumnarSource(t.columns, bad_types, nullptr,
+                                                 nullptr, 3, 5));
+}
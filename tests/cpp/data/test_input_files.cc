@@ -0,0 +1,58 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include <unistd.h>
+#include "../../../src/data/input_files.h"
+
+#include "../helpers.h"
+
+namespace {
+void WriteFile(const std::string& fname, const std::string& content) {
+  std::ofstream fo(fname);
+  fo << content;
+}
+}  // namespace
+
+TEST(InputFiles, LoadDirectory) {
+  std::string dir = TempFileName();
+  ASSERT_EQ(mkdir(dir.c_str(), 0700), 0);
+  // listed by name, so part-0 comes first
+  WriteFile(dir + "/part-1", "1 0:1 5:2\n0 1:3\n");
+  WriteFile(dir + "/part-1.group", "2\n");
+  WriteFile(dir + "/part-0", "0 0:0 1:10 2:20\n1 0:0 3:30\n1 2:5\n");
+  WriteFile(dir + "/part-0.group", "1\n2\n");
+  WriteFile(dir + "/.hidden", "not a data file");
+
+  std::vector<std::string> files = xgboost::data::ListInputFiles(dir);
+  ASSERT_EQ(files.size(), 2);
+  EXPECT_EQ(files[0], dir + "/part-0");
+  EXPECT_EQ(files[1], dir + "/part-1");
+  EXPECT_EQ(xgboost::data::ListInputFiles(dir + "/part-*"), files);
+  EXPECT_FALSE(xgboost::data::IsMultiFilePath(files[0]));
+
+  std::unique_ptr<xgboost::DMatrix> dmat(xgboost::DMatrix::Load(dir, true, false));
+  const xgboost::MetaInfo& info = dmat->info();
+  EXPECT_EQ(info.num_row, 5);
+  EXPECT_EQ(info.num_col, 6);
+  EXPECT_EQ(info.num_nonzero, 9);
+  EXPECT_EQ(info.labels, std::vector<float>({0.0f, 1.0f, 1.0f, 1.0f, 0.0f}));
+  EXPECT_EQ(info.group_ptr, std::vector<unsigned>({0, 1, 3, 5}));
+
+  dmlc::DataIter<xgboost::RowBatch>* iter = dmat->RowIterator();
+  iter->BeforeFirst();
+  ASSERT_TRUE(iter->Next());
+  const xgboost::RowBatch& batch = iter->Value();
+  EXPECT_EQ(batch[2].length, 1);
+  EXPECT_EQ(batch[2][0].fvalue, 5.0f);
+  EXPECT_EQ(batch[3].length, 2);
+  EXPECT_EQ(batch[3][1].index, 5);
+  EXPECT_EQ(batch[4][0].fvalue, 3.0f);
+
+  // the groups must be given for all the files or for none
+  std::remove((dir + "/part-1.group").c_str());
+  EXPECT_THROW(xgboost::DMatrix::Load(dir, true, false), dmlc::Error);
+
+  for (const char* name : {"/part-0", "/part-0.group", "/part-1", "/.hidden"}) {
+    std::remove((dir + name).c_str());
+  }
+  rmdir(dir.c_str());
+}
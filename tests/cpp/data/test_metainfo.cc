@@ -61,3 +61,33 @@ TEST(MetaInfo, SaveLoadBinary) {
 
   std::remove(tmp_file.c_str());
 }
+
+TEST(MetaInfo, Append) {
+  xgboost::MetaInfo info, other;
+  info.num_row = 2;
+  info.num_col = 3;
+  info.labels = {1.0f, 2.0f};
+  info.weights = {0.5f, 0.5f};
+  info.group_ptr = {0, 2};
+  other.num_row = 3;
+  other.num_col = 5;
+  other.labels = {3.0f, 4.0f, 5.0f};
+  other.root_index = {1, 1, 2};
+  other.group_ptr = {0, 1, 3};
+
+  info.Append(other);
+  EXPECT_EQ(info.num_row, 5);
+  EXPECT_EQ(info.num_col, 5);
+  ASSERT_EQ(info.labels.size(), 5);
+  EXPECT_EQ(info.labels[4], 5.0f);
+  // the missing weights and root indices take their default value
+  ASSERT_EQ(info.weights.size(), 5);
+  EXPECT_EQ(info.weights[1], 0.5f);
+  EXPECT_EQ(info.weights[2], 1.0f);
+  ASSERT_EQ(info.root_index.size(), 5);
+  EXPECT_EQ(info.root_index[1], 0);
+  EXPECT_EQ(info.root_index[4], 2);
+  ASSERT_EQ(info.group_ptr.size(), 4);
+  EXPECT_EQ(info.group_ptr[2], 3);
+  EXPECT_EQ(info.group_ptr[3], 5);
+}
@@ -0,0 +1,49 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include "../../../src/data/mmap_csr_source.h"
+
+#include "../helpers.h"
+
+TEST(MmapCSRSource, SaveLoadBinary) {
+  std::string tmp_file = CreateSimpleTestData();
+  xgboost::DMatrix * dmat = xgboost::DMatrix::Load(tmp_file, true, false);
+  std::remove(tmp_file.c_str());
+  dmat->info().weights = {0.5f, 2.0f};
+  dmat->info().group_ptr = {0, 2};
+
+  std::string tmp_binfile = TempFileName();
+  dmat->SaveToLocalFile(tmp_binfile, true);
+  xgboost::DMatrix * dmat_read = xgboost::DMatrix::Load(tmp_binfile, true, false);
+
+  EXPECT_EQ(dmat->info().num_col, dmat_read->info().num_col);
+  EXPECT_EQ(dmat->info().num_row, dmat_read->info().num_row);
+  EXPECT_EQ(dmat->info().num_nonzero, dmat_read->info().num_nonzero);
+  EXPECT_EQ(dmat->info().labels, dmat_read->info().labels);
+  EXPECT_EQ(dmat->info().weights, dmat_read->info().weights);
+  EXPECT_EQ(dmat->info().group_ptr, dmat_read->info().group_ptr);
+
+  dmlc::DataIter<xgboost::RowBatch> * row_iter = dmat->RowIterator();
+  dmlc::DataIter<xgboost::RowBatch> * row_iter_read = dmat_read->RowIterator();
+  row_iter->BeforeFirst(); row_iter->Next();
+  row_iter_read->BeforeFirst(); row_iter_read->Next();
+  const xgboost::RowBatch& batch = row_iter->Value();
+  const xgboost::RowBatch& batch_read = row_iter_read->Value();
+  ASSERT_EQ(batch.size, batch_read.size);
+  // the rows are read in place, on page boundaries of the file
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(batch_read.data_ptr) %
+            xgboost::data::MmapCSRSource::kPageAlign, 0);
+  for (size_t i = 0; i < batch.size; ++i) {
+    xgboost::SparseBatch::Inst row = batch[i];
+    xgboost::SparseBatch::Inst row_read = batch_read[i];
+    ASSERT_EQ(row.length, row_read.length);
+    for (size_t j = 0; j < row.length; ++j) {
+      EXPECT_EQ(row[j].index, row_read[j].index);
+      EXPECT_EQ(row[j].fvalue, row_read[j].fvalue);
+    }
+  }
+  EXPECT_FALSE(row_iter_read->Next());
+
+  delete dmat;
+  delete dmat_read;
+  std::remove(tmp_binfile.c_str());
+}
@@ -0,0 +1,72 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include "../../../src/data/page_prefetcher.h"
+#include "../../../src/common/timer.h"
+
+#include "../helpers.h"
+
+namespace {
+// shards of which the i-th page holds the single entry (shard, i)
+std::vector<xgboost::data::PagePrefetcher::Shard> MakeShards(
+    std::vector<int>* pos, int npages) {
+  std::vector<xgboost::data::PagePrefetcher::Shard> shards(pos->size());
+  for (size_t s = 0; s < pos->size(); ++s) {
+    int* p = &(*pos)[s];
+    shards[s].read = [p, s, npages](xgboost::data::SparsePage* page) {
+      if (*p == npages) return false;
+      page->Clear();
+      page->data.push_back(xgboost::SparseBatch::Entry(
+          static_cast<xgboost::bst_uint>(s), static_cast<xgboost::bst_float>(*p)));
+      page->offset.push_back(1);
+      ++(*p);
+      return true;
+    };
+    shards[s].before_first = [p]() { *p = 0; };
+  }
+  return shards;
+}
+}  // namespace
+
+TEST(PagePrefetcher, ClockOrder) {
+  xgboost::common::Profiler::Get()->Clear();
+  std::vector<int> pos(2, 0);
+  xgboost::data::PagePrefetcher prefetcher(MakeShards(&pos, 3), "test");
+  for (int pass = 0; pass < 3; ++pass) {
+    xgboost::data::SparsePage* page = nullptr;
+    int count = 0;
+    while (prefetcher.Next(&page)) {
+      ASSERT_EQ(page->data.size(), 1);
+      EXPECT_EQ(page->data[0].index, count % 2);
+      EXPECT_EQ(page->data[0].fvalue, count / 2);
+      prefetcher.Recycle(&page);
+      EXPECT_EQ(page, nullptr);
+      ++count;
+    }
+    EXPECT_EQ(count, 6);
+    EXPECT_GE(prefetcher.Depth(), xgboost::data::PagePrefetcher::kMinDepth);
+    EXPECT_LE(prefetcher.Depth(), 8);
+    prefetcher.BeforeFirst();
+  }
+  std::string profile = xgboost::common::Profiler::Get()->ToJSON();
+  EXPECT_NE(profile.find("\"test.pages\": 18"), std::string::npos);
+  EXPECT_NE(profile.find("test.read"), std::string::npos);
+}
+
+TEST(PagePrefetcher, BeforeFirstMidPass) {
+  std::vector<int> pos(3, 0);
+  xgboost::data::PagePrefetcher prefetcher(MakeShards(&pos, 4), "test");
+  xgboost::data::SparsePage* page = nullptr;
+  ASSERT_TRUE(prefetcher.Next(&page));
+  ASSERT_TRUE(prefetcher.Next(&page));
+  EXPECT_EQ(page->data[0].index, 1);
+  prefetcher.Recycle(&page);
+  prefetcher.BeforeFirst();
+  int count = 0;
+  while (prefetcher.Next(&page)) {
+    EXPECT_EQ(page->data[0].index, count % 3);
+    EXPECT_EQ(page->data[0].fvalue, count / 3);
+    prefetcher.Recycle(&page);
+    ++count;
+  }
+  EXPECT_EQ(count, 12);
+}
@@ -0,0 +1,104 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include <cmath>
+#include "../../../src/data/parallel_text_parser.h"
+
+#include "../helpers.h"
+
+namespace {
+std::string WriteTestFile(const std::string& content) {
+  std::string tmp_file = TempFileName();
+  std::ofstream fo(tmp_file);
+  fo << content;
+  return tmp_file;
+}
+
+// all the rows of the parser, the entries as index, value pairs
+struct ParsedRows {
+  std::vector<float> labels;
+  std::vector<float> weights;
+  std::vector<std::vector<std::pair<uint32_t, float> > > rows;
+};
+
+ParsedRows ReadAll(dmlc::Parser<uint32_t>* parser) {
+  ParsedRows out;
+  parser->BeforeFirst();
+  while (parser->Next()) {
+    const dmlc::RowBlock<uint32_t>& batch = parser->Value();
+    for (size_t i = 0; i < batch.size; ++i) {
+      dmlc::Row<uint32_t> row = batch[i];
+      out.labels.push_back(row.get_label());
+      out.weights.push_back(row.get_weight());
+      out.rows.emplace_back();
+      for (size_t j = 0; j < row.length; ++j) {
+        out.rows.back().emplace_back(row.get_index(j), row.get_value(j));
+      }
+    }
+  }
+  return out;
+}
+}  // namespace
+
+TEST(ParallelTextParser, LibSVM) {
+  std::string tmp_file = WriteTestFile(
+      "1 0:1.5 3:-2e-1\n"
+      "\n"
+      "0:2 qid:3 1 2:nan 10:+.25\r\n"
+      "  1e1   4:12345678901234567890 \n"
+      "2 7:3.0e2");
+  for (const char* args : {"?format=fast_libsvm&nthread=3",
+                           "?format=fast_libsvm&nthread=2&chunk_size=8"}) {
+    std::unique_ptr<dmlc::Parser<uint32_t> > parser(
+        dmlc::Parser<uint32_t>::Create((tmp_file + args).c_str(), 0, 1, "auto"));
+    ParsedRows parsed = ReadAll(parser.get());
+    ASSERT_EQ(parsed.rows.size(), 4);
+    EXPECT_EQ(parsed.labels, std::vector<float>({1, 0, 10, 2}));
+    EXPECT_EQ(parsed.weights, std::vector<float>({1, 2, 1, 1}));
+    ASSERT_EQ(parsed.rows[0].size(), 2);
+    EXPECT_EQ(parsed.rows[0][1].first, 3);
+    EXPECT_FLOAT_EQ(parsed.rows[0][1].second, -0.2f);
+    ASSERT_EQ(parsed.rows[1].size(), 3);
+    EXPECT_EQ(parsed.rows[1][0].first, 1);
+    EXPECT_EQ(parsed.rows[1][0].second, 1.0f);
+    EXPECT_TRUE(std::isnan(parsed.rows[1][1].second));
+    EXPECT_EQ(parsed.rows[1][2].first, 10);
+    EXPECT_EQ(parsed.rows[1][2].second, 0.25f);
+    ASSERT_EQ(parsed.rows[2].size(), 1);
+    EXPECT_FLOAT_EQ(parsed.rows[2][0].second, 12345678901234567890.0f);
+    ASSERT_EQ(parsed.rows[3].size(), 1);
+    EXPECT_EQ(parsed.rows[3][0].second, 300.0f);
+    // a second pass gives the same rows
+    EXPECT_EQ(ReadAll(parser.get()).rows.size(), 4);
+  }
+
+  std::unique_ptr<xgboost::DMatrix> dmat(xgboost::DMatrix::Load(
+      tmp_file + "?format=fast_libsvm", true, false));
+  EXPECT_EQ(dmat->info().num_row, 4);
+  EXPECT_EQ(dmat->info().num_col, 11);
+  EXPECT_EQ(dmat->info().num_nonzero, 7);
+  std::remove(tmp_file.c_str());
+
+  tmp_file = WriteTestFile("1 0:1\n1 x:1\n");
+  std::unique_ptr<dmlc::Parser<uint32_t> > parser(dmlc::Parser<uint32_t>::Create(
+      (tmp_file + "?format=fast_libsvm").c_str(), 0, 1, "auto"));
+  EXPECT_ANY_THROW(parser->Next());
+  std::remove(tmp_file.c_str());
+}
+
+TEST(ParallelTextParser, CSV) {
+  std::string tmp_file = WriteTestFile("1,0.5,2\n0,,-3\n\n1,4,5e-1\n");
+  std::unique_ptr<dmlc::Parser<uint32_t> > parser(dmlc::Parser<uint32_t>::Create(
+      (tmp_file + "?format=fast_csv&label_column=0&nthread=2").c_str(), 0, 1, "auto"));
+  ParsedRows parsed = ReadAll(parser.get());
+  ASSERT_EQ(parsed.rows.size(), 3);
+  EXPECT_EQ(parsed.labels, std::vector<float>({1, 0, 1}));
+  for (const auto& row : parsed.rows) {
+    ASSERT_EQ(row.size(), 2);
+    EXPECT_EQ(row[1].first, 1);
+  }
+  EXPECT_EQ(parsed.rows[0][0].second, 0.5f);
+  EXPECT_EQ(parsed.rows[1][0].second, 0.0f);
+  EXPECT_EQ(parsed.rows[1][1].second, -3.0f);
+  EXPECT_EQ(parsed.rows[2][1].second, 0.5f);
+  std::remove(tmp_file.c_str());
+}
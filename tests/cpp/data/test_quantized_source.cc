@@ -0,0 +1,100 @@
+// Copyright by Contributors
+#include <dmlc/data.h>
+#include <xgboost/data.h>
+#include <algorithm>
+#include "../../../src/data/quantized_source.h"
+
+#include "../helpers.h"
+
+namespace {
+// parser over CSR blocks held in memory
+class BlockParser : public dmlc::Parser<uint32_t> {
+ public:
+  BlockParser(const std::vector<dmlc::RowBlock<uint32_t> >& blocks)
+      : blocks_(blocks), pos_(0), num_reset_(0) {}
+  void BeforeFirst() override {
+    pos_ = 0;
+    ++num_reset_;
+  }
+  bool Next() override {
+    return pos_++ < blocks_.size();
+  }
+  const dmlc::RowBlock<uint32_t>& Value() const override {
+    return blocks_[pos_ - 1];
+  }
+  size_t BytesRead() const override {
+    return 0;
+  }
+  size_t num_reset() const {
+    return num_reset_;
+  }
+
+ private:
+  std::vector<dmlc::RowBlock<uint32_t> > blocks_;
+  size_t pos_;
+  size_t num_reset_;
+};
+}  // namespace
+
+TEST(QuantizedSource, Basic) {
+  // two blocks of 10 rows over 3 features, the third is missing in odd rows
+  std::vector<size_t> offset[2];
+  std::vector<uint32_t> index[2];
+  std::vector<float> value[2], label[2];
+  std::vector<dmlc::RowBlock<uint32_t> > blocks(2);
+  for (int b = 0; b < 2; ++b) {
+    offset[b].push_back(0);
+    for (int i = 0; i < 10; ++i) {
+      const int row = b * 10 + i;
+      for (uint32_t fid = 0; fid < 3; ++fid) {
+        if (fid == 2 && row % 2 == 1) continue;
+        index[b].push_back(fid);
+        value[b].push_back(static_cast<float>((row * (fid + 3)) % 7));
+      }
+      offset[b].push_back(index[b].size());
+      label[b].push_back(static_cast<float>(row));
+    }
+    blocks[b].size = 10;
+    blocks[b].offset = offset[b].data();
+    blocks[b].label = label[b].data();
+    blocks[b].index = index[b].data();
+    blocks[b].value = value[b].data();
+  }
+  BlockParser parser(blocks);
+  xgboost::data::QuantizedSource source(&parser, 4, 8);
+  EXPECT_EQ(parser.num_reset(), 2);
+  EXPECT_EQ(source.info.num_row, 20);
+  EXPECT_EQ(source.info.num_col, 3);
+  EXPECT_EQ(source.info.num_nonzero, 50);
+  ASSERT_EQ(source.info.labels.size(), 20);
+  EXPECT_EQ(source.info.labels[13], 13.0f);
+  EXPECT_EQ(source.gmat.row_ptr.size(), 21);
+
+  // every value falls back into the bin of the value it replaces
+  const xgboost::common::HistCutMatrix& cut = source.cut;
+  auto bin_of = [&cut](uint32_t fid, float v) {
+    auto cbegin = cut.cut.begin() + cut.row_ptr[fid];
+    auto cend = cut.cut.begin() + cut.row_ptr[fid + 1];
+    auto it = std::upper_bound(cbegin, cend, v);
+    if (it == cend) it = cend - 1;
+    return it - cut.cut.begin();
+  };
+  size_t nbatch = 0, row = 0;
+  source.BeforeFirst();
+  while (source.Next()) {
+    const xgboost::RowBatch& batch = source.Value();
+    EXPECT_EQ(batch.base_rowid, row);
+    for (size_t i = 0; i < batch.size; ++i, ++row) {
+      xgboost::RowBatch::Inst inst = batch[i];
+      ASSERT_EQ(inst.length, row % 2 == 1 ? 2 : 3);
+      for (size_t j = 0; j < inst.length; ++j) {
+        EXPECT_EQ(inst[j].index, j);
+        const float original = value[row / 10][offset[row / 10][row % 10] + j];
+        EXPECT_EQ(bin_of(inst[j].index, inst[j].fvalue), bin_of(inst[j].index, original));
+      }
+    }
+    ++nbatch;
+  }
+  EXPECT_EQ(nbatch, 3);
+  EXPECT_EQ(row, 20);
+}
@@ -0,0 +1,47 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include "../../../src/data/row_batch_source.h"
+
+#include "../helpers.h"
+
+TEST(RowBatchSource, SlicePages) {
+  std::string tmp_file = CreateSimpleTestData();
+  std::unique_ptr<xgboost::DMatrix> dmat(xgboost::DMatrix::Load(
+    tmp_file + "#" + tmp_file + ".cache", true, false));
+  std::remove(tmp_file.c_str());
+  dmat->info().base_margin = {0.5f, 1.5f};
+
+  dmlc::DataIter<xgboost::RowBatch> * row_iter = dmat->RowIterator();
+  row_iter->BeforeFirst();
+  size_t row_count = 0;
+  while (row_iter->Next()) {
+    const xgboost::RowBatch& batch = row_iter->Value();
+    std::unique_ptr<xgboost::DataSource> source(
+        new xgboost::data::RowBatchSource(batch, dmat->info()));
+    std::unique_ptr<xgboost::DMatrix> dpage(
+        xgboost::DMatrix::Create(std::move(source)));
+    EXPECT_EQ(dpage->info().num_row, batch.size);
+    EXPECT_EQ(dpage->info().num_col, dmat->info().num_col);
+    ASSERT_EQ(dpage->info().base_margin.size(), batch.size);
+    for (size_t i = 0; i < batch.size; ++i) {
+      EXPECT_EQ(dpage->info().base_margin[i],
+                dmat->info().base_margin[batch.base_rowid + i]);
+    }
+    // the page is a view with row ids starting at 0
+    dmlc::DataIter<xgboost::RowBatch> * page_iter = dpage->RowIterator();
+    size_t npage = 0;
+    while (page_iter->Next()) {
+      EXPECT_EQ(page_iter->Value().base_rowid, 0);
+      EXPECT_EQ(page_iter->Value().size, batch.size);
+      EXPECT_EQ(page_iter->Value()[0].data, batch[0].data);
+      ++npage;
+    }
+    EXPECT_EQ(npage, 1);
+    row_count += batch.size;
+  }
+  EXPECT_EQ(row_count, dmat->info().num_row);
+
+  // Clean up of external memory files
+  std::remove((tmp_file + ".cache").c_str());
+  std::remove((tmp_file + ".cache.row.page").c_str());
+}
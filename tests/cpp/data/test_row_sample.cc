@@ -0,0 +1,89 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include <algorithm>
+#include <vector>
+#include "../../../src/data/row_sample.h"
+
+#include "../helpers.h"
+
+TEST(RowSample, Stratified) {
+  std::shared_ptr<xgboost::DMatrix> parent = CreateDMatrix(1000, 4, 0.3, 1);
+  xgboost::MetaInfo& info = parent->info();
+  // the weights tell the rows of the parent apart
+  for (size_t i = 0; i < 1000; ++i) {
+    info.labels.push_back(i % 10 == 0);
+    info.weights.push_back(i);
+  }
+  xgboost::data::RowSample sample;
+  xgboost::data::SampleRows(parent.get(), 200, true, 0, 10, &sample);
+  const xgboost::MetaInfo& sinfo = sample.dmat->info();
+  ASSERT_EQ(sinfo.num_row, 200);
+  ASSERT_EQ(sample.fold.size(), 200);
+  EXPECT_EQ(sample.source_rows, 1000);
+  EXPECT_EQ(std::count(sinfo.labels.begin(), sinfo.labels.end(), 1.0f), 20);
+  EXPECT_TRUE(std::is_sorted(sinfo.weights.begin(), sinfo.weights.end()));
+
+  // the rows are copies of the rows of the parent
+  dmlc::DataIter<xgboost::RowBatch>* piter = parent->RowIterator();
+  piter->BeforeFirst();
+  ASSERT_TRUE(piter->Next());
+  const xgboost::RowBatch& pbatch = piter->Value();
+  dmlc::DataIter<xgboost::RowBatch>* siter = sample.dmat->RowIterator();
+  siter->BeforeFirst();
+  ASSERT_TRUE(siter->Next());
+  const xgboost::RowBatch& sbatch = siter->Value();
+  ASSERT_EQ(sbatch.size, 200);
+  for (size_t i = 0; i < sbatch.size; ++i) {
+    const size_t r = static_cast<size_t>(sinfo.weights[i]);
+    EXPECT_EQ(sinfo.labels[i], info.labels[r]);
+    ASSERT_EQ(sbatch[i].length, pbatch[r].length);
+    for (size_t j = 0; j < sbatch[i].length; ++j) {
+      EXPECT_EQ(sbatch[i][j].fvalue, pbatch[r][j].fvalue);
+    }
+  }
+
+  // each fold gets the same number of rows of each label
+  std::vector<xgboost::bst_float> preds(400);
+  for (size_t i = 0; i < preds.size(); ++i) preds[i] = i;
+  xgboost::MetaInfo fold_info;
+  std::vector<xgboost::bst_float> fold_preds;
+  size_t nrow = 0;
+  for (unsigned k = 0; k < 10; ++k) {
+    xgboost::data::SelectFold(sample, k, preds, &fold_info, &fold_preds);
+    EXPECT_EQ(fold_info.num_row, 20);
+    EXPECT_EQ(std::count(fold_info.labels.begin(), fold_info.labels.end(), 1.0f), 2);
+    ASSERT_EQ(fold_preds.size(), 40);
+    nrow += fold_info.num_row;
+  }
+  EXPECT_EQ(nrow, 200);
+}
+
+TEST(RowSample, Groups) {
+  std::shared_ptr<xgboost::DMatrix> parent = CreateDMatrix(1000, 4, 0.3, 2);
+  xgboost::MetaInfo& info = parent->info();
+  for (size_t i = 0; i < 1000; ++i) {
+    info.labels.push_back(i % 3);
+  }
+  for (size_t g = 0; g <= 100; ++g) {
+    info.group_ptr.push_back(g * 10);
+  }
+  xgboost::data::RowSample sample;
+  xgboost::data::SampleRows(parent.get(), 200, true, 7, 4, &sample);
+  const xgboost::MetaInfo& sinfo = sample.dmat->info();
+  // whole groups are sampled, and dealt to the folds whole
+  ASSERT_EQ(sinfo.num_row, 200);
+  ASSERT_EQ(sinfo.group_ptr.size(), 21);
+  for (size_t g = 0; g + 1 < sinfo.group_ptr.size(); ++g) {
+    EXPECT_EQ(sinfo.group_ptr[g + 1] - sinfo.group_ptr[g], 10);
+    for (size_t r = sinfo.group_ptr[g]; r < sinfo.group_ptr[g + 1]; ++r) {
+      EXPECT_EQ(sample.fold[r], sample.fold[sinfo.group_ptr[g]]);
+    }
+  }
+  std::vector<xgboost::bst_float> preds(200, 0.5f);
+  xgboost::MetaInfo fold_info;
+  std::vector<xgboost::bst_float> fold_preds;
+  xgboost::data::SelectFold(sample, 1, preds, &fold_info, &fold_preds);
+  EXPECT_EQ(fold_info.num_row, 50);
+  EXPECT_EQ(fold_info.group_ptr.size(), 6);
+  EXPECT_EQ(fold_info.group_ptr.back(), 50);
+}
@@ -0,0 +1,102 @@
+// Copyright by Contributors
+#include <dmlc/io.h>
+#include <xgboost/data.h>
+#include <memory>
+#include "../../../src/data/sectioned_binary.h"
+
+#include "../helpers.h"
+
+TEST(SectionedBinary, SaveLoad) {
+  std::string tmp_file = CreateSimpleTestData();
+  std::unique_ptr<xgboost::DMatrix> dmat(xgboost::DMatrix::Load(tmp_file, true, false));
+  std::remove(tmp_file.c_str());
+  dmat->info().weights = {0.5f, 2.0f};
+  dmat->info().group_ptr = {0, 2};
+
+  std::string tmp_binfile = TempFileName();
+  dmat->SaveSectioned(tmp_binfile, true);
+  std::unique_ptr<xgboost::DMatrix> dmat_read(xgboost::DMatrix::Load(tmp_binfile, true, false));
+  EXPECT_EQ(dmat->info().num_col, dmat_read->info().num_col);
+  EXPECT_EQ(dmat->info().num_row, dmat_read->info().num_row);
+  EXPECT_EQ(dmat->info().num_nonzero, dmat_read->info().num_nonzero);
+  EXPECT_EQ(dmat->info().labels, dmat_read->info().labels);
+  EXPECT_EQ(dmat->info().weights, dmat_read->info().weights);
+  EXPECT_EQ(dmat->info().group_ptr, dmat_read->info().group_ptr);
+  EXPECT_EQ(dmat_read->info().base_margin.size(), 0);
+
+  dmlc::DataIter<xgboost::RowBatch>* row_iter = dmat->RowIterator();
+  dmlc::DataIter<xgboost::RowBatch>* row_iter_read = dmat_read->RowIterator();
+  row_iter->BeforeFirst(); row_iter->Next();
+  row_iter_read->BeforeFirst(); row_iter_read->Next();
+  const xgboost::RowBatch& batch = row_iter->Value();
+  const xgboost::RowBatch& batch_read = row_iter_read->Value();
+  ASSERT_EQ(batch.size, batch_read.size);
+  for (size_t i = 0; i < batch.size; ++i) {
+    xgboost::SparseBatch::Inst row = batch[i];
+    xgboost::SparseBatch::Inst row_read = batch_read[i];
+    ASSERT_EQ(row.length, row_read.length);
+    for (size_t j = 0; j < row.length; ++j) {
+      EXPECT_EQ(row[j].index, row_read[j].index);
+      EXPECT_EQ(row[j].fvalue, row_read[j].fvalue);
+    }
+  }
+  std::remove(tmp_binfile.c_str());
+}
+
+TEST(SectionedBinary, ChunksAndChecksums) {
+  using xgboost::data::SectionedBinary;
+  xgboost::data::SimpleCSRSource source;
+  const size_t nrow = 1000;
+  for (size_t i = 0; i < nrow; ++i) {
+    for (size_t j = 0; j < i % 9; ++j) {
+      source.row_data_.emplace_back(static_cast<xgboost::bst_uint>(j * 3),
+                                    static_cast<float>(i + j));
+    }
+    source.row_ptr_.push_back(source.row_data_.size());
+    source.info.labels.push_back(static_cast<float>(i % 2));
+  }
+  source.info.num_row = nrow;
+  source.info.num_col = 25;
+  source.info.num_nonzero = source.row_data_.size();
+
+  // small chunks so the sections are read in many pieces
+  std::string tmp_binfile = TempFileName();
+  {
+    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(tmp_binfile.c_str(), "w"));
+    SectionedBinary::Save(source, fo.get(), true, 100);
+  }
+  SectionedBinary file(tmp_binfile);
+  EXPECT_EQ(file.Length(SectionedBinary::kRowData), source.row_data_.size());
+  EXPECT_EQ(file.Length(SectionedBinary::kWeights), 0);
+  // a single section is read without the others
+  std::vector<float> labels;
+  file.Read(SectionedBinary::kLabels, &labels, 4);
+  EXPECT_EQ(labels, source.info.labels);
+  xgboost::data::SimpleCSRSource read;
+  file.ReadAll(&read, 4);
+  EXPECT_EQ(read.row_ptr_, source.row_ptr_);
+  ASSERT_EQ(read.row_data_.size(), source.row_data_.size());
+  for (size_t i = 0; i < read.row_data_.size(); ++i) {
+    EXPECT_EQ(read.row_data_[i].index, source.row_data_[i].index);
+    EXPECT_EQ(read.row_data_[i].fvalue, source.row_data_[i].fvalue);
+  }
+
+  // a flipped byte in the rows fails the checksum of its chunk
+  std::string content;
+  {
+    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(tmp_binfile.c_str(), "r"));
+    char buf[4096];
+    size_t n;
+    while ((n = fi->Read(buf, sizeof(buf))) != 0) content.append(buf, n);
+  }
+  content[content.size() - source.info.labels.size() * sizeof(float) - 10] ^= 1;
+  {
+    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(tmp_binfile.c_str(), "w"));
+    fo->Write(content.data(), content.size());
+  }
+  SectionedBinary corrupted(tmp_binfile);
+  EXPECT_THROW(corrupted.ReadAll(&read, 2), dmlc::Error);
+  corrupted.Read(SectionedBinary::kLabels, &labels, 2);
+  EXPECT_EQ(labels, source.info.labels);
+  std::remove(tmp_binfile.c_str());
+}
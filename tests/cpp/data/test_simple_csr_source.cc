@@ -30,3 +30,41 @@ TEST(SimpleCSRSource, SaveLoadBinary) {
   EXPECT_EQ(first_row[2].fvalue, first_row_read[2].fvalue);
   row_iter = nullptr; row_iter_read = nullptr;
 }
+
+TEST(SimpleCSRSource, PushBlocks) {
+  // two blocks of a parser, the second one with offsets not starting at 0
+  std::vector<size_t> offset0 = {0, 2, 3};
+  std::vector<uint32_t> index0 = {0, 3, 1};
+  std::vector<float> value0 = {1.0f, 2.0f, 3.0f};
+  std::vector<float> label0 = {0.0f, 1.0f};
+  std::vector<size_t> offset1 = {5, 6};
+  std::vector<uint32_t> index1 = {0, 0, 0, 0, 0, 5};
+  std::vector<float> value1 = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 4.0f};
+  std::vector<float> label1 = {1.0f};
+  dmlc::RowBlock<uint32_t> block0, block1;
+  block0.size = 2;
+  block0.offset = offset0.data();
+  block0.label = label0.data();
+  block0.weight = nullptr;
+  block0.qid = nullptr;
+  block0.field = nullptr;
+  block0.index = index0.data();
+  block0.value = value0.data();
+  block1 = block0;
+  block1.size = 1;
+  block1.offset = offset1.data();
+  block1.label = label1.data();
+  block1.index = index1.data();
+  block1.value = value1.data();
+
+  xgboost::data::SimpleCSRSource source;
+  source.Push(block0);
+  source.Push(block1);
+  EXPECT_EQ(source.info.num_row, 3);
+  EXPECT_EQ(source.info.num_col, 6);
+  EXPECT_EQ(source.info.num_nonzero, 4);
+  EXPECT_EQ(source.info.labels, std::vector<float>({0.0f, 1.0f, 1.0f}));
+  EXPECT_EQ(source.row_ptr_, std::vector<size_t>({0, 2, 3, 4}));
+  EXPECT_EQ(source.row_data_[3].index, 5);
+  EXPECT_EQ(source.row_data_[3].fvalue, 4.0f);
+}
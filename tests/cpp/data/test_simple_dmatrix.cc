@@ -1,6 +1,7 @@
 // Copyright by Contributors
 #include <xgboost/data.h>
 #include "../../../src/data/simple_dmatrix.h"
+#include "../../../src/data/simple_csr_source.h"
 
 #include "../helpers.h"
 
@@ -142,3 +143,111 @@ TEST(SimpleDMatrix, ColAccessWithBatches) {
   }
   sub_col_iter = nullptr;
 }
+
+TEST(SimpleDMatrix, Append) {
+  std::string tmp_file = CreateSimpleTestData();
+  std::unique_ptr<xgboost::DMatrix> dmat(xgboost::DMatrix::Load(tmp_file, true, false));
+  std::remove(tmp_file.c_str());
+  const std::vector<bool> enable(dmat->info().num_col, true);
+  dmat->InitColAccess(enable, 1, dmat->info().num_row, true);
+
+  // two rows with a new feature, 0:-1 sorts before the previous values
+  std::unique_ptr<xgboost::data::SimpleCSRSource> source(
+      new xgboost::data::SimpleCSRSource());
+  source->row_data_ = {{0, -1.0f}, {5, 50.0f}, {0, 5.0f}, {2, 10.0f}};
+  source->row_ptr_ = {0, 2, 4};
+  source->info.num_row = 2;
+  source->info.num_col = 6;
+  source->info.num_nonzero = 4;
+  source->info.labels = {0.0f, 1.0f};
+  std::unique_ptr<xgboost::DMatrix> other(xgboost::DMatrix::Create(std::move(source)));
+  dmat->Append(other.get());
+
+  EXPECT_EQ(dmat->info().num_row, 4);
+  EXPECT_EQ(dmat->info().num_col, 6);
+  EXPECT_EQ(dmat->info().num_nonzero, 10);
+  EXPECT_EQ(dmat->info().labels.size(), 4);
+  EXPECT_EQ(dmat->buffered_rowset().size(), 4);
+  ASSERT_TRUE(dmat->HaveColAccess(true));
+  ASSERT_TRUE(dmat->SingleColBlock());
+  EXPECT_EQ(dmat->GetColSize(0), 4);
+  EXPECT_EQ(dmat->GetColSize(1), 1);
+  EXPECT_EQ(dmat->GetColSize(2), 2);
+  EXPECT_EQ(dmat->GetColSize(5), 1);
+
+  dmlc::DataIter<xgboost::ColBatch>* col_iter = dmat->ColIterator();
+  col_iter->BeforeFirst();
+  ASSERT_TRUE(col_iter->Next());
+  const xgboost::ColBatch& batch = col_iter->Value();
+  ASSERT_EQ(batch.size, 6);
+  for (size_t i = 0; i < batch.size; ++i) {
+    EXPECT_EQ(batch[i].length, dmat->GetColSize(i));
+    for (size_t j = 1; j < batch[i].length; ++j) {
+      EXPECT_LE(batch[i][j - 1].fvalue, batch[i][j].fvalue);
+    }
+  }
+  EXPECT_EQ(batch[0][0].index, 2);
+  EXPECT_EQ(batch[0][3].index, 3);
+  EXPECT_EQ(batch[2][0].index, 3);
+  EXPECT_EQ(batch[5][0].index, 2);
+  EXPECT_FALSE(col_iter->Next());
+
+  // the rows are appended too
+  dmlc::DataIter<xgboost::RowBatch>* row_iter = dmat->RowIterator();
+  row_iter->BeforeFirst();
+  ASSERT_TRUE(row_iter->Next());
+  ASSERT_EQ(row_iter->Value().size, 4);
+  EXPECT_EQ(row_iter->Value()[3][1].fvalue, 10.0f);
+}
+
+TEST(SimpleDMatrix, ColAccessWide) {
+  // wide enough for the rows to be transposed a block of columns at a time
+  const size_t nrow = 3000, ncol = 5000;
+  std::unique_ptr<xgboost::data::SimpleCSRSource> source(
+      new xgboost::data::SimpleCSRSource());
+  for (size_t i = 0; i < nrow; ++i) {
+    for (size_t j = i % 7; j < ncol; j += 1 + (i % 5) * 400) {
+      source->row_data_.emplace_back(static_cast<xgboost::bst_uint>(j),
+                                     static_cast<float>((i * 31 + j) % 97));
+    }
+    source->row_ptr_.push_back(source->row_data_.size());
+  }
+  source->info.num_row = nrow;
+  source->info.num_col = ncol;
+  source->info.num_nonzero = source->row_data_.size();
+  std::vector<size_t> col_size(ncol, 0);
+  for (const auto& e : source->row_data_) ++col_size[e.index];
+  std::unique_ptr<xgboost::DMatrix> dmat(xgboost::DMatrix::Create(std::move(source)));
+
+  const std::vector<bool> enable(ncol, true);
+  dmat->InitColAccess(enable, 1, nrow + 1, false);
+  dmlc::DataIter<xgboost::ColBatch>* col_iter = dmat->ColIterator();
+  col_iter->BeforeFirst();
+  ASSERT_TRUE(col_iter->Next());
+  const xgboost::ColBatch& batch = col_iter->Value();
+  for (size_t j = 0; j < ncol; ++j) {
+    ASSERT_EQ(batch[j].length, col_size[j]);
+    for (size_t k = 1; k < batch[j].length; ++k) {
+      // the rows of a column keep their order
+      ASSERT_LT(batch[j][k - 1].index, batch[j][k].index);
+    }
+    for (size_t k = 0; k < batch[j].length; ++k) {
+      const size_t i = batch[j][k].index;
+      ASSERT_EQ(batch[j][k].fvalue, static_cast<float>((i * 31 + j) % 97));
+    }
+  }
+
+  // sorting the columns built before
+  dmat->InitColAccess(enable, 1, nrow + 1, true);
+  ASSERT_TRUE(dmat->HaveColAccess(true));
+  ASSERT_TRUE(dmat->HaveColAccess(false));
+  col_iter = dmat->ColIterator();
+  col_iter->BeforeFirst();
+  ASSERT_TRUE(col_iter->Next());
+  for (size_t j = 0; j < ncol; ++j) {
+    ASSERT_EQ(col_iter->Value()[j].length, col_size[j]);
+    for (size_t k = 1; k < col_iter->Value()[j].length; ++k) {
+      ASSERT_LE(col_iter->Value()[j][k - 1].fvalue, col_iter->Value()[j][k].fvalue);
+    }
+  }
+}
@@ -0,0 +1,89 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include "../../../src/data/slice_source.h"
+
+#include "../helpers.h"
+
+namespace {
+// the rows of a row iterator, gathered over all its batches
+std::vector<std::vector<xgboost::SparseBatch::Entry> > ReadRows(
+    dmlc::DataIter<xgboost::RowBatch>* iter) {
+  std::vector<std::vector<xgboost::SparseBatch::Entry> > rows;
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const xgboost::RowBatch& batch = iter->Value();
+    EXPECT_EQ(batch.base_rowid, rows.size());
+    for (size_t i = 0; i < batch.size; ++i) {
+      xgboost::SparseBatch::Inst inst = batch[i];
+      rows.emplace_back(inst.data, inst.data + inst.length);
+    }
+  }
+  return rows;
+}
+}  // namespace
+
+TEST(SliceSource, Rows) {
+  std::shared_ptr<xgboost::DMatrix> parent = CreateDMatrix(20, 4, 0.3, 1);
+  xgboost::MetaInfo& info = parent->info();
+  for (size_t i = 0; i < 20; ++i) {
+    info.labels.push_back(i);
+    info.weights.push_back(i * 2);
+    // two margins per row
+    info.base_margin.push_back(i * 3);
+    info.base_margin.push_back(i * 3 + 1);
+  }
+  info.group_ptr = {0, 5, 12, 20};
+  auto parent_rows = ReadRows(parent->RowIterator());
+
+  std::vector<xgboost::bst_uint> ridx = {13, 2, 7, 7, 19, 0, 4};
+  xgboost::data::SliceSource source(parent, ridx, 3);
+  EXPECT_EQ(source.info.num_row, ridx.size());
+  EXPECT_EQ(source.info.num_col, 4);
+  auto rows = ReadRows(&source);
+  ASSERT_EQ(rows.size(), ridx.size());
+  size_t nonzero = 0;
+  for (size_t i = 0; i < ridx.size(); ++i) {
+    ASSERT_EQ(rows[i].size(), parent_rows[ridx[i]].size());
+    for (size_t j = 0; j < rows[i].size(); ++j) {
+      EXPECT_EQ(rows[i][j].index, parent_rows[ridx[i]][j].index);
+      EXPECT_EQ(rows[i][j].fvalue, parent_rows[ridx[i]][j].fvalue);
+    }
+    nonzero += rows[i].size();
+    EXPECT_EQ(source.info.labels[i], ridx[i]);
+    EXPECT_EQ(source.info.weights[i], ridx[i] * 2);
+    EXPECT_EQ(source.info.base_margin[i * 2 + 1], ridx[i] * 3 + 1);
+  }
+  EXPECT_EQ(source.info.num_nonzero, nonzero);
+  // rows 13 | 2 | 7 7 | 19 | 0 4 by the groups of the parent
+  std::vector<xgboost::bst_uint> group_ptr = {0, 1, 2, 4, 5, 7};
+  EXPECT_EQ(source.info.group_ptr, group_ptr);
+  // a second pass over the rows gives the same batches
+  EXPECT_EQ(ReadRows(&source).size(), ridx.size());
+
+  EXPECT_ANY_THROW(xgboost::data::SliceSource(parent, {20}));
+}
+
+TEST(SliceSource, SparsePageDMatrix) {
+  std::string tmp_file = CreateSimpleTestData();
+  std::shared_ptr<xgboost::DMatrix> parent(xgboost::DMatrix::Load(
+      tmp_file + "#" + tmp_file + ".cache", true, false));
+  std::remove(tmp_file.c_str());
+
+  std::unique_ptr<xgboost::data::SliceSource> source(
+      new xgboost::data::SliceSource(parent, {1, 0, 1}));
+  std::unique_ptr<xgboost::DMatrix> dmat(
+      xgboost::DMatrix::Create(std::move(source)));
+  EXPECT_EQ(dmat->info().num_row, 3);
+  EXPECT_EQ(dmat->info().num_nonzero, 9);
+  EXPECT_EQ(dmat->info().labels[0], 1);
+  auto rows = ReadRows(dmat->RowIterator());
+  ASSERT_EQ(rows.size(), 3);
+  EXPECT_EQ(rows[0][1].index, 3);
+  EXPECT_EQ(rows[1][1].index, 1);
+  EXPECT_EQ(rows[2][2].fvalue, 40);
+
+  dmat.reset();
+  parent.reset();
+  std::remove((tmp_file + ".cache").c_str());
+  std::remove((tmp_file + ".cache.row.page").c_str());
+}
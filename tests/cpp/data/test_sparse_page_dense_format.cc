@@ -0,0 +1,100 @@
+// Copyright by Contributors
+#include <dmlc/io.h>
+#include <xgboost/data.h>
+#include "../../../src/data/sparse_batch_page.h"
+
+#include "../helpers.h"
+
+namespace {
+// write the pages with the dense format and check that they read back equal.
+void CheckRoundTrip(const std::vector<xgboost::data::SparsePage>& pages) {
+  using xgboost::data::SparsePage;
+  std::string tmp_file = TempFileName();
+  {
+    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(tmp_file.c_str(), "w"));
+    std::unique_ptr<SparsePage::Format> fmt(SparsePage::Format::Create("dense"));
+    for (const SparsePage& page : pages) fmt->Write(page, fo.get());
+  }
+  std::unique_ptr<dmlc::SeekStream> fi(dmlc::SeekStream::CreateForRead(tmp_file.c_str()));
+  std::unique_ptr<SparsePage::Format> fmt(SparsePage::Format::Create("dense"));
+  SparsePage page;
+  for (const SparsePage& expected : pages) {
+    ASSERT_TRUE(fmt->Read(&page, fi.get()));
+    ASSERT_EQ(page.offset, expected.offset);
+    for (size_t i = 0; i < expected.data.size(); ++i) {
+      EXPECT_EQ(page.data[i].index, expected.data[i].index);
+      EXPECT_EQ(page.data[i].fvalue, expected.data[i].fvalue);
+    }
+  }
+  EXPECT_FALSE(fmt->Read(&page, fi.get()));
+
+  // read a subset of the segments of the first page
+  fi->Seek(0);
+  std::vector<xgboost::bst_uint> index_set = {0, 2};
+  ASSERT_TRUE(fmt->Read(&page, fi.get(), index_set));
+  const SparsePage& first = pages[0];
+  ASSERT_EQ(page.offset.size(), 3);
+  for (size_t i = 0; i < index_set.size(); ++i) {
+    size_t begin = first.offset[index_set[i]];
+    ASSERT_EQ(page.offset[i + 1] - page.offset[i],
+              first.offset[index_set[i] + 1] - begin);
+    for (size_t j = page.offset[i]; j < page.offset[i + 1]; ++j) {
+      EXPECT_EQ(page.data[j].index, first.data[begin + j - page.offset[i]].index);
+    }
+  }
+  std::remove(tmp_file.c_str());
+}
+
+// a page of nrow rows over the features [1, 1 + ncol), keep(i, j) tells
+// whether the entry is present.
+template<typename Func>
+xgboost::data::SparsePage MakePage(size_t nrow, size_t ncol, Func keep) {
+  xgboost::data::SparsePage page;
+  page.Clear();
+  for (size_t i = 0; i < nrow; ++i) {
+    for (size_t j = 0; j < ncol; ++j) {
+      if (keep(i, j)) {
+        page.data.push_back(xgboost::SparseBatch::Entry(
+            static_cast<xgboost::bst_uint>(j + 1), static_cast<float>(i * ncol + j)));
+      }
+    }
+    page.offset.push_back(page.data.size());
+  }
+  return page;
+}
+}  // namespace
+
+TEST(SparsePageDenseFormat, RoundTrip) {
+  std::vector<xgboost::data::SparsePage> pages;
+  // dense
+  pages.push_back(MakePage(4, 5, [](size_t i, size_t j) { return true; }));
+  // mostly dense, stored with a bitmap
+  pages.push_back(MakePage(4, 5, [](size_t i, size_t j) { return (i + j) % 4 != 0; }));
+  // sparse
+  pages.push_back(MakePage(4, 50, [](size_t i, size_t j) { return j % 17 == i; }));
+  // unsorted rows
+  pages.push_back(MakePage(4, 5, [](size_t i, size_t j) { return true; }));
+  std::swap(pages.back().data[0], pages.back().data[1]);
+  CheckRoundTrip(pages);
+}
+
+TEST(SparsePageDenseFormat, SparsePageDMatrix) {
+  std::string tmp_file = CreateSimpleTestData();
+  std::string cache = tmp_file + ".cache.fmt-dense";
+  std::unique_ptr<xgboost::DMatrix> dmat(xgboost::DMatrix::Load(
+      tmp_file + "#" + cache, true, false));
+  std::remove(tmp_file.c_str());
+  EXPECT_EQ(dmat->info().num_nonzero, 6);
+
+  dmlc::DataIter<xgboost::RowBatch>* row_iter = dmat->RowIterator();
+  size_t nnz = 0;
+  row_iter->BeforeFirst();
+  while (row_iter->Next()) {
+    const xgboost::RowBatch& batch = row_iter->Value();
+    nnz += batch.ind_ptr[batch.size] - batch.ind_ptr[0];
+  }
+  EXPECT_EQ(nnz, 6);
+  dmat.reset();
+  std::remove(cache.c_str());
+  std::remove((cache + ".row.page").c_str());
+}
@@ -96,3 +96,42 @@ TEST(SparsePageDMatrix, ColAcess) {
   std::remove((tmp_file + ".cache.col.page").c_str());
   std::remove((tmp_file + ".cache.row.page").c_str());
 }
+
+TEST(SparsePageDMatrix, ColAccessShards) {
+  std::string tmp_file = CreateSimpleTestData();
+  std::string cache0 = tmp_file + ".cache0", cache1 = tmp_file + ".cache1";
+  std::unique_ptr<xgboost::DMatrix> dmat(xgboost::DMatrix::Load(
+    tmp_file + "#" + cache0 + ":" + cache1, true, false));
+  std::remove(tmp_file.c_str());
+
+  const std::vector<bool> enable(dmat->info().num_col, true);
+  dmat->InitColAccess(enable, 1, 1, true); // Max 1 row per patch
+  EXPECT_TRUE(FileExists(cache0 + ".col.page"));
+  EXPECT_TRUE(FileExists(cache1 + ".col.page"));
+  EXPECT_EQ(dmat->GetColSize(0), 2);
+  EXPECT_EQ(dmat->GetColSize(1), 1);
+  EXPECT_EQ(dmat->GetColSize(3), 1);
+
+  // the pages of the shards come back in the order of the rows
+  dmlc::DataIter<xgboost::ColBatch> * col_iter = dmat->ColIterator();
+  xgboost::bst_uint num_col_batch = 0;
+  col_iter->BeforeFirst();
+  while (col_iter->Next()) {
+    const xgboost::ColBatch& batch = col_iter->Value();
+    for (size_t i = 0; i < batch.size; ++i) {
+      for (size_t j = 0; j < batch[i].length; ++j) {
+        EXPECT_EQ(batch[i][j].index, num_col_batch);
+      }
+    }
+    num_col_batch += 1;
+  }
+  EXPECT_EQ(num_col_batch, dmat->info().num_row);
+  dmat.reset();
+
+  for (const std::string& cache : {cache0, cache1}) {
+    std::remove(cache.c_str());
+    std::remove((cache + ".row.page").c_str());
+    std::remove((cache + ".col.page").c_str());
+  }
+  std::remove((cache0 + ".col.meta").c_str());
+}
@@ -0,0 +1,65 @@
+// Copyright by Contributors
+#include <dmlc/io.h>
+#include <xgboost/gbm.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../helpers.h"
+
+namespace xgboost {
+TEST(GBLinear, IncrementalPredictionCache) {
+  typedef std::pair<std::string, std::string> arg;
+  const int nrow = 200;
+  // the matrix has a column beyond the features of the model
+  std::shared_ptr<DMatrix> dmat = CreateDMatrix(nrow, 6, 0.3, 7);
+  std::string tmp_file = TempFileName();
+  for (const char* ngroup : {"1", "3"}) {
+    std::vector<arg> cfg = {arg("num_feature", "5"), arg("num_output_group", ngroup),
+                            arg("updater", "coord_descent"), arg("eta", "0.5"),
+                            arg("silent", "1")};
+    std::unique_ptr<GradientBooster> cached(GradientBooster::Create("gblinear", {dmat}, 0.5f));
+    cached->Configure(cfg);
+    const size_t n = nrow * std::stoi(ngroup);
+    HostDeviceVector<bst_gpair> gpair(n);
+    HostDeviceVector<bst_float> preds, expected;
+    for (int iter = 0; iter < 8; ++iter) {
+      for (size_t i = 0; i < n; ++i) {
+        const float pred = iter == 0 ? 0.5f : preds.data_h()[i];
+        gpair.data_h()[i] = bst_gpair(pred - static_cast<float>(i % 3), 1.0f);
+      }
+      cached->DoBoost(dmat.get(), &gpair, nullptr);
+      cached->PredictBatch(dmat.get(), &preds, 0);
+      // the predictions of a booster without cache
+      {
+        std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(tmp_file.c_str(), "w"));
+        cached->Save(fo.get());
+      }
+      std::unique_ptr<GradientBooster> reference(GradientBooster::Create("gblinear", {}, 0.5f));
+      reference->Configure(cfg);
+      {
+        std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(tmp_file.c_str(), "r"));
+        reference->Load(fi.get());
+      }
+      reference->PredictBatch(dmat.get(), &expected, 0);
+      ASSERT_EQ(preds.size(), n);
+      ASSERT_EQ(expected.size(), n);
+      for (size_t i = 0; i < n; ++i) {
+        ASSERT_NEAR(preds.data_h()[i], expected.data_h()[i], 1e-4)
+            << "iteration " << iter << " ngroup " << ngroup;
+      }
+    }
+    // a single row predicted by itself
+    dmlc::DataIter<RowBatch>* iter = dmat->RowIterator();
+    iter->BeforeFirst();
+    ASSERT_TRUE(iter->Next());
+    std::vector<bst_float> row_preds;
+    cached->PredictInstance(iter->Value()[0], &row_preds, 0, 0);
+    ASSERT_EQ(row_preds.size(), static_cast<size_t>(std::stoi(ngroup)));
+    for (size_t gid = 0; gid < row_preds.size(); ++gid) {
+      ASSERT_NEAR(row_preds[gid], expected.data_h()[gid], 1e-5);
+    }
+  }
+}
+}  // namespace xgboost
@@ -0,0 +1,223 @@
+// Copyright by Contributors
+#include <dmlc/io.h>
+#include <dmlc/omp.h>
+#include <xgboost/gbm.h>
+#include <xgboost/tree_updater.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../../src/common/common.h"
+#include "../../../src/common/random.h"
+#include "../../../src/gbm/gbtree_model.h"
+#include "../../../src/gbm/group_gradients.h"
+
+#include "../helpers.h"
+
+namespace xgboost {
+TEST(GBTree, DartPredictionCache) {
+  typedef std::pair<std::string, std::string> arg;
+  const int nrow = 300;
+  std::shared_ptr<DMatrix> dmat = CreateDMatrix(nrow, 5, 0.2, 3);
+  dmat->InitColAccess(std::vector<bool>(5, true), 1.0f, nrow, true);
+  std::string tmp_file = TempFileName();
+  for (const char* keep : {"0", "1"}) {
+    for (const char* ngroup : {"1", "2"}) {
+      std::vector<arg> cfg = {arg("num_feature", "5"), arg("num_output_group", ngroup),
+                              arg("max_depth", "3"), arg("rate_drop", "0.3"),
+                              arg("one_drop", "1"), arg("silent", "1"),
+                              arg("cache_tree_output", keep)};
+      std::unique_ptr<GradientBooster> cached(GradientBooster::Create("dart", {dmat}, 0.5f));
+      cached->Configure(cfg);
+      const size_t n = nrow * std::stoi(ngroup);
+      HostDeviceVector<bst_gpair> gpair(n);
+      for (int iter = 0; iter < 12; ++iter) {
+        // the same dropout predicted from the cache and from all the trees
+        HostDeviceVector<bst_float> preds, expected;
+        common::GlobalRandom().seed(iter);
+        cached->PredictBatch(dmat.get(), &preds, 0);
+        {
+          std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(tmp_file.c_str(), "w"));
+          cached->Save(fo.get());
+        }
+        std::unique_ptr<GradientBooster> reference(GradientBooster::Create("dart", {}, 0.5f));
+        reference->Configure(cfg);
+        {
+          std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(tmp_file.c_str(), "r"));
+          reference->Load(fi.get());
+        }
+        common::GlobalRandom().seed(iter);
+        reference->PredictBatch(dmat.get(), &expected, 0);
+        ASSERT_EQ(preds.size(), n);
+        ASSERT_EQ(expected.size(), n);
+        for (size_t i = 0; i < n; ++i) {
+          ASSERT_NEAR(preds.data_h()[i], expected.data_h()[i], 1e-5)
+              << "iteration " << iter << " keep " << keep << " ngroup " << ngroup;
+        }
+        for (size_t i = 0; i < n; ++i) {
+          gpair.data_h()[i] = bst_gpair(preds.data_h()[i] - static_cast<float>(i % 3), 1.0f);
+        }
+        cached->DoBoost(dmat.get(), &gpair, nullptr);
+      }
+    }
+  }
+  std::remove(tmp_file.c_str());
+}
+
+TEST(GBTree, ConcurrentTrees) {
+  typedef std::pair<std::string, std::string> arg;
+  const int nrow = 400, ngroup = 3;
+  std::shared_ptr<DMatrix> dmat = CreateDMatrix(nrow, 6, 0.1, 5);
+  dmat->InitColAccess(std::vector<bool>(6, true), 1.0f, nrow, true);
+  const int nthread = omp_get_max_threads();
+  omp_set_num_threads(4);
+  // a forest of each group, built in turn and by 3 jobs at the same time
+  for (const char* updater : {"grow_fast_histmaker", "grow_colmaker,prune"}) {
+    std::vector<std::vector<bst_float> > preds;
+    for (const char* njob : {"1", "3"}) {
+      std::vector<arg> cfg = {arg("num_feature", "6"), arg("num_output_group", "3"),
+                              arg("num_parallel_tree", "2"), arg("eta", "0.7"),
+                              arg("max_depth", "3"), arg("silent", "1"),
+                              arg("updater", updater), arg("concurrent_trees", njob)};
+      std::unique_ptr<GradientBooster> gbm(GradientBooster::Create("gbtree", {dmat}, 0.5f));
+      gbm->Configure(cfg);
+      HostDeviceVector<bst_gpair> gpair(nrow * ngroup);
+      HostDeviceVector<bst_float> out;
+      for (int iter = 0; iter < 4; ++iter) {
+        gbm->PredictBatch(dmat.get(), &out, 0);
+        for (size_t i = 0; i < gpair.size(); ++i) {
+          const float label = static_cast<float>((i / ngroup) % 3 == i % ngroup);
+          gpair.data_h()[i] = bst_gpair(out.data_h()[i] - label, 1.0f);
+        }
+        gbm->DoBoost(dmat.get(), &gpair, nullptr);
+      }
+      gbm->PredictBatch(dmat.get(), &out, 0);
+      preds.push_back(out.data_h());
+    }
+    ASSERT_EQ(preds[0].size(), nrow * ngroup);
+    ASSERT_EQ(preds[1].size(), nrow * ngroup);
+    for (size_t i = 0; i < preds[0].size(); ++i) {
+      ASSERT_NEAR(preds[0][i], preds[1][i], 1e-4) << updater;
+    }
+  }
+  omp_set_num_threads(nthread);
+}
+
+TEST(GBTree, TrainingPredictionCache) {
+  typedef std::pair<std::string, std::string> arg;
+  const int nrow = 500;
+  std::shared_ptr<DMatrix> dmat = CreateDMatrix(nrow, 6, 0.2, 7);
+  dmat->InitColAccess(std::vector<bool>(6, true), 1.0f, nrow, true);
+  std::string tmp_file = TempFileName();
+  for (const char* updater : {"grow_colmaker,prune", "grow_histmaker,prune",
+                              "grow_skmaker,prune", "grow_fast_histmaker"}) {
+    // the pruner removes some of the splits
+    std::vector<arg> cfg = {arg("num_feature", "6"), arg("max_depth", "4"),
+                            arg("gamma", "0.5"), arg("silent", "1"),
+                            arg("updater", updater)};
+    // the grower keeps the leaf of each row
+    {
+      const std::string grower = common::Split(updater, ',')[0];
+      std::unique_ptr<TreeUpdater> up(TreeUpdater::Create(grower));
+      up->Init(cfg);
+      HostDeviceVector<bst_gpair> gpair(nrow);
+      for (int i = 0; i < nrow; ++i) {
+        gpair.data_h()[i] = bst_gpair(0.1f * (i % 9) - 0.4f, 1.0f);
+      }
+      RegTree tree;
+      tree.param.InitAllowUnknown(cfg);
+      tree.InitModel();
+      up->Update(&gpair, dmat.get(), {&tree});
+      HostDeviceVector<bst_float> preds(nrow, 0.0f);
+      ASSERT_TRUE(up->UpdatePredictionCache(dmat.get(), &preds)) << updater;
+    }
+    std::unique_ptr<GradientBooster> gbm(GradientBooster::Create("gbtree", {dmat}, 0.5f));
+    gbm->Configure(cfg);
+    HostDeviceVector<bst_gpair> gpair(nrow);
+    HostDeviceVector<bst_float> cached, expected;
+    for (int iter = 0; iter < 5; ++iter) {
+      gbm->PredictBatch(dmat.get(), &cached, 0);
+      for (int i = 0; i < nrow; ++i) {
+        gpair.data_h()[i] = bst_gpair(cached.data_h()[i] - static_cast<float>(i % 2), 1.0f);
+      }
+      gbm->DoBoost(dmat.get(), &gpair, nullptr);
+    }
+    gbm->PredictBatch(dmat.get(), &cached, 0);
+    {
+      std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(tmp_file.c_str(), "w"));
+      gbm->Save(fo.get());
+    }
+    std::unique_ptr<GradientBooster> reference(GradientBooster::Create("gbtree", {}, 0.5f));
+    reference->Configure(cfg);
+    {
+      std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(tmp_file.c_str(), "r"));
+      reference->Load(fi.get());
+    }
+    reference->PredictBatch(dmat.get(), &expected, 0);
+    ASSERT_EQ(cached.size(), expected.size());
+    for (size_t i = 0; i < cached.size(); ++i) {
+      ASSERT_NEAR(cached.data_h()[i], expected.data_h()[i], 1e-5) << updater;
+    }
+  }
+  std::remove(tmp_file.c_str());
+}
+}  // namespace xgboost
+
+namespace xgboost {
+TEST(GBTree, ParallelDump) {
+  // more trees than a dump block, each tree has its own leaf values
+  gbm::GBTreeModel model(0.5f);
+  model.param.num_feature = 4;
+  std::vector<std::unique_ptr<RegTree> > trees;
+  for (int i = 0; i < 150; ++i) {
+    std::unique_ptr<RegTree> tree(new RegTree());
+    tree->InitModel();
+    tree->AddChilds(0);
+    (*tree)[0].set_split(i % 4, 0.1f * i, i % 2 == 0);
+    (*tree)[(*tree)[0].cleft()].set_leaf(-0.01f * i);
+    (*tree)[(*tree)[0].cright()].set_leaf(0.02f * i);
+    trees.push_back(std::move(tree));
+  }
+  model.CommitModel(std::move(trees), 0);
+  for (const char* format : {"text", "json", "json_compact", "c"}) {
+    std::vector<std::string> serial;
+    for (const auto& tree : model.trees) {
+      serial.push_back(tree->DumpModel(FeatureMap(), false, format));
+    }
+    const int nthread = omp_get_max_threads();
+    omp_set_num_threads(4);
+    std::vector<std::string> parallel = model.DumpModel(FeatureMap(), false, format);
+    std::vector<std::string> visited;
+    model.DumpModelTo(FeatureMap(), false, format,
+                      [&](const std::string& dump) { visited.push_back(dump); });
+    omp_set_num_threads(nthread);
+    ASSERT_EQ(parallel.size(), serial.size());
+    EXPECT_EQ(visited, parallel);
+    for (size_t i = 0; i < serial.size(); ++i) {
+      EXPECT_NE(parallel[i].find(serial[i]), std::string::npos) << format << " " << i;
+    }
+  }
+}
+
+TEST(GBTree, GroupGradients) {
+  const int ngroup = 3;
+  const size_t nrow = 1000;
+  gbm::GroupGradients groups;
+  for (int iter = 0; iter < 2; ++iter) {
+    HostDeviceVector<bst_gpair> in_gpair(nrow * ngroup);
+    std::vector<bst_gpair>& in_h = in_gpair.data_h();
+    for (size_t i = 0; i < in_h.size(); ++i) {
+      in_h[i] = bst_gpair(static_cast<float>(i + iter), static_cast<float>(i % 7));
+    }
+    groups.Split(&in_gpair, ngroup);
+    for (int gid = 0; gid < ngroup; ++gid) {
+      const std::vector<bst_gpair>& group = groups.Group(gid)->const_data_h();
+      ASSERT_EQ(group.size(), nrow);
+      for (size_t i = 0; i < nrow; ++i) {
+        ASSERT_EQ(group[i].GetGrad(), in_h[i * ngroup + gid].GetGrad());
+        ASSERT_EQ(group[i].GetHess(), in_h[i * ngroup + gid].GetHess());
+      }
+    }
+  }
+}
+}  // namespace xgboost
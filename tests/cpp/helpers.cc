@@ -85,3 +85,16 @@ std::shared_ptr<xgboost::DMatrix> CreateDMatrix(int rows, int columns,
                          &handle);
   return *static_cast<std::shared_ptr<xgboost::DMatrix> *>(handle);
 }
+
+void ExpectSameTree(const xgboost::RegTree& a, const xgboost::RegTree& b, float eps) {
+  ASSERT_EQ(a.param.num_nodes, b.param.num_nodes);
+  for (int nid = 0; nid < a.param.num_nodes; ++nid) {
+    ASSERT_EQ(a[nid].is_leaf(), b[nid].is_leaf());
+    if (a[nid].is_leaf()) {
+      ASSERT_NEAR(a[nid].leaf_value(), b[nid].leaf_value(), eps);
+    } else {
+      ASSERT_EQ(a[nid].split_index(), b[nid].split_index());
+      ASSERT_EQ(a[nid].split_cond(), b[nid].split_cond());
+    }
+  }
+}
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <fstream>
 #include <cstdio>
+#include <memory>
+#include <random>
 #include <string>
 #include <vector>
 #include <sys/stat.h>
@@ -14,6 +16,7 @@
 #include <xgboost/base.h>
 #include <xgboost/objective.h>
 #include <xgboost/metric.h>
+#include <xgboost/tree_model.h>
 
 std::string TempFileName();
 
@@ -51,4 +54,32 @@ xgboost::bst_float GetMetricEval(
 
 std::shared_ptr<xgboost::DMatrix> CreateDMatrix(int rows, int columns,
                                                 float sparsity, int seed = 0);
+
+/**
+ * \brief Expects two trees with the same structure and splits, and leaf values
+ *  within eps of each other.
+ */
+void ExpectSameTree(const xgboost::RegTree& a, const xgboost::RegTree& b, float eps = 0.0f);
+
+/**
+ * \brief Grows a full tree of the given depth below nid with random splits and
+ *  leaf values. Every leaf covers a hessian of 1, as needed by the contributions.
+ *  Inline so that the benchmarks use it without the rest of the helpers.
+ */
+inline void GrowRandomTree(xgboost::RegTree* tree, int nid, int depth, int num_feature,
+                           std::mt19937* gen) {
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  if (depth == 0) {
+    (*tree)[nid].set_leaf(dis(*gen) - 0.5f);
+    tree->stat(nid).sum_hess = 1.0f;
+    return;
+  }
+  tree->AddChilds(nid);
+  (*tree)[nid].set_split(static_cast<unsigned>((*gen)() % num_feature), dis(*gen),
+                         dis(*gen) < 0.5f);
+  GrowRandomTree(tree, (*tree)[nid].cleft(), depth - 1, num_feature, gen);
+  GrowRandomTree(tree, (*tree)[nid].cright(), depth - 1, num_feature, gen);
+  tree->stat(nid).sum_hess = tree->stat((*tree)[nid].cleft()).sum_hess +
+      tree->stat((*tree)[nid].cright()).sum_hess;
+}
 #endif
@@ -1,7 +1,9 @@
 // Copyright by Contributors
+#include <dmlc/omp.h>
 #include <xgboost/linear_updater.h>
 #include "../helpers.h"
 #include "xgboost/gbm.h"
+#include "../../../src/linear/coordinate_common.h"
 
 typedef std::pair<std::string, std::string> arg;
 
@@ -41,4 +43,123 @@ TEST(Linear, coordinate) {
   updater->Update(&gpair, mat.get(), &model, gpair.size());
 
   ASSERT_EQ(model.bias()[0], 5.0f);
-}
\ No newline at end of file
+}
+namespace {
+std::vector<float> ShotgunWeights(xgboost::DMatrix* mat, const std::vector<arg>& args,
+                                  int nthread) {
+  auto updater = std::unique_ptr<xgboost::LinearUpdater>(
+      xgboost::LinearUpdater::Create("shotgun"));
+  updater->Init(args);
+  std::vector<xgboost::bst_gpair> gpair;
+  for (size_t i = 0; i < mat->info().num_row; ++i) {
+    gpair.emplace_back(0.1f * (i % 9) - 0.4f, 0.5f + 0.1f * (i % 3));
+  }
+  xgboost::gbm::GBLinearModel model;
+  model.param.num_feature = mat->info().num_col;
+  model.param.num_output_group = 1;
+  model.LazyInitModel();
+  const int saved = omp_get_max_threads();
+  omp_set_num_threads(nthread);
+  for (int it = 0; it < 3; ++it) {
+    updater->Update(&gpair, mat, &model, gpair.size());
+  }
+  omp_set_num_threads(saved);
+  return model.weight;
+}
+}  // namespace
+
+TEST(Linear, shotgunBlocked) {
+  auto mat = CreateDMatrix(300, 40, 0.5);
+  std::vector<bool> enabled(mat->info().num_col, true);
+  mat->InitColAccess(enabled, 1.0f, 1 << 16, false);
+  // the blocked updates do not depend on the number of threads
+  std::vector<arg> blocked = {arg("parallel_mode", "blocked"), arg("block_size", "8")};
+  std::vector<float> serial = ShotgunWeights(mat.get(), blocked, 1);
+  EXPECT_EQ(ShotgunWeights(mat.get(), blocked, 4), serial);
+  // on one thread the lock-free updates are the cyclic coordinate descent
+  std::vector<float> hogwild = ShotgunWeights(mat.get(), {arg("parallel_mode", "hogwild")}, 1);
+  std::vector<float> cyclic = ShotgunWeights(
+      mat.get(), {arg("parallel_mode", "blocked"), arg("block_size", "1")}, 4);
+  EXPECT_EQ(hogwild, cyclic);
+  EXPECT_NE(hogwild, serial);
+  std::vector<float> parallel = ShotgunWeights(mat.get(), {arg("parallel_mode", "hogwild")}, 4);
+  for (size_t i = 0; i < parallel.size(); ++i) {
+    EXPECT_NEAR(parallel[i], hogwild[i], 0.1f);
+  }
+}
+
+namespace {
+class GreedySums : public xgboost::linear::GreedyFeatureSelector {
+ public:
+  const std::vector<std::pair<double, double>>& Sums() const { return gpair_sums; }
+};
+}  // namespace
+
+TEST(Linear, greedyCachedSums) {
+  auto mat = CreateDMatrix(100, 12, 0.5);
+  std::vector<bool> enabled(mat->info().num_col, true);
+  mat->InitColAccess(enabled, 1.0f, 1 << 16, false);
+  std::vector<xgboost::bst_gpair> gpair;
+  for (size_t i = 0; i < mat->info().num_row; ++i) {
+    gpair.emplace_back(0.1f * (i % 9) - 0.4f, 0.5f + 0.1f * (i % 3));
+  }
+  xgboost::gbm::GBLinearModel model;
+  model.param.num_feature = mat->info().num_col;
+  model.param.num_output_group = 1;
+  model.LazyInitModel();
+  GreedySums cached;
+  cached.Setup(model, gpair, mat.get(), 0.0f, 0.0f, 0);
+  // the sums moved along with the residuals match the sums computed afresh
+  for (int k = 0; k < 4; ++k) {
+    const int fidx = cached.NextFeature(k, model, 0, gpair, mat.get(), 0.0f, 0.0f);
+    ASSERT_GE(fidx, 0);
+    const float dw = 0.3f;
+    model[fidx][0] += dw;
+    xgboost::linear::UpdateResidualParallel(fidx, 0, 1, dw, &gpair, mat.get());
+    cached.UpdateResidual(fidx, 0, dw, gpair, mat.get());
+  }
+  GreedySums fresh;
+  fresh.Setup(model, gpair, mat.get(), 0.0f, 0.0f, 0);
+  ASSERT_EQ(cached.Sums().size(), fresh.Sums().size());
+  for (size_t i = 0; i < fresh.Sums().size(); ++i) {
+    EXPECT_NEAR(cached.Sums()[i].first, fresh.Sums()[i].first, 1e-4);
+    EXPECT_NEAR(cached.Sums()[i].second, fresh.Sums()[i].second, 1e-4);
+  }
+}
+
+namespace {
+std::vector<float> CoordinateWeights(size_t max_row_perbatch, const std::vector<arg>& args) {
+  auto mat = CreateDMatrix(120, 10, 0.4, 5);
+  std::vector<bool> enabled(mat->info().num_col, true);
+  mat->InitColAccess(enabled, 1.0f, max_row_perbatch, false);
+  auto updater = std::unique_ptr<xgboost::LinearUpdater>(
+      xgboost::LinearUpdater::Create("coord_descent"));
+  updater->Init(args);
+  std::vector<xgboost::bst_gpair> gpair;
+  for (size_t i = 0; i < mat->info().num_row; ++i) {
+    gpair.emplace_back(0.1f * (i % 7) - 0.3f, 0.5f + 0.1f * (i % 3));
+  }
+  xgboost::gbm::GBLinearModel model;
+  model.param.num_feature = mat->info().num_col;
+  model.param.num_output_group = 1;
+  model.LazyInitModel();
+  for (int it = 0; it < 3; ++it) {
+    xgboost::common::GlobalRandom().seed(it);
+    updater->Update(&gpair, mat.get(), &model, gpair.size());
+  }
+  return model.weight;
+}
+}  // namespace
+
+TEST(Linear, coordinateColumnBlocks) {
+  // the columns of a matrix of several pages are read by blocks of features
+  for (const char* selector : {"cyclic", "shuffle", "greedy", "random"}) {
+    std::vector<arg> args = {arg("feature_selector", selector), arg("feature_block_size", "3")};
+    std::vector<float> single = CoordinateWeights(1 << 16, args);
+    std::vector<float> paged = CoordinateWeights(16, args);
+    ASSERT_EQ(single.size(), paged.size());
+    for (size_t i = 0; i < single.size(); ++i) {
+      EXPECT_NEAR(single[i], paged[i], 1e-5) << selector;
+    }
+  }
+}
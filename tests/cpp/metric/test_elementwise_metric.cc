@@ -1,5 +1,7 @@
 // Copyright by Contributors
 #include <xgboost/metric.h>
+#include <memory>
+#include <vector>
 
 #include "../helpers.h"
 
@@ -67,3 +69,26 @@ TEST(Metric, PoissionNegLogLik) {
                             {  0,   0,   1,   1}),
               1.1280f, 0.001f);
 }
+
+TEST(Metric, EvalAll) {
+  // several blocks of rows, element-wise metrics mixed with others
+  xgboost::MetaInfo info;
+  std::vector<xgboost::bst_float> preds;
+  for (size_t i = 0; i < 10000; ++i) {
+    preds.push_back(static_cast<xgboost::bst_float>((i * 7919) % 1000) * 0.001f + 0.0005f);
+    info.labels.push_back(static_cast<xgboost::bst_float>(i % 3 == 0));
+    info.weights.push_back(static_cast<xgboost::bst_float>(1 + i % 4));
+  }
+  info.num_row = info.labels.size();
+  std::vector<std::unique_ptr<xgboost::Metric> > metrics;
+  for (const char* name : {"rmse", "auc", "mae", "logloss", "ndcg@5", "error@0.7"}) {
+    metrics.emplace_back(xgboost::Metric::Create(name));
+  }
+  std::vector<xgboost::bst_float> results;
+  xgboost::Metric::EvalAll(metrics, preds, info, false, &results);
+  ASSERT_EQ(results.size(), metrics.size());
+  for (size_t k = 0; k < metrics.size(); ++k) {
+    EXPECT_EQ(results[k], metrics[k]->Eval(preds, info, false)) << metrics[k]->Name();
+  }
+  EXPECT_ANY_THROW(xgboost::Metric::EvalAll(metrics, {0.5f}, info, false, &results));
+}
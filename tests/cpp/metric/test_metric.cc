@@ -1,5 +1,7 @@
 // Copyright by Contributors
 #include <xgboost/metric.h>
+#include <memory>
+#include <vector>
 
 #include "../helpers.h"
 
@@ -9,3 +11,21 @@ TEST(Metric, UnknownMetric) {
   EXPECT_ANY_THROW(xgboost::Metric::Create("unknown_name@1"));
   EXPECT_NO_THROW(xgboost::Metric::Create("error@0.5f"));
 }
+
+TEST(Metric, EvalAllHostDeviceVector) {
+  std::vector<std::unique_ptr<xgboost::Metric> > metrics;
+  metrics.emplace_back(xgboost::Metric::Create("rmse"));
+  metrics.emplace_back(xgboost::Metric::Create("auc"));
+  xgboost::MetaInfo info;
+  info.num_row = 4;
+  info.labels = {0, 0, 1, 1};
+  std::vector<xgboost::bst_float> preds = {0.1f, 0.9f, 0.1f, 0.9f};
+  xgboost::HostDeviceVector<xgboost::bst_float> preds_hd(preds);
+  std::vector<xgboost::bst_float> out, expected;
+  // the predictions on the host are evaluated as a std::vector
+  xgboost::Metric::EvalAll(metrics, &preds_hd, info, false, &out);
+  xgboost::Metric::EvalAll(metrics, preds, info, false, &expected);
+  EXPECT_EQ(out, expected);
+  EXPECT_NEAR(out[0], 0.6403f, 0.001f);
+  EXPECT_NEAR(out[1], 0.5f, 0.001f);
+}
@@ -0,0 +1,61 @@
+/*!
+ * Copyright 2018 XGBoost contributors
+ */
+#include <xgboost/metric.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../helpers.h"
+
+namespace {
+// the metrics evaluated on the device copy of preds, and on the host
+void CheckDeviceMetrics(const std::vector<std::string>& names,
+                        const std::vector<xgboost::bst_float>& preds,
+                        const xgboost::MetaInfo& info) {
+  std::vector<std::unique_ptr<xgboost::Metric> > metrics;
+  for (const std::string& name : names) {
+    metrics.emplace_back(xgboost::Metric::Create(name));
+  }
+  xgboost::HostDeviceVector<xgboost::bst_float> preds_d(preds, 0);
+  std::vector<xgboost::bst_float> device_out, host_out;
+  xgboost::Metric::EvalAll(metrics, &preds_d, info, false, &device_out);
+  xgboost::Metric::EvalAll(metrics, preds, info, false, &host_out);
+  ASSERT_EQ(device_out.size(), names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    EXPECT_NEAR(device_out[i], host_out[i], 1e-5) << names[i];
+  }
+}
+}  // namespace
+
+TEST(Metric, GPUEvalAll) {
+  const size_t nrow = 10000;
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  xgboost::MetaInfo info;
+  info.num_row = nrow;
+  std::vector<xgboost::bst_float> preds(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    // a few ties for the auc
+    preds[i] = std::round(dist(rng) * 1000.0f) / 1000.0f;
+    info.labels.push_back(dist(rng) < preds[i] ? 1.0f : 0.0f);
+    info.weights.push_back(0.5f + dist(rng));
+  }
+  CheckDeviceMetrics({"rmse", "mae", "logloss", "error", "error@0.7", "auc"}, preds, info);
+  // the rows without weights
+  info.weights.clear();
+  CheckDeviceMetrics({"rmse", "error", "auc", "poisson-nloglik"}, preds, info);
+
+  // multi-class predictions, only read on the device
+  const size_t nclass = 3;
+  std::vector<xgboost::bst_float> mpreds(nrow * nclass);
+  for (size_t i = 0; i < nrow; ++i) {
+    mpreds[i * nclass + i % nclass] = 0.2f + dist(rng);
+    for (size_t k = 0; k < nclass; ++k) mpreds[i * nclass + k] += dist(rng);
+    info.labels[i] = static_cast<xgboost::bst_float>(i % nclass);
+  }
+  CheckDeviceMetrics({"merror", "mlogloss"}, mpreds, info);
+  info.labels[0] = 5.0f;
+  EXPECT_ANY_THROW(CheckDeviceMetrics({"merror"}, mpreds, info));
+}
@@ -1,5 +1,11 @@
 // Copyright by Contributors
 #include <xgboost/metric.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include "../../../src/common/math.h"
+#include "../../../src/metric/auc.h"
 
 #include "../helpers.h"
 
@@ -52,6 +58,53 @@ TEST(Metric, AUCPR) {
   EXPECT_ANY_THROW(GetMetricEval(metric, {0, 0}, {0, 0}));
 }
 
+TEST(Metric, AUCParallelRuns) {
+  using xgboost::metric::PredBucket;
+  // enough rows to sort and sweep them in chunks, with many ties and weights
+  xgboost::MetaInfo info;
+  std::vector<xgboost::bst_float> preds;
+  const unsigned n = 200000;
+  for (unsigned i = 0; i < n; ++i) {
+    preds.push_back(static_cast<xgboost::bst_float>((i * 7919) % 3001) * 0.01f);
+    info.labels.push_back(static_cast<xgboost::bst_float>((i * 104729) % 7 < 3));
+    info.weights.push_back(static_cast<xgboost::bst_float>(1 + i % 3));
+  }
+  info.num_row = n;
+  std::vector<PredBucket> serial, parallel, head, tail, merged;
+  xgboost::metric::MakeRun(preds, info, 0, n, 1, &serial);
+  xgboost::metric::MakeRun(preds, info, 0, n, 4, &parallel);
+  ASSERT_EQ(serial.size(), 3001);
+  ASSERT_EQ(parallel.size(), serial.size());
+  // the runs of two halves merge into the run of the whole data
+  xgboost::metric::MakeRun(preds, info, 0, n / 3, 1, &head);
+  xgboost::metric::MakeRun(preds, info, n / 3, n, 4, &tail);
+  xgboost::metric::MergeRuns(head, tail, &merged);
+  ASSERT_EQ(merged.size(), serial.size());
+  for (size_t i = 0; i < serial.size(); ++i) {
+    ASSERT_EQ(parallel[i].pred, serial[i].pred);
+    ASSERT_EQ(merged[i].pred, serial[i].pred);
+    EXPECT_NEAR(parallel[i].pos, serial[i].pos, 1e-6);
+    EXPECT_NEAR(merged[i].neg, serial[i].neg, 1e-6);
+  }
+  double pos, neg, par_pos, par_neg;
+  const double auc = xgboost::metric::RunAUC(serial, 1, &pos, &neg);
+  EXPECT_NEAR(xgboost::metric::RunAUC(merged, 4, &par_pos, &par_neg), auc, 1e-9);
+  EXPECT_NEAR(par_pos, pos, 1e-6);
+  EXPECT_NEAR(par_neg, neg, 1e-6);
+  const double aucpr = xgboost::metric::RunAUCPR(serial, 1, &pos, &neg);
+  EXPECT_NEAR(xgboost::metric::RunAUCPR(merged, 4, &par_pos, &par_neg), aucpr, 1e-9);
+
+  // the metrics of a single group and of groups evaluated one per thread
+  std::unique_ptr<xgboost::Metric> metric_auc(xgboost::Metric::Create("auc"));
+  std::unique_ptr<xgboost::Metric> metric_aucpr(xgboost::Metric::Create("aucpr"));
+  EXPECT_NEAR(metric_auc->Eval(preds, info, false), auc, 1e-5);
+  EXPECT_NEAR(metric_aucpr->Eval(preds, info, false), aucpr, 1e-5);
+  info.group_ptr = {0, n / 3, n};
+  double group_auc = xgboost::metric::RunAUC(head, 1, &pos, &neg) +
+                     xgboost::metric::RunAUC(tail, 1, &pos, &neg);
+  EXPECT_NEAR(metric_auc->Eval(preds, info, false), group_auc / 2, 1e-5);
+}
+
 TEST(Metric, Precision) {
   // When the limit for precision is not given, it takes the limit at
   // std::numeric_limits<unsigned>::max(); hence all values are very small
@@ -140,3 +193,81 @@ TEST(Metric, MAP) {
                             {  0,   0,   1,   1}),
               0.25f, 0.001f);
 }
+
+namespace {
+// the rank list metrics by a stable sort of each whole group
+double ReferenceRankMetric(const std::string& name, unsigned topn,
+                           const std::vector<xgboost::bst_float>& preds,
+                           const xgboost::MetaInfo& info) {
+  double sum = 0.0;
+  for (size_t k = 0; k + 1 < info.group_ptr.size(); ++k) {
+    std::vector<std::pair<xgboost::bst_float, unsigned> > rec;
+    for (unsigned j = info.group_ptr[k]; j < info.group_ptr[k + 1]; ++j) {
+      rec.emplace_back(preds[j], static_cast<unsigned>(info.labels[j]));
+    }
+    std::stable_sort(rec.begin(), rec.end(), xgboost::common::CmpFirst);
+    auto dcg = [topn](const std::vector<std::pair<xgboost::bst_float, unsigned> >& r) {
+      double s = 0.0;
+      for (size_t i = 0; i < r.size() && i < topn; ++i) {
+        s += ((1 << r[i].second) - 1) / std::log2(i + 2.0);
+      }
+      return s;
+    };
+    if (name == "ndcg") {
+      const double d = dcg(rec);
+      std::stable_sort(rec.begin(), rec.end(), xgboost::common::CmpSecond);
+      const double idcg = dcg(rec);
+      sum += idcg == 0.0 ? 1.0 : d / idcg;
+    } else if (name == "map") {
+      unsigned nhits = 0;
+      double ap = 0.0;
+      for (size_t i = 0; i < rec.size(); ++i) {
+        if (rec[i].second != 0) {
+          ++nhits;
+          if (i < topn) ap += static_cast<double>(nhits) / (i + 1);
+        }
+      }
+      sum += nhits == 0 ? 1.0 : ap / nhits;
+    } else {
+      unsigned nhit = 0;
+      for (size_t i = 0; i < rec.size() && i < topn; ++i) nhit += rec[i].second != 0;
+      sum += static_cast<double>(nhit) / topn;
+    }
+  }
+  return sum / (info.group_ptr.size() - 1);
+}
+}  // namespace
+
+TEST(Metric, RankListTopK) {
+  // groups longer and shorter than k, with tied predictions, evaluated by
+  // several metrics in turn on the same predictions then on new ones
+  xgboost::MetaInfo info;
+  info.group_ptr = {0};
+  for (unsigned size : {300, 3, 1000, 7, 50}) {
+    for (unsigned i = 0; i < size; ++i) {
+      info.labels.push_back(static_cast<xgboost::bst_float>((i * 31 + size) % 5 == 0 ? i % 4 : 0));
+    }
+    info.group_ptr.push_back(static_cast<unsigned>(info.labels.size()));
+  }
+  info.num_row = info.labels.size();
+  std::unique_ptr<xgboost::Metric> metrics[] = {
+    std::unique_ptr<xgboost::Metric>(xgboost::Metric::Create("ndcg@10")),
+    std::unique_ptr<xgboost::Metric>(xgboost::Metric::Create("map@5")),
+    std::unique_ptr<xgboost::Metric>(xgboost::Metric::Create("pre@20")),
+    std::unique_ptr<xgboost::Metric>(xgboost::Metric::Create("ndcg")),
+    std::unique_ptr<xgboost::Metric>(xgboost::Metric::Create("map@40"))
+  };
+  const char* names[] = {"ndcg", "map", "pre", "ndcg", "map"};
+  const unsigned topn[] = {10, 5, 20, std::numeric_limits<unsigned>::max(), 40};
+  for (unsigned seed : {1, 2}) {
+    std::vector<xgboost::bst_float> preds;
+    for (size_t i = 0; i < info.labels.size(); ++i) {
+      preds.push_back(static_cast<xgboost::bst_float>((i * 7919 * seed) % 97));
+    }
+    for (int m = 0; m < 5; ++m) {
+      EXPECT_NEAR(metrics[m]->Eval(preds, info, false),
+                  ReferenceRankMetric(names[m], topn[m], preds, info), 1e-5)
+          << metrics[m]->Name() << " seed " << seed;
+    }
+  }
+}
@@ -0,0 +1,81 @@
+// Copyright by Contributors
+#include <xgboost/objective.h>
+#include <cmath>
+#include <memory>
+#include <string>
+
+#include "../helpers.h"
+
+namespace {
+// softmax of each row of preds by the scalar formula
+std::vector<xgboost::bst_float> ReferenceSoftmax(
+    const std::vector<xgboost::bst_float>& preds, int nclass) {
+  std::vector<xgboost::bst_float> prob(preds.size());
+  for (size_t i = 0; i < preds.size() / nclass; ++i) {
+    double wmax = preds[i * nclass];
+    for (int k = 1; k < nclass; ++k) wmax = std::max(wmax, double(preds[i * nclass + k]));
+    double wsum = 0.0;
+    for (int k = 0; k < nclass; ++k) wsum += std::exp(preds[i * nclass + k] - wmax);
+    for (int k = 0; k < nclass; ++k) {
+      prob[i * nclass + k] = static_cast<xgboost::bst_float>(
+          std::exp(preds[i * nclass + k] - wmax) / wsum);
+    }
+  }
+  return prob;
+}
+}  // namespace
+
+TEST(Objective, SoftmaxMultiClass) {
+  // 3 classes go through the blocked softmax, 40 through the row one,
+  // 21 rows leave a partial block after two blocks of 8 rows
+  for (int nclass : {3, 40}) {
+    std::unique_ptr<xgboost::ObjFunction> obj(
+        xgboost::ObjFunction::Create("multi:softprob"));
+    obj->Configure({{"num_class", std::to_string(nclass)}});
+    const size_t nrow = 21;
+    xgboost::MetaInfo info;
+    info.num_row = nrow;
+    std::vector<xgboost::bst_float> preds(nrow * nclass);
+    for (size_t i = 0; i < preds.size(); ++i) {
+      preds[i] = static_cast<xgboost::bst_float>((i * 37) % 23) * 0.4f - 4.0f;
+    }
+    for (size_t i = 0; i < nrow; ++i) {
+      info.labels.push_back(static_cast<xgboost::bst_float>(i % nclass));
+      info.weights.push_back(0.5f + static_cast<xgboost::bst_float>(i % 3));
+    }
+    std::vector<xgboost::bst_float> prob = ReferenceSoftmax(preds, nclass);
+
+    xgboost::HostDeviceVector<xgboost::bst_float> in_preds(preds);
+    xgboost::HostDeviceVector<xgboost::bst_gpair> out_gpair;
+    obj->GetGradient(&in_preds, info, 1, &out_gpair);
+    std::vector<xgboost::bst_gpair>& gpair = out_gpair.data_h();
+    ASSERT_EQ(gpair.size(), preds.size());
+    for (size_t i = 0; i < nrow; ++i) {
+      const xgboost::bst_float wt = info.weights[i];
+      for (int k = 0; k < nclass; ++k) {
+        const xgboost::bst_float p = prob[i * nclass + k];
+        const xgboost::bst_float grad = (k == static_cast<int>(info.labels[i]) ? p - 1.0f : p);
+        EXPECT_NEAR(gpair[i * nclass + k].GetGrad(), grad * wt, 1e-5);
+        EXPECT_NEAR(gpair[i * nclass + k].GetHess(), 2.0f * p * (1.0f - p) * wt, 1e-5);
+      }
+    }
+
+    obj->PredTransform(&in_preds);
+    ASSERT_EQ(in_preds.size(), prob.size());
+    for (size_t i = 0; i < prob.size(); ++i) {
+      EXPECT_NEAR(in_preds.data_h()[i], prob[i], 1e-6);
+    }
+
+    std::unique_ptr<xgboost::ObjFunction> softmax(
+        xgboost::ObjFunction::Create("multi:softmax"));
+    softmax->Configure({{"num_class", std::to_string(nclass)}});
+    xgboost::HostDeviceVector<xgboost::bst_float> classes(preds);
+    softmax->PredTransform(&classes);
+    ASSERT_EQ(classes.size(), nrow);
+    for (size_t i = 0; i < nrow; ++i) {
+      const xgboost::bst_float* row = &prob[i * nclass];
+      EXPECT_EQ(classes.data_h()[i],
+                std::max_element(row, row + nclass) - row);
+    }
+  }
+}
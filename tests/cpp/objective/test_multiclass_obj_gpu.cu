@@ -0,0 +1,72 @@
+/*!
+ * Copyright 2018 XGBoost contributors
+ */
+#include <xgboost/objective.h>
+
+#include "../helpers.h"
+
+namespace {
+// gradients of the objective for the predictions of 3 classes and 4 rows
+std::vector<xgboost::bst_gpair> SoftmaxGradient(const std::string& name) {
+  xgboost::ObjFunction* obj = xgboost::ObjFunction::Create(name);
+  std::vector<std::pair<std::string, std::string> > args;
+  args.push_back(std::make_pair("num_class", "3"));
+  obj->Configure(args);
+  xgboost::MetaInfo info;
+  info.num_row = 4;
+  info.labels = {0, 1, 2, 1};
+  info.weights = {1, 0.5f, 2, 1};
+  xgboost::HostDeviceVector<xgboost::bst_float> preds(
+      {0.1f, 0.5f, -1.0f, 2.0f, 0.0f, 0.3f, -0.2f, -0.2f, 4.0f, 1.0f, 1.0f, 1.0f});
+  xgboost::HostDeviceVector<xgboost::bst_gpair> out_gpair;
+  obj->GetGradient(&preds, info, 0, &out_gpair);
+  delete obj;
+  return out_gpair.data_h();
+}
+}  // namespace
+
+TEST(Objective, GPUSoftmaxMultiClassGPair) {
+  auto expected = SoftmaxGradient("multi:softprob");
+  auto gpair = SoftmaxGradient("gpu:multi:softprob");
+  ASSERT_EQ(gpair.size(), expected.size());
+  for (size_t i = 0; i < gpair.size(); ++i) {
+    EXPECT_NEAR(gpair[i].GetGrad(), expected[i].GetGrad(), 1e-5f);
+    EXPECT_NEAR(gpair[i].GetHess(), expected[i].GetHess(), 1e-5f);
+  }
+}
+
+TEST(Objective, GPUSoftmaxMultiClassTransform) {
+  std::vector<std::pair<std::string, std::string> > args;
+  args.push_back(std::make_pair("num_class", "3"));
+  std::vector<xgboost::bst_float> margins = {0.1f, 0.5f, -1.0f, 2.0f, 0.0f, 0.3f};
+
+  xgboost::ObjFunction* softmax = xgboost::ObjFunction::Create("gpu:multi:softmax");
+  softmax->Configure(args);
+  xgboost::HostDeviceVector<xgboost::bst_float> index(margins);
+  softmax->PredTransform(&index);
+  ASSERT_EQ(index.size(), 2);
+  EXPECT_EQ(index.data_h()[0], 1.0f);
+  EXPECT_EQ(index.data_h()[1], 0.0f);
+
+  xgboost::ObjFunction* softprob = xgboost::ObjFunction::Create("gpu:multi:softprob");
+  softprob->Configure(args);
+  xgboost::HostDeviceVector<xgboost::bst_float> prob(margins);
+  softprob->PredTransform(&prob);
+  ASSERT_EQ(prob.size(), margins.size());
+  for (int i = 0; i < 2; ++i) {
+    float sum = 0.0f;
+    for (int k = 0; k < 3; ++k) sum += prob.data_h()[i * 3 + k];
+    EXPECT_NEAR(sum, 1.0f, 1e-5f);
+  }
+  EXPECT_GT(prob.data_h()[1], prob.data_h()[0]);
+
+  // test label validation
+  xgboost::MetaInfo info;
+  info.num_row = 2;
+  info.labels = {0, 3};
+  xgboost::HostDeviceVector<xgboost::bst_float> preds(margins);
+  xgboost::HostDeviceVector<xgboost::bst_gpair> out_gpair;
+  EXPECT_ANY_THROW(softprob->GetGradient(&preds, info, 0, &out_gpair));
+  delete softmax;
+  delete softprob;
+}
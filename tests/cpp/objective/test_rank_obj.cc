@@ -0,0 +1,91 @@
+// Copyright by Contributors
+#include <dmlc/omp.h>
+#include <xgboost/objective.h>
+#include <memory>
+
+#include "../helpers.h"
+
+namespace {
+std::vector<xgboost::bst_gpair> RankGradient(const std::string& name,
+                                             const xgboost::MetaInfo& info,
+                                             const std::vector<xgboost::bst_float>& preds) {
+  std::unique_ptr<xgboost::ObjFunction> obj(xgboost::ObjFunction::Create(name));
+  obj->Configure({{"num_pairsample", "2"}});
+  xgboost::HostDeviceVector<xgboost::bst_float> in_preds(preds);
+  xgboost::HostDeviceVector<xgboost::bst_gpair> out_gpair;
+  obj->GetGradient(&in_preds, info, 3, &out_gpair);
+  return out_gpair.data_h();
+}
+}  // namespace
+
+TEST(Objective, PairwiseRankGPair) {
+  // groups of two rows with different labels, where each row has a single
+  // possible pair so the sampling is deterministic, and a group of a single label
+  xgboost::MetaInfo info;
+  info.num_row = 10;
+  info.labels = {0, 1, 2, 0, 1, 3, 0, 0, 1, 1};
+  info.group_ptr = {0, 2, 4, 6, 8, 10};
+  std::vector<xgboost::bst_float> preds =
+      {0.5f, -0.5f, 1.0f, 0.2f, -1.0f, 2.0f, 0.3f, 0.1f, 0.4f, 0.6f};
+  auto gpair = RankGradient("rank:pairwise", info, preds);
+  ASSERT_EQ(gpair.size(), preds.size());
+  for (size_t i = 0; i < 6; i += 2) {
+    const size_t pos = info.labels[i] > info.labels[i + 1] ? i : i + 1;
+    const size_t neg = pos == i ? i + 1 : i;
+    const float p = 1.0f / (1.0f + std::exp(preds[neg] - preds[pos]));
+    // two pairs of weight 1 / num_pairsample for each row of the group
+    EXPECT_NEAR(gpair[pos].GetGrad(), 2 * (p - 1.0f), 1e-5f);
+    EXPECT_NEAR(gpair[neg].GetGrad(), 2 * (1.0f - p), 1e-5f);
+    EXPECT_NEAR(gpair[pos].GetHess(), 4 * p * (1.0f - p), 1e-5f);
+    EXPECT_NEAR(gpair[neg].GetHess(), 4 * p * (1.0f - p), 1e-5f);
+  }
+  for (size_t i = 6; i < 10; ++i) {
+    EXPECT_EQ(gpair[i].GetGrad(), 0.0f);
+    EXPECT_EQ(gpair[i].GetHess(), 0.0f);
+  }
+}
+
+TEST(Objective, LambdaRankLargeGroup) {
+  // a group large enough to be split among the threads, with more distinct
+  // labels than are bucketed without sorting, next to small groups
+  const size_t nlarge = 5000, nrow = nlarge + 40;
+  xgboost::MetaInfo info;
+  info.num_row = nrow;
+  std::vector<xgboost::bst_float> preds;
+  for (size_t i = 0; i < nrow; ++i) {
+    info.labels.push_back(static_cast<xgboost::bst_float>(i < nlarge ? i % 100 : i % 3));
+    // distinct predictions, so the order of the sorted group is unique
+    preds.push_back(static_cast<xgboost::bst_float>((i * 7919) % 5051) / 5051.0f);
+  }
+  info.group_ptr = {0, static_cast<unsigned>(nlarge)};
+  for (size_t i = nlarge + 10; i <= nrow; i += 10) {
+    info.group_ptr.push_back(static_cast<unsigned>(i));
+  }
+  const int nthread = omp_get_max_threads();
+  for (const char* name : {"rank:pairwise", "rank:ndcg", "rank:map"}) {
+    omp_set_num_threads(2);
+    auto expected = RankGradient(name, info, preds);
+    omp_set_num_threads(4);
+    auto gpair = RankGradient(name, info, preds);
+    ASSERT_EQ(gpair.size(), nrow);
+    // the sampling of a split group does not depend on the threads,
+    // unlike the one of the small groups
+    for (size_t i = 0; i < nlarge; ++i) {
+      EXPECT_NEAR(gpair[i].GetGrad(), expected[i].GetGrad(), 1e-5f) << name;
+      EXPECT_NEAR(gpair[i].GetHess(), expected[i].GetHess(), 1e-5f) << name;
+    }
+    // a pair adds opposite gradients to its two rows
+    for (size_t k = 0; k + 1 < info.group_ptr.size(); ++k) {
+      double sum = 0.0;
+      for (size_t i = info.group_ptr[k]; i < info.group_ptr[k + 1]; ++i) {
+        sum += gpair[i].GetGrad();
+      }
+      EXPECT_NEAR(sum, 0.0, 1e-3) << name;
+    }
+  }
+  omp_set_num_threads(nthread);
+  auto single = RankGradient("rank:pairwise", info, preds);
+  for (size_t i = 0; i < nlarge; ++i) {
+    EXPECT_GT(single[i].GetHess(), 0.0f);
+  }
+}
@@ -0,0 +1,45 @@
+/*!
+ * Copyright 2018 XGBoost contributors
+ */
+#include <xgboost/objective.h>
+
+#include "../helpers.h"
+
+namespace {
+// gradients of the objective on groups of two rows with different labels,
+// where each row has a single possible pair so the sampling is deterministic
+std::vector<xgboost::bst_gpair> RankGradient(const std::string& name) {
+  xgboost::ObjFunction* obj = xgboost::ObjFunction::Create(name);
+  std::vector<std::pair<std::string, std::string> > args;
+  args.push_back(std::make_pair("num_pairsample", "2"));
+  obj->Configure(args);
+  xgboost::MetaInfo info;
+  info.num_row = 8;
+  info.labels = {0, 1, 2, 0, 1, 3, 0, 0};
+  info.group_ptr = {0, 2, 4, 6, 8};
+  xgboost::HostDeviceVector<xgboost::bst_float> preds(
+      {0.5f, -0.5f, 1.0f, 0.2f, -1.0f, 2.0f, 0.3f, 0.1f});
+  xgboost::HostDeviceVector<xgboost::bst_gpair> out_gpair;
+  obj->GetGradient(&preds, info, 3, &out_gpair);
+  delete obj;
+  return out_gpair.data_h();
+}
+
+void CheckRankGradient(const std::string& name) {
+  auto expected = RankGradient(name);
+  auto gpair = RankGradient("gpu:" + name);
+  ASSERT_EQ(gpair.size(), expected.size());
+  for (size_t i = 0; i < gpair.size(); ++i) {
+    EXPECT_NEAR(gpair[i].GetGrad(), expected[i].GetGrad(), 1e-5f) << name;
+    EXPECT_NEAR(gpair[i].GetHess(), expected[i].GetHess(), 1e-5f) << name;
+  }
+}
+}  // namespace
+
+TEST(Objective, GPUPairwiseRankGPair) {
+  CheckRankGradient("rank:pairwise");
+}
+
+TEST(Objective, GPULambdaRankNDCGGPair) {
+  CheckRankGradient("rank:ndcg");
+}
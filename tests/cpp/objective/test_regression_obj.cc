@@ -188,3 +188,50 @@ TEST(Objective, CoxRegressionGPair) {
                    { 0,    0,    0, -0.799f, -0.788f, -0.590f, 0.910f,  1.006f},
                    { 0,    0,    0,  0.160f,  0.186f,  0.348f, 0.610f,  0.639f});
 }
+
+TEST(Objective, ExpObjectivesTail) {
+  // 11 rows: one vector of eight rows and a padded tail of three
+  const std::vector<xgboost::bst_float> preds =
+      {-2, -0.5f, 0, 0.3f, 1, 2, 3, -1, 0.7f, 1.5f, -3};
+  const std::vector<xgboost::bst_float> labels =
+      {0, 1, 2, 0.5f, 3, 1, 10, 0, 2, 4, 0.1f};
+  const std::vector<xgboost::bst_float> weights =
+      {1, 2, 0.5f, 1, 1, 3, 1, 1, 2, 0.5f, 1};
+  const float rho = 1.3f;
+  std::vector<xgboost::bst_float> poisson_grad, poisson_hess, gamma_grad,
+      gamma_hess, tweedie_grad, tweedie_hess;
+  for (size_t i = 0; i < preds.size(); ++i) {
+    const float p = preds[i], y = labels[i], w = weights[i];
+    poisson_grad.push_back((std::exp(p) - y) * w);
+    poisson_hess.push_back(std::exp(p + 0.7f) * w);
+    gamma_grad.push_back((1 - y / std::exp(p)) * w);
+    gamma_hess.push_back(y / std::exp(p) * w);
+    tweedie_grad.push_back((-y * std::exp((1 - rho) * p) + std::exp((2 - rho) * p)) * w);
+    tweedie_hess.push_back((-y * (1 - rho) * std::exp((1 - rho) * p) +
+                            (2 - rho) * std::exp((2 - rho) * p)) * w);
+  }
+  xgboost::ObjFunction * obj = xgboost::ObjFunction::Create("count:poisson");
+  obj->Configure({{"max_delta_step", "0.7"}});
+  CheckObjFunction(obj, preds, labels, weights, poisson_grad, poisson_hess);
+  delete obj;
+  obj = xgboost::ObjFunction::Create("reg:gamma");
+  obj->Configure({});
+  CheckObjFunction(obj, preds, labels, weights, gamma_grad, gamma_hess);
+  delete obj;
+  obj = xgboost::ObjFunction::Create("reg:tweedie");
+  obj->Configure({{"tweedie_variance_power", "1.3"}});
+  CheckObjFunction(obj, preds, labels, weights, tweedie_grad, tweedie_hess);
+
+  // a negative label in the tail is caught
+  std::vector<xgboost::bst_float> bad_labels = labels;
+  bad_labels.back() = -1;
+  EXPECT_ANY_THROW(CheckObjFunction(obj, preds, bad_labels, weights,
+                                    tweedie_grad, tweedie_hess));
+
+  xgboost::HostDeviceVector<xgboost::bst_float> io_preds(preds);
+  obj->PredTransform(&io_preds);
+  for (size_t i = 0; i < preds.size(); ++i) {
+    EXPECT_NEAR(io_preds.data_h()[i], std::exp(preds[i]), 1e-5f * std::exp(preds[i]));
+  }
+  delete obj;
+}
@@ -0,0 +1,96 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/predictor.h>
+#include <random>
+#include "../../../src/data/simple_csr_source.h"
+#include "../helpers.h"
+
+namespace xgboost {
+namespace {
+// a model of num_tree random trees, whose trees alternate between the groups
+void RandomModel(int num_tree, int num_feature, int num_group, gbm::GBTreeModel* model) {
+  std::mt19937 gen(7);
+  model->param.num_output_group = num_group;
+  model->param.num_feature = num_feature;
+  for (int gid = 0; gid < num_group; ++gid) {
+    std::vector<std::unique_ptr<RegTree>> group_trees;
+    for (int i = gid; i < num_tree; i += num_group) {
+      group_trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+      group_trees.back()->InitModel();
+      GrowRandomTree(group_trees.back().get(), 0, 1 + i % 4, num_feature, &gen);
+    }
+    model->CommitModel(std::move(group_trees), gid);
+  }
+}
+}  // anonymous namespace
+
+TEST(cpu_binned, PredictBatch) {
+  const int num_feature = 4;
+  const int num_group = 2;
+  // few thresholds a feature fit uint8_t bins, many of them take uint16_t bins
+  for (int num_tree : {10, 600}) {
+    gbm::GBTreeModel model(0.5);
+    RandomModel(num_tree, num_feature, num_group, &model);
+    // the matrix has a column the model does not split on
+    auto dmat = CreateDMatrix(50, num_feature + 1, 0.3f);
+    std::unique_ptr<Predictor> binned =
+        std::unique_ptr<Predictor>(Predictor::Create("cpu_binned"));
+    std::unique_ptr<Predictor> cpu_predictor =
+        std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+    binned->Init({}, {});
+    cpu_predictor->Init({}, {});
+
+    for (unsigned ntree_limit : {0U, 2U}) {
+      HostDeviceVector<float> binned_predictions;
+      HostDeviceVector<float> cpu_predictions;
+      binned->PredictBatch(dmat.get(), &binned_predictions, model, 0, ntree_limit);
+      cpu_predictor->PredictBatch(dmat.get(), &cpu_predictions, model, 0, ntree_limit);
+      std::vector<float>& binned_predictions_h = binned_predictions.data_h();
+      std::vector<float>& cpu_predictions_h = cpu_predictions.data_h();
+      ASSERT_EQ(binned_predictions_h.size(), 50 * num_group);
+      ASSERT_EQ(cpu_predictions_h.size(), binned_predictions_h.size());
+      for (size_t i = 0; i < binned_predictions_h.size(); ++i) {
+        ASSERT_NEAR(binned_predictions_h[i], cpu_predictions_h[i], 1e-5f)
+            << "num_tree " << num_tree;
+      }
+    }
+  }
+}
+
+TEST(cpu_binned, Thresholds) {
+  // a value equal to the threshold goes right, NaN goes right, missing
+  // values follow the default direction
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  RegTree& tree = *trees.back();
+  tree.InitModel();
+  tree.AddChilds(0);
+  tree[0].set_split(0, 0.5f, true);
+  tree[tree[0].cleft()].set_leaf(-1.0f);
+  tree[tree[0].cright()].set_leaf(1.0f);
+  gbm::GBTreeModel model(0.0);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 1;
+  model.CommitModel(std::move(trees), 0);
+
+  std::vector<float> values = {0.25f, 0.5f, 0.75f, std::numeric_limits<float>::quiet_NaN()};
+  std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+  for (float v : values) {
+    source->row_data_.push_back(SparseBatch::Entry(0, v));
+    source->row_ptr_.push_back(source->row_data_.size());
+  }
+  // a row without the feature
+  source->row_ptr_.push_back(source->row_data_.size());
+  source->info.num_row = values.size() + 1;
+  source->info.num_col = 1;
+  source->info.num_nonzero = values.size();
+  std::unique_ptr<DMatrix> dmat(DMatrix::Create(std::move(source)));
+
+  std::unique_ptr<Predictor> binned =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_binned"));
+  binned->Init({}, {});
+  HostDeviceVector<float> out_predictions;
+  binned->PredictBatch(dmat.get(), &out_predictions, model, 0);
+  EXPECT_EQ(out_predictions.data_h(), std::vector<float>({-1.0f, 1.0f, 1.0f, 1.0f, -1.0f}));
+}
+}  // namespace xgboost
@@ -1,4 +1,5 @@
 // Copyright by Contributors
+#include <dmlc/omp.h>
 #include <gtest/gtest.h>
 #include <xgboost/predictor.h>
 #include "../helpers.h"
@@ -60,3 +61,276 @@ TEST(cpu_predictor, Test) {
   }
 }
 }  // namespace xgboost
+
+namespace xgboost {
+// root splits on feature 0, its right child splits on feature 1
+std::unique_ptr<RegTree> CreateTwoLevelTree(bst_float scale) {
+  std::unique_ptr<RegTree> tree(new RegTree);
+  tree->InitModel();
+  tree->AddChilds(0);
+  (*tree)[0].set_split(0, 0.5f, true);
+  tree->AddChilds((*tree)[0].cright());
+  int right = (*tree)[0].cright();
+  (*tree)[right].set_split(1, 0.3f, false);
+  (*tree)[(*tree)[0].cleft()].set_leaf(-1.0f * scale);
+  (*tree)[(*tree)[right].cleft()].set_leaf(2.0f * scale);
+  (*tree)[(*tree)[right].cright()].set_leaf(3.0f * scale);
+  return tree;
+}
+
+TEST(cpu_predictor, CompiledTrees) {
+  std::unique_ptr<RegTree> tree = CreateTwoLevelTree(1.0f);
+
+  gbm::CompiledTrees compiled;
+  compiled.Append(*tree);
+  ASSERT_EQ(compiled.Size(), 1);
+  ASSERT_EQ(compiled.value.size(), 5);
+
+  auto dmat = CreateDMatrix(32, 2, 0.3f);
+  dmlc::DataIter<RowBatch>* iter = dmat->RowIterator();
+  iter->BeforeFirst();
+  RegTree::FVec feats;
+  feats.Init(2);
+  while (iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    for (size_t i = 0; i < batch.size; ++i) {
+      feats.Fill(batch[i]);
+      ASSERT_EQ(compiled.Predict(0, feats), tree->Predict(feats));
+      feats.Drop(batch[i]);
+    }
+  }
+}
+
+TEST(cpu_predictor, CompiledTreesAppendRange) {
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < 9; ++i) {
+    trees.push_back(CreateTwoLevelTree(i + 1.0f));
+  }
+  // a tree with a pruned subtree, its deleted nodes are not compiled
+  trees[4]->ChangeToLeaf((*trees[4])[0].cright(), 0.5f);
+  gbm::CompiledTrees one_by_one, at_once;
+  for (const auto& tree : trees) one_by_one.Append(*tree);
+  int nthread = omp_get_max_threads();
+  omp_set_num_threads(4);
+  at_once.Append(trees.begin(), trees.begin() + 2);
+  at_once.Append(trees.begin() + 2, trees.end());
+  omp_set_num_threads(nthread);
+  EXPECT_EQ(at_once.Size(), trees.size());
+  EXPECT_TRUE(at_once.compact);
+  EXPECT_EQ(at_once.node, one_by_one.node);
+  EXPECT_EQ(at_once.sindex, one_by_one.sindex);
+  EXPECT_EQ(at_once.value, one_by_one.value);
+  EXPECT_EQ(at_once.cright, one_by_one.cright);
+  EXPECT_EQ(at_once.roots, one_by_one.roots);
+  EXPECT_EQ(at_once.root_ptr, one_by_one.root_ptr);
+  EXPECT_EQ(at_once.value.size(), 8 * 5 + 3);
+}
+
+TEST(cpu_predictor, CompiledTreesWideNodes) {
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(CreateTwoLevelTree(1.0f));
+  // the right child of the root is further than a compact offset reaches
+  trees.push_back(CreateTwoLevelTree(2.0f));
+  RegTree& deep = *trees.back();
+  int nid = deep[0].cleft();
+  for (int depth = 0; depth < 16400; ++depth) {
+    deep.AddChilds(nid);
+    deep[nid].set_split(depth % 2, 0.01f * (depth % 97), depth % 3 == 0);
+    deep[deep[nid].cright()].set_leaf(0.001f * depth);
+    nid = deep[nid].cleft();
+  }
+  deep[nid].set_leaf(-4.0f);
+  gbm::CompiledTrees compiled;
+  compiled.Append(*trees[0]);
+  EXPECT_TRUE(compiled.compact);
+  EXPECT_EQ(compiled.NodeBytes(), 8U);
+  compiled.Append(*trees[1]);
+  EXPECT_FALSE(compiled.compact);
+  EXPECT_EQ(compiled.NodeBytes(), 12U);
+  EXPECT_TRUE(compiled.node.empty());
+  EXPECT_EQ(compiled.sindex.size(), compiled.value.size());
+
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 2;
+  model.CommitModel(std::move(trees), 0);
+  EXPECT_FALSE(model.compiled_trees.compact);
+  auto dmat = CreateDMatrix(37, 2, 0.1f);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  cpu_predictor->Init({}, {});
+  HostDeviceVector<float> out_predictions;
+  cpu_predictor->PredictBatch(dmat.get(), &out_predictions, model, 0);
+  dmlc::DataIter<RowBatch>* iter = dmat->RowIterator();
+  iter->BeforeFirst();
+  RegTree::FVec feats;
+  feats.Init(2);
+  while (iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    for (size_t i = 0; i < batch.size; ++i) {
+      feats.Fill(batch[i]);
+      const size_t ridx = batch.base_rowid + i;
+      const bst_float expected = 0.5f + model.trees[0]->Predict(feats) +
+          model.trees[1]->Predict(feats);
+      ASSERT_FLOAT_EQ(out_predictions.data_h()[ridx], expected);
+      feats.Drop(batch[i]);
+    }
+  }
+  // so does a split feature beyond the range of compact nodes
+  gbm::CompiledTrees wide_fid;
+  wide_fid.Append(*CreateTwoLevelTree(1.0f));
+  std::unique_ptr<RegTree> far = CreateTwoLevelTree(1.0f);
+  (*far)[0].set_split(70000, 0.5f, true);
+  wide_fid.Append(*far);
+  EXPECT_FALSE(wide_fid.compact);
+  RegTree::FVec wide_feats;
+  wide_feats.Init(70001);
+  std::vector<SparseBatch::Entry> row = {SparseBatch::Entry(1, 0.7f),
+                                         SparseBatch::Entry(70000, 0.9f)};
+  SparseBatch::Inst inst(row.data(), static_cast<bst_uint>(row.size()));
+  wide_feats.Fill(inst);
+  EXPECT_EQ(wide_fid.Predict(0, wide_feats), -1.0f);
+  EXPECT_EQ(wide_fid.Predict(1, wide_feats), 3.0f);
+}
+
+TEST(cpu_predictor, SparseLookup) {
+  // a model much wider than its rows looks the features up in sparse vectors
+  const unsigned num_feature = 100000;
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < 5; ++i) {
+    trees.push_back(CreateTwoLevelTree(i + 1.0f));
+    (*trees.back())[0].set_split(i % 2 == 0 ? 0 : num_feature - 1, 0.5f, i % 3 == 0);
+  }
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 1;
+  model.param.num_feature = num_feature;
+  model.CommitModel(std::move(trees), 0);
+
+  auto dmat = CreateDMatrix(37, 2, 0.3f);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  cpu_predictor->Init({}, {});
+  HostDeviceVector<float> out_predictions;
+  cpu_predictor->PredictBatch(dmat.get(), &out_predictions, model, 0);
+  dmlc::DataIter<RowBatch>* iter = dmat->RowIterator();
+  iter->BeforeFirst();
+  RegTree::FVec feats;
+  feats.Init(num_feature);
+  while (iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    for (size_t i = 0; i < batch.size; ++i) {
+      feats.Fill(batch[i]);
+      bst_float expected = 0.5f;
+      for (const auto& tree : model.trees) expected += tree->Predict(feats);
+      ASSERT_FLOAT_EQ(out_predictions.data_h()[batch.base_rowid + i], expected);
+      std::vector<float> instance;
+      cpu_predictor->PredictInstance(batch[i], &instance, model);
+      ASSERT_FLOAT_EQ(instance[0], expected);
+      feats.Drop(batch[i]);
+    }
+  }
+}
+}  // namespace xgboost
+
+namespace xgboost {
+TEST(cpu_predictor, BlockedPrediction) {
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < 7; ++i) {
+    trees.push_back(CreateTwoLevelTree(i + 1.0f));
+  }
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 2;
+  model.CommitModel(std::move(trees), 0);
+
+  auto dmat = CreateDMatrix(37, 2, 0.3f);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  cpu_predictor->Init({{"row_block_size", "3"}, {"tree_block_size", "2"}}, {});
+  HostDeviceVector<float> out_predictions;
+  cpu_predictor->PredictBatch(dmat.get(), &out_predictions, model, 0);
+  std::vector<float>& out_predictions_h = out_predictions.data_h();
+  ASSERT_EQ(out_predictions_h.size(), 37);
+
+  dmlc::DataIter<RowBatch>* iter = dmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const RowBatch& batch = iter->Value();
+    for (size_t i = 0; i < batch.size; ++i) {
+      std::vector<float> instance_out_predictions;
+      cpu_predictor->PredictInstance(batch[i], &instance_out_predictions, model);
+      ASSERT_EQ(instance_out_predictions[0],
+                out_predictions_h[batch.base_rowid + i]);
+    }
+  }
+}
+
+TEST(cpu_predictor, DenseKernel) {
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < 5; ++i) {
+    trees.push_back(CreateTwoLevelTree(i + 1.0f));
+  }
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 2;
+  model.CommitModel(std::move(trees), 0);
+
+  // mostly dense, the missing values go through the default direction
+  auto dmat = CreateDMatrix(37, 2, 0.2f);
+  std::unique_ptr<Predictor> dense_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  dense_predictor->Init({{"row_block_size", "20"}, {"dense_kernel", "1"}}, {});
+  std::unique_ptr<Predictor> sparse_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  sparse_predictor->Init({{"dense_kernel", "0"}}, {});
+  HostDeviceVector<float> dense_predictions;
+  HostDeviceVector<float> sparse_predictions;
+  dense_predictor->PredictBatch(dmat.get(), &dense_predictions, model, 0);
+  sparse_predictor->PredictBatch(dmat.get(), &sparse_predictions, model, 0);
+  std::vector<float>& dense_predictions_h = dense_predictions.data_h();
+  std::vector<float>& sparse_predictions_h = sparse_predictions.data_h();
+  ASSERT_EQ(dense_predictions_h.size(), 37);
+  ASSERT_EQ(sparse_predictions_h.size(), 37);
+  for (size_t i = 0; i < dense_predictions_h.size(); ++i) {
+    ASSERT_EQ(dense_predictions_h[i], sparse_predictions_h[i]);
+  }
+}
+
+TEST(cpu_predictor, ContributionOverTrees) {
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < 6; ++i) {
+    trees.push_back(CreateTwoLevelTree(i + 1.0f));
+    for (int nid = 0; nid < trees.back()->param.num_nodes; ++nid) {
+      trees.back()->stat(nid).sum_hess = 1.0f + nid;
+    }
+  }
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 2;
+  model.param.num_feature = 2;
+  std::vector<std::unique_ptr<RegTree>> group_trees[2];
+  for (int i = 0; i < 6; ++i) {
+    group_trees[i % 2].push_back(std::move(trees[i]));
+  }
+  model.CommitModel(std::move(group_trees[0]), 0);
+  model.CommitModel(std::move(group_trees[1]), 1);
+
+  auto dmat = CreateDMatrix(5, 2, 0.3f);
+  std::unique_ptr<Predictor> rows_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  rows_predictor->Init({{"contrib_parallel", "rows"}}, {});
+  std::unique_ptr<Predictor> trees_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  trees_predictor->Init({{"contrib_parallel", "trees"}}, {});
+  for (bool approximate : {false, true}) {
+    std::vector<float> rows_contribs;
+    std::vector<float> trees_contribs;
+    rows_predictor->PredictContribution(dmat.get(), &rows_contribs, model, 0, approximate);
+    trees_predictor->PredictContribution(dmat.get(), &trees_contribs, model, 0, approximate);
+    ASSERT_EQ(rows_contribs.size(), 5 * 2 * 3);
+    ASSERT_EQ(trees_contribs.size(), rows_contribs.size());
+    for (size_t i = 0; i < rows_contribs.size(); ++i) {
+      ASSERT_NEAR(rows_contribs[i], trees_contribs[i], 1e-5 * std::abs(rows_contribs[i]) + 1e-5);
+    }
+  }
+}
+}  // namespace xgboost
@@ -74,5 +74,179 @@ TEST(gpu_predictor, Test) {
     ASSERT_EQ(gpu_out_contribution[i], cpu_out_contribution[i]);
   }
 }
+
+TEST(gpu_predictor, StreamAndAppendTrees) {
+  std::unique_ptr<Predictor> gpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("gpu_predictor"));
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  // rows are copied in chunks of 3 rows over 2 streams
+  gpu_predictor->Init({{"stream_rows", "3"}, {"n_streams", "2"}}, {});
+  cpu_predictor->Init({}, {});
+
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 5;
+  auto dmat = CreateDMatrix(10, 5, 0.2f);
+  for (int round = 0; round < 3; ++round) {
+    // the device model is extended with the new tree
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree()));
+    trees.back()->InitModel();
+    trees.back()->AddChilds(0);
+    (*trees.back())[0].set_split(round, 0.5f, round % 2 == 0);
+    (*trees.back())[(*trees.back())[0].cleft()].set_leaf(-1.0f - round);
+    (*trees.back())[(*trees.back())[0].cright()].set_leaf(1.0f + round);
+    model.CommitModel(std::move(trees), 0);
+
+    HostDeviceVector<float> gpu_out_predictions;
+    HostDeviceVector<float> cpu_out_predictions;
+    gpu_predictor->PredictBatch(dmat.get(), &gpu_out_predictions, model, 0);
+    cpu_predictor->PredictBatch(dmat.get(), &cpu_out_predictions, model, 0);
+    std::vector<float>& gpu_out_predictions_h = gpu_out_predictions.data_h();
+    std::vector<float>& cpu_out_predictions_h = cpu_out_predictions.data_h();
+    ASSERT_EQ(gpu_out_predictions_h.size(), cpu_out_predictions_h.size());
+    for (size_t i = 0; i < gpu_out_predictions_h.size(); i++) {
+      ASSERT_NEAR(gpu_out_predictions_h[i], cpu_out_predictions_h[i], 1e-5);
+    }
+  }
+}
+
+TEST(gpu_predictor, MultiDevice) {
+  std::unique_ptr<Predictor> gpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("gpu_predictor"));
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  // rows are sharded over all visible devices
+  gpu_predictor->Init({{"n_gpus", "-1"}, {"stream_rows", "7"}}, {});
+  cpu_predictor->Init({}, {});
+
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < 4; ++i) {
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree()));
+    trees.back()->InitModel();
+    trees.back()->AddChilds(0);
+    (*trees.back())[0].set_split(i, 0.5f, i % 2 == 0);
+    (*trees.back())[(*trees.back())[0].cleft()].set_leaf(-0.5f * i);
+    (*trees.back())[(*trees.back())[0].cright()].set_leaf(0.25f * i);
+  }
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 2;
+  model.param.num_feature = 5;
+  for (int gid = 0; gid < 2; ++gid) {
+    std::vector<std::unique_ptr<RegTree>> group_trees;
+    group_trees.push_back(std::move(trees[gid]));
+    group_trees.push_back(std::move(trees[gid + 2]));
+    model.CommitModel(std::move(group_trees), gid);
+  }
+
+  auto dmat = CreateDMatrix(33, 5, 0.2f);
+  HostDeviceVector<float> gpu_out_predictions;
+  HostDeviceVector<float> cpu_out_predictions;
+  gpu_predictor->PredictBatch(dmat.get(), &gpu_out_predictions, model, 0);
+  cpu_predictor->PredictBatch(dmat.get(), &cpu_out_predictions, model, 0);
+  std::vector<float>& gpu_out_predictions_h = gpu_out_predictions.data_h();
+  std::vector<float>& cpu_out_predictions_h = cpu_out_predictions.data_h();
+  ASSERT_EQ(gpu_out_predictions_h.size(), 33 * 2);
+  for (size_t i = 0; i < gpu_out_predictions_h.size(); i++) {
+    ASSERT_NEAR(gpu_out_predictions_h[i], cpu_out_predictions_h[i], 1e-5);
+  }
+}
+
+TEST(gpu_predictor, Contribution) {
+  std::unique_ptr<Predictor> gpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("gpu_predictor"));
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  gpu_predictor->Init({}, {});
+  cpu_predictor->Init({}, {});
+
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 2;
+  model.param.num_feature = 4;
+  for (int i = 0; i < 4; ++i) {
+    // depth two trees splitting twice on the same feature in one branch
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree()));
+    RegTree& tree = *trees.back();
+    tree.InitModel();
+    tree.AddChilds(0);
+    tree[0].set_split(i % 4, 0.5f, i % 2 == 0);
+    const int left = tree[0].cleft(), right = tree[0].cright();
+    tree.AddChilds(left);
+    tree[left].set_split((i + 1) % 4, 0.3f, true);
+    tree.AddChilds(right);
+    tree[right].set_split(i % 4, 0.7f, false);
+    const int leaves[] = {tree[left].cleft(), tree[left].cright(),
+                          tree[right].cleft(), tree[right].cright()};
+    for (int l = 0; l < 4; ++l) {
+      tree[leaves[l]].set_leaf(0.1f * (l + 1) - 0.2f * i);
+      tree.stat(leaves[l]).sum_hess = 1.0f + l;
+    }
+    tree.stat(left).sum_hess = 3.0f;
+    tree.stat(right).sum_hess = 7.0f;
+    tree.stat(0).sum_hess = 10.0f;
+    model.CommitModel(std::move(trees), i % 2);
+  }
+
+  auto dmat = CreateDMatrix(21, 4, 0.3f);
+  std::vector<float> gpu_out;
+  std::vector<float> cpu_out;
+  gpu_predictor->PredictContribution(dmat.get(), &gpu_out, model);
+  cpu_predictor->PredictContribution(dmat.get(), &cpu_out, model);
+  ASSERT_EQ(gpu_out.size(), cpu_out.size());
+  for (size_t i = 0; i < gpu_out.size(); i++) {
+    ASSERT_NEAR(gpu_out[i], cpu_out[i], 1e-5);
+  }
+  gpu_predictor->PredictInteractionContributions(dmat.get(), &gpu_out, model);
+  cpu_predictor->PredictInteractionContributions(dmat.get(), &cpu_out, model);
+  ASSERT_EQ(gpu_out.size(), cpu_out.size());
+  for (size_t i = 0; i < gpu_out.size(); i++) {
+    ASSERT_NEAR(gpu_out[i], cpu_out[i], 1e-5);
+  }
+}
+
+TEST(gpu_predictor, Tiling) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  cpu_predictor->Init({}, {});
+
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 2;
+  model.param.num_feature = 5;
+  for (int i = 0; i < 64; ++i) {
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree()));
+    trees.back()->InitModel();
+    trees.back()->AddChilds(0);
+    (*trees.back())[0].set_split(i % 5, 0.1f * (i % 10), i % 2 == 0);
+    (*trees.back())[(*trees.back())[0].cleft()].set_leaf(-0.01f * i);
+    (*trees.back())[(*trees.back())[0].cright()].set_leaf(0.02f * i);
+    model.CommitModel(std::move(trees), i % 2);
+  }
+
+  auto dmat = CreateDMatrix(2000, 5, 0.2f);
+  HostDeviceVector<float> cpu_out_predictions;
+  cpu_predictor->PredictBatch(dmat.get(), &cpu_out_predictions, model, 0);
+  std::vector<float>& cpu_out_predictions_h = cpu_out_predictions.data_h();
+  for (const char* tiling : {"rows", "trees", "auto"}) {
+    std::unique_ptr<Predictor> gpu_predictor =
+        std::unique_ptr<Predictor>(Predictor::Create("gpu_predictor"));
+    gpu_predictor->Init({{"tiling", tiling}}, {});
+    HostDeviceVector<float> gpu_out_predictions;
+    gpu_predictor->PredictBatch(dmat.get(), &gpu_out_predictions, model, 0);
+    // trees [10, 30) only, the tile starts in the middle of the model
+    HostDeviceVector<float> gpu_out_limit;
+    HostDeviceVector<float> cpu_out_limit;
+    gpu_predictor->PredictBatch(dmat.get(), &gpu_out_limit, model, 10, 15);
+    cpu_predictor->PredictBatch(dmat.get(), &cpu_out_limit, model, 10, 15);
+    std::vector<float>& gpu_out_predictions_h = gpu_out_predictions.data_h();
+    ASSERT_EQ(gpu_out_predictions_h.size(), cpu_out_predictions_h.size());
+    for (size_t i = 0; i < gpu_out_predictions_h.size(); i++) {
+      ASSERT_NEAR(gpu_out_predictions_h[i], cpu_out_predictions_h[i], 1e-5);
+      ASSERT_NEAR(gpu_out_limit.data_h()[i], cpu_out_limit.data_h()[i], 1e-5);
+    }
+  }
+}
 }  // namespace predictor
 }  // namespace xgboost
@@ -0,0 +1,81 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/predictor.h>
+#include <random>
+#include "../helpers.h"
+
+namespace xgboost {
+
+TEST(cpu_quickscorer, PredictBatch) {
+  const int num_feature = 4;
+  const int num_group = 2;
+  std::mt19937 gen(7);
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < 10; ++i) {
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    trees.back()->InitModel();
+    GrowRandomTree(trees.back().get(), 0, 1 + i % 4, num_feature, &gen);
+  }
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = num_group;
+  model.param.num_feature = num_feature;
+  for (int gid = 0; gid < num_group; ++gid) {
+    std::vector<std::unique_ptr<RegTree>> group_trees;
+    for (int i = gid; i < 10; i += num_group) {
+      group_trees.push_back(std::move(trees[i]));
+    }
+    model.CommitModel(std::move(group_trees), gid);
+  }
+
+  auto dmat = CreateDMatrix(50, num_feature, 0.3f);
+  std::unique_ptr<Predictor> quickscorer =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_quickscorer"));
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  quickscorer->Init({}, {});
+  cpu_predictor->Init({}, {});
+
+  for (unsigned ntree_limit : {0U, 2U}) {
+    HostDeviceVector<float> qs_predictions;
+    HostDeviceVector<float> cpu_predictions;
+    quickscorer->PredictBatch(dmat.get(), &qs_predictions, model, 0, ntree_limit);
+    cpu_predictor->PredictBatch(dmat.get(), &cpu_predictions, model, 0, ntree_limit);
+    std::vector<float>& qs_predictions_h = qs_predictions.data_h();
+    std::vector<float>& cpu_predictions_h = cpu_predictions.data_h();
+    ASSERT_EQ(qs_predictions_h.size(), 50 * num_group);
+    ASSERT_EQ(cpu_predictions_h.size(), qs_predictions_h.size());
+    for (size_t i = 0; i < qs_predictions_h.size(); ++i) {
+      ASSERT_EQ(qs_predictions_h[i], cpu_predictions_h[i]);
+    }
+  }
+}
+
+TEST(cpu_quickscorer, DeepTree) {
+  // more than 64 leaves, falls back to plain traversal
+  std::mt19937 gen(3);
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  trees.back()->InitModel();
+  GrowRandomTree(trees.back().get(), 0, 7, 3, &gen);
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 3;
+  model.CommitModel(std::move(trees), 0);
+
+  auto dmat = CreateDMatrix(20, 3, 0.3f);
+  std::unique_ptr<Predictor> quickscorer =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_quickscorer"));
+  quickscorer->Init({}, {});
+  HostDeviceVector<float> out_predictions;
+  quickscorer->PredictBatch(dmat.get(), &out_predictions, model, 0);
+  std::vector<float>& out_predictions_h = out_predictions.data_h();
+  ASSERT_EQ(out_predictions_h.size(), 20);
+
+  auto batch = dmat->RowIterator()->Value();
+  for (size_t i = 0; i < batch.size; ++i) {
+    std::vector<float> instance_out_predictions;
+    quickscorer->PredictInstance(batch[i], &instance_out_predictions, model);
+    ASSERT_EQ(instance_out_predictions[0], out_predictions_h[i]);
+  }
+}
+}  // namespace xgboost
@@ -1,7 +1,10 @@
 // Copyright by Contributors
 #include <gtest/gtest.h>
+#include <dmlc/omp.h>
+#include <string>
 #include "helpers.h"
 #include "xgboost/learner.h"
+#include "../../src/common/io.h"
 
 namespace xgboost {
 TEST(learner, Test) {
@@ -11,4 +14,125 @@ TEST(learner, Test) {
   auto learner = std::unique_ptr<Learner>(Learner::Create(mat));
   learner->Configure(args);
 }
-}  // namespace xgboost
\ No newline at end of file
+
+TEST(learner, EvalSample) {
+  typedef std::pair<std::string, std::string> arg;
+  std::shared_ptr<DMatrix> train = CreateDMatrix(100, 5, 0, 1);
+  std::shared_ptr<DMatrix> eval = CreateDMatrix(2000, 5, 0, 2);
+  for (int i = 0; i < 100; ++i) train->info().labels.push_back(i % 2);
+  for (int i = 0; i < 2000; ++i) eval->info().labels.push_back(i % 2);
+  auto learner = std::unique_ptr<Learner>(Learner::Create({train, eval}));
+  learner->Configure({arg("eval_sample_rows", "500"), arg("eval_metric", "rmse"),
+                      arg("eval_metric", "error")});
+  learner->InitModel();
+  learner->UpdateOneIter(0, train.get());
+  std::string out = learner->EvalOneIter(0, {train.get(), eval.get()}, {"train", "eval"});
+  // the small matrix is evaluated in full, the large one on a sample
+  EXPECT_EQ(out.find("train-rmse-stderr"), std::string::npos);
+  EXPECT_NE(out.find("\teval-rmse-stderr:"), std::string::npos);
+  EXPECT_LT(out.find("eval-error-stderr:"), out.find("eval-error:"));
+  // the sample stays the same from one evaluation to the next
+  EXPECT_EQ(learner->EvalOneIter(0, {eval.get()}, {"eval"}),
+            learner->EvalOneIter(0, {eval.get()}, {"eval"}));
+  // a matrix out of the cache is evaluated in full
+  std::shared_ptr<DMatrix> other = CreateDMatrix(2000, 5, 0, 3);
+  for (int i = 0; i < 2000; ++i) other->info().labels.push_back(i % 2);
+  out = learner->EvalOneIter(0, {other.get()}, {"other"});
+  EXPECT_EQ(out.find("other-rmse-stderr"), std::string::npos);
+}
+
+TEST(learner, EarlyStopping) {
+  typedef std::pair<std::string, std::string> arg;
+  // the same rows with flipped labels, the gains on one are losses on the other
+  std::shared_ptr<DMatrix> train = CreateDMatrix(100, 5, 0, 1);
+  std::shared_ptr<DMatrix> flipped = CreateDMatrix(100, 5, 0, 1);
+  for (int i = 0; i < 100; ++i) {
+    train->info().labels.push_back(i % 2);
+    flipped->info().labels.push_back(1 - i % 2);
+  }
+  auto learner = std::unique_ptr<Learner>(Learner::Create({train, flipped}));
+  learner->Configure({arg("eval_metric", "rmse"), arg("eval_metric", "auc"),
+                      arg("early_stopping_rounds", "2"),
+                      arg("early_stopping_data", "flipped"),
+                      arg("num_parallel_tree", "2")});
+  learner->InitModel();
+  std::vector<bst_float> results;
+  int iter = 0;
+  for (; iter < 10 && !learner->EarlyStopped(); ++iter) {
+    learner->UpdateOneIter(iter, train.get());
+    learner->EvalOneIter(iter, {train.get(), flipped.get()}, {"train", "flipped"}, &results);
+    ASSERT_EQ(results.size(), 4);
+  }
+  // the metrics of each set together, in the order of their names
+  EXPECT_EQ(learner->GetMetricNames(), std::vector<std::string>({"rmse", "auc"}));
+  std::string best;
+  ASSERT_TRUE(learner->GetAttr("best_iteration", &best));
+  EXPECT_EQ(best, "0");
+  ASSERT_TRUE(learner->GetAttr("best_ntree_limit", &best));
+  EXPECT_EQ(best, "2");
+  EXPECT_EQ(iter, 3);
+
+  // a metric where higher is better does not stop on the training set
+  learner.reset(Learner::Create({train}));
+  learner->Configure({arg("eval_metric", "auc"), arg("early_stopping_rounds", "1")});
+  learner->InitModel();
+  for (iter = 0; iter < 3; ++iter) {
+    learner->UpdateOneIter(iter, train.get());
+    learner->EvalOneIter(iter, {train.get()}, {"train"}, &results);
+  }
+  EXPECT_FALSE(learner->EarlyStopped());
+}
+
+TEST(learner, ThreadScope) {
+  typedef std::pair<std::string, std::string> arg;
+  std::shared_ptr<DMatrix> train = CreateDMatrix(50, 5, 0, 1);
+  for (int i = 0; i < 50; ++i) train->info().labels.push_back(i % 2);
+  const int nthread = omp_get_max_threads();
+  omp_set_num_threads(3);
+  // the number of threads of the booster does not leak out of its calls
+  auto learner = std::unique_ptr<Learner>(Learner::Create({train}));
+  learner->Configure({arg("nthread", "2")});
+  learner->InitModel();
+  EXPECT_EQ(omp_get_max_threads(), 3);
+  learner->UpdateOneIter(0, train.get());
+  EXPECT_EQ(omp_get_max_threads(), 3);
+  HostDeviceVector<bst_float> preds;
+  learner->Predict(train.get(), false, &preds);
+  EXPECT_EQ(preds.size(), 50);
+  learner->EvalOneIter(0, {train.get()}, {"train"});
+  EXPECT_EQ(omp_get_max_threads(), 3);
+  omp_set_num_threads(nthread);
+}
+}  // namespace xgboost
+
+namespace xgboost {
+TEST(learner, DumpModelStream) {
+  typedef std::pair<std::string, std::string> arg;
+  std::shared_ptr<DMatrix> train = CreateDMatrix(100, 5, 0, 1);
+  for (int i = 0; i < 100; ++i) train->info().labels.push_back(i % 2);
+  auto learner = std::unique_ptr<Learner>(Learner::Create({train}));
+  learner->Configure({arg("max_depth", "3"), arg("silent", "1")});
+  learner->InitModel();
+  for (int iter = 0; iter < 3; ++iter) learner->UpdateOneIter(iter, train.get());
+  for (const char* format : {"text", "json", "json_compact"}) {
+    std::vector<std::string> dump = learner->DumpModel(FeatureMap(), true, format);
+    ASSERT_EQ(dump.size(), 3U);
+    std::string expected;
+    const bool json = std::string(format) != "text";
+    if (json) expected += "[\n";
+    for (size_t i = 0; i < dump.size(); ++i) {
+      if (json) {
+        if (i != 0) expected += ",\n";
+      } else {
+        expected += "booster[" + std::to_string(i) + "]:\n";
+      }
+      expected += dump[i];
+    }
+    if (json) expected += "\n]\n";
+    std::string streamed;
+    common::MemoryBufferStream fo(&streamed);
+    learner->DumpModel(FeatureMap(), true, format, &fo);
+    EXPECT_EQ(streamed, expected) << format;
+  }
+}
+}  // namespace xgboost
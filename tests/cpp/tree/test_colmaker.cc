@@ -0,0 +1,92 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <dmlc/omp.h>
+#include <xgboost/c_api.h>
+#include <xgboost/tree_updater.h>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "../helpers.h"
+
+namespace xgboost {
+
+TEST(ColMaker, ReuseBuilder) {
+  const size_t nrow = 200;
+  auto dmat = CreateDMatrix(nrow, 5, 0.1f);
+  dmat->InitColAccess(std::vector<bool>(5, true), 1.0f, nrow, true);
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f, 1.0f);
+  }
+  std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_colmaker"));
+  updater->Init({{"max_depth", "8"}, {"min_child_weight", "4"}});
+  // the second tree starts from the buffers and the compacted columns of the first
+  RegTree trees[2];
+  for (int i = 0; i < 2; ++i) {
+    trees[i].InitModel();
+    updater->Update(&gpair, dmat.get(), {&trees[i]});
+  }
+  ASSERT_GT(trees[0].param.num_nodes, 8);
+  ExpectSameTree(trees[0], trees[1]);
+}
+
+TEST(ColMaker, BalancedParallelOption) {
+  // feature 0 is dense, the others have few entries
+  const int nrow = 6000, ncol = 40;
+  std::vector<float> data(nrow * ncol, NAN);
+  for (int i = 0; i < nrow; ++i) {
+    data[i * ncol] = static_cast<float>((i * 7919) % 1000);
+    for (int j = 1; j < ncol; ++j) {
+      if ((i + j * 13) % (j + 20) == 0) data[i * ncol + j] = static_cast<float>(i % (j + 3));
+    }
+  }
+  DMatrixHandle handle;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), nrow, ncol, NAN, &handle), 0);
+  std::shared_ptr<DMatrix> dmat = *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  XGDMatrixFree(handle);
+  dmat->InitColAccess(std::vector<bool>(ncol, true), 1.0f, nrow, true);
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f + (i % 1000) * 1e-3f, 1.0f);
+  }
+  const int nthread = omp_get_max_threads();
+  omp_set_num_threads(4);
+  // the dense feature is split among the threads, the sparse ones are packed
+  RegTree trees[2];
+  const char* options[] = {"0", "2"};
+  for (int i = 0; i < 2; ++i) {
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_colmaker"));
+    updater->Init({{"max_depth", "6"}, {"parallel_option", options[i]}});
+    trees[i].InitModel();
+    updater->Update(&gpair, dmat.get(), {&trees[i]});
+  }
+  omp_set_num_threads(nthread);
+  ASSERT_GT(trees[0].param.num_nodes, 8);
+  ExpectSameTree(trees[0], trees[1]);
+}
+TEST(ColMaker, DeterministicReduction) {
+  const size_t nrow = 3000;
+  auto dmat = CreateDMatrix(nrow, 6, 0.2f);
+  dmat->InitColAccess(std::vector<bool>(6, true), 1.0f, nrow, true);
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f + (i % 997) * 1e-4f,
+                                  0.5f + (i % 7) * 0.1f);
+  }
+  const int nthread = omp_get_max_threads();
+  // the node statistics are summed in row order, the features by one thread
+  RegTree trees[2];
+  const int nthreads[] = {1, 4};
+  for (int i = 0; i < 2; ++i) {
+    omp_set_num_threads(nthreads[i]);
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_colmaker"));
+    updater->Init({{"max_depth", "6"}, {"parallel_option", "1"},
+                   {"deterministic_reduction", "1"}});
+    trees[i].InitModel();
+    updater->Update(&gpair, dmat.get(), {&trees[i]});
+  }
+  omp_set_num_threads(nthread);
+  ASSERT_GT(trees[0].param.num_nodes, 8);
+  ExpectSameTree(trees[0], trees[1]);
+}
+}  // namespace xgboost
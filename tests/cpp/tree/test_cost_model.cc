@@ -0,0 +1,40 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/data.h>
+#include "../../../src/tree/cost_model.h"
+
+namespace xgboost {
+namespace tree {
+namespace {
+MetaInfo Shape(uint64_t num_row, uint64_t num_col, double density) {
+  MetaInfo info;
+  info.num_row = num_row;
+  info.num_col = num_col;
+  info.num_nonzero = static_cast<uint64_t>(num_row * num_col * density);
+  return info;
+}
+}  // namespace
+
+TEST(TreeMethodCost, Best) {
+  // small matrices are cheapest with the exact method
+  EXPECT_EQ(TreeMethodCost::Estimate(Shape(1000, 10, 1.0), 8, 6, 256, 0).Best(), "exact");
+  // large ones with hist, and gpu_hist when there is a device
+  EXPECT_EQ(TreeMethodCost::Estimate(Shape(1 << 20, 100, 1.0), 8, 6, 256, 0).Best(), "hist");
+  EXPECT_EQ(TreeMethodCost::Estimate(Shape(1 << 20, 100, 1.0), 8, 6, 256, 1).Best(),
+            "gpu_hist");
+  EXPECT_EQ(TreeMethodCost::Estimate(Shape(1000, 10, 1.0), 8, 6, 256, 1).Best(), "exact");
+  // very sparse wide matrices scan few entries against many bins
+  EXPECT_EQ(TreeMethodCost::Estimate(Shape(100000, 50000, 0.0005), 8, 8, 256, 0).Best(),
+            "exact");
+
+  TreeMethodCost cost = TreeMethodCost::Estimate(Shape(1 << 20, 100, 1.0), 8, 6, 256, 0);
+  EXPECT_GT(cost.approx, cost.exact);
+  EXPECT_TRUE(std::isinf(cost.gpu_hist));
+  EXPECT_EQ(cost.ToString().find("gpu_hist"), std::string::npos);
+  // the matrices that do not count the entries are taken as dense
+  MetaInfo uncounted = Shape(1 << 20, 100, 1.0);
+  uncounted.num_nonzero = 0;
+  EXPECT_DOUBLE_EQ(TreeMethodCost::Estimate(uncounted, 8, 6, 256, 0).hist, cost.hist);
+}
+}  // namespace tree
+}  // namespace xgboost
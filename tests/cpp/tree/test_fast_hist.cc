@@ -0,0 +1,342 @@
+// Copyright by Contributors
+#include <dmlc/omp.h>
+#include <gtest/gtest.h>
+#include <xgboost/gbm.h>
+#include <xgboost/tree_updater.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../helpers.h"
+#include "../../../src/common/random.h"
+#include "../../../src/common/timer.h"
+
+namespace xgboost {
+// source over the rows of another DMatrix in batches of page_rows,
+// as for external memory data
+class PagedSource : public DataSource {
+ public:
+  PagedSource(DMatrix* parent, size_t page_rows) : page_rows_(page_rows), pos_(0) {
+    info.num_row = parent->info().num_row;
+    info.num_col = parent->info().num_col;
+    info.num_nonzero = parent->info().num_nonzero;
+    dmlc::DataIter<RowBatch>* iter = parent->RowIterator();
+    iter->BeforeFirst();
+    CHECK(iter->Next());
+    parent_ = iter->Value();
+  }
+  bool Next() override {
+    if (pos_ >= info.num_row) return false;
+    batch_.base_rowid = pos_;
+    batch_.size = std::min(page_rows_, info.num_row - pos_);
+    batch_.ind_ptr = parent_.ind_ptr + pos_;
+    batch_.data_ptr = parent_.data_ptr;
+    pos_ += batch_.size;
+    return true;
+  }
+  void BeforeFirst() override {
+    pos_ = 0;
+  }
+  const RowBatch& Value() const override {
+    return batch_;
+  }
+
+ private:
+  RowBatch parent_, batch_;
+  size_t page_rows_, pos_;
+};
+
+TEST(FastHistMaker, ExternalMemory) {
+  const size_t nrow = 1000;
+  auto dmat = CreateDMatrix(nrow, 6, 0.2f);
+  std::unique_ptr<DMatrix> paged(DMatrix::Create(
+      std::unique_ptr<DataSource>(new PagedSource(dmat.get(), 128))));
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f, 1.0f);
+  }
+  const std::string page_file = TempFileName();
+  std::vector<std::pair<std::string, std::string> > args{
+    {"max_depth", "4"}, {"hist_page_file", page_file}};
+
+  RegTree trees[3];
+  DMatrix* data[3] = {dmat.get(), paged.get(), paged.get()};
+  for (int i = 0; i < 3; ++i) {
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_fast_histmaker"));
+    // the pages are not shared, each updater reads its own
+    if (i == 2) args.emplace_back("share_quantized_data", "1");
+    updater->Init(args);
+    trees[i].InitModel();
+    updater->Update(&gpair, data[i], {&trees[i]});
+  }
+  ASSERT_TRUE(FileExists(page_file));
+  std::remove(page_file.c_str());
+
+  // the pages give the same tree as the data in memory
+  ASSERT_GT(trees[0].param.num_nodes, 8);
+  ExpectSameTree(trees[0], trees[1], 1e-5);
+  ExpectSameTree(trees[0], trees[2], 1e-5);
+}
+
+TEST(FastHistMaker, ExternalMemoryConcurrentTrees) {
+  typedef std::pair<std::string, std::string> arg;
+  const size_t nrow = 600;
+  auto dmat = CreateDMatrix(nrow, 6, 0.2f);
+  std::shared_ptr<DMatrix> paged(DMatrix::Create(
+      std::unique_ptr<DataSource>(new PagedSource(dmat.get(), 128))));
+  const std::string page_file = TempFileName();
+  const int nthread = omp_get_max_threads();
+  omp_set_num_threads(4);
+  // the jobs cannot share the pages, the trees are built in turn
+  std::vector<std::vector<bst_float> > preds;
+  for (const char* njob : {"1", "3"}) {
+    std::vector<arg> cfg = {arg("num_feature", "6"), arg("num_parallel_tree", "3"),
+                            arg("max_depth", "3"), arg("silent", "1"),
+                            arg("updater", "grow_fast_histmaker"),
+                            arg("hist_page_file", page_file), arg("concurrent_trees", njob)};
+    std::unique_ptr<GradientBooster> gbm(GradientBooster::Create("gbtree", {paged}, 0.5f));
+    gbm->Configure(cfg);
+    HostDeviceVector<bst_gpair> gpair(nrow);
+    HostDeviceVector<bst_float> out;
+    for (int iter = 0; iter < 3; ++iter) {
+      gbm->PredictBatch(paged.get(), &out, 0);
+      for (size_t i = 0; i < nrow; ++i) {
+        gpair.data_h()[i] = bst_gpair(out.data_h()[i] - static_cast<float>(i % 3 == 0), 1.0f);
+      }
+      gbm->DoBoost(paged.get(), &gpair, nullptr);
+    }
+    gbm->PredictBatch(paged.get(), &out, 0);
+    preds.push_back(out.data_h());
+  }
+  omp_set_num_threads(nthread);
+  std::remove(page_file.c_str());
+  ASSERT_EQ(preds[0].size(), nrow);
+  ASSERT_EQ(preds[1].size(), nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    ASSERT_NEAR(preds[0][i], preds[1][i], 1e-4);
+  }
+}
+
+TEST(FastHistMaker, SinglePrecisionHistogram) {
+  const size_t nrow = 1000;
+  auto dmat = CreateDMatrix(nrow, 6, 0.2f);
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f, 1.0f);
+  }
+  RegTree trees[2];
+  const char* precision[2] = {"0", "1"};
+  for (int i = 0; i < 2; ++i) {
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_fast_histmaker"));
+    updater->Init({{"max_depth", "4"}, {"single_precision_histogram", precision[i]}});
+    trees[i].InitModel();
+    updater->Update(&gpair, dmat.get(), {&trees[i]});
+  }
+
+  // float sums are accurate enough to find the same splits
+  ASSERT_GT(trees[0].param.num_nodes, 8);
+  ExpectSameTree(trees[0], trees[1], 1e-4);
+}
+
+TEST(FastHistMaker, SparseNodeFeatures) {
+  const size_t nrow = 2000;
+  // about six entries per row
+  auto dmat = CreateDMatrix(nrow, 200, 0.97f);
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f, 1.0f);
+  }
+  RegTree trees[2];
+  // a zero threshold turns the feature bitmaps of the nodes off
+  const char* threshold[2] = {"0", "0.2"};
+  for (int i = 0; i < 2; ++i) {
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_fast_histmaker"));
+    updater->Init({{"max_depth", "6"}, {"node_feature_threshold", threshold[i]}});
+    trees[i].InitModel();
+    updater->Update(&gpair, dmat.get(), {&trees[i]});
+  }
+
+  // skipping the features without entries in a node gives the same tree
+  ASSERT_GT(trees[0].param.num_nodes, 16);
+  ExpectSameTree(trees[0], trees[1], 1e-5);
+}
+
+TEST(FastHistMaker, ColumnSplit) {
+  const size_t nrow = 1000;
+  auto dmat = CreateDMatrix(nrow, 8, 0.3f);
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f, 1.0f);
+  }
+  RegTree trees[2];
+  const char* dsplit[2] = {"row", "col"};
+  for (int i = 0; i < 2; ++i) {
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_fast_histmaker"));
+    updater->Init({{"max_depth", "5"}, {"dsplit", dsplit[i]}});
+    trees[i].InitModel();
+    updater->Update(&gpair, dmat.get(), {&trees[i]});
+  }
+
+  // on a single worker, whose features are all of them, the reduced splits
+  // and row bitmaps give the same tree
+  ASSERT_GT(trees[0].param.num_nodes, 8);
+  ExpectSameTree(trees[0], trees[1], 1e-5);
+}
+
+TEST(FastHistMaker, ContiguousGradients) {
+  const size_t nrow = 2000;
+  auto dmat = CreateDMatrix(nrow, 8, 0.3f);
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f, 1.0f);
+  }
+  RegTree trees[2];
+  const char* contiguous[2] = {"0", "1"};
+  for (int i = 0; i < 2; ++i) {
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_fast_histmaker"));
+    updater->Init({{"max_depth", "6"}, {"contiguous_gradients", contiguous[i]}});
+    trees[i].InitModel();
+    updater->Update(&gpair, dmat.get(), {&trees[i]});
+  }
+
+  // the gradients moved with the rows give the same sums
+  ASSERT_GT(trees[0].param.num_nodes, 16);
+  ExpectSameTree(trees[0], trees[1], 1e-5);
+}
+
+TEST(FastHistMaker, SharedQuantizedData) {
+  const size_t nrow = 2000;
+  auto dmat = CreateDMatrix(nrow, 8, 0.3f);
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 13) - 0.6f, 1.0f);
+  }
+  // the quantized matrix built by the first updater outlives it
+  RegTree trees[3];
+  const char* share[3] = {"0", "1", "1"};
+  for (int i = 0; i < 3; ++i) {
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_fast_histmaker"));
+    updater->Init({{"max_depth", "5"}, {"share_quantized_data", share[i]}});
+    trees[i].InitModel();
+    updater->Update(&gpair, dmat.get(), {&trees[i]});
+  }
+  ASSERT_GT(trees[0].param.num_nodes, 16);
+  ExpectSameTree(trees[0], trees[1], 1e-6);
+  ExpectSameTree(trees[0], trees[2], 1e-6);
+
+  int ncreate = 0;
+  auto create = [&ncreate]() { ++ncreate; return std::make_shared<int>(1); };
+  std::shared_ptr<void> a = dmat->DerivedData("key", create);
+  std::shared_ptr<void> b = dmat->DerivedData("key", create);
+  std::shared_ptr<void> c = dmat->DerivedData("other", create);
+  ASSERT_EQ(a, b);
+  ASSERT_NE(a, c);
+  ASSERT_EQ(ncreate, 2);
+}
+
+TEST(FastHistMaker, IncrementalRootHistogram) {
+  const size_t nrow = 3000;
+  auto dmat = CreateDMatrix(nrow, 8, 0.3f);
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f, 1.0f);
+  }
+  std::unique_ptr<TreeUpdater> full(TreeUpdater::Create("grow_fast_histmaker"));
+  std::unique_ptr<TreeUpdater> incremental(TreeUpdater::Create("grow_fast_histmaker"));
+  full->Init({{"max_depth", "5"}});
+  incremental->Init({{"max_depth", "5"}, {"incremental_root_histogram", "1"}});
+  common::Profiler::Get()->Clear();
+  for (int iter = 0; iter < 4; ++iter) {
+    // a few rows change, then all of them in the last iteration
+    std::vector<bst_gpair>& gpair_h = gpair.data_h();
+    for (size_t i = 0; i < nrow; ++i) {
+      if (iter == 3 || i % 97 == static_cast<size_t>(iter)) {
+        gpair_h[i] = bst_gpair(gpair_h[i].GetGrad() * 0.7f + 0.05f * iter,
+                               gpair_h[i].GetHess() * 0.9f);
+      }
+    }
+    RegTree trees[2];
+    trees[0].InitModel();
+    trees[1].InitModel();
+    full->Update(&gpair, dmat.get(), {&trees[0]});
+    incremental->Update(&gpair, dmat.get(), {&trees[1]});
+    ASSERT_GT(trees[0].param.num_nodes, 8);
+    ExpectSameTree(trees[0], trees[1], 1e-5);
+  }
+  // the roots of the second and third trees are updated, the last one is built
+  EXPECT_EQ(common::Profiler::Get()->Counters()["FastHistMaker.BuildHist.root_reuses"], 2U);
+}
+
+TEST(FastHistMaker, QuantizedCacheFile) {
+  const size_t nrow = 1000;
+  // two dense matrices of the same shape with other values
+  auto first = CreateDMatrix(nrow, 8, 0.0f, 0);
+  auto second = CreateDMatrix(nrow, 8, 0.0f, 1);
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f, 1.0f);
+  }
+  const std::string cache_file = TempFileName();
+  auto grow = [&](DMatrix* dmat, bool cached, RegTree* tree) {
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_fast_histmaker"));
+    updater->Init({{"max_depth", "4"}, {"hist_cache_file", cached ? cache_file : ""}});
+    tree->InitModel();
+    updater->Update(&gpair, dmat, {tree});
+  };
+
+  RegTree trees[4];
+  grow(first.get(), true, &trees[0]);
+  ASSERT_TRUE(FileExists(cache_file));
+  // the cache of the first matrix is loaded for it and ignored for the second
+  grow(first.get(), true, &trees[1]);
+  grow(second.get(), true, &trees[2]);
+  grow(second.get(), false, &trees[3]);
+  std::remove(cache_file.c_str());
+  ASSERT_GT(trees[0].param.num_nodes, 8);
+  ExpectSameTree(trees[0], trees[1], 1e-5);
+  ExpectSameTree(trees[3], trees[2], 1e-5);
+}
+
+TEST(FastHistMaker, GOSS) {
+  const size_t nrow = 40000;
+  auto dmat = CreateDMatrix(nrow, 6, 0.2f);
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f, 1.0f);
+  }
+  auto grow = [&](const std::vector<std::pair<std::string, std::string> >& args,
+                  RegTree* tree) {
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_fast_histmaker"));
+    updater->Init(args);
+    tree->InitModel();
+    common::GlobalRandom().seed(7);
+    updater->Update(&gpair, dmat.get(), {tree});
+  };
+
+  // keeping all the rows as top rows gives the tree without sampling
+  RegTree full, all_top;
+  grow({{"max_depth", "4"}}, &full);
+  grow({{"max_depth", "4"}, {"sampling_method", "goss"},
+        {"goss_top_rate", "1"}, {"goss_other_rate", "0"}}, &all_top);
+  ASSERT_GT(full.param.num_nodes, 8);
+  ExpectSameTree(full, all_top, 1e-5);
+
+  // the rows are sampled the same way whatever the number of threads
+  RegTree sampled[2];
+  const int nthread = omp_get_max_threads();
+  for (int i = 0; i < 2; ++i) {
+    omp_set_num_threads(i == 0 ? 1 : 4);
+    grow({{"max_depth", "4"}, {"sampling_method", "goss"}}, &sampled[i]);
+  }
+  omp_set_num_threads(nthread);
+  ExpectSameTree(sampled[0], sampled[1], 1e-5);
+
+  // the scaled sample of the small gradients keeps the hessian sum close to
+  // the number of rows
+  const double sum_hess = sampled[0].stat(0).sum_hess;
+  EXPECT_NEAR(sum_hess, static_cast<double>(nrow), 0.05 * nrow);
+  EXPECT_THROW(grow({{"sampling_method", "goss"}, {"goss_top_rate", "0.7"},
+                     {"goss_other_rate", "0.5"}}, &sampled[0]), dmlc::Error);
+}
+}  // namespace xgboost
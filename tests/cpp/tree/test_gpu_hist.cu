@@ -4,6 +4,9 @@
  */
 #include <thrust/device_vector.h>
 #include <xgboost/base.h>
+#include <map>
+#include <string>
+#include <vector>
 #include "../helpers.h"
 #include "gtest/gtest.h"
 
@@ -24,6 +27,9 @@ TEST(gpu_hist_experimental, TestSparseShard) {
   gmat.Init(dmat.get());
   TrainParam p;
   p.max_depth = 6;
+  p.gpu_page_rows = 0;
+  p.gpu_managed_memory = false;
+  p.gpu_quantized_histogram = false;
   DeviceShard shard(0, 0, gmat, 0, rows, hmat.row_ptr.back(),
                     p);
 
@@ -59,6 +65,9 @@ TEST(gpu_hist_experimental, TestDenseShard) {
   gmat.Init(dmat.get());
   TrainParam p;
   p.max_depth = 6;
+  p.gpu_page_rows = 0;
+  p.gpu_managed_memory = false;
+  p.gpu_quantized_histogram = false;
   DeviceShard shard(0, 0, gmat, 0, rows, hmat.row_ptr.back(),
                     p);
 
@@ -74,5 +83,85 @@ TEST(gpu_hist_experimental, TestDenseShard) {
   }
 }
 
+TEST(gpu_hist_experimental, TestPagedShard) {
+  int rows = 100;
+  int columns = 80;
+  int max_bins = 4;
+  auto dmat = CreateDMatrix(rows, columns, 0.9f);
+  common::HistCutMatrix hmat;
+  common::GHistIndexMatrix gmat;
+  hmat.Init(dmat.get(), max_bins);
+  gmat.cut = &hmat;
+  gmat.Init(dmat.get());
+  TrainParam p;
+  p.max_depth = 6;
+  p.gpu_page_rows = 30;
+  p.gpu_managed_memory = false;
+  p.gpu_quantized_histogram = false;
+  DeviceShard shard(0, 0, gmat, 0, rows, hmat.row_ptr.back(),
+                    p);
+
+  ASSERT_TRUE(shard.paged);
+  ASSERT_EQ(shard.NumPages(), 4);
+
+  for (int i = 0; i < rows; i++) {
+    int page = i / p.gpu_page_rows;
+    common::CompressedIterator<uint32_t> gidx(
+        shard.host_pages + page * shard.page_bytes, hmat.row_ptr.back() + 1);
+    int row_begin = (i - page * p.gpu_page_rows) * shard.row_stride;
+    int row_offset = 0;
+    for (auto j = gmat.row_ptr[i]; j < gmat.row_ptr[i + 1]; j++) {
+      ASSERT_EQ(gidx[row_begin + row_offset], gmat.index[j]);
+      row_offset++;
+    }
+
+    for (; row_offset < shard.row_stride; row_offset++) {
+      ASSERT_EQ(gidx[row_begin + row_offset], shard.null_gidx_value);
+    }
+  }
+}
+
+TEST(gpu_hist_experimental, TestHistogramKernels) {
+  int rows = 1000;
+  int columns = 10;
+  int max_bins = 16;
+  auto dmat = CreateDMatrix(rows, columns, 0.3f);
+  common::HistCutMatrix hmat;
+  common::GHistIndexMatrix gmat;
+  hmat.Init(dmat.get(), max_bins);
+  gmat.cut = &hmat;
+  gmat.Init(dmat.get());
+  const int n_bins = hmat.row_ptr.back();
+  HostDeviceVector<bst_gpair> gpair(rows);
+  std::vector<double> expected(n_bins * 2, 0.0);
+  for (int i = 0; i < rows; ++i) {
+    bst_gpair g(0.1f * (i % 11) - 0.5f, 0.01f * (i % 7) + 0.1f);
+    gpair.data_h()[i] = g;
+    for (auto j = gmat.row_ptr[i]; j < gmat.row_ptr[i + 1]; ++j) {
+      expected[gmat.index[j] * 2] += g.GetGrad();
+      expected[gmat.index[j] * 2 + 1] += g.GetHess();
+    }
+  }
+
+  // the shared memory and the fixed point sums give the same histogram
+  for (const char* shared : {"0", "1"}) {
+    for (const char* quantized : {"0", "1"}) {
+      TrainParam p;
+      p.InitAllowUnknown(std::map<std::string, std::string>{
+          {"max_depth", "6"},
+          {"gpu_shared_memory_histogram", shared},
+          {"gpu_quantized_histogram", quantized}});
+      DeviceShard shard(0, 0, gmat, 0, rows, n_bins, p);
+      shard.Reset(&gpair, 0);
+      shard.BuildHist({0});
+      std::vector<gpair_sum_t> hist = shard.hist.data.as_vector();
+      for (int bin = 0; bin < n_bins; ++bin) {
+        ASSERT_NEAR(hist[bin].GetGrad(), expected[bin * 2], 1e-4);
+        ASSERT_NEAR(hist[bin].GetHess(), expected[bin * 2 + 1], 1e-4);
+      }
+    }
+  }
+}
+
 }  // namespace tree
 }  // namespace xgboost
\ No newline at end of file
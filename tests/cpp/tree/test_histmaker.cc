@@ -0,0 +1,100 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/c_api.h>
+#include <xgboost/tree_updater.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../helpers.h"
+
+namespace xgboost {
+namespace {
+std::string DumpTree(const RegTree& tree) {
+  return tree.DumpModel(FeatureMap(), true, "text");
+}
+}  // namespace
+
+TEST(GlobalProposalHistMaker, ReuseRootProposal) {
+  const int nrow = 1000, ncol = 6;
+  // feature 0 grows with the row index
+  std::vector<float> data(nrow * ncol);
+  for (int i = 0; i < nrow; ++i) {
+    data[i * ncol] = static_cast<float>(i) / nrow;
+    for (int j = 1; j < ncol; ++j) {
+      data[i * ncol + j] = static_cast<float>((i * (j + 3) * 7919) % 1000) / 1000;
+    }
+  }
+  DMatrixHandle handle;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), nrow, ncol, -1.0f, &handle), 0);
+  std::shared_ptr<DMatrix> dmat = *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  XGDMatrixFree(handle);
+  dmat->InitColAccess(std::vector<bool>(ncol, true), 1.0f, nrow, true);
+  // the second gradients put most of the hessian on the first rows
+  HostDeviceVector<bst_gpair> gpair_a(nrow), gpair_b(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    gpair_a.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f, 1.0f);
+    gpair_b.data_h()[i] = bst_gpair(0.1f * (i % 7) - 0.3f, i < nrow / 4 ? 10.0f : 0.1f);
+  }
+  std::vector<std::pair<std::string, std::string> > args =
+      {{"max_depth", "4"}, {"max_proposal_reuse", "3"}};
+  std::unique_ptr<TreeUpdater> reuse(TreeUpdater::Create("grow_histmaker"));
+  reuse->Init(args);
+  std::unique_ptr<TreeUpdater> fresh(TreeUpdater::Create("grow_histmaker"));
+  fresh->Init({{"max_depth", "4"}});
+
+  RegTree trees[4], expected[2];
+  HostDeviceVector<bst_gpair>* gpairs[] = {&gpair_a, &gpair_a, &gpair_b, &gpair_b};
+  for (int i = 0; i < 4; ++i) {
+    trees[i].param.num_feature = ncol;
+    trees[i].InitModel();
+    reuse->Update(gpairs[i], dmat.get(), {&trees[i]});
+  }
+  for (int i = 0; i < 2; ++i) {
+    expected[i].param.num_feature = ncol;
+    expected[i].InitModel();
+    fresh->Update(i == 0 ? &gpair_a : &gpair_b, dmat.get(), {&expected[i]});
+  }
+  // the same gradients give the same proposal
+  ASSERT_EQ(DumpTree(trees[0]), DumpTree(expected[0]));
+  ASSERT_EQ(DumpTree(trees[1]), DumpTree(expected[0]));
+  // the third tree uses the old proposal and detects the drift of the
+  // hessian, the fourth sketches again
+  ASSERT_NE(DumpTree(trees[2]), DumpTree(expected[1]));
+  ASSERT_EQ(DumpTree(trees[3]), DumpTree(expected[1]));
+}
+
+TEST(GlobalProposalHistMaker, CompressedAllreduce) {
+  const size_t nrow = 500;
+  auto dmat = CreateDMatrix(nrow, 8, 0.6f);
+  dmat->InitColAccess(std::vector<bool>(8, true), 1.0f, nrow, true);
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.1f * (i % 11) - 0.5f, 1.0f);
+  }
+  const char* options[][2] = {{"0", "0"}, {"0", "1"}, {"1", "0"}, {"1", "1"}};
+  RegTree trees[4];
+  for (int i = 0; i < 4; ++i) {
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_histmaker"));
+    updater->Init({{"max_depth", "5"}, {"hist_allreduce_float", options[i][0]},
+                   {"hist_allreduce_sparse", options[i][1]}});
+    trees[i].param.num_feature = 8;
+    trees[i].InitModel();
+    updater->Update(&gpair, dmat.get(), {&trees[i]});
+  }
+  ASSERT_GT(trees[0].param.num_nodes, 8);
+  // the sparse encoding is exact, single precision only rounds the sums
+  ASSERT_EQ(DumpTree(trees[1]), DumpTree(trees[0]));
+  for (int i = 2; i < 4; ++i) {
+    ASSERT_EQ(trees[i].param.num_nodes, trees[0].param.num_nodes);
+    for (int nid = 0; nid < trees[0].param.num_nodes; ++nid) {
+      ASSERT_EQ(trees[i][nid].is_leaf(), trees[0][nid].is_leaf());
+      if (trees[0][nid].is_leaf()) {
+        ASSERT_NEAR(trees[i][nid].leaf_value(), trees[0][nid].leaf_value(), 1e-5);
+      } else {
+        ASSERT_EQ(trees[i][nid].split_index(), trees[0][nid].split_index());
+      }
+    }
+  }
+}
+}  // namespace xgboost
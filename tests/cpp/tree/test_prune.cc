@@ -0,0 +1,98 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <dmlc/omp.h>
+#include <xgboost/tree_updater.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../helpers.h"
+
+namespace xgboost {
+namespace {
+// grow ntree trees on different gradients of a matrix
+std::vector<RegTree> GrowTrees(DMatrix* dmat, int ntree) {
+  const size_t nrow = dmat->info().num_row;
+  std::unique_ptr<TreeUpdater> grower(TreeUpdater::Create("grow_colmaker"));
+  grower->Init({{"max_depth", "6"}, {"min_child_weight", "1"}});
+  std::vector<RegTree> trees(ntree);
+  for (int t = 0; t < ntree; ++t) {
+    HostDeviceVector<bst_gpair> gpair(nrow);
+    for (size_t i = 0; i < nrow; ++i) {
+      gpair.data_h()[i] = bst_gpair(0.1f * ((i * (t + 3)) % 13) - 0.6f, 1.0f);
+    }
+    trees[t].param.num_feature = static_cast<int>(dmat->info().num_col);
+    trees[t].InitModel();
+    grower->Update(&gpair, dmat, {&trees[t]});
+  }
+  return trees;
+}
+
+std::vector<RegTree*> Pointers(std::vector<RegTree>* trees) {
+  std::vector<RegTree*> out;
+  for (RegTree& tree : *trees) out.push_back(&tree);
+  return out;
+}
+}  // namespace
+
+TEST(TreePruner, ParallelOverTrees) {
+  const size_t nrow = 300;
+  auto dmat = CreateDMatrix(nrow, 5, 0.1f);
+  dmat->InitColAccess(std::vector<bool>(5, true), 1.0f, nrow, true);
+  std::vector<RegTree> serial = GrowTrees(dmat.get(), 6);
+  std::vector<RegTree> parallel = serial;
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  const int nthread = omp_get_max_threads();
+  for (int n : {1, 4}) {
+    std::unique_ptr<TreeUpdater> pruner(TreeUpdater::Create("prune"));
+    pruner->Init({{"min_split_loss", "3"}, {"max_depth", "3"}});
+    omp_set_num_threads(n);
+    pruner->Update(&gpair, dmat.get(), Pointers(n == 1 ? &serial : &parallel));
+  }
+  omp_set_num_threads(nthread);
+  for (size_t t = 0; t < serial.size(); ++t) {
+    ASSERT_GT(serial[t].param.num_deleted, 0);
+    ASSERT_LE(serial[t].MaxDepth(), 3);
+    ASSERT_EQ(serial[t].param.num_deleted, parallel[t].param.num_deleted);
+    for (int nid = 0; nid < serial[t].param.num_nodes; ++nid) {
+      ASSERT_EQ(serial[t][nid].is_deleted(), parallel[t][nid].is_deleted());
+      ASSERT_EQ(serial[t][nid].is_leaf(), parallel[t][nid].is_leaf());
+      if (serial[t][nid].is_leaf()) {
+        ASSERT_EQ(serial[t][nid].leaf_value(), parallel[t][nid].leaf_value());
+      }
+    }
+  }
+}
+
+TEST(TreeRefresher, BatchedTrees) {
+  const size_t nrow = 300;
+  const int ntree = 6;
+  auto dmat = CreateDMatrix(nrow, 5, 0.1f);
+  dmat->InitColAccess(std::vector<bool>(5, true), 1.0f, nrow, true);
+  std::vector<RegTree> batched = GrowTrees(dmat.get(), ntree);
+  std::vector<RegTree> alone = batched;
+  HostDeviceVector<bst_gpair> gpair(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    gpair.data_h()[i] = bst_gpair(0.05f * (i % 7) - 0.2f, 0.5f);
+  }
+  const int nthread = omp_get_max_threads();
+  omp_set_num_threads(4);
+  // all the trees in one pass over the rows, the learning rate split among them
+  std::unique_ptr<TreeUpdater> refresher(TreeUpdater::Create("refresh"));
+  refresher->Init({{"learning_rate", "0.6"}});
+  refresher->Update(&gpair, dmat.get(), Pointers(&batched));
+  refresher->Init({{"learning_rate", "0.1"}});
+  for (RegTree& tree : alone) {
+    refresher->Update(&gpair, dmat.get(), {&tree});
+  }
+  omp_set_num_threads(nthread);
+  for (int t = 0; t < ntree; ++t) {
+    for (int nid = 0; nid < batched[t].param.num_nodes; ++nid) {
+      ASSERT_FLOAT_EQ(batched[t].stat(nid).sum_hess, alone[t].stat(nid).sum_hess);
+      ASSERT_FLOAT_EQ(batched[t].stat(nid).loss_chg, alone[t].stat(nid).loss_chg);
+      if (batched[t][nid].is_leaf()) {
+        ASSERT_FLOAT_EQ(batched[t][nid].leaf_value(), alone[t][nid].leaf_value());
+      }
+    }
+  }
+}
+}  // namespace xgboost
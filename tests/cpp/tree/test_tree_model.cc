@@ -0,0 +1,73 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/tree_model.h>
+#include <string>
+#include "../helpers.h"
+
+namespace xgboost {
+TEST(RegTree, DumpCode) {
+  RegTree tree;
+  tree.InitModel();
+  tree.AddChilds(0);
+  tree[0].set_split(2, 0.5f, true);
+  tree[tree[0].cleft()].set_leaf(-1.0f);
+  tree[tree[0].cright()].set_leaf(1.0f);
+  tree.stat(tree[0].cleft()).sum_hess = 1.0f;
+  tree.stat(tree[0].cright()).sum_hess = 3.0f;
+
+  std::string code = tree.DumpModel(FeatureMap(), false, "c");
+  // right child has more cover, the negated condition goes first
+  std::string cond = "if (XGB_LIKELY(!(XGB_ISNAN(f[2]) ? 1 : f[2] < ";
+  ASSERT_NE(code.find(cond), std::string::npos);
+  ASSERT_LT(code.find("return 1.000000000e+00f;"),
+            code.find("return -1.000000000e+00f;"));
+}
+
+TEST(RegTree, SparseFVec) {
+  RegTree::SparseFVec feats;
+  bst_float v;
+  EXPECT_FALSE(feats.Find(3, &v));
+  // first a short row, then a longer row growing the slots
+  for (bst_uint length : {3U, 200U}) {
+    std::vector<SparseBatch::Entry> row;
+    for (bst_uint i = 0; i < length; ++i) {
+      row.emplace_back(i * 7919U % 10000019U, 0.5f * i);
+    }
+    SparseBatch::Inst inst(row.data(), static_cast<bst_uint>(row.size()));
+    feats.Fill(inst);
+    for (const auto& e : row) {
+      ASSERT_TRUE(feats.Find(e.index, &v));
+      EXPECT_EQ(v, e.fvalue);
+      EXPECT_FALSE(feats.is_missing(e.index));
+      EXPECT_EQ(feats.fvalue(e.index), e.fvalue);
+    }
+    EXPECT_TRUE(feats.is_missing(1));
+    EXPECT_TRUE(feats.is_missing(10000018));
+    feats.Drop(inst);
+    for (const auto& e : row) {
+      EXPECT_TRUE(feats.is_missing(e.index));
+    }
+  }
+}
+
+TEST(RegTree, DumpCompactJson) {
+  RegTree tree;
+  tree.InitModel();
+  tree.AddChilds(0);
+  tree[0].set_split(2, 0.5f, true);
+  tree[tree[0].cleft()].set_leaf(-1.0f);
+  tree[tree[0].cright()].set_leaf(1.5f);
+  tree.stat(0).loss_chg = 2.0f;
+  tree.stat(0).sum_hess = 4.0f;
+  tree.stat(tree[0].cleft()).sum_hess = 1.0f;
+  tree.stat(tree[0].cright()).sum_hess = 3.0f;
+  EXPECT_EQ(tree.DumpModel(FeatureMap(), false, "json_compact"),
+            "{ \"num_roots\": 1, \"num_nodes\": 3"
+            ", \"left_children\": [1, -1, -1], \"right_children\": [2, -1, -1]"
+            ", \"default_left\": [1, 0, 0], \"split_indices\": [2, 0, 0]"
+            ", \"split_conditions\": [0.5, -1, 1.5] }");
+  std::string with_stats = tree.DumpModel(FeatureMap(), true, "json_compact");
+  EXPECT_NE(with_stats.find(", \"loss_changes\": [2, 0, 0], \"sum_hessians\": [4, 1, 3] }"),
+            std::string::npos);
+}
+}  // namespace xgboost